@@ -115,6 +115,7 @@ protected:
       this->SetErrorText(ERR_TIGER_DEV_NOT_SUPPORTED, g_Msg_ERR_TIGER_DEV_NOT_SUPPORTED);
       this->SetErrorText(ERR_CRISP_NOT_CALIBRATED, g_Msg_ERR_CRISP_NOT_CALIBRATED);
       this->SetErrorText(ERR_CRISP_NOT_LOCKED, g_Msg_ERR_CRISP_NOT_LOCKED);
+      this->SetErrorText(ERR_RB_REPEAT_NOT_SUPPORTED, g_Msg_ERR_RB_REPEAT_NOT_SUPPORTED);
       this->SetErrorText(ERR_UNKNOWN_COMMAND, g_Msg_ERR_UNKNOWN_COMMAND);
       this->SetErrorText(ERR_UNKNOWN_AXIS, g_Msg_ERR_UNKNOWN_AXIS);
       this->SetErrorText(ERR_MISSING_PARAM, g_Msg_ERR_MISSING_PARAM);
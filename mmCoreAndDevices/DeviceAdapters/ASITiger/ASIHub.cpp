@@ -51,7 +51,10 @@ ASIHub::ASIHub() :
       serialRepeatDuration_(0),
       serialRepeatPeriod_(500),
       serialOnlySendChanged_(true),
-      updatingSharedProperties_(false)
+      updatingSharedProperties_(false),
+      statusPollingPeriod_(0),
+      statusCacheMaxAge_(250),
+      statusPoller_(this)
 {
    CPropertyAction* pAct = new CPropertyAction(this, &ASIHub::OnPort);
    CreateProperty(MM::g_Keyword_Port, "Undefined", MM::String, false, pAct, true);
@@ -88,6 +91,27 @@ ASIHub::ASIHub() :
    AddAllowedValue(g_SerialTerminatorPropertyName, g_SerialTerminator_2);
    AddAllowedValue(g_SerialTerminatorPropertyName, g_SerialTerminator_3);
    AddAllowedValue(g_SerialTerminatorPropertyName, g_SerialTerminator_4);
+
+   // how often to poll position and status of the stages in the background; 0 disables polling
+   pAct = new CPropertyAction (this, &ASIHub::OnStatusPollingPeriod);
+   CreateProperty(g_StatusPollingPeriodPropertyName, "0", MM::Integer, false, pAct);
+   SetPropertyLimits(g_StatusPollingPeriodPropertyName, 0, 1000);
+
+   // how old polled values can be before the stages query the controller themselves again
+   pAct = new CPropertyAction (this, &ASIHub::OnStatusCacheMaxAge);
+   CreateProperty(g_StatusCacheMaxAgePropertyName, "250", MM::Integer, false, pAct);
+   SetPropertyLimits(g_StatusCacheMaxAgePropertyName, 0, 5000);
+}
+
+ASIHub::~ASIHub()
+{
+   statusPoller_.Stop();
+}
+
+int ASIHub::Shutdown()
+{
+   statusPoller_.Stop();
+   return ASIBase< ::HubBase, ASIHub >::Shutdown();
 }
 
 int ASIHub::ClearComPort(void)
@@ -100,6 +124,7 @@ int ASIHub::ClearComPort(void)
    */
 int ASIHub::QueryCommandUnterminatedResponse(const char *command, const long timeoutMs, unsigned long reply_length)
 {
+   MMThreadGuard g(threadLock_);
    RETURN_ON_MM_ERROR ( ClearComPort() );
    RETURN_ON_MM_ERROR ( SendSerialCommand(port_.c_str(), command, "\r") );
    serialCommand_ = command;
@@ -127,6 +152,7 @@ int ASIHub::QueryCommandUnterminatedResponse(const char *command, const long tim
 // Note that the property SerialResponse property will only show the first 1023 characters of the controller's reply.
 int ASIHub::QueryCommandLongReply(const char *command, const char *replyTerminator)
 {
+   MMThreadGuard g(threadLock_);
    RETURN_ON_MM_ERROR ( ClearComPort() );
    RETURN_ON_MM_ERROR ( SendSerialCommand(port_.c_str(), command, "\r") );
    serialCommand_ = command;
@@ -171,11 +197,210 @@ int ASIHub::QueryCommandVerify(const char *command, const char *expectedReplyPre
    return DEVICE_OK;
 }
 
-int ASIHub::ParseErrorReply() const
+int ASIHub::QueryCommandsPipelined(const vector<string> &commands, const string &expectedReplyPrefix, unsigned int window)
+{
+   MMThreadGuard g(threadLock_);
+   if (window < 1)
+      window = 1;
+   RETURN_ON_MM_ERROR ( ClearComPort() );
+   size_t nrSent = 0;
+   size_t nrReceived = 0;
+   int ret = DEVICE_OK;
+   while (nrReceived < nrSent || (ret == DEVICE_OK && nrSent < commands.size()))
+   {
+      while (ret == DEVICE_OK && nrSent < commands.size() && nrSent - nrReceived < window)
+      {
+         RETURN_ON_MM_ERROR ( SendSerialCommand(port_.c_str(), commands[nrSent].c_str(), "\r") );
+         ++nrSent;
+      }
+      string answer;
+      RETURN_ON_MM_ERROR ( GetSerialAnswer(port_.c_str(), g_SerialTerminatorDefault, answer) );
+      if (ret == DEVICE_OK && answer.compare(0, expectedReplyPrefix.length(), expectedReplyPrefix) != 0)
+         ret = ParseErrorReply(answer);  // still read the replies to the commands already sent
+      ++nrReceived;
+   }
+   return ret;
+}
+
+// Like QueryCommand() but leaves serialCommand_ and serialAnswer_ alone, because
+//   the poller thread can run between a peripheral's query and its parsing of the reply
+int ASIHub::QueryStatusCommand(const string &command, string &answer)
+{
+   MMThreadGuard g(threadLock_);
+   RETURN_ON_MM_ERROR ( ClearComPort() );
+   RETURN_ON_MM_ERROR ( SendSerialCommand(port_.c_str(), command.c_str(), "\r") );
+   RETURN_ON_MM_ERROR ( GetSerialAnswer(port_.c_str(), g_SerialTerminatorDefault, answer) );
+   return DEVICE_OK;
+}
+
+int ASIHub::QueryCommandVerifyAnswer(const string &command, const string &expectedReplyPrefix, string &answer)
+{
+   RETURN_ON_MM_ERROR ( QueryStatusCommand(command, answer) );
+   if (answer.compare(0, expectedReplyPrefix.length(), expectedReplyPrefix) != 0)
+      return ParseErrorReply(answer);
+   return DEVICE_OK;
+}
+
+void ASIHub::RegisterPolledAxis(const string &deviceLabel, const string &addressChar, const string &axisLetter, bool pollBusy)
+{
+   MMThreadGuard g(cacheLock_);
+   PolledAxis axis;
+   axis.deviceLabel = deviceLabel;
+   axis.addressChar = addressChar;
+   axis.pollBusy = pollBusy;
+   axis.generation = 0;
+   axis.positionValid = false;
+   axis.position = 0.0;
+   axis.busyValid = false;
+   axis.busy = false;
+   polledAxes_[axisLetter] = axis;
+}
+
+void ASIHub::UnRegisterPolledAxes(const string &deviceLabel)
+{
+   MMThreadGuard g(cacheLock_);
+   map<string, PolledAxis>::iterator it = polledAxes_.begin();
+   while (it != polledAxes_.end())
+   {
+      if (it->second.deviceLabel == deviceLabel)
+         polledAxes_.erase(it++);
+      else
+         ++it;
+   }
+}
+
+bool ASIHub::IsCacheFresh(const MM::MMTime &sampleTime)
+{
+   return statusPoller_.IsRunning() &&
+         (GetCurrentMMTime() - sampleTime).getMsec() <= statusCacheMaxAge_;
+}
+
+bool ASIHub::GetCachedPosition(const string &axisLetter, double &pos)
+{
+   MMThreadGuard g(cacheLock_);
+   map<string, PolledAxis>::const_iterator it = polledAxes_.find(axisLetter);
+   if (it == polledAxes_.end() || !it->second.positionValid || !IsCacheFresh(it->second.positionTime))
+      return false;
+   pos = it->second.position;
+   return true;
+}
+
+bool ASIHub::GetCachedBusy(const string &axisLetter, bool &busy)
+{
+   MMThreadGuard g(cacheLock_);
+   map<string, PolledAxis>::const_iterator it = polledAxes_.find(axisLetter);
+   if (it == polledAxes_.end() || !it->second.busyValid || !IsCacheFresh(it->second.busyTime))
+      return false;
+   busy = it->second.busy;
+   return true;
+}
+
+void ASIHub::InvalidateCachedStatus(const string &addressChar)
+{
+   MMThreadGuard g(cacheLock_);
+   for (map<string, PolledAxis>::iterator it = polledAxes_.begin(); it != polledAxes_.end(); ++it)
+   {
+      if (it->second.addressChar == addressChar)
+      {
+         ++it->second.generation;
+         it->second.positionValid = false;
+         it->second.busyValid = false;
+      }
+   }
+}
+
+int ASIHub::PollStatus()
+{
+   // group the axes by card: the controller replies to a multi-axis query in the order
+   //   of the axes only if they are on the same card
+   map<string, vector<string> > cardAxes;
+   map<string, vector<string> > cardBusyAxes;
+   map<string, unsigned long> generations;
+   {
+      MMThreadGuard g(cacheLock_);
+      for (map<string, PolledAxis>::const_iterator it = polledAxes_.begin(); it != polledAxes_.end(); ++it)
+      {
+         cardAxes[it->second.addressChar].push_back(it->first);
+         if (it->second.pollBusy)
+            cardBusyAxes[it->second.addressChar].push_back(it->first);
+         generations[it->first] = it->second.generation;
+      }
+   }
+
+   int ret = DEVICE_OK;
+   for (map<string, vector<string> >::const_iterator card = cardAxes.begin(); card != cardAxes.end(); ++card)
+   {
+      const vector<string> &axes = card->second;
+
+      // position reply is like ":A 123.4 -56.7"
+      ostringstream command; command.str("");
+      command << "W";
+      for (unsigned int i=0; i<axes.size(); ++i)
+         command << " " << axes[i];
+      string answer;
+      ret = QueryStatusCommand(command.str(), answer);
+      MM::MMTime sampleTime = GetCurrentMMTime();
+      vector<string> tokens;
+      CDeviceUtils::Tokenize(answer, tokens, " ");
+      bool positionsOK = (ret == DEVICE_OK && tokens.size() == axes.size() + 1 && tokens[0] == ":A");
+
+      // busy reply has one character per axis, e.g. ":A NB" or ":A N B"
+      const vector<string> &busyAxes = cardBusyAxes[card->first];
+      string busyChars;
+      if (!busyAxes.empty())
+      {
+         command.str("");
+         command << "RS";
+         for (unsigned int i=0; i<busyAxes.size(); ++i)
+            command << " " << busyAxes[i] << "?";
+         ret = QueryStatusCommand(command.str(), answer);
+         if (ret == DEVICE_OK && answer.compare(0, 2, ":A") == 0)
+         {
+            for (unsigned int i=2; i<answer.length(); ++i)
+            {
+               if (answer[i] != ' ')
+                  busyChars.push_back(answer[i]);
+            }
+         }
+      }
+      bool busyOK = (busyChars.length() == busyAxes.size());
+
+      MMThreadGuard g(cacheLock_);
+      if (positionsOK)
+      {
+         for (unsigned int i=0; i<axes.size(); ++i)
+         {
+            map<string, PolledAxis>::iterator it = polledAxes_.find(axes[i]);
+            if (it != polledAxes_.end() && it->second.generation == generations[axes[i]])
+            {
+               it->second.position = atof(tokens[i+1].c_str());
+               it->second.positionTime = sampleTime;
+               it->second.positionValid = true;
+            }
+         }
+      }
+      if (busyOK)
+      {
+         for (unsigned int i=0; i<busyAxes.size(); ++i)
+         {
+            map<string, PolledAxis>::iterator it = polledAxes_.find(busyAxes[i]);
+            if (it != polledAxes_.end() && it->second.generation == generations[busyAxes[i]])
+            {
+               it->second.busy = (busyChars[i] == 'B');
+               it->second.busyTime = sampleTime;
+               it->second.busyValid = true;
+            }
+         }
+      }
+   }
+   return ret;
+}
+
+int ASIHub::ParseErrorReply(const string &answer)
 {
-   if (serialAnswer_.length() > 3 && serialAnswer_.substr(0, 2).compare(":N") == 0)
+   if (answer.length() > 3 && answer.substr(0, 2).compare(":N") == 0)
    {
-      int errNo = atoi(serialAnswer_.substr(3).c_str());
+      int errNo = atoi(answer.substr(3).c_str());
       return ERR_ASICODE_OFFSET + errNo;
     }
     return ERR_UNRECOGNIZED_ANSWER;
@@ -194,12 +419,17 @@ int ASIHub::ParseAnswerAfterEquals(double &val)
 
 int ASIHub::ParseAnswerAfterEquals(long &val)
 {
-   size_t pos = serialAnswer_.find("=");
-   if ((pos == string::npos) || ((pos+1) >= serialAnswer_.length()))
+   return ParseAnswerAfterEquals(serialAnswer_, val);
+}
+
+int ASIHub::ParseAnswerAfterEquals(const string &answer, long &val)
+{
+   size_t pos = answer.find("=");
+   if ((pos == string::npos) || ((pos+1) >= answer.length()))
    {
       return ERR_UNRECOGNIZED_ANSWER;
    }
-   val = atol(serialAnswer_.substr(serialAnswer_.find("=")+1).c_str());
+   val = atol(answer.substr(pos+1).c_str());
    return DEVICE_OK;
 }
 
@@ -654,6 +884,41 @@ int ASIHub::OnSerialCommandRepeatPeriod(MM::PropertyBase* pProp, MM::ActionType
    return DEVICE_OK;
 }
 
+int ASIHub::OnStatusPollingPeriod(MM::PropertyBase* pProp, MM::ActionType eAct)
+{
+   if (eAct == MM::BeforeGet)
+   {
+      pProp->Set(statusPollingPeriod_);
+   }
+   else if (eAct == MM::AfterSet) {
+      long tmp = 0;
+      pProp->Get(tmp);
+      if (tmp < 0) tmp = 0;
+      statusPollingPeriod_ = tmp;
+      if (statusPollingPeriod_ > 0)
+         statusPoller_.Start(statusPollingPeriod_);
+      else
+         statusPoller_.Stop();
+   }
+   return DEVICE_OK;
+}
+
+int ASIHub::OnStatusCacheMaxAge(MM::PropertyBase* pProp, MM::ActionType eAct)
+{
+   if (eAct == MM::BeforeGet)
+   {
+      pProp->Set(statusCacheMaxAge_);
+   }
+   else if (eAct == MM::AfterSet) {
+      long tmp = 0;
+      pProp->Get(tmp);
+      if (tmp < 0) tmp = 0;
+      MMThreadGuard g(cacheLock_);
+      statusCacheMaxAge_ = tmp;
+   }
+   return DEVICE_OK;
+}
+
 int ASIHub::OnSerialCommandOnlySendChanged(MM::PropertyBase* pProp, MM::ActionType eAct)
 {
    string tmpstr;
@@ -786,3 +1051,54 @@ vector<int> ASIHub::ConvertStringVector2IntVector(const vector<string> v)
    return result;
 }
 
+
+///////////////////////////////////////////////////////////////////////////////
+// ASIHubStatusPoller implementation
+//
+void ASIHubStatusPoller::Start(long periodMs)
+{
+   MMThreadGuard g(lock_);
+   periodMs_ = periodMs;
+   if (stop_)
+   {
+      stop_ = false;
+      activate();
+   }
+}
+
+void ASIHubStatusPoller::Stop()
+{
+   {
+      MMThreadGuard g(lock_);
+      if (stop_)
+         return;
+      stop_ = true;
+   }
+   wait();
+}
+
+bool ASIHubStatusPoller::IsRunning()
+{
+   MMThreadGuard g(lock_);
+   return !stop_;
+}
+
+int ASIHubStatusPoller::svc()
+{
+   for (;;)
+   {
+      long periodMs;
+      {
+         MMThreadGuard g(lock_);
+         if (stop_)
+            break;
+         periodMs = periodMs_;
+      }
+      hub_->PollStatus();  // errors just leave the cache stale, stages then query directly
+
+      // sleep in short steps to stop promptly
+      for (long slept = 0; slept < periodMs && IsRunning(); slept += 10)
+         CDeviceUtils::SleepMs(10);
+   }
+   return 0;
+}
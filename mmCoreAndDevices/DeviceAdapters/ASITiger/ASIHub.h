@@ -30,9 +30,31 @@
 #include "DeviceBase.h"
 #include "DeviceThreads.h"
 #include <string>
+#include <map>
 
 using namespace std;
 
+class ASIHub;
+
+// background thread that periodically calls ASIHub::PollStatus()
+class ASIHubStatusPoller : public MMDeviceThreadBase
+{
+public:
+   ASIHubStatusPoller(ASIHub* hub) : hub_(hub), periodMs_(0), stop_(true) { }
+   ~ASIHubStatusPoller() { Stop(); }
+
+   void Start(long periodMs);
+   void Stop();
+   bool IsRunning();
+   int svc();
+
+private:
+   ASIHub* hub_;
+   long periodMs_;
+   bool stop_;
+   MMThreadLock lock_;
+};
+
 ////////////////////////////////////////////////////////////////
 // *********** generic ASI comm class *************************
 // implements a "hub" device with communication abilities
@@ -46,7 +68,9 @@ class ASIHub : public ASIBase<HubBase, ASIHub>
 {
 public:
 	ASIHub();
-	~ASIHub() { }
+	~ASIHub();
+
+   int Shutdown();
 
 	// Communication base functions
    int ClearComPort();
@@ -90,6 +114,18 @@ public:
       { return QueryCommandVerify(command.c_str(), expectedReplyPrefix.c_str(), replyTerminator.c_str(), delayMs); }
 
    // accessing serial commands and answers
+   // QueryCommandsPipelined sends the commands back-to-back, with up to window commands awaiting their
+   //   replies instead of waiting for each reply before sending the next command, and makes sure all
+   //   replies start with expectedReplyPrefix.  Stops sending at the first unexpected reply.
+   // Used to upload long lists of commands (e.g. ring buffer contents); window must be small enough
+   //   that the pending commands fit the controller's serial input buffer.
+   //   Leaves serialCommand_ and serialAnswer_ alone, so it may be called from other threads.
+   int QueryCommandsPipelined(const vector<string> &commands, const string &expectedReplyPrefix, unsigned int window);
+
+   // Like QueryCommandVerify but returns the reply in answer instead of serialAnswer_, which other threads
+   //   may overwrite between the query and the parsing of its reply (e.g. the scanner's ring buffer streamer)
+   int QueryCommandVerifyAnswer(const string &command, const string &expectedReplyPrefix, string &answer);
+
    string LastSerialAnswer() const { return serialAnswer_; } // use with caution!; crashes to access something that doesn't exist!
    string LastSerialCommand() const { return serialCommand_; }
    void SetLastSerialAnswer(string s) { serialAnswer_ = s; }  // used to parse subsets of full answer for commands like PZINFO using "Split" functions
@@ -98,6 +134,7 @@ public:
    int ParseAnswerAfterEquals(double &val);  // finds next number after equals sign and returns as float
    int ParseAnswerAfterEquals(long &val);  // finds next number after equals sign and returns as long int
    int ParseAnswerAfterEquals(unsigned int &val);  // finds next number after equals sign and returns as long int
+   static int ParseAnswerAfterEquals(const string &answer, long &val);  // same for an answer from QueryCommandVerifyAnswer
    int ParseAnswerAfterUnderscore(unsigned int &val);  // finds next number after underscore and returns as long int
    int ParseAnswerAfterColon(double &val);  // finds next number after colon and returns as float
    int ParseAnswerAfterColon(long &val);  // finds next number after colon and returns as long int
@@ -134,6 +171,19 @@ public:
       deviceMap_.erase(deviceLabel);  // remove device from lookup table
    }
 
+   // Background status polling: while enabled, the hub reads the position (and busy
+   //   state if requested) of all registered axes with one query per card instead of
+   //   one query per axis per call, and peripherals answer from the cached values
+   //   as long as they are recent enough.  Peripherals must invalidate the cache
+   //   after sending motion commands so they don't report a stale position or state.
+   // Cached positions are in controller units as in the reply to "W".
+   void RegisterPolledAxis(const string &deviceLabel, const string &addressChar, const string &axisLetter, bool pollBusy);
+   void UnRegisterPolledAxes(const string &deviceLabel);
+   bool GetCachedPosition(const string &axisLetter, double &pos);  // returns false if no fresh value
+   bool GetCachedBusy(const string &axisLetter, bool &busy);       // returns false if no fresh value
+   void InvalidateCachedStatus(const string &addressChar);         // invalidates all axes of the card
+   int PollStatus();  // one polling cycle, called from the poller thread
+
    bool UpdatingSharedProperties() { return updatingSharedProperties_; }
 
    int UpdateSharedProperties(string addressChar, string propName, string value);
@@ -146,16 +196,36 @@ public:
    int OnSerialCommandRepeatDuration(MM::PropertyBase* pProp, MM::ActionType eAct);
    int OnSerialCommandRepeatPeriod  (MM::PropertyBase* pProp, MM::ActionType eAct);
    int OnSerialCommandOnlySendChanged(MM::PropertyBase* pProp, MM::ActionType eAct);
+   int OnStatusPollingPeriod        (MM::PropertyBase* pProp, MM::ActionType eAct);
+   int OnStatusCacheMaxAge          (MM::PropertyBase* pProp, MM::ActionType eAct);
 
 protected:
    string port_;         // port to use for communication
 
 private:
-	int ParseErrorReply() const;
+	int ParseErrorReply() const { return ParseErrorReply(serialAnswer_); }
+	static int ParseErrorReply(const string &answer);
 	static string EscapeControlCharacters(const string v);
 	static string UnescapeControlCharacters(const string v0 );
 	static vector<char> ConvertStringVector2CharVector(const vector<string> v);
 	static vector<int> ConvertStringVector2IntVector(const vector<string> v);
+   int QueryStatusCommand(const string &command, string &answer);  // doesn't touch serialAnswer_
+   bool IsCacheFresh(const MM::MMTime &sampleTime);
+
+   struct PolledAxis
+   {
+      string deviceLabel;
+      string addressChar;
+      bool pollBusy;
+      unsigned long generation;  // incremented on invalidation, so that replies to queries
+                                 //   sent before a motion command are discarded
+      bool positionValid;
+      double position;
+      MM::MMTime positionTime;
+      bool busyValid;
+      bool busy;
+      MM::MMTime busyTime;
+   };
 
    string serialAnswer_;      // the last answer received from any communication with the controller
    string manualSerialAnswer_; // last answer received when the SerialCommand property was used
@@ -168,6 +238,11 @@ private:
    bool updatingSharedProperties_;
    map<string, string> deviceMap_;  // to implement properties shared between devices
         // key is the device name, value is the Tiger address (normally a single character, see note about addressChar_ in ASIPeripheralBase)
+   map<string, PolledAxis> polledAxes_;  // key is the axis letter
+   MMThreadLock cacheLock_;   // guards polledAxes_
+   long statusPollingPeriod_; // ms between polling cycles, 0 disables polling
+   long statusCacheMaxAge_;   // ms for which polled values are used
+   ASIHubStatusPoller statusPoller_;
 
 };
 
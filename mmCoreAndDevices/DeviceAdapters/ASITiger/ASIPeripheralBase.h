@@ -66,6 +66,7 @@ public:
       string str(deviceLabel);
       if (hub_) {
          hub_->UnRegisterPeripheral(str);
+         hub_->UnRegisterPolledAxes(str);
       }
       return (ASIBase<TDeviceBase, UConcreteDevice>::Shutdown());
    }
@@ -136,6 +137,15 @@ public:
    }
 
 protected:
+   // lets the hub poll the axis position (and busy state if requested) in the background
+   // see ASIHub::RegisterPolledAxis()
+   void RegisterPolledAxis(const string &axisLetter, bool pollBusy)
+   {
+      char deviceLabel[MM::MaxStrLength];
+      this->GetLabel(deviceLabel);
+      hub_->RegisterPolledAxis(deviceLabel, addressChar_, axisLetter, pollBusy);
+   }
+
    ASIHub *hub_;           // pointer to hub object used for serial communication
    string addressString_;  // address within hub, in hex format, should be two characters (e.g. '31')
    string addressChar_;    // address within hub, in single character (allowed to be extended ASCII so use string to store)
@@ -85,6 +85,9 @@ int CPiezo::Initialize()
    command << addressChar_ << "VB Z=2";
    RETURN_ON_MM_ERROR ( hub_->QueryCommand(command.str()) );
 
+   // let the hub poll position in the background (if enabled in the hub); piezo is never busy
+   RegisterPolledAxis(axisLetter_, false);
+
    // expose the step size to user as read-only property (no need for action handler)
    command.str("");
    command << g_StageMinStepSize;
@@ -429,6 +432,11 @@ int CPiezo::Initialize()
 
 int CPiezo::GetPositionUm(double& pos)
 {
+   if (hub_->GetCachedPosition(axisLetter_, pos))
+   {
+      pos = pos/unitMult_;
+      return DEVICE_OK;
+   }
    ostringstream command; command.str("");
    command << "W " << axisLetter_;
    RETURN_ON_MM_ERROR ( hub_->QueryCommandVerify(command.str(),":A") );
@@ -441,15 +449,22 @@ int CPiezo::SetPositionUm(double pos)
 {
    ostringstream command; command.str("");
    command << "M " << axisLetter_ << "=" << pos*unitMult_;
-   return hub_->QueryCommandVerify(command.str(),":A");
+   int ret = hub_->QueryCommandVerify(command.str(),":A");
+   hub_->InvalidateCachedStatus(addressChar_);
+   return ret;
 }
 
 int CPiezo::GetPositionSteps(long& steps)
 {
+   double tmp;
+   if (hub_->GetCachedPosition(axisLetter_, tmp))
+   {
+      steps = (long)(tmp/unitMult_/stepSizeUm_);
+      return DEVICE_OK;
+   }
    ostringstream command; command.str("");
    command << "W " << axisLetter_;
    RETURN_ON_MM_ERROR ( hub_->QueryCommandVerify(command.str(),":A") );
-   double tmp;
    RETURN_ON_MM_ERROR ( hub_->ParseAnswerAfterPosition2(tmp) );
    steps = (long)(tmp/unitMult_/stepSizeUm_);
    return DEVICE_OK;
@@ -459,14 +474,18 @@ int CPiezo::SetPositionSteps(long steps)
 {
    ostringstream command; command.str("");
    command << "M " << axisLetter_ << "=" << steps*unitMult_*stepSizeUm_;
-   return hub_->QueryCommandVerify(command.str(),":A");
+   int ret = hub_->QueryCommandVerify(command.str(),":A");
+   hub_->InvalidateCachedStatus(addressChar_);
+   return ret;
 }
 
 int CPiezo::SetRelativePositionUm(double d)
 {
    ostringstream command; command.str("");
    command << "R " << axisLetter_ << "=" << d*unitMult_;
-   return hub_->QueryCommandVerify(command.str(),":A");
+   int ret = hub_->QueryCommandVerify(command.str(),":A");
+   hub_->InvalidateCachedStatus(addressChar_);
+   return ret;
 }
 
 int CPiezo::GetLimits(double& min, double& max)
@@ -491,7 +510,9 @@ int CPiezo::Stop()
    // note this stops the card, \ stops all stages
    ostringstream command; command.str("");
    command << addressChar_ << "halt";
-   return hub_->QueryCommand(command.str());
+   int ret = hub_->QueryCommand(command.str());
+   hub_->InvalidateCachedStatus(addressChar_);
+   return ret;
 }
 
 int CPiezo::Home()
@@ -506,8 +527,9 @@ int CPiezo::Home()
    }
    ostringstream command; command.str("");
    command << "! " << axisLetter_;
-   RETURN_ON_MM_ERROR ( hub_->QueryCommandVerify(command.str(), ":A") );
-   return DEVICE_OK;
+   int ret = hub_->QueryCommandVerify(command.str(), ":A");
+   hub_->InvalidateCachedStatus(addressChar_);
+   return ret;
 }
 
 bool CPiezo::Busy()
@@ -519,7 +541,9 @@ int CPiezo::SetOrigin()
 {
    ostringstream command; command.str("");
    command << "H " << axisLetter_ << "=" << 0;
-   return hub_->QueryCommandVerify(command.str(),":A");
+   int ret = hub_->QueryCommandVerify(command.str(),":A");
+   hub_->InvalidateCachedStatus(addressChar_);
+   return ret;
 }
 
 int CPiezo::StopStageSequence()
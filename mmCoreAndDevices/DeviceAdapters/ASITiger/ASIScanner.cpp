@@ -37,6 +37,14 @@
 
 using namespace std;
 
+// ring buffer size assumed if the firmware doesn't report it
+const long g_ScannerDefaultRingBufferCapacity = 50;
+// number of "LD" commands sent ahead of their replies when uploading the ring buffer,
+//   limited by the controller's serial input buffer
+const unsigned int g_RingBufferUploadWindow = 8;
+// how often to check whether the ring buffer has finished playing a segment
+const long g_RingBufferPollMs = 10;
+
 // as of mid-2017 assume that have only single (two-axis) mmTarget device per Tiger card
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -61,6 +69,11 @@ CScanner::CScanner(const char* name) :
    saStateY_(),
    polygonRepetitions_(0),
    ring_buffer_supported_(false),
+   ring_buffer_capacity_(g_ScannerDefaultRingBufferCapacity),
+   ringBufferCommands_(),
+   ringBufferShutterCommand_(""),
+   loadedSegment_(0),
+   streamer_(this),
    laser_side_(0),   // will be set to 1 or 2 if used
    laserTTLenabled_(false),
    mmTarget_(false),
@@ -532,6 +545,15 @@ int CScanner::Initialize()
    {
       ring_buffer_supported_ = true;
 
+      // get the number of ring buffer positions from the BU X output
+      string rb_define = hub_->GetDefineString(build, "RING BUFFER");
+      if (rb_define.size() > 12)
+      {
+         long capacity = atol(rb_define.substr(11).c_str());
+         if (capacity > 1)
+            ring_buffer_capacity_ = capacity;
+      }
+
       pAct = new CPropertyAction (this, &CScanner::OnRBMode);
       CreateProperty(g_RB_ModePropertyName, g_RB_OnePoint_1, MM::String, false, pAct);
       AddAllowedValue(g_RB_ModePropertyName, g_RB_OnePoint_1);
@@ -649,7 +671,8 @@ int CScanner::Initialize()
 
 bool CScanner::Busy()
 {
-   return false;
+   // busy while a pattern longer than the ring buffer is being streamed
+   return streamer_.IsRunning();
 }
 
 int CScanner::SetPosition(double x, double y)
@@ -909,26 +932,30 @@ int CScanner::LoadPolygons()
 {
    if (ring_buffer_supported_)
    {
+      streamer_.Stop();
+      ringBufferCommands_.clear();
+      ringBufferShutterCommand_ = "";
       ostringstream command; command.str("");
-      command << addressChar_ << "RM X=0";
-      RETURN_ON_MM_ERROR ( hub_->QueryCommandVerify(command.str(), ":A") );
       for (int i=0; i< (int) polygons_.size(); ++i)
       {
          command.str("");
          command << "LD " << axisLetterX_ << "=" << polygons_[i].first*unitMultX_
                << " " << axisLetterY_ << "=" << polygons_[i].second*unitMultY_;
-         RETURN_ON_MM_ERROR ( hub_->QueryCommandVerify(command.str(), ":A") );
+         ringBufferCommands_.push_back(command.str());
       }
       if (!mmTarget_)
       {
          // TODO only blank at end for non-repeat g_RB_PlayRepeat_3
 
          // make the last point the home/shutter position for non-target firmware
+         // (of each segment, so the beam is off while the next segment is loaded)
          command.str("");
          command << "LD " << axisLetterX_ << "=" << shutterX_*unitMultX_
                << " " << axisLetterY_ << "=" << shutterY_*unitMultY_;
-         RETURN_ON_MM_ERROR ( hub_->QueryCommandVerify(command.str(), ":A") );
+         ringBufferShutterCommand_ = command.str();
       }
+      // load the start of the pattern now, the rest is streamed in while running
+      RETURN_ON_MM_ERROR ( LoadRingBufferSegment(0) );
    }
    else
    {
@@ -947,30 +974,17 @@ int CScanner::RunPolygons()
 {
    if (ring_buffer_supported_)
    {
+      streamer_.Stop();
       RETURN_ON_MM_ERROR ( SetProperty(g_RB_ModePropertyName, g_RB_PlayOnce_2) );
 
       // essentially like SetIlluminationState(true) but no caching
       illuminationState_ = true;
       RETURN_ON_MM_ERROR ( SetIlluminationStateHelper(true) );
 
-      // trigger ring buffer requested number of times, sleeping until done
+      // play pattern requested number of times, sleeping until done
       // TODO support specified # of repeats in firmware directly
       for (int j=0; j<polygonRepetitions_; ++j) {
-         RETURN_ON_MM_ERROR ( SetProperty(g_RB_TriggerPropertyName, g_DoItState) );
-         bool done = false;
-         do {
-            char propValue[MM::MaxStrLength];
-            refreshOverride_ = true;
-            // check flag to see if we are still playing
-            // flag goes low as soon as last point is moved to, which we have as home/shutter
-            // so will be briefly shuttered and then start up again
-            RETURN_ON_MM_ERROR ( GetProperty(g_RB_AutoplayRunningPropertyName, propValue) );
-            if (strcmp(propValue, g_YesState) == 0) {
-               CDeviceUtils::SleepMs(100);
-            } else {
-               done = true;
-            }
-         } while (!done);
+         RETURN_ON_MM_ERROR ( PlayRingBufferSegments() );
       }
 
       // essentially like SetIlluminationState(false) but no caching
@@ -1004,8 +1018,27 @@ int CScanner::RunSequence()
    {
       // should consider ensuring that RM Y is set appropriately with axisIndexX_ and axisIndexY_
 
-      // note that this simply sends a trigger, which will also turn it off if it's currently running
-      RETURN_ON_MM_ERROR ( SetProperty(g_RB_TriggerPropertyName, g_DoItState) );
+      streamer_.Stop();
+      if (NumberOfRingBufferSegments() <= 1)
+      {
+         // note that this simply sends a trigger, which will also turn it off if it's currently running
+         RETURN_ON_MM_ERROR ( SetProperty(g_RB_TriggerPropertyName, g_DoItState) );
+      }
+      else
+      {
+         // pattern is longer than the ring buffer, play it one segment after the other in the background
+         // each segment is played once, so the repeat mode cannot be honored
+         char mode[MM::MaxStrLength];
+         RETURN_ON_MM_ERROR ( GetProperty(g_RB_ModePropertyName, mode) );
+         if (strcmp(mode, g_RB_PlayRepeat_3) == 0)
+            return ERR_RB_REPEAT_NOT_SUPPORTED;
+         if (strcmp(mode, g_RB_PlayOnce_2) != 0)
+         {
+            LogMessage("switching ring buffer mode to play once to stream the pattern", false);
+            RETURN_ON_MM_ERROR ( SetProperty(g_RB_ModePropertyName, g_RB_PlayOnce_2) );
+         }
+         streamer_.Start();
+      }
       return DEVICE_OK;
    }
    else
@@ -1014,6 +1047,160 @@ int CScanner::RunSequence()
    }
 }
 
+int CScanner::StopSequence()
+{
+   if (!ring_buffer_supported_)
+      return DEVICE_UNSUPPORTED_COMMAND;
+   streamer_.Stop();
+   bool running = false;
+   RETURN_ON_MM_ERROR ( IsRingBufferRunning(running) );
+   if (running)
+   {
+      // a trigger while playing stops the ring buffer
+      RETURN_ON_MM_ERROR ( TriggerRingBuffer() );
+   }
+   return DEVICE_OK;
+}
+
+size_t CScanner::RingBufferSegmentLength() const
+{
+   return ringBufferShutterCommand_.empty() ? ring_buffer_capacity_ : ring_buffer_capacity_ - 1;
+}
+
+size_t CScanner::NumberOfRingBufferSegments() const
+{
+   return (ringBufferCommands_.size() + RingBufferSegmentLength() - 1) / RingBufferSegmentLength();
+}
+
+// clears the ring buffer and uploads the specified segment of the pattern using pipelined writes
+int CScanner::LoadRingBufferSegment(size_t segment)
+{
+   ostringstream command; command.str("");
+   command << addressChar_ << "RM X=0";  // clear ring buffer
+   vector<string> commands(1, command.str());
+   size_t first = min(segment * RingBufferSegmentLength(), ringBufferCommands_.size());
+   size_t last = min(first + RingBufferSegmentLength(), ringBufferCommands_.size());
+   commands.insert(commands.end(), ringBufferCommands_.begin() + first, ringBufferCommands_.begin() + last);
+   if (!ringBufferShutterCommand_.empty())
+      commands.push_back(ringBufferShutterCommand_);
+   loadedSegment_ = NumberOfRingBufferSegments();  // i.e. none, in case upload fails part way
+   RETURN_ON_MM_ERROR ( hub_->QueryCommandsPipelined(commands, ":A", g_RingBufferUploadWindow) );
+   loadedSegment_ = segment;
+   return DEVICE_OK;
+}
+
+// like setting g_RB_TriggerPropertyName but doesn't go through the property (may be called from streamer_)
+int CScanner::TriggerRingBuffer()
+{
+   ostringstream command; command.str("");
+   command << addressChar_ << "RM";
+   string answer;
+   RETURN_ON_MM_ERROR ( hub_->QueryCommandVerifyAnswer(command.str(), ":A", answer) );
+   return DEVICE_OK;
+}
+
+// like reading g_RB_AutoplayRunningPropertyName but doesn't go through the property (may be called from streamer_)
+int CScanner::IsRingBufferRunning(bool &running)
+{
+   ostringstream command; command.str("");
+   ostringstream response; response.str("");
+   string pseudoAxisChar = FirmwareVersionAtLeast(2.89) ? "F" : "X";
+   long tmp = 0;
+   command << addressChar_ << "RM " << pseudoAxisChar << "?";
+   response << ":A " << pseudoAxisChar << "=";
+   string answer;
+   RETURN_ON_MM_ERROR ( hub_->QueryCommandVerifyAnswer(command.str(), response.str(), answer) );
+   RETURN_ON_MM_ERROR ( ASIHub::ParseAnswerAfterEquals(answer, tmp) );
+   running = (tmp >= 128);
+   return DEVICE_OK;
+}
+
+// Plays the loaded polygon pattern once.  If it doesn't fit in the ring buffer then each segment is
+//   played in turn, the next one being uploaded as soon as the ring buffer stops.  Afterwards the
+//   first segment is loaded again so that the pattern can be repeated.
+int CScanner::PlayRingBufferSegments()
+{
+   size_t nrSegments = NumberOfRingBufferSegments();
+   if (nrSegments == 0)
+      nrSegments = 1;  // nothing loaded with LoadPolygons(), play whatever the ring buffer has
+   for (size_t segment = 0; segment < nrSegments && !streamer_.IsStopRequested(); ++segment)
+   {
+      if (nrSegments > 1 && loadedSegment_ != segment)
+         RETURN_ON_MM_ERROR ( LoadRingBufferSegment(segment) );
+      RETURN_ON_MM_ERROR ( TriggerRingBuffer() );
+      // check flag to see if we are still playing
+      // flag goes low as soon as last point is moved to, which we have as home/shutter
+      // so will be briefly shuttered and then start up again
+      bool running = true;
+      while (running && !streamer_.IsStopRequested())
+      {
+         RETURN_ON_MM_ERROR ( IsRingBufferRunning(running) );
+         if (running)
+            CDeviceUtils::SleepMs(g_RingBufferPollMs);
+      }
+   }
+   if (nrSegments > 1 && loadedSegment_ != 0 && !streamer_.IsStopRequested())
+      RETURN_ON_MM_ERROR ( LoadRingBufferSegment(0) );
+   return DEVICE_OK;
+}
+
+int CScanner::Shutdown()
+{
+   streamer_.Stop();
+   return ASIPeripheralBase< ::CGalvoBase, CScanner >::Shutdown();
+}
+
+void CScannerPatternStreamer::Start()
+{
+   Stop();  // waits for a previous run that has finished by itself
+   MMThreadGuard g(lock_);
+   stopRequested_ = false;
+   running_ = true;
+   joinable_ = true;
+   activate();
+}
+
+void CScannerPatternStreamer::Stop()
+{
+   {
+      MMThreadGuard g(lock_);
+      if (!joinable_)
+         return;
+      stopRequested_ = true;
+   }
+   wait();
+   MMThreadGuard g(lock_);
+   joinable_ = false;
+   running_ = false;
+   stopRequested_ = false;
+}
+
+bool CScannerPatternStreamer::IsRunning()
+{
+   MMThreadGuard g(lock_);
+   return running_;
+}
+
+bool CScannerPatternStreamer::IsStopRequested()
+{
+   MMThreadGuard g(lock_);
+   return stopRequested_;
+}
+
+int CScannerPatternStreamer::svc()
+{
+   int ret = scanner_->PlayRingBufferSegments();
+   if (ret != DEVICE_OK)
+   {
+      ostringstream msg; msg.str("");
+      msg << "streaming of polygon pattern failed with error " << ret;
+      scanner_->LogMessage(msg.str(), false);
+   }
+   MMThreadGuard g(lock_);
+   running_ = false;
+   return 0;
+}
+
 int CScanner::SetSpotInterval(double pulseInterval_us)
 {
    // sets time between points in sequence (and also "on" time for PointAndFire)
@@ -28,16 +28,42 @@
 #include "ASIPeripheralBase.h"
 #include "MMDevice.h"
 #include "DeviceBase.h"
+#include "DeviceThreads.h"
+
+class CScanner;
+
+// background thread that plays polygon patterns longer than the controller's ring buffer
+class CScannerPatternStreamer : public MMDeviceThreadBase
+{
+public:
+   CScannerPatternStreamer(CScanner* scanner) :
+      scanner_(scanner), stopRequested_(false), running_(false), joinable_(false) { }
+   ~CScannerPatternStreamer() { Stop(); }
+
+   void Start();
+   void Stop();
+   bool IsRunning();
+   bool IsStopRequested();
+   int svc();
+
+private:
+   CScanner* scanner_;
+   bool stopRequested_;
+   bool running_;
+   bool joinable_;   // thread was started and not yet waited for
+   MMThreadLock lock_;
+};
 
 class CScanner : public ASIPeripheralBase<CGalvoBase, CScanner>
 {
 public:
    CScanner(const char* name);
-   ~CScanner() { }
+   ~CScanner() { streamer_.Stop(); }
 
    // Device API
    // ----------
    int Initialize();
+   int Shutdown();
    bool Busy();
 
    // Galvo API
@@ -54,7 +80,7 @@ public:
    int SetPolygonRepetitions(int repetitions);
    int RunPolygons();
    int RunSequence();
-   int StopSequence() { return DEVICE_UNSUPPORTED_COMMAND; }  // doesn't appear to be used in MMCore.cpp anyway
+   int StopSequence();
 
    int PointAndFire(double x, double y, double time_us);
    int SetSpotInterval(double pulseInterval_us);
@@ -190,6 +216,12 @@ private:
    vector< pair<double,double> > polygons_;
    long polygonRepetitions_;
    bool ring_buffer_supported_;
+   long ring_buffer_capacity_;
+   // patterns longer than the ring buffer are played as consecutive segments that each fill the ring buffer
+   vector<string> ringBufferCommands_;  // "LD" command of each point, built by LoadPolygons()
+   string ringBufferShutterCommand_;    // "LD" command ending each segment, empty if none
+   size_t loadedSegment_;               // segment currently in the ring buffer
+   CScannerPatternStreamer streamer_;
 
    unsigned char laser_side_;  // code for corresponding laser line: 0 for none, 1 for side0, 2 for side1
    bool laserTTLenabled_;      // whether it has MM_LASER_TTL module
@@ -198,6 +230,15 @@ private:
 
    int SetIlluminationStateHelper(bool on);
    int OnSaveJoystickSettings();
+
+   size_t RingBufferSegmentLength() const;
+   size_t NumberOfRingBufferSegments() const;
+   int LoadRingBufferSegment(size_t segment);
+   int TriggerRingBuffer();
+   int IsRingBufferRunning(bool &running);
+   int PlayRingBufferSegments();  // plays whole pattern once, called from RunPolygons() and streamer_
+
+   friend class CScannerPatternStreamer;
 };
 
 #endif //_ASIScanner_H_
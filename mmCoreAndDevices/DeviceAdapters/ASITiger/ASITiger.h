@@ -91,6 +91,8 @@ const char* const g_Msg_ERR_TIGER_PAIR_NOT_PRESENT = "Axis should be present in
 const char* const g_Msg_ERR_CRISP_NOT_CALIBRATED = "CRISP is not calibrated.  Try focusing close to a coverslip and selecting 'Calibrate'";
 #define ERR_CRISP_NOT_LOCKED         10051
 const char* const g_Msg_ERR_CRISP_NOT_LOCKED = "The CRISP failed to lock";
+#define ERR_RB_REPEAT_NOT_SUPPORTED  10060
+const char* const g_Msg_ERR_RB_REPEAT_NOT_SUPPORTED = "Ring buffer mode '3 - Repeat' is not supported for patterns longer than the ring buffer";
 
 #define ERR_ASICODE_OFFSET 10100  // offset when reporting error number from controller
 #define ERR_UNKNOWN_COMMAND         10101
@@ -181,6 +183,8 @@ const char* const g_SerialCommandOnlySendChangedPropertyName = "OnlySendSerialCo
 const char* const g_SerialCommandRepeatDurationPropertyName = "SerialCommandRepeatDuration(s)";
 const char* const g_SerialCommandRepeatPeriodPropertyName = "SerialCommandRepeatPeriod(ms)";
 const char* const g_SerialComPortPropertyName = "SerialComPort";
+const char* const g_StatusPollingPeriodPropertyName = "StatusPollingPeriod(ms)";
+const char* const g_StatusCacheMaxAgePropertyName = "StatusCacheMaxAge(ms)";
 
 // motorized stage property names (XY and Z)
 const char* const g_StepSizeXPropertyName = "StepSizeX(um)";
@@ -96,6 +96,10 @@ int CXYStage::Initialize()
    command << addressChar_ << "VB Z=1";
    RETURN_ON_MM_ERROR ( hub_->QueryCommand(command.str()) );
 
+   // let the hub poll position and state in the background (if enabled in the hub)
+   RegisterPolledAxis(axisLetterX_, FirmwareVersionAtLeast(2.7));
+   RegisterPolledAxis(axisLetterY_, FirmwareVersionAtLeast(2.7));
+
    // expose the step size to user as read-only property (no need for action handler)
    command.str("");
    command << g_StageMinStepSize;
@@ -495,6 +499,13 @@ int CXYStage::getMinMaxSpeed(string axisLetter, double& minSpeed, double& maxSpe
 
 int CXYStage::GetPositionSteps(long& x, long& y)
 {
+   double cachedX, cachedY;
+   if (hub_->GetCachedPosition(axisLetterX_, cachedX) && hub_->GetCachedPosition(axisLetterY_, cachedY))
+   {
+      x = (long)(cachedX/unitMultX_/stepSizeXUm_);
+      y = (long)(cachedY/unitMultY_/stepSizeYUm_);
+      return DEVICE_OK;
+   }
    ostringstream command; command.str("");
    command << "W " << axisLetterX_;
    RETURN_ON_MM_ERROR ( hub_->QueryCommandVerify(command.str(),":A") );
@@ -538,7 +549,9 @@ int CXYStage::SetPositionSteps(long x, long y)
 {
    ostringstream command; command.str("");
    command << "M " << axisLetterX_ << "=" << x*unitMultX_*stepSizeXUm_ << " " << axisLetterY_ << "=" << y*unitMultY_*stepSizeYUm_;
-   return hub_->QueryCommandVerify(command.str(),":A");
+   int ret = hub_->QueryCommandVerify(command.str(),":A");
+   hub_->InvalidateCachedStatus(addressChar_);
+   return ret;
 }
 
 int CXYStage::SetRelativePositionSteps(long x, long y)
@@ -556,7 +569,9 @@ int CXYStage::SetRelativePositionSteps(long x, long y)
    {
       command << "R " << axisLetterX_ << "=" << x*unitMultX_*stepSizeXUm_ << " " << axisLetterY_ << "=" << y*unitMultY_*stepSizeYUm_;
    }
-   return hub_->QueryCommandVerify(command.str(),":A");
+   int ret = hub_->QueryCommandVerify(command.str(),":A");
+   hub_->InvalidateCachedStatus(addressChar_);
+   return ret;
 }
 
 int CXYStage::GetStepLimits(long& xMin, long& xMax, long& yMin, long& yMax)
@@ -592,8 +607,9 @@ int CXYStage::Stop()
    ostringstream command; command.str("");
    command.str("");
    command << addressChar_ << "HALT";
-   RETURN_ON_MM_ERROR ( hub_->QueryCommand(command.str()) );
-   return DEVICE_OK;
+   int ret = hub_->QueryCommand(command.str());
+   hub_->InvalidateCachedStatus(addressChar_);
+   return ret;
 }
 
 bool CXYStage::Busy()
@@ -601,6 +617,9 @@ bool CXYStage::Busy()
    ostringstream command; command.str("");
    if (FirmwareVersionAtLeast(2.7)) // can use more accurate RS <axis>?
    {
+      bool busyX, busyY;
+      if (hub_->GetCachedBusy(axisLetterX_, busyX) && hub_->GetCachedBusy(axisLetterY_, busyY))
+         return (busyX || busyY);
       command << "RS " << axisLetterX_ << "?";
       if (hub_->QueryCommandVerify(command.str(),":A") != DEVICE_OK)  // say we aren't busy if we can't communicate
          return false;
@@ -641,28 +660,36 @@ int CXYStage::SetOrigin()
 {
    ostringstream command; command.str("");
    command << "H " << axisLetterX_ << "=0 " << axisLetterY_ << "=0";
-   return hub_->QueryCommandVerify(command.str(),":A");
+   int ret = hub_->QueryCommandVerify(command.str(),":A");
+   hub_->InvalidateCachedStatus(addressChar_);
+   return ret;
 }
 
 int CXYStage::SetXOrigin()
 {
    ostringstream command; command.str("");
    command << "H " << axisLetterX_ << "=0 ";
-   return hub_->QueryCommandVerify(command.str(),":A");
+   int ret = hub_->QueryCommandVerify(command.str(),":A");
+   hub_->InvalidateCachedStatus(addressChar_);
+   return ret;
 }
 
 int CXYStage::SetYOrigin()
 {
    ostringstream command; command.str("");
    command << "H " << axisLetterY_ << "=0";
-   return hub_->QueryCommandVerify(command.str(),":A");
+   int ret = hub_->QueryCommandVerify(command.str(),":A");
+   hub_->InvalidateCachedStatus(addressChar_);
+   return ret;
 }
 
 int CXYStage::Home()
 {
    ostringstream command; command.str("");
    command << "! " << axisLetterX_ << " " << axisLetterY_;
-   return hub_->QueryCommandVerify(command.str(),":A");
+   int ret = hub_->QueryCommandVerify(command.str(),":A");
+   hub_->InvalidateCachedStatus(addressChar_);
+   return ret;
 }
 
 int CXYStage::SetHome()
@@ -760,7 +787,9 @@ int CXYStage::Move(double vx, double vy)
 {
    ostringstream command; command.str("");
    command << "VE " << axisLetterX_ << "=" << vx <<" "<< axisLetterY_ << "=" << vy ;
-   return hub_->QueryCommandVerify(command.str(), ":A") ;
+   int ret = hub_->QueryCommandVerify(command.str(), ":A");
+   hub_->InvalidateCachedStatus(addressChar_);
+   return ret;
 }
 
 
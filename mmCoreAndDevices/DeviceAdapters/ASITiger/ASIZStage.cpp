@@ -85,6 +85,9 @@ int CZStage::Initialize()
    command << addressChar_ << "VB Z=1";
    RETURN_ON_MM_ERROR ( hub_->QueryCommand(command.str()) );
 
+   // let the hub poll position and state in the background (if enabled in the hub)
+   RegisterPolledAxis(axisLetter_, FirmwareVersionAtLeast(2.7));
+
    // expose the step size to user as read-only property (no need for action handler)
    command.str("");
    command << g_StageMinStepSize;
@@ -411,6 +414,11 @@ int CZStage::Initialize()
 
 int CZStage::GetPositionUm(double& pos)
 {
+   if (hub_->GetCachedPosition(axisLetter_, pos))
+   {
+      pos = pos/unitMult_;
+      return DEVICE_OK;
+   }
    ostringstream command; command.str("");
    command << "W " << axisLetter_;
    RETURN_ON_MM_ERROR ( hub_->QueryCommandVerify(command.str(),":A") );
@@ -423,15 +431,22 @@ int CZStage::SetPositionUm(double pos)
 {
    ostringstream command; command.str("");
    command << "M " << axisLetter_ << "=" << pos*unitMult_;
-   return hub_->QueryCommandVerify(command.str(),":A");
+   int ret = hub_->QueryCommandVerify(command.str(),":A");
+   hub_->InvalidateCachedStatus(addressChar_);
+   return ret;
 }
 
 int CZStage::GetPositionSteps(long& steps)
 {
+   double tmp;
+   if (hub_->GetCachedPosition(axisLetter_, tmp))
+   {
+      steps = (long)(tmp/unitMult_/stepSizeUm_);
+      return DEVICE_OK;
+   }
    ostringstream command; command.str("");
    command << "W " << axisLetter_;
    RETURN_ON_MM_ERROR ( hub_->QueryCommandVerify(command.str(),":A") );
-   double tmp;
    RETURN_ON_MM_ERROR ( hub_->ParseAnswerAfterPosition2(tmp) );
    steps = (long)(tmp/unitMult_/stepSizeUm_);
    return DEVICE_OK;
@@ -441,14 +456,18 @@ int CZStage::SetPositionSteps(long steps)
 {
    ostringstream command; command.str("");
    command << "M " << axisLetter_ << "=" << steps*unitMult_*stepSizeUm_;
-   return hub_->QueryCommandVerify(command.str(),":A");
+   int ret = hub_->QueryCommandVerify(command.str(),":A");
+   hub_->InvalidateCachedStatus(addressChar_);
+   return ret;
 }
 
 int CZStage::SetRelativePositionUm(double d)
 {
    ostringstream command; command.str("");
    command << "R " << axisLetter_ << "=" << d*unitMult_;
-   return hub_->QueryCommandVerify(command.str(),":A");
+   int ret = hub_->QueryCommandVerify(command.str(),":A");
+   hub_->InvalidateCachedStatus(addressChar_);
+   return ret;
 }
 
 int CZStage::GetLimits(double& min, double& max)
@@ -473,7 +492,9 @@ int CZStage::Stop()
    // note this stops the card (including if there are other stages on same card), \ stops all stages
    ostringstream command; command.str("");
    command << addressChar_ << "halt";
-   return hub_->QueryCommand(command.str());
+   int ret = hub_->QueryCommand(command.str());
+   hub_->InvalidateCachedStatus(addressChar_);
+   return ret;
 }
 
 int CZStage::Home()
@@ -483,8 +504,9 @@ int CZStage::Home()
    // device adapter then stop move here like in ASIPiezo
    ostringstream command; command.str("");
    command << "! " << axisLetter_;
-   RETURN_ON_MM_ERROR ( hub_->QueryCommandVerify(command.str(), ":A") );
-   return DEVICE_OK;
+   int ret = hub_->QueryCommandVerify(command.str(), ":A");
+   hub_->InvalidateCachedStatus(addressChar_);
+   return ret;
 }
 
 bool CZStage::Busy()
@@ -496,6 +518,9 @@ bool CZStage::Busy()
    }
    if (FirmwareVersionAtLeast(2.7)) // can use more accurate RS <axis>?
    {
+      bool busy;
+      if (hub_->GetCachedBusy(axisLetter_, busy))
+         return busy;
       command << "RS " << axisLetter_ << "?";
       if (hub_->QueryCommandVerify(command.str(),":A") != DEVICE_OK)  // say we aren't busy if we can't communicate
          return false;
@@ -520,7 +545,9 @@ int CZStage::SetOrigin()
 {
    ostringstream command; command.str("");
    command << "H " << axisLetter_ << "=0";
-   return hub_->QueryCommandVerify(command.str(),":A");
+   int ret = hub_->QueryCommandVerify(command.str(),":A");
+   hub_->InvalidateCachedStatus(addressChar_);
+   return ret;
 }
 
 int CZStage::StopStageSequence()
@@ -628,8 +655,9 @@ int CZStage::Move(double velocity)
 {
 ostringstream command; command.str("");
 command << "VE " << axisLetter_ << "=" << velocity;
-return hub_->QueryCommandVerify(command.str(), ":A") ;
-
+int ret = hub_->QueryCommandVerify(command.str(), ":A");
+hub_->InvalidateCachedStatus(addressChar_);
+return ret;
 }
 
 ////////////////
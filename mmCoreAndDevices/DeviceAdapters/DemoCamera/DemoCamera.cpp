@@ -234,6 +234,9 @@ CDemoCamera::CDemoCamera() :
    stopOnOverflow_(false),
 	dropPixels_(false),
    fastImage_(false),
+   fastGeneration_(false),
+   replayFrameCount_(0),
+   replayIndex_(0),
    saturatePixels_(false),
 	fractionOfPixelsToDropOrSaturate_(0.002),
    shouldRotateImages_(false),
@@ -242,6 +245,7 @@ CDemoCamera::CDemoCamera() :
    supportsMultiROI_(false),
    multiROIFillValue_(0),
    nComponents_(1),
+   pixelType_(g_PixelType_8bit),
    mode_(MODE_ARTIFICIAL_WAVES),
    imgManpl_(0),
    pcf_(1.0),
@@ -459,6 +463,22 @@ int CDemoCamera::Initialize()
    AddAllowedValue("FastImage", "0");
    AddAllowedValue("FastImage", "1");
 
+   // Fast generation: multithreaded, table-driven generation of 8- and
+   // 16-bit images, and optional replay of pre-rendered frames during
+   // sequence acquisition, for load testing at high frame rates
+   pAct = new CPropertyAction (this, &CDemoCamera::OnFastGeneration);
+   CreateIntegerProperty("FastGeneration", 0, false, pAct);
+   AddAllowedValue("FastGeneration", "0");
+   AddAllowedValue("FastGeneration", "1");
+
+   pAct = new CPropertyAction (this, &CDemoCamera::OnFastGenerationThreads);
+   CreateIntegerProperty("FastGenerationThreads", fastGenerator_.GetThreadCount(), false, pAct);
+   SetPropertyLimits("FastGenerationThreads", 1, 64);
+
+   pAct = new CPropertyAction (this, &CDemoCamera::OnReplayFrames);
+   CreateIntegerProperty("ReplayFrames", 0, false, pAct);
+   SetPropertyLimits("ReplayFrames", 0, 256);
+
    pAct = new CPropertyAction (this, &CDemoCamera::OnFractionOfPixelsToDropOrSaturate);
    CreateFloatProperty("FractionOfPixelsToDropOrSaturate", 0.002, false, pAct);
 	SetPropertyLimits("FractionOfPixelsToDropOrSaturate", 0., 0.1);
@@ -1064,6 +1084,10 @@ int CDemoCamera::StartSequenceAcquisition(long numImages, double interval_ms, bo
    int ret = GetCoreCallback()->PrepareForAcq(this);
    if (ret != DEVICE_OK)
       return ret;
+   if (fastGeneration_ && !fastImage_ && replayFrameCount_ > 0)
+      RenderReplayFrames(GetSequenceExposure());
+   else
+      ReleaseReplayFrames();
    sequenceStartTime_ = GetCurrentMMTime();
    imageCounter_ = 0;
    thd_->Start(numImages,interval_ms);
@@ -1097,7 +1121,13 @@ int CDemoCamera::InsertImage()
    MMThreadGuard g(imgPixelsLock_);
 
    const unsigned char* pI;
-   pI = GetImageBuffer();
+   if (!replayFrames_.empty())
+   {
+      pI = &replayFrames_[replayIndex_][0];
+      replayIndex_ = (replayIndex_ + 1) % replayFrames_.size();
+   }
+   else
+      pI = GetImageBuffer();
 
    unsigned int w = GetImageWidth();
    unsigned int h = GetImageHeight();
@@ -1136,7 +1166,7 @@ int CDemoCamera::RunSequenceOnThread(MM::MMTime startTime)
 
    double exposure = GetSequenceExposure();
 
-   if (!fastImage_)
+   if (!fastImage_ && replayFrames_.empty())
    {
       GenerateSyntheticImage(img_, exposure);
    }
@@ -1400,6 +1430,7 @@ int CDemoCamera::OnPixelType(MM::PropertyBase* pProp, MM::ActionType eAct)
             bitDepth_ = 8;
             ret = ERR_UNKNOWN_MODE;
          }
+         pProp->Get(pixelType_);
       }
       break;
    case MM::BeforeGet:
@@ -1587,6 +1618,63 @@ int CDemoCamera::OnDropPixels(MM::PropertyBase* pProp, MM::ActionType eAct)
    return DEVICE_OK;
 }
 
+int CDemoCamera::OnFastGeneration(MM::PropertyBase* pProp, MM::ActionType eAct)
+{
+   if (eAct == MM::AfterSet)
+   {
+      if (IsCapturing())
+         return DEVICE_CAMERA_BUSY_ACQUIRING;
+      long tvalue = 0;
+      pProp->Get(tvalue);
+      fastGeneration_ = (0 == tvalue) ? false : true;
+      if (!fastGeneration_)
+         ReleaseReplayFrames();
+   }
+   else if (eAct == MM::BeforeGet)
+   {
+      pProp->Set(fastGeneration_ ? 1L : 0L);
+   }
+
+   return DEVICE_OK;
+}
+
+int CDemoCamera::OnFastGenerationThreads(MM::PropertyBase* pProp, MM::ActionType eAct)
+{
+   if (eAct == MM::AfterSet)
+   {
+      if (IsCapturing())
+         return DEVICE_CAMERA_BUSY_ACQUIRING;
+      long threads = 1;
+      pProp->Get(threads);
+      MMThreadGuard g(imgPixelsLock_);
+      fastGenerator_.SetThreadCount(static_cast<unsigned>(threads));
+   }
+   else if (eAct == MM::BeforeGet)
+   {
+      pProp->Set(static_cast<long>(fastGenerator_.GetThreadCount()));
+   }
+
+   return DEVICE_OK;
+}
+
+int CDemoCamera::OnReplayFrames(MM::PropertyBase* pProp, MM::ActionType eAct)
+{
+   if (eAct == MM::AfterSet)
+   {
+      if (IsCapturing())
+         return DEVICE_CAMERA_BUSY_ACQUIRING;
+      pProp->Get(replayFrameCount_);
+      if (replayFrameCount_ == 0)
+         ReleaseReplayFrames();
+   }
+   else if (eAct == MM::BeforeGet)
+   {
+      pProp->Set(replayFrameCount_);
+   }
+
+   return DEVICE_OK;
+}
+
 int CDemoCamera::OnFastImage(MM::PropertyBase* pProp, MM::ActionType eAct)
 {
    if (eAct == MM::AfterSet)
@@ -2021,8 +2109,27 @@ void CDemoCamera::GenerateSyntheticImage(ImgBuffer& img, double exp)
          offset = 100;
       }
 	   double readNoiseDN = readNoise_ / pcf_;
-      AddBackgroundAndNoise(img, offset, readNoiseDN);
-      AddSignal (img, photonFlux_, exp, pcf_);
+      if (fastGeneration_ && (pixelType_ == g_PixelType_8bit ||
+               pixelType_ == g_PixelType_16bit))
+      {
+         // Background and signal in one pass: the sum of the read noise and
+         // shot noise is itself Gaussian
+         double photons = photonFlux_ * exp;
+         double mean = offset + photons / pcf_;
+         double stdDev = sqrt(readNoiseDN * readNoiseDN + photons / (pcf_ * pcf_));
+         double maxValue = (1 << GetBitDepth()) - 1;
+         if (pixelType_ == g_PixelType_8bit)
+            fastGenerator_.FillNoise8(img.GetPixelsRW(), img.Width(),
+                  img.Height(), mean, stdDev, maxValue);
+         else
+            fastGenerator_.FillNoise16(reinterpret_cast<unsigned short*>(img.GetPixelsRW()),
+                  img.Width(), img.Height(), mean, stdDev, maxValue);
+      }
+      else
+      {
+         AddBackgroundAndNoise(img, offset, readNoiseDN);
+         AddSignal (img, photonFlux_, exp, pcf_);
+      }
       if (imgManpl_ != 0)
       {
          imgManpl_->ChangePixels(img);
@@ -2035,10 +2142,7 @@ void CDemoCamera::GenerateSyntheticImage(ImgBuffer& img, double exp)
          return;
    }
 
-	//std::string pixelType;
-	char buf[MM::MaxStrLength];
-   GetProperty(MM::g_Keyword_PixelType, buf);
-   std::string pixelType(buf);
+   const std::string& pixelType = pixelType_;
 
 	if (img.Height() == 0 || img.Width() == 0 || img.Depth() == 0)
       return;
@@ -2082,18 +2186,28 @@ void CDemoCamera::GenerateSyntheticImage(ImgBuffer& img, double exp)
    {
       double pedestal = 127 * exp / 100.0 * GetBinning() * GetBinning();
       unsigned char* pBuf = const_cast<unsigned char*>(img.GetPixels());
-      for (j=0; j<img.Height(); j++)
+      if (fastGeneration_)
       {
-         for (k=0; k<imgWidth; k++)
+         fastGenerator_.FillSineWave8(pBuf, imgWidth, img.Height(), pedestal,
+               dAmp, dPhase_, cLinePhaseInc, 2.0 * lSinePeriod / lPeriod,
+               g_IntensityFactor_, 255.0);
+         maxDrawnVal = g_IntensityFactor_ * min(255.0, pedestal + dAmp);
+      }
+      else
+      {
+         for (j=0; j<img.Height(); j++)
          {
-            long lIndex = imgWidth*j + k;
-            unsigned char val = (unsigned char) (g_IntensityFactor_ * min(255.0, (pedestal + dAmp * sin(dPhase_ + dLinePhase + (2.0 * lSinePeriod * k) / lPeriod))));
-            if (val > maxDrawnVal) {
-                maxDrawnVal = val;
+            for (k=0; k<imgWidth; k++)
+            {
+               long lIndex = imgWidth*j + k;
+               unsigned char val = (unsigned char) (g_IntensityFactor_ * min(255.0, (pedestal + dAmp * sin(dPhase_ + dLinePhase + (2.0 * lSinePeriod * k) / lPeriod))));
+               if (val > maxDrawnVal) {
+                   maxDrawnVal = val;
+               }
+               *(pBuf + lIndex) = val;
             }
-            *(pBuf + lIndex) = val;
+            dLinePhase += cLinePhaseInc;
          }
-         dLinePhase += cLinePhaseInc;
       }
 	   for(int snoise = 0; snoise < pixelsToSaturate; ++snoise)
 		{
@@ -2115,19 +2229,29 @@ void CDemoCamera::GenerateSyntheticImage(ImgBuffer& img, double exp)
       double pedestal = maxValue/2 * exp / 100.0 * GetBinning() * GetBinning();
       double dAmp16 = dAmp * maxValue/255.0; // scale to behave like 8-bit
       unsigned short* pBuf = (unsigned short*) const_cast<unsigned char*>(img.GetPixels());
-      for (j=0; j<img.Height(); j++)
+      if (fastGeneration_)
       {
-         for (k=0; k<imgWidth; k++)
+         fastGenerator_.FillSineWave16(pBuf, imgWidth, img.Height(), pedestal,
+               dAmp16, dPhase_, cLinePhaseInc, 2.0 * lSinePeriod / lPeriod,
+               g_IntensityFactor_, (double)maxValue);
+         maxDrawnVal = g_IntensityFactor_ * min((double)maxValue, pedestal + dAmp16);
+      }
+      else
+      {
+         for (j=0; j<img.Height(); j++)
          {
-            long lIndex = imgWidth*j + k;
-            unsigned short val = (unsigned short) (g_IntensityFactor_ * min((double)maxValue, pedestal + dAmp16 * sin(dPhase_ + dLinePhase + (2.0 * lSinePeriod * k) / lPeriod)));
-            if (val > maxDrawnVal) {
-                maxDrawnVal = val;
+            for (k=0; k<imgWidth; k++)
+            {
+               long lIndex = imgWidth*j + k;
+               unsigned short val = (unsigned short) (g_IntensityFactor_ * min((double)maxValue, pedestal + dAmp16 * sin(dPhase_ + dLinePhase + (2.0 * lSinePeriod * k) / lPeriod)));
+               if (val > maxDrawnVal) {
+                   maxDrawnVal = val;
+               }
+               *(pBuf + lIndex) = val;
             }
-            *(pBuf + lIndex) = val;
+            dLinePhase += cLinePhaseInc;
          }
-         dLinePhase += cLinePhaseInc;
-      }         
+      }
 	   for(int snoise = 0; snoise < pixelsToSaturate; ++snoise)
 		{
 			j = (unsigned)(0.5 + (double)img.Height()*(double)rand()/(double)RAND_MAX);
@@ -2481,6 +2605,30 @@ bool CDemoCamera::GenerateColorTestPattern(ImgBuffer& img)
 }
 
 
+/**
+* Pre-renders ReplayFrames images, which the sequence thread then inserts in
+* turn instead of generating a new image for every frame. The frames are kept
+* after the sequence ends and released when no longer configured.
+*/
+void CDemoCamera::RenderReplayFrames(double exp)
+{
+   replayFrames_.resize(replayFrameCount_);
+   for (std::size_t i = 0; i < replayFrames_.size(); ++i)
+   {
+      GenerateSyntheticImage(img_, exp);
+      MMThreadGuard g(imgPixelsLock_);
+      replayFrames_[i].assign(img_.GetPixels(),
+            img_.GetPixels() + img_.Width() * img_.Height() * img_.Depth());
+   }
+   replayIndex_ = 0;
+}
+
+void CDemoCamera::ReleaseReplayFrames()
+{
+   MMThreadGuard g(imgPixelsLock_);
+   std::vector< std::vector<unsigned char> >().swap(replayFrames_);
+}
+
 void CDemoCamera::TestResourceLocking(const bool recurse)
 {
    if(recurse)
@@ -2492,9 +2640,7 @@ void CDemoCamera::TestResourceLocking(const bool recurse)
 */
 void CDemoCamera::AddBackgroundAndNoise(ImgBuffer& img, double mean, double stdDev)
 { 
-	char buf[MM::MaxStrLength];
-   GetProperty(MM::g_Keyword_PixelType, buf);
-	std::string pixelType(buf);
+   const std::string& pixelType = pixelType_;
 
    int maxValue = 1 << GetBitDepth();
    long nrPixels = img.Width() * img.Height();
@@ -2544,9 +2690,7 @@ void CDemoCamera::AddBackgroundAndNoise(ImgBuffer& img, double mean, double stdD
 */
 void CDemoCamera::AddSignal(ImgBuffer& img, double photonFlux, double exp, double cf)
 { 
-	char buf[MM::MaxStrLength];
-   GetProperty(MM::g_Keyword_PixelType, buf);
-	std::string pixelType(buf);
+   const std::string& pixelType = pixelType_;
 
    int maxValue = (1 << GetBitDepth()) -1;
    long nrPixels = img.Width() * img.Height();
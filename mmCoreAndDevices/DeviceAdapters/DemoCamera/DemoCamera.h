@@ -33,6 +33,7 @@
 #include "DeviceBase.h"
 #include "ImgBuffer.h"
 #include "DeviceThreads.h"
+#include "FastImageGenerator.h"
 #include <string>
 #include <map>
 #include <algorithm>
@@ -186,6 +187,9 @@ public:
    int OnTriggerDevice(MM::PropertyBase* pProp, MM::ActionType eAct);
    int OnDropPixels(MM::PropertyBase* pProp, MM::ActionType eAct);
    int OnFastImage(MM::PropertyBase* pProp, MM::ActionType eAct);
+   int OnFastGeneration(MM::PropertyBase* pProp, MM::ActionType eAct);
+   int OnFastGenerationThreads(MM::PropertyBase* pProp, MM::ActionType eAct);
+   int OnReplayFrames(MM::PropertyBase* pProp, MM::ActionType eAct);
    int OnSaturatePixels(MM::PropertyBase* pProp, MM::ActionType eAct);
    int OnFractionOfPixelsToDropOrSaturate(MM::PropertyBase* pProp, MM::ActionType eAct);
    int OnShouldRotateImages(MM::PropertyBase* pProp, MM::ActionType eAct);
@@ -218,6 +222,8 @@ private:
    void GenerateEmptyImage(ImgBuffer& img);
    void GenerateSyntheticImage(ImgBuffer& img, double exp);
    bool GenerateColorTestPattern(ImgBuffer& img);
+   void RenderReplayFrames(double exp);
+   void ReleaseReplayFrames();
    int ResizeImageBuffer();
 
    static const double nominalPixelSizeUm_;
@@ -252,6 +258,12 @@ private:
 
 	bool dropPixels_;
    bool fastImage_;
+   bool fastGeneration_;
+   long replayFrameCount_;
+   FastImageGenerator fastGenerator_;
+   // Frames pre-rendered for replay during a sequence acquisition
+   std::vector< std::vector<unsigned char> > replayFrames_;
+   std::size_t replayIndex_;
 	bool saturatePixels_;
 	double fractionOfPixelsToDropOrSaturate_;
    bool shouldRotateImages_;
@@ -268,6 +280,7 @@ private:
    MMThreadLock imgPixelsLock_;
    friend class MySequenceThread;
    int nComponents_;
+   std::string pixelType_; // Cached value of the PixelType property
    MySequenceThread * thd_;
    int mode_;
    ImgManipulator* imgManpl_;
@@ -0,0 +1,412 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          FastImageGenerator.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     DeviceAdapters
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Fast synthetic image generation for the demo camera, used
+//                to drive the rest of the system at high frame rates.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "FastImageGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+// Images smaller than this are filled on the calling thread only
+static const std::size_t g_MinPixelsPerThread = 64 * 1024;
+
+uint32_t FastImageGenerator::Rng::kn_[128];
+float FastImageGenerator::Rng::wn_[128];
+float FastImageGenerator::Rng::fn_[128];
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Random numbers
+///////////////////////////////////////////////////////////////////////////////
+
+FastImageGenerator::Rng::Rng(uint64_t seed)
+{
+   // Expand the seed with splitmix64, as recommended for the xoshiro family
+   for (int i = 0; i < 2; ++i)
+   {
+      seed += 0x9E3779B97F4A7C15ULL;
+      uint64_t z = seed;
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+      z ^= z >> 31;
+      s_[2 * i] = static_cast<uint32_t>(z);
+      s_[2 * i + 1] = static_cast<uint32_t>(z >> 32);
+   }
+}
+
+/**
+ * Ziggurat tables for the normal distribution with 128 layers (Marsaglia and
+ * Tsang, J. Stat. Software 5(8), 2000).
+ */
+void FastImageGenerator::Rng::InitializeTables()
+{
+   const double m1 = 2147483648.0;
+   const double vn = 9.91256303526217e-3;
+   double dn = 3.442619855899;
+   double tn = dn;
+   const double q = vn / std::exp(-0.5 * dn * dn);
+
+   kn_[0] = static_cast<uint32_t>((dn / q) * m1);
+   kn_[1] = 0;
+   wn_[0] = static_cast<float>(q / m1);
+   wn_[127] = static_cast<float>(dn / m1);
+   fn_[0] = 1.0f;
+   fn_[127] = static_cast<float>(std::exp(-0.5 * dn * dn));
+   for (int i = 126; i >= 1; --i)
+   {
+      dn = std::sqrt(-2.0 * std::log(vn / dn + std::exp(-0.5 * dn * dn)));
+      kn_[i + 1] = static_cast<uint32_t>((dn / tn) * m1);
+      tn = dn;
+      fn_[i] = static_cast<float>(std::exp(-0.5 * dn * dn));
+      wn_[i] = static_cast<float>(dn / m1);
+   }
+}
+
+float FastImageGenerator::Rng::NormalTail(int32_t hz, uint32_t iz)
+{
+   const float r = 3.442620f;
+   for (;;)
+   {
+      float x = hz * wn_[iz];
+      if (iz == 0)
+      {
+         // Base strip: sample from the tail beyond r
+         float y;
+         do
+         {
+            x = -std::log(Uniform()) / r;
+            y = -std::log(Uniform());
+         } while (y + y < x * x);
+         return hz > 0 ? r + x : -r - x;
+      }
+      if (fn_[iz] + Uniform() * (fn_[iz - 1] - fn_[iz]) <
+            std::exp(-0.5f * x * x))
+         return x;
+
+      hz = static_cast<int32_t>(Next());
+      iz = hz & 127;
+      const uint32_t absHz = hz < 0 ? 0u - static_cast<uint32_t>(hz) :
+         static_cast<uint32_t>(hz);
+      if (absHz < kn_[iz])
+         return hz * wn_[iz];
+   }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Fill tasks
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+template <typename PixelT>
+class SineWaveTask : public FastImageGenerator::Task
+{
+public:
+   SineWaveTask(PixelT* pixels, unsigned width, const float* sinTable,
+         const float* cosTable, double pedestal, double amplitude,
+         double phase, double rowPhaseInc, double intensity, double maxValue) :
+      pixels_(pixels), width_(width), sinTable_(sinTable), cosTable_(cosTable),
+      pedestal_(pedestal), amplitude_(amplitude), phase_(phase),
+      rowPhaseInc_(rowPhaseInc), intensity_(intensity), maxValue_(maxValue)
+   {}
+
+   void Run(unsigned firstRow, unsigned endRow, unsigned /*part*/)
+   {
+      const float pedestal = static_cast<float>(pedestal_);
+      const float maxValue = static_cast<float>(maxValue_);
+      const float intensity = static_cast<float>(intensity_);
+      for (unsigned row = firstRow; row < endRow; ++row)
+      {
+         // sin(a + b) = sin(a) cos(b) + cos(a) sin(b)
+         const double a = phase_ + row * rowPhaseInc_;
+         const float sinA = static_cast<float>(amplitude_ * std::sin(a));
+         const float cosA = static_cast<float>(amplitude_ * std::cos(a));
+         PixelT* out = pixels_ + (std::size_t)row * width_;
+         for (unsigned col = 0; col < width_; ++col)
+         {
+            float v = pedestal + sinA * cosTable_[col] + cosA * sinTable_[col];
+            v = std::max(0.0f, std::min(maxValue, v)) * intensity;
+            out[col] = static_cast<PixelT>(v);
+         }
+      }
+   }
+
+private:
+   PixelT* pixels_;
+   unsigned width_;
+   const float* sinTable_;
+   const float* cosTable_;
+   double pedestal_;
+   double amplitude_;
+   double phase_;
+   double rowPhaseInc_;
+   double intensity_;
+   double maxValue_;
+};
+
+template <typename PixelT>
+class NoiseTask : public FastImageGenerator::Task
+{
+public:
+   NoiseTask(PixelT* pixels, unsigned width,
+         std::vector<FastImageGenerator::Rng>& rngs,
+         double mean, double stdDev, double maxValue) :
+      pixels_(pixels), width_(width), rngs_(rngs),
+      mean_(mean), stdDev_(stdDev), maxValue_(maxValue)
+   {}
+
+   void Run(unsigned firstRow, unsigned endRow, unsigned part)
+   {
+      FastImageGenerator::Rng& rng = rngs_[part];
+      const float mean = static_cast<float>(mean_);
+      const float stdDev = static_cast<float>(stdDev_);
+      const float maxValue = static_cast<float>(maxValue_);
+
+      // Draw a row of deviates first, so that the clamping and conversion
+      // loop is free of branches
+      std::vector<float> row(width_);
+      for (unsigned r = firstRow; r < endRow; ++r)
+      {
+         for (unsigned col = 0; col < width_; ++col)
+            row[col] = rng.Normal();
+         PixelT* out = pixels_ + (std::size_t)r * width_;
+         for (unsigned col = 0; col < width_; ++col)
+         {
+            float v = mean + stdDev * row[col];
+            out[col] = static_cast<PixelT>(std::max(0.0f, std::min(maxValue, v)));
+         }
+      }
+   }
+
+private:
+   PixelT* pixels_;
+   unsigned width_;
+   std::vector<FastImageGenerator::Rng>& rngs_;
+   double mean_;
+   double stdDev_;
+   double maxValue_;
+};
+
+} // anonymous namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+// FastImageGenerator
+///////////////////////////////////////////////////////////////////////////////
+
+FastImageGenerator::FastImageGenerator() :
+   threadCount_(1),
+   tableWidth_(0),
+   tablePhaseInc_(0.0),
+   task_(0),
+   taskHeight_(0),
+   taskParts_(0),
+   generation_(0),
+   pending_(0),
+   stopWorkers_(false)
+{
+   static boost::once_flag tablesInitialized = BOOST_ONCE_INIT;
+   boost::call_once(&Rng::InitializeTables, tablesInitialized);
+
+   unsigned hwThreads = boost::thread::hardware_concurrency();
+   SetThreadCount(hwThreads > 0 ? hwThreads : 1);
+}
+
+FastImageGenerator::~FastImageGenerator()
+{
+   StopWorkers();
+}
+
+void FastImageGenerator::SetThreadCount(unsigned count)
+{
+   count = std::max(1u, count);
+   if (count == threadCount_ && rngs_.size() == count)
+      return;
+
+   StopWorkers();
+   threadCount_ = count;
+   rngs_.clear();
+   for (unsigned i = 0; i < count; ++i)
+      rngs_.push_back(Rng(0x5EED0000ULL + i));
+}
+
+void FastImageGenerator::FillSineWave8(unsigned char* pixels, unsigned width,
+      unsigned height, double pedestal, double amplitude, double phase,
+      double rowPhaseInc, double colPhaseInc, double intensity, double maxValue)
+{
+   FillSineWave(pixels, width, height, pedestal, amplitude, phase,
+         rowPhaseInc, colPhaseInc, intensity, maxValue);
+}
+
+void FastImageGenerator::FillSineWave16(unsigned short* pixels, unsigned width,
+      unsigned height, double pedestal, double amplitude, double phase,
+      double rowPhaseInc, double colPhaseInc, double intensity, double maxValue)
+{
+   FillSineWave(pixels, width, height, pedestal, amplitude, phase,
+         rowPhaseInc, colPhaseInc, intensity, maxValue);
+}
+
+void FastImageGenerator::FillNoise8(unsigned char* pixels, unsigned width,
+      unsigned height, double mean, double stdDev, double maxValue)
+{
+   FillNoise(pixels, width, height, mean, stdDev, maxValue);
+}
+
+void FastImageGenerator::FillNoise16(unsigned short* pixels, unsigned width,
+      unsigned height, double mean, double stdDev, double maxValue)
+{
+   FillNoise(pixels, width, height, mean, stdDev, maxValue);
+}
+
+template <typename PixelT>
+void FastImageGenerator::FillSineWave(PixelT* pixels, unsigned width,
+      unsigned height, double pedestal, double amplitude, double phase,
+      double rowPhaseInc, double colPhaseInc, double intensity, double maxValue)
+{
+   if (width == 0 || height == 0)
+      return;
+   UpdateColumnTables(width, colPhaseInc);
+   SineWaveTask<PixelT> task(pixels, width, &sinTable_[0], &cosTable_[0],
+         pedestal, amplitude, phase, rowPhaseInc, intensity, maxValue);
+   RunParallel(task, height, (std::size_t)width * height);
+}
+
+template <typename PixelT>
+void FastImageGenerator::FillNoise(PixelT* pixels, unsigned width,
+      unsigned height, double mean, double stdDev, double maxValue)
+{
+   if (width == 0 || height == 0)
+      return;
+   NoiseTask<PixelT> task(pixels, width, rngs_, mean, stdDev, maxValue);
+   RunParallel(task, height, (std::size_t)width * height);
+}
+
+void FastImageGenerator::UpdateColumnTables(unsigned width, double colPhaseInc)
+{
+   if (width == tableWidth_ && colPhaseInc == tablePhaseInc_)
+      return;
+
+   sinTable_.resize(width);
+   cosTable_.resize(width);
+   for (unsigned col = 0; col < width; ++col)
+   {
+      sinTable_[col] = static_cast<float>(std::sin(col * colPhaseInc));
+      cosTable_[col] = static_cast<float>(std::cos(col * colPhaseInc));
+   }
+   tableWidth_ = width;
+   tablePhaseInc_ = colPhaseInc;
+}
+
+void FastImageGenerator::RunParallel(Task& task, unsigned height,
+      std::size_t pixelCount)
+{
+   unsigned parts = static_cast<unsigned>(std::min<std::size_t>(threadCount_,
+            std::max<std::size_t>(1, pixelCount / g_MinPixelsPerThread)));
+   parts = std::min(parts, height);
+   if (parts <= 1)
+   {
+      task.Run(0, height, 0);
+      return;
+   }
+
+   if (workers_.empty())
+      StartWorkers();
+
+   {
+      boost::mutex::scoped_lock lock(mutex_);
+      task_ = &task;
+      taskHeight_ = height;
+      taskParts_ = parts;
+      pending_ = parts - 1;
+      ++generation_;
+   }
+   startCond_.notify_all();
+
+   // The calling thread fills the first part
+   task.Run(0, height / parts, 0);
+
+   boost::mutex::scoped_lock lock(mutex_);
+   while (pending_ > 0)
+      doneCond_.wait(lock);
+   task_ = 0;
+}
+
+void FastImageGenerator::StartWorkers()
+{
+   unsigned long generation;
+   {
+      boost::mutex::scoped_lock lock(mutex_);
+      stopWorkers_ = false;
+      generation = generation_;
+   }
+   for (unsigned part = 1; part < threadCount_; ++part)
+      workers_.push_back(new boost::thread(boost::bind(
+                  &FastImageGenerator::WorkerThread, this, part, generation)));
+}
+
+void FastImageGenerator::StopWorkers()
+{
+   {
+      boost::mutex::scoped_lock lock(mutex_);
+      stopWorkers_ = true;
+   }
+   startCond_.notify_all();
+   for (std::size_t i = 0; i < workers_.size(); ++i)
+   {
+      workers_[i]->join();
+      delete workers_[i];
+   }
+   workers_.clear();
+}
+
+void FastImageGenerator::WorkerThread(unsigned part,
+      unsigned long seenGeneration)
+{
+   for (;;)
+   {
+      Task* task;
+      unsigned firstRow, endRow;
+      {
+         boost::mutex::scoped_lock lock(mutex_);
+         while (!stopWorkers_ && generation_ == seenGeneration)
+            startCond_.wait(lock);
+         if (stopWorkers_)
+            return;
+         seenGeneration = generation_;
+         if (part >= taskParts_)
+            continue; // Not needed for this (small) image
+         task = task_;
+         firstRow = static_cast<unsigned>((std::size_t)taskHeight_ * part / taskParts_);
+         endRow = static_cast<unsigned>((std::size_t)taskHeight_ * (part + 1) / taskParts_);
+      }
+
+      task->Run(firstRow, endRow, part);
+
+      {
+         boost::mutex::scoped_lock lock(mutex_);
+         --pending_;
+      }
+      doneCond_.notify_all();
+   }
+}
@@ -0,0 +1,159 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          FastImageGenerator.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     DeviceAdapters
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Fast synthetic image generation for the demo camera, used
+//                to drive the rest of the system at high frame rates.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#ifndef _FASTIMAGEGENERATOR_H_
+#define _FASTIMAGEGENERATOR_H_
+
+#include <boost/thread.hpp>
+
+#include <cstddef>
+#include <vector>
+#include <stdint.h>
+
+/**
+ * Fills 8- and 16-bit images with the demo camera's sine wave and noise
+ * patterns, much faster than the per-pixel reference implementation in
+ * CDemoCamera.
+ *
+ * Sine waves are evaluated from per-column sine and cosine tables using the
+ * angle addition formula, leaving a multiply-add per pixel that the compiler
+ * can vectorize. Gaussian noise is drawn with the Ziggurat method from
+ * xoshiro128** generators, one per worker. Rows are split across a set of
+ * persistent worker threads.
+ */
+class FastImageGenerator
+{
+public:
+   FastImageGenerator();
+   ~FastImageGenerator();
+
+   // Number of threads (including the calling thread) used to fill an image
+   void SetThreadCount(unsigned count);
+   unsigned GetThreadCount() const { return threadCount_; }
+
+   /**
+    * pixel(row, col) = intensity * min(maxValue,
+    *       pedestal + amplitude * sin(phase + row * rowPhaseInc + col * colPhaseInc))
+    */
+   void FillSineWave8(unsigned char* pixels, unsigned width, unsigned height,
+         double pedestal, double amplitude, double phase, double rowPhaseInc,
+         double colPhaseInc, double intensity, double maxValue);
+   void FillSineWave16(unsigned short* pixels, unsigned width, unsigned height,
+         double pedestal, double amplitude, double phase, double rowPhaseInc,
+         double colPhaseInc, double intensity, double maxValue);
+
+   // Gaussian noise, clipped to [0, maxValue]
+   void FillNoise8(unsigned char* pixels, unsigned width, unsigned height,
+         double mean, double stdDev, double maxValue);
+   void FillNoise16(unsigned short* pixels, unsigned width, unsigned height,
+         double mean, double stdDev, double maxValue);
+
+   // Task run on each part of an image; parts are contiguous row ranges
+   class Task
+   {
+   public:
+      virtual ~Task() {}
+      virtual void Run(unsigned firstRow, unsigned endRow, unsigned part) = 0;
+   };
+
+   class Rng
+   {
+   public:
+      explicit Rng(uint64_t seed = 0);
+      uint32_t Next()
+      {
+         const uint32_t result = Rotl(s_[1] * 5, 7) * 9;
+         const uint32_t t = s_[1] << 9;
+         s_[2] ^= s_[0];
+         s_[3] ^= s_[1];
+         s_[1] ^= s_[2];
+         s_[0] ^= s_[3];
+         s_[2] ^= t;
+         s_[3] = Rotl(s_[3], 11);
+         return result;
+      }
+      // Uniform in (0, 1)
+      float Uniform() { return ((Next() >> 8) + 0.5f) * (1.0f / 16777216.0f); }
+      // Standard normal deviate (Ziggurat method)
+      float Normal()
+      {
+         const int32_t hz = static_cast<int32_t>(Next());
+         const uint32_t iz = hz & 127;
+         const uint32_t absHz = hz < 0 ? 0u - static_cast<uint32_t>(hz) :
+            static_cast<uint32_t>(hz);
+         if (absHz < kn_[iz])
+            return hz * wn_[iz];
+         return NormalTail(hz, iz);
+      }
+
+   private:
+      static uint32_t Rotl(uint32_t x, int k) { return (x << k) | (x >> (32 - k)); }
+      float NormalTail(int32_t hz, uint32_t iz);
+      uint32_t s_[4];
+
+      friend class FastImageGenerator;
+      static void InitializeTables();
+      static uint32_t kn_[128];
+      static float wn_[128];
+      static float fn_[128];
+   };
+
+private:
+   FastImageGenerator(const FastImageGenerator&);
+   FastImageGenerator& operator=(const FastImageGenerator&);
+
+   template <typename PixelT>
+   void FillSineWave(PixelT* pixels, unsigned width, unsigned height,
+         double pedestal, double amplitude, double phase, double rowPhaseInc,
+         double colPhaseInc, double intensity, double maxValue);
+   template <typename PixelT>
+   void FillNoise(PixelT* pixels, unsigned width, unsigned height,
+         double mean, double stdDev, double maxValue);
+
+   void UpdateColumnTables(unsigned width, double colPhaseInc);
+   void RunParallel(Task& task, unsigned height, std::size_t pixelCount);
+   void StartWorkers();
+   void StopWorkers();
+   void WorkerThread(unsigned part, unsigned long seenGeneration);
+
+   unsigned threadCount_;
+   std::vector<Rng> rngs_; // One per part
+
+   unsigned tableWidth_;
+   double tablePhaseInc_;
+   std::vector<float> sinTable_;
+   std::vector<float> cosTable_;
+
+   boost::mutex mutex_;
+   boost::condition_variable startCond_;
+   boost::condition_variable doneCond_;
+   std::vector<boost::thread*> workers_;
+   Task* task_;
+   unsigned taskHeight_;
+   unsigned taskParts_;
+   unsigned long generation_;
+   unsigned pending_;
+   bool stopWorkers_;
+};
+
+#endif //_FASTIMAGEGENERATOR_H_
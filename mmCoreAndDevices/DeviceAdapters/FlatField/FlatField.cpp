@@ -0,0 +1,294 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          FlatField.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     DeviceAdapters
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Image processor applying dark frame and flat-field
+//                correction to camera images
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "FlatField.h"
+
+#include "ModuleInterface.h"
+
+#include <boost/thread/thread.hpp>
+
+#include <algorithm>
+#include <sstream>
+
+
+const char* g_FlatFieldDeviceName = "FlatFieldCorrection";
+
+const char* g_PropReferenceDirectory = "ReferenceDirectory";
+const char* g_PropChannelGroup = "ChannelGroup";
+const char* g_PropEnabled = "Enabled";
+const char* g_PropThreads = "Threads";
+const char* g_PropReferences = "References";
+const char* g_PropUncorrectedFrames = "UncorrectedFrames";
+
+const char* g_Yes = "Yes";
+const char* g_No = "No";
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Exported MMDevice API
+///////////////////////////////////////////////////////////////////////////////
+
+MODULE_API void InitializeModuleData()
+{
+   RegisterDevice(g_FlatFieldDeviceName, MM::ImageProcessorDevice,
+         "Dark frame and flat-field correction");
+}
+
+MODULE_API MM::Device* CreateDevice(const char* deviceName)
+{
+   if (deviceName == 0)
+      return 0;
+
+   if (strcmp(deviceName, g_FlatFieldDeviceName) == 0)
+      return new FlatFieldCorrection();
+
+   // ...supplied name not recognized
+   return 0;
+}
+
+MODULE_API void DeleteDevice(MM::Device* pDevice)
+{
+   delete pDevice;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// FlatFieldCorrection
+///////////////////////////////////////////////////////////////////////////////
+
+FlatFieldCorrection::FlatFieldCorrection() :
+   initialized_(false),
+   enabled_(true),
+   channelGroup_("Channel"),
+   uncorrectedFrames_(0)
+{
+   InitializeDefaultErrorMessages();
+   SetErrorText(ERR_REFERENCES_NOT_LOADED,
+         "Failed to load the dark and flat references (see the log)");
+}
+
+FlatFieldCorrection::~FlatFieldCorrection()
+{
+   Shutdown();
+}
+
+void FlatFieldCorrection::GetName(char* name) const
+{
+   CDeviceUtils::CopyLimitedString(name, g_FlatFieldDeviceName);
+}
+
+int FlatFieldCorrection::Initialize()
+{
+   if (initialized_)
+      return DEVICE_OK;
+
+   CPropertyAction* pAct =
+      new CPropertyAction(this, &FlatFieldCorrection::OnReferenceDirectory);
+   int ret = CreateStringProperty(g_PropReferenceDirectory, "", false, pAct);
+   if (ret != DEVICE_OK)
+      return ret;
+
+   pAct = new CPropertyAction(this, &FlatFieldCorrection::OnChannelGroup);
+   ret = CreateStringProperty(g_PropChannelGroup, channelGroup_.c_str(),
+         false, pAct);
+   if (ret != DEVICE_OK)
+      return ret;
+
+   pAct = new CPropertyAction(this, &FlatFieldCorrection::OnEnabled);
+   ret = CreateStringProperty(g_PropEnabled, g_Yes, false, pAct);
+   if (ret != DEVICE_OK)
+      return ret;
+   AddAllowedValue(g_PropEnabled, g_Yes);
+   AddAllowedValue(g_PropEnabled, g_No);
+
+   const unsigned threads =
+      std::min(8u, std::max(1u, boost::thread::hardware_concurrency()));
+   corrector_.SetThreadCount(threads);
+   pAct = new CPropertyAction(this, &FlatFieldCorrection::OnThreads);
+   ret = CreateIntegerProperty(g_PropThreads, threads, false, pAct);
+   if (ret != DEVICE_OK)
+      return ret;
+   SetPropertyLimits(g_PropThreads, 1, 32);
+
+   pAct = new CPropertyAction(this, &FlatFieldCorrection::OnReferences);
+   ret = CreateStringProperty(g_PropReferences, "", true, pAct);
+   if (ret != DEVICE_OK)
+      return ret;
+
+   pAct = new CPropertyAction(this, &FlatFieldCorrection::OnUncorrectedFrames);
+   ret = CreateIntegerProperty(g_PropUncorrectedFrames, 0, true, pAct);
+   if (ret != DEVICE_OK)
+      return ret;
+
+   initialized_ = true;
+   return DEVICE_OK;
+}
+
+int FlatFieldCorrection::Shutdown()
+{
+   corrector_.ClearReferences();
+   initialized_ = false;
+   return DEVICE_OK;
+}
+
+/**
+ * Called for every image from the camera (snapped or sequence). Images for
+ * which no reference matches (by channel, size and pixel depth) are passed
+ * through unchanged and counted.
+ */
+int FlatFieldCorrection::Process(unsigned char* buffer, unsigned width,
+      unsigned height, unsigned byteDepth)
+{
+   if (!enabled_)
+      return DEVICE_OK;
+
+   if (!corrector_.Correct(buffer, width, height, byteDepth, GetCurrentChannel()))
+      ++uncorrectedFrames_;
+   return DEVICE_OK;
+}
+
+// The channel preset in effect, or an empty string. This is read from the
+// core's property cache, as it is needed for every frame; it reflects the
+// state set through the core, so hardware-sequenced channel switching
+// within a camera sequence is not seen here.
+std::string FlatFieldCorrection::GetCurrentChannel()
+{
+   if (channelGroup_.empty() || corrector_.GetChannelCount() == 0)
+      return std::string();
+
+   char channel[MM::MaxStrLength];
+   channel[0] = 0;
+   if (GetCoreCallback()->GetCurrentConfigFromCache(channelGroup_.c_str(),
+            MM::MaxStrLength, channel) != DEVICE_OK)
+      return std::string();
+   channel[MM::MaxStrLength - 1] = 0;
+   return channel;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Action handlers
+///////////////////////////////////////////////////////////////////////////////
+
+int FlatFieldCorrection::OnReferenceDirectory(MM::PropertyBase* pProp,
+      MM::ActionType eAct)
+{
+   if (eAct == MM::BeforeGet)
+   {
+      pProp->Set(referenceDirectory_.c_str());
+   }
+   else if (eAct == MM::AfterSet)
+   {
+      std::string directory;
+      pProp->Get(directory);
+      if (directory.empty())
+      {
+         corrector_.ClearReferences();
+         referenceDirectory_.clear();
+         return DEVICE_OK;
+      }
+
+      std::string errorMessage;
+      if (!corrector_.LoadReferences(directory, errorMessage))
+      {
+         LogMessage(errorMessage);
+         pProp->Set(referenceDirectory_.c_str());
+         return ERR_REFERENCES_NOT_LOADED;
+      }
+      referenceDirectory_ = directory;
+      uncorrectedFrames_ = 0;
+
+      std::ostringstream os;
+      os << "Loaded " << corrector_.GetReferenceCount() <<
+         " references from " << directory;
+      LogMessage(os.str());
+   }
+   return DEVICE_OK;
+}
+
+int FlatFieldCorrection::OnChannelGroup(MM::PropertyBase* pProp,
+      MM::ActionType eAct)
+{
+   if (eAct == MM::BeforeGet)
+   {
+      pProp->Set(channelGroup_.c_str());
+   }
+   else if (eAct == MM::AfterSet)
+   {
+      pProp->Get(channelGroup_);
+   }
+   return DEVICE_OK;
+}
+
+int FlatFieldCorrection::OnEnabled(MM::PropertyBase* pProp, MM::ActionType eAct)
+{
+   if (eAct == MM::BeforeGet)
+   {
+      pProp->Set(enabled_ ? g_Yes : g_No);
+   }
+   else if (eAct == MM::AfterSet)
+   {
+      std::string value;
+      pProp->Get(value);
+      enabled_ = (value == g_Yes);
+   }
+   return DEVICE_OK;
+}
+
+int FlatFieldCorrection::OnThreads(MM::PropertyBase* pProp, MM::ActionType eAct)
+{
+   if (eAct == MM::BeforeGet)
+   {
+      pProp->Set(static_cast<long>(corrector_.GetThreadCount()));
+   }
+   else if (eAct == MM::AfterSet)
+   {
+      long threads;
+      pProp->Get(threads);
+      corrector_.SetThreadCount(static_cast<unsigned>(threads));
+   }
+   return DEVICE_OK;
+}
+
+int FlatFieldCorrection::OnReferences(MM::PropertyBase* pProp,
+      MM::ActionType eAct)
+{
+   if (eAct == MM::BeforeGet)
+   {
+      std::ostringstream os;
+      os << corrector_.GetReferenceCount() << " (" <<
+         corrector_.GetChannelCount() << " channel-specific)";
+      pProp->Set(os.str().c_str());
+   }
+   return DEVICE_OK;
+}
+
+int FlatFieldCorrection::OnUncorrectedFrames(MM::PropertyBase* pProp,
+      MM::ActionType eAct)
+{
+   if (eAct == MM::BeforeGet)
+   {
+      pProp->Set(uncorrectedFrames_);
+   }
+   return DEVICE_OK;
+}
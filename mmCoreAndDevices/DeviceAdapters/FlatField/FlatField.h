@@ -0,0 +1,73 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          FlatField.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     DeviceAdapters
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Image processor applying dark frame and flat-field
+//                correction to camera images
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#ifndef _FLATFIELD_H_
+#define _FLATFIELD_H_
+
+#include "DeviceBase.h"
+#include "ShadingCorrector.h"
+
+#include <string>
+
+#define ERR_REFERENCES_NOT_LOADED 101
+
+
+//////////////////////////////////////////////////////////////////////////////
+// FlatFieldCorrection class
+// dark frame subtraction and flat-field division
+//////////////////////////////////////////////////////////////////////////////
+class FlatFieldCorrection : public CImageProcessorBase<FlatFieldCorrection>
+{
+public:
+   FlatFieldCorrection();
+   ~FlatFieldCorrection();
+
+   int Initialize();
+   int Shutdown();
+   void GetName(char* name) const;
+   bool Busy() { return false; }
+
+   int Process(unsigned char* buffer, unsigned width, unsigned height,
+         unsigned byteDepth);
+
+   // action interface
+   // ----------------
+   int OnReferenceDirectory(MM::PropertyBase* pProp, MM::ActionType eAct);
+   int OnChannelGroup(MM::PropertyBase* pProp, MM::ActionType eAct);
+   int OnEnabled(MM::PropertyBase* pProp, MM::ActionType eAct);
+   int OnThreads(MM::PropertyBase* pProp, MM::ActionType eAct);
+   int OnReferences(MM::PropertyBase* pProp, MM::ActionType eAct);
+   int OnUncorrectedFrames(MM::PropertyBase* pProp, MM::ActionType eAct);
+
+private:
+   std::string GetCurrentChannel();
+
+   bool initialized_;
+   bool enabled_;
+   std::string referenceDirectory_;
+   std::string channelGroup_;
+   ShadingCorrector corrector_;
+   long uncorrectedFrames_;
+};
+
+#endif //_FLATFIELD_H_
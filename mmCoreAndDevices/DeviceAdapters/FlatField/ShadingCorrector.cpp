@@ -0,0 +1,541 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          ShadingCorrector.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     DeviceAdapters
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Dark frame and flat-field correction of 8- and 16-bit images
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "ShadingCorrector.h"
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+
+// Images smaller than this are corrected on the calling thread only
+static const std::size_t g_MinPixelsPerThread = 64 * 1024;
+
+static const uint16_t g_UnityGain = 1 << ShadingCorrector::gainShift;
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Reading references
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Sum of all frames of one size and depth in a raw stack
+struct FrameSum
+{
+   std::vector<double> sum;
+   unsigned count;
+};
+
+typedef std::map<std::pair<std::pair<unsigned, unsigned>, unsigned>, FrameSum>
+   FrameSumMap; // ((width, height), byteDepth)
+
+bool FileExists(const std::string& path)
+{
+   FILE* fp = fopen(path.c_str(), "rb");
+   if (!fp)
+      return false;
+   fclose(fp);
+   return true;
+}
+
+bool Seek(FILE* fp, uint64_t offset)
+{
+#ifdef _WIN32
+   return _fseeki64(fp, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+   return fseeko(fp, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+template <typename T>
+bool ReadValue(FILE* fp, T& value)
+{
+   return fread(&value, sizeof(T), 1, fp) == 1;
+}
+
+// Reads the raw stack pathPrefix.raw/.idx and sums its frames by size
+bool ReadStack(const std::string& pathPrefix, FrameSumMap& sums,
+      std::string& errorMessage)
+{
+   FILE* idx = fopen((pathPrefix + ".idx").c_str(), "rb");
+   if (!idx)
+   {
+      errorMessage = "Cannot open " + pathPrefix + ".idx";
+      return false;
+   }
+   FILE* raw = fopen((pathPrefix + ".raw").c_str(), "rb");
+   if (!raw)
+   {
+      fclose(idx);
+      errorMessage = "Cannot open " + pathPrefix + ".raw";
+      return false;
+   }
+
+   bool ok = true;
+   char magic[8];
+   uint32_t version, reserved;
+   if (fread(magic, 1, 8, idx) != 8 || memcmp(magic, "MMRAWIDX", 8) != 0 ||
+         !ReadValue(idx, version) || version != 1 || !ReadValue(idx, reserved))
+   {
+      errorMessage = pathPrefix + ".idx is not a raw stack index";
+      ok = false;
+   }
+
+   std::vector<unsigned char> frame;
+   while (ok)
+   {
+      uint32_t recordBytes, channel, width, height, byteDepth, nComponents;
+      uint64_t frameNumber, offset, bytes;
+      if (!ReadValue(idx, recordBytes))
+         break; // End of index
+      if (!ReadValue(idx, channel) || !ReadValue(idx, frameNumber) ||
+            !ReadValue(idx, offset) || !ReadValue(idx, bytes) ||
+            !ReadValue(idx, width) || !ReadValue(idx, height) ||
+            !ReadValue(idx, byteDepth) || !ReadValue(idx, nComponents) ||
+            recordBytes < 48 || fseek(idx, recordBytes - 48, SEEK_CUR) != 0)
+      {
+         errorMessage = pathPrefix + ".idx is truncated";
+         ok = false;
+         break;
+      }
+
+      if (nComponents != 1 || (byteDepth != 1 && byteDepth != 2))
+         continue; // Not a grayscale frame
+      const std::size_t pixelCount = static_cast<std::size_t>(width) * height;
+      if (bytes != pixelCount * byteDepth || pixelCount == 0)
+      {
+         errorMessage = pathPrefix + ".idx has an inconsistent frame size";
+         ok = false;
+         break;
+      }
+
+      frame.resize(static_cast<std::size_t>(bytes));
+      if (!Seek(raw, offset) || fread(&frame[0], 1, frame.size(), raw) != frame.size())
+      {
+         errorMessage = pathPrefix + ".raw is truncated";
+         ok = false;
+         break;
+      }
+
+      FrameSum& frameSum = sums[std::make_pair(std::make_pair(
+               static_cast<unsigned>(width), static_cast<unsigned>(height)),
+            static_cast<unsigned>(byteDepth))];
+      if (frameSum.sum.empty())
+      {
+         frameSum.sum.assign(pixelCount, 0.0);
+         frameSum.count = 0;
+      }
+      double* sum = &frameSum.sum[0];
+      if (byteDepth == 1)
+      {
+         const unsigned char* p = &frame[0];
+         for (std::size_t i = 0; i < pixelCount; ++i)
+            sum[i] += p[i];
+      }
+      else
+      {
+         const uint16_t* p = reinterpret_cast<const uint16_t*>(&frame[0]);
+         for (std::size_t i = 0; i < pixelCount; ++i)
+            sum[i] += p[i];
+      }
+      ++frameSum.count;
+   }
+
+   fclose(raw);
+   fclose(idx);
+   return ok;
+}
+
+// Names of the subdirectories of directory
+std::vector<std::string> ListSubdirectories(const std::string& directory)
+{
+   std::vector<std::string> names;
+#ifdef _WIN32
+   WIN32_FIND_DATAA data;
+   HANDLE h = FindFirstFileA((directory + "\\*").c_str(), &data);
+   if (h == INVALID_HANDLE_VALUE)
+      return names;
+   do
+   {
+      std::string name = data.cFileName;
+      if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) &&
+            name != "." && name != "..")
+         names.push_back(name);
+   } while (FindNextFileA(h, &data));
+   FindClose(h);
+#else
+   DIR* dir = opendir(directory.c_str());
+   if (!dir)
+      return names;
+   while (struct dirent* entry = readdir(dir))
+   {
+      std::string name = entry->d_name;
+      if (name == "." || name == "..")
+         continue;
+      struct stat st;
+      if (stat((directory + "/" + name).c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+         names.push_back(name);
+   }
+   closedir(dir);
+#endif
+   return names;
+}
+
+bool IsDirectory(const std::string& path)
+{
+#ifdef _WIN32
+   DWORD attributes = GetFileAttributesA(path.c_str());
+   return attributes != INVALID_FILE_ATTRIBUTES &&
+      (attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+   struct stat st;
+   return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+#endif
+}
+
+} // anonymous namespace
+
+
+bool ShadingCorrector::Key::operator<(const Key& other) const
+{
+   if (channel != other.channel)
+      return channel < other.channel;
+   if (width != other.width)
+      return width < other.width;
+   if (height != other.height)
+      return height < other.height;
+   return byteDepth < other.byteDepth;
+}
+
+bool ShadingCorrector::LoadChannel(const std::string& directory,
+      const std::string& channel, ReferenceMap& references,
+      std::string& errorMessage)
+{
+   FrameSumMap darks, flats;
+   const std::string darkPath = directory + "/dark";
+   const std::string flatPath = directory + "/flat";
+   if (FileExists(darkPath + ".idx") &&
+         !ReadStack(darkPath, darks, errorMessage))
+      return false;
+   if (FileExists(flatPath + ".idx") &&
+         !ReadStack(flatPath, flats, errorMessage))
+      return false;
+
+   // All sizes present in either stack
+   FrameSumMap all(darks);
+   all.insert(flats.begin(), flats.end());
+   for (FrameSumMap::const_iterator it = all.begin(); it != all.end(); ++it)
+   {
+      Key key;
+      key.channel = channel;
+      key.width = it->first.first.first;
+      key.height = it->first.first.second;
+      key.byteDepth = it->first.second;
+      const std::size_t pixelCount = static_cast<std::size_t>(key.width) * key.height;
+
+      FrameSumMap::const_iterator dark = darks.find(it->first);
+      FrameSumMap::const_iterator flat = flats.find(it->first);
+      std::vector<double> darkMean(pixelCount, 0.0);
+      if (dark != darks.end())
+      {
+         for (std::size_t i = 0; i < pixelCount; ++i)
+            darkMean[i] = dark->second.sum[i] / dark->second.count;
+      }
+
+      boost::shared_ptr<Reference> reference(new Reference());
+      reference->dark.resize(pixelCount);
+      reference->gain.assign(pixelCount, g_UnityGain);
+      for (std::size_t i = 0; i < pixelCount; ++i)
+         reference->dark[i] = static_cast<uint16_t>(darkMean[i] + 0.5);
+
+      if (flat != flats.end())
+      {
+         std::vector<double> signal(pixelCount);
+         double total = 0.0;
+         for (std::size_t i = 0; i < pixelCount; ++i)
+         {
+            signal[i] = flat->second.sum[i] / flat->second.count - darkMean[i];
+            total += signal[i];
+         }
+         const double mean = total / pixelCount;
+         const double maxGain = 65535.0 / g_UnityGain;
+         for (std::size_t i = 0; i < pixelCount; ++i)
+         {
+            // Pixels without signal in the flat are left unscaled
+            if (signal[i] <= 0.0 || mean <= 0.0)
+               continue;
+            const double gain = std::min(mean / signal[i], maxGain);
+            reference->gain[i] = static_cast<uint16_t>(gain * g_UnityGain + 0.5);
+         }
+      }
+      references[key] = reference;
+   }
+   return true;
+}
+
+bool ShadingCorrector::LoadReferences(const std::string& directory,
+      std::string& errorMessage)
+{
+   if (!IsDirectory(directory))
+   {
+      errorMessage = "Reference directory " + directory + " does not exist";
+      return false;
+   }
+
+   ReferenceMap references;
+   if (!LoadChannel(directory, "", references, errorMessage))
+      return false;
+   std::size_t channelCount = 0;
+   const std::vector<std::string> channels = ListSubdirectories(directory);
+   for (std::vector<std::string>::const_iterator it = channels.begin();
+         it != channels.end(); ++it)
+   {
+      const std::size_t before = references.size();
+      if (!LoadChannel(directory + "/" + *it, *it, references, errorMessage))
+         return false;
+      if (references.size() > before)
+         ++channelCount;
+   }
+
+   if (references.empty())
+   {
+      errorMessage = "No dark or flat references found in " + directory;
+      return false;
+   }
+
+   boost::mutex::scoped_lock lock(referenceMutex_);
+   references_.swap(references);
+   channelCount_ = channelCount;
+   return true;
+}
+
+void ShadingCorrector::ClearReferences()
+{
+   boost::mutex::scoped_lock lock(referenceMutex_);
+   references_.clear();
+   channelCount_ = 0;
+}
+
+std::size_t ShadingCorrector::GetReferenceCount() const
+{
+   boost::mutex::scoped_lock lock(referenceMutex_);
+   return references_.size();
+}
+
+std::size_t ShadingCorrector::GetChannelCount() const
+{
+   boost::mutex::scoped_lock lock(referenceMutex_);
+   return channelCount_;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Correction
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+template <typename PixelT>
+void CorrectPixels(PixelT* pixels, const uint16_t* dark, const uint16_t* gain,
+      int count, uint32_t maxValue)
+{
+   // (65535 * 65535 + rounding) still fits in 32 bits
+   const uint32_t rounding = 1 << (ShadingCorrector::gainShift - 1);
+   for (int i = 0; i < count; ++i)
+   {
+      const int32_t signal = static_cast<int32_t>(pixels[i]) - dark[i];
+      const uint32_t positive = signal > 0 ? static_cast<uint32_t>(signal) : 0;
+      const uint32_t value =
+         (positive * gain[i] + rounding) >> ShadingCorrector::gainShift;
+      pixels[i] = static_cast<PixelT>(value < maxValue ? value : maxValue);
+   }
+}
+
+} // anonymous namespace
+
+ShadingCorrector::ShadingCorrector() :
+   channelCount_(0),
+   threadCount_(1),
+   jobParts_(0),
+   generation_(0),
+   pending_(0),
+   stopWorkers_(false)
+{
+   memset(&job_, 0, sizeof(job_));
+}
+
+ShadingCorrector::~ShadingCorrector()
+{
+   StopWorkers();
+}
+
+void ShadingCorrector::SetThreadCount(unsigned count)
+{
+   boost::mutex::scoped_lock lock(correctMutex_);
+   count = std::max(1u, count);
+   if (count == threadCount_)
+      return;
+   StopWorkers();
+   threadCount_ = count;
+}
+
+bool ShadingCorrector::Correct(unsigned char* pixels, unsigned width,
+      unsigned height, unsigned byteDepth, const std::string& channel)
+{
+   if (width == 0 || height == 0 || (byteDepth != 1 && byteDepth != 2))
+      return false;
+
+   ReferencePtr reference;
+   {
+      boost::mutex::scoped_lock lock(referenceMutex_);
+      Key key;
+      key.channel = channel;
+      key.width = width;
+      key.height = height;
+      key.byteDepth = byteDepth;
+      ReferenceMap::const_iterator it = references_.find(key);
+      if (it == references_.end() && !channel.empty())
+      {
+         key.channel.clear();
+         it = references_.find(key);
+      }
+      if (it == references_.end())
+         return false;
+      reference = it->second;
+   }
+
+   boost::mutex::scoped_lock correctLock(correctMutex_);
+   const std::size_t pixelCount = static_cast<std::size_t>(width) * height;
+   unsigned parts = static_cast<unsigned>(std::min<std::size_t>(threadCount_,
+            std::max<std::size_t>(1, pixelCount / g_MinPixelsPerThread)));
+   parts = std::min(parts, height);
+
+   job_.pixels = pixels;
+   job_.width = width;
+   job_.height = height;
+   job_.byteDepth = byteDepth;
+   job_.reference = reference.get();
+   if (parts <= 1)
+   {
+      CorrectRows(0, height);
+      return true;
+   }
+
+   if (workers_.empty())
+      StartWorkers();
+
+   {
+      boost::mutex::scoped_lock lock(mutex_);
+      jobParts_ = parts;
+      pending_ = parts - 1;
+      ++generation_;
+   }
+   startCond_.notify_all();
+
+   // The calling thread corrects the first part
+   CorrectRows(0, height / parts);
+
+   boost::mutex::scoped_lock lock(mutex_);
+   while (pending_ > 0)
+      doneCond_.wait(lock);
+   return true;
+}
+
+void ShadingCorrector::CorrectRows(unsigned firstRow, unsigned endRow)
+{
+   const std::size_t begin = static_cast<std::size_t>(firstRow) * job_.width;
+   const int count = static_cast<int>((endRow - firstRow) * job_.width);
+   const uint16_t* dark = &job_.reference->dark[begin];
+   const uint16_t* gain = &job_.reference->gain[begin];
+   if (job_.byteDepth == 1)
+      CorrectPixels(job_.pixels + begin, dark, gain, count, 255);
+   else
+      CorrectPixels(reinterpret_cast<uint16_t*>(job_.pixels) + begin, dark,
+            gain, count, 65535);
+}
+
+void ShadingCorrector::StartWorkers()
+{
+   unsigned long generation;
+   {
+      boost::mutex::scoped_lock lock(mutex_);
+      stopWorkers_ = false;
+      generation = generation_;
+   }
+   for (unsigned part = 1; part < threadCount_; ++part)
+      workers_.push_back(new boost::thread(boost::bind(
+                  &ShadingCorrector::WorkerThread, this, part, generation)));
+}
+
+void ShadingCorrector::StopWorkers()
+{
+   {
+      boost::mutex::scoped_lock lock(mutex_);
+      stopWorkers_ = true;
+   }
+   startCond_.notify_all();
+   for (std::size_t i = 0; i < workers_.size(); ++i)
+   {
+      workers_[i]->join();
+      delete workers_[i];
+   }
+   workers_.clear();
+}
+
+void ShadingCorrector::WorkerThread(unsigned part, unsigned long seenGeneration)
+{
+   for (;;)
+   {
+      unsigned firstRow, endRow;
+      {
+         boost::mutex::scoped_lock lock(mutex_);
+         while (!stopWorkers_ && generation_ == seenGeneration)
+            startCond_.wait(lock);
+         if (stopWorkers_)
+            return;
+         seenGeneration = generation_;
+         if (part >= jobParts_)
+            continue; // Not needed for this (small) image
+         firstRow = static_cast<unsigned>((std::size_t)job_.height * part / jobParts_);
+         endRow = static_cast<unsigned>((std::size_t)job_.height * (part + 1) / jobParts_);
+      }
+
+      CorrectRows(firstRow, endRow);
+
+      {
+         boost::mutex::scoped_lock lock(mutex_);
+         --pending_;
+      }
+      doneCond_.notify_all();
+   }
+}
@@ -0,0 +1,139 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          ShadingCorrector.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     DeviceAdapters
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Dark frame and flat-field correction of 8- and 16-bit images
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#ifndef _SHADINGCORRECTOR_H_
+#define _SHADINGCORRECTOR_H_
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/**
+ * Applies out = (raw - dark) * gain to images, where gain is the mean of
+ * (flat - dark) divided by (flat - dark), per pixel.
+ *
+ * References are read from raw stacks as written by the core's disk
+ * streaming (a .raw file and a .idx index, see MMCore/DiskSink.h); all
+ * frames of a given size and pixel depth in a stack are averaged. In a
+ * reference directory, dark.raw/dark.idx and flat.raw/flat.idx apply to all
+ * channels, and the same files in a subdirectory named after a channel
+ * preset apply to that channel only. Either reference may be missing. A
+ * stack may hold frames of several sizes (e.g. recorded at different
+ * binnings); each image is corrected with the reference of its own size.
+ *
+ * The gain is precomputed as a 4.12 fixed-point factor, so that the
+ * correction is an integer subtract, multiply and shift per pixel, in loops
+ * that the compiler vectorizes. Rows are split across a set of persistent
+ * worker threads.
+ */
+class ShadingCorrector
+{
+public:
+   ShadingCorrector();
+   ~ShadingCorrector();
+
+   // Number of threads (including the calling thread) used per image
+   void SetThreadCount(unsigned count);
+   unsigned GetThreadCount() const { return threadCount_; }
+
+   /**
+    * Replaces the references with those found in directory. On failure, the
+    * current references are kept and false is returned with a message.
+    */
+   bool LoadReferences(const std::string& directory, std::string& errorMessage);
+   void ClearReferences();
+   std::size_t GetReferenceCount() const;
+   // Number of channels with their own references
+   std::size_t GetChannelCount() const;
+
+   /**
+    * Corrects the image in place, using the references of the given channel
+    * (or the default ones if the channel has none). Returns false, leaving
+    * the image unchanged, if no reference matches the image.
+    */
+   bool Correct(unsigned char* pixels, unsigned width, unsigned height,
+         unsigned byteDepth, const std::string& channel);
+
+   static const unsigned gainShift = 12;
+
+private:
+   ShadingCorrector(const ShadingCorrector&);
+   ShadingCorrector& operator=(const ShadingCorrector&);
+
+   struct Reference
+   {
+      std::vector<uint16_t> dark;
+      std::vector<uint16_t> gain; // 4.12 fixed point
+   };
+   typedef boost::shared_ptr<const Reference> ReferencePtr;
+
+   // (channel, width, height, byteDepth); channel is empty for the default
+   struct Key
+   {
+      std::string channel;
+      unsigned width;
+      unsigned height;
+      unsigned byteDepth;
+      bool operator<(const Key& other) const;
+   };
+   typedef std::map<Key, ReferencePtr> ReferenceMap;
+
+   struct Job
+   {
+      unsigned char* pixels;
+      unsigned width;
+      unsigned height;
+      unsigned byteDepth;
+      const Reference* reference;
+   };
+
+   static bool LoadChannel(const std::string& directory,
+         const std::string& channel, ReferenceMap& references,
+         std::string& errorMessage);
+   void CorrectRows(unsigned firstRow, unsigned endRow);
+   void StartWorkers();
+   void StopWorkers();
+   void WorkerThread(unsigned part, unsigned long seenGeneration);
+
+   mutable boost::mutex referenceMutex_;
+   ReferenceMap references_;
+   std::size_t channelCount_;
+
+   // Serializes Correct() calls, which share the workers
+   boost::mutex correctMutex_;
+   unsigned threadCount_;
+   boost::mutex mutex_;
+   boost::condition_variable startCond_;
+   boost::condition_variable doneCond_;
+   std::vector<boost::thread*> workers_;
+   Job job_;
+   unsigned jobParts_;
+   unsigned long generation_;
+   unsigned pending_;
+   bool stopWorkers_;
+};
+
+#endif //_SHADINGCORRECTOR_H_
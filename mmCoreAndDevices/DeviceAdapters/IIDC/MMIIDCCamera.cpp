@@ -36,6 +36,7 @@
 
 #include "DeviceBase.h"
 #include "ModuleInterface.h"
+#include "PixelConvert.h"
 
 #ifdef _MSC_VER
 #include <stdlib.h> // _byteswap_ushort()
@@ -281,20 +282,6 @@ inline void RightShift16(uint16_t* dst, const uint16_t* src,
 }
 
 
-/*
- * Convert to Micro-Manager's idiosyncratic RGB format
- */
-inline void BGR24ToRGB32(uint8_t* dst, const uint8_t* src, size_t count)
-{
-   for (size_t i = 0; i < count; ++i)
-   {
-      dst[4 * i + 0] = src[3 * i + 2];
-      dst[4 * i + 1] = src[3 * i + 1];
-      dst[4 * i + 2] = src[3 * i + 0];
-      dst[4 * i + 3] = 0;
-   }
-}
-
 } // anonymous namespace
 
 
@@ -1926,10 +1913,11 @@ MMIIDCCamera::ProcessImage(const void* source, bool ownResultBuffer,
          bufferConvertedTo32Bit.reset(dest);
       }
 
-      // We seem to get BGR images out of libdc1394 (seen with iSight YUV
-      // formats on OS X; AVT YUV or RGB formats on OS X and Windows), so
-      // handle BGR-to-RGB at the same time.
-      BGR24ToRGB32(dest, pixels, destWidth * destHeight);
+      // Convert to Micro-Manager's idiosyncratic RGB format (B, G, R, A
+      // bytes), from the R, G, B bytes we get out of libdc1394
+      PixelConverter().RGB24ToRGB32(dest, pixels,
+            static_cast<unsigned>(destWidth), static_cast<unsigned>(destHeight),
+            static_cast<unsigned>(destWidth * 3));
       pixels = dest;
    }
 
@@ -0,0 +1,153 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          FocusScorer.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     DeviceAdapters
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Image sharpness scores for SimpleAutofocus
+// AUTHOR:        agent, agent@local, 10/19/2026
+// COPYRIGHT:     agent, 2026
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+//
+
+#ifndef _FOCUSSCORER_H_
+#define _FOCUSSCORER_H_
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/barrier.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/**
+ * Computes the sharpness of the central region of an 8- or 16-bit image.
+ *
+ * The region (cropFactor times the image size, optionally taking only every
+ * n-th row and column) is copied once into a 16-bit work buffer with a
+ * one-pixel border, so that the metric kernels need no bounds checks. The
+ * kernels are written as straight-line loops over rows that the compiler can
+ * vectorize, and rows are split across threads. Buffers and worker threads
+ * are kept between calls.
+ *
+ * Available metrics:
+ *   MedianEdges        - 3x3 median filter followed by the squared diagonal
+ *                        edge filter [-2 -1 0; -1 0 1; 0 1 2], normalized by
+ *                        the squared mean (the original SimpleAutofocus score)
+ *   NormalizedVariance - variance / mean
+ *   Brenner            - mean of (I(x+2,y) - I(x,y))^2 / mean^2
+ *   Tenengrad          - mean of squared Sobel gradient magnitude / mean^2
+ *   Laplacian          - mean of squared 4-neighbour Laplacian / mean^2
+ */
+class FocusScorer
+{
+public:
+   enum Metric
+   {
+      MedianEdges,
+      NormalizedVariance,
+      Brenner,
+      Tenengrad,
+      Laplacian
+   };
+
+   static const char* GetMetricName(Metric metric);
+   static bool GetMetricFromName(const std::string& name, Metric& metric);
+   static std::vector<std::string> GetMetricNames();
+
+   FocusScorer();
+   ~FocusScorer();
+
+   void SetMetric(Metric metric) { metric_ = metric; }
+   Metric GetMetric() const { return metric_; }
+   void SetThreadCount(unsigned count);
+   unsigned GetThreadCount() const { return threadCount_; }
+   // Use every step-th row and column of the region
+   void SetSubsampling(unsigned step) { subsampling_ = step < 1 ? 1 : step; }
+   unsigned GetSubsampling() const { return subsampling_; }
+
+   // Returns false if byteDepth is not 1 or 2
+   bool Score(const unsigned char* pixels, unsigned width, unsigned height,
+         unsigned byteDepth, double cropFactor);
+
+   double GetScore() const { return score_; }
+   double GetMean() const { return mean_; }
+   double GetStdDevOverMean() const { return stdDevOverMean_; }
+   // Half the difference of the two highest and two lowest median-filtered
+   // values (MedianEdges only), normalized by the mean
+   double GetDynamicRange() const { return dynamicRange_; }
+
+   // Per-thread partial results; public for use by the kernels
+   struct Partial
+   {
+      uint64_t sum;
+      uint64_t sumSq;
+      double acc;
+      unsigned short min1, min2, max1, max2;
+      std::vector<float> rowX;
+      std::vector<float> rowY;
+   };
+
+private:
+   FocusScorer(const FocusScorer&);
+   FocusScorer& operator=(const FocusScorer&);
+
+   void StartWorkers(unsigned count);
+   void StopWorkers();
+   void WorkerThreadFunc(unsigned part, unsigned generation);
+   void RunParts(unsigned parts, const unsigned char* pixels,
+         unsigned byteDepth);
+   void RunPart(unsigned part, unsigned parts, const unsigned char* pixels,
+         unsigned byteDepth, boost::barrier* barrier);
+   template <typename PixelT>
+   void CopyRegion(unsigned firstRow, unsigned endRow, const PixelT* pixels,
+         Partial& partial);
+   void MedianFilter(unsigned firstRow, unsigned endRow, Partial& partial);
+   void ScoreRows(unsigned firstRow, unsigned endRow, Partial& partial);
+
+   Metric metric_;
+   unsigned threadCount_;
+   unsigned subsampling_;
+
+   // Geometry of the current call
+   unsigned imageWidth_, imageHeight_;
+   unsigned originX_, originY_;
+   unsigned regionWidth_, regionHeight_; // after subsampling
+   unsigned paddedWidth_;
+
+   std::vector<unsigned short> work_;     // region with a one-pixel border
+   std::vector<unsigned short> smoothed_; // median-filtered region
+   std::vector<Partial> partials_;
+
+   // Worker i runs part i + 1 of each call that has that many parts
+   std::vector< boost::shared_ptr<boost::thread> > workers_;
+   boost::mutex workMutex_;
+   boost::condition_variable workCond_;
+   boost::condition_variable doneCond_;
+   unsigned workGeneration_; // Incremented for each call run by workers
+   unsigned pendingParts_;
+   bool stopWorkers_;
+   // The current call
+   unsigned workParts_;
+   const unsigned char* workPixels_;
+   unsigned workByteDepth_;
+   boost::barrier* workBarrier_;
+
+   double score_;
+   double mean_;
+   double stdDevOverMean_;
+   double dynamicRange_;
+};
+
+#endif // _FOCUSSCORER_H_
@@ -26,6 +26,7 @@
 #include "MMDevice.h"
 #include "DeviceBase.h"
 #include "ImgBuffer.h"
+#include "FocusScorer.h"
 
 #include <string>
 //#include <iostream>
@@ -40,10 +41,6 @@
 // data for AF performance report table
 class SAFData;
 
-// computational utility functions
-
-double GetScore(short* img, int w0, int h0, double cropFactor);
-
 class SimpleAutofocus : public CAutoFocusBase<SimpleAutofocus>
 {
 public:
@@ -104,6 +101,9 @@ public:
    int OnStandardDeviationOverMean(MM::PropertyBase* pProp, MM::ActionType eAct);
    int OnChannel(MM::PropertyBase* pProp, MM::ActionType eAct);
    int OnSearchAlgorithm(MM::PropertyBase* pProp, MM::ActionType eAct);
+   int OnSharpnessMetric(MM::PropertyBase* pProp, MM::ActionType eAct);
+   int OnScoringThreads(MM::PropertyBase* pProp, MM::ActionType eAct);
+   int OnSubsampling(MM::PropertyBase* pProp, MM::ActionType eAct);
 
 
 private:
@@ -142,12 +142,8 @@ private:
    double latestSharpness_;
 
    long enableAutoShuttering_;
-   unsigned long sizeOfTempShortBuffer_;
-
-   float* pSmoothedIm_;
-   unsigned long sizeOfSmoothedIm_;
 
-   unsigned short* pShort_;
+   FocusScorer scorer_;
    // a flag to trigger recalculation
    long recalculate_;
    double mean_;
@@ -162,16 +158,6 @@ private:
    double exposureForAutofocusAcquisition_;
    long binningForAutofocusAcquisition_; // over-ride the camera setting if this is non-0
 
-
-   //std::multiset<float> mins_;
-   //std::mulitset<float> maxs_;
-   //const int nExtrema_ = 5;
-
-   float min1_;
-   float min2_;
-   float max1_;
-   float max2_;
-
    // this defines member functions that operate on evaluator DoubleFunctionOfDouble
 #include "Brent.h"
 
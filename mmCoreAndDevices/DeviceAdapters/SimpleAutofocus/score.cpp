@@ -1,157 +1,524 @@
-#include "SimpleAutofocus.h"
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          score.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     DeviceAdapters
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Image sharpness scores for SimpleAutofocus
+// COPYRIGHT:     University of California, San Francisco, 2009-2021
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+//
 
-unsigned short FindMedian(unsigned short* arr, const int lengthMinusOne)
+#include "FocusScorer.h"
+
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace {
+
+const char* const g_MetricNames[] =
+{
+   "MedianEdges",
+   "NormalizedVariance",
+   "Brenner",
+   "Tenengrad",
+   "Laplacian",
+};
+const unsigned g_NumMetrics = sizeof(g_MetricNames) / sizeof(g_MetricNames[0]);
+
+// Below this many region pixels the scoring runs on the calling thread
+const unsigned g_MinPixelsForThreads = 64 * 1024;
+// Minimum number of rows handed to each thread
+const unsigned g_MinRowsPerThread = 16;
+
+inline unsigned Clamp(int value, unsigned size)
+{
+   if (value < 0)
+      return 0;
+   if ((unsigned)value >= size)
+      return size - 1;
+   return (unsigned)value;
+}
+
+// Four independent accumulators, so that the loop vectorizes without
+// reassociating the sum
+inline double SumSquares(const float* values, unsigned count)
+{
+   double a0 = 0.0, a1 = 0.0, a2 = 0.0, a3 = 0.0;
+   unsigned i = 0;
+   for (; i + 4 <= count; i += 4)
+   {
+      a0 += (double)values[i] * values[i];
+      a1 += (double)values[i + 1] * values[i + 1];
+      a2 += (double)values[i + 2] * values[i + 2];
+      a3 += (double)values[i + 3] * values[i + 3];
+   }
+   for (; i < count; ++i)
+      a0 += (double)values[i] * values[i];
+   return (a0 + a1) + (a2 + a3);
+}
+
+// Keeps the two lowest and two highest values seen
+inline void UpdateExtrema(unsigned short v, FocusScorer::Partial& p)
 {
-   unsigned short tmp;
-   // n.b. this was ported from java, looks like a bubble sort....
-   // todo use qsort
-   for(int i=0; i<lengthMinusOne; ++i)
+   if (v < p.min1)
    {
-      for(int j=0; j<lengthMinusOne-i; ++j)
+      p.min2 = p.min1;
+      p.min1 = v;
+   }
+   else if (v < p.min2)
+      p.min2 = v;
+   if (v > p.max1)
+   {
+      p.max2 = p.max1;
+      p.max1 = v;
+   }
+   else if (v > p.max2)
+      p.max2 = v;
+}
+
+} // anonymous namespace
+
+
+const char* FocusScorer::GetMetricName(Metric metric)
+{
+   if ((unsigned)metric < g_NumMetrics)
+      return g_MetricNames[metric];
+   return "";
+}
+
+bool FocusScorer::GetMetricFromName(const std::string& name, Metric& metric)
+{
+   for (unsigned i = 0; i < g_NumMetrics; ++i)
+   {
+      if (name == g_MetricNames[i])
       {
-         if (arr[j+1]<arr[j])
-         {
-            tmp = arr[j];
-            arr[j]=arr[j+1];
-            arr[j+1]=tmp;
-         }
+         metric = static_cast<Metric>(i);
+         return true;
       }
    }
-   return arr[lengthMinusOne/2 +1];
+   return false;
 }
 
+std::vector<std::string> FocusScorer::GetMetricNames()
+{
+   return std::vector<std::string>(g_MetricNames, g_MetricNames + g_NumMetrics);
+}
 
-double GetScore(unsigned short* img, int w0, int h0, double cropFactor)
+
+FocusScorer::FocusScorer() :
+   metric_(MedianEdges),
+   threadCount_(1),
+   subsampling_(1),
+   imageWidth_(0),
+   imageHeight_(0),
+   originX_(0),
+   originY_(0),
+   regionWidth_(0),
+   regionHeight_(0),
+   paddedWidth_(0),
+   workGeneration_(0),
+   pendingParts_(0),
+   stopWorkers_(false),
+   workParts_(0),
+   workPixels_(0),
+   workByteDepth_(0),
+   workBarrier_(0),
+   score_(0.0),
+   mean_(0.0),
+   stdDevOverMean_(0.0),
+   dynamicRange_(0.0)
+{
+   SetThreadCount(std::min(boost::thread::hardware_concurrency(), 8u));
+}
+
+FocusScorer::~FocusScorer()
+{
+   StopWorkers();
+}
+
+void FocusScorer::SetThreadCount(unsigned count)
+{
+   threadCount_ = count < 1 ? 1 : count;
+   if (workers_.size() > threadCount_ - 1)
+      StopWorkers();
+}
+
+// Workers are started on first use and kept until the thread count drops
+void FocusScorer::StartWorkers(unsigned count)
+{
+   while (workers_.size() < count)
+      workers_.push_back(boost::make_shared<boost::thread>(
+               boost::bind(&FocusScorer::WorkerThreadFunc, this,
+                  (unsigned)workers_.size() + 1, workGeneration_)));
+}
+
+void FocusScorer::StopWorkers()
 {
-   unsigned short windo[9];
-   int width =  (int)(cropFactor * w0);
-   int height = (int)(cropFactor * h0);
-   int ow = (int)(((1-cropFactor)/2)*w0);
-   int oh = (int)(((1-cropFactor)/2)*h0);
-   unsigned short* smoothedImage = new unsigned short[width*height];
-   // calculate the standard deviation & mean
-   long nPts = 0;
-   double mean = 0;
-   double M2 = 0;
-   double delta;
-   // one-pass algorithm for mean and std from Welford / Knuth  - KH
-   for (int i=0; i<width; i++)
    {
-      for (int j=0; j<height; j++)
+      boost::lock_guard<boost::mutex> lock(workMutex_);
+      stopWorkers_ = true;
+   }
+   workCond_.notify_all();
+   for (std::size_t i = 0; i < workers_.size(); ++i)
+      workers_[i]->join();
+   workers_.clear();
+   stopWorkers_ = false;
+}
+
+// generation is that of the last call before the worker was started
+void FocusScorer::WorkerThreadFunc(unsigned part, unsigned generation)
+{
+   for (;;)
+   {
+      unsigned parts;
+      const unsigned char* pixels;
+      unsigned byteDepth;
+      boost::barrier* barrier;
+      {
+         boost::unique_lock<boost::mutex> lock(workMutex_);
+         while (workGeneration_ == generation && !stopWorkers_)
+            workCond_.wait(lock);
+         if (stopWorkers_)
+            return;
+         generation = workGeneration_;
+         if (part >= workParts_)
+            continue;
+         parts = workParts_;
+         pixels = workPixels_;
+         byteDepth = workByteDepth_;
+         barrier = workBarrier_;
+      }
+
+      RunPart(part, parts, pixels, byteDepth, barrier);
+
       {
-         ++nPts;
-         long value = img[ow+i+ width*(oh+j)];
-         delta = value - mean;
-         mean = mean + delta/nPts;
-         M2 = M2 + delta*(value - mean); // #This expression uses the new value of mean_
+         boost::lock_guard<boost::mutex> lock(workMutex_);
+         if (--pendingParts_ == 0)
+            doneCond_.notify_all();
       }
    }
-   //double variance_n = M2/nPts;
-   double variance = M2/(nPts - 1);
-   double stdOverMean = 0.;
-   double meanScaling = 1.;
-   if( 0. != mean)
+}
+
+// Runs part 0 on the calling thread and the others on the workers
+void FocusScorer::RunParts(unsigned parts, const unsigned char* pixels,
+      unsigned byteDepth)
+{
+   StartWorkers(parts - 1);
+
+   boost::barrier barrier(parts);
    {
-      stdOverMean = pow(variance,0.5)/mean;
-      meanScaling = 1./mean;
+      boost::lock_guard<boost::mutex> lock(workMutex_);
+      workParts_ = parts;
+      workPixels_ = pixels;
+      workByteDepth_ = byteDepth;
+      workBarrier_ = &barrier;
+      pendingParts_ = parts - 1;
+      ++workGeneration_;
    }
-   //LogMessage("N " + boost::lexical_cast<std::string,long>(nPts) + " mean " +  boost::lexical_cast<std::string,float>((float)mean_) + " nrmlzd std " +  boost::lexical_cast<std::string,float>((float)standardDeviationOverMean_) );
-   // ToDO -- eliminate copy above.
-   int x[9];
-   int y[9];
-   /*Apply 3x3 median filter to reduce shot noise*/
-   for (int i=0; i<width; i++)
+   workCond_.notify_all();
+
+   RunPart(0, parts, pixels, byteDepth, &barrier);
+
+   boost::unique_lock<boost::mutex> lock(workMutex_);
+   while (pendingParts_ > 0)
+      doneCond_.wait(lock);
+}
+
+bool FocusScorer::Score(const unsigned char* pixels, unsigned width,
+      unsigned height, unsigned byteDepth, double cropFactor)
+{
+   score_ = mean_ = stdDevOverMean_ = dynamicRange_ = 0.0;
+   if (!pixels || width == 0 || height == 0 || (byteDepth != 1 && byteDepth != 2))
+      return false;
+
+   unsigned cropWidth = std::max(1, (int)(cropFactor * width));
+   unsigned cropHeight = std::max(1, (int)(cropFactor * height));
+   cropWidth = std::min(cropWidth, width);
+   cropHeight = std::min(cropHeight, height);
+   imageWidth_ = width;
+   imageHeight_ = height;
+   originX_ = std::min((unsigned)(((1 - cropFactor) / 2) * width), width - cropWidth);
+   originY_ = std::min((unsigned)(((1 - cropFactor) / 2) * height), height - cropHeight);
+   regionWidth_ = (cropWidth + subsampling_ - 1) / subsampling_;
+   regionHeight_ = (cropHeight + subsampling_ - 1) / subsampling_;
+   paddedWidth_ = regionWidth_ + 2;
+
+   work_.resize((std::size_t)paddedWidth_ * (regionHeight_ + 2));
+   if (metric_ == MedianEdges)
+      smoothed_.resize((std::size_t)regionWidth_ * regionHeight_);
+
+   unsigned parts = 1;
+   if ((std::size_t)regionWidth_ * regionHeight_ >= g_MinPixelsForThreads)
+      parts = std::max(1u, std::min(threadCount_, regionHeight_ / g_MinRowsPerThread));
+   partials_.resize(parts);
+
+   if (parts == 1)
+   {
+      RunPart(0, 1, pixels, byteDepth, 0);
+   }
+   else
+   {
+      RunParts(parts, pixels, byteDepth);
+   }
+
+   uint64_t sum = 0, sumSq = 0;
+   double acc = 0.0;
+   for (unsigned part = 0; part < parts; ++part)
+   {
+      sum += partials_[part].sum;
+      sumSq += partials_[part].sumSq;
+      acc += partials_[part].acc;
+   }
+
+   const double n = (double)regionWidth_ * regionHeight_;
+   mean_ = sum / n;
+   double variance = 0.0;
+   if (n > 1)
+      variance = std::max(0.0, ((double)sumSq - sum * mean_) / (n - 1));
+   double meanScaling = 1.0;
+   if (mean_ != 0.0)
    {
-      for (int j=0; j<height; j++)
+      stdDevOverMean_ = std::sqrt(variance) / mean_;
+      meanScaling = 1.0 / mean_;
+   }
+
+   switch (metric_)
+   {
+      case MedianEdges:
       {
-         float theValue;
-         x[0]=ow+i-1;
-         y[0]= (oh+j-1);
-         x[1]=ow+i;
-         y[1]= (oh+j-1);
-         x[2]=ow+i+1;
-         y[2]= (oh+j-1);
-         x[3]=ow+i-1;
-         y[3]=(oh+j);
-         x[4]=ow+i;
-         y[4]=(oh+j);
-         x[5]=ow+i+1;
-         y[5]=(oh+j);
-         x[6]=ow+i-1;
-         y[6]=(oh+j+1);
-         x[7]=ow+i;
-         y[7]=(oh+j+1);
-         x[8]=ow+i+1;
-         y[8]=(oh+j+1);
-         // truncate the median filter window  -- duplicate edge points
-         // this could be more efficient, we could fill in the interior image [1,w0-1]x[1,h0-1] then explicitly fill in the edge pixels.
-         for(int ij =0; ij < 9; ++ij)
+         // To reduce the effect of bleaching, the median-filtered image is
+         // normalized by the mean
+         score_ = acc * meanScaling * meanScaling;
+
+         std::vector<unsigned short> lows, highs;
+         for (unsigned part = 0; part < parts; ++part)
          {
-            if( x[ij] < 0)
-               x[ij] = 0;
-            else if( w0-1 < x[ij])
-               x[ij] = w0-1;
-            if( y[ij] < 0)
-               y[ij] = 0;
-            else if( h0-1 < y[ij])
-               y[ij] = h0-1;
+            lows.push_back(partials_[part].min1);
+            lows.push_back(partials_[part].min2);
+            highs.push_back(partials_[part].max1);
+            highs.push_back(partials_[part].max2);
          }
-         for(int ij = 0; ij < 9; ++ij)
+         std::sort(lows.begin(), lows.end());
+         std::sort(highs.begin(), highs.end());
+         if (regionWidth_ * regionHeight_ >= 2)
+            dynamicRange_ = 0.5 * meanScaling *
+               (((double)highs[highs.size() - 1] + highs[highs.size() - 2]) -
+                ((double)lows[0] + lows[1]));
+         break;
+      }
+      case NormalizedVariance:
+         score_ = variance * meanScaling;
+         break;
+      case Brenner:
+      case Tenengrad:
+      case Laplacian:
+         score_ = acc / n * meanScaling * meanScaling;
+         break;
+   }
+   return true;
+}
+
+void FocusScorer::RunPart(unsigned part, unsigned parts,
+      const unsigned char* pixels, unsigned byteDepth, boost::barrier* barrier)
+{
+   Partial& partial = partials_[part];
+   partial.sum = 0;
+   partial.sumSq = 0;
+   partial.acc = 0.0;
+   partial.min1 = partial.min2 = 0xffff;
+   partial.max1 = partial.max2 = 0;
+   partial.rowX.resize(paddedWidth_);
+   partial.rowY.resize(paddedWidth_);
+
+   const unsigned paddedHeight = regionHeight_ + 2;
+   unsigned first = paddedHeight * part / parts;
+   unsigned end = paddedHeight * (part + 1) / parts;
+   if (byteDepth == 1)
+      CopyRegion(first, end, pixels, partial);
+   else
+      CopyRegion(first, end, reinterpret_cast<const unsigned short*>(pixels), partial);
+
+   if (metric_ == NormalizedVariance)
+      return;
+
+   // All kernels read the rows above and below their own
+   if (barrier)
+      barrier->wait();
+
+   first = regionHeight_ * part / parts;
+   end = regionHeight_ * (part + 1) / parts;
+   if (metric_ == MedianEdges)
+   {
+      MedianFilter(first, end, partial);
+      if (barrier)
+         barrier->wait();
+   }
+   ScoreRows(first, end, partial);
+}
+
+template <typename PixelT>
+void FocusScorer::CopyRegion(unsigned firstRow, unsigned endRow,
+      const PixelT* pixels, Partial& partial)
+{
+   const int step = (int)subsampling_;
+   for (unsigned py = firstRow; py < endRow; ++py)
+   {
+      const unsigned sy = Clamp((int)originY_ + ((int)py - 1) * step, imageHeight_);
+      const PixelT* src = pixels + (std::size_t)sy * imageWidth_ + originX_;
+      unsigned short* dst = &work_[(std::size_t)py * paddedWidth_];
+
+      // Border columns duplicate the image edge where the region touches it
+      dst[0] = pixels[(std::size_t)sy * imageWidth_ +
+         Clamp((int)originX_ - step, imageWidth_)];
+      dst[regionWidth_ + 1] = pixels[(std::size_t)sy * imageWidth_ +
+         Clamp((int)(originX_ + regionWidth_ * step), imageWidth_)];
+      unsigned short* out = dst + 1;
+      if (step == 1)
+      {
+         for (unsigned x = 0; x < regionWidth_; ++x)
+            out[x] = src[x];
+      }
+      else
+      {
+         for (unsigned x = 0; x < regionWidth_; ++x)
+            out[x] = src[x * step];
+      }
+
+      if (py >= 1 && py <= regionHeight_)
+      {
+         uint64_t sum = 0, sumSq = 0;
+         for (unsigned x = 0; x < regionWidth_; ++x)
          {
-            windo[ij] = img[x[ij] + w0*y[ij]];
+            const uint32_t v = out[x];
+            sum += v;
+            sumSq += v * v;
          }
-         // N.B. this window filler as ported from java needs to have a pad guaranteed around the cropped image!!!! KH
-         //windo[0] = pShort_[ow+i-1 + width*(oh+j-1)];
-         //windo[1] = pShort_[ow+i+ width*(oh+j-1)];
-         //windo[2] = pShort_[ow+i+1+ width*(oh+j-1)];
-         //windo[3] = pShort_[ow+i-1+ width*(oh+j)];
-         //windo[4] = pShort_[ow+i+ width*(oh+j)];
-         //windo[5] = pShort_[ow+i+1+ width*(oh+j)];
-         //windo[6] = pShort_[ow+i-1+ width*(oh+j+1)];
-         //windo[7] = pShort_[ow+i+ width*(oh+j+1)];
-         //windo[8] = pShort_[ow+i+1+ width*(oh+j+1)];
-         // to reduce effect of bleaching on the high-pass sharpness measurement, i use the image normalized by the mean - KH.
-         theValue = (float)((double)FindMedian(windo,8)*meanScaling);
-         smoothedImage[i + j*width] = (unsigned short)theValue;
-         // the dynamic range of the normalized image is a very strong function of the image sharpness, also  - KH
-         // here I'm using dynamic range of the median-filter image
-         // a faster measure could skip the median filter, but use the sum of the 5 - 10 highest and 5 - 10 lowest normalized pixels
-         // average over a couple of points to lessen effect of fluctuations & noise
-         // todo - make the active measure of image sharpness user-selectable
-         // save the  max points and the min points
-         double min1 = 1.e8;
-         double min2 = 1.e8;
-         double max1 = -1.e8;
-         double max2 = -1.e8;
-         if( theValue < min1 )
+         partial.sum += sum;
+         partial.sumSq += sumSq;
+      }
+   }
+}
+
+#define SORT2(a, b) { const unsigned short t = std::min(a, b); b = std::max(a, b); a = t; }
+
+void FocusScorer::MedianFilter(unsigned firstRow, unsigned endRow,
+      Partial& partial)
+{
+   const int w = (int)regionWidth_;
+   for (unsigned y = firstRow; y < endRow; ++y)
+   {
+      const unsigned short* up = &work_[(std::size_t)y * paddedWidth_];
+      const unsigned short* mid = up + paddedWidth_;
+      const unsigned short* dn = mid + paddedWidth_;
+      unsigned short* out = &smoothed_[(std::size_t)y * regionWidth_];
+
+      // Median of 9 by a 19-comparison sorting network, branch free
+      for (int x = 0; x < w; ++x)
+      {
+         unsigned short p0 = up[x], p1 = up[x + 1], p2 = up[x + 2];
+         unsigned short p3 = mid[x], p4 = mid[x + 1], p5 = mid[x + 2];
+         unsigned short p6 = dn[x], p7 = dn[x + 1], p8 = dn[x + 2];
+         SORT2(p1, p2); SORT2(p4, p5); SORT2(p7, p8);
+         SORT2(p0, p1); SORT2(p3, p4); SORT2(p6, p7);
+         SORT2(p1, p2); SORT2(p4, p5); SORT2(p7, p8);
+         SORT2(p0, p3); SORT2(p5, p8); SORT2(p4, p7);
+         SORT2(p3, p6); SORT2(p1, p4); SORT2(p2, p5);
+         SORT2(p4, p7); SORT2(p4, p2); SORT2(p6, p4);
+         SORT2(p4, p2);
+         out[x] = p4;
+      }
+
+      for (int x = 0; x < w; ++x)
+         UpdateExtrema(out[x], partial);
+   }
+}
+
+#undef SORT2
+
+void FocusScorer::ScoreRows(unsigned firstRow, unsigned endRow,
+      Partial& partial)
+{
+   float* rx = &partial.rowX[0];
+   float* ry = &partial.rowY[0];
+   const int w = (int)regionWidth_;
+   double acc = 0.0;
+
+   switch (metric_)
+   {
+      case MedianEdges:
+      {
+         // Edge filter [-2 -1 0; -1 0 1; 0 1 2] on the interior of the
+         // median-filtered region
+         if (w < 3)
+            break;
+         const unsigned first = std::max(firstRow, 1u);
+         const unsigned end = std::min(endRow, regionHeight_ - 1);
+         for (unsigned l = first; l < end; ++l)
          {
-            min2 = min1;
-            min1 = theValue;
+            const unsigned short* up = &smoothed_[(std::size_t)(l - 1) * w];
+            const unsigned short* mid = up + w;
+            const unsigned short* dn = mid + w;
+            for (int k = 1; k < w - 1; ++k)
+               rx[k - 1] = (float)(-2 * (int)up[k - 1] - (int)up[k] -
+                     (int)mid[k - 1] + (int)mid[k + 1] +
+                     (int)dn[k] + 2 * (int)dn[k + 1]);
+            acc += SumSquares(rx, w - 2);
          }
-         else if (theValue < min2)
+         break;
+      }
+      case Brenner:
+         for (unsigned y = firstRow; y < endRow; ++y)
          {
-            min2 = theValue;
+            const unsigned short* row = &work_[(std::size_t)(y + 1) * paddedWidth_];
+            for (int x = 0; x < w; ++x)
+               rx[x] = (float)((int)row[x + 2] - (int)row[x]);
+            acc += SumSquares(rx, w);
          }
-         if( max1 < theValue)
+         break;
+      case Tenengrad:
+         for (unsigned y = firstRow; y < endRow; ++y)
          {
-            max2 = max1;
-            max1 = theValue;
+            const unsigned short* up = &work_[(std::size_t)y * paddedWidth_];
+            const unsigned short* mid = up + paddedWidth_;
+            const unsigned short* dn = mid + paddedWidth_;
+            for (int x = 0; x < w; ++x)
+            {
+               rx[x] = (float)(((int)up[x + 2] + 2 * (int)mid[x + 2] + (int)dn[x + 2]) -
+                     ((int)up[x] + 2 * (int)mid[x] + (int)dn[x]));
+               ry[x] = (float)(((int)dn[x] + 2 * (int)dn[x + 1] + (int)dn[x + 2]) -
+                     ((int)up[x] + 2 * (int)up[x + 1] + (int)up[x + 2]));
+            }
+            acc += SumSquares(rx, w) + SumSquares(ry, w);
          }
-         else if (max2 < theValue )
+         break;
+      case Laplacian:
+         for (unsigned y = firstRow; y < endRow; ++y)
          {
-            max2 = theValue;
+            const unsigned short* up = &work_[(std::size_t)y * paddedWidth_];
+            const unsigned short* mid = up + paddedWidth_;
+            const unsigned short* dn = mid + paddedWidth_;
+            for (int x = 0; x < w; ++x)
+               rx[x] = (float)((int)up[x + 1] + (int)dn[x + 1] +
+                     (int)mid[x] + (int)mid[x + 2] - 4 * (int)mid[x + 1]);
+            acc += SumSquares(rx, w);
          }
-      }
-   }
-   /*Edge detection using a 3x3 filter: [-2 -1 0; -1 0 1; 0 1 2]. Then sum all pixel values. Ideally, the sum is large if most edges are sharp*/
-   double sharpness(0.0);
-   for (int k=1; k<width-1; k++) {
-      for (int l=1; l<height-1; l++)
-      {
-         double convolvedValue = -2.0*smoothedImage[k-1 + width*(l-1)] - smoothedImage[k+ width*(l-1)]-smoothedImage[k-1 + width*l]+smoothedImage[k+1 + width*l]+smoothedImage[k+ width*(l+1)]+2.0*smoothedImage[k+1+ width*(l+1)];
-         sharpness = sharpness + convolvedValue*convolvedValue;
-      }
+         break;
+      case NormalizedVariance:
+         break;
    }
-   delete[] smoothedImage;
-   return sharpness;
+   partial.acc = acc;
 }
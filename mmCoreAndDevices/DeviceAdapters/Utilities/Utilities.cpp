@@ -33,6 +33,7 @@
 #include "ModuleInterface.h"
 #include "MMDevice.h"
 
+#include <boost/bind.hpp>
 #include <boost/lexical_cast.hpp>
 
 #include <algorithm>
@@ -74,6 +75,88 @@ inline long Round(double x)
 }
 
 
+namespace {
+
+// The sequence of one physical stage or DA device, as part of the sequence
+// of a logical device
+struct PhysicalSequence
+{
+   explicit PhysicalSequence(MM::Stage* s) : stage(s), da(0), result(DEVICE_OK) {}
+   explicit PhysicalSequence(MM::SignalIO* d) : stage(0), da(d), result(DEVICE_OK) {}
+
+   MM::Device* GetDevice() const
+   { return stage ? static_cast<MM::Device*>(stage) : static_cast<MM::Device*>(da); }
+
+   MM::Stage* stage;
+   MM::SignalIO* da;
+   std::vector<double> values; // positions (um) or voltages
+   int result;
+};
+
+int LoadPhysicalSequence(const PhysicalSequence& sequence)
+{
+   int err;
+   if (sequence.stage)
+   {
+      err = sequence.stage->ClearStageSequence();
+      for (size_t i = 0; err == DEVICE_OK && i < sequence.values.size(); ++i)
+         err = sequence.stage->AddToStageSequence(sequence.values[i]);
+      if (err == DEVICE_OK)
+         err = sequence.stage->SendStageSequence();
+   }
+   else
+   {
+      err = sequence.da->ClearDASequence();
+      for (size_t i = 0; err == DEVICE_OK && i < sequence.values.size(); ++i)
+         err = sequence.da->AddToDASequence(sequence.values[i]);
+      if (err == DEVICE_OK)
+         err = sequence.da->SendDASequence();
+   }
+   return err;
+}
+
+void LoadPhysicalSequences(std::vector<PhysicalSequence*> sequences)
+{
+   for (size_t i = 0; i < sequences.size(); ++i)
+      sequences[i]->result = LoadPhysicalSequence(*sequences[i]);
+}
+
+// Loads the sequences into the devices. Uploads to devices of different
+// device adapters run concurrently, since they usually go through separate
+// ports; devices of the same adapter are loaded one after the other, because
+// adapters expect calls to be serialized.
+int LoadPhysicalSequencesConcurrently(std::vector<PhysicalSequence>& sequences)
+{
+   std::map< std::string, std::vector<PhysicalSequence*> > byModule;
+   for (size_t i = 0; i < sequences.size(); ++i)
+   {
+      char moduleName[MM::MaxStrLength];
+      sequences[i].GetDevice()->GetModuleName(moduleName);
+      byModule[moduleName].push_back(&sequences[i]);
+   }
+
+   boost::thread_group threads;
+   for (std::map< std::string, std::vector<PhysicalSequence*> >::iterator
+         it = byModule.begin(), end = byModule.end(); it != end; ++it)
+   {
+      if (byModule.size() > 1)
+         threads.create_thread(boost::bind(&LoadPhysicalSequences, it->second));
+      else
+         LoadPhysicalSequences(it->second);
+   }
+   threads.join_all();
+
+   for (size_t i = 0; i < sequences.size(); ++i)
+   {
+      if (sequences[i].result != DEVICE_OK)
+         return sequences[i].result;
+   }
+   return DEVICE_OK;
+}
+
+} // anonymous namespace
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // Exported MMDevice API
 ///////////////////////////////////////////////////////////////////////////////
@@ -326,7 +409,82 @@ int MultiShutter::OnState(MM::PropertyBase* pProp, MM::ActionType eAct)
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// Multi Shutter implementation
+// CameraSnapThread implementation
+///////////////////////////////////////////////////////////////////////////////
+CameraSnapThread::CameraSnapThread() :
+   camera_(0),
+   running_(false),
+   snapRequested_(false),
+   snapDone_(false),
+   stopRequested_(false),
+   result_(DEVICE_OK)
+{
+}
+
+CameraSnapThread::~CameraSnapThread()
+{
+   Stop();
+}
+
+void CameraSnapThread::Start()
+{
+   boost::mutex::scoped_lock lock(mutex_);
+   if (!running_)
+   {
+      stopRequested_ = false;
+      thread_ = boost::thread(&CameraSnapThread::Run, this);
+      running_ = true;
+   }
+   snapDone_ = false;
+   snapRequested_ = true;
+   cond_.notify_all();
+}
+
+int CameraSnapThread::Wait()
+{
+   boost::mutex::scoped_lock lock(mutex_);
+   while (!snapDone_)
+      cond_.wait(lock);
+   return result_;
+}
+
+void CameraSnapThread::Stop()
+{
+   {
+      boost::mutex::scoped_lock lock(mutex_);
+      if (!running_)
+         return;
+      stopRequested_ = true;
+      cond_.notify_all();
+   }
+   thread_.join();
+   running_ = false;
+}
+
+void CameraSnapThread::Run()
+{
+   boost::mutex::scoped_lock lock(mutex_);
+   for (;;)
+   {
+      while (!snapRequested_ && !stopRequested_)
+         cond_.wait(lock);
+      if (stopRequested_)
+         return;
+
+      snapRequested_ = false;
+      MM::Camera* camera = camera_;
+      lock.unlock();
+      int ret = camera->SnapImage();
+      lock.lock();
+
+      result_ = ret;
+      snapDone_ = true;
+      cond_.notify_all();
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Multi Camera implementation
 ///////////////////////////////////////////////////////////////////////////////
 MultiCamera::MultiCamera() :
    imageBuffer_(0),
@@ -358,7 +516,10 @@ MultiCamera::~MultiCamera()
 
 int MultiCamera::Shutdown()
 {
+   for (int i = 0; i < MAX_NUMBER_PHYSICAL_CAMERAS; i++)
+      snapThreads_[i].Stop();
    delete imageBuffer_;
+   imageBuffer_ = 0;
    // Rely on the cameras to shut themselves down
    return DEVICE_OK;
 }
@@ -425,20 +586,30 @@ int MultiCamera::SnapImage()
    if (!ImageSizesAreEqual())
       return ERR_NO_EQUAL_SIZE;
 
-   CameraSnapThread t[MAX_NUMBER_PHYSICAL_CAMERAS];
+   bool started[MAX_NUMBER_PHYSICAL_CAMERAS] = { false };
    for (unsigned int i = 0; i < usedCameras_.size(); i++)
    {
       MM::Camera* camera = (MM::Camera*) GetDevice(usedCameras_[i].c_str());
       if (camera != 0) 
       {
-         t[i].SetCamera(camera);
-         t[i].Start();
+         snapThreads_[i].SetCamera(camera);
+         snapThreads_[i].Start();
+         started[i] = true;
       }
    }
-   // I think that the CameraSnapThread destructor waits until the SnapImage function is done
-   // So, we are likely to be waiting here until all cameras are done snapping
 
-   return DEVICE_OK;
+   // Wait for all cameras, even if one of them fails
+   int ret = DEVICE_OK;
+   for (unsigned int i = 0; i < usedCameras_.size(); i++)
+   {
+      if (started[i])
+      {
+         int snapRet = snapThreads_[i].Wait();
+         if (ret == DEVICE_OK)
+            ret = snapRet;
+      }
+   }
+   return ret;
 }
 
 /**
@@ -1388,57 +1559,39 @@ int MultiStage::StopStageSequence()
 
 int MultiStage::ClearStageSequence()
 {
-   int lastErr = DEVICE_OK;
-   for (std::vector<std::string>::iterator it = usedStages_.begin(),
-         end = usedStages_.end();
-         it != end;
-         ++it)
-   {
-      MM::Stage* stage = (MM::Stage*)GetDevice((*it).c_str());
-      if (!stage)
-         continue;
-
-      int err = stage->ClearStageSequence();
-      if (err != DEVICE_OK)
-         lastErr = err;
-   }
-   return lastErr;
+   sequence_.clear();
+   return DEVICE_OK;
 }
 
 
 int MultiStage::AddToStageSequence(double pos)
 {
-   for (unsigned i = 0; i < nrPhysicalStages_; ++i)
-   {
-      MM::Stage* stage = (MM::Stage*)GetDevice(usedStages_[i].c_str());
-      if (!stage)
-         continue;
-
-      double physicalPos = stageScalings_[i] * pos + stageTranslations_[i];
-      int err = stage->AddToStageSequence(physicalPos);
-      if (err != DEVICE_OK)
-         return err;
-   }
+   // Positions are collected here and sent to the physical stages in one go
+   sequence_.push_back(pos);
    return DEVICE_OK;
 }
 
 
 int MultiStage::SendStageSequence()
 {
-   for (std::vector<std::string>::iterator it = usedStages_.begin(),
-         end = usedStages_.end();
-         it != end;
-         ++it)
+   std::vector<PhysicalSequence> sequences;
+   for (unsigned i = 0; i < nrPhysicalStages_; ++i)
    {
-      MM::Stage* stage = (MM::Stage*)GetDevice((*it).c_str());
+      MM::Stage* stage = (MM::Stage*)GetDevice(usedStages_[i].c_str());
       if (!stage)
          continue;
 
-      int err = stage->SendStageSequence();
-      if (err != DEVICE_OK)
-         return err;
+      PhysicalSequence sequence(stage);
+      sequence.values.reserve(sequence_.size());
+      for (size_t j = 0; j < sequence_.size(); ++j)
+         sequence.values.push_back(stageScalings_[i] * sequence_[j] + stageTranslations_[i]);
+      sequences.push_back(sequence);
    }
-   return DEVICE_OK;
+
+   if (sequences.empty())
+      return ERR_NO_PHYSICAL_STAGE;
+
+   return LoadPhysicalSequencesConcurrently(sequences);
 }
 
 
@@ -1917,18 +2070,9 @@ int ComboXYStage::StopXYStageSequence()
 
 int ComboXYStage::ClearXYStageSequence()
 {
-   int lastErr = DEVICE_OK;
-   for (int i = 0; i < 2; ++i)
-   {
-      MM::Stage* stage = (MM::Stage*)GetDevice(usedStages_[i].c_str());
-      if (!stage)
-         continue;
-
-      int err = stage->ClearStageSequence();
-      if (err != DEVICE_OK)
-         lastErr = err;
-   }
-   return lastErr;
+   sequenceX_.clear();
+   sequenceY_.clear();
+   return DEVICE_OK;
 }
 
 
@@ -1940,35 +2084,31 @@ int ComboXYStage::AddToXYStageSequence(double positionX, double positionY)
       if (!stage)
          return ERR_NO_PHYSICAL_STAGE;
    }
-   for (int i = 0; i < 2; ++i)
-   {
-      MM::Stage* stage = (MM::Stage*)GetDevice(usedStages_[i].c_str());
-      const double& logicalPos = (i == 0) ? positionX : positionY;
-      double physicalPos = stageScalings_[i] * logicalPos + stageTranslations_[i];
-      int err = stage->AddToStageSequence(physicalPos);
-      if (err != DEVICE_OK)
-         return err;
-   }
+
+   // Positions are collected here and sent to the physical stages in one go
+   sequenceX_.push_back(positionX);
+   sequenceY_.push_back(positionY);
    return DEVICE_OK;
 }
 
 
 int ComboXYStage::SendXYStageSequence()
 {
+   std::vector<PhysicalSequence> sequences;
    for (int i = 0; i < 2; ++i)
    {
       MM::Stage* stage = (MM::Stage*)GetDevice(usedStages_[i].c_str());
       if (!stage)
          return ERR_NO_PHYSICAL_STAGE;
+
+      const std::vector<double>& logicalPositions = (i == 0) ? sequenceX_ : sequenceY_;
+      PhysicalSequence sequence(stage);
+      sequence.values.reserve(logicalPositions.size());
+      for (size_t j = 0; j < logicalPositions.size(); ++j)
+         sequence.values.push_back(stageScalings_[i] * logicalPositions[j] + stageTranslations_[i]);
+      sequences.push_back(sequence);
    }
-   for (int i = 0; i < 2; ++i)
-   {
-      MM::Stage* stage = (MM::Stage*)GetDevice(usedStages_[i].c_str());
-      int err = stage->SendStageSequence();
-      if (err != DEVICE_OK)
-         return err;
-   }
-   return DEVICE_OK;
+   return LoadPhysicalSequencesConcurrently(sequences);
 }
 
 
@@ -3643,11 +3783,15 @@ int DAXYStage::IsXYStageSequenceable(bool& isSequenceable) const
    if (da_x == 0 || da_y == 0 )
       return ERR_NO_DA_DEVICE;
 
-	bool x, y;
-   da_x->IsDASequenceable(x);
-	da_y->IsDASequenceable(y);
-	isSequenceable = x && y;
-	return DEVICE_OK ;
+   bool x, y;
+   int ret = da_x->IsDASequenceable(x);
+   if (ret != DEVICE_OK)
+      return ret;
+   ret = da_y->IsDASequenceable(y);
+   if (ret != DEVICE_OK)
+      return ret;
+   isSequenceable = x && y;
+   return DEVICE_OK;
 }
 
 int DAXYStage::GetXYStageSequenceMaxLength(long& nrEvents) const
@@ -3666,77 +3810,70 @@ int DAXYStage::GetXYStageSequenceMaxLength(long& nrEvents) const
     return ret;
 }
 
-int DAXYStage::StartXYStageSequence()  
+int DAXYStage::StartXYStageSequence()
 {
    MM::SignalIO* da_x = (MM::SignalIO*) GetDevice(DADeviceNameX_.c_str());
    MM::SignalIO* da_y = (MM::SignalIO*) GetDevice(DADeviceNameY_.c_str());
    if (da_x == 0 || da_y == 0 )
       return ERR_NO_DA_DEVICE;
 
-	int ret = da_x->StartDASequence();
-	if(ret !=DEVICE_OK) return ret;
-	ret = da_y->StartDASequence();
-	if(ret !=DEVICE_OK) return ret;
-   return ret;
+   int ret = da_x->StartDASequence();
+   if (ret != DEVICE_OK)
+      return ret;
+   ret = da_y->StartDASequence();
+   if (ret != DEVICE_OK)
+   {
+      da_x->StopDASequence();
+      return ret;
+   }
+   return DEVICE_OK;
 }
 
-int DAXYStage::StopXYStageSequence()  
+int DAXYStage::StopXYStageSequence()
 {
    MM::SignalIO* da_x = (MM::SignalIO*) GetDevice(DADeviceNameX_.c_str());
    MM::SignalIO* da_y = (MM::SignalIO*) GetDevice(DADeviceNameY_.c_str());
    if (da_x == 0 || da_y == 0 )
       return ERR_NO_DA_DEVICE;
 
-   int ret = da_x->StopDASequence();
-	if(ret !=DEVICE_OK) return ret;
-	ret = da_y->StopDASequence();
-	if(ret !=DEVICE_OK) return ret;
-   return DEVICE_OK;
+   // Try to stop both even after error
+   int retX = da_x->StopDASequence();
+   int retY = da_y->StopDASequence();
+   return (retX != DEVICE_OK) ? retX : retY;
 }
 
-int DAXYStage::ClearXYStageSequence() 
+int DAXYStage::ClearXYStageSequence()
 {
-   MM::SignalIO* da_x = (MM::SignalIO*) GetDevice(DADeviceNameX_.c_str());
-   MM::SignalIO* da_y = (MM::SignalIO*) GetDevice(DADeviceNameY_.c_str());
-   if (da_x == 0 || da_y == 0 )
-      return ERR_NO_DA_DEVICE;
-
-   int ret = da_x->ClearDASequence();
-	if(ret !=DEVICE_OK) return ret;
-	ret = da_y->ClearDASequence();
-	if(ret !=DEVICE_OK) return ret;
+   sequenceX_.clear();
+   sequenceY_.clear();
    return DEVICE_OK;
 }
 
-int DAXYStage::AddToXYStageSequence(double positionX, double positionY) 
+int DAXYStage::AddToXYStageSequence(double positionX, double positionY)
 {
    MM::SignalIO* da_x = (MM::SignalIO*) GetDevice(DADeviceNameX_.c_str());
    MM::SignalIO* da_y = (MM::SignalIO*) GetDevice(DADeviceNameY_.c_str());
    if (da_x == 0 || da_y == 0 )
       return ERR_NO_DA_DEVICE;
 
-   double voltageX, voltageY;
-
-      voltageX = ( (positionX + originPosX_) / (maxStagePosX_ - minStagePosX_)) * 
-                     (maxStageVoltX_ - minStageVoltX_);
-      if (voltageX > maxStageVoltX_)
-         voltageX = maxStageVoltX_;
-      else if (voltageX < minStageVoltX_)
-         voltageX = minStageVoltX_;
-
-      voltageY = ( (positionY + originPosY_) / (maxStagePosY_ - minStagePosY_)) * 
-                     (maxStageVoltY_ - minStageVoltY_);
-      if (voltageY > maxStageVoltY_)
-         voltageY = maxStageVoltY_;
-      else if (voltageY < minStageVoltY_)
-         voltageY = minStageVoltY_;
-   
-   int ret = da_x->AddToDASequence(voltageX);
-   if(ret != DEVICE_OK) return ret;
+   // Same conversion as SetPositionUm(), but clipped to the allowed range
+   double voltageX = ( (positionX - originPosX_) / (maxStagePosX_ - minStagePosX_)) *
+                  (maxStageVoltX_ - minStageVoltX_);
+   if (voltageX > maxStageVoltX_)
+      voltageX = maxStageVoltX_;
+   else if (voltageX < minStageVoltX_)
+      voltageX = minStageVoltX_;
 
-   ret = da_y->AddToDASequence(voltageY);
-   if(ret != DEVICE_OK) return ret;
+   double voltageY = ( (positionY - originPosY_) / (maxStagePosY_ - minStagePosY_)) *
+                  (maxStageVoltY_ - minStageVoltY_);
+   if (voltageY > maxStageVoltY_)
+      voltageY = maxStageVoltY_;
+   else if (voltageY < minStageVoltY_)
+      voltageY = minStageVoltY_;
 
+   // Voltages are collected here and sent to the DA devices in one go
+   sequenceX_.push_back(voltageX);
+   sequenceY_.push_back(voltageY);
    return DEVICE_OK;
 }
 
@@ -3747,10 +3884,12 @@ int DAXYStage::SendXYStageSequence()
    if (da_x == 0 || da_y == 0 )
       return ERR_NO_DA_DEVICE;
 
-   int ret = da_x->SendDASequence();
-   if(ret != DEVICE_OK) return ret;
-   ret = da_y->SendDASequence();
-   return ret;
+   std::vector<PhysicalSequence> sequences;
+   sequences.push_back(PhysicalSequence(da_x));
+   sequences.back().values = sequenceX_;
+   sequences.push_back(PhysicalSequence(da_y));
+   sequences.back().values = sequenceY_;
+   return LoadPhysicalSequencesConcurrently(sequences);
 }
 
 void DAXYStage::UpdateStepSize() 
@@ -27,6 +27,9 @@
 #include "MMDevice.h"
 #include "DeviceBase.h"
 #include "ImgBuffer.h"
+
+#include <boost/thread.hpp>
+
 #include <string>
 #include <map>
 
@@ -98,27 +101,38 @@ private:
 };
 
 /**
- * CameraSnapThread: helper thread for MultiCamera
+ * CameraSnapThread: persistent helper thread for MultiCamera that snaps one
+ * physical camera on request, so that no thread is created per snap
  */
-class CameraSnapThread : public MMDeviceThreadBase
+class CameraSnapThread
 {
    public:
-      CameraSnapThread() :
-         camera_(0),
-         started_(false)
-      {}
-
-      ~CameraSnapThread() { if (started_) wait(); }
+      CameraSnapThread();
+      ~CameraSnapThread();
 
       void SetCamera(MM::Camera* camera) { camera_ = camera; }
 
-      int svc() { camera_->SnapImage(); return 0; }
-
-      void Start() { activate(); started_ = true; }
+      // Request a snap; the thread is launched on first use
+      void Start();
+      // Wait for the requested snap to finish and return its result
+      int Wait();
+      void Stop();
 
    private:
+      CameraSnapThread(const CameraSnapThread&);
+      CameraSnapThread& operator=(const CameraSnapThread&);
+
+      void Run();
+
       MM::Camera* camera_;
-      bool started_;
+      boost::mutex mutex_;
+      boost::condition_variable cond_;
+      boost::thread thread_;
+      bool running_;
+      bool snapRequested_;
+      bool snapDone_;
+      bool stopRequested_;
+      int result_;
 };
 
 /*
@@ -169,6 +183,7 @@ private:
    int Logical2Physical(int logical);
    bool ImageSizesAreEqual();
    unsigned char* imageBuffer_;
+   CameraSnapThread snapThreads_[MAX_NUMBER_PHYSICAL_CAMERAS];
 
    std::vector<std::string> availableCameras_;
    std::vector<std::string> usedCameras_;
@@ -235,6 +250,8 @@ private:
    std::vector<std::string> usedStages_;
    std::vector<double> stageScalings_;
    std::vector<double> stageTranslations_;
+
+   std::vector<double> sequence_; // logical positions, sent on SendStageSequence()
 };
 
 
@@ -294,6 +311,10 @@ private:
    std::vector<std::string> usedStages_;
    std::vector<double> stageScalings_;
    std::vector<double> stageTranslations_;
+
+   // logical positions, sent on SendXYStageSequence()
+   std::vector<double> sequenceX_;
+   std::vector<double> sequenceY_;
 };
 
 
@@ -492,9 +513,7 @@ private:
 
 // DAXYStage 
 
-class DAXYStage :
-	/*public MM::SequenceableXYStage,*/
-	public CXYStageBase<DAXYStage>
+class DAXYStage : public CXYStageBase<DAXYStage>
 {
 public:
    DAXYStage();
@@ -577,6 +596,9 @@ private:
    double stepSizeXUm_;
    double stepSizeYUm_;
 
+   // voltages, sent on SendXYStageSequence()
+   std::vector<double> sequenceX_;
+   std::vector<double> sequenceY_;
 };
 
 
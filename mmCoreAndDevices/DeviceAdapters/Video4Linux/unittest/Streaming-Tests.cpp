@@ -0,0 +1,543 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          Streaming-Tests.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     DeviceAdapters
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Tests of the video4linux2 streaming pipeline, run against an
+//                in-memory video device
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include <gtest/gtest.h>
+
+#include "video4linux2.h"
+
+#include <algorithm>
+#include <set>
+#include <time.h>
+
+
+namespace {
+
+class Lock
+{
+   pthread_mutex_t& mutex_;
+public:
+   explicit Lock(pthread_mutex_t& mutex) : mutex_(mutex)
+   { pthread_mutex_lock(&mutex_); }
+   ~Lock() { pthread_mutex_unlock(&mutex_); }
+};
+
+} // anonymous namespace
+
+
+// A capture device whose buffers live in memory. A frame is "captured" when
+// the adapter waits for one and the adapter has handed back all buffers, as
+// with a camera slower than the conversion. Free running, it is captured as
+// soon as any buffer is queued. Luma samples of a frame hold its sequence
+// number; line padding is 0xee.
+class FakeVideoDevice : public VideoDeviceIo
+{
+public:
+   static const int FD = 42;
+
+   FakeVideoDevice(unsigned width, unsigned height, unsigned bytesPerLine) :
+      width_(width),
+      height_(height),
+      bytesPerLine_(bytesPerLine),
+      sequenceStep_(1),
+      nextSequence_(0),
+      freeRunning_(false),
+      streaming_(false)
+   {
+      pthread_mutex_init(&mutex_, 0);
+   }
+
+   ~FakeVideoDevice() { pthread_mutex_destroy(&mutex_); }
+
+   // Numbers frames in steps of n, as a driver does that drops n - 1 frames
+   // between each pair it delivers
+   void SetSequenceStep(unsigned n) { Lock lock(mutex_); sequenceStep_ = n; }
+
+   void SetFreeRunning(bool flag) { Lock lock(mutex_); freeRunning_ = flag; }
+
+   size_t BuffersQueued() { Lock lock(mutex_); return queued_.size() + filled_.size(); }
+
+   int Open(const char*) { return FD; }
+   int Close(int) { return 0; }
+
+   int Ioctl(int fd, unsigned long request, void* parameter)
+   {
+      if (fd != FD)
+         return Fail(EBADF);
+      Lock lock(mutex_);
+      switch (request)
+      {
+         case VIDIOC_QUERYCAP:
+         {
+            struct v4l2_capability* cap = static_cast<v4l2_capability*>(parameter);
+            memset(cap, 0, sizeof(*cap));
+            cap->capabilities = V4L2_CAP_VIDEO_CAPTURE | V4L2_CAP_STREAMING;
+            return 0;
+         }
+         case VIDIOC_S_FMT:
+         {
+            struct v4l2_format* fmt = static_cast<v4l2_format*>(parameter);
+            if (fmt->fmt.pix.pixelformat != V4L2_PIX_FMT_YUYV)
+               return Fail(EINVAL);
+            fmt->fmt.pix.width = width_;
+            fmt->fmt.pix.height = height_;
+            fmt->fmt.pix.bytesperline = bytesPerLine_;
+            fmt->fmt.pix.sizeimage = FrameSize();
+            return 0;
+         }
+         case VIDIOC_REQBUFS:
+         {
+            struct v4l2_requestbuffers* req = static_cast<v4l2_requestbuffers*>(parameter);
+            if (req->memory != V4L2_MEMORY_MMAP)
+               return Fail(EINVAL);
+            buffers_.assign(req->count, std::vector<unsigned char>(FrameSize()));
+            queued_.clear();
+            filled_.clear();
+            return 0;
+         }
+         case VIDIOC_QUERYBUF:
+         {
+            struct v4l2_buffer* buf = static_cast<v4l2_buffer*>(parameter);
+            if (buf->index >= buffers_.size())
+               return Fail(EINVAL);
+            buf->length = FrameSize();
+            buf->m.offset = buf->index * FrameSize();
+            return 0;
+         }
+         case VIDIOC_QBUF:
+         {
+            struct v4l2_buffer* buf = static_cast<v4l2_buffer*>(parameter);
+            if (buf->index >= buffers_.size() || IsQueued(buf->index))
+               return Fail(EINVAL);
+            queued_.push_back(buf->index);
+            return 0;
+         }
+         case VIDIOC_DQBUF:
+         {
+            if (filled_.empty())
+               Capture();
+            if (filled_.empty())
+               return Fail(EAGAIN);
+            *static_cast<v4l2_buffer*>(parameter) = filled_.front();
+            filled_.pop_front();
+            return 0;
+         }
+         case VIDIOC_STREAMON:
+            streaming_ = true;
+            return 0;
+         case VIDIOC_STREAMOFF:
+            streaming_ = false;
+            return 0;
+         default:
+            return Fail(EINVAL);
+      }
+   }
+
+   void* Map(size_t length, int fd, off_t offset)
+   {
+      Lock lock(mutex_);
+      size_t index = offset / FrameSize();
+      if (fd != FD || length != FrameSize() || index >= buffers_.size())
+         return MAP_FAILED;
+      return &buffers_[index][0];
+   }
+
+   int Unmap(void*, size_t) { return 0; }
+
+   int WaitReadable(int, long)
+   {
+      {
+         Lock lock(mutex_);
+         if (filled_.empty())
+            Capture();
+         if (!filled_.empty())
+            return 1;
+      }
+      // All buffers are with the adapter; don't spin
+      usleep(1000);
+      return 0;
+   }
+
+private:
+   static int Fail(int error) { errno = error; return -1; }
+
+   size_t FrameSize() const { return bytesPerLine_ * height_; }
+
+   bool IsQueued(unsigned index) const
+   {
+      if (std::find(queued_.begin(), queued_.end(), index) != queued_.end())
+         return true;
+      for (size_t i = 0; i < filled_.size(); ++i)
+         if (filled_[i].index == index)
+            return true;
+      return false;
+   }
+
+   void Capture()
+   {
+      if (!streaming_ || queued_.empty())
+         return;
+      if (!freeRunning_ && queued_.size() < buffers_.size())
+         return;
+      unsigned index = queued_.front();
+      queued_.pop_front();
+      unsigned sequence = nextSequence_;
+      nextSequence_ += sequenceStep_;
+
+      std::vector<unsigned char>& frame = buffers_[index];
+      for (unsigned y = 0; y < height_; ++y)
+      {
+         unsigned char* line = &frame[y * bytesPerLine_];
+         for (unsigned x = 0; x < bytesPerLine_; ++x)
+         {
+            if (x >= 2 * width_)
+               line[x] = 0xee;
+            else
+               line[x] = (x % 2 == 0) ? (unsigned char) sequence : 128;
+         }
+      }
+
+      struct v4l2_buffer buf;
+      memset(&buf, 0, sizeof(buf));
+      buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+      buf.memory = V4L2_MEMORY_MMAP;
+      buf.index = index;
+      buf.bytesused = (unsigned) FrameSize();
+      buf.sequence = sequence;
+      filled_.push_back(buf);
+   }
+
+   const unsigned width_;
+   const unsigned height_;
+   const unsigned bytesPerLine_;
+   pthread_mutex_t mutex_;
+   std::vector< std::vector<unsigned char> > buffers_;
+   std::deque<unsigned> queued_;
+   std::deque<struct v4l2_buffer> filled_;
+   unsigned sequenceStep_;
+   unsigned nextSequence_;
+   bool freeRunning_;
+   bool streaming_;
+};
+
+
+// Collects the images the camera inserts. Inserts listed with
+// RejectInsert() fail with DEVICE_BUFFER_OVERFLOW, as the core does when its
+// buffer is full under the default overflow policy.
+class FakeCore : public MM::Core
+{
+public:
+   struct Frame
+   {
+      std::vector<unsigned char> pixels;
+      unsigned width, height, byteDepth;
+      std::string sequence;
+   };
+
+   FakeCore() :
+      insertDelayUs_(0),
+      inserts_(0),
+      clears_(0),
+      finished_(false),
+      finishedStatus_(DEVICE_OK)
+   {
+      pthread_mutex_init(&mutex_, 0);
+      pthread_cond_init(&cond_, 0);
+   }
+
+   ~FakeCore()
+   {
+      pthread_cond_destroy(&cond_);
+      pthread_mutex_destroy(&mutex_);
+   }
+
+   void RejectInsert(unsigned n) { Lock lock(mutex_); rejected_.insert(n); }
+   void SetInsertDelayUs(unsigned delay) { Lock lock(mutex_); insertDelayUs_ = delay; }
+
+   // Returns the status passed to AcqFinished(), or -1 on timeout
+   int WaitForAcqFinished()
+   {
+      Lock lock(mutex_);
+      struct timespec deadline;
+      clock_gettime(CLOCK_REALTIME, &deadline);
+      deadline.tv_sec += 10;
+      while (!finished_)
+      {
+         if (pthread_cond_timedwait(&cond_, &mutex_, &deadline) == ETIMEDOUT)
+            return -1;
+      }
+      return finishedStatus_;
+   }
+
+   unsigned Inserts() { Lock lock(mutex_); return inserts_; }
+   unsigned Clears() { Lock lock(mutex_); return clears_; }
+   std::vector<Frame> Frames() { Lock lock(mutex_); return frames_; }
+
+   int PrepareForAcq(const MM::Device*)
+   {
+      Lock lock(mutex_);
+      finished_ = false;
+      return DEVICE_OK;
+   }
+
+   int AcqFinished(const MM::Device*, int statusCode)
+   {
+      Lock lock(mutex_);
+      finished_ = true;
+      finishedStatus_ = statusCode;
+      pthread_cond_broadcast(&cond_);
+      return DEVICE_OK;
+   }
+
+   int InsertImage(const MM::Device*, const MM::ImageWriter& writer,
+         unsigned width, unsigned height, unsigned byteDepth,
+         unsigned, const Metadata* md)
+   {
+      Lock lock(mutex_);
+      if (insertDelayUs_ > 0)
+         usleep(insertDelayUs_);
+      if (rejected_.count(++inserts_))
+         return DEVICE_BUFFER_OVERFLOW;
+      Frame frame;
+      frame.pixels.resize(width * height * byteDepth);
+      writer.WriteImage(&frame.pixels[0]);
+      frame.width = width;
+      frame.height = height;
+      frame.byteDepth = byteDepth;
+      if (md && const_cast<Metadata*>(md)->HasTag("V4L2-Sequence"))
+         frame.sequence = md->GetSingleTag("V4L2-Sequence").GetValue();
+      frames_.push_back(frame);
+      return DEVICE_OK;
+   }
+
+   void ClearImageBuffer(const MM::Device*)
+   {
+      Lock lock(mutex_);
+      ++clears_;
+      frames_.clear();
+   }
+
+   int LogMessage(const MM::Device*, const char*, bool) const { return DEVICE_OK; }
+   int OnPropertiesChanged(const MM::Device*) { return DEVICE_OK; }
+   int OnPropertyChanged(const MM::Device*, const char*, const char*) { return DEVICE_OK; }
+   int OnExposureChanged(const MM::Device*, double) { return DEVICE_OK; }
+   unsigned long GetClockTicksUs(const MM::Device*) { return 0; }
+   MM::MMTime GetCurrentMMTime() { return MM::MMTime(); }
+   unsigned long long GetMonotonicTimeNs() { return 0; }
+
+   // Not used by the camera
+   MM::Device* GetDevice(const MM::Device*, const char*) { return 0; }
+   int GetDeviceProperty(const char*, const char*, char*) { return DEVICE_ERR; }
+   int SetDeviceProperty(const char*, const char*, const char*) { return DEVICE_ERR; }
+   void GetLoadedDeviceOfType(const MM::Device*, MM::DeviceType, char* name, const unsigned int) { name[0] = 0; }
+   int SetSerialProperties(const char*, const char*, const char*, const char*, const char*, const char*, const char*) { return DEVICE_ERR; }
+   int SetSerialCommand(const MM::Device*, const char*, const char*, const char*) { return DEVICE_ERR; }
+   int GetSerialAnswer(const MM::Device*, const char*, unsigned long, char*, const char*) { return DEVICE_ERR; }
+   int WriteToSerial(const MM::Device*, const char*, const unsigned char*, unsigned long) { return DEVICE_ERR; }
+   int ReadFromSerial(const MM::Device*, const char*, unsigned char*, unsigned long, unsigned long&) { return DEVICE_ERR; }
+   int PurgeSerial(const MM::Device*, const char*) { return DEVICE_ERR; }
+   MM::PortType GetSerialPortType(const char*) const { return MM::InvalidPort; }
+   int OnStagePositionChanged(const MM::Device*, double) { return DEVICE_OK; }
+   int OnXYStagePositionChanged(const MM::Device*, double, double) { return DEVICE_OK; }
+   int OnSLMExposureChanged(const MM::Device*, double) { return DEVICE_OK; }
+   int OnMagnifierChanged(const MM::Device*) { return DEVICE_OK; }
+   int InsertImage(const MM::Device*, const ImgBuffer&) { return DEVICE_ERR; }
+   int InsertImage(const MM::Device*, const unsigned char*, unsigned, unsigned, unsigned, unsigned, const char*, const bool) { return DEVICE_ERR; }
+   int InsertImage(const MM::Device*, const unsigned char*, unsigned, unsigned, unsigned, const Metadata*, const bool) { return DEVICE_ERR; }
+   int InsertImage(const MM::Device*, const unsigned char*, unsigned, unsigned, unsigned, const char*, const bool) { return DEVICE_ERR; }
+   bool InitializeImageBuffer(unsigned, unsigned, unsigned int, unsigned int, unsigned int) { return false; }
+   int InsertMultiChannel(const MM::Device*, const unsigned char*, unsigned, unsigned, unsigned, unsigned, Metadata*) { return DEVICE_ERR; }
+   const char* GetImage() { return 0; }
+   int GetImageDimensions(int&, int&, int&) { return DEVICE_ERR; }
+   int GetFocusPosition(double&) { return DEVICE_ERR; }
+   int SetFocusPosition(double) { return DEVICE_ERR; }
+   int MoveFocus(double) { return DEVICE_ERR; }
+   int SetXYPosition(double, double) { return DEVICE_ERR; }
+   int GetXYPosition(double&, double&) { return DEVICE_ERR; }
+   int MoveXYStage(double, double) { return DEVICE_ERR; }
+   int SetExposure(double) { return DEVICE_ERR; }
+   int GetExposure(double&) { return DEVICE_ERR; }
+   int SetConfig(const char*, const char*) { return DEVICE_ERR; }
+   int GetCurrentConfig(const char*, int, char*) { return DEVICE_ERR; }
+   int GetCurrentConfigFromCache(const char*, int, char*) { return DEVICE_ERR; }
+   int GetChannelConfig(char*, const unsigned int) { return DEVICE_ERR; }
+   MM::ImageProcessor* GetImageProcessor(const MM::Device*) { return 0; }
+   MM::AutoFocus* GetAutoFocus(const MM::Device*) { return 0; }
+   MM::Hub* GetParentHub(const MM::Device*) const { return 0; }
+   MM::State* GetStateDevice(const MM::Device*, const char*) { return 0; }
+   MM::SignalIO* GetSignalIODevice(const MM::Device*, const char*) { return 0; }
+   void NextPostedError(int&, char*, int, int&) {}
+   void PostError(const int, const char*) {}
+   void ClearPostedErrors() {}
+
+private:
+   pthread_mutex_t mutex_;
+   pthread_cond_t cond_;
+   std::set<unsigned> rejected_;
+   unsigned insertDelayUs_;
+   unsigned inserts_;
+   unsigned clears_;
+   std::vector<Frame> frames_;
+   bool finished_;
+   int finishedStatus_;
+};
+
+
+const unsigned WIDTH = 8;
+const unsigned HEIGHT = 4;
+const unsigned BYTES_PER_LINE = 20; // padded from 16
+
+class StreamingTest : public ::testing::Test
+{
+protected:
+   StreamingTest() :
+      device_(WIDTH, HEIGHT, BYTES_PER_LINE),
+      camera_(device_)
+   {}
+
+   virtual void SetUp()
+   {
+      camera_.SetCallback(&core_);
+      ASSERT_EQ(DEVICE_OK, camera_.Initialize());
+      ASSERT_EQ(DEVICE_OK, camera_.SetProperty(MM::g_Keyword_PixelType,
+            PixelType8Bit::PROPERTY_VALUE.c_str()));
+   }
+
+   virtual void TearDown()
+   {
+      camera_.Shutdown();
+   }
+
+   // Runs a sequence to its end and returns the acquisition's status
+   int RunSequence(long numImages, bool stopOnOverflow)
+   {
+      int ret = camera_.StartSequenceAcquisition(numImages, 0.0, stopOnOverflow);
+      if (ret != DEVICE_OK)
+         return ret;
+      int status = core_.WaitForAcqFinished();
+      camera_.StopSequenceAcquisition();
+      return status;
+   }
+
+   long GetCounter(const char* name)
+   {
+      char value[MM::MaxStrLength];
+      EXPECT_EQ(DEVICE_OK, camera_.GetProperty(name, value));
+      return atol(value);
+   }
+
+   FakeVideoDevice device_;
+   FakeCore core_;
+   V4L2 camera_;
+};
+
+
+TEST_F(StreamingTest, InsertsConvertedFramesInOrder)
+{
+   ASSERT_EQ(DEVICE_OK, RunSequence(5, false));
+   EXPECT_FALSE(camera_.IsCapturing());
+
+   std::vector<FakeCore::Frame> frames = core_.Frames();
+   ASSERT_EQ(5u, frames.size());
+   for (size_t i = 0; i < frames.size(); ++i)
+   {
+      EXPECT_EQ(WIDTH, frames[i].width);
+      EXPECT_EQ(HEIGHT, frames[i].height);
+      EXPECT_EQ(1u, frames[i].byteDepth);
+      EXPECT_EQ(CDeviceUtils::ConvertToString((long) i), frames[i].sequence);
+      // Luma only; the line padding must not end up in the image
+      std::vector<unsigned char> expected(WIDTH * HEIGHT, (unsigned char) i);
+      EXPECT_EQ(expected, frames[i].pixels);
+   }
+
+   EXPECT_GE(GetCounter(gPropertyFramesCaptured), 5);
+   EXPECT_EQ(0, GetCounter(gPropertyFramesDroppedByDriver));
+}
+
+TEST_F(StreamingTest, ReturnsAllBuffersToTheDriver)
+{
+   ASSERT_EQ(DEVICE_OK, RunSequence(10, false));
+   EXPECT_EQ((size_t) gBufferCountDefault, device_.BuffersQueued());
+}
+
+TEST_F(StreamingTest, ClearsBufferOnOverflowUnlessAskedToStop)
+{
+   core_.RejectInsert(2);
+   ASSERT_EQ(DEVICE_OK, RunSequence(5, false));
+   // The rejected frame is inserted again once the buffer is cleared
+   EXPECT_EQ(1u, core_.Clears());
+   EXPECT_EQ(6u, core_.Inserts());
+   std::vector<FakeCore::Frame> frames = core_.Frames();
+   ASSERT_EQ(4u, frames.size());
+   EXPECT_EQ("1", frames[0].sequence);
+   EXPECT_EQ("4", frames[3].sequence);
+   EXPECT_EQ((size_t) gBufferCountDefault, device_.BuffersQueued());
+}
+
+TEST_F(StreamingTest, StopsOnOverflowWhenAsked)
+{
+   core_.RejectInsert(2);
+   EXPECT_EQ(DEVICE_BUFFER_OVERFLOW, RunSequence(5, true));
+   EXPECT_FALSE(camera_.IsCapturing());
+   EXPECT_EQ(2u, core_.Inserts());
+   EXPECT_EQ(0u, core_.Clears());
+   EXPECT_EQ(1u, core_.Frames().size());
+   EXPECT_EQ((size_t) gBufferCountDefault, device_.BuffersQueued());
+}
+
+TEST_F(StreamingTest, CountsFramesDroppedByDriver)
+{
+   device_.SetSequenceStep(3);
+   ASSERT_EQ(DEVICE_OK, RunSequence(5, false));
+   long captured = GetCounter(gPropertyFramesCaptured);
+   ASSERT_GE(captured, 5);
+   EXPECT_EQ(2 * (captured - 1), GetCounter(gPropertyFramesDroppedByDriver));
+}
+
+TEST_F(StreamingTest, DropsOldestFramesWhenConversionFallsBehind)
+{
+   device_.SetFreeRunning(true);
+   core_.SetInsertDelayUs(5000);
+   ASSERT_EQ(DEVICE_OK, RunSequence(5, false));
+   EXPECT_GT(GetCounter(gPropertyFramesDroppedByAdapter), 0);
+   EXPECT_EQ(0, GetCounter(gPropertyFramesDroppedByDriver));
+
+   std::vector<FakeCore::Frame> frames = core_.Frames();
+   ASSERT_EQ(5u, frames.size());
+   for (size_t i = 1; i < frames.size(); ++i)
+      EXPECT_LT(atol(frames[i - 1].sequence.c_str()), atol(frames[i].sequence.c_str()));
+   EXPECT_EQ((size_t) gBufferCountDefault, device_.BuffersQueued());
+}
+
+TEST_F(StreamingTest, CanRestartAfterSequenceEnds)
+{
+   ASSERT_EQ(DEVICE_OK, RunSequence(3, false));
+   ASSERT_EQ(DEVICE_OK, RunSequence(3, false));
+   EXPECT_EQ(6u, core_.Frames().size());
+}
+
+
+int main(int argc, char **argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
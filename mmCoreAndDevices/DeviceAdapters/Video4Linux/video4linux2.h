@@ -0,0 +1,1158 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          video4linux2.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     DeviceAdapters
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   video4linux2 camera device adapter. Declarations are kept
+//                here so that the streaming pipeline can be unit tested
+//                against a fake VideoDeviceIo; see video4linux2.cpp.
+//
+// LICENSE:       This file is distributed under the "LGPL" license.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#ifndef _VIDEO4LINUX2_H_
+#define _VIDEO4LINUX2_H_
+
+#include <iostream>
+#include <string>
+#include <math.h>
+#include "MMDevice.h"
+#include "DeviceBase.h"
+#include "ModuleInterface.h"
+#include "ImgBuffer.h"
+#include "PixelConvert.h"
+#include <sstream>
+#include <map>
+#include <vector>
+#include <deque>
+#include <climits>
+
+#include <sys/ioctl.h>
+#include <linux/videodev2.h>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <assert.h>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <sys/mman.h>
+#include <sys/select.h>
+
+#include <pthread.h>
+
+using namespace std;
+
+extern const char
+  *gName,
+  *gDescription,
+  *gPropertyDevicePath,
+  *gPropertyDevicePathDefault,
+  *gPropertyNameResolution,
+  *gResolutionDefault,
+  *gPropertyBufferCount,
+  *gPropertyFramesCaptured,
+  *gPropertyFramesDroppedByDriver,
+  *gPropertyFramesDroppedByAdapter;
+
+const long gWidthDefault = 640,
+           gHeightDefault = 480,
+           gBufferCountDefault = 4,
+           gBufferCountMin = 2,
+           gBufferCountMax = 32;
+
+struct VidBuffer {
+  void *start;
+  size_t length;
+};
+
+// v4l2 state
+typedef struct State State;
+struct State {
+  int W, H, fd;
+  unsigned bytesPerLine;
+  struct VidBuffer *buffers;
+  unsigned int buffers_count;
+  struct v4l2_buffer *buf;
+};
+
+class PixelType {
+  public:
+    PixelType(string propertyValue, unsigned bytesPerPixel, unsigned numberOfComponents, unsigned bitDepth) :
+      m_propertyValue(propertyValue),
+      m_bytesPerPixel(bytesPerPixel),
+      m_numberOfComponents(numberOfComponents),
+      m_bitDepth(bitDepth) {
+      }
+
+    string GetPropertyValue() const { return m_propertyValue; }
+    unsigned GetImageBytesPerPixel() const { return m_bytesPerPixel; }
+    unsigned GetNumberOfComponents() const { return m_numberOfComponents; }
+    unsigned GetBitDepth() const { return m_bitDepth; }
+
+    virtual void convertV4l2ToOutput(const PixelConverter& converter,
+        State *state, unsigned char* in, unsigned char* output) const = 0;
+  private:
+    string m_propertyValue;
+    unsigned m_bytesPerPixel;
+    unsigned m_numberOfComponents;
+    unsigned m_bitDepth;
+};
+
+class PixelType8Bit : public PixelType {
+  public:
+    static string PROPERTY_VALUE;
+
+    PixelType8Bit() :
+      PixelType(PROPERTY_VALUE, 1, 1, 8) {
+      }
+
+    virtual void convertV4l2ToOutput(const PixelConverter& converter,
+        State *state, unsigned char* in, unsigned char* output) const {
+      // Luma channel of YUYV
+      converter.YUYVToGray8(output, in, state->W, state->H, state->bytesPerLine);
+    }
+};
+extern PixelType8Bit PIXELTYPE_8BIT;
+
+class PixelTypeYUYV : public PixelType {
+  public:
+    static string PROPERTY_VALUE;
+
+    PixelTypeYUYV() :
+      PixelType(PROPERTY_VALUE, 4, 4, 8) {
+      }
+
+    virtual void convertV4l2ToOutput(const PixelConverter& converter,
+        State *state, unsigned char* ptrIn, unsigned char* ptrOut) const {
+      /* Convert YUYV to RGBA32, apparently mm does only display colors
+       * in this format */
+      converter.YUYVToRGB32(ptrOut, ptrIn, state->W, state->H, state->bytesPerLine);
+    }
+};
+extern PixelTypeYUYV PIXELTYPE_YUYV;
+
+/* All access to the device goes through this interface, so that the
+ * capture pipeline can also be run against a fake device. For testing
+ * without a camera, the kernel's vivid driver provides virtual capture
+ * devices (modprobe vivid, then set DevicePath to its /dev/videoN). */
+class VideoDeviceIo {
+  public:
+    virtual ~VideoDeviceIo() {}
+    virtual int Open(const char* path) = 0;
+    virtual int Close(int fd) = 0;
+    virtual int Ioctl(int fd, unsigned long request, void* parameter) = 0;
+    virtual void* Map(size_t length, int fd, off_t offset) = 0;
+    virtual int Unmap(void* start, size_t length) = 0;
+    // Like select(): > 0 when a buffer can be dequeued, 0 on timeout
+    virtual int WaitReadable(int fd, long timeoutMs) = 0;
+};
+
+class SystemVideoDeviceIo : public VideoDeviceIo {
+  public:
+    int Open(const char* path) { return open(path, O_RDWR); }
+    int Close(int fd) { return close(fd); }
+    int Ioctl(int fd, unsigned long request, void* parameter) {
+      return ioctl(fd, request, parameter);
+    }
+    void* Map(size_t length, int fd, off_t offset) {
+      return mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, offset);
+    }
+    int Unmap(void* start, size_t length) { return munmap(start, length); }
+    int WaitReadable(int fd, long timeoutMs) {
+      fd_set fds;
+      FD_ZERO(&fds);
+      FD_SET(fd, &fds);
+      struct timeval tv;
+      tv.tv_sec = timeoutMs / 1000;
+      tv.tv_usec = (timeoutMs % 1000) * 1000;
+      return select(fd + 1, &fds, NULL, NULL, &tv);
+    }
+};
+extern SystemVideoDeviceIo SYSTEM_VIDEO_DEVICE_IO;
+
+/* Converts a mapped driver buffer straight into the core's buffer */
+class FrameWriter : public MM::ImageWriter {
+  public:
+    FrameWriter(const PixelType& pixelType, const PixelConverter& converter,
+        State* state, unsigned char* data) :
+      m_pixelType(pixelType),
+      m_converter(converter),
+      m_state(state),
+      m_data(data) {
+      }
+
+    void WriteImage(unsigned char* dest) const {
+      m_pixelType.convertV4l2ToOutput(m_converter, m_state, m_data, dest);
+    }
+
+  private:
+    const PixelType& m_pixelType;
+    const PixelConverter& m_converter;
+    State* m_state;
+    unsigned char* m_data;
+};
+
+class V4L2;
+
+/* Runs one of the loops of the streaming pipeline */
+class StreamThread : public MMDeviceThreadBase {
+  public:
+    typedef int (V4L2::*Loop)();
+
+    StreamThread(V4L2* camera, Loop loop) :
+      m_camera(camera),
+      m_loop(loop) {
+      }
+
+    int svc();
+
+  private:
+    V4L2* m_camera;
+    Loop m_loop;
+};
+
+class V4L2 : public CCameraBase<V4L2>
+{
+public:
+
+  // set all variables to default values, create only necessary device
+  // properties we need for defining initialisation parameters, do as
+  // little as possible, don't access hardware, do everything else in
+  // Initialize()
+  explicit V4L2(VideoDeviceIo& io = SYSTEM_VIDEO_DEVICE_IO) :
+    io_(&io),
+    pixelType(&PIXELTYPE_8BIT),
+    bufferCount_(gBufferCountDefault),
+    captureThread_(this, &V4L2::CaptureLoop),
+    conversionThread_(this, &V4L2::ConversionLoop),
+    streaming_(false),
+    stopStreaming_(false),
+    streamThreadsRunning_(false),
+    stopOnOverflow_(false),
+    streamStatus_(DEVICE_OK),
+    imagesToAcquire_(0),
+    imagesAcquired_(0),
+    framesCaptured_(0),
+    framesDroppedByDriver_(0),
+    framesDroppedByAdapter_(0),
+    haveSequence_(false),
+    lastSequence_(0)
+  {
+    initialized_ = 0;
+    pixelConverter.SetThreadCount(PixelConverter::GetProcessorCount());
+    pthread_mutex_init(&streamMutex_, NULL);
+    pthread_cond_init(&streamCond_, NULL);
+  }
+
+  // Shutdown is always called before destructor, in any case release
+  // all resources even if Shutdown wasn't called
+  ~V4L2()
+  {
+    Shutdown();
+    pthread_cond_destroy(&streamCond_);
+    pthread_mutex_destroy(&streamMutex_);
+  }
+
+  // access hardware, create device properties
+  int Initialize()
+  {
+    if(initialized_)
+      return DEVICE_OK;
+    LogMessage("initializing device driver");
+
+    CreateProperty(MM::g_Keyword_Name, gName, MM::String, true);
+
+    CreateProperty(MM::g_Keyword_Description, gDescription, MM::String, true);
+
+    // Device Path
+    CPropertyAction* pAct = new CPropertyAction(this, &V4L2::OnDevicePath);
+    int nRet = CreateProperty(
+        gPropertyDevicePath, gPropertyDevicePathDefault, MM::String, false, pAct);
+    if (nRet != DEVICE_OK)
+      return nRet;
+
+    // Resolution
+    pAct = new CPropertyAction(this, &V4L2::OnResolutionChange);
+    nRet = CreateProperty(
+        gPropertyNameResolution, gResolutionDefault, MM::String, false, pAct);
+    if (nRet != DEVICE_OK)
+      return nRet;
+
+    // Binning
+    pAct = new CPropertyAction(this, &V4L2::OnBinning);
+    nRet = CreateProperty(MM::g_Keyword_Binning, "1", MM::Integer, false, pAct);
+    if (nRet != DEVICE_OK)
+      return nRet;
+
+    // Pixel type
+    pAct = new CPropertyAction(this, &V4L2::OnPixelType);
+    nRet = CreateProperty(MM::g_Keyword_PixelType,
+			  PixelTypeYUYV::PROPERTY_VALUE.c_str(), MM::String, false, pAct);
+    if (nRet != DEVICE_OK)
+       return nRet;
+
+    vector<string> pixTypes;
+    pixTypes.push_back(PixelType8Bit::PROPERTY_VALUE);
+    pixTypes.push_back(PixelTypeYUYV::PROPERTY_VALUE);
+    nRet = SetAllowedValues(MM::g_Keyword_PixelType, pixTypes);
+    if (nRet != DEVICE_OK)
+       return nRet;
+
+    // Gain
+    pAct = new CPropertyAction(this, &V4L2::OnGain);
+    nRet = CreateProperty(MM::g_Keyword_Gain,
+			  "0", MM::Integer, false, pAct);
+    assert(nRet == DEVICE_OK);
+
+    // Exposure
+    pAct = new CPropertyAction(this, &V4L2::OnExposure);
+    nRet = CreateProperty(MM::g_Keyword_Exposure, "0.0", MM::Float, false, pAct);
+    assert(nRet == DEVICE_OK);
+
+    // Number of driver buffers; more buffers absorb longer conversion stalls
+    // during sequence acquisition
+    pAct = new CPropertyAction(this, &V4L2::OnBufferCount);
+    nRet = CreateProperty(gPropertyBufferCount,
+        CDeviceUtils::ConvertToString(gBufferCountDefault), MM::Integer, false, pAct);
+    if (nRet != DEVICE_OK)
+      return nRet;
+    SetPropertyLimits(gPropertyBufferCount, gBufferCountMin, gBufferCountMax);
+
+    // Counters of the last sequence acquisition
+    pAct = new CPropertyAction(this, &V4L2::OnFramesCaptured);
+    nRet = CreateProperty(gPropertyFramesCaptured, "0", MM::Integer, true, pAct);
+    if (nRet != DEVICE_OK)
+      return nRet;
+    pAct = new CPropertyAction(this, &V4L2::OnFramesDroppedByDriver);
+    nRet = CreateProperty(gPropertyFramesDroppedByDriver, "0", MM::Integer, true, pAct);
+    if (nRet != DEVICE_OK)
+      return nRet;
+    pAct = new CPropertyAction(this, &V4L2::OnFramesDroppedByAdapter);
+    nRet = CreateProperty(gPropertyFramesDroppedByAdapter, "0", MM::Integer, true, pAct);
+    if (nRet != DEVICE_OK)
+      return nRet;
+
+    LogMessage("calling video init");
+    if (VideoInit()) {
+      initialized_ = true;
+      return DEVICE_OK;
+    }
+    else {
+      initialized_ = false;
+      return DEVICE_ERR;
+    }
+  }
+
+  // Shutdown is called multiple times, Initialize will be called
+  // afterwards, unload device, release all resources
+  int Shutdown()
+  {
+    if (initialized_) {
+      StopSequenceAcquisition();
+      VideoClose();
+    }
+    initialized_ = false;
+    return DEVICE_OK;
+  }
+  
+  void GetName(char*name) const
+  {
+    CDeviceUtils::CopyLimitedString(name,gName);
+  }
+
+  // blocks until exposure is finished
+  int SnapImage()
+  {
+    if (IsCapturing())
+      return DEVICE_CAMERA_BUSY_ACQUIRING;
+    unsigned char* data = VideoTakeBuffer();
+    pixelType->convertV4l2ToOutput(pixelConverter, state, data,
+        const_cast<unsigned char*>(imageBuffer.GetPixels()));
+    VideoReturnBuffer();
+    return DEVICE_OK;
+  }
+
+  // waits for camera readout
+  const unsigned char* GetImageBuffer()
+  {
+    return imageBuffer.GetPixels();
+  }
+
+  // changes only if binning, pixel type, ... properties are set
+  unsigned GetImageWidth() const {return imageBuffer.Width();}
+  unsigned GetImageHeight() const {return imageBuffer.Height();}
+  unsigned GetImageBytesPerPixel() const {return imageBuffer.Depth();} 
+  long GetImageBufferSize() const {return GetImageWidth() * GetImageHeight() * GetImageBytesPerPixel();}
+  unsigned GetBitDepth() const { return pixelType->GetBitDepth(); }
+  unsigned GetNumberOfComponents() const { return pixelType->GetNumberOfComponents(); }
+
+  int SetROI(unsigned x,unsigned y,unsigned xSize,unsigned ySize)
+  {
+    (void) x; // get rid of warning
+    (void) y;
+    (void) xSize;
+    (void) ySize;
+    // FIXME
+    // set_roi(x,y,xSize,ySize);
+    return DEVICE_OK;
+  }
+
+  int GetBinning() const 
+  {
+    // FIXME
+    return 1;// get_binning();
+  }
+  
+  int SetBinning(int binSize)
+  {
+    // FIXME  set_binning(binSize);
+    SetProperty(MM::g_Keyword_Binning, CDeviceUtils::ConvertToString(binSize));
+    return DEVICE_OK;
+  }
+
+  double GetExposure() const 
+  {
+    // FIXME
+    return 1.0; //get_exposure();
+  }
+
+  void SetExposure(double exp)
+  {
+    // FIXME
+    // set_exposure(exp);
+    SetProperty(MM::g_Keyword_Exposure, CDeviceUtils::ConvertToString(exp));
+  }
+
+  int GetROI(unsigned&x,
+	     unsigned&y,
+	     unsigned&xSize,
+	     unsigned&ySize)
+  {
+    // FIXME
+    // get_roi(&x,&y,&xSize,&ySize);
+    x=0; y=0; xSize=state->W; ySize=state->H;
+    return DEVICE_OK;
+  }
+
+  int ClearROI()
+  {
+    // FIXME
+    //clear_roi();
+    return DEVICE_OK;
+  }
+  
+  // action interface
+  int OnExposure(MM::PropertyBase* pProp, MM::ActionType eAct)
+  {
+    if(eAct == MM::BeforeGet){
+      //pProp->Set(get_exposure()); // FIXME
+      //on_exposure();
+    }else if(eAct==MM::AfterSet){
+      double exp;
+      pProp->Get(exp);
+      //set_exposure(exp); // FIXME
+    }
+    return DEVICE_OK;
+  }
+
+  int OnDevicePath(MM::PropertyBase* pProp, MM::ActionType eAct)
+  {
+    if (eAct == MM::AfterSet) {
+      if (IsCapturing())
+         return DEVICE_CAMERA_BUSY_ACQUIRING;
+
+      ostringstream msg;
+      string devicePath;
+      pProp->Get(devicePath);
+
+      msg << "device path changed to " << devicePath;
+      LogMessage(msg.str());
+      return reinitializeDeviceIfRunning();
+    }
+
+    return DEVICE_OK;
+  }
+
+  int OnResolutionChange(MM::PropertyBase* pProp, MM::ActionType eAct)
+  {
+    if (eAct == MM::AfterSet) {
+      if (IsCapturing())
+         return DEVICE_CAMERA_BUSY_ACQUIRING;
+
+      ostringstream msg;
+      string devicePath;
+      pProp->Get(devicePath);
+
+      msg << "resolution changed to " << devicePath;
+      LogMessage(msg.str());
+      return reinitializeDeviceIfRunning();
+    }
+
+    return DEVICE_OK;
+  }
+
+  int OnBinning(MM::PropertyBase* pProp, MM::ActionType eAct)
+  {
+    if(eAct == MM::BeforeGet){
+      //on_binning(); // FIXME
+    }else if(eAct==MM::AfterSet){
+    }
+    return DEVICE_OK;
+  }
+  
+  int OnPixelType(MM::PropertyBase* pProp, MM::ActionType eAct)
+  {
+    if (eAct == MM::AfterSet)
+    {
+      if (IsCapturing())
+         return DEVICE_CAMERA_BUSY_ACQUIRING;
+
+      string pixType;
+      pProp->Get(pixType);
+      if (pixType == PixelType8Bit::PROPERTY_VALUE) {
+        pixelType = &PIXELTYPE_8BIT;
+      }
+      else if (pixType == PixelTypeYUYV::PROPERTY_VALUE) {
+        pixelType = &PIXELTYPE_YUYV;
+      }
+      else {
+        return DEVICE_INVALID_PROPERTY;
+      }
+  
+      LogMessage("setting pixelType " + pixelType->GetPropertyValue());
+      return this->resizeBuffer();
+    }
+    else if (eAct == MM::BeforeGet)
+    {
+      pProp->Set(pixelType->GetPropertyValue().c_str());
+    }
+    return DEVICE_OK;
+  }
+
+  int OnGain(MM::PropertyBase* pProp, MM::ActionType eAct)
+  {
+    if(eAct == MM::BeforeGet){
+      //on_gain(); // FIXME
+    }else if(eAct==MM::AfterSet){
+    }
+    return DEVICE_OK;
+  }
+
+  int OnBufferCount(MM::PropertyBase* pProp, MM::ActionType eAct)
+  {
+    if (eAct == MM::AfterSet) {
+      if (IsCapturing())
+         return DEVICE_CAMERA_BUSY_ACQUIRING;
+
+      pProp->Get(bufferCount_);
+      return reinitializeDeviceIfRunning();
+    }
+    else if (eAct == MM::BeforeGet) {
+      pProp->Set(bufferCount_);
+    }
+    return DEVICE_OK;
+  }
+
+  int OnFramesCaptured(MM::PropertyBase* pProp, MM::ActionType eAct)
+  {
+    if (eAct == MM::BeforeGet)
+      pProp->Set((long) GetStreamCounter(framesCaptured_));
+    return DEVICE_OK;
+  }
+
+  int OnFramesDroppedByDriver(MM::PropertyBase* pProp, MM::ActionType eAct)
+  {
+    if (eAct == MM::BeforeGet)
+      pProp->Set((long) GetStreamCounter(framesDroppedByDriver_));
+    return DEVICE_OK;
+  }
+
+  int OnFramesDroppedByAdapter(MM::PropertyBase* pProp, MM::ActionType eAct)
+  {
+    if (eAct == MM::BeforeGet)
+      pProp->Set((long) GetStreamCounter(framesDroppedByAdapter_));
+    return DEVICE_OK;
+  }
+
+  /**
+   * TODO: implement if possible
+   */
+  int IsExposureSequenceable(bool& isSequenceable) const 
+  {
+     isSequenceable = false; 
+     return DEVICE_OK;
+  }
+
+  /* Sequence acquisition streams frames through two threads: the capture
+   * thread dequeues filled buffers from the driver and hands them to the
+   * conversion thread, which converts each straight into the core's buffer
+   * and then queues it back to the driver. When conversion falls behind,
+   * the oldest waiting frame is dropped, so that the driver always keeps a
+   * buffer to fill. Frames are delivered as fast as the device produces
+   * them; the interval is ignored. */
+  int StartSequenceAcquisition(double interval_ms)
+  {
+    return StartSequenceAcquisition(LONG_MAX, interval_ms, false);
+  }
+
+  int StartSequenceAcquisition(long numImages, double interval_ms, bool stopOnOverflow)
+  {
+    (void) interval_ms;
+    if (!initialized_)
+      return DEVICE_NOT_CONNECTED;
+    if (IsCapturing())
+      return DEVICE_CAMERA_BUSY_ACQUIRING;
+    // An acquisition that ended by itself still has its threads to join
+    JoinStreamThreads();
+
+    int ret = GetCoreCallback()->PrepareForAcq(this);
+    if (ret != DEVICE_OK)
+      return ret;
+
+    pthread_mutex_lock(&streamMutex_);
+    streaming_ = true;
+    stopStreaming_ = false;
+    stopOnOverflow_ = stopOnOverflow;
+    streamStatus_ = DEVICE_OK;
+    imagesToAcquire_ = numImages;
+    imagesAcquired_ = 0;
+    framesCaptured_ = 0;
+    framesDroppedByDriver_ = 0;
+    framesDroppedByAdapter_ = 0;
+    haveSequence_ = false;
+    pthread_mutex_unlock(&streamMutex_);
+
+    captureThread_.activate();
+    conversionThread_.activate();
+    streamThreadsRunning_ = true;
+    LogMessage("started streaming");
+    return DEVICE_OK;
+  }
+
+  int StopSequenceAcquisition()
+  {
+    pthread_mutex_lock(&streamMutex_);
+    stopStreaming_ = true;
+    pthread_cond_broadcast(&streamCond_);
+    pthread_mutex_unlock(&streamMutex_);
+    JoinStreamThreads();
+    return DEVICE_OK;
+  }
+
+  bool IsCapturing()
+  {
+    pthread_mutex_lock(&streamMutex_);
+    bool streaming = streaming_;
+    pthread_mutex_unlock(&streamMutex_);
+    return streaming;
+  }
+
+private:
+  friend class StreamThread;
+
+  // Capture thread: dequeues filled buffers and passes them on
+  int CaptureLoop()
+  {
+    // Keep at least one buffer queued with the driver
+    const size_t maxPending = state->buffers_count > 1 ? state->buffers_count - 1 : 1;
+    for (;;) {
+      pthread_mutex_lock(&streamMutex_);
+      bool stop = stopStreaming_;
+      pthread_mutex_unlock(&streamMutex_);
+      if (stop)
+        break;
+
+      // Wake up regularly to notice stop requests
+      int ready = io_->WaitReadable(state->fd, 100);
+      if (ready == 0 || (ready < 0 && errno == EINTR))
+        continue;
+
+      struct v4l2_buffer buf;
+      memset(&buf, 0, sizeof(buf));
+      buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+      buf.memory = V4L2_MEMORY_MMAP;
+      if (ready < 0 || -1 == io_->Ioctl(state->fd, VIDIOC_DQBUF, &buf)) {
+        if (ready > 0 && (errno == EAGAIN || errno == EINTR))
+          continue;
+        ostringstream msg;
+        msg << "error: could not dequeue image buffer: " << strerror(errno);
+        LogMessage(msg.str().c_str());
+        StopStreaming(DEVICE_ERR);
+        break;
+      }
+
+      bool dropOldest = false;
+      struct v4l2_buffer oldest;
+      pthread_mutex_lock(&streamMutex_);
+      ++framesCaptured_;
+      // The driver numbers frames, including those it had no buffer for
+      if (haveSequence_ && buf.sequence > lastSequence_ + 1)
+        framesDroppedByDriver_ += buf.sequence - lastSequence_ - 1;
+      lastSequence_ = buf.sequence;
+      haveSequence_ = true;
+      if (pendingBuffers_.size() >= maxPending) {
+        oldest = pendingBuffers_.front();
+        pendingBuffers_.pop_front();
+        ++framesDroppedByAdapter_;
+        dropOldest = true;
+      }
+      pendingBuffers_.push_back(buf);
+      pthread_cond_signal(&streamCond_);
+      pthread_mutex_unlock(&streamMutex_);
+
+      if (dropOldest)
+        QueueBuffer(oldest);
+    }
+    return 0;
+  }
+
+  // Conversion thread: converts frames into the core's buffer, then
+  // re-queues their buffers. Ends the acquisition when it stops.
+  int ConversionLoop()
+  {
+    for (;;) {
+      pthread_mutex_lock(&streamMutex_);
+      while (pendingBuffers_.empty() && !stopStreaming_)
+        pthread_cond_wait(&streamCond_, &streamMutex_);
+      if (stopStreaming_) {
+        pthread_mutex_unlock(&streamMutex_);
+        break;
+      }
+      struct v4l2_buffer buf = pendingBuffers_.front();
+      pendingBuffers_.pop_front();
+      pthread_mutex_unlock(&streamMutex_);
+
+      int ret = InsertFrame(buf);
+      QueueBuffer(buf);
+      if (ret != DEVICE_OK) {
+        StopStreaming(ret);
+        break;
+      }
+
+      pthread_mutex_lock(&streamMutex_);
+      if (++imagesAcquired_ >= imagesToAcquire_)
+        stopStreaming_ = true;
+      pthread_mutex_unlock(&streamMutex_);
+    }
+
+    captureThread_.wait();
+
+    // Give back the frames left unconverted
+    pthread_mutex_lock(&streamMutex_);
+    std::deque<struct v4l2_buffer> unconverted;
+    unconverted.swap(pendingBuffers_);
+    int status = streamStatus_;
+    pthread_mutex_unlock(&streamMutex_);
+    for (size_t i = 0; i < unconverted.size(); ++i)
+      QueueBuffer(unconverted[i]);
+
+    pthread_mutex_lock(&streamMutex_);
+    streaming_ = false;
+    pthread_mutex_unlock(&streamMutex_);
+    LogMessage("stopped streaming");
+    GetCoreCallback()->AcqFinished(this, status);
+    return status;
+  }
+
+  int InsertFrame(const struct v4l2_buffer& buf)
+  {
+    char label[MM::MaxStrLength];
+    GetLabel(label);
+    Metadata md;
+    md.put("Camera", label);
+    md.put("V4L2-Sequence", CDeviceUtils::ConvertToString((long) buf.sequence));
+
+    FrameWriter writer(*pixelType, pixelConverter, state,
+        (unsigned char*) state->buffers[buf.index].start);
+    int ret = GetCoreCallback()->InsertImage(this, writer, imageBuffer.Width(),
+        imageBuffer.Height(), imageBuffer.Depth(),
+        pixelType->GetNumberOfComponents(), &md);
+    if (ret == DEVICE_BUFFER_OVERFLOW) {
+      pthread_mutex_lock(&streamMutex_);
+      bool stopOnOverflow = stopOnOverflow_;
+      pthread_mutex_unlock(&streamMutex_);
+      if (!stopOnOverflow) {
+        // do not stop on overflow - just reset the buffer
+        GetCoreCallback()->ClearImageBuffer(this);
+        ret = GetCoreCallback()->InsertImage(this, writer, imageBuffer.Width(),
+            imageBuffer.Height(), imageBuffer.Depth(),
+            pixelType->GetNumberOfComponents(), &md);
+      }
+    }
+    return ret;
+  }
+
+  void QueueBuffer(struct v4l2_buffer& buf)
+  {
+    if (-1 == tryIoctl(state->fd, VIDIOC_QBUF, &buf)) {
+      ostringstream msg;
+      msg << "error: could not queue image buffer: " << strerror(errno);
+      LogMessage(msg.str().c_str());
+    }
+  }
+
+  void StopStreaming(int status)
+  {
+    pthread_mutex_lock(&streamMutex_);
+    if (streamStatus_ == DEVICE_OK)
+      streamStatus_ = status;
+    stopStreaming_ = true;
+    pthread_cond_broadcast(&streamCond_);
+    pthread_mutex_unlock(&streamMutex_);
+  }
+
+  void JoinStreamThreads()
+  {
+    if (streamThreadsRunning_) {
+      conversionThread_.wait();
+      streamThreadsRunning_ = false;
+    }
+  }
+
+  unsigned long GetStreamCounter(const unsigned long& counter)
+  {
+    pthread_mutex_lock(&streamMutex_);
+    unsigned long value = counter;
+    pthread_mutex_unlock(&streamMutex_);
+    return value;
+  }
+
+  bool
+  VideoInit()
+  {
+    char devicePath[MM::MaxStrLength];
+    int ret = GetProperty(gPropertyDevicePath, devicePath);
+    if (ret != DEVICE_OK) {
+      LogMessage("could not read device path property");
+      return false;
+    }
+
+    char resolutionString[MM::MaxStrLength];
+    ret = GetProperty(gPropertyNameResolution, resolutionString);
+    if (ret != DEVICE_OK) {
+      LogMessage("could not read device resolution property");
+      return false;
+    }
+
+    long requestedWidth = gWidthDefault;
+    long requestedHeight = gHeightDefault;
+    ret = parseResolution(resolutionString, requestedWidth, requestedHeight);
+    if (ret != DEVICE_OK) {
+      LogMessage("could not parse device resolution property value");
+      return false;
+    }
+
+    ret = initDevice(devicePath, requestedWidth, requestedHeight);
+    if (ret != DEVICE_OK)
+      return false;
+
+    struct v4l2_requestbuffers reqbuf;
+    memset(&reqbuf, 0, sizeof(reqbuf));
+    reqbuf.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    reqbuf.memory = V4L2_MEMORY_MMAP;
+    reqbuf.count = (unsigned) bufferCount_;
+
+    if (-1 == tryIoctl(state->fd, VIDIOC_REQBUFS, &reqbuf)) {
+      ostringstream msg;
+      if (EINVAL == errno) {
+        msg << "error: the device does not support memory mapping";
+      }
+      else {
+        msg << "error: could not request memory map buffers: "
+            << strerror(errno) << " (errno " << errno << ")";
+      }
+      LogMessage(msg.str().c_str());
+      return false;
+    }
+
+    ostringstream bufMsg;
+    bufMsg << "got " << reqbuf.count << " out of " << bufferCount_ << " requested buffers";
+    LogMessage(bufMsg.str().c_str());
+
+    state->buffers = (struct VidBuffer*)calloc(reqbuf.count, sizeof(*(state->buffers)));
+    if (!state->buffers) {
+      LogMessage("could not allocate buffer(s)");
+      return false;
+    }
+
+    state->buf = (struct v4l2_buffer*) malloc(sizeof(struct v4l2_buffer));
+
+    unsigned int i;
+    for (i = 0; i < reqbuf.count; i++) {
+      struct v4l2_buffer buf;
+      memset(&buf, 0 , sizeof(buf));
+
+      buf.type = reqbuf.type;
+      buf.memory = V4L2_MEMORY_MMAP;
+      buf.index = i;
+      if (-1 == tryIoctl(state->fd, VIDIOC_QUERYBUF, &buf)) {
+        LogMessage("could not query the buffer state");
+        return false;
+      }
+
+      state->buffers[i].length = buf.length; // remember for munmap
+      state->buffers[i].start = io_->Map(buf.length, state->fd, buf.m.offset);
+
+      if (state->buffers[i].start == MAP_FAILED) {
+        LogMessage("memory map failed");
+        return false;
+      }
+
+      if (-1 == tryIoctl(state->fd, VIDIOC_QBUF, &buf)) {
+        LogMessage("could not enqueue buffer");
+        return false;
+      }
+    }
+
+    state->buffers_count = reqbuf.count;
+
+    ret = this->resizeBuffer();
+    if (ret != DEVICE_OK)
+      return false;
+
+    int type = V4L2_BUF_TYPE_VIDEO_CAPTURE; 
+    if (-1 == tryIoctl(state->fd, VIDIOC_STREAMON, &type)) {
+      LogMessage("could not initialize stream");
+      return false;
+    }
+
+    LogMessage("initialized data stream");
+    return true;
+  }
+
+  int
+  initDevice(const char* devicePath, long requestedWidth, long requestedHeight)
+  {
+    struct v4l2_capability cap;
+    struct v4l2_format fmt;
+
+    state->fd = io_->Open(devicePath);
+  
+    if (-1 == state->fd) {
+      LogMessage("could not open the video device");
+      return false;
+    }
+    LogMessage("opened device");
+
+    if (-1 == tryIoctl(state->fd, VIDIOC_QUERYCAP, &cap)) {
+      ostringstream msg;
+      if (EINVAL == errno) {
+        msg << "error: device is not a v4l2 device";
+      } else {
+        msg << "error: could not query v4l2 capabilities: " << strerror(errno);
+      }
+      LogMessage(msg.str().c_str());
+      return DEVICE_ERR;
+    }
+
+    if (!(cap.capabilities & V4L2_CAP_VIDEO_CAPTURE)) {
+      ostringstream msg;
+      msg << "error: device is not a v4l2 capture device";
+      LogMessage(msg.str().c_str());
+      return DEVICE_ERR;
+    }
+
+    memset(&fmt, 0, sizeof(fmt));
+
+    fmt.type                = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_YUYV;
+    fmt.fmt.pix.field       = V4L2_FIELD_INTERLACED;
+    fmt.fmt.pix.height      = (unsigned) requestedWidth;
+    fmt.fmt.pix.width       = (unsigned) requestedHeight;
+
+    if (-1 == tryIoctl(state->fd, VIDIOC_S_FMT, &fmt)) {
+      ostringstream msg;
+      msg << "error: could not set format YUYV: " << strerror(errno);
+      LogMessage(msg.str().c_str());
+      return DEVICE_ERR;
+    }
+
+    if (fmt.fmt.pix.width != requestedWidth) {
+      ostringstream msg;
+      msg << "warning: device did not match requested pixel width: "
+          << fmt.fmt.pix.width << " requested: " << requestedWidth;
+      LogMessage(msg.str().c_str());
+      // not necessarily fatal
+    }
+
+    if (fmt.fmt.pix.height != requestedHeight) {
+      ostringstream msg;
+      msg << "warning: device did not match requested pixel height: "
+          << fmt.fmt.pix.height << " requested: " << requestedHeight;
+      LogMessage(msg.str().c_str());
+      // not necessarily fatal
+    }
+
+    state->W = fmt.fmt.pix.width;
+    state->H = fmt.fmt.pix.height;
+    // Drivers may pad lines; older ones leave bytesperline unset
+    state->bytesPerLine = fmt.fmt.pix.bytesperline > 0 ?
+      fmt.fmt.pix.bytesperline : 2 * state->W;
+
+    ostringstream formatMsg;
+    formatMsg << "device is configured for " << state->W << "x" << state->H << " pixel"
+              << " and " << fmt.fmt.pix.bytesperline << " bytes per line ("
+              << (fmt.fmt.pix.bytesperline / state->H) <<" bpp)";
+    LogMessage(formatMsg.str().c_str());
+    return DEVICE_OK;
+  }
+
+  bool
+  VideoClose()
+  {
+    int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (-1 == tryIoctl(state->fd, VIDIOC_STREAMOFF, &type)) {
+      ostringstream msg;
+      msg << "warning setting streamoff: " << strerror(errno);
+      LogMessage(msg.str().c_str());
+      // not fatal
+    }
+  
+    unsigned int i;
+    for (i = 0; i < state->buffers_count; i++)
+      io_->Unmap(state->buffers[i].start, state->buffers[i].length);
+    io_->Close(state->fd);
+    free(state->buf);
+  
+    state->fd = 0;
+    state->W = 0;
+    state->H = 0;
+    state->bytesPerLine = 0;
+    state->buffers_count = 0;
+    state->buffers = 0;
+  
+    return true;
+  }
+
+  /*  has to be followed by a call to videoreturnbuffer */
+  unsigned char*
+  VideoTakeBuffer()
+  {
+    memset(state->buf, 0, sizeof(struct v4l2_buffer));
+    state->buf->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    state->buf->memory = V4L2_MEMORY_MMAP;
+    // By default VIDIOC_DQBUF blocks when no buffer is in the outgoing queue
+    if (-1 == tryIoctl(state->fd, VIDIOC_DQBUF, state->buf)) {
+      ostringstream msg;
+      msg << "error: could not prepare next image buffer: " << strerror(errno);
+      LogMessage(msg.str().c_str());
+      assert(false);
+    }
+
+    assert(state->buf->index < state->buffers_count);
+    return (unsigned char*)state->buffers[state->buf->index].start;
+  }
+  
+  void
+  VideoReturnBuffer()
+  {
+    if (-1 == tryIoctl(state->fd, VIDIOC_QBUF, state->buf)) {
+      ostringstream msg;
+      msg << "error: could not get next image buffer: " << strerror(errno);
+      LogMessage(msg.str().c_str());
+      return;
+    }
+  }
+
+  int reinitializeDeviceIfRunning() {
+    if (initialized_) {
+      LogMessage("closing current device");
+      if (! VideoClose()) {
+        return DEVICE_ERR;
+      }
+      if (! VideoInit()) {
+        return DEVICE_ERR;
+      }
+    }
+    return DEVICE_OK;
+  }
+  
+  int parseResolution(const char* resolutionString, long &width, long &height) {
+    long parsedWidth = 0;
+    long parsedHeight = 0;
+    int matched = sscanf(resolutionString, "%ldx%ld", &parsedWidth, &parsedHeight);
+
+    if (matched == 2) {
+      width = parsedWidth;
+      height = parsedHeight;
+
+      return DEVICE_OK;
+    }
+    else if (errno != 0) {
+      ostringstream msg;
+      msg << "error: could not parse resolution: " << strerror(errno);
+      LogMessage(msg.str().c_str());
+      return DEVICE_INVALID_PROPERTY;
+    }
+    else {
+      LogMessage("resolution not in format 'WxH'");
+      return DEVICE_INVALID_PROPERTY;
+    }
+
+    width = parsedWidth;
+    height = parsedHeight;
+
+    return DEVICE_OK;
+  }
+  
+  int resizeBuffer()
+  {
+    imageBuffer.Resize(state->W, state->H, pixelType->GetImageBytesPerPixel());
+    return DEVICE_OK;
+  }
+
+  int tryIoctl(int fd, unsigned long ioctlCode, void *parameter) const
+  {
+      while (-1 == io_->Ioctl(fd, ioctlCode, parameter)) {
+          if (!(errno == EBUSY || errno == EAGAIN))
+              return -1;
+  
+          int result = io_->WaitReadable(fd, 10000);
+          if (0 == result) {
+            LogMessage("tryIoctl select timeout");
+            return -1;
+          }
+          else if (-1 == result && EINTR != errno) {
+            return -1;
+          }
+      }
+      return 0;
+  }
+
+  bool initialized_;
+  VideoDeviceIo* io_;
+  State state[1];
+  ImgBuffer imageBuffer;
+  PixelType *pixelType;
+  PixelConverter pixelConverter;
+  long bufferCount_;
+
+  // Streaming pipeline; the state below is guarded by streamMutex_
+  StreamThread captureThread_;
+  StreamThread conversionThread_;
+  pthread_mutex_t streamMutex_;
+  pthread_cond_t streamCond_;
+  std::deque<struct v4l2_buffer> pendingBuffers_;
+  bool streaming_;
+  bool stopStreaming_;
+  bool streamThreadsRunning_; // not guarded; used by the calling thread only
+  bool stopOnOverflow_;
+  int streamStatus_;
+  long imagesToAcquire_;
+  long imagesAcquired_;
+  unsigned long framesCaptured_;
+  unsigned long framesDroppedByDriver_;
+  unsigned long framesDroppedByAdapter_;
+  bool haveSequence_;
+  unsigned lastSequence_;
+};
+
+#endif // _VIDEO4LINUX2_H_
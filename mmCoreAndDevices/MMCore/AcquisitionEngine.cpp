@@ -0,0 +1,652 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          AcquisitionEngine.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Runs acquisition plans as hardware-sequenced camera
+//                sequences.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "AcquisitionEngine.h"
+
+#include "CoreClock.h"
+#include "CoreUtils.h"
+#include "ErrorCodes.h"
+#include "MMCore.h"
+
+#include "../MMDevice/ImageMetadata.h"
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+#include <climits>
+#include <map>
+#include <utility>
+
+
+namespace mm
+{
+
+/// A sequence to be loaded into (and started on) one device for a run.
+struct AcquisitionEngine::SequenceLoad
+{
+   enum Kind
+   {
+      XYStage,
+      Stage,
+      Exposure,
+      Property
+   };
+
+   Kind kind;
+   std::string device;
+   std::string property;
+   std::vector<double> first;  // X, Z or exposure
+   std::vector<double> second; // Y
+   std::vector<std::string> values;
+};
+
+AcquisitionEngine::AcquisitionEngine(CMMCore* core) :
+   core_(core),
+   lastPosition_(-1),
+   lastSlice_(-1),
+   lastChannel_(-1),
+   startNs_(0),
+   running_(false),
+   stopRequested_(false),
+   cameraChannels_(1),
+   imagesInserted_(0)
+{
+}
+
+AcquisitionEngine::~AcquisitionEngine()
+{
+   Stop();
+}
+
+void AcquisitionEngine::LoadSequence(CMMCore* core, const SequenceLoad* load,
+      boost::shared_ptr<CMMError>* error)
+{
+   try
+   {
+      const char* device = load->device.c_str();
+      switch (load->kind)
+      {
+         case SequenceLoad::XYStage:
+            core->loadXYStageSequence(device, load->first, load->second);
+            break;
+         case SequenceLoad::Stage:
+            core->loadStageSequence(device, load->first);
+            break;
+         case SequenceLoad::Exposure:
+            core->loadExposureSequence(device, load->first);
+            break;
+         case SequenceLoad::Property:
+            core->loadPropertySequence(device, load->property.c_str(),
+                  load->values);
+            break;
+      }
+   }
+   catch (const CMMError& e)
+   {
+      error->reset(new CMMError(e));
+   }
+}
+
+std::vector<AcquisitionRun>
+AcquisitionEngine::Compile(const AcquisitionPlan& plan) throw (CMMError)
+{
+   PreparedPlan prepared;
+   Prepare(plan, prepared);
+   return prepared.runs;
+}
+
+void AcquisitionEngine::Start(const AcquisitionPlan& plan) throw (CMMError)
+{
+   if (IsRunning() || core_->isSequenceRunning())
+      throw CMMError("Cannot start a planned acquisition while a sequence "
+            "acquisition is running", MMERR_NotAllowedDuringSequenceAcquisition);
+   if (thread_.joinable())
+      thread_.join();
+
+   Prepare(plan, current_);
+   core_->initializeCircularBuffer();
+   const unsigned cameraChannels = core_->getNumberOfCameraChannels();
+
+   boost::mutex::scoped_lock lock(mutex_);
+   running_ = true;
+   stopRequested_ = false;
+   lastError_.clear();
+   cameraChannels_ = cameraChannels > 0 ? cameraChannels : 1;
+   imagesInserted_ = 0;
+   thread_ = boost::thread(&AcquisitionEngine::RunPlan, this);
+}
+
+void AcquisitionEngine::Stop()
+{
+   {
+      boost::mutex::scoped_lock lock(mutex_);
+      stopRequested_ = true;
+      cond_.notify_all();
+   }
+   if (thread_.joinable())
+      thread_.join();
+}
+
+bool AcquisitionEngine::IsRunning() const
+{
+   boost::mutex::scoped_lock lock(mutex_);
+   return running_;
+}
+
+std::string AcquisitionEngine::GetLastError() const
+{
+   boost::mutex::scoped_lock lock(mutex_);
+   return lastError_;
+}
+
+long AcquisitionEngine::GetAcquiredFrameCount() const
+{
+   boost::mutex::scoped_lock lock(mutex_);
+   return static_cast<long>(imagesInserted_ / cameraChannels_);
+}
+
+void AcquisitionEngine::TagImage(Metadata& md)
+{
+   boost::mutex::scoped_lock lock(mutex_);
+   if (!running_)
+      return;
+
+   const std::size_t frame = imagesInserted_ / cameraChannels_;
+   ++imagesInserted_;
+   cond_.notify_all();
+   if (frame >= current_.events.size())
+      return;
+
+   const AcquisitionEvent& event = current_.events[frame];
+   md.PutImageTag<long>("Acquisition-Frame", static_cast<long>(frame));
+   md.PutImageTag<long>("Acquisition-TimeIndex", event.timeIndex);
+   md.PutImageTag<long>("Acquisition-PositionIndex", event.positionIndex);
+   md.PutImageTag<long>("Acquisition-SliceIndex", event.sliceIndex);
+   md.PutImageTag<long>("Acquisition-ChannelIndex", event.channelIndex);
+   const std::vector<std::string>& channels = current_.plan.getChannels();
+   if (!channels.empty())
+      md.PutImageTag("Acquisition-Channel", channels[event.channelIndex]);
+}
+
+void AcquisitionEngine::Prepare(const AcquisitionPlan& plan,
+      PreparedPlan& prepared) throw (CMMError)
+{
+   prepared.plan = plan;
+   prepared.camera = core_->getCameraDevice();
+   if (prepared.camera.empty())
+      throw CMMError("No camera for the planned acquisition",
+            MMERR_CameraNotAvailable);
+
+   prepared.xyStage.clear();
+   if (!plan.getXPositions().empty())
+   {
+      prepared.xyStage = plan.getXYStage().empty() ?
+         core_->getXYStageDevice() : plan.getXYStage();
+      if (prepared.xyStage.empty())
+         throw CMMError("No XY stage for the planned positions",
+               MMERR_InvalidXYStageDevice);
+   }
+
+   prepared.focusStage.clear();
+   if (!plan.getZPositions().empty())
+   {
+      prepared.focusStage = plan.getFocusStage().empty() ?
+         core_->getFocusDevice() : plan.getFocusStage();
+      if (prepared.focusStage.empty())
+         throw CMMError("No focus stage for the planned slices",
+               MMERR_InvalidStageDevice);
+   }
+
+   // Find the channel properties that differ between channels; only these
+   // need to be sequenced
+   prepared.channelProperties.clear();
+   prepared.channelPropertiesComplete = true;
+   const std::vector<std::string> channels = plan.getChannels();
+   typedef std::map<std::pair<std::string, std::string>, ChannelProperty> PropertyMap;
+   PropertyMap properties;
+   for (std::size_t i = 0; i < channels.size(); ++i)
+   {
+      Configuration config = core_->getConfigData(
+            plan.getChannelGroup().c_str(), channels[i].c_str());
+      for (std::size_t j = 0; j < config.size(); ++j)
+      {
+         PropertySetting setting = config.getSetting(j);
+         ChannelProperty& property = properties[std::make_pair(
+               setting.getDeviceLabel(), setting.getPropertyName())];
+         property.device = setting.getDeviceLabel();
+         property.property = setting.getPropertyName();
+         if (property.values.size() != i) // Missing from earlier channels
+            prepared.channelPropertiesComplete = false;
+         property.values.resize(i);
+         property.values.push_back(setting.getPropertyValue());
+      }
+   }
+   for (PropertyMap::const_iterator it = properties.begin();
+         it != properties.end(); ++it)
+   {
+      const std::vector<std::string>& values = it->second.values;
+      if (values.size() != channels.size())
+         prepared.channelPropertiesComplete = false;
+      else if (std::count(values.begin(), values.end(), values.front()) !=
+            static_cast<std::ptrdiff_t>(values.size()))
+         prepared.channelProperties.push_back(it->second);
+   }
+
+   const std::vector<double> exposures = plan.getChannelExposures();
+   prepared.exposuresVary = !exposures.empty() &&
+      std::count(exposures.begin(), exposures.end(), exposures.front()) !=
+      static_cast<std::ptrdiff_t>(exposures.size());
+
+   prepared.events = SequenceCompiler::ExpandEvents(plan);
+   prepared.runs = SequenceCompiler::CompileRuns(plan, prepared.events,
+         QueryLimits(prepared));
+}
+
+SequenceLimits
+AcquisitionEngine::QueryLimits(const PreparedPlan& prepared) throw (CMMError)
+{
+   SequenceLimits limits;
+   const AcquisitionPlan& plan = prepared.plan;
+
+   if (plan.getPositionCount() > 1 &&
+         core_->isXYStageSequenceable(prepared.xyStage.c_str()))
+      limits.xyMaxLength =
+         core_->getXYStageSequenceMaxLength(prepared.xyStage.c_str());
+
+   if (plan.getSliceCount() > 1 &&
+         core_->isStageSequenceable(prepared.focusStage.c_str()))
+      limits.zMaxLength =
+         core_->getStageSequenceMaxLength(prepared.focusStage.c_str());
+
+   if (plan.getChannelCount() > 1 && prepared.channelPropertiesComplete)
+   {
+      long maxLength = LONG_MAX;
+      for (std::vector<ChannelProperty>::const_iterator it =
+            prepared.channelProperties.begin();
+            it != prepared.channelProperties.end() && maxLength > 0; ++it)
+      {
+         if (!core_->isPropertySequenceable(it->device.c_str(),
+                  it->property.c_str()))
+            maxLength = 0;
+         else
+            maxLength = (std::min)(maxLength, core_->getPropertySequenceMaxLength(
+                     it->device.c_str(), it->property.c_str()));
+      }
+      if (prepared.exposuresVary && maxLength > 0)
+      {
+         if (!core_->isExposureSequenceable(prepared.camera.c_str()))
+            maxLength = 0;
+         else
+            maxLength = (std::min)(maxLength,
+                  core_->getExposureSequenceMaxLength(prepared.camera.c_str()));
+      }
+      limits.channelMaxLength = maxLength;
+   }
+   return limits;
+}
+
+void AcquisitionEngine::RunPlan()
+{
+   std::string error;
+   bool shutterOpened = false;
+   try
+   {
+      if (core_->getAutoShutter() && !core_->getShutterDevice().empty())
+      {
+         core_->setShutterOpen(true);
+         shutterOpened = true;
+      }
+
+      lastPosition_ = lastSlice_ = lastChannel_ = -1;
+      startNs_ = CoreClock::MonotonicNs();
+      for (std::vector<AcquisitionRun>::const_iterator it = current_.runs.begin();
+            it != current_.runs.end() && !IsStopRequested(); ++it)
+      {
+         RunOne(*it);
+      }
+   }
+   catch (const CMMError& e)
+   {
+      error = e.getFullMsg();
+   }
+
+   if (shutterOpened)
+   {
+      try
+      {
+         core_->setShutterOpen(false);
+      }
+      catch (const CMMError& e)
+      {
+         if (error.empty())
+            error = e.getFullMsg();
+      }
+   }
+
+   if (error.empty())
+      core_->logMessage(("Planned acquisition finished after " +
+               ToString(GetAcquiredFrameCount()) + " frames").c_str());
+   else
+      core_->logMessage(("Planned acquisition failed: " + error).c_str());
+
+   boost::mutex::scoped_lock lock(mutex_);
+   lastError_ = error;
+   running_ = false;
+   cond_.notify_all();
+}
+
+void AcquisitionEngine::RunOne(const AcquisitionRun& run) throw (CMMError)
+{
+   const AcquisitionEvent& first = current_.events[run.firstEvent];
+   if (run.waitForTimePoint)
+   {
+      const double offsetMs = first.timeIndex * current_.plan.getIntervalMs();
+      if (!WaitUntil(startNs_ + static_cast<unsigned long long>(offsetMs * 1.0e6)))
+         return;
+   }
+
+   ApplyState(first);
+
+   const std::vector<SequenceLoad> loads = GetLoads(run);
+   LoadSequences(loads);
+   try
+   {
+      StartSequences(loads, true);
+      AcquireRun(run);
+   }
+   catch (const CMMError&)
+   {
+      // Also stops the sequences that were started before one failed to
+      // start
+      try
+      {
+         StartSequences(loads, false);
+      }
+      catch (const CMMError&)
+      {
+      }
+      throw;
+   }
+   StartSequences(loads, false);
+
+   // Sequenced devices are left at the last step of their sequence
+   if (run.sequenceXY)
+      lastPosition_ = -1;
+   if (run.sequenceZ)
+      lastSlice_ = -1;
+   if (run.sequenceChannel)
+      lastChannel_ = -1;
+}
+
+void AcquisitionEngine::ApplyState(const AcquisitionEvent& event) throw (CMMError)
+{
+   const AcquisitionPlan& plan = current_.plan;
+   bool moveXY = false, moveZ = false, changeChannel = false;
+
+   if (!current_.xyStage.empty() && event.positionIndex != lastPosition_)
+   {
+      core_->setXYPosition(current_.xyStage.c_str(),
+            plan.getXPositions()[event.positionIndex],
+            plan.getYPositions()[event.positionIndex]);
+      moveXY = true;
+   }
+   if (!current_.focusStage.empty() && event.sliceIndex != lastSlice_)
+   {
+      core_->setPosition(current_.focusStage.c_str(),
+            plan.getZPositions()[event.sliceIndex]);
+      moveZ = true;
+   }
+   const std::vector<std::string> channels = plan.getChannels();
+   if (!channels.empty() && event.channelIndex != lastChannel_)
+   {
+      core_->setConfig(plan.getChannelGroup().c_str(),
+            channels[event.channelIndex].c_str());
+      const std::vector<double> exposures = plan.getChannelExposures();
+      if (!exposures.empty())
+         core_->setExposure(current_.camera.c_str(),
+               exposures[event.channelIndex]);
+      changeChannel = true;
+   }
+
+   // Let all devices move concurrently before waiting for any of them
+   if (moveXY)
+      core_->waitForDevice(current_.xyStage.c_str());
+   if (moveZ)
+      core_->waitForDevice(current_.focusStage.c_str());
+   if (changeChannel)
+      core_->waitForConfig(plan.getChannelGroup().c_str(),
+            channels[event.channelIndex].c_str());
+
+   lastPosition_ = event.positionIndex;
+   lastSlice_ = event.sliceIndex;
+   lastChannel_ = event.channelIndex;
+}
+
+std::vector<AcquisitionEngine::SequenceLoad>
+AcquisitionEngine::GetLoads(const AcquisitionRun& run) const
+{
+   const AcquisitionPlan& plan = current_.plan;
+   const std::size_t begin = run.firstEvent;
+   const std::size_t end = run.firstEvent + run.eventCount;
+   std::vector<SequenceLoad> loads;
+
+   if (run.sequenceXY)
+   {
+      const std::vector<double> x = plan.getXPositions();
+      const std::vector<double> y = plan.getYPositions();
+      SequenceLoad load;
+      load.kind = SequenceLoad::XYStage;
+      load.device = current_.xyStage;
+      for (std::size_t i = begin; i < end; ++i)
+      {
+         load.first.push_back(x[current_.events[i].positionIndex]);
+         load.second.push_back(y[current_.events[i].positionIndex]);
+      }
+      loads.push_back(load);
+   }
+
+   if (run.sequenceZ)
+   {
+      const std::vector<double> z = plan.getZPositions();
+      SequenceLoad load;
+      load.kind = SequenceLoad::Stage;
+      load.device = current_.focusStage;
+      for (std::size_t i = begin; i < end; ++i)
+         load.first.push_back(z[current_.events[i].sliceIndex]);
+      loads.push_back(load);
+   }
+
+   if (run.sequenceChannel)
+   {
+      for (std::vector<ChannelProperty>::const_iterator it =
+            current_.channelProperties.begin();
+            it != current_.channelProperties.end(); ++it)
+      {
+         SequenceLoad load;
+         load.kind = SequenceLoad::Property;
+         load.device = it->device;
+         load.property = it->property;
+         for (std::size_t i = begin; i < end; ++i)
+            load.values.push_back(it->values[current_.events[i].channelIndex]);
+         loads.push_back(load);
+      }
+      if (current_.exposuresVary)
+      {
+         const std::vector<double> exposures = plan.getChannelExposures();
+         SequenceLoad load;
+         load.kind = SequenceLoad::Exposure;
+         load.device = current_.camera;
+         for (std::size_t i = begin; i < end; ++i)
+            load.first.push_back(exposures[current_.events[i].channelIndex]);
+         loads.push_back(load);
+      }
+   }
+   return loads;
+}
+
+void AcquisitionEngine::LoadSequences(const std::vector<SequenceLoad>& loads)
+   throw (CMMError)
+{
+   // Sending a sequence can take a long time on serial devices, so all
+   // devices are loaded at once. Devices sharing a module are serialized by
+   // the module lock.
+   std::vector< boost::shared_ptr<CMMError> > errors(loads.size());
+   if (loads.size() == 1)
+   {
+      LoadSequence(core_, &loads[0], &errors[0]);
+   }
+   else if (loads.size() > 1)
+   {
+      boost::thread_group threads;
+      for (std::size_t i = 0; i < loads.size(); ++i)
+         threads.create_thread(boost::bind(&LoadSequence, core_, &loads[i],
+                  &errors[i]));
+      threads.join_all();
+   }
+
+   for (std::size_t i = 0; i < errors.size(); ++i)
+   {
+      if (errors[i])
+         throw CMMError("Failed to load sequence into " +
+               ToQuotedString(loads[i].device), *errors[i]);
+   }
+}
+
+void AcquisitionEngine::StartSequences(const std::vector<SequenceLoad>& loads,
+      bool start) throw (CMMError)
+{
+   for (std::vector<SequenceLoad>::const_iterator it = loads.begin();
+         it != loads.end(); ++it)
+   {
+      const char* device = it->device.c_str();
+      switch (it->kind)
+      {
+         case SequenceLoad::XYStage:
+            if (start)
+               core_->startXYStageSequence(device);
+            else
+               core_->stopXYStageSequence(device);
+            break;
+         case SequenceLoad::Stage:
+            if (start)
+               core_->startStageSequence(device);
+            else
+               core_->stopStageSequence(device);
+            break;
+         case SequenceLoad::Exposure:
+            if (start)
+               core_->startExposureSequence(device);
+            else
+               core_->stopExposureSequence(device);
+            break;
+         case SequenceLoad::Property:
+            if (start)
+               core_->startPropertySequence(device, it->property.c_str());
+            else
+               core_->stopPropertySequence(device, it->property.c_str());
+            break;
+      }
+   }
+}
+
+void AcquisitionEngine::AcquireRun(const AcquisitionRun& run) throw (CMMError)
+{
+   if (IsStopRequested())
+      return;
+
+   const char* camera = current_.camera.c_str();
+   const unsigned long target =
+      static_cast<unsigned long>(run.firstEvent + run.eventCount) * cameraChannels_;
+   core_->startSequenceAcquisition(camera, static_cast<long>(run.eventCount),
+         run.cameraIntervalMs, true);
+
+   const unsigned long long timeoutNs =
+      static_cast<unsigned long long>(core_->getTimeoutMs()) * 1000000ULL;
+   unsigned long long doneNs = 0;
+   for (;;)
+   {
+      bool stop, done;
+      {
+         boost::mutex::scoped_lock lock(mutex_);
+         if (!stopRequested_ && imagesInserted_ < target)
+            cond_.timed_wait(lock, boost::posix_time::milliseconds(10));
+         stop = stopRequested_;
+         done = imagesInserted_ >= target;
+      }
+
+      if (stop)
+      {
+         core_->stopSequenceAcquisition(camera);
+         return;
+      }
+
+      if (!core_->isSequenceRunning(camera))
+      {
+         boost::mutex::scoped_lock lock(mutex_);
+         if (imagesInserted_ < target)
+            throw CMMError("Camera stopped after " +
+                  ToString(imagesInserted_ / cameraChannels_) + " of " +
+                  ToString(current_.events.size()) + " planned frames",
+                  MMERR_InvalidImageSequence);
+         return;
+      }
+
+      if (done)
+      {
+         // Give the camera some time to notice the end of the sequence
+         const unsigned long long nowNs = CoreClock::MonotonicNs();
+         if (doneNs == 0)
+            doneNs = nowNs;
+         else if (nowNs - doneNs > timeoutNs)
+         {
+            core_->stopSequenceAcquisition(camera);
+            return;
+         }
+         boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+      }
+   }
+}
+
+bool AcquisitionEngine::WaitUntil(unsigned long long monotonicNs)
+{
+   boost::mutex::scoped_lock lock(mutex_);
+   for (;;)
+   {
+      if (stopRequested_)
+         return false;
+      const unsigned long long nowNs = CoreClock::MonotonicNs();
+      if (nowNs >= monotonicNs)
+         return true;
+      const unsigned long long remainingMs = (monotonicNs - nowNs) / 1000000ULL;
+      cond_.timed_wait(lock, boost::posix_time::milliseconds(
+               static_cast<long>((std::min)(remainingMs + 1, 100ULL))));
+   }
+}
+
+bool AcquisitionEngine::IsStopRequested() const
+{
+   boost::mutex::scoped_lock lock(mutex_);
+   return stopRequested_;
+}
+
+} // namespace mm
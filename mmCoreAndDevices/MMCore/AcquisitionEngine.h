@@ -0,0 +1,138 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          AcquisitionEngine.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Runs acquisition plans as hardware-sequenced camera
+//                sequences.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "AcquisitionPlan.h"
+#include "Error.h"
+#include "SequenceCompiler.h"
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <string>
+#include <vector>
+
+class CMMCore;
+class Metadata;
+
+namespace mm
+{
+
+/// Runs an AcquisitionPlan on a background thread.
+/**
+ * The plan is compiled into runs (see SequenceCompiler) using the sequencing
+ * capabilities reported by the devices. For each run, the engine waits for
+ * the scheduled time point if needed, sets the axes that do not change
+ * during the run by software, loads the sequences of the changing axes (all
+ * devices in parallel), starts them, and acquires the run's frames as one
+ * camera sequence. The circular buffer is initialized once, so the frames of
+ * all runs end up in it in acquisition order.
+ *
+ * While a plan runs, every image inserted by a camera is tagged with its
+ * position in the plan. Multi-channel cameras insert one image per channel
+ * for each frame.
+ *
+ * All device access goes through the public CMMCore interface.
+ */
+class AcquisitionEngine
+{
+public:
+   explicit AcquisitionEngine(CMMCore* core);
+   ~AcquisitionEngine();
+
+   /// Compile the plan for the current devices without running it.
+   std::vector<AcquisitionRun> Compile(const AcquisitionPlan& plan) throw (CMMError);
+
+   void Start(const AcquisitionPlan& plan) throw (CMMError);
+   /// Stop the running plan, if any, and wait for the engine to finish.
+   void Stop();
+   bool IsRunning() const;
+   /// Error that ended the last plan, or an empty string.
+   std::string GetLastError() const;
+   /// Number of frames acquired since the last plan was started.
+   long GetAcquiredFrameCount() const;
+
+   /// Called for each image inserted by a camera.
+   void TagImage(Metadata& md);
+
+private:
+   AcquisitionEngine(const AcquisitionEngine&);
+   AcquisitionEngine& operator=(const AcquisitionEngine&);
+
+   struct SequenceLoad;
+   struct ChannelProperty
+   {
+      std::string device;
+      std::string property;
+      std::vector<std::string> values; // Per channel
+   };
+
+   // A plan resolved against the current devices
+   struct PreparedPlan
+   {
+      AcquisitionPlan plan;
+      std::string camera;
+      std::string xyStage;
+      std::string focusStage;
+      std::vector<ChannelProperty> channelProperties; // Only varying ones
+      bool channelPropertiesComplete;
+      bool exposuresVary;
+      std::vector<AcquisitionEvent> events;
+      std::vector<AcquisitionRun> runs;
+   };
+
+   void Prepare(const AcquisitionPlan& plan, PreparedPlan& prepared) throw (CMMError);
+   SequenceLimits QueryLimits(const PreparedPlan& prepared) throw (CMMError);
+   void RunPlan();
+   void RunOne(const AcquisitionRun& run) throw (CMMError);
+   void ApplyState(const AcquisitionEvent& event) throw (CMMError);
+   std::vector<SequenceLoad> GetLoads(const AcquisitionRun& run) const;
+   static void LoadSequence(CMMCore* core, const SequenceLoad* load,
+         boost::shared_ptr<CMMError>* error);
+   void LoadSequences(const std::vector<SequenceLoad>& loads) throw (CMMError);
+   void StartSequences(const std::vector<SequenceLoad>& loads, bool start) throw (CMMError);
+   void AcquireRun(const AcquisitionRun& run) throw (CMMError);
+   bool WaitUntil(unsigned long long monotonicNs);
+   bool IsStopRequested() const;
+
+   CMMCore* core_;
+
+   // Set up before the engine thread starts
+   PreparedPlan current_;
+   long lastPosition_, lastSlice_, lastChannel_; // Set by software; -1 if unknown
+   unsigned long long startNs_;
+
+   boost::thread thread_;
+   mutable boost::mutex mutex_;
+   boost::condition_variable cond_;
+   bool running_;
+   bool stopRequested_;
+   std::string lastError_;
+   unsigned cameraChannels_;
+   unsigned long imagesInserted_;
+};
+
+} // namespace mm
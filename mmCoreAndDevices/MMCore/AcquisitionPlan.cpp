@@ -0,0 +1,120 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          AcquisitionPlan.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Description of a multi-dimensional acquisition, to be run by
+//                the core's acquisition engine.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "AcquisitionPlan.h"
+
+#include "ErrorCodes.h"
+
+
+AcquisitionPlan::AcquisitionPlan() :
+   timePoints_(1),
+   intervalMs_(0.0),
+   channelsFirst_(true),
+   cameraTimedIntervals_(false)
+{
+}
+
+void AcquisitionPlan::setTimePoints(long count, double intervalMs) throw (CMMError)
+{
+   if (count < 1 || intervalMs < 0.0)
+      throw CMMError("Invalid number of time points or interval",
+            MMERR_InvalidContents);
+   timePoints_ = count;
+   intervalMs_ = intervalMs;
+}
+
+void AcquisitionPlan::setXYPositions(std::vector<double> xPositions,
+      std::vector<double> yPositions) throw (CMMError)
+{
+   if (xPositions.size() != yPositions.size())
+      throw CMMError("X and Y position lists differ in length",
+            MMERR_InvalidContents);
+   xPositions_ = xPositions;
+   yPositions_ = yPositions;
+}
+
+void AcquisitionPlan::setZPositions(std::vector<double> zPositions)
+{
+   zPositions_ = zPositions;
+}
+
+void AcquisitionPlan::setChannels(const char* configGroup,
+      std::vector<std::string> configs,
+      std::vector<double> exposuresMs) throw (CMMError)
+{
+   if (!configs.empty() && (!configGroup || !*configGroup))
+      throw CMMError("Null or empty channel group", MMERR_NullPointerException);
+   if (!exposuresMs.empty() && exposuresMs.size() != configs.size())
+      throw CMMError("Channel and exposure lists differ in length",
+            MMERR_InvalidContents);
+   for (std::vector<double>::const_iterator it = exposuresMs.begin();
+         it != exposuresMs.end(); ++it)
+   {
+      if (*it < 0.0)
+         throw CMMError("Negative channel exposure", MMERR_InvalidContents);
+   }
+   channelGroup_ = configs.empty() ? std::string() : std::string(configGroup);
+   channels_ = configs;
+   exposuresMs_ = exposuresMs;
+}
+
+void AcquisitionPlan::setChannelsBeforeSlices(bool channelsFirst)
+{
+   channelsFirst_ = channelsFirst;
+}
+
+void AcquisitionPlan::setCameraTimedIntervals(bool cameraTimed)
+{
+   cameraTimedIntervals_ = cameraTimed;
+}
+
+void AcquisitionPlan::setXYStage(const char* xyStageLabel)
+{
+   xyStage_ = xyStageLabel ? xyStageLabel : "";
+}
+
+void AcquisitionPlan::setFocusStage(const char* focusLabel)
+{
+   focusStage_ = focusLabel ? focusLabel : "";
+}
+
+long AcquisitionPlan::getPositionCount() const
+{
+   return xPositions_.empty() ? 1 : static_cast<long>(xPositions_.size());
+}
+
+long AcquisitionPlan::getSliceCount() const
+{
+   return zPositions_.empty() ? 1 : static_cast<long>(zPositions_.size());
+}
+
+long AcquisitionPlan::getChannelCount() const
+{
+   return channels_.empty() ? 1 : static_cast<long>(channels_.size());
+}
+
+long AcquisitionPlan::getFrameCount() const
+{
+   return timePoints_ * getPositionCount() * getSliceCount() *
+      getChannelCount();
+}
@@ -0,0 +1,122 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          AcquisitionPlan.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Description of a multi-dimensional acquisition, to be run by
+//                the core's acquisition engine.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#ifndef _ACQUISITIONPLAN_H_
+#define _ACQUISITIONPLAN_H_
+
+#ifdef WIN32
+// disable exception scpecification warnings in MSVC
+#pragma warning( disable : 4290 )
+#endif
+
+#include "Error.h"
+
+#include <string>
+#include <vector>
+
+
+/**
+ * Multi-dimensional acquisition plan: time points, XY positions, Z slices
+ * and channels. Passed to CMMCore::startPlannedAcquisition().
+ *
+ * Frames are acquired with time as the outermost loop, followed by position,
+ * then slices and channels in the order given by setChannelsBeforeSlices().
+ * Each axis that is not set has a single, implicit entry that leaves the
+ * corresponding device untouched.
+ *
+ * Frames are acquired with the current camera. Empty stage labels (the
+ * default) stand for the current XY stage and focus device at the time the
+ * acquisition is started.
+ */
+class AcquisitionPlan
+{
+public:
+   AcquisitionPlan();
+
+   /**
+    * Number of time points and the interval between their starts. An
+    * interval of 0 acquires the time points back to back.
+    */
+   void setTimePoints(long count, double intervalMs) throw (CMMError);
+   /// XY stage positions, in um; both vectors must have the same length.
+   void setXYPositions(std::vector<double> xPositions,
+         std::vector<double> yPositions) throw (CMMError);
+   /// Absolute focus stage positions of the slices, in um.
+   void setZPositions(std::vector<double> zPositions);
+   /**
+    * Channels, as presets of a configuration group, each with its exposure.
+    * exposuresMs may be empty, to keep the camera's exposure throughout.
+    */
+   void setChannels(const char* configGroup, std::vector<std::string> configs,
+         std::vector<double> exposuresMs) throw (CMMError);
+   /// Whether all channels of a slice are acquired before moving in Z
+   /// (the default), rather than all slices of a channel.
+   void setChannelsBeforeSlices(bool channelsFirst);
+   /**
+    * Whether the camera may time the frames of successive time points
+    * itself, by passing the interval to the sequence acquisition. This only
+    * applies when there is one frame per time point, and requires a camera
+    * that honors the interval. Otherwise each time point is started by the
+    * core.
+    */
+   void setCameraTimedIntervals(bool cameraTimed);
+
+   void setXYStage(const char* xyStageLabel);
+   void setFocusStage(const char* focusLabel);
+
+   long getTimePointCount() const { return timePoints_; }
+   double getIntervalMs() const { return intervalMs_; }
+   std::vector<double> getXPositions() const { return xPositions_; }
+   std::vector<double> getYPositions() const { return yPositions_; }
+   std::vector<double> getZPositions() const { return zPositions_; }
+   std::string getChannelGroup() const { return channelGroup_; }
+   std::vector<std::string> getChannels() const { return channels_; }
+   std::vector<double> getChannelExposures() const { return exposuresMs_; }
+   bool getChannelsBeforeSlices() const { return channelsFirst_; }
+   bool getCameraTimedIntervals() const { return cameraTimedIntervals_; }
+   std::string getXYStage() const { return xyStage_; }
+   std::string getFocusStage() const { return focusStage_; }
+
+   /// Number of entries along each axis, counting unset axes as 1.
+   long getPositionCount() const;
+   long getSliceCount() const;
+   long getChannelCount() const;
+   /// Total number of frames in the plan.
+   long getFrameCount() const;
+
+private:
+   long timePoints_;
+   double intervalMs_;
+   std::vector<double> xPositions_;
+   std::vector<double> yPositions_;
+   std::vector<double> zPositions_;
+   std::string channelGroup_;
+   std::vector<std::string> channels_;
+   std::vector<double> exposuresMs_;
+   bool channelsFirst_;
+   bool cameraTimedIntervals_;
+   std::string xyStage_;
+   std::string focusStage_;
+};
+
+#endif //_ACQUISITIONPLAN_H_
@@ -0,0 +1,466 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          CallbackDispatcher.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Delivers core events to the application on a thread of its own.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+
+#include "CallbackDispatcher.h"
+
+#include "CoreClock.h"
+
+#include <boost/thread/thread_time.hpp>
+
+#include <exception>
+#include <limits>
+#include <vector>
+
+
+namespace {
+
+const char* const eventTypeNames[] = {
+   "onPropertiesChanged",
+   "onPropertyChanged",
+   "onChannelGroupChanged",
+   "onConfigGroupChanged",
+   "onSystemConfigurationLoaded",
+   "onPixelSizeChanged",
+   "onPixelSizeAffineChanged",
+   "onStagePositionChanged",
+   "onXYStagePositionChanged",
+   "onExposureChanged",
+   "onSLMExposureChanged",
+};
+
+// For the callbacks that take a non-const name
+class NameBuffer
+{
+   std::vector<char> chars_;
+
+public:
+   explicit NameBuffer(const std::string& name) :
+      chars_(name.begin(), name.end())
+   { chars_.push_back('\0'); }
+   char* Get() { return &chars_[0]; }
+};
+
+} // anonymous namespace
+
+
+const char*
+CallbackDispatcher::GetEventTypeName(EventType type)
+{
+   if (type < 0 || type >= NumEventTypes)
+      return "";
+   return eventTypeNames[type];
+}
+
+bool
+CallbackDispatcher::GetEventTypeByName(const std::string& name,
+      EventType& type)
+{
+   for (int i = 0; i < NumEventTypes; ++i)
+   {
+      if (name == eventTypeNames[i])
+      {
+         type = static_cast<EventType>(i);
+         return true;
+      }
+   }
+   return false;
+}
+
+
+CallbackDispatcher::Event::Event(EventType type, const std::string& subject) :
+   key(type, subject)
+{
+   for (unsigned i = 0; i < 6; ++i)
+      values[i] = 0.0;
+}
+
+
+CallbackDispatcher::CallbackDispatcher(mm::logging::Logger logger) :
+   logger_(logger),
+   downstream_(0),
+   running_(false),
+   stopping_(false),
+   coalescedCount_(0),
+   droppedCount_(0)
+{
+   for (int i = 0; i < NumEventTypes; ++i)
+      maxRates_[i] = 0.0;
+}
+
+CallbackDispatcher::~CallbackDispatcher()
+{
+   Stop();
+}
+
+void
+CallbackDispatcher::Start()
+{
+   {
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      // Including when stopped by a listener that has not returned yet
+      if (running_ && (!stopping_ || IsDispatcherThread()))
+         return;
+   }
+
+   // Wait for the thread of a listener that stopped the dispatcher
+   if (thread_.joinable())
+      thread_.join();
+
+   boost::lock_guard<boost::mutex> lock(mutex_);
+   running_ = true;
+   stopping_ = false;
+   lastDeliveryNs_.clear();
+   coalescedCount_ = 0;
+   droppedCount_ = 0;
+   thread_ = boost::thread(&CallbackDispatcher::Run, this);
+}
+
+void
+CallbackDispatcher::Stop()
+{
+   {
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      if (running_)
+         stopping_ = true;
+   }
+   condition_.notify_all();
+
+   // A listener may stop the dispatcher, from the dispatcher thread, which
+   // then exits once the listener returns. It is joined by the next Start()
+   // or Stop().
+   if (thread_.joinable() && !IsDispatcherThread())
+      thread_.join();
+}
+
+bool
+CallbackDispatcher::IsDispatcherThread() const
+{
+   return boost::this_thread::get_id() == thread_.get_id();
+}
+
+bool
+CallbackDispatcher::IsRunning() const
+{
+   boost::lock_guard<boost::mutex> lock(mutex_);
+   return running_ && !stopping_;
+}
+
+void
+CallbackDispatcher::SetDownstreamCallback(MMEventCallback* callback)
+{
+   boost::lock_guard<boost::recursive_mutex> lock(deliveryMutex_);
+   downstream_ = callback;
+}
+
+MMEventCallback*
+CallbackDispatcher::GetDownstreamCallback() const
+{
+   boost::lock_guard<boost::recursive_mutex> lock(deliveryMutex_);
+   return downstream_;
+}
+
+void
+CallbackDispatcher::SetMaxRate(EventType type, double eventsPerSecond)
+{
+   boost::lock_guard<boost::mutex> lock(mutex_);
+   maxRates_[type] = eventsPerSecond > 0.0 ? eventsPerSecond : 0.0;
+}
+
+double
+CallbackDispatcher::GetMaxRate(EventType type) const
+{
+   boost::lock_guard<boost::mutex> lock(mutex_);
+   return maxRates_[type];
+}
+
+boost::uint64_t
+CallbackDispatcher::GetCoalescedEventCount() const
+{
+   boost::lock_guard<boost::mutex> lock(mutex_);
+   return coalescedCount_;
+}
+
+boost::uint64_t
+CallbackDispatcher::GetDroppedEventCount() const
+{
+   boost::lock_guard<boost::mutex> lock(mutex_);
+   return droppedCount_;
+}
+
+void
+CallbackDispatcher::Post(const Event& event)
+{
+   {
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      if (running_)
+      {
+         std::map<Key, std::list<Event>::iterator>::iterator it =
+            queued_.find(event.key);
+         if (it != queued_.end())
+         {
+            *it->second = event;
+            ++coalescedCount_;
+            return;
+         }
+         if (queue_.size() >= MaxQueuedEvents)
+         {
+            ++droppedCount_;
+            return;
+         }
+         queue_.push_back(event);
+         queued_[event.key] = --queue_.end();
+         condition_.notify_one();
+         return;
+      }
+   }
+   // Not started, or the dispatcher thread has exited
+   Deliver(event);
+}
+
+boost::uint64_t
+CallbackDispatcher::ReadyTimeNs(const Event& event) const
+{
+   const double maxRate = maxRates_[event.key.first];
+   if (maxRate <= 0.0)
+      return 0;
+   std::map<Key, boost::uint64_t>::const_iterator it =
+      lastDeliveryNs_.find(event.key);
+   if (it == lastDeliveryNs_.end())
+      return 0;
+   return it->second + static_cast<boost::uint64_t>(1e9 / maxRate);
+}
+
+void
+CallbackDispatcher::Run()
+{
+   boost::unique_lock<boost::mutex> lock(mutex_);
+   for (;;)
+   {
+      if (queue_.empty())
+      {
+         if (stopping_)
+            break;
+         condition_.wait(lock);
+         continue;
+      }
+
+      // The first event in the queue that its rate limit lets through;
+      // when stopping, all events are delivered without delay
+      const boost::uint64_t nowNs = mm::CoreClock::MonotonicNs();
+      boost::uint64_t wakeNs = std::numeric_limits<boost::uint64_t>::max();
+      std::list<Event>::iterator it = queue_.begin();
+      for (; it != queue_.end(); ++it)
+      {
+         const boost::uint64_t readyNs = ReadyTimeNs(*it);
+         if (stopping_ || readyNs <= nowNs)
+            break;
+         if (readyNs < wakeNs)
+            wakeNs = readyNs;
+      }
+      if (it == queue_.end())
+      {
+         condition_.timed_wait(lock, boost::get_system_time() +
+               boost::posix_time::microseconds(
+                  static_cast<long>((wakeNs - nowNs) / 1000 + 1)));
+         continue;
+      }
+
+      const Event event = *it;
+      queued_.erase(event.key);
+      queue_.erase(it);
+      if (maxRates_[event.key.first] > 0.0)
+         lastDeliveryNs_[event.key] = nowNs;
+
+      lock.unlock();
+      try
+      {
+         Deliver(event);
+      }
+      catch (const std::exception& e)
+      {
+         LOG_ERROR(logger_) << "Exception in callback " <<
+            GetEventTypeName(event.key.first) << ": " << e.what();
+      }
+      catch (...)
+      {
+         LOG_ERROR(logger_) << "Exception in callback " <<
+            GetEventTypeName(event.key.first);
+      }
+      lock.lock();
+   }
+   running_ = false;
+   stopping_ = false;
+}
+
+void
+CallbackDispatcher::Deliver(const Event& event)
+{
+   boost::lock_guard<boost::recursive_mutex> lock(deliveryMutex_);
+   if (!downstream_)
+      return;
+
+   const std::string* text = event.text;
+   const double* v = event.values;
+   switch (event.key.first)
+   {
+      case PropertiesChanged:
+         downstream_->onPropertiesChanged();
+         break;
+      case PropertyChanged:
+         downstream_->onPropertyChanged(text[0].c_str(), text[1].c_str(),
+               text[2].c_str());
+         break;
+      case ChannelGroupChanged:
+         downstream_->onChannelGroupChanged(text[0].c_str());
+         break;
+      case ConfigGroupChanged:
+         downstream_->onConfigGroupChanged(text[0].c_str(), text[1].c_str());
+         break;
+      case SystemConfigurationLoaded:
+         downstream_->onSystemConfigurationLoaded();
+         break;
+      case PixelSizeChanged:
+         downstream_->onPixelSizeChanged(v[0]);
+         break;
+      case PixelSizeAffineChanged:
+         downstream_->onPixelSizeAffineChanged(v[0], v[1], v[2], v[3], v[4],
+               v[5]);
+         break;
+      case StagePositionChanged:
+         downstream_->onStagePositionChanged(NameBuffer(text[0]).Get(), v[0]);
+         break;
+      case XYStagePositionChanged:
+         downstream_->onXYStagePositionChanged(NameBuffer(text[0]).Get(),
+               v[0], v[1]);
+         break;
+      case ExposureChanged:
+         downstream_->onExposureChanged(NameBuffer(text[0]).Get(), v[0]);
+         break;
+      case SLMExposureChanged:
+         downstream_->onSLMExposureChanged(NameBuffer(text[0]).Get(), v[0]);
+         break;
+      default:
+         break;
+   }
+}
+
+void
+CallbackDispatcher::onPropertiesChanged()
+{
+   Post(Event(PropertiesChanged, std::string()));
+}
+
+void
+CallbackDispatcher::onPropertyChanged(const char* name, const char* propName,
+      const char* propValue)
+{
+   Event event(PropertyChanged, std::string(name) + '\n' + propName);
+   event.text[0] = name;
+   event.text[1] = propName;
+   event.text[2] = propValue;
+   Post(event);
+}
+
+void
+CallbackDispatcher::onChannelGroupChanged(const char* newChannelGroupName)
+{
+   Event event(ChannelGroupChanged, std::string());
+   event.text[0] = newChannelGroupName;
+   Post(event);
+}
+
+void
+CallbackDispatcher::onConfigGroupChanged(const char* groupName,
+      const char* newConfigName)
+{
+   Event event(ConfigGroupChanged, groupName);
+   event.text[0] = groupName;
+   event.text[1] = newConfigName;
+   Post(event);
+}
+
+void
+CallbackDispatcher::onSystemConfigurationLoaded()
+{
+   Post(Event(SystemConfigurationLoaded, std::string()));
+}
+
+void
+CallbackDispatcher::onPixelSizeChanged(double newPixelSizeUm)
+{
+   Event event(PixelSizeChanged, std::string());
+   event.values[0] = newPixelSizeUm;
+   Post(event);
+}
+
+void
+CallbackDispatcher::onPixelSizeAffineChanged(double v0, double v1, double v2,
+      double v3, double v4, double v5)
+{
+   Event event(PixelSizeAffineChanged, std::string());
+   event.values[0] = v0;
+   event.values[1] = v1;
+   event.values[2] = v2;
+   event.values[3] = v3;
+   event.values[4] = v4;
+   event.values[5] = v5;
+   Post(event);
+}
+
+void
+CallbackDispatcher::onStagePositionChanged(char* name, double pos)
+{
+   Event event(StagePositionChanged, name);
+   event.text[0] = name;
+   event.values[0] = pos;
+   Post(event);
+}
+
+void
+CallbackDispatcher::onXYStagePositionChanged(char* name, double xpos,
+      double ypos)
+{
+   Event event(XYStagePositionChanged, name);
+   event.text[0] = name;
+   event.values[0] = xpos;
+   event.values[1] = ypos;
+   Post(event);
+}
+
+void
+CallbackDispatcher::onExposureChanged(char* name, double newExposure)
+{
+   Event event(ExposureChanged, name);
+   event.text[0] = name;
+   event.values[0] = newExposure;
+   Post(event);
+}
+
+void
+CallbackDispatcher::onSLMExposureChanged(char* name, double newExposure)
+{
+   Event event(SLMExposureChanged, name);
+   event.text[0] = name;
+   event.values[0] = newExposure;
+   Post(event);
+}
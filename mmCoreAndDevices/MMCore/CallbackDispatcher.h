@@ -0,0 +1,158 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          CallbackDispatcher.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Delivers core events to the application on a thread of its own.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+
+
+#pragma once
+
+#include "MMEventCallback.h"
+#include "Logging/Logger.h"
+
+#include <boost/cstdint.hpp>
+#include <boost/thread.hpp>
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <string>
+#include <utility>
+
+/// Delivers the core's events to a downstream callback on a dispatcher thread.
+/**
+ * While started, the dispatcher is registered as the core's callback, and
+ * each event is queued and returns immediately, so that device threads
+ * never wait for the application's listeners. Events are coalesced by what
+ * they describe: a queued event is updated with the latest values of a
+ * later event of the same kind for the same device, property or group (for
+ * example, the latest position of each stage), keeping its place in the
+ * queue. The number of queued events is bounded; an event that would exceed
+ * the bound is dropped.
+ *
+ * The delivery of each kind of event can be limited to a maximum rate, which
+ * applies to each device, property or group separately. Coalescing ensures
+ * that the latest values are always delivered eventually.
+ *
+ * While stopped, events are forwarded synchronously. Stopping delivers the
+ * queued events first. A listener may stop the dispatcher; the queued events
+ * are then delivered after the listener returns, and the dispatcher cannot be
+ * restarted by the same listener.
+ */
+class CallbackDispatcher : public MMEventCallback
+{
+public:
+   enum EventType
+   {
+      PropertiesChanged,
+      PropertyChanged,
+      ChannelGroupChanged,
+      ConfigGroupChanged,
+      SystemConfigurationLoaded,
+      PixelSizeChanged,
+      PixelSizeAffineChanged,
+      StagePositionChanged,
+      XYStagePositionChanged,
+      ExposureChanged,
+      SLMExposureChanged,
+      NumEventTypes
+   };
+
+   // The name of the MMEventCallback method, such as "onPropertyChanged"
+   static const char* GetEventTypeName(EventType type);
+   static bool GetEventTypeByName(const std::string& name, EventType& type);
+
+   static const std::size_t MaxQueuedEvents = 4096;
+
+   explicit CallbackDispatcher(mm::logging::Logger logger);
+   ~CallbackDispatcher();
+
+   void Start();
+   void Stop();
+   bool IsRunning() const;
+
+   // Waits for any event being delivered to the previous callback
+   void SetDownstreamCallback(MMEventCallback* callback);
+   MMEventCallback* GetDownstreamCallback() const;
+
+   // 0 for no limit (the default)
+   void SetMaxRate(EventType type, double eventsPerSecond);
+   double GetMaxRate(EventType type) const;
+
+   // Since started
+   boost::uint64_t GetCoalescedEventCount() const;
+   boost::uint64_t GetDroppedEventCount() const;
+
+   virtual void onPropertiesChanged();
+   virtual void onPropertyChanged(const char* name, const char* propName,
+         const char* propValue);
+   virtual void onChannelGroupChanged(const char* newChannelGroupName);
+   virtual void onConfigGroupChanged(const char* groupName,
+         const char* newConfigName);
+   virtual void onSystemConfigurationLoaded();
+   virtual void onPixelSizeChanged(double newPixelSizeUm);
+   virtual void onPixelSizeAffineChanged(double v0, double v1, double v2,
+         double v3, double v4, double v5);
+   virtual void onStagePositionChanged(char* name, double pos);
+   virtual void onXYStagePositionChanged(char* name, double xpos,
+         double ypos);
+   virtual void onExposureChanged(char* name, double newExposure);
+   virtual void onSLMExposureChanged(char* name, double newExposure);
+
+private:
+   // Events with the same key are coalesced
+   typedef std::pair<EventType, std::string> Key;
+
+   struct Event
+   {
+      Key key;
+      std::string text[3];
+      double values[6];
+
+      Event(EventType type, const std::string& subject);
+   };
+
+   CallbackDispatcher(const CallbackDispatcher&);
+   CallbackDispatcher& operator=(const CallbackDispatcher&);
+
+   void Post(const Event& event);
+   void Deliver(const Event& event);
+   void Run();
+   bool IsDispatcherThread() const;
+   // Must be called with mutex_ held
+   boost::uint64_t ReadyTimeNs(const Event& event) const;
+
+   mm::logging::Logger logger_;
+
+   mutable boost::recursive_mutex deliveryMutex_;
+   MMEventCallback* downstream_; // Synchronized by deliveryMutex_
+
+   mutable boost::mutex mutex_;
+   boost::condition_variable condition_;
+   bool running_;
+   bool stopping_;
+   std::list<Event> queue_;
+   std::map<Key, std::list<Event>::iterator> queued_;
+   std::map<Key, boost::uint64_t> lastDeliveryNs_; // Of rate-limited keys
+   double maxRates_[NumEventTypes];
+   boost::uint64_t coalescedCount_;
+   boost::uint64_t droppedCount_;
+   boost::thread thread_;
+};
@@ -24,13 +24,23 @@
 // AUTHOR:        Nenad Amodaj, nenad@amodaj.com, 01/05/2007
 // 
 #include "CircularBuffer.h"
+#include "CompressedFrameStore.h"
+#include "CoreClock.h"
 #include "CoreUtils.h"
+#include "DiskSink.h"
+#include "SequenceMonitor.h"
+#include "SharedMemoryExport.h"
+#include "SpillFile.h"
 
 #include "TaskSet_CopyMemory.h"
 
 #include "../MMDevice/DeviceUtils.h"
 
 #include <boost/make_shared.hpp>
+#include <boost/thread/thread_time.hpp>
+
+#include <algorithm>
+#include <limits>
 
 
 const long long bytesInMB = 1 << 20;
@@ -41,7 +51,26 @@ const long adjustThreshold = LONG_MAX / 2;
 // division by zero can be added.
 const unsigned long maxCBSize = 10000000;
 
-CircularBuffer::CircularBuffer(unsigned int memorySizeMB) :
+// Frame slots kept (for frames being read) when compression is enabled
+const unsigned long compressedModeCBSize = 4;
+
+// The camera that produced a frame, by which frames are counted
+static std::string CameraLabel(const Metadata* md)
+{
+   if (!md)
+      return std::string();
+   try
+   {
+      return md->GetSingleTag("Camera").GetValue();
+   }
+   catch (const MetadataKeyError&)
+   {
+      return std::string();
+   }
+}
+
+CircularBuffer::CircularBuffer(unsigned int memorySizeMB,
+      boost::shared_ptr<ThreadPool> threadPool) :
    width_(0), 
    height_(0), 
    pixDepth_(0), 
@@ -49,22 +78,39 @@ CircularBuffer::CircularBuffer(unsigned int memorySizeMB) :
    insertIndex_(0), 
    saveIndex_(0), 
    memorySizeMB_(memorySizeMB), 
+   numChannels_(0),
    overflow_(false),
-   threadPool_(boost::make_shared<ThreadPool>()),
-   tasksMemCopy_(boost::make_shared<TaskSet_CopyMemory>(threadPool_))
+   overflowPolicy_(ClearBuffer),
+   overflowBlockTimeoutMs_(1000.0),
+   threadPool_(threadPool ? threadPool : boost::make_shared<ThreadPool>()),
+   tasksMemCopy_(boost::make_shared<TaskSet_CopyMemory>(threadPool_)),
+   shmExport_(boost::make_shared<SharedMemoryExport>(tasksMemCopy_)),
+   monitor_(boost::make_shared<SequenceMonitor>()),
+   compressionEnabled_(false),
+   compressed_(boost::make_shared<CompressedFrameStore>(threadPool_)),
+   spill_(boost::make_shared<SpillFile>()),
+   spillPeakImageCount_(0),
+   spilledImageCount_(0)
 {
+   tiers_[0] = compressed_.get();
+   tiers_[1] = spill_.get();
    facet = new boost::posix_time::time_facet("%Y-%m-%d %H:%M:%s");
    tStream.imbue(std::locale(tStream.getloc(), facet));
+   std::fill(droppedImageCounts_, droppedImageCounts_ + Block + 1, 0);
 }
 
 CircularBuffer::~CircularBuffer() {}
 
 bool CircularBuffer::Initialize(unsigned channels, unsigned int w, unsigned int h, unsigned int pixDepth)
 {
+   boost::lock_guard<boost::mutex> readLock(tierReadMutex_);
    MMThreadGuard guard(g_bufferLock);
    imageNumbers_.clear();
-   boost::posix_time::ptime t = boost::posix_time::microsec_clock::local_time();
-   startTime_ = GetMMTimeNow(t);
+   startTime_ = mm::CoreClock::NowMMTime();
+   std::fill(droppedImageCounts_, droppedImageCounts_ + Block + 1, 0);
+   monitor_->ResetStatistics();
+   // Frames left from before are not counted as lost when cleared
+   overflow_ = false;
 
    bool ret = true;
    try
@@ -84,6 +130,7 @@ bool CircularBuffer::Initialize(unsigned channels, unsigned int w, unsigned int
       insertIndex_ = 0;
       saveIndex_ = 0;
       overflow_ = false;
+      monitor_->ClearQueue();
 
       // calculate the size of the entire buffer array once all images get allocated
       // the actual size at the time of the creation is going to be less, because
@@ -101,6 +148,17 @@ bool CircularBuffer::Initialize(unsigned channels, unsigned int w, unsigned int
       if (cbSize > maxCBSize)
          cbSize = maxCBSize; 
 
+      // In compressed mode, the memory not used by the slots holds
+      // compressed frames
+      unsigned long long arenaBytes = 0;
+      if (compressionEnabled_ && cbSize > compressedModeCBSize)
+      {
+         cbSize = compressedModeCBSize;
+         arenaBytes = std::min<unsigned long long>(
+               memorySizeMB_ * bytesInMB - (long long)cbSize * frameSizeBytes,
+               std::numeric_limits<std::size_t>::max());
+      }
+
       // TODO: verify if we have enough RAM to satisfy this request
 
       for (unsigned long i=0; i<frameArray_.size(); i++)
@@ -113,11 +171,16 @@ bool CircularBuffer::Initialize(unsigned channels, unsigned int w, unsigned int
          frameArray_[i].Resize(w, h, pixDepth);
          frameArray_[i].Preallocate(numChannels_);
       }
+
+      compressed_->Allocate((std::size_t)arenaBytes);
+      ResetTiers();
    }
 
    catch( ... /* std::bad_alloc& ex */)
    {
       frameArray_.resize(0);
+      compressed_->Allocate(0);
+      ResetTiers();
       ret = false;
    }
    return ret;
@@ -125,25 +188,457 @@ bool CircularBuffer::Initialize(unsigned channels, unsigned int w, unsigned int
 
 void CircularBuffer::Clear() 
 {
-   MMThreadGuard guard(g_bufferLock); 
-   insertIndex_=0; 
-   saveIndex_=0; 
-   overflow_ = false;
-   boost::posix_time::ptime t = boost::posix_time::microsec_clock::local_time();
-   startTime_ = GetMMTimeNow(t);
-   imageNumbers_.clear();
+   {
+      boost::lock_guard<boost::mutex> readLock(tierReadMutex_);
+      MMThreadGuard guard(g_bufferLock); 
+      // Clearing an overflowed buffer is how cameras apply the Clear policy
+      if (overflow_ && overflowPolicy_ == ClearBuffer)
+         droppedImageCounts_[ClearBuffer] += GetRemainingImageCount();
+      insertIndex_=0; 
+      saveIndex_=0; 
+      overflow_ = false;
+      startTime_ = mm::CoreClock::NowMMTime();
+      imageNumbers_.clear();
+      monitor_->ClearQueue();
+      ResetTiers();
+   }
+   NotifyRoom();
+}
+
+bool CircularBuffer::ParseOverflowPolicy(const std::string& name, OverflowPolicy& policy)
+{
+   if (name == "Clear")
+      policy = ClearBuffer;
+   else if (name == "DropNewest")
+      policy = DropNewest;
+   else if (name == "DropOldest")
+      policy = DropOldest;
+   else if (name == "Block")
+      policy = Block;
+   else
+      return false;
+   return true;
+}
+
+std::string CircularBuffer::GetOverflowPolicyName(OverflowPolicy policy)
+{
+   switch (policy)
+   {
+      case ClearBuffer: return "Clear";
+      case DropNewest: return "DropNewest";
+      case DropOldest: return "DropOldest";
+      case Block: return "Block";
+   }
+   return std::string();
+}
+
+void CircularBuffer::SetOverflowPolicy(OverflowPolicy policy)
+{
+   {
+      MMThreadGuard guard(g_bufferLock);
+      overflowPolicy_ = policy;
+   }
+   // A blocked insert re-evaluates the policy
+   NotifyRoom();
+}
+
+CircularBuffer::OverflowPolicy CircularBuffer::GetOverflowPolicy() const
+{
+   MMThreadGuard guard(g_bufferLock);
+   return overflowPolicy_;
+}
+
+void CircularBuffer::SetOverflowBlockTimeoutMs(double timeoutMs)
+{
+   MMThreadGuard guard(g_bufferLock);
+   overflowBlockTimeoutMs_ = timeoutMs;
+}
+
+double CircularBuffer::GetOverflowBlockTimeoutMs() const
+{
+   MMThreadGuard guard(g_bufferLock);
+   return overflowBlockTimeoutMs_;
+}
+
+unsigned long CircularBuffer::GetDroppedImageCount(OverflowPolicy policy) const
+{
+   MMThreadGuard guard(g_bufferLock);
+   return droppedImageCounts_[policy];
+}
+
+/**
+* Applies the overflow policy if the buffer is full. Returns false if the
+* frame is to be rejected. Must be called with g_insertLock held, so that the
+* room made cannot be taken by another insert.
+*/
+bool CircularBuffer::MakeRoomForInsert(const std::string& camera)
+{
+   boost::unique_lock<boost::mutex> roomLock(roomMutex_);
+   boost::system_time deadline;
+   for (;;)
+   {
+      bool dropOldest = false;
+      {
+         MMThreadGuard guard(g_bufferLock);
+         if (frameArray_.empty())
+         {
+            overflow_ = true;
+            monitor_->FrameRejected(camera);
+            return false;
+         }
+         if (!IsFull())
+            return true;
+
+         switch (overflowPolicy_)
+         {
+            case DropOldest:
+               // Tier frames are drained without g_bufferLock
+               dropOldest = true;
+               break;
+            case Block:
+               if (deadline.is_not_a_date_time())
+                  deadline = boost::get_system_time() +
+                     boost::posix_time::microseconds(
+                           static_cast<long>(overflowBlockTimeoutMs_ * 1000.0));
+               else if (boost::get_system_time() >= deadline)
+               {
+                  overflow_ = true;
+                  ++droppedImageCounts_[Block];
+                  monitor_->FrameRejected(camera);
+                  return false;
+               }
+               break;
+            case ClearBuffer:
+               // Not lost: the camera clears the buffer, counting the
+               // frames lost then, and inserts the frame again
+               overflow_ = true;
+               return false;
+            case DropNewest:
+            default:
+               overflow_ = true;
+               ++droppedImageCounts_[DropNewest];
+               monitor_->FrameRejected(camera);
+               return false;
+         }
+      }
+      if (dropOldest)
+      {
+         DropOldestFrame();
+         continue;
+      }
+      roomCondition_.timed_wait(roomLock, deadline);
+   }
+}
+
+// Discards the oldest frame, if the buffer is still full
+void CircularBuffer::DropOldestFrame()
+{
+   boost::lock_guard<boost::mutex> readLock(tierReadMutex_);
+   // The oldest frame is in frameArray_ once drained
+   DrainTiers();
+   {
+      MMThreadGuard guard(g_bufferLock);
+      if (!IsFull() || insertIndex_ == saveIndex_)
+         return;
+      ++saveIndex_;
+      ++droppedImageCounts_[DropOldest];
+      monitor_->FrameEvicted();
+   }
+   // Room may have been made in a tier before the one to insert to, in which
+   // case more frames are dropped
+   DrainTiers();
+}
+
+// Must be called without g_bufferLock held
+void CircularBuffer::NotifyRoom()
+{
+   // Taking the mutex ensures a blocked insert is either waiting or has not
+   // yet checked for room
+   {
+      boost::lock_guard<boost::mutex> roomLock(roomMutex_);
+   }
+   roomCondition_.notify_all();
+}
+
+void CircularBuffer::AttachDiskSink(boost::shared_ptr<DiskSink> sink)
+{
+   MMThreadGuard guard(g_insertLock);
+   diskSink_ = sink;
+}
+
+void CircularBuffer::DetachDiskSink()
+{
+   // Once this returns, no insert is writing to the sink any more
+   MMThreadGuard guard(g_insertLock);
+   diskSink_.reset();
+}
+
+void CircularBuffer::GetSequenceStatistics(const std::string& camera, SequenceStatistics& statistics) const
+{
+   monitor_->GetStatistics(camera, statistics);
+}
+
+std::vector<std::string> CircularBuffer::GetSequenceStatisticsCameras() const
+{
+   return monitor_->GetCameras();
+}
+
+void CircularBuffer::EnableCompression(bool enable)
+{
+   MMThreadGuard insertGuard(g_insertLock);
+   boost::lock_guard<boost::mutex> readLock(tierReadMutex_);
+   MMThreadGuard guard(g_bufferLock);
+   if (enable == compressionEnabled_)
+      return;
+   compressionEnabled_ = enable;
+   // Forces the next Initialize() to divide the memory anew
+   frameArray_.clear();
+   insertIndex_ = 0;
+   saveIndex_ = 0;
+   monitor_->ClearQueue();
+   compressed_->Allocate(0);
+   ResetTiers();
+}
+
+bool CircularBuffer::IsCompressionEnabled() const
+{
+   MMThreadGuard guard(g_bufferLock);
+   return compressionEnabled_;
+}
+
+unsigned long CircularBuffer::GetCompressedCapacity() const
+{
+   MMThreadGuard guard(g_bufferLock);
+   return (unsigned long)compressed_->GetCapacity();
+}
+
+unsigned long CircularBuffer::GetCompressedImageCount() const
+{
+   MMThreadGuard guard(g_bufferLock);
+   return (unsigned long)compressed_->GetCount();
+}
+
+double CircularBuffer::GetCompressionRatio() const
+{
+   MMThreadGuard guard(g_bufferLock);
+   if (compressed_->GetCompressedBytes() == 0)
+      return 0.0;
+   return static_cast<double>(compressed_->GetRawBytes()) /
+      static_cast<double>(compressed_->GetCompressedBytes());
+}
+
+void CircularBuffer::EnableSpill(const std::string& path, unsigned sizeMB) throw (CMMError)
+{
+   MMThreadGuard insertGuard(g_insertLock);
+   boost::lock_guard<boost::mutex> readLock(tierReadMutex_);
+   MMThreadGuard guard(g_bufferLock);
+   spill_->Open(path, sizeMB);
+   // The frames in the tiers are discarded; they are the newest ones
+   std::size_t tierImageCount = 0;
+   for (unsigned i = 0; i < tierCount; ++i)
+      tierImageCount += tiers_[i]->GetCount();
+   monitor_->DiscardNewest(tierImageCount);
+   ResetTiers();
+}
+
+void CircularBuffer::DisableSpill()
+{
+   MMThreadGuard insertGuard(g_insertLock);
+   boost::lock_guard<boost::mutex> readLock(tierReadMutex_);
+   MMThreadGuard guard(g_bufferLock);
+   spill_->Close();
+}
+
+bool CircularBuffer::IsSpillEnabled() const
+{
+   MMThreadGuard guard(g_bufferLock);
+   return spill_->IsOpen();
+}
+
+std::string CircularBuffer::GetSpillPath() const
+{
+   MMThreadGuard guard(g_bufferLock);
+   return spill_->IsOpen() ? spill_->GetPath() : std::string();
+}
+
+unsigned CircularBuffer::GetSpillSizeMB() const
+{
+   MMThreadGuard guard(g_bufferLock);
+   return spill_->IsOpen() ? spill_->GetSizeMB() : 0;
+}
+
+unsigned long CircularBuffer::GetSpillCapacity() const
+{
+   MMThreadGuard guard(g_bufferLock);
+   return (unsigned long)spill_->GetCapacity();
+}
+
+unsigned long CircularBuffer::GetSpillImageCount() const
+{
+   MMThreadGuard guard(g_bufferLock);
+   return (unsigned long)spill_->GetCount();
+}
+
+unsigned long CircularBuffer::GetSpillPeakImageCount() const
+{
+   MMThreadGuard guard(g_bufferLock);
+   return spillPeakImageCount_;
+}
+
+unsigned long CircularBuffer::GetSpilledImageCount() const
+{
+   MMThreadGuard guard(g_bufferLock);
+   return spilledImageCount_;
+}
+
+void CircularBuffer::EnableSharedMemoryExport(const std::string& name, unsigned sizeMB) throw (CMMError)
+{
+   MMThreadGuard insertGuard(g_insertLock);
+   shmExport_->Open(name, sizeMB);
+}
+
+void CircularBuffer::DisableSharedMemoryExport()
+{
+   MMThreadGuard insertGuard(g_insertLock);
+   shmExport_->Close();
+}
+
+bool CircularBuffer::IsSharedMemoryExportEnabled() const
+{
+   MMThreadGuard insertGuard(g_insertLock);
+   return shmExport_->IsOpen();
+}
+
+std::string CircularBuffer::GetSharedMemoryExportName() const
+{
+   MMThreadGuard insertGuard(g_insertLock);
+   return shmExport_->GetName();
+}
+
+unsigned CircularBuffer::GetSharedMemoryExportSizeMB() const
+{
+   MMThreadGuard insertGuard(g_insertLock);
+   return shmExport_->GetSizeMB();
+}
+
+unsigned long CircularBuffer::GetSharedMemoryExportedImageCount() const
+{
+   MMThreadGuard insertGuard(g_insertLock);
+   return (unsigned long)shmExport_->GetWrittenImageCount();
+}
+
+bool CircularBuffer::IsRAMFull() const
+{
+   return insertIndex_ - saveIndex_ >= static_cast<long>(frameArray_.size());
+}
+
+/**
+* Finds where the next frame goes: frameArray_ (tier 0) or a tier. Frames go
+* to the last tier holding frames, or to the next usable tier once it is
+* full, so that they are retrieved in order. Returns false if the buffer is
+* full.
+*/
+bool CircularBuffer::FindInsertTier(FrameTier*& tier) const
+{
+   int last = -1;
+   for (unsigned i = 0; i < tierCount; ++i)
+      if (tiers_[i]->GetCount() > 0)
+         last = i;
+
+   tier = 0;
+   if (last < 0 && !IsRAMFull())
+      return true;
+   for (unsigned i = std::max(last, 0); i < tierCount; ++i)
+   {
+      if (tiers_[i]->GetCapacity() > 0 && !tiers_[i]->IsFull())
+      {
+         tier = tiers_[i];
+         return true;
+      }
+   }
+   return false;
+}
+
+bool CircularBuffer::IsFull() const
+{
+   FrameTier* tier;
+   return !FindInsertTier(tier);
+}
+
+void CircularBuffer::ResetTiers()
+{
+   for (unsigned i = 0; i < tierCount; ++i)
+      tiers_[i]->Reset((std::size_t)width_ * height_ * pixDepth_, numChannels_,
+            pixDepth_);
+   spillPeakImageCount_ = 0;
+   spilledImageCount_ = 0;
+}
+
+/**
+* Moves the oldest frames of the tiers into the free slots of frameArray_.
+* The frames are decompressed or copied from the spill file without
+* g_bufferLock, so that inserts and queries go on meanwhile: the tier frame
+* stays in place until popped, and the slot stays free, since frames are
+* inserted to the tiers while they hold any.
+*/
+void CircularBuffer::DrainTiers()
+{
+   for (;;)
+   {
+      FrameTier* tier = 0;
+      mm::FrameBuffer* frame;
+      const unsigned char* stored;
+      unsigned channels;
+      {
+         MMThreadGuard guard(g_bufferLock);
+         if (frameArray_.empty() || IsRAMFull())
+            return;
+         for (unsigned t = 0; t < tierCount && !tier; ++t)
+            if (tiers_[t]->GetCount() > 0)
+               tier = tiers_[t];
+         if (!tier)
+            return;
+         frame = &frameArray_[insertIndex_ % frameArray_.size()];
+         stored = tier->GetFrame(0);
+         channels = (unsigned)tier->GetMetadata(0).size();
+      }
+
+      for (unsigned i = 0; i < channels; ++i)
+      {
+         mm::ImgBuffer* img = frame->FindImage(i);
+         if (img)
+            tier->ReadChannel(stored, channels, i,
+                  const_cast<unsigned char*>(img->GetPixels()));
+      }
+
+      MMThreadGuard guard(g_bufferLock);
+      const std::vector<Metadata>& md = tier->GetMetadata(0);
+      for (unsigned i = 0; i < channels; ++i)
+      {
+         mm::ImgBuffer* img = frame->FindImage(i);
+         if (img)
+            img->SetMetadata(md[i]);
+      }
+      tier->Pop();
+      ++insertIndex_;
+   }
 }
 
 unsigned long CircularBuffer::GetSize() const
 {
    MMThreadGuard guard(g_bufferLock);
-   return (unsigned long)frameArray_.size();
+   std::size_t size = frameArray_.size();
+   for (unsigned i = 0; i < tierCount; ++i)
+      size += tiers_[i]->GetCapacity();
+   return (unsigned long)size;
 }
 
 unsigned long CircularBuffer::GetFreeSize() const
 {
    MMThreadGuard guard(g_bufferLock);
    long freeSize = (long)frameArray_.size() - (insertIndex_ - saveIndex_);
+   for (unsigned i = 0; i < tierCount; ++i)
+      freeSize += (long)tiers_[i]->GetCapacity() - (long)tiers_[i]->GetCount();
    if (freeSize < 0)
       return 0;
    else
@@ -153,9 +648,11 @@ unsigned long CircularBuffer::GetFreeSize() const
 unsigned long CircularBuffer::GetRemainingImageCount() const
 {
    MMThreadGuard guard(g_bufferLock);
-   return (unsigned long)(insertIndex_ - saveIndex_);
+   long count = insertIndex_ - saveIndex_;
+   for (unsigned i = 0; i < tierCount; ++i)
+      count += (long)tiers_[i]->GetCount();
+   return (unsigned long)count;
 }
-
 /**
 * Inserts a single image in the buffer.
 */
@@ -184,6 +681,30 @@ bool CircularBuffer::InsertImage(const unsigned char* pixArray, unsigned int wid
 * Inserts a multi-channel frame in the buffer.
 */
 bool CircularBuffer::InsertMultiChannel(const unsigned char* pixArray, unsigned int numChannels, unsigned int width, unsigned int height, unsigned int byteDepth, unsigned int nComponents, const Metadata* pMd) throw (CMMError)
+{
+   return InsertChannels(pixArray, 0, 0, pMd, 0, numChannels, width, height, byteDepth, nComponents);
+}
+
+/**
+* Inserts a multi-channel frame in the buffer, taking the pixels and the
+* metadata of each channel from separate buffers.
+*/
+bool CircularBuffer::InsertMultiChannel(const unsigned char* const* channelPixels, const Metadata* channelMetadata, unsigned int numChannels, unsigned int width, unsigned int height, unsigned int byteDepth, unsigned int nComponents) throw (CMMError)
+{
+   return InsertChannels(0, channelPixels, 0, 0, channelMetadata, numChannels, width, height, byteDepth, nComponents);
+}
+
+/**
+* Inserts a multi-channel frame in the buffer, letting source write the
+* pixels of each channel in place. The metadata of each channel is taken
+* from channelMetadata.
+*/
+bool CircularBuffer::InsertMultiChannel(const ChannelSource& source, const Metadata* channelMetadata, unsigned int numChannels, unsigned int width, unsigned int height, unsigned int byteDepth, unsigned int nComponents) throw (CMMError)
+{
+   return InsertChannels(0, 0, &source, 0, channelMetadata, numChannels, width, height, byteDepth, nComponents);
+}
+
+bool CircularBuffer::InsertChannels(const unsigned char* pixArray, const unsigned char* const* channelPixels, const ChannelSource* source, const Metadata* pMd, const Metadata* channelMetadata, unsigned int numChannels, unsigned int width, unsigned int height, unsigned int byteDepth, unsigned int nComponents) throw (CMMError)
 {
     MMThreadGuard guard(g_insertLock);
  
@@ -196,11 +717,22 @@ bool CircularBuffer::InsertMultiChannel(const unsigned char* pixArray, unsigned
        // check image dimensions
        if (width != width_ || height != height_ || byteDepth != pixDepth_)
           throw CMMError("Incompatible image dimensions in the circular buffer", MMERR_CircularBufferIncompatibleImage);
- 
-       bool overflowed = (insertIndex_ - saveIndex_) >= static_cast<long>(frameArray_.size());
-       if (overflowed) {
-          overflow_ = true;
-          return false;
+    }
+
+    const std::string camera = CameraLabel(channelMetadata ? channelMetadata : pMd);
+    if (!MakeRoomForInsert(camera))
+       return false;
+
+    FrameTier* tier = 0;
+    unsigned char* tierSlot = 0;
+    std::vector<Metadata> tierMetadata;
+    {
+       MMThreadGuard guard(g_bufferLock);
+       if (FindInsertTier(tier) && tier)
+       {
+          if (numChannels > numChannels_)
+             return false;
+          tierSlot = tier->GetBackSlot();
        }
     }
  
@@ -210,33 +742,38 @@ bool CircularBuffer::InsertMultiChannel(const unsigned char* pixArray, unsigned
        {
           MMThreadGuard guard(g_bufferLock);
           // we assume that all buffers are pre-allocated
-          pImg = frameArray_[insertIndex_ % frameArray_.size()].FindImage(i);
-          if (!pImg)
+          pImg = tierSlot ? 0 : frameArray_[insertIndex_ % frameArray_.size()].FindImage(i);
+          if (!pImg && !tierSlot)
              return false;
  
-          if (pMd)
+          if (channelMetadata)
+             md = channelMetadata[i];
+          else if (pMd)
           {
              // TODO: the same metadata is inserted for each channel ???
              // Perhaps we need to add specific tags to each channel
              md = *pMd;
           }
 
-         std::string cameraName = md.GetSingleTag("Camera").GetValue();
-         if (imageNumbers_.end() == imageNumbers_.find(cameraName))
+         // Channels of a frame may come from the same camera; number them
+         // separately so that the image number counts frames
+         std::pair<std::string, unsigned> stream(
+               md.GetSingleTag("Camera").GetValue(), i);
+         if (imageNumbers_.end() == imageNumbers_.find(stream))
          {
-            imageNumbers_[cameraName] = 0;
+            imageNumbers_[stream] = 0;
          }
 
          // insert image number. 
-         md.put(MM::g_Keyword_Metadata_ImageNumber, CDeviceUtils::ConvertToString(imageNumbers_[cameraName]));
-         ++imageNumbers_[cameraName];
+         md.put(MM::g_Keyword_Metadata_ImageNumber, CDeviceUtils::ConvertToString(imageNumbers_[stream]));
+         ++imageNumbers_[stream];
       }
 
-      boost::posix_time::ptime t = boost::posix_time::microsec_clock::local_time();
+      boost::posix_time::ptime t = mm::CoreClock::NowPtime();
       if (!md.HasTag(MM::g_Keyword_Elapsed_Time_ms))
       {
          // if time tag was not supplied by the camera insert current timestamp
-         MM::MMTime timestamp = GetMMTimeNow(t);
+         MM::MMTime timestamp = mm::CoreClock::NowMMTime();
          md.PutImageTag(MM::g_Keyword_Elapsed_Time_ms, CDeviceUtils::ConvertToString((timestamp - startTime_).getMsec()));
       }
       tStream << t;
@@ -262,20 +799,65 @@ bool CircularBuffer::InsertMultiChannel(const unsigned char* pixArray, unsigned
       else
          md.PutImageTag("PixelType","Unknown"); 
 
-      pImg->SetMetadata(md);
       //pImg->SetPixels(pixArray + i * singleChannelSize);
       // TODO: In MMCore the ImgBuffer::GetPixels() returns const pointer.
       //       It would be better to have something like ImgBuffer::GetPixelsRW() in MMDevice.
       //       Or even better - pass tasksMemCopy_ to ImgBuffer constructor
       //       and utilize parallel copy also in single snap acquisitions.
-      tasksMemCopy_->MemCopy((void*)pImg->GetPixels(),
-            pixArray + i * singleChannelSize, singleChannelSize);
+      unsigned char* dest = tierSlot ? tierSlot + i * singleChannelSize :
+         const_cast<unsigned char*>(pImg->GetPixels());
+      const unsigned char* channelPix;
+      if (source)
+      {
+         source->CopyChannel(i, dest);
+         channelPix = dest;
+      }
+      else
+      {
+         channelPix = channelPixels ? channelPixels[i] :
+            pixArray + i * singleChannelSize;
+         tasksMemCopy_->MemCopy(dest, channelPix, singleChannelSize);
+      }
+
+      // Published before the metadata are stored, so that the image in the
+      // buffer can be matched with the shared copy
+      boost::uint64_t shmImageNumber;
+      if (shmExport_->IsOpen() && shmExport_->WriteImage(channelPix,
+               singleChannelSize, width, height, byteDepth, nComponents, i, md,
+               shmImageNumber))
+         md.PutImageTag(SharedMemoryExport::ImageNumberTag,
+               CDeviceUtils::ConvertToString(static_cast<long>(shmImageNumber)));
+
+      if (tierSlot)
+         tierMetadata.push_back(md);
+      else
+         pImg->SetMetadata(md);
+
+      if (diskSink_)
+         diskSink_->WriteFrame(channelPix,
+               singleChannelSize, width, height, byteDepth, nComponents, i, md);
    }
 
+   // Compression runs without blocking readers
+   if (tierSlot)
+      tier->StoreBack(numChannels);
+
    {
       MMThreadGuard guard(g_bufferLock);
 
       imageCounter_++;
+      monitor_->FrameInserted(camera, mm::CoreClock::MonotonicNs());
+      if (tierSlot)
+      {
+         tier->Push(tierMetadata);
+         if (tier == spill_.get())
+         {
+            ++spilledImageCount_;
+            spillPeakImageCount_ = std::max(spillPeakImageCount_,
+                  static_cast<unsigned long>(spill_->GetCount()));
+         }
+         return true;
+      }
       insertIndex_++;
       if ((insertIndex_ - (long)frameArray_.size()) > adjustThreshold && (saveIndex_- (long)frameArray_.size()) > adjustThreshold)
       {
@@ -310,18 +892,71 @@ const mm::ImgBuffer* CircularBuffer::GetNthFromTopImageBuffer(unsigned long n) c
 const mm::ImgBuffer* CircularBuffer::GetNthFromTopImageBuffer(long n,
       unsigned channel) const
 {
-   MMThreadGuard guard(g_bufferLock);
+   boost::lock_guard<boost::mutex> readLock(tierReadMutex_);
+   FrameTier* tier = 0;
+   const unsigned char* stored = 0;
+   unsigned channels = 0;
+   Metadata md;
+   unsigned width, height, pixDepth;
+   {
+      MMThreadGuard guard(g_bufferLock);
 
-   long availableImages = insertIndex_ - saveIndex_;
-   if (n + 1 > availableImages)
-      return 0;
+      // The most recent frames are in the last tier holding frames, if any
+      for (unsigned t = tierCount; t-- > 0 && !tier; )
+      {
+         const long count = (long)tiers_[t]->GetCount();
+         if (n >= count)
+         {
+            n -= count;
+            continue;
+         }
+         const std::size_t index = (std::size_t)(count - 1 - n);
+         const std::vector<Metadata>& channelMetadata =
+            tiers_[t]->GetMetadata(index);
+         if (channel >= channelMetadata.size())
+            return 0;
+         tier = tiers_[t];
+         stored = tier->GetFrame(index);
+         channels = (unsigned)channelMetadata.size();
+         md = channelMetadata[channel];
+         width = width_;
+         height = height_;
+         pixDepth = pixDepth_;
+      }
+
+      if (!tier)
+      {
+         long availableImages = insertIndex_ - saveIndex_;
+         if (n + 1 > availableImages)
+            return 0;
 
-   long targetIndex = insertIndex_ - n - 1L;
-   while (targetIndex < 0)
-      targetIndex += (long) frameArray_.size();
-   targetIndex %= frameArray_.size();
+         long targetIndex = insertIndex_ - n - 1L;
+         while (targetIndex < 0)
+            targetIndex += (long) frameArray_.size();
+         targetIndex %= frameArray_.size();
 
-   return frameArray_[targetIndex].FindImage(channel);
+         return frameArray_[targetIndex].FindImage(channel);
+      }
+   }
+
+   // Decompressed or copied without g_bufferLock, to the frame of the
+   // calling thread; the tier frame stays in place while tierReadMutex_ is
+   // held
+   mm::FrameBuffer* frame = tierPeekFrames_.get();
+   if (!frame)
+   {
+      frame = new mm::FrameBuffer();
+      tierPeekFrames_.reset(frame);
+   }
+   if (frame->Width() != width || frame->Height() != height ||
+         frame->Depth() != pixDepth)
+      frame->Resize(width, height, pixDepth);
+   frame->Preallocate(channel + 1);
+   mm::ImgBuffer* img = frame->FindImage(channel);
+   tier->ReadChannel(stored, channels, channel,
+         const_cast<unsigned char*>(img->GetPixels()));
+   img->SetMetadata(md);
+   return img;
 }
 
 const unsigned char* CircularBuffer::GetNextImage()
@@ -334,13 +969,21 @@ const unsigned char* CircularBuffer::GetNextImage()
 
 const mm::ImgBuffer* CircularBuffer::GetNextImageBuffer(unsigned channel)
 {
-   MMThreadGuard guard(g_bufferLock);
-
-   long availableImages = insertIndex_ - saveIndex_;
-   if (availableImages < 1)
-      return 0;
+   const mm::ImgBuffer* img;
+   {
+      boost::lock_guard<boost::mutex> readLock(tierReadMutex_);
+      DrainTiers();
 
-   long targetIndex = saveIndex_ % frameArray_.size();
-   ++saveIndex_;
-   return frameArray_[targetIndex].FindImage(channel);
+      MMThreadGuard guard(g_bufferLock);
+      long availableImages = insertIndex_ - saveIndex_;
+      if (availableImages < 1)
+         return 0;
+
+      long targetIndex = saveIndex_ % frameArray_.size();
+      ++saveIndex_;
+      monitor_->FramePopped(mm::CoreClock::MonotonicNs());
+      img = frameArray_[targetIndex].FindImage(channel);
+   }
+   NotifyRoom();
+   return img;
 }
@@ -33,7 +33,13 @@
 
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/smart_ptr/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
 
+#include <map>
+#include <string>
+#include <utility>
 #include <vector>
 
 #ifdef _MSC_VER
@@ -41,13 +47,42 @@
 #endif
 
 
+class CompressedFrameStore;
+class DiskSink;
+class FrameTier;
+class SequenceMonitor;
+class SequenceStatistics;
+class SharedMemoryExport;
+class SpillFile;
 class ThreadPool;
 class TaskSet_CopyMemory;
 
 class CircularBuffer
 {
 public:
-   CircularBuffer(unsigned int memorySizeMB);
+   // Fills the channels of an inserted frame directly in the buffer, for
+   // frames whose channels are computed from another image
+   class ChannelSource
+   {
+   public:
+      virtual ~ChannelSource() {}
+      virtual void CopyChannel(unsigned channel, unsigned char* dest) const = 0;
+   };
+
+   // What happens to an inserted frame when the buffer is full
+   enum OverflowPolicy
+   {
+      ClearBuffer, // ("Clear") Reject the frame and flag the overflow; the
+                   // camera then clears the buffer and inserts it again
+      DropNewest,  // Reject the frame and flag the overflow
+      DropOldest,  // Discard the oldest unread frame to make room
+      Block        // Wait for room, rejecting the frame after a timeout
+   };
+
+   // Copies and compression run on threadPool, or on a pool of the buffer's
+   // own if none is given
+   CircularBuffer(unsigned int memorySizeMB,
+         boost::shared_ptr<ThreadPool> threadPool = boost::shared_ptr<ThreadPool>());
    ~CircularBuffer();
 
    unsigned GetMemorySizeMB() const { return memorySizeMB_; }
@@ -65,6 +100,13 @@ public:
    bool InsertMultiChannel(const unsigned char* pixArray, unsigned int numChannels, unsigned int width, unsigned int height, unsigned int byteDepth, const Metadata* pMd) throw (CMMError);
    bool InsertImage(const unsigned char* pixArray, unsigned int width, unsigned int height, unsigned int byteDepth, unsigned int nComponents, const Metadata* pMd) throw (CMMError);
    bool InsertMultiChannel(const unsigned char* pixArray, unsigned int numChannels, unsigned int width, unsigned int height, unsigned int byteDepth, unsigned int nComponents, const Metadata* pMd) throw (CMMError);
+   // Insert a multi-channel frame whose channels are held in separate buffers,
+   // each with its own metadata (arrays of numChannels elements)
+   bool InsertMultiChannel(const unsigned char* const* channelPixels, const Metadata* channelMetadata, unsigned int numChannels, unsigned int width, unsigned int height, unsigned int byteDepth, unsigned int nComponents) throw (CMMError);
+   // Insert a multi-channel frame whose channels are written by source
+   bool InsertMultiChannel(const ChannelSource& source, const Metadata* channelMetadata, unsigned int numChannels, unsigned int width, unsigned int height, unsigned int byteDepth, unsigned int nComponents) throw (CMMError);
+   // Frames held in a tier (see below) are returned in a frame of the
+   // calling thread, valid until its next call for a tier frame
    const unsigned char* GetTopImage() const;
    const unsigned char* GetNextImage();
    const mm::ImgBuffer* GetTopImageBuffer(unsigned channel) const;
@@ -75,16 +117,94 @@ public:
 
    bool Overflow() {MMThreadGuard guard(g_bufferLock); return overflow_;}
 
+   static bool ParseOverflowPolicy(const std::string& name, OverflowPolicy& policy);
+   static std::string GetOverflowPolicyName(OverflowPolicy policy);
+
+   void SetOverflowPolicy(OverflowPolicy policy);
+   OverflowPolicy GetOverflowPolicy() const;
+   void SetOverflowBlockTimeoutMs(double timeoutMs);
+   double GetOverflowBlockTimeoutMs() const;
+   // Frames lost to the given policy since the buffer was last initialized
+   unsigned long GetDroppedImageCount(OverflowPolicy policy) const;
+
+   // Optional tiers for frames that do not fit in the frame slots, in this
+   // order: compressed in memory, then in a memory-mapped file. Frames are
+   // moved back to the slots, in order, as frames are retrieved. A frame
+   // moved back takes the place of the frame last returned by
+   // GetNextImageBuffer(), which is therefore only valid until the next call.
+
+   // While compression is enabled, Initialize() keeps only a few frame slots
+   // and uses the rest of the memory for compressed frames. Takes effect at
+   // the next Initialize(); discards all frames if changed.
+   void EnableCompression(bool enable);
+   bool IsCompressionEnabled() const;
+   // Estimated from the compression ratio so far
+   unsigned long GetCompressedCapacity() const;
+   unsigned long GetCompressedImageCount() const;
+   // Raw over compressed size of the frames compressed since the buffer was
+   // last cleared or initialized; 0 if none
+   double GetCompressionRatio() const;
+
+   void EnableSpill(const std::string& path, unsigned sizeMB) throw (CMMError);
+   void DisableSpill();
+   bool IsSpillEnabled() const;
+   // Empty and 0 if not enabled
+   std::string GetSpillPath() const;
+   unsigned GetSpillSizeMB() const;
+   unsigned long GetSpillCapacity() const;
+   unsigned long GetSpillImageCount() const;
+   // Since the buffer was last cleared or initialized
+   unsigned long GetSpillPeakImageCount() const;
+   unsigned long GetSpilledImageCount() const;
+
+   // Images inserted while enabled are also published in a POSIX
+   // shared-memory segment (see MMCoreShm/MMCoreShm.h)
+   void EnableSharedMemoryExport(const std::string& name, unsigned sizeMB) throw (CMMError);
+   void DisableSharedMemoryExport();
+   bool IsSharedMemoryExportEnabled() const;
+   // Empty and 0 if not enabled
+   std::string GetSharedMemoryExportName() const;
+   unsigned GetSharedMemoryExportSizeMB() const;
+   // Since enabled
+   unsigned long GetSharedMemoryExportedImageCount() const;
+
+   // Frames inserted while a sink is attached are also streamed to disk
+   void AttachDiskSink(boost::shared_ptr<DiskSink> sink);
+   void DetachDiskSink();
+
+   // Per-camera counts and latencies of the frames since the buffer was last
+   // initialized; clearing keeps them. Does not wait for inserts or retrievals.
+   void GetSequenceStatistics(const std::string& camera, SequenceStatistics& statistics) const;
+   // Cameras that have inserted frames
+   std::vector<std::string> GetSequenceStatisticsCameras() const;
+
    mutable MMThreadLock g_bufferLock;
    mutable MMThreadLock g_insertLock;
 
 private:
+   bool MakeRoomForInsert(const std::string& camera);
+   void DropOldestFrame();
+   void NotifyRoom();
+   // The following must be called with g_bufferLock held
+   bool IsRAMFull() const;
+   bool FindInsertTier(FrameTier*& tier) const;
+   bool IsFull() const;
+   void ResetTiers();
+   // Must be called with tierReadMutex_ held and g_bufferLock not held
+   void DrainTiers();
+
+   bool InsertChannels(const unsigned char* pixArray, const unsigned char* const* channelPixels,
+         const ChannelSource* source,
+         const Metadata* pMd, const Metadata* channelMetadata, unsigned int numChannels,
+         unsigned int width, unsigned int height, unsigned int byteDepth,
+         unsigned int nComponents) throw (CMMError);
+
    unsigned int width_;
    unsigned int height_;
    unsigned int pixDepth_;
    long imageCounter_;
    MM::MMTime startTime_;
-   std::map<std::string, long> imageNumbers_;
+   std::map<std::pair<std::string, unsigned>, long> imageNumbers_; // By camera and channel
 
    // Invariants:
    // 0 <= saveIndex_ <= insertIndex_
@@ -97,9 +217,39 @@ private:
    bool overflow_;
    std::vector<mm::FrameBuffer> frameArray_;
 
+   OverflowPolicy overflowPolicy_;
+   double overflowBlockTimeoutMs_;
+   unsigned long droppedImageCounts_[Block + 1]; // By policy
+
+   // Signaled when images are removed, to wake up a blocked insert. Always
+   // acquired before g_bufferLock.
+   boost::mutex roomMutex_;
+   boost::condition_variable roomCondition_;
+
+   // Held while frames of the tiers are read, which is done without
+   // g_bufferLock, and while they are popped or the tiers are reset.
+   // Acquired after roomMutex_ and before g_bufferLock.
+   mutable boost::mutex tierReadMutex_;
+
    boost::shared_ptr<ThreadPool> threadPool_;
    boost::shared_ptr<TaskSet_CopyMemory> tasksMemCopy_;
 
+   boost::shared_ptr<DiskSink> diskSink_; // Synchronized by g_insertLock
+   boost::shared_ptr<SharedMemoryExport> shmExport_; // Synchronized by g_insertLock
+   boost::shared_ptr<SequenceMonitor> monitor_; // Updated with g_bufferLock held
+
+   bool compressionEnabled_;
+   boost::shared_ptr<CompressedFrameStore> compressed_;
+   boost::shared_ptr<SpillFile> spill_;
+   unsigned long spillPeakImageCount_;
+   unsigned long spilledImageCount_;
+   // Frames in each tier were all inserted after those in frameArray_ and in
+   // the previous tiers
+   static const unsigned tierCount = 2;
+   FrameTier* tiers_[tierCount];
+   // Return tier frames by n from top, one per thread
+   mutable boost::thread_specific_ptr<mm::FrameBuffer> tierPeekFrames_;
+
    boost::posix_time::time_facet * facet;
    std::ostringstream tStream;
 };
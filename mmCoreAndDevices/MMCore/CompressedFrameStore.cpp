@@ -0,0 +1,271 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          CompressedFrameStore.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Compressed in-memory overflow tier of the circular buffer.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+
+#include "CompressedFrameStore.h"
+
+#include <boost/make_shared.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Large enough to compress well, small enough to spread a frame over the
+// threads of the pool
+const std::size_t blockBytes = 256 * 1024;
+
+const boost::uint32_t rawBlockFlag = 0x80000000U;
+
+inline boost::uint32_t ReadBlockSize(const unsigned char* record, std::size_t block)
+{
+   boost::uint32_t size;
+   memcpy(&size, record + block * sizeof(size), sizeof(size));
+   return size;
+}
+
+} // anonymous namespace
+
+
+CompressedFrameStore::CompressedFrameStore(boost::shared_ptr<ThreadPool> pool) :
+   arenaBytes_(0),
+   channelBytes_(0),
+   maxChannels_(0),
+   elementBytes_(1),
+   usedBytes_(0),
+   backOffset_(0),
+   backBytes_(0),
+   storedImageCount_(0),
+   rawBytes_(0),
+   compressedBytes_(0),
+   encoder_(boost::make_shared<TaskSet_FrameCodec>(pool)),
+   decoder_(boost::make_shared<TaskSet_FrameCodec>(pool))
+{
+}
+
+CompressedFrameStore::~CompressedFrameStore()
+{
+}
+
+void CompressedFrameStore::Allocate(std::size_t bytes)
+{
+   records_.clear();
+   usedBytes_ = 0;
+   arena_.reset();
+   arenaBytes_ = 0;
+   if (bytes > 0)
+   {
+      // Not initialized, so that pages are committed only once used
+      arena_.reset(new unsigned char[bytes]);
+      arenaBytes_ = bytes;
+   }
+}
+
+void CompressedFrameStore::Reset(std::size_t channelBytes, unsigned maxChannels,
+      unsigned elementBytes)
+{
+   records_.clear();
+   usedBytes_ = 0;
+   storedImageCount_ = 0;
+   rawBytes_ = 0;
+   compressedBytes_ = 0;
+   channelBytes_ = channelBytes;
+   maxChannels_ = maxChannels;
+   elementBytes_ = std::max(elementBytes, 1U);
+   if (arena_)
+      backSlot_.resize(channelBytes * maxChannels);
+   else
+      std::vector<unsigned char>().swap(backSlot_);
+}
+
+std::size_t CompressedFrameStore::GetBlocksPerChannel() const
+{
+   return (channelBytes_ + blockBytes - 1) / blockBytes;
+}
+
+std::size_t CompressedFrameStore::GetBlockBytes(std::size_t block) const
+{
+   return std::min(blockBytes, channelBytes_ - block * blockBytes);
+}
+
+std::size_t CompressedFrameStore::GetMaxRecordBytes() const
+{
+   return maxChannels_ * (GetBlocksPerChannel() * sizeof(boost::uint32_t) +
+         channelBytes_);
+}
+
+std::size_t CompressedFrameStore::GetCapacity() const
+{
+   if (!arena_ || channelBytes_ == 0 || maxChannels_ == 0)
+      return 0;
+   if (storedImageCount_ == 0)
+      return arenaBytes_ / GetMaxRecordBytes();
+   const double meanBytes = static_cast<double>(compressedBytes_) /
+      static_cast<double>(storedImageCount_);
+   return static_cast<std::size_t>(arenaBytes_ / meanBytes);
+}
+
+// Finds contiguous free space after the newest frame, wrapping to the start
+// of the arena if needed
+bool CompressedFrameStore::FindSpace(std::size_t bytes, std::size_t& offset) const
+{
+   if (records_.empty())
+   {
+      offset = 0;
+      return bytes <= arenaBytes_;
+   }
+   const std::size_t front = records_.front().offset;
+   const std::size_t end = records_.back().offset + records_.back().bytes;
+   if (records_.back().offset >= front)
+   {
+      if (arenaBytes_ - end >= bytes)
+      {
+         offset = end;
+         return true;
+      }
+      offset = 0;
+      return front >= bytes;
+   }
+   offset = end;
+   return front - end >= bytes;
+}
+
+bool CompressedFrameStore::IsFull() const
+{
+   if (!arena_ || channelBytes_ == 0 || maxChannels_ == 0)
+      return true;
+   std::size_t offset;
+   return !FindSpace(GetMaxRecordBytes(), offset);
+}
+
+unsigned char* CompressedFrameStore::GetBackSlot()
+{
+   if (IsFull())
+      return 0;
+   FindSpace(GetMaxRecordBytes(), backOffset_);
+   return &backSlot_[0];
+}
+
+void CompressedFrameStore::StoreBack(unsigned channels)
+{
+   const std::size_t blocksPerChannel = GetBlocksPerChannel();
+   const std::size_t blockCount = channels * blocksPerChannel;
+   unsigned char* record = arena_.get() + backOffset_;
+   unsigned char* data = record + blockCount * sizeof(boost::uint32_t);
+
+   // Each block is compressed in place of its uncompressed copy, which it
+   // must be smaller than, and then moved down
+   encodeBlocks_.resize(blockCount);
+   std::size_t rawOffset = 0;
+   for (std::size_t i = 0; i < blockCount; ++i)
+   {
+      TaskSet_FrameCodec::Block& block = encodeBlocks_[i];
+      const std::size_t channel = i / blocksPerChannel;
+      const std::size_t channelBlock = i % blocksPerChannel;
+      block.src = &backSlot_[channel * channelBytes_ + channelBlock * blockBytes];
+      block.srcBytes = GetBlockBytes(channelBlock);
+      block.dst = data + rawOffset;
+      block.dstBytes = block.srcBytes - 1;
+      block.raw = false;
+      rawOffset += block.srcBytes;
+   }
+   encoder_->Compress(encodeBlocks_, elementBytes_);
+
+   std::size_t offset = 0;
+   for (std::size_t i = 0; i < blockCount; ++i)
+   {
+      const TaskSet_FrameCodec::Block& block = encodeBlocks_[i];
+      boost::uint32_t size;
+      if (block.raw)
+      {
+         size = static_cast<boost::uint32_t>(block.srcBytes);
+         memcpy(data + offset, block.src, size);
+         size |= rawBlockFlag;
+      }
+      else
+      {
+         size = static_cast<boost::uint32_t>(block.dstBytes);
+         memmove(data + offset, block.dst, size);
+      }
+      memcpy(record + i * sizeof(size), &size, sizeof(size));
+      offset += size & ~rawBlockFlag;
+   }
+   backBytes_ = blockCount * sizeof(boost::uint32_t) + offset;
+}
+
+void CompressedFrameStore::Push(const std::vector<Metadata>& channelMetadata)
+{
+   Record frame;
+   frame.offset = backOffset_;
+   frame.bytes = backBytes_;
+   frame.metadata = channelMetadata;
+   records_.push_back(frame);
+   usedBytes_ += backBytes_;
+
+   ++storedImageCount_;
+   rawBytes_ += channelBytes_ * channelMetadata.size();
+   compressedBytes_ += backBytes_;
+}
+
+const std::vector<Metadata>& CompressedFrameStore::GetMetadata(std::size_t index) const
+{
+   return records_[index].metadata;
+}
+
+const unsigned char* CompressedFrameStore::GetFrame(std::size_t index) const
+{
+   return arena_.get() + records_[index].offset;
+}
+
+void CompressedFrameStore::ReadChannel(const unsigned char* record,
+      unsigned channels, unsigned channel, unsigned char* dest) const
+{
+   const std::size_t blocksPerChannel = GetBlocksPerChannel();
+   const unsigned char* data = record +
+      channels * blocksPerChannel * sizeof(boost::uint32_t);
+
+   const std::size_t firstBlock = channel * blocksPerChannel;
+   for (std::size_t i = 0; i < firstBlock; ++i)
+      data += ReadBlockSize(record, i) & ~rawBlockFlag;
+
+   decodeBlocks_.resize(blocksPerChannel);
+   for (std::size_t i = 0; i < blocksPerChannel; ++i)
+   {
+      const boost::uint32_t size = ReadBlockSize(record, firstBlock + i);
+      TaskSet_FrameCodec::Block& block = decodeBlocks_[i];
+      block.src = data;
+      block.srcBytes = size & ~rawBlockFlag;
+      block.dst = dest + i * blockBytes;
+      block.dstBytes = GetBlockBytes(i);
+      block.raw = (size & rawBlockFlag) != 0;
+      data += block.srcBytes;
+   }
+   decoder_->Decompress(decodeBlocks_, elementBytes_);
+}
+
+void CompressedFrameStore::Pop()
+{
+   if (records_.empty())
+      return;
+   usedBytes_ -= records_.front().bytes;
+   records_.pop_front();
+}
@@ -0,0 +1,128 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          CompressedFrameStore.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Compressed in-memory overflow tier of the circular buffer.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+
+#pragma once
+
+#include "FrameTier.h"
+#include "TaskSet_FrameCodec.h"
+
+#include "../MMDevice/ImageMetadata.h"
+
+#include <boost/cstdint.hpp>
+#include <boost/smart_ptr/scoped_array.hpp>
+#include <boost/smart_ptr/shared_ptr.hpp>
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+class ThreadPool;
+
+/// A FIFO of losslessly compressed frames in a preallocated memory arena.
+/**
+ * Used by the circular buffer to hold more frames in memory than fit
+ * uncompressed. Each channel is divided into blocks, which are compressed
+ * with FrameCodec in parallel on the thread pool. Frames take variable space
+ * in the arena, used as a ring; a frame is stored only where the whole
+ * frame would fit uncompressed.
+ *
+ * A stored frame is the size of each block (the top bit set if the block is
+ * stored uncompressed), followed by the blocks.
+ */
+class CompressedFrameStore : public FrameTier
+{
+public:
+   explicit CompressedFrameStore(boost::shared_ptr<ThreadPool> pool);
+   ~CompressedFrameStore();
+
+   // Replaces the arena, discarding all frames; 0 frees it. Throws
+   // std::bad_alloc.
+   void Allocate(std::size_t bytes);
+   std::size_t GetArenaBytes() const { return arenaBytes_; }
+
+   virtual void Reset(std::size_t channelBytes, unsigned maxChannels,
+         unsigned elementBytes);
+   // Estimated from the compressed size of the frames stored so far
+   virtual std::size_t GetCapacity() const;
+   virtual std::size_t GetCount() const { return records_.size(); }
+   virtual bool IsFull() const;
+
+   virtual unsigned char* GetBackSlot();
+   virtual void StoreBack(unsigned channels);
+   virtual void Push(const std::vector<Metadata>& channelMetadata);
+   virtual const std::vector<Metadata>& GetMetadata(std::size_t index) const;
+   virtual const unsigned char* GetFrame(std::size_t index) const;
+   virtual void ReadChannel(const unsigned char* frame, unsigned channels,
+         unsigned channel, unsigned char* dest) const;
+   virtual void Pop();
+
+   // Of the frames held
+   std::size_t GetUsedBytes() const { return usedBytes_; }
+   // Of all frames stored since the last Reset()
+   boost::uint64_t GetStoredImageCount() const { return storedImageCount_; }
+   boost::uint64_t GetRawBytes() const { return rawBytes_; }
+   boost::uint64_t GetCompressedBytes() const { return compressedBytes_; }
+
+private:
+   CompressedFrameStore(const CompressedFrameStore&);
+   CompressedFrameStore& operator=(const CompressedFrameStore&);
+
+   struct Record
+   {
+      std::size_t offset;
+      std::size_t bytes;
+      std::vector<Metadata> metadata;
+   };
+
+   std::size_t GetBlocksPerChannel() const;
+   std::size_t GetBlockBytes(std::size_t block) const;
+   std::size_t GetMaxRecordBytes() const;
+   bool FindSpace(std::size_t bytes, std::size_t& offset) const;
+
+   boost::scoped_array<unsigned char> arena_;
+   std::size_t arenaBytes_;
+
+   std::size_t channelBytes_;
+   unsigned maxChannels_;
+   unsigned elementBytes_;
+
+   std::deque<Record> records_;
+   std::size_t usedBytes_;
+
+   // The frame being inserted: uncompressed, then in the arena at
+   // backOffset_
+   std::vector<unsigned char> backSlot_;
+   std::size_t backOffset_;
+   std::size_t backBytes_;
+
+   boost::uint64_t storedImageCount_;
+   boost::uint64_t rawBytes_;
+   boost::uint64_t compressedBytes_;
+
+   // Separate task sets (and scratch buffers) for the inserting thread and
+   // for readers
+   boost::shared_ptr<TaskSet_FrameCodec> encoder_;
+   boost::shared_ptr<TaskSet_FrameCodec> decoder_;
+   std::vector<TaskSet_FrameCodec::Block> encodeBlocks_;
+   mutable std::vector<TaskSet_FrameCodec::Block> decodeBlocks_;
+};
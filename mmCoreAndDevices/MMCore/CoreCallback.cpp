@@ -28,11 +28,17 @@
 #include "../MMDevice/DeviceThreads.h"
 #include "../MMDevice/DeviceUtils.h"
 #include "../MMDevice/ImgBuffer.h"
+#include "AcquisitionEngine.h"
 #include "CircularBuffer.h"
 #include "CoreCallback.h"
+#include "CoreClock.h"
 #include "DeviceManager.h"
+#include "FrameCombiner.h"
+#include "FrameDemultiplexer.h"
+#include "FrameSynchronizer.h"
 
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread/locks.hpp>
 #include <string>
 #include <vector>
 
@@ -222,6 +228,7 @@ CoreCallback::AddCameraMetadata(const MM::Device* caller, const Metadata* pMd)
 
    std::string label = camera->GetLabel();
    newMD.put("Camera", label);
+   core_->acqEngine_->TagImage(newMD);
 
    std::string serializedMD;
    try
@@ -240,6 +247,72 @@ CoreCallback::AddCameraMetadata(const MM::Device* caller, const Metadata* pMd)
    return newMD;
 }
 
+/**
+ * Insert an image into the circular buffer, passing it through the frame
+ * combiner and then the frame demultiplexer or synchronizer when these are
+ * enabled.
+ */
+bool
+CoreCallback::InsertIntoBuffer(const MM::Device* caller,
+      const unsigned char* buf, unsigned width, unsigned height,
+      unsigned byteDepth, unsigned nComponents, const Metadata& md)
+{
+   const bool combine = core_->frameCombiner_->IsEnabled();
+   const bool demultiplex = core_->frameDemux_->IsEnabled();
+   const bool synchronize = core_->frameSync_->IsEnabled();
+   if (!combine && !demultiplex && !synchronize)
+      return core_->cbuf_->InsertImage(buf, width, height, byteDepth,
+            nComponents, &md);
+
+   std::string label = core_->deviceManager_->GetDevice(caller)->GetLabel();
+
+   // Only every Nth frame yields a combined frame to pass on
+   FrameCombiner::FramePtr combined;
+   const Metadata* pMd = &md;
+   if (combine)
+   {
+      combined = core_->frameCombiner_->AddFrame(label, buf, width, height,
+            byteDepth, nComponents, md);
+      if (!combined)
+         return true;
+      buf = &combined->pixels[0];
+      width = combined->width;
+      height = combined->height;
+      byteDepth = combined->byteDepth;
+      pMd = &combined->md;
+   }
+
+   if (demultiplex)
+      return core_->frameDemux_->InsertImage(*core_->cbuf_, buf, width,
+            height, byteDepth, nComponents, *pMd);
+   if (synchronize)
+   {
+      // The camera would insert the image into the synchronizer again
+      const bool clearOnOverflow = core_->cbuf_->GetOverflowPolicy() ==
+         CircularBuffer::ClearBuffer && !core_->stopOnOverflow_;
+      return core_->frameSync_->InsertImage(*core_->cbuf_, label, buf,
+            width, height, byteDepth, nComponents, *pMd, clearOnOverflow);
+   }
+   return core_->cbuf_->InsertImage(buf, width, height, byteDepth,
+         nComponents, pMd);
+}
+
+/**
+ * The status returned to a camera for an image the circular buffer rejected.
+ * Under the Clear overflow policy, the camera is told of the overflow, so
+ * that it stops or clears the buffer and inserts the image again. Under the
+ * other policies, the buffer has already counted the image as lost, and only
+ * a camera that stops on overflow is told, so that it stops.
+ */
+int
+CoreCallback::RejectedInsertStatus() const
+{
+   if (core_->cbuf_->GetOverflowPolicy() == CircularBuffer::ClearBuffer ||
+         core_->stopOnOverflow_)
+      return DEVICE_BUFFER_OVERFLOW;
+   return DEVICE_OK;
+}
+
 int CoreCallback::InsertImage(const MM::Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, const char* serializedMetadata, const bool doProcess)
 {
    Metadata md;
@@ -261,10 +334,10 @@ int CoreCallback::InsertImage(const MM::Device* caller, const unsigned char* buf
             ip->Process(const_cast<unsigned char*>(buf), width, height, byteDepth);
          }
       }
-      if (core_->cbuf_->InsertImage(buf, width, height, byteDepth, &md))
+      if (InsertIntoBuffer(caller, buf, width, height, byteDepth, 1, md))
          return DEVICE_OK;
       else
-         return DEVICE_BUFFER_OVERFLOW;
+         return RejectedInsertStatus();
    }
    catch (CMMError& /*e*/)
    {
@@ -293,10 +366,69 @@ int CoreCallback::InsertImage(const MM::Device* caller, const unsigned char* buf
             ip->Process(const_cast<unsigned char*>(buf), width, height, byteDepth);
          }
       }
-      if (core_->cbuf_->InsertImage(buf, width, height, byteDepth, nComponents, &md))
+      if (InsertIntoBuffer(caller, buf, width, height, byteDepth, nComponents, md))
          return DEVICE_OK;
       else
-         return DEVICE_BUFFER_OVERFLOW;
+         return RejectedInsertStatus();
+   }
+   catch (CMMError& /*e*/)
+   {
+      return DEVICE_INCOMPATIBLE_IMAGE;
+   }
+}
+
+namespace
+{
+
+// Lets an image writer fill a circular buffer slot directly
+class WriterChannelSource : public CircularBuffer::ChannelSource
+{
+public:
+   explicit WriterChannelSource(const MM::ImageWriter& writer) :
+      writer_(writer)
+   {}
+
+   virtual void CopyChannel(unsigned, unsigned char* dest) const
+   {
+      writer_.WriteImage(dest);
+   }
+
+private:
+   const MM::ImageWriter& writer_;
+};
+
+} // anonymous namespace
+
+int CoreCallback::InsertImage(const MM::Device* caller, const MM::ImageWriter& writer, unsigned width, unsigned height, unsigned byteDepth, unsigned nComponents, const Metadata* pMd)
+{
+   try
+   {
+      Metadata md = AddCameraMetadata(caller, pMd);
+
+      MM::ImageProcessor* ip = GetImageProcessor(caller);
+      const bool direct = (ip == NULL) &&
+         !core_->frameCombiner_->IsEnabled() &&
+         !core_->frameDemux_->IsEnabled() &&
+         !core_->frameSync_->IsEnabled();
+      bool inserted;
+      if (direct)
+      {
+         WriterChannelSource source(writer);
+         inserted = core_->cbuf_->InsertMultiChannel(source, &md, 1,
+               width, height, byteDepth, nComponents);
+      }
+      else
+      {
+         // The image must exist before it can be processed
+         std::vector<unsigned char> pixels(
+               (std::size_t)width * height * byteDepth);
+         writer.WriteImage(&pixels[0]);
+         if (ip != NULL)
+            ip->Process(&pixels[0], width, height, byteDepth);
+         inserted = InsertIntoBuffer(caller, &pixels[0], width, height,
+               byteDepth, nComponents, md);
+      }
+      return inserted ? DEVICE_OK : RejectedInsertStatus();
    }
    catch (CMMError& /*e*/)
    {
@@ -330,7 +462,7 @@ bool CoreCallback::InitializeImageBuffer(unsigned channels, unsigned slices,
    if (slices != 1)
       return false;
 
-   return core_->cbuf_->Initialize(channels, w, h, pixDepth);
+   return core_->initializeCircularBufferFor(channels, w, h, pixDepth);
 }
 
 int CoreCallback::InsertMultiChannel(const MM::Device* caller,
@@ -353,7 +485,7 @@ int CoreCallback::InsertMultiChannel(const MM::Device* caller,
       if (core_->cbuf_->InsertMultiChannel(buf, numChannels, width, height, byteDepth, &md))
          return DEVICE_OK;
       else
-         return DEVICE_BUFFER_OVERFLOW;
+         return RejectedInsertStatus();
    }
    catch (CMMError& /*e*/)
    {
@@ -448,8 +580,11 @@ int CoreCallback::PrepareForAcq(const MM::Device* /*caller*/)
  */
 int CoreCallback::OnPropertiesChanged(const MM::Device* /* caller */)
 {
-   if (core_->externalCallback_)
-      core_->externalCallback_->onPropertiesChanged();
+   {
+      boost::shared_lock<boost::shared_mutex> lock(core_->externalCallbackMutex_);
+      if (core_->externalCallback_)
+         core_->externalCallback_->onPropertiesChanged();
+   }
 
    // TODO It is inconsistent that we do not update the system state cache in
    // this case. However, doing so would be time-consuming (if not unsafe).
@@ -474,7 +609,11 @@ int CoreCallback::OnPropertyChanged(const MM::Device* device, const char* propNa
          MMThreadGuard scg(core_->stateCacheLock_);
          core_->stateCache_.addSetting(*ps);
       }
-      core_->externalCallback_->onPropertyChanged(label, propName, value);
+      {
+         boost::shared_lock<boost::shared_mutex> lock(core_->externalCallbackMutex_);
+         if (core_->externalCallback_)
+            core_->externalCallback_->onPropertyChanged(label, propName, value);
+      }
 
       // Find all configs that contain this property and callback to indicate 
       // that the config group changed
@@ -540,6 +679,7 @@ int CoreCallback::OnPropertyChanged(const MM::Device* device, const char* propNa
  */
 int CoreCallback::OnConfigGroupChanged(const char* groupName, const char* newConfigName)
 {
+   boost::shared_lock<boost::shared_mutex> lock(core_->externalCallbackMutex_);
    if (core_->externalCallback_) {
       core_->externalCallback_->onConfigGroupChanged(groupName, newConfigName);
    }
@@ -552,6 +692,7 @@ int CoreCallback::OnConfigGroupChanged(const char* groupName, const char* newCon
  */
 int CoreCallback::OnPixelSizeChanged(double newPixelSizeUm)
 {
+   boost::shared_lock<boost::shared_mutex> lock(core_->externalCallbackMutex_);
    if (core_->externalCallback_) {
       core_->externalCallback_->onPixelSizeChanged(newPixelSizeUm);
    }
@@ -565,6 +706,7 @@ int CoreCallback::OnPixelSizeChanged(double newPixelSizeUm)
  */
 int CoreCallback::OnPixelSizeAffineChanged(std::vector<double> newPixelSizeAffine)
 {
+   boost::shared_lock<boost::shared_mutex> lock(core_->externalCallbackMutex_);
    if (core_->externalCallback_ && newPixelSizeAffine.size() == 6) {
       core_->externalCallback_->onPixelSizeAffineChanged(newPixelSizeAffine[0],
             newPixelSizeAffine[1],
@@ -582,6 +724,17 @@ int CoreCallback::OnPixelSizeAffineChanged(std::vector<double> newPixelSizeAffin
  */
 int CoreCallback::OnStagePositionChanged(const MM::Device* device, double pos)
 {
+   try
+   {
+      core_->deviceManager_->GetDeviceOfType<StageInstance>(
+            core_->deviceManager_->GetDevice(device))->
+         GetPositionCache().Store(pos);
+   }
+   catch (const CMMError&) // Unregistered or not a stage
+   {
+   }
+
+   boost::shared_lock<boost::shared_mutex> lock(core_->externalCallbackMutex_);
    if (core_->externalCallback_) {
       char label[MM::MaxStrLength];
       device->GetLabel(label);
@@ -596,6 +749,17 @@ int CoreCallback::OnStagePositionChanged(const MM::Device* device, double pos)
  */
 int CoreCallback::OnXYStagePositionChanged(const MM::Device* device, double xPos, double yPos)
 {
+   try
+   {
+      core_->deviceManager_->GetDeviceOfType<XYStageInstance>(
+            core_->deviceManager_->GetDevice(device))->
+         GetPositionCache().Store(xPos, yPos);
+   }
+   catch (const CMMError&) // Unregistered or not an XY stage
+   {
+   }
+
+   boost::shared_lock<boost::shared_mutex> lock(core_->externalCallbackMutex_);
    if (core_->externalCallback_) {
       char label[MM::MaxStrLength];
       device->GetLabel(label);
@@ -611,6 +775,7 @@ int CoreCallback::OnXYStagePositionChanged(const MM::Device* device, double xPos
  */
 int CoreCallback::OnExposureChanged(const MM::Device* device, double newExposure)
 {
+   boost::shared_lock<boost::shared_mutex> lock(core_->externalCallbackMutex_);
    if (core_->externalCallback_) {
       char label[MM::MaxStrLength];
       device->GetLabel(label);
@@ -625,6 +790,7 @@ int CoreCallback::OnExposureChanged(const MM::Device* device, double newExposure
  */
 int CoreCallback::OnSLMExposureChanged(const MM::Device* device, double newExposure)
 {
+   boost::shared_lock<boost::shared_mutex> lock(core_->externalCallbackMutex_);
    if (core_->externalCallback_) {
       MMThreadGuard g(*pValueChangeLock_);
       char label[MM::MaxStrLength];
@@ -963,6 +1129,21 @@ int CoreCallback::GetCurrentConfig(const char* group, int bufLen, char* name)
    return DEVICE_OK;
 }
 
+int CoreCallback::GetCurrentConfigFromCache(const char* group, int bufLen, char* name)
+{
+   try
+   {
+      std::string cfgName = core_->getCurrentConfigFromCache(group);
+      strncpy(name, cfgName.c_str(), bufLen);
+   }
+   catch (...)
+   {
+      return DEVICE_CORE_CONFIG_FAILED;
+   }
+
+   return DEVICE_OK;
+}
+
 int CoreCallback::GetChannelConfig(char* channelConfigName, const unsigned int channelConfigIterator)
 {
    if (0 == channelConfigName)
@@ -1067,15 +1248,18 @@ void CoreCallback::ClearPostedErrors()
 unsigned long CoreCallback::GetClockTicksUs(const MM::Device* /*caller*/)
 {
 	using namespace boost::posix_time;
-	using namespace boost::gregorian;
-	boost::posix_time::ptime t = boost::posix_time::microsec_clock::local_time();
-	boost::gregorian::date today( day_clock::local_day());
-	boost::posix_time::ptime timet_start(today); 
+	boost::posix_time::ptime t = mm::CoreClock::NowPtime();
+	boost::posix_time::ptime timet_start(t.date());
 	time_duration diff = t - timet_start; 
 	return (unsigned long) diff.total_microseconds();
 }
 
 MM::MMTime CoreCallback::GetCurrentMMTime()
-{		
-	return GetMMTimeNow();
+{
+   return mm::CoreClock::NowMMTime();
+}
+
+unsigned long long CoreCallback::GetMonotonicTimeNs()
+{
+   return mm::CoreClock::MonotonicNs();
 }
@@ -81,6 +81,7 @@ public:
 
 	// MMTime, in epoch beginning at 2000 01 01
    MM::MMTime GetCurrentMMTime();
+   unsigned long long GetMonotonicTimeNs();
 
    void Sleep(const MM::Device* caller, double intervalMs);
 
@@ -88,6 +89,7 @@ public:
    int InsertImage(const MM::Device* caller, const ImgBuffer& imgBuf); // Note: _not_ mm::ImgBuffer
    int InsertImage(const MM::Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, const char* serializedMetadata, const bool doProcess = true);
    int InsertImage(const MM::Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, unsigned nComponents, const char* serializedMetadata, const bool doProcess = true);
+   int InsertImage(const MM::Device* caller, const MM::ImageWriter& writer, unsigned width, unsigned height, unsigned byteDepth, unsigned nComponents, const Metadata* pMd = 0);
 
    /*Deprecated*/ int InsertImage(const MM::Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, const Metadata* pMd = 0, const bool doProcess = true);
    /*Deprecated*/ int InsertImage(const MM::Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, unsigned nComponents, const Metadata* pMd = 0, const bool doProcess = true);
@@ -112,6 +114,7 @@ public:
    int GetExposure(double& expMs);
    int SetConfig(const char* group, const char* name);
    int GetCurrentConfig(const char* group, int bufLen, char* name);
+   int GetCurrentConfigFromCache(const char* group, int bufLen, char* name);
    int GetChannelConfig(char* channelConfigName, const unsigned int channelConfigIterator);
 
    // notification handlers
@@ -143,6 +146,10 @@ private:
    MMThreadLock* pValueChangeLock_;
 
    Metadata AddCameraMetadata(const MM::Device* caller, const Metadata* pMd);
+   bool InsertIntoBuffer(const MM::Device* caller, const unsigned char* buf,
+         unsigned width, unsigned height, unsigned byteDepth,
+         unsigned nComponents, const Metadata& md);
+   int RejectedInsertStatus() const;
 
    int OnConfigGroupChanged(const char* groupName, const char* newConfigName);
    int OnPixelSizeChanged(double newPixelSizeUm);
@@ -0,0 +1,137 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          CoreClock.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Monotonic high-resolution clock with a wall-clock anchor
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "CoreClock.h"
+
+#include "../MMDevice/MMDevice.h"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread/once.hpp>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <mach/mach_time.h>
+#else
+#include <time.h>
+#endif
+
+namespace mm
+{
+
+namespace
+{
+
+#ifdef _WIN32
+LARGE_INTEGER g_PerfFrequency;
+#elif defined(__APPLE__)
+mach_timebase_info_data_t g_Timebase;
+#endif
+
+struct Anchor
+{
+   unsigned long long monotonicNs;
+   long long wallUs; // Since 2000-01-01, local time
+   boost::posix_time::ptime wallTime;
+};
+
+Anchor g_Anchor;
+boost::once_flag g_InitFlag = BOOST_ONCE_INIT;
+
+unsigned long long ReadMonotonicNs()
+{
+#ifdef _WIN32
+   LARGE_INTEGER count;
+   QueryPerformanceCounter(&count);
+   const unsigned long long ticks = count.QuadPart;
+   const unsigned long long freq = g_PerfFrequency.QuadPart;
+   // Split to avoid overflowing the multiplication
+   return (ticks / freq) * 1000000000ULL + (ticks % freq) * 1000000000ULL / freq;
+#elif defined(__APPLE__)
+   return mach_absolute_time() * g_Timebase.numer / g_Timebase.denom;
+#else
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+void Initialize()
+{
+#ifdef _WIN32
+   QueryPerformanceFrequency(&g_PerfFrequency);
+#elif defined(__APPLE__)
+   mach_timebase_info(&g_Timebase);
+#endif
+
+   // Take the wall time between two monotonic readings, to halve the error
+   // from being descheduled in between
+   const unsigned long long before = ReadMonotonicNs();
+   const boost::posix_time::ptime wall =
+      boost::posix_time::microsec_clock::local_time();
+   const unsigned long long after = ReadMonotonicNs();
+
+   g_Anchor.monotonicNs = before + (after - before) / 2;
+   g_Anchor.wallTime = wall;
+   const boost::posix_time::ptime epoch(boost::gregorian::date(2000, 1, 1));
+   g_Anchor.wallUs = (wall - epoch).total_microseconds();
+}
+
+inline const Anchor& GetAnchor()
+{
+   boost::call_once(g_InitFlag, &Initialize);
+   return g_Anchor;
+}
+
+} // anonymous namespace
+
+
+unsigned long long CoreClock::MonotonicNs()
+{
+   GetAnchor();
+   return ReadMonotonicNs();
+}
+
+MM::MMTime CoreClock::NowMMTime()
+{
+   return ToMMTime(MonotonicNs());
+}
+
+MM::MMTime CoreClock::ToMMTime(unsigned long long monotonicNs)
+{
+   const Anchor& anchor = GetAnchor();
+   const long long us = anchor.wallUs +
+      ((long long)monotonicNs - (long long)anchor.monotonicNs) / 1000;
+   return MM::MMTime((long)(us / 1000000), (long)(us % 1000000));
+}
+
+boost::posix_time::ptime CoreClock::NowPtime()
+{
+   const Anchor& anchor = GetAnchor();
+   const long long us =
+      ((long long)ReadMonotonicNs() - (long long)anchor.monotonicNs) / 1000;
+   // seconds() and microseconds() take a long, which is 32 bits on Windows
+   return anchor.wallTime + boost::posix_time::seconds((long)(us / 1000000)) +
+      boost::posix_time::microseconds((long)(us % 1000000));
+}
+
+} // namespace mm
@@ -0,0 +1,67 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          CoreClock.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Monotonic high-resolution clock with a wall-clock anchor
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include <boost/date_time/posix_time/ptime.hpp>
+
+namespace MM
+{
+   class MMTime;
+}
+
+namespace mm
+{
+
+/// Time source for the core and, through MM::Core, for device adapters.
+/**
+ * Time is read from the operating system's monotonic counter
+ * (CLOCK_MONOTONIC, mach_absolute_time() or QueryPerformanceCounter(), all
+ * of which are TSC-based on current hardware and avoid a system call).
+ *
+ * Wall-clock values are derived from a single anchor: the local time and the
+ * monotonic counter are sampled together the first time the clock is used,
+ * and later wall-clock times are the anchor plus the elapsed monotonic time.
+ * Wall-clock times therefore never go backwards and are not affected by
+ * daylight saving changes or NTP adjustments after startup, and reading them
+ * does not involve the C library's time zone conversion.
+ */
+class CoreClock
+{
+public:
+   /// Nanoseconds since an arbitrary, fixed origin.
+   static unsigned long long MonotonicNs();
+
+   /// Local time in microseconds since 2000-01-01 (the MMTime epoch).
+   static MM::MMTime NowMMTime();
+
+   /// Local time.
+   static boost::posix_time::ptime NowPtime();
+
+   /// Convert a MonotonicNs() value to MMTime.
+   static MM::MMTime ToMMTime(unsigned long long monotonicNs);
+
+private:
+   CoreClock();
+};
+
+} // namespace mm
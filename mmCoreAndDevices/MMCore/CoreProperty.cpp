@@ -28,11 +28,44 @@
 #include "CoreUtils.h"
 #include "MMCore.h"
 #include "Error.h"
+#include "SequenceStatistics.h"
 #include "../MMDevice/DeviceUtils.h"
 #include <assert.h>
 #include <stdlib.h>
 using namespace std;
 
+// Read-only properties holding the sequence statistics of the current camera
+static bool GetSequenceStatistic(CMMCore* core, const char* propName, string& value)
+{
+   const char* const names[] = {
+      MM::g_Keyword_CoreSequenceInsertsPerSecond,
+      MM::g_Keyword_CoreSequencePopsPerSecond,
+      MM::g_Keyword_CoreSequenceQueueDepth,
+      MM::g_Keyword_CoreSequenceQueueDepthHighWaterMark,
+      MM::g_Keyword_CoreSequenceOverflowCount,
+      MM::g_Keyword_CoreSequenceMeanResidenceMs,
+   };
+   unsigned i = 0;
+   const unsigned count = sizeof(names) / sizeof(names[0]);
+   while (i < count && strcmp(propName, names[i]) != 0)
+      ++i;
+   if (i == count)
+      return false;
+
+   const SequenceStatistics stats =
+      core->getSequenceStatistics(core->getCameraDevice().c_str());
+   switch (i)
+   {
+      case 0: value = CDeviceUtils::ConvertToString(stats.getInsertsPerSecond()); break;
+      case 1: value = CDeviceUtils::ConvertToString(stats.getPopsPerSecond()); break;
+      case 2: value = CDeviceUtils::ConvertToString(stats.getQueueDepth()); break;
+      case 3: value = CDeviceUtils::ConvertToString(stats.getQueueDepthHighWaterMark()); break;
+      case 4: value = CDeviceUtils::ConvertToString(stats.getOverflowCount()); break;
+      default: value = CDeviceUtils::ConvertToString(stats.getMeanResidenceMs()); break;
+   }
+   return true;
+}
+
 vector<string> CoreProperty::GetAllowedValues() const
 {
    vector<string> allowedVals;
@@ -181,6 +214,9 @@ string CorePropertyCollection::Get(const char* propName) const
             ToString(propName) + ")",
             MMERR_InvalidCoreProperty);
 
+   string value;
+   if (GetSequenceStatistic(core_, propName, value))
+      return value;
    return it->second.Get();
 }
 
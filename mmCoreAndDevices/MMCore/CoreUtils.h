@@ -25,6 +25,8 @@
 
 #pragma once
 
+#include "CoreClock.h"
+
 #include "../MMDevice/MMDevice.h"
 
 // suppress hideous boost warnings
@@ -108,6 +110,6 @@ inline MM::MMTime GetMMTimeNow(boost::posix_time::ptime t0)
 //NB we are starting the 'epoch' on 2000 01 01
 inline MM::MMTime GetMMTimeNow()
 {
-   return GetMMTimeNow(boost::posix_time::microsec_clock::local_time());
+   return mm::CoreClock::NowMMTime();
 }
 
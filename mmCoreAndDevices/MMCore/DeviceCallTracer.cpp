@@ -0,0 +1,484 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          DeviceCallTracer.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Latency instrumentation of device calls.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+
+#include "DeviceCallTracer.h"
+
+#include "CoreClock.h"
+
+#include <boost/make_shared.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <set>
+
+
+namespace {
+
+const char* const methodNames[DeviceCallTracer::NumMethods] =
+{
+   "GetProperty",
+   "SetProperty",
+   "Busy",
+   "Initialize",
+   "Shutdown",
+   "SnapImage",
+   "GetImageBuffer",
+   "StartSequenceAcquisition",
+   "StopSequenceAcquisition",
+   "SetExposure",
+   "GetExposure",
+   "SetPosition",
+   "GetPosition",
+   "SetRelativePosition",
+   "Home",
+   "Stop",
+   "SetOpen",
+   "GetOpen",
+};
+
+// Threads are numbered in the order they first make a traced call (in any
+// core), starting from 1. Numbers are never reused.
+boost::atomic<boost::uint64_t> g_lastThreadNumber(0);
+boost::thread_specific_ptr<boost::uint64_t> g_threadNumber;
+
+boost::uint64_t CurrentThreadNumber()
+{
+   boost::uint64_t* number = g_threadNumber.get();
+   if (!number)
+   {
+      number = new boost::uint64_t(++g_lastThreadNumber);
+      g_threadNumber.reset(number);
+   }
+   return *number;
+}
+
+unsigned HistogramBucket(boost::uint64_t durationNs)
+{
+   boost::uint64_t us = durationNs / 1000;
+   unsigned bucket = 0;
+   while (us > 0 && bucket < DeviceCallTracer::NumHistogramBuckets - 1)
+   {
+      us >>= 1;
+      ++bucket;
+   }
+   return bucket;
+}
+
+void WriteJSONString(std::ostream& out, const std::string& s)
+{
+   out << '"';
+   for (std::string::const_iterator it = s.begin(); it != s.end(); ++it)
+   {
+      const unsigned char c = static_cast<unsigned char>(*it);
+      if (c == '"' || c == '\\')
+         out << '\\' << *it;
+      else if (c < 0x20)
+      {
+         char escaped[8];
+         std::sprintf(escaped, "\\u%04x", c);
+         out << escaped;
+      }
+      else
+         out << *it;
+   }
+   out << '"';
+}
+
+// Trace event timestamps are in microseconds
+void WriteMicroseconds(std::ostream& out, boost::uint64_t ns)
+{
+   char s[32];
+   std::sprintf(s, "%llu.%03u", static_cast<unsigned long long>(ns / 1000),
+         static_cast<unsigned>(ns % 1000));
+   out << s;
+}
+
+void WriteCompleteEvent(std::ostream& out, const char* name,
+      const std::string& category, boost::uint64_t threadNumber,
+      boost::uint64_t startNs, boost::uint64_t durationNs)
+{
+   out << "{\"name\":\"" << name << "\",\"cat\":";
+   WriteJSONString(out, category);
+   out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << threadNumber << ",\"ts\":";
+   WriteMicroseconds(out, startNs);
+   out << ",\"dur\":";
+   WriteMicroseconds(out, durationNs);
+   out << '}';
+}
+
+} // anonymous namespace
+
+
+const char*
+DeviceCallTracer::GetMethodName(Method method)
+{
+   if (method < 0 || method >= NumMethods)
+      return "";
+   return methodNames[method];
+}
+
+bool
+DeviceCallTracer::GetMethodByName(const std::string& name, Method& method)
+{
+   for (int i = 0; i < NumMethods; ++i)
+   {
+      if (name == methodNames[i])
+      {
+         method = static_cast<Method>(i);
+         return true;
+      }
+   }
+   return false;
+}
+
+
+DeviceCallTracer::Device::Device(DeviceCallTracer* tracer, boost::uint32_t id,
+      const std::string& label) :
+   tracer_(tracer),
+   id_(id),
+   label_(label)
+{
+   Reset();
+}
+
+void
+DeviceCallTracer::Device::Reset()
+{
+   for (int m = 0; m < NumMethods; ++m)
+   {
+      Counters& c = counters_[m];
+      for (unsigned b = 0; b < NumHistogramBuckets; ++b)
+         c.buckets[b].store(0, boost::memory_order_relaxed);
+      c.count.store(0, boost::memory_order_relaxed);
+      c.totalNs.store(0, boost::memory_order_relaxed);
+      c.maxNs.store(0, boost::memory_order_relaxed);
+      c.lockWaitNs.store(0, boost::memory_order_relaxed);
+   }
+}
+
+
+DeviceCallTracer::Call::Call(Device* device, Method method) :
+   device_(0),
+   method_(method),
+   startNs_(0)
+{
+   if (device && device->GetTracer()->IsEnabled())
+   {
+      device_ = device;
+      startNs_ = mm::CoreClock::MonotonicNs();
+   }
+}
+
+DeviceCallTracer::Call::~Call()
+{
+   if (device_)
+      device_->GetTracer()->Record(*device_, method_, startNs_,
+            mm::CoreClock::MonotonicNs());
+}
+
+
+DeviceCallTracer::ThreadSlots::ThreadSlots()
+{
+   for (std::size_t i = 0; i < maxThreads; ++i)
+   {
+      threads[i].store(0);
+      buffers[i].store(0);
+   }
+}
+
+DeviceCallTracer::ThreadSlots::~ThreadSlots()
+{
+   for (std::size_t i = 0; i < maxThreads; ++i)
+      delete buffers[i].load();
+}
+
+
+DeviceCallTracer::SlotLease::SlotLease(boost::shared_ptr<ThreadSlots> slots,
+      std::size_t slot, ThreadBuffer* buffer) :
+   slots(slots),
+   slot(slot),
+   buffer(buffer)
+{
+}
+
+DeviceCallTracer::SlotLease::~SlotLease()
+{
+   slots->threads[slot].store(0, boost::memory_order_release);
+}
+
+
+DeviceCallTracer::DeviceCallTracer() :
+   enabled_(false),
+   clearedAtNs_(0),
+   slots_(boost::make_shared<ThreadSlots>())
+{
+}
+
+DeviceCallTracer::~DeviceCallTracer()
+{
+   for (std::vector<Device*>::iterator it = devices_.begin(),
+         end = devices_.end(); it != end; ++it)
+      delete *it;
+}
+
+void
+DeviceCallTracer::Clear()
+{
+   // Events are discarded lazily, as the buffers belong to their threads
+   clearedAtNs_.store(mm::CoreClock::MonotonicNs());
+
+   boost::mutex::scoped_lock lock(devicesMutex_);
+   for (std::vector<Device*>::iterator it = devices_.begin(),
+         end = devices_.end(); it != end; ++it)
+      (*it)->Reset();
+}
+
+DeviceCallTracer::Device*
+DeviceCallTracer::RegisterDevice(const std::string& label)
+{
+   boost::mutex::scoped_lock lock(devicesMutex_);
+   std::map<std::string, Device*>::iterator found =
+      devicesByLabel_.find(label);
+   if (found != devicesByLabel_.end())
+      return found->second;
+
+   Device* device = new Device(this,
+         static_cast<boost::uint32_t>(devices_.size()), label);
+   devices_.push_back(device);
+   devicesByLabel_[label] = device;
+   return device;
+}
+
+void
+DeviceCallTracer::RecordLockWait(boost::uint64_t startNs,
+      boost::uint64_t endNs)
+{
+   ThreadBuffer* buffer = GetThreadBuffer();
+   if (!buffer)
+      return;
+   buffer->pendingLockWaitStartNs = startNs;
+   buffer->pendingLockWaitNs = endNs - startNs;
+}
+
+void
+DeviceCallTracer::Record(Device& device, Method method,
+      boost::uint64_t startNs, boost::uint64_t endNs)
+{
+   const boost::uint64_t durationNs = endNs - startNs;
+
+   ThreadBuffer* buffer = GetThreadBuffer();
+   boost::uint64_t lockWaitStartNs = 0, lockWaitNs = 0;
+   if (buffer)
+   {
+      lockWaitStartNs = buffer->pendingLockWaitStartNs;
+      lockWaitNs = buffer->pendingLockWaitNs;
+      buffer->pendingLockWaitStartNs = buffer->pendingLockWaitNs = 0;
+
+      const boost::uint64_t n =
+         buffer->written.load(boost::memory_order_relaxed);
+      Event& e = buffer->events[n & (eventsPerThread - 1)];
+      e.startNs = startNs;
+      e.durationNs = durationNs;
+      e.lockWaitStartNs = lockWaitStartNs;
+      e.lockWaitNs = lockWaitNs;
+      e.thread = buffer->threadNumber;
+      e.device = device.id_;
+      e.method = method;
+      buffer->written.store(n + 1, boost::memory_order_release);
+   }
+
+   Device::Counters& c = device.counters_[method];
+   c.buckets[HistogramBucket(durationNs)].fetch_add(1,
+         boost::memory_order_relaxed);
+   c.count.fetch_add(1, boost::memory_order_relaxed);
+   c.totalNs.fetch_add(durationNs, boost::memory_order_relaxed);
+   c.lockWaitNs.fetch_add(lockWaitNs, boost::memory_order_relaxed);
+   boost::uint64_t maxNs = c.maxNs.load(boost::memory_order_relaxed);
+   while (durationNs > maxNs &&
+         !c.maxNs.compare_exchange_weak(maxNs, durationNs,
+            boost::memory_order_relaxed))
+   {}
+}
+
+DeviceCallTracer::ThreadBuffer*
+DeviceCallTracer::GetThreadBuffer()
+{
+   // A lease of another tracer is left by one destroyed at the same address
+   SlotLease* lease = threadSlot_.get();
+   if (lease && lease->slots == slots_)
+      return lease->buffer;
+
+   // Threads without a slot look again at each call, as slots are released
+   // when threads exit
+   const boost::uint64_t thread = CurrentThreadNumber();
+   for (std::size_t probe = 0; probe < maxThreads; ++probe)
+   {
+      const std::size_t slot = (thread + probe) % maxThreads;
+      boost::uint64_t owner = 0;
+      if (!slots_->threads[slot].compare_exchange_strong(owner, thread,
+               boost::memory_order_acquire))
+         continue;
+
+      ThreadBuffer* buffer = slots_->buffers[slot].load();
+      if (!buffer)
+      {
+         buffer = new ThreadBuffer();
+         buffer->events.resize(eventsPerThread);
+         buffer->written.store(0);
+      }
+      buffer->threadNumber = thread;
+      buffer->pendingLockWaitStartNs = buffer->pendingLockWaitNs = 0;
+      slots_->buffers[slot].store(buffer, boost::memory_order_release);
+      threadSlot_.reset(new SlotLease(slots_, slot, buffer));
+      return buffer;
+   }
+   threadSlot_.reset();
+   return 0;
+}
+
+bool
+DeviceCallTracer::GetStatistics(const std::string& label, Method method,
+      MethodStatistics& statistics) const
+{
+   if (method < 0 || method >= NumMethods)
+      return false;
+
+   boost::mutex::scoped_lock lock(devicesMutex_);
+   std::map<std::string, Device*>::const_iterator found =
+      devicesByLabel_.find(label);
+   if (found == devicesByLabel_.end())
+      return false;
+   const Device::Counters& c = found->second->counters_[method];
+
+   statistics.histogram.resize(NumHistogramBuckets);
+   statistics.count = 0;
+   for (unsigned b = 0; b < NumHistogramBuckets; ++b)
+   {
+      statistics.histogram[b] = c.buckets[b].load(boost::memory_order_relaxed);
+      statistics.count += statistics.histogram[b];
+   }
+   if (statistics.count == 0)
+      return false;
+   const double n = static_cast<double>(statistics.count);
+   statistics.meanMs = c.totalNs.load(boost::memory_order_relaxed) / n / 1e6;
+   statistics.maxMs = c.maxNs.load(boost::memory_order_relaxed) / 1e6;
+   statistics.meanLockWaitMs =
+      c.lockWaitNs.load(boost::memory_order_relaxed) / n / 1e6;
+   return true;
+}
+
+std::vector<DeviceCallTracer::Method>
+DeviceCallTracer::GetCalledMethods(const std::string& label) const
+{
+   std::vector<Method> methods;
+   boost::mutex::scoped_lock lock(devicesMutex_);
+   std::map<std::string, Device*>::const_iterator found =
+      devicesByLabel_.find(label);
+   if (found == devicesByLabel_.end())
+      return methods;
+   for (int m = 0; m < NumMethods; ++m)
+   {
+      if (found->second->counters_[m].count.load(boost::memory_order_relaxed))
+         methods.push_back(static_cast<Method>(m));
+   }
+   return methods;
+}
+
+void
+DeviceCallTracer::CopyEvents(const ThreadBuffer& buffer,
+      std::vector<Event>& events) const
+{
+   const boost::uint64_t written =
+      buffer.written.load(boost::memory_order_acquire);
+   const boost::uint64_t first =
+      written > eventsPerThread ? written - eventsPerThread : 0;
+   std::vector<Event> copy;
+   copy.reserve(static_cast<std::size_t>(written - first));
+   for (boost::uint64_t n = first; n < written; ++n)
+      copy.push_back(buffer.events[n & (eventsPerThread - 1)]);
+
+   // Events that the thread may have overwritten while they were copied
+   // are dropped
+   const boost::uint64_t writtenAfter =
+      buffer.written.load(boost::memory_order_acquire);
+   const boost::uint64_t valid = writtenAfter >= eventsPerThread ?
+      writtenAfter - eventsPerThread + 1 : 0;
+
+   const boost::uint64_t clearedAtNs = clearedAtNs_.load();
+   for (boost::uint64_t n = std::max(first, valid); n < written; ++n)
+   {
+      const Event& e = copy[static_cast<std::size_t>(n - first)];
+      if (e.startNs >= clearedAtNs)
+         events.push_back(e);
+   }
+}
+
+void
+DeviceCallTracer::WriteChromeTrace(std::ostream& out) const
+{
+   std::vector<std::string> labels;
+   {
+      boost::mutex::scoped_lock lock(devicesMutex_);
+      for (std::vector<Device*>::const_iterator it = devices_.begin(),
+            end = devices_.end(); it != end; ++it)
+         labels.push_back((*it)->label_);
+   }
+
+   out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+   out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+      "\"args\":{\"name\":\"MMCore device calls\"}}";
+   // A buffer holds the events of the threads that owned it in turn
+   std::set<boost::uint64_t> namedThreads;
+   for (std::size_t slot = 0; slot < maxThreads; ++slot)
+   {
+      const ThreadBuffer* buffer =
+         slots_->buffers[slot].load(boost::memory_order_acquire);
+      if (!buffer)
+         continue;
+      std::vector<Event> events;
+      CopyEvents(*buffer, events);
+
+      for (std::vector<Event>::const_iterator e = events.begin(),
+            end = events.end(); e != end; ++e)
+      {
+         if (e->device >= labels.size())
+            continue;
+         const boost::uint64_t thread = e->thread;
+         if (namedThreads.insert(thread).second)
+            out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" <<
+               thread << ",\"args\":{\"name\":\"Thread " << thread << "\"}}";
+         const std::string& label = labels[e->device];
+         if (e->lockWaitNs > 0)
+         {
+            out << ",\n";
+            WriteCompleteEvent(out, "Module lock wait", label, thread,
+                  e->lockWaitStartNs, e->lockWaitNs);
+         }
+         out << ",\n";
+         WriteCompleteEvent(out,
+               GetMethodName(static_cast<Method>(e->method)), label, thread,
+               e->startNs, e->durationNs);
+      }
+   }
+   out << "\n]}\n";
+}
@@ -0,0 +1,226 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          DeviceCallTracer.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Latency instrumentation of device calls.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+
+#pragma once
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/smart_ptr/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/utility.hpp>
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// Records the calls made by the core to devices, and how long they take.
+/**
+ * The DeviceInstance wrappers of the slow or frequently called device
+ * methods time each call with a DeviceCallTracer::Call object, and the time
+ * spent waiting for the device's module lock is measured by
+ * DeviceModuleLockGuard. Nothing is recorded unless tracing is enabled.
+ *
+ * Each call is counted in a latency histogram kept per device and method,
+ * using atomic counters only. Each call is also written as a trace event to
+ * a ring buffer owned by the calling thread, so that threads never contend
+ * with each other; when a thread's buffer is full, its oldest events are
+ * overwritten. A thread hands its buffer back when it exits, and the buffer
+ * goes on to a later thread; the events of the thread that exited are kept
+ * until overwritten. The retained events can be exported in the Chrome trace
+ * event format, for viewing in chrome://tracing or Perfetto.
+ */
+class DeviceCallTracer : boost::noncopyable
+{
+public:
+   enum Method
+   {
+      MethodGetProperty,
+      MethodSetProperty,
+      MethodBusy,
+      MethodInitialize,
+      MethodShutdown,
+      MethodSnapImage,
+      MethodGetImageBuffer,
+      MethodStartSequenceAcquisition,
+      MethodStopSequenceAcquisition,
+      MethodSetExposure,
+      MethodGetExposure,
+      MethodSetPosition,
+      MethodGetPosition,
+      MethodSetRelativePosition,
+      MethodHome,
+      MethodStop,
+      MethodSetOpen,
+      MethodGetOpen,
+      NumMethods
+   };
+
+   static const char* GetMethodName(Method method);
+   static bool GetMethodByName(const std::string& name, Method& method);
+
+   // Bucket 0 counts calls shorter than 1 us; bucket i > 0 counts calls
+   // taking [2^(i-1), 2^i) us. The last bucket also counts longer calls.
+   static const unsigned NumHistogramBuckets = 32;
+
+   struct MethodStatistics
+   {
+      boost::uint64_t count;
+      double meanMs;
+      double maxMs;
+      double meanLockWaitMs;
+      std::vector<boost::uint64_t> histogram;
+   };
+
+   /// The calls of one device (by label).
+   class Device : boost::noncopyable
+   {
+      friend class DeviceCallTracer;
+
+      struct Counters
+      {
+         boost::atomic<boost::uint64_t> buckets[NumHistogramBuckets];
+         boost::atomic<boost::uint64_t> count;
+         boost::atomic<boost::uint64_t> totalNs;
+         boost::atomic<boost::uint64_t> maxNs;
+         boost::atomic<boost::uint64_t> lockWaitNs;
+      };
+
+      DeviceCallTracer* const tracer_;
+      const boost::uint32_t id_;
+      const std::string label_;
+      Counters counters_[NumMethods];
+
+      Device(DeviceCallTracer* tracer, boost::uint32_t id,
+            const std::string& label);
+      void Reset();
+
+   public:
+      DeviceCallTracer* GetTracer() const { return tracer_; }
+   };
+
+   /// Times a device call for as long as it is in scope.
+   class Call : boost::noncopyable
+   {
+      Device* device_;
+      Method method_;
+      boost::uint64_t startNs_;
+
+   public:
+      // device may be null
+      Call(Device* device, Method method);
+      ~Call();
+   };
+
+   DeviceCallTracer();
+   ~DeviceCallTracer();
+
+   void Enable(bool enable) { enabled_.store(enable); }
+   bool IsEnabled() const { return enabled_.load(boost::memory_order_relaxed); }
+
+   // Forget all calls recorded so far
+   void Clear();
+
+   // Returns the same object for as long as the tracer exists, so that
+   // reloading a device continues its statistics
+   Device* RegisterDevice(const std::string& label);
+
+   // Called by DeviceModuleLockGuard; the wait is attributed to the next
+   // call made by the current thread
+   void RecordLockWait(boost::uint64_t startNs, boost::uint64_t endNs);
+
+   // Returns false if the method of the device has not been called
+   bool GetStatistics(const std::string& label, Method method,
+         MethodStatistics& statistics) const;
+   std::vector<Method> GetCalledMethods(const std::string& label) const;
+
+   void WriteChromeTrace(std::ostream& out) const;
+
+private:
+   struct Event
+   {
+      boost::uint64_t startNs;
+      boost::uint64_t durationNs;
+      boost::uint64_t lockWaitStartNs;
+      boost::uint64_t lockWaitNs;
+      boost::uint64_t thread;
+      boost::uint32_t device;
+      boost::uint32_t method;
+   };
+
+   // Written only by the thread owning it
+   struct ThreadBuffer
+   {
+      boost::uint64_t threadNumber;
+      std::vector<Event> events;
+      boost::atomic<boost::uint64_t> written; // Not reset for a new owner
+      boost::uint64_t pendingLockWaitStartNs;
+      boost::uint64_t pendingLockWaitNs;
+   };
+
+   // Power of two
+   static const std::size_t eventsPerThread = 16384;
+   // Threads beyond this number at once are counted in the histograms, but
+   // their events are not kept
+   static const std::size_t maxThreads = 256;
+
+   // Open addressing by thread number. Shared with the threads owning a
+   // slot, which release it when they exit, possibly after the tracer is
+   // destroyed.
+   struct ThreadSlots : boost::noncopyable
+   {
+      boost::atomic<boost::uint64_t> threads[maxThreads]; // 0 if free
+      boost::atomic<ThreadBuffer*> buffers[maxThreads]; // Kept once created
+
+      ThreadSlots();
+      ~ThreadSlots();
+   };
+
+   // Held by a thread for as long as it owns a slot
+   struct SlotLease : boost::noncopyable
+   {
+      const boost::shared_ptr<ThreadSlots> slots;
+      const std::size_t slot;
+      ThreadBuffer* const buffer;
+
+      SlotLease(boost::shared_ptr<ThreadSlots> slots, std::size_t slot,
+            ThreadBuffer* buffer);
+      ~SlotLease();
+   };
+
+   void Record(Device& device, Method method, boost::uint64_t startNs,
+         boost::uint64_t endNs);
+   ThreadBuffer* GetThreadBuffer();
+   void CopyEvents(const ThreadBuffer& buffer, std::vector<Event>& events) const;
+
+   boost::atomic<bool> enabled_;
+   boost::atomic<boost::uint64_t> clearedAtNs_;
+
+   const boost::shared_ptr<ThreadSlots> slots_;
+   boost::thread_specific_ptr<SlotLease> threadSlot_;
+
+   mutable boost::mutex devicesMutex_;
+   std::map<std::string, Device*> devicesByLabel_;
+   std::vector<Device*> devices_; // Owned
+};
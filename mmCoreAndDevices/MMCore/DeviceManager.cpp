@@ -18,7 +18,9 @@
 #include "DeviceManager.h"
 
 #include "Devices/HubInstance.h"
+#include "CoreClock.h"
 #include "CoreUtils.h"
+#include "DeviceCallTracer.h"
 #include "Devices/DeviceInstance.h"
 #include "Error.h"
 #include "LoadableModules/LoadedDeviceAdapter.h"
@@ -292,9 +294,27 @@ DeviceManager::GetParentDevice(boost::shared_ptr<DeviceInstance> device) const
 }
 
 
+namespace {
+
+unsigned long long BeginLockWait(const boost::shared_ptr<DeviceInstance>& device)
+{
+   DeviceCallTracer::Device* traced = device->GetTracedDevice();
+   if (!traced || !traced->GetTracer()->IsEnabled())
+      return 0;
+   return CoreClock::MonotonicNs();
+}
+
+} // anonymous namespace
+
+
 DeviceModuleLockGuard::DeviceModuleLockGuard(boost::shared_ptr<DeviceInstance> device) :
+   waitStartNs_(BeginLockWait(device)),
    g_(device->GetAdapterModule()->GetLock())
-{}
+{
+   if (waitStartNs_)
+      device->GetTracedDevice()->GetTracer()->RecordLockWait(waitStartNs_,
+            CoreClock::MonotonicNs());
+}
 
 
 } // namespace mm
@@ -137,6 +137,8 @@ public:
 // Scoped acquisition of a device's module's lock
 class DeviceModuleLockGuard
 {
+   // When device calls are traced, the time at which the wait began
+   unsigned long long waitStartNs_;
    MMThreadGuard g_;
 public:
    explicit DeviceModuleLockGuard(boost::shared_ptr<DeviceInstance> device);
@@ -22,9 +22,27 @@
 #include "CameraInstance.h"
 
 
-int CameraInstance::SnapImage() { return GetImpl()->SnapImage(); }
-const unsigned char* CameraInstance::GetImageBuffer() { return GetImpl()->GetImageBuffer(); }
-const unsigned char* CameraInstance::GetImageBuffer(unsigned channelNr) { return GetImpl()->GetImageBuffer(channelNr); }
+int CameraInstance::SnapImage()
+{
+   DeviceCallTracer::Call call(tracedDevice_,
+         DeviceCallTracer::MethodSnapImage);
+   return GetImpl()->SnapImage();
+}
+
+const unsigned char* CameraInstance::GetImageBuffer()
+{
+   DeviceCallTracer::Call call(tracedDevice_,
+         DeviceCallTracer::MethodGetImageBuffer);
+   return GetImpl()->GetImageBuffer();
+}
+
+const unsigned char* CameraInstance::GetImageBuffer(unsigned channelNr)
+{
+   DeviceCallTracer::Call call(tracedDevice_,
+         DeviceCallTracer::MethodGetImageBuffer);
+   return GetImpl()->GetImageBuffer(channelNr);
+}
+
 const unsigned int* CameraInstance::GetImageBufferAsRGB32() { return GetImpl()->GetImageBufferAsRGB32(); }
 unsigned CameraInstance::GetNumberOfComponents() const { return GetImpl()->GetNumberOfComponents(); }
 
@@ -55,8 +73,21 @@ unsigned CameraInstance::GetBitDepth() const { return GetImpl()->GetBitDepth();
 double CameraInstance::GetPixelSizeUm() const { return GetImpl()->GetPixelSizeUm(); }
 int CameraInstance::GetBinning() const { return GetImpl()->GetBinning(); }
 int CameraInstance::SetBinning(int binSize) { return GetImpl()->SetBinning(binSize); }
-void CameraInstance::SetExposure(double exp_ms) { return GetImpl()->SetExposure(exp_ms); }
-double CameraInstance::GetExposure() const { return GetImpl()->GetExposure(); }
+
+void CameraInstance::SetExposure(double exp_ms)
+{
+   DeviceCallTracer::Call call(tracedDevice_,
+         DeviceCallTracer::MethodSetExposure);
+   GetImpl()->SetExposure(exp_ms);
+}
+
+double CameraInstance::GetExposure() const
+{
+   DeviceCallTracer::Call call(tracedDevice_,
+         DeviceCallTracer::MethodGetExposure);
+   return GetImpl()->GetExposure();
+}
+
 int CameraInstance::SetROI(unsigned x, unsigned y, unsigned xSize, unsigned ySize) { return GetImpl()->SetROI(x, y, xSize, ySize); }
 int CameraInstance::GetROI(unsigned& x, unsigned& y, unsigned& xSize, unsigned& ySize) { return GetImpl()->GetROI(x, y, xSize, ySize); }
 int CameraInstance::ClearROI() { return GetImpl()->ClearROI(); }
@@ -120,9 +151,27 @@ int CameraInstance::GetMultiROI(unsigned* xs, unsigned* ys, unsigned* widths,
    return GetImpl()->GetMultiROI(xs, ys, widths, heights, length);
 }
 
-int CameraInstance::StartSequenceAcquisition(long numImages, double interval_ms, bool stopOnOverflow) { return GetImpl()->StartSequenceAcquisition(numImages, interval_ms, stopOnOverflow); }
-int CameraInstance::StartSequenceAcquisition(double interval_ms) { return GetImpl()->StartSequenceAcquisition(interval_ms); }
-int CameraInstance::StopSequenceAcquisition() { return GetImpl()->StopSequenceAcquisition(); }
+int CameraInstance::StartSequenceAcquisition(long numImages, double interval_ms, bool stopOnOverflow)
+{
+   DeviceCallTracer::Call call(tracedDevice_,
+         DeviceCallTracer::MethodStartSequenceAcquisition);
+   return GetImpl()->StartSequenceAcquisition(numImages, interval_ms, stopOnOverflow);
+}
+
+int CameraInstance::StartSequenceAcquisition(double interval_ms)
+{
+   DeviceCallTracer::Call call(tracedDevice_,
+         DeviceCallTracer::MethodStartSequenceAcquisition);
+   return GetImpl()->StartSequenceAcquisition(interval_ms);
+}
+
+int CameraInstance::StopSequenceAcquisition()
+{
+   DeviceCallTracer::Call call(tracedDevice_,
+         DeviceCallTracer::MethodStopSequenceAcquisition);
+   return GetImpl()->StopSequenceAcquisition();
+}
+
 int CameraInstance::PrepareSequenceAcqusition() { return GetImpl()->PrepareSequenceAcqusition(); }
 bool CameraInstance::IsCapturing() { return GetImpl()->IsCapturing(); }
 
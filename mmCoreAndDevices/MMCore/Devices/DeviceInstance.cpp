@@ -47,6 +47,7 @@ DeviceInstance::DeviceInstance(CMMCore* core,
       mm::logging::Logger deviceLogger,
       mm::logging::Logger coreLogger) :
    pImpl_(pDevice),
+   tracedDevice_(core ? core->callTracer_->RegisterDevice(label) : 0),
    core_(core),
    adapter_(adapter),
    label_(label),
@@ -66,6 +67,8 @@ DeviceInstance::DeviceInstance(CMMCore* core,
    }
 
    pImpl_->SetLabel(label_.c_str());
+   // Lets devices that use other devices tell which ones share their adapter
+   pImpl_->SetModuleName(adapter_->GetName().c_str());
 }
 
 DeviceInstance::~DeviceInstance()
@@ -149,7 +152,12 @@ std::string
 DeviceInstance::GetProperty(const std::string& name) const
 {
    DeviceStringBuffer valueBuf(this, "GetProperty");
-   int err = pImpl_->GetProperty(name.c_str(), valueBuf.GetBuffer());
+   int err;
+   {
+      DeviceCallTracer::Call call(tracedDevice_,
+            DeviceCallTracer::MethodGetProperty);
+      err = pImpl_->GetProperty(name.c_str(), valueBuf.GetBuffer());
+   }
    ThrowIfError(err, "Cannot get value of property " +
          ToQuotedString(name));
    return valueBuf.Get();
@@ -162,7 +170,14 @@ DeviceInstance::SetProperty(const std::string& name,
    LOG_DEBUG(Logger()) << "Will set property \"" << name << "\" to \"" <<
       value << "\"";
 
-   int err = pImpl_->SetProperty(name.c_str(), value.c_str());
+   WillSetProperty();
+
+   int err;
+   {
+      DeviceCallTracer::Call call(tracedDevice_,
+            DeviceCallTracer::MethodSetProperty);
+      err = pImpl_->SetProperty(name.c_str(), value.c_str());
+   }
 
    ThrowIfError(err, "Cannot set property " + ToQuotedString(name) +
          " to " + ToQuotedString(value));
@@ -315,7 +330,13 @@ DeviceInstance::GetErrorText(int code) const
 
 bool
 DeviceInstance::Busy()
-{ return pImpl_->Busy(); }
+{
+   DeviceCallTracer::Call call(tracedDevice_, DeviceCallTracer::MethodBusy);
+   const bool busy = pImpl_->Busy();
+   if (!busy)
+      BusyCleared();
+   return busy;
+}
 
 double
 DeviceInstance::GetDelayMs() const
@@ -332,13 +353,25 @@ DeviceInstance::UsesDelay()
 void
 DeviceInstance::Initialize()
 {
-   ThrowIfError(pImpl_->Initialize());
+   int err;
+   {
+      DeviceCallTracer::Call call(tracedDevice_,
+            DeviceCallTracer::MethodInitialize);
+      err = pImpl_->Initialize();
+   }
+   ThrowIfError(err);
 }
 
 void
 DeviceInstance::Shutdown()
 {
-   ThrowIfError(pImpl_->Shutdown());
+   int err;
+   {
+      DeviceCallTracer::Call call(tracedDevice_,
+            DeviceCallTracer::MethodShutdown);
+      err = pImpl_->Shutdown();
+   }
+   ThrowIfError(err);
 }
 
 MM::DeviceType
@@ -20,6 +20,7 @@
 #pragma once
 
 #include "../../MMDevice/MMDeviceConstants.h"
+#include "../DeviceCallTracer.h"
 #include "../Error.h"
 #include "../Logging/Logger.h"
 
@@ -62,6 +63,8 @@ class DeviceInstance : boost::noncopyable
 {
 protected:
    MM::Device* pImpl_;
+   // Null if the device does not belong to a core
+   DeviceCallTracer::Device* tracedDevice_;
 
 private:
    CMMCore* core_; // Weak reference
@@ -82,6 +85,8 @@ public:
    // need it for the few CoreCallback methods that return a device pointer.
    MM::Device* GetRawPtr() const /* final */ { return pImpl_; }
 
+   DeviceCallTracer::Device* GetTracedDevice() const /* final */ { return tracedDevice_; }
+
    // Callback API
    int LogMessage(const char* msg, bool debugOnly);
 
@@ -104,6 +109,11 @@ protected:
    const mm::logging::Logger& Logger() const
    { return coreLogger_; }
 
+   // Called before SetProperty() calls the device
+   virtual void WillSetProperty() const {}
+   // Called when Busy() finds the device not busy
+   virtual void BusyCleared() {}
+
    CMMError MakeException() const;
    CMMError MakeExceptionForCode(int code) const;
    void ThrowError(const std::string& message) const;
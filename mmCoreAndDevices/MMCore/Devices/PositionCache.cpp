@@ -0,0 +1,107 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          PositionCache.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Last known position of a stage device
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+
+#include "PositionCache.h"
+
+#include "../CoreClock.h"
+
+#include <boost/thread/locks.hpp>
+
+
+PositionCache::PositionCache() :
+   valid_(false),
+   movePending_(false),
+   x_(0.0),
+   y_(0.0),
+   timeNs_(0),
+   defaultMaxAgeMs_(0.0)
+{
+}
+
+void
+PositionCache::Store(double x, double y)
+{
+   const unsigned long long now = mm::CoreClock::MonotonicNs();
+   boost::lock_guard<boost::mutex> lock(mutex_);
+   x_ = x;
+   y_ = y;
+   timeNs_ = now;
+   valid_ = true;
+}
+
+bool
+PositionCache::Get(double maxAgeMs, double& x, double& y) const
+{
+   if (!(maxAgeMs > 0.0))
+      return false;
+   const unsigned long long now = mm::CoreClock::MonotonicNs();
+   boost::lock_guard<boost::mutex> lock(mutex_);
+   if (!valid_ || movePending_)
+      return false;
+   const double ageMs = now > timeNs_ ? (now - timeNs_) / 1e6 : 0.0;
+   if (ageMs > maxAgeMs)
+      return false;
+   x = x_;
+   y = y_;
+   return true;
+}
+
+void
+PositionCache::MoveStarted()
+{
+   boost::lock_guard<boost::mutex> lock(mutex_);
+   movePending_ = true;
+   valid_ = false;
+}
+
+void
+PositionCache::MoveCompleted()
+{
+   boost::lock_guard<boost::mutex> lock(mutex_);
+   if (movePending_)
+   {
+      movePending_ = false;
+      valid_ = false;
+   }
+}
+
+bool
+PositionCache::IsMovePending() const
+{
+   boost::lock_guard<boost::mutex> lock(mutex_);
+   return movePending_;
+}
+
+void
+PositionCache::SetDefaultMaxAgeMs(double maxAgeMs)
+{
+   boost::lock_guard<boost::mutex> lock(mutex_);
+   defaultMaxAgeMs_ = maxAgeMs > 0.0 ? maxAgeMs : 0.0;
+}
+
+double
+PositionCache::GetDefaultMaxAgeMs() const
+{
+   boost::lock_guard<boost::mutex> lock(mutex_);
+   return defaultMaxAgeMs_;
+}
@@ -0,0 +1,65 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          PositionCache.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Last known position of a stage device
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+
+
+#pragma once
+
+#include <boost/thread/mutex.hpp>
+
+
+// Last known position of a stage or XY stage, for serving position queries
+// without a round trip to the device.
+//
+// Positions are stored when they are read from the device and when the
+// device reports them through the core callback. Once a move has been
+// started, nothing is served until the device has been seen to be no longer
+// busy; the positions stored up to then are discarded, because a device may
+// report intermediate positions (or its target) during the move.
+//
+// Thread-safe: positions can be reported from device threads.
+class PositionCache
+{
+   mutable boost::mutex mutex_;
+   bool valid_;
+   bool movePending_;
+   double x_, y_;
+   unsigned long long timeNs_;
+   double defaultMaxAgeMs_;
+
+public:
+   PositionCache();
+
+   void Store(double x, double y = 0.0);
+   // Returns false if there is no position younger than maxAgeMs to serve
+   // (always when maxAgeMs is not positive)
+   bool Get(double maxAgeMs, double& x, double& y) const;
+
+   void MoveStarted();
+   void MoveCompleted();
+   bool IsMovePending() const;
+
+   // Max age used by position queries that do not specify one; 0 (the
+   // default) disables the cache for them
+   void SetDefaultMaxAgeMs(double maxAgeMs);
+   double GetDefaultMaxAgeMs() const;
+};
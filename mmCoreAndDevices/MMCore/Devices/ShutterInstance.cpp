@@ -22,6 +22,16 @@
 #include "ShutterInstance.h"
 
 
-int ShutterInstance::SetOpen(bool open) { return GetImpl()->SetOpen(open); }
-int ShutterInstance::GetOpen(bool& open) { return GetImpl()->GetOpen(open); }
+int ShutterInstance::SetOpen(bool open)
+{
+   DeviceCallTracer::Call call(tracedDevice_, DeviceCallTracer::MethodSetOpen);
+   return GetImpl()->SetOpen(open);
+}
+
+int ShutterInstance::GetOpen(bool& open)
+{
+   DeviceCallTracer::Call call(tracedDevice_, DeviceCallTracer::MethodGetOpen);
+   return GetImpl()->GetOpen(open);
+}
+
 int ShutterInstance::Fire(double deltaT) { return GetImpl()->Fire(deltaT); }
@@ -22,16 +22,72 @@
 #include "StageInstance.h"
 
 
-int StageInstance::SetPositionUm(double pos) { return GetImpl()->SetPositionUm(pos); }
-int StageInstance::SetRelativePositionUm(double d) { return GetImpl()->SetRelativePositionUm(d); }
-int StageInstance::Move(double velocity) { return GetImpl()->Move(velocity); }
-int StageInstance::Stop() { return GetImpl()->Stop(); }
-int StageInstance::Home() { return GetImpl()->Home(); }
-int StageInstance::SetAdapterOriginUm(double d) { return GetImpl()->SetAdapterOriginUm(d); }
-int StageInstance::GetPositionUm(double& pos) { return GetImpl()->GetPositionUm(pos); }
-int StageInstance::SetPositionSteps(long steps) { return GetImpl()->SetPositionSteps(steps); }
+int StageInstance::SetPositionUm(double pos)
+{
+   DeviceCallTracer::Call call(tracedDevice_,
+         DeviceCallTracer::MethodSetPosition);
+   positionCache_.MoveStarted();
+   return GetImpl()->SetPositionUm(pos);
+}
+
+int StageInstance::SetRelativePositionUm(double d)
+{
+   DeviceCallTracer::Call call(tracedDevice_,
+         DeviceCallTracer::MethodSetRelativePosition);
+   positionCache_.MoveStarted();
+   return GetImpl()->SetRelativePositionUm(d);
+}
+
+int StageInstance::Move(double velocity)
+{
+   positionCache_.MoveStarted();
+   return GetImpl()->Move(velocity);
+}
+
+int StageInstance::Stop()
+{
+   DeviceCallTracer::Call call(tracedDevice_, DeviceCallTracer::MethodStop);
+   positionCache_.MoveStarted();
+   return GetImpl()->Stop();
+}
+
+int StageInstance::Home()
+{
+   DeviceCallTracer::Call call(tracedDevice_, DeviceCallTracer::MethodHome);
+   positionCache_.MoveStarted();
+   return GetImpl()->Home();
+}
+
+int StageInstance::SetAdapterOriginUm(double d)
+{
+   positionCache_.MoveStarted();
+   return GetImpl()->SetAdapterOriginUm(d);
+}
+
+int StageInstance::GetPositionUm(double& pos)
+{
+   DeviceCallTracer::Call call(tracedDevice_,
+         DeviceCallTracer::MethodGetPosition);
+   int ret = GetImpl()->GetPositionUm(pos);
+   if (ret == DEVICE_OK)
+      positionCache_.Store(pos);
+   return ret;
+}
+
+int StageInstance::SetPositionSteps(long steps)
+{
+   positionCache_.MoveStarted();
+   return GetImpl()->SetPositionSteps(steps);
+}
+
 int StageInstance::GetPositionSteps(long& steps) { return GetImpl()->GetPositionSteps(steps); }
-int StageInstance::SetOrigin() { return GetImpl()->SetOrigin(); }
+
+int StageInstance::SetOrigin()
+{
+   positionCache_.MoveStarted();
+   return GetImpl()->SetOrigin();
+}
+
 int StageInstance::GetLimits(double& lower, double& upper) { return GetImpl()->GetLimits(lower, upper); }
 
 MM::FocusDirection
@@ -61,8 +117,19 @@ int StageInstance::IsStageSequenceable(bool& isSequenceable) const { return GetI
 int StageInstance::IsStageLinearSequenceable(bool& isSequenceable) const { return GetImpl()->IsStageLinearSequenceable(isSequenceable); }
 bool StageInstance::IsContinuousFocusDrive() const { return GetImpl()->IsContinuousFocusDrive(); }
 int StageInstance::GetStageSequenceMaxLength(long& nrEvents) const { return GetImpl()->GetStageSequenceMaxLength(nrEvents); }
-int StageInstance::StartStageSequence() { return GetImpl()->StartStageSequence(); }
-int StageInstance::StopStageSequence() { return GetImpl()->StopStageSequence(); }
+
+int StageInstance::StartStageSequence()
+{
+   positionCache_.MoveStarted();
+   return GetImpl()->StartStageSequence();
+}
+
+int StageInstance::StopStageSequence()
+{
+   positionCache_.MoveStarted();
+   return GetImpl()->StopStageSequence();
+}
+
 int StageInstance::ClearStageSequence() { return GetImpl()->ClearStageSequence(); }
 int StageInstance::AddToStageSequence(double position) { return GetImpl()->AddToStageSequence(position); }
 int StageInstance::SendStageSequence() { return GetImpl()->SendStageSequence(); }
@@ -20,12 +20,15 @@
 #pragma once
 
 #include "DeviceInstanceBase.h"
+#include "PositionCache.h"
 
 
 class StageInstance : public DeviceInstanceBase<MM::Stage>
 {
    MM::FocusDirection focusDirection_;
    bool focusDirectionHasBeenSet_;
+   // Mutable because a property change can move the stage
+   mutable PositionCache positionCache_;
 
 public:
    StageInstance(CMMCore* core,
@@ -62,4 +65,11 @@ public:
    int AddToStageSequence(double position);
    int SendStageSequence();
    int SetStageLinearSequence(double dZ_um, long nSlices);
+
+   // Filled by GetPositionUm() and by position notifications from the device
+   PositionCache& GetPositionCache() { return positionCache_; }
+
+protected:
+   virtual void WillSetProperty() const { positionCache_.MoveStarted(); }
+   virtual void BusyCleared() { positionCache_.MoveCompleted(); }
 };
@@ -22,9 +22,26 @@
 #include "StateInstance.h"
 
 
-int StateInstance::SetPosition(long pos) { return GetImpl()->SetPosition(pos); }
-int StateInstance::SetPosition(const char* label) { return GetImpl()->SetPosition(label); }
-int StateInstance::GetPosition(long& pos) const { return GetImpl()->GetPosition(pos); }
+int StateInstance::SetPosition(long pos)
+{
+   DeviceCallTracer::Call call(tracedDevice_,
+         DeviceCallTracer::MethodSetPosition);
+   return GetImpl()->SetPosition(pos);
+}
+
+int StateInstance::SetPosition(const char* label)
+{
+   DeviceCallTracer::Call call(tracedDevice_,
+         DeviceCallTracer::MethodSetPosition);
+   return GetImpl()->SetPosition(label);
+}
+
+int StateInstance::GetPosition(long& pos) const
+{
+   DeviceCallTracer::Call call(tracedDevice_,
+         DeviceCallTracer::MethodGetPosition);
+   return GetImpl()->GetPosition(pos);
+}
 
 std::string StateInstance::GetPositionLabel() const
 {
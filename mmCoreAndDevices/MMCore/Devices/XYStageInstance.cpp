@@ -22,27 +22,111 @@
 #include "XYStageInstance.h"
 
 
-int XYStageInstance::SetPositionUm(double x, double y) { return GetImpl()->SetPositionUm(x, y); }
-int XYStageInstance::SetRelativePositionUm(double dx, double dy) { return GetImpl()->SetRelativePositionUm(dx, dy); }
-int XYStageInstance::SetAdapterOriginUm(double x, double y) { return GetImpl()->SetAdapterOriginUm(x, y); }
-int XYStageInstance::GetPositionUm(double& x, double& y) { return GetImpl()->GetPositionUm(x, y); }
+int XYStageInstance::SetPositionUm(double x, double y)
+{
+   DeviceCallTracer::Call call(tracedDevice_,
+         DeviceCallTracer::MethodSetPosition);
+   positionCache_.MoveStarted();
+   return GetImpl()->SetPositionUm(x, y);
+}
+
+int XYStageInstance::SetRelativePositionUm(double dx, double dy)
+{
+   DeviceCallTracer::Call call(tracedDevice_,
+         DeviceCallTracer::MethodSetRelativePosition);
+   positionCache_.MoveStarted();
+   return GetImpl()->SetRelativePositionUm(dx, dy);
+}
+
+int XYStageInstance::SetAdapterOriginUm(double x, double y)
+{
+   positionCache_.MoveStarted();
+   return GetImpl()->SetAdapterOriginUm(x, y);
+}
+
+int XYStageInstance::GetPositionUm(double& x, double& y)
+{
+   DeviceCallTracer::Call call(tracedDevice_,
+         DeviceCallTracer::MethodGetPosition);
+   int ret = GetImpl()->GetPositionUm(x, y);
+   if (ret == DEVICE_OK)
+      positionCache_.Store(x, y);
+   return ret;
+}
+
 int XYStageInstance::GetLimitsUm(double& xMin, double& xMax, double& yMin, double& yMax) { return GetImpl()->GetLimitsUm(xMin, xMax, yMin, yMax); }
-int XYStageInstance::Move(double vx, double vy) { return GetImpl()->Move(vx, vy); }
-int XYStageInstance::SetPositionSteps(long x, long y) { return GetImpl()->SetPositionSteps(x, y); }
+
+int XYStageInstance::Move(double vx, double vy)
+{
+   positionCache_.MoveStarted();
+   return GetImpl()->Move(vx, vy);
+}
+
+int XYStageInstance::SetPositionSteps(long x, long y)
+{
+   positionCache_.MoveStarted();
+   return GetImpl()->SetPositionSteps(x, y);
+}
+
 int XYStageInstance::GetPositionSteps(long& x, long& y) { return GetImpl()->GetPositionSteps(x, y); }
-int XYStageInstance::SetRelativePositionSteps(long x, long y) { return GetImpl()->SetRelativePositionSteps(x, y); }
-int XYStageInstance::Home() { return GetImpl()->Home(); }
-int XYStageInstance::Stop() { return GetImpl()->Stop(); }
-int XYStageInstance::SetOrigin() { return GetImpl()->SetOrigin(); }
-int XYStageInstance::SetXOrigin() { return GetImpl()->SetXOrigin(); }
-int XYStageInstance::SetYOrigin() { return GetImpl()->SetYOrigin(); }
+
+int XYStageInstance::SetRelativePositionSteps(long x, long y)
+{
+   positionCache_.MoveStarted();
+   return GetImpl()->SetRelativePositionSteps(x, y);
+}
+
+int XYStageInstance::Home()
+{
+   DeviceCallTracer::Call call(tracedDevice_, DeviceCallTracer::MethodHome);
+   positionCache_.MoveStarted();
+   return GetImpl()->Home();
+}
+
+int XYStageInstance::Stop()
+{
+   DeviceCallTracer::Call call(tracedDevice_, DeviceCallTracer::MethodStop);
+   positionCache_.MoveStarted();
+   return GetImpl()->Stop();
+}
+
+
+int XYStageInstance::SetOrigin()
+{
+   positionCache_.MoveStarted();
+   return GetImpl()->SetOrigin();
+}
+
+int XYStageInstance::SetXOrigin()
+{
+   positionCache_.MoveStarted();
+   return GetImpl()->SetXOrigin();
+}
+
+int XYStageInstance::SetYOrigin()
+{
+   positionCache_.MoveStarted();
+   return GetImpl()->SetYOrigin();
+}
+
 int XYStageInstance::GetStepLimits(long& xMin, long& xMax, long& yMin, long& yMax) { return GetImpl()->GetStepLimits(xMin, xMax, yMin, yMax); }
 double XYStageInstance::GetStepSizeXUm() { return GetImpl()->GetStepSizeXUm(); }
 double XYStageInstance::GetStepSizeYUm() { return GetImpl()->GetStepSizeYUm(); }
 int XYStageInstance::IsXYStageSequenceable(bool& isSequenceable) const { return GetImpl()->IsXYStageSequenceable(isSequenceable); }
 int XYStageInstance::GetXYStageSequenceMaxLength(long& nrEvents) const { return GetImpl()->GetXYStageSequenceMaxLength(nrEvents); }
-int XYStageInstance::StartXYStageSequence() { return GetImpl()->StartXYStageSequence(); }
-int XYStageInstance::StopXYStageSequence() { return GetImpl()->StopXYStageSequence(); }
+
+int XYStageInstance::StartXYStageSequence()
+{
+   positionCache_.MoveStarted();
+   return GetImpl()->StartXYStageSequence();
+}
+
+int XYStageInstance::StopXYStageSequence()
+{
+   positionCache_.MoveStarted();
+   return GetImpl()->StopXYStageSequence();
+}
+
 int XYStageInstance::ClearXYStageSequence() { return GetImpl()->ClearXYStageSequence(); }
 int XYStageInstance::AddToXYStageSequence(double positionX, double positionY) { return GetImpl()->AddToXYStageSequence(positionX, positionY); }
 int XYStageInstance::SendXYStageSequence() { return GetImpl()->SendXYStageSequence(); }
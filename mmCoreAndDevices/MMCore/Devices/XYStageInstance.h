@@ -20,10 +20,14 @@
 #pragma once
 
 #include "DeviceInstanceBase.h"
+#include "PositionCache.h"
 
 
 class XYStageInstance : public DeviceInstanceBase<MM::XYStage>
 {
+   // Mutable because a property change can move the stage
+   mutable PositionCache positionCache_;
+
 public:
    XYStageInstance(CMMCore* core,
          boost::shared_ptr<LoadedDeviceAdapter> adapter,
@@ -60,4 +64,11 @@ public:
    int ClearXYStageSequence();
    int AddToXYStageSequence(double positionX, double positionY);
    int SendXYStageSequence();
+
+   // Filled by GetPositionUm() and by position notifications from the device
+   PositionCache& GetPositionCache() { return positionCache_; }
+
+protected:
+   virtual void WillSetProperty() const { positionCache_.MoveStarted(); }
+   virtual void BusyCleared() { positionCache_.MoveCompleted(); }
 };
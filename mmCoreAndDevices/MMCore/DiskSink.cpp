@@ -0,0 +1,492 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          DiskSink.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Camera-agnostic streaming of sequence frames to disk.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "DiskSink.h"
+
+#include "ErrorCodes.h"
+
+#include "../MMDevice/ImageMetadata.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WINDOWS
+#include <malloc.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+const std::size_t minChunkBytes = 16 << 20;
+const std::size_t ioAlignment = 4096;
+
+const char indexMagic[8] = { 'M', 'M', 'R', 'A', 'W', 'I', 'D', 'X' };
+const boost::uint32_t indexVersion = 1;
+const std::size_t indexRecordFixedBytes = 48;
+
+void* AllocateAligned(std::size_t bytes, std::size_t alignment)
+{
+#ifdef _WINDOWS
+   return _aligned_malloc(bytes, alignment);
+#else
+   void* ptr = 0;
+   if (posix_memalign(&ptr, alignment, bytes) != 0)
+      return 0;
+   return ptr;
+#endif
+}
+
+void FreeAligned(void* ptr)
+{
+#ifdef _WINDOWS
+   _aligned_free(ptr);
+#else
+   free(ptr);
+#endif
+}
+
+template <typename T>
+void AppendValue(std::vector<char>& buf, T value)
+{
+   const char* p = reinterpret_cast<const char*>(&value);
+   buf.insert(buf.end(), p, p + sizeof(T));
+}
+
+} // anonymous namespace
+
+
+// Thin platform wrapper around an unbuffered output file
+struct DiskSink::RawFile
+{
+#ifdef _WINDOWS
+   HANDLE handle;
+#else
+   int fd;
+#endif
+   bool unbuffered;
+
+   RawFile() : unbuffered(false)
+   {
+#ifdef _WINDOWS
+      handle = INVALID_HANDLE_VALUE;
+#else
+      fd = -1;
+#endif
+   }
+
+   bool Open(const std::string& path)
+   {
+#ifdef _WINDOWS
+      handle = CreateFileA(path.c_str(), GENERIC_WRITE, 0, NULL,
+            CREATE_ALWAYS, FILE_FLAG_NO_BUFFERING | FILE_FLAG_SEQUENTIAL_SCAN,
+            NULL);
+      unbuffered = (handle != INVALID_HANDLE_VALUE);
+      if (!unbuffered)
+         handle = CreateFileA(path.c_str(), GENERIC_WRITE, 0, NULL,
+               CREATE_ALWAYS, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+      return handle != INVALID_HANDLE_VALUE;
+#else
+      const int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+      fd = open(path.c_str(), flags | O_DIRECT, 0644);
+      unbuffered = (fd >= 0);
+#endif
+      // Not all file systems (e.g. tmpfs) support O_DIRECT
+      if (fd < 0)
+         fd = open(path.c_str(), flags, 0644);
+#ifdef F_NOCACHE
+      if (fd >= 0)
+         unbuffered = (fcntl(fd, F_NOCACHE, 1) != -1);
+#endif
+      return fd >= 0;
+#endif
+   }
+
+   bool Write(const unsigned char* data, std::size_t bytes)
+   {
+#ifdef _WINDOWS
+      while (bytes > 0)
+      {
+         DWORD toWrite = static_cast<DWORD>(std::min<std::size_t>(bytes, 1 << 30));
+         DWORD written = 0;
+         if (!WriteFile(handle, data, toWrite, &written, NULL) || written == 0)
+            return false;
+         data += written;
+         bytes -= written;
+      }
+      return true;
+#else
+      while (bytes > 0)
+      {
+         ssize_t written = write(fd, data, bytes);
+         if (written < 0)
+         {
+            if (errno == EINTR)
+               continue;
+            return false;
+         }
+         data += written;
+         bytes -= static_cast<std::size_t>(written);
+      }
+      return true;
+#endif
+   }
+
+   bool Truncate(boost::uint64_t bytes)
+   {
+#ifdef _WINDOWS
+      LARGE_INTEGER pos;
+      pos.QuadPart = static_cast<LONGLONG>(bytes);
+      return SetFilePointerEx(handle, pos, NULL, FILE_BEGIN) &&
+         SetEndOfFile(handle);
+#else
+      return ftruncate(fd, static_cast<off_t>(bytes)) == 0;
+#endif
+   }
+
+   void Close()
+   {
+#ifdef _WINDOWS
+      if (handle != INVALID_HANDLE_VALUE)
+         CloseHandle(handle);
+      handle = INVALID_HANDLE_VALUE;
+#else
+      if (fd >= 0)
+         close(fd);
+      fd = -1;
+#endif
+   }
+};
+
+
+DiskSink::DiskSink() :
+   active_(false),
+   stopRequested_(false),
+   alignment_(ioAlignment),
+   chunkBytes_(0),
+   currentChunk_(-1),
+   rawFile_(0),
+   indexFile_(0),
+   fileBytes_(0),
+   writtenFrames_(0),
+   droppedFrames_(0)
+{
+}
+
+DiskSink::~DiskSink()
+{
+   Stop();
+}
+
+void DiskSink::Start(const std::string& pathPrefix) throw (CMMError)
+{
+   Stop();
+
+   boost::lock_guard<boost::mutex> lock(mx_);
+
+   const std::string rawPath = pathPrefix + ".raw";
+   const std::string indexPath = pathPrefix + ".idx";
+
+   RawFile* rawFile = new RawFile();
+   if (!rawFile->Open(rawPath))
+   {
+      delete rawFile;
+      throw CMMError("Cannot open " + rawPath + " for writing",
+            MMERR_FileOpenFailed);
+   }
+
+   std::FILE* indexFile = std::fopen(indexPath.c_str(), "wb");
+   if (!indexFile)
+   {
+      rawFile->Close();
+      delete rawFile;
+      throw CMMError("Cannot open " + indexPath + " for writing",
+            MMERR_FileOpenFailed);
+   }
+   std::vector<char> header(indexMagic, indexMagic + sizeof(indexMagic));
+   AppendValue<boost::uint32_t>(header, indexVersion);
+   AppendValue<boost::uint32_t>(header, 0);
+   std::fwrite(&header[0], 1, header.size(), indexFile);
+
+   rawFile_ = rawFile;
+   indexFile_ = indexFile;
+   pathPrefix_ = pathPrefix;
+   lastError_.clear();
+   fileBytes_ = 0;
+   writtenFrames_ = 0;
+   droppedFrames_ = 0;
+   currentChunk_ = -1;
+   pendingIndex_.clear();
+   stopRequested_ = false;
+   active_ = true;
+
+   writerThread_ = boost::thread(&DiskSink::WriterThreadFunc, this);
+}
+
+bool DiskSink::Stop()
+{
+   {
+      boost::lock_guard<boost::mutex> lock(mx_);
+      if (!active_)
+         return lastError_.empty();
+      // Hand the partially filled chunk to the writer as the final one
+      if (currentChunk_ >= 0 && chunks_[currentChunk_].used > 0)
+         fullChunks_.push_back(currentChunk_);
+      currentChunk_ = -1;
+      stopRequested_ = true;
+   }
+   cv_.notify_all();
+   writerThread_.join();
+
+   boost::lock_guard<boost::mutex> lock(mx_);
+   // The last chunk was padded to the I/O alignment; cut the padding off
+   if (!rawFile_->Truncate(fileBytes_) && lastError_.empty())
+      lastError_ = "Failed to set final size of " + pathPrefix_ + ".raw";
+   rawFile_->Close();
+   delete rawFile_;
+   rawFile_ = 0;
+   if (std::fclose(indexFile_) != 0 && lastError_.empty())
+      lastError_ = "Failed to write " + pathPrefix_ + ".idx";
+   indexFile_ = 0;
+
+   FreeChunks();
+   active_ = false;
+   stopRequested_ = false;
+   return lastError_.empty();
+}
+
+bool DiskSink::IsActive() const
+{
+   boost::lock_guard<boost::mutex> lock(mx_);
+   return active_;
+}
+
+std::string DiskSink::GetLastError() const
+{
+   boost::lock_guard<boost::mutex> lock(mx_);
+   return lastError_;
+}
+
+boost::uint64_t DiskSink::GetWrittenFrameCount() const
+{
+   boost::lock_guard<boost::mutex> lock(mx_);
+   return writtenFrames_;
+}
+
+boost::uint64_t DiskSink::GetDroppedFrameCount() const
+{
+   boost::lock_guard<boost::mutex> lock(mx_);
+   return droppedFrames_;
+}
+
+/**
+ * Queues a frame for writing. Must not be called concurrently with itself or
+ * with Stop(); the circular buffer serializes calls with its insert lock.
+ */
+void DiskSink::WriteFrame(const unsigned char* pixels, std::size_t bytes,
+      unsigned width, unsigned height, unsigned byteDepth,
+      unsigned nComponents, unsigned channel, const Metadata& md)
+{
+   if (bytes == 0)
+      return;
+
+   // Segments of the frame as (chunk, offset, length)
+   struct Segment { std::size_t chunk, offset, length; };
+   Segment segments[chunkCount_ + 1];
+   unsigned segmentCount = 0;
+   std::vector<std::size_t> completed;
+
+   {
+      boost::lock_guard<boost::mutex> lock(mx_);
+      if (!active_ || stopRequested_)
+         return;
+
+      if (chunks_.empty())
+      {
+         try
+         {
+            AllocateChunks(bytes);
+         }
+         catch (const std::bad_alloc&)
+         {
+            lastError_ = "Out of memory allocating disk streaming buffers";
+         }
+      }
+
+      std::size_t available = freeChunks_.size() * chunkBytes_;
+      if (currentChunk_ >= 0)
+         available += chunkBytes_ - chunks_[currentChunk_].used;
+      if (!lastError_.empty() || available < bytes)
+      {
+         ++droppedFrames_;
+         return;
+      }
+
+      const std::string serialized = md.Serialize();
+      AppendValue<boost::uint32_t>(pendingIndex_,
+            static_cast<boost::uint32_t>(indexRecordFixedBytes + serialized.size()));
+      AppendValue<boost::uint32_t>(pendingIndex_, channel);
+      AppendValue<boost::uint64_t>(pendingIndex_, writtenFrames_);
+      AppendValue<boost::uint64_t>(pendingIndex_, fileBytes_);
+      AppendValue<boost::uint64_t>(pendingIndex_, bytes);
+      AppendValue<boost::uint32_t>(pendingIndex_, width);
+      AppendValue<boost::uint32_t>(pendingIndex_, height);
+      AppendValue<boost::uint32_t>(pendingIndex_, byteDepth);
+      AppendValue<boost::uint32_t>(pendingIndex_, nComponents);
+      pendingIndex_.insert(pendingIndex_.end(), serialized.begin(), serialized.end());
+
+      // Reserve space; the chunks being filled are owned by this thread until
+      // they are queued for writing below
+      std::size_t remaining = bytes;
+      while (remaining > 0)
+      {
+         if (currentChunk_ < 0)
+         {
+            currentChunk_ = static_cast<long>(freeChunks_.front());
+            freeChunks_.pop_front();
+            chunks_[currentChunk_].used = 0;
+         }
+         Chunk& chunk = chunks_[currentChunk_];
+         Segment& seg = segments[segmentCount++];
+         seg.chunk = currentChunk_;
+         seg.offset = chunk.used;
+         seg.length = std::min(remaining, chunkBytes_ - chunk.used);
+         chunk.used += seg.length;
+         remaining -= seg.length;
+         if (chunk.used == chunkBytes_)
+         {
+            completed.push_back(currentChunk_);
+            currentChunk_ = -1;
+         }
+      }
+      fileBytes_ += bytes;
+      ++writtenFrames_;
+   }
+
+   const unsigned char* src = pixels;
+   for (unsigned i = 0; i < segmentCount; ++i)
+   {
+      std::memcpy(chunks_[segments[i].chunk].data + segments[i].offset,
+            src, segments[i].length);
+      src += segments[i].length;
+   }
+
+   if (!completed.empty())
+   {
+      {
+         boost::lock_guard<boost::mutex> lock(mx_);
+         fullChunks_.insert(fullChunks_.end(), completed.begin(), completed.end());
+      }
+      cv_.notify_all();
+   }
+}
+
+void DiskSink::AllocateChunks(std::size_t frameBytes)
+{
+   std::size_t bytes = std::max(minChunkBytes, 4 * frameBytes);
+   chunkBytes_ = (bytes + alignment_ - 1) / alignment_ * alignment_;
+   for (unsigned i = 0; i < chunkCount_; ++i)
+   {
+      Chunk chunk;
+      chunk.data = static_cast<unsigned char*>(AllocateAligned(chunkBytes_, alignment_));
+      chunk.used = 0;
+      if (!chunk.data)
+      {
+         FreeChunks();
+         throw std::bad_alloc();
+      }
+      chunks_.push_back(chunk);
+      freeChunks_.push_back(i);
+   }
+}
+
+void DiskSink::FreeChunks()
+{
+   for (std::size_t i = 0; i < chunks_.size(); ++i)
+      FreeAligned(chunks_[i].data);
+   chunks_.clear();
+   freeChunks_.clear();
+   fullChunks_.clear();
+   currentChunk_ = -1;
+   chunkBytes_ = 0;
+}
+
+void DiskSink::WriterThreadFunc()
+{
+   for (;;)
+   {
+      std::size_t chunkIndex = 0;
+      bool haveChunk = false;
+      std::vector<char> index;
+      {
+         boost::unique_lock<boost::mutex> lock(mx_);
+         while (fullChunks_.empty() && !stopRequested_)
+            cv_.wait(lock);
+         if (!fullChunks_.empty())
+         {
+            chunkIndex = fullChunks_.front();
+            fullChunks_.pop_front();
+            haveChunk = true;
+         }
+         index.swap(pendingIndex_);
+      }
+
+      bool ok = true;
+      if (haveChunk)
+         ok = WriteChunk(chunks_[chunkIndex]);
+      if (!index.empty() &&
+            std::fwrite(&index[0], 1, index.size(), indexFile_) != index.size())
+         ok = false;
+
+      {
+         boost::lock_guard<boost::mutex> lock(mx_);
+         if (!ok && lastError_.empty())
+            lastError_ = "Write error while streaming to " + pathPrefix_;
+         if (haveChunk)
+            freeChunks_.push_back(chunkIndex);
+         else if (stopRequested_)
+            break;
+      }
+   }
+}
+
+bool DiskSink::WriteChunk(Chunk& chunk)
+{
+   // Only the final chunk can be partially filled. Unbuffered I/O requires
+   // whole blocks, so pad it; Stop() truncates the file afterwards.
+   std::size_t bytes = chunk.used;
+   if (bytes % alignment_ != 0)
+   {
+      const std::size_t padded = (bytes + alignment_ - 1) / alignment_ * alignment_;
+      std::memset(chunk.data + bytes, 0, padded - bytes);
+      bytes = padded;
+   }
+   return rawFile_->Write(chunk.data, bytes);
+}
@@ -0,0 +1,131 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          DiskSink.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Camera-agnostic streaming of sequence frames to disk.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "Error.h"
+
+#include <boost/cstdint.hpp>
+#include <boost/thread.hpp>
+
+#include <cstddef>
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <vector>
+
+class Metadata;
+
+/// Writes frames inserted into the circular buffer to a raw stack on disk.
+/**
+ * Frames are copied into large page-aligned chunks on the inserting thread
+ * and written out by a dedicated writer thread, so that the camera thread
+ * never waits for the disk. Chunks are written with unbuffered I/O (O_DIRECT
+ * on Linux, F_NOCACHE on macOS, FILE_FLAG_NO_BUFFERING on Windows) when the
+ * file system supports it, and with ordinary writes otherwise. If the disk
+ * falls behind and all chunks are in flight, frames are dropped from the
+ * stream (they are still inserted into the circular buffer) and counted.
+ *
+ * Two files are produced for a path prefix P:
+ *
+ * P.raw: the pixel data of all frames, back to back, without padding.
+ *
+ * P.idx: a binary index (native byte order). It starts with the 8-byte
+ * magic "MMRAWIDX", followed by a uint32 format version (1) and a uint32
+ * reserved field. Then follows one record per frame (and per channel):
+ *
+ *    uint32 recordBytes    total size of this record, including this field
+ *    uint32 channel
+ *    uint64 frameNumber    sequence number within this stream
+ *    uint64 offset         byte offset of the pixels in P.raw
+ *    uint64 bytes          number of pixel bytes
+ *    uint32 width
+ *    uint32 height
+ *    uint32 byteDepth      bytes per pixel (including all components)
+ *    uint32 nComponents
+ *    char   metadata[]     serialized Metadata (recordBytes - 48 bytes)
+ *
+ * This is enough to rebuild the images and their metadata later, e.g. for
+ * conversion to OME-TIFF.
+ */
+class DiskSink
+{
+public:
+   DiskSink();
+   ~DiskSink();
+
+   void Start(const std::string& pathPrefix) throw (CMMError);
+   // Flushes all pending frames and closes the files. Returns false if a
+   // write error occurred at any point while streaming.
+   bool Stop();
+   bool IsActive() const;
+   std::string GetLastError() const;
+
+   void WriteFrame(const unsigned char* pixels, std::size_t bytes,
+         unsigned width, unsigned height, unsigned byteDepth,
+         unsigned nComponents, unsigned channel, const Metadata& md);
+
+   boost::uint64_t GetWrittenFrameCount() const;
+   boost::uint64_t GetDroppedFrameCount() const;
+
+private:
+   DiskSink(const DiskSink&);
+   DiskSink& operator=(const DiskSink&);
+
+   struct Chunk
+   {
+      unsigned char* data;
+      std::size_t used;
+   };
+
+   void AllocateChunks(std::size_t frameBytes);
+   void FreeChunks();
+   void WriterThreadFunc();
+   bool WriteChunk(Chunk& chunk);
+
+   static const unsigned chunkCount_ = 4;
+
+   mutable boost::mutex mx_;
+   boost::condition_variable cv_;
+   boost::thread writerThread_;
+
+   std::string pathPrefix_;
+   bool active_;
+   bool stopRequested_;
+   std::string lastError_;
+
+   std::size_t alignment_;
+   std::size_t chunkBytes_;
+   std::vector<Chunk> chunks_;
+   std::deque<std::size_t> freeChunks_;
+   std::deque<std::size_t> fullChunks_;
+   long currentChunk_; // -1 when no chunk is being filled
+   std::vector<char> pendingIndex_;
+
+   struct RawFile;
+   RawFile* rawFile_;
+   std::FILE* indexFile_;
+   boost::uint64_t fileBytes_; // Bytes of pixel data handed to the writer
+
+   boost::uint64_t writtenFrames_;
+   boost::uint64_t droppedFrames_;
+};
@@ -0,0 +1,265 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          FrameCodec.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Lossless compression of frames (byte shuffle and LZ4).
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+
+#include "FrameCodec.h"
+
+#include <boost/cstdint.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Constraints of the LZ4 block format
+const std::size_t minMatch = 4;
+const std::size_t lastLiterals = 5; // The last bytes are always literals
+const std::size_t matchFindLimit = 12; // No match starts in the last bytes
+const std::size_t maxOffset = 65535;
+
+const unsigned hashLog = 12;
+
+inline boost::uint32_t Read32(const unsigned char* p)
+{
+   boost::uint32_t v;
+   memcpy(&v, p, sizeof(v));
+   return v;
+}
+
+inline unsigned Hash(boost::uint32_t v)
+{
+   return (v * 2654435761U) >> (32 - hashLog);
+}
+
+// Bytes needed to encode the part of a length above 15
+inline std::size_t LengthBytes(std::size_t length)
+{
+   return length < 15 ? 0 : (length - 15) / 255 + 1;
+}
+
+inline unsigned char* WriteLength(unsigned char* op, std::size_t length)
+{
+   length -= 15;
+   for (; length >= 255; length -= 255)
+      *op++ = 255;
+   *op++ = static_cast<unsigned char>(length);
+   return op;
+}
+
+inline bool ReadLength(const unsigned char*& ip, const unsigned char* end,
+      std::size_t& length)
+{
+   unsigned char b;
+   do
+   {
+      if (ip == end)
+         return false;
+      b = *ip++;
+      length += b;
+   } while (b == 255);
+   return true;
+}
+
+} // anonymous namespace
+
+
+std::size_t FrameCodec::MaxCompressedBytes(std::size_t bytes)
+{
+   return bytes + bytes / 255 + 16;
+}
+
+void FrameCodec::Shuffle(unsigned char* dst, const unsigned char* src,
+      std::size_t bytes, unsigned elementBytes)
+{
+   const std::size_t count = elementBytes > 1 ? bytes / elementBytes : 0;
+   if (elementBytes == 2)
+   {
+      for (std::size_t i = 0; i < count; ++i)
+      {
+         dst[i] = src[2 * i];
+         dst[count + i] = src[2 * i + 1];
+      }
+   }
+   else
+   {
+      for (unsigned b = 0; b < elementBytes && count > 0; ++b)
+         for (std::size_t i = 0; i < count; ++i)
+            dst[b * count + i] = src[i * elementBytes + b];
+   }
+   const std::size_t shuffled = count * elementBytes;
+   memcpy(dst + shuffled, src + shuffled, bytes - shuffled);
+}
+
+void FrameCodec::Unshuffle(unsigned char* dst, const unsigned char* src,
+      std::size_t bytes, unsigned elementBytes)
+{
+   const std::size_t count = elementBytes > 1 ? bytes / elementBytes : 0;
+   if (elementBytes == 2)
+   {
+      for (std::size_t i = 0; i < count; ++i)
+      {
+         dst[2 * i] = src[i];
+         dst[2 * i + 1] = src[count + i];
+      }
+   }
+   else
+   {
+      for (unsigned b = 0; b < elementBytes && count > 0; ++b)
+         for (std::size_t i = 0; i < count; ++i)
+            dst[i * elementBytes + b] = src[b * count + i];
+   }
+   const std::size_t shuffled = count * elementBytes;
+   memcpy(dst + shuffled, src + shuffled, bytes - shuffled);
+}
+
+/**
+ * Greedy compression with a hash table of the last position of each 4-byte
+ * sequence. Each sequence of the output is a token (literal and match
+ * lengths), the literals, the 16-bit match offset and the match length
+ * continuation; the last sequence has literals only.
+ */
+std::size_t FrameCodec::Compress(unsigned char* dst, std::size_t dstCapacity,
+      const unsigned char* src, std::size_t bytes)
+{
+   unsigned char* op = dst;
+   unsigned char* const opEnd = dst + dstCapacity;
+   std::size_t anchor = 0; // Start of the pending literals
+
+   if (bytes > matchFindLimit)
+   {
+      // Positions are relative to src; a stale entry is rejected by
+      // comparing the bytes
+      boost::uint32_t table[1 << hashLog];
+      std::fill(table, table + (1 << hashLog), 0);
+
+      const std::size_t matchLimit = bytes - lastLiterals;
+      const std::size_t searchLimit = bytes - matchFindLimit;
+      std::size_t ip = 1;
+      unsigned misses = 0;
+      while (ip <= searchLimit)
+      {
+         const boost::uint32_t sequence = Read32(src + ip);
+         const unsigned h = Hash(sequence);
+         std::size_t ref = table[h];
+         table[h] = static_cast<boost::uint32_t>(ip);
+         if (ref >= ip || ip - ref > maxOffset || Read32(src + ref) != sequence)
+         {
+            // Step faster through data that does not compress
+            ip += 1 + (misses++ >> 6);
+            continue;
+         }
+         misses = 0;
+
+         std::size_t start = ip;
+         while (start > anchor && ref > 0 && src[start - 1] == src[ref - 1])
+         {
+            --start;
+            --ref;
+         }
+         std::size_t length = ip - start + minMatch;
+         while (start + length < matchLimit &&
+               src[start + length] == src[ref + length])
+            ++length;
+
+         const std::size_t literals = start - anchor;
+         const std::size_t matchCode = length - minMatch;
+         if (static_cast<std::size_t>(opEnd - op) < 1 + LengthBytes(literals) +
+               literals + 2 + LengthBytes(matchCode))
+            return 0;
+
+         unsigned char* token = op++;
+         *token = static_cast<unsigned char>(std::min<std::size_t>(literals, 15) << 4);
+         if (literals >= 15)
+            op = WriteLength(op, literals);
+         memcpy(op, src + anchor, literals);
+         op += literals;
+         const std::size_t offset = start - ref;
+         *op++ = static_cast<unsigned char>(offset);
+         *op++ = static_cast<unsigned char>(offset >> 8);
+         *token |= static_cast<unsigned char>(std::min<std::size_t>(matchCode, 15));
+         if (matchCode >= 15)
+            op = WriteLength(op, matchCode);
+
+         ip = start + length;
+         anchor = ip;
+         table[Hash(Read32(src + ip - 2))] = static_cast<boost::uint32_t>(ip - 2);
+      }
+   }
+
+   const std::size_t literals = bytes - anchor;
+   if (static_cast<std::size_t>(opEnd - op) < 1 + LengthBytes(literals) + literals)
+      return 0;
+   *op++ = static_cast<unsigned char>(std::min<std::size_t>(literals, 15) << 4);
+   if (literals >= 15)
+      op = WriteLength(op, literals);
+   memcpy(op, src + anchor, literals);
+   op += literals;
+   return static_cast<std::size_t>(op - dst);
+}
+
+bool FrameCodec::Decompress(unsigned char* dst, std::size_t dstBytes,
+      const unsigned char* src, std::size_t srcBytes)
+{
+   const unsigned char* ip = src;
+   const unsigned char* const ipEnd = src + srcBytes;
+   std::size_t op = 0;
+
+   while (ip < ipEnd)
+   {
+      const unsigned token = *ip++;
+      std::size_t literals = token >> 4;
+      if (literals == 15 && !ReadLength(ip, ipEnd, literals))
+         return false;
+      if (literals > static_cast<std::size_t>(ipEnd - ip) ||
+            literals > dstBytes - op)
+         return false;
+      memcpy(dst + op, ip, literals);
+      ip += literals;
+      op += literals;
+      if (ip == ipEnd)
+         break; // Last sequence
+
+      if (ipEnd - ip < 2)
+         return false;
+      const std::size_t offset = ip[0] | (ip[1] << 8);
+      ip += 2;
+      std::size_t length = token & 15;
+      if (length == 15 && !ReadLength(ip, ipEnd, length))
+         return false;
+      length += minMatch;
+      if (offset == 0 || offset > op || length > dstBytes - op)
+         return false;
+
+      unsigned char* out = dst + op;
+      const unsigned char* match = out - offset;
+      if (offset >= length)
+         memcpy(out, match, length);
+      else
+      {
+         // Overlapping match repeats the last offset bytes
+         for (std::size_t i = 0; i < length; ++i)
+            out[i] = match[i];
+      }
+      op += length;
+   }
+   return op == dstBytes;
+}
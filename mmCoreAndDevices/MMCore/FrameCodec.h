@@ -0,0 +1,55 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          FrameCodec.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Lossless compression of frames (byte shuffle and LZ4).
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+
+#pragma once
+
+#include <cstddef>
+
+/// Lossless compression of pixel data.
+/**
+ * Samples are first byte-shuffled: all the first bytes of the samples are
+ * gathered, then all the second bytes, and so on. This brings together the
+ * high-order bytes of samples that use fewer bits than their type holds,
+ * which then compress well. The shuffled data are compressed in the LZ4
+ * block format, so that they can be decoded by any LZ4 implementation;
+ * there is no dependency on the LZ4 library.
+ */
+class FrameCodec
+{
+public:
+   // Size of the compressed data in the worst case
+   static std::size_t MaxCompressedBytes(std::size_t bytes);
+
+   // Bytes that do not form a whole sample are copied unchanged to the end
+   static void Shuffle(unsigned char* dst, const unsigned char* src,
+         std::size_t bytes, unsigned elementBytes);
+   static void Unshuffle(unsigned char* dst, const unsigned char* src,
+         std::size_t bytes, unsigned elementBytes);
+
+   // Returns the compressed size, or 0 if it would exceed dstCapacity
+   static std::size_t Compress(unsigned char* dst, std::size_t dstCapacity,
+         const unsigned char* src, std::size_t bytes);
+   // Returns false unless src decompresses to exactly dstBytes
+   static bool Decompress(unsigned char* dst, std::size_t dstBytes,
+         const unsigned char* src, std::size_t srcBytes);
+};
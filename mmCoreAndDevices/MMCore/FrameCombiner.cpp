@@ -0,0 +1,334 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          FrameCombiner.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Combines every N sequence frames into one (mean, sum,
+//                maximum or minimum) before they reach the circular buffer.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "FrameCombiner.h"
+
+#include "ErrorCodes.h"
+
+#include <limits>
+
+using boost::uint16_t;
+using boost::uint32_t;
+
+
+namespace
+{
+
+// The per-pixel loops below are kept simple and branch-free so that
+// the compiler can vectorize them.
+
+template <typename T>
+void CopySamples(uint32_t* sums, const T* src, std::size_t n)
+{
+   for (std::size_t i = 0; i < n; ++i)
+      sums[i] = src[i];
+}
+
+template <typename T>
+void AddSamples(uint32_t* sums, const T* src, std::size_t n)
+{
+   for (std::size_t i = 0; i < n; ++i)
+      sums[i] += src[i];
+}
+
+template <typename T>
+void MaxSamples(T* acc, const T* src, std::size_t n)
+{
+   for (std::size_t i = 0; i < n; ++i)
+      acc[i] = src[i] > acc[i] ? src[i] : acc[i];
+}
+
+template <typename T>
+void MinSamples(T* acc, const T* src, std::size_t n)
+{
+   for (std::size_t i = 0; i < n; ++i)
+      acc[i] = src[i] < acc[i] ? src[i] : acc[i];
+}
+
+// Rounded division; exact in double since the sums are below 2^32
+template <typename T>
+void DivideSamples(T* dst, const uint32_t* sums, std::size_t n,
+      unsigned count)
+{
+   const double scale = 1.0 / count;
+   for (std::size_t i = 0; i < n; ++i)
+      dst[i] = static_cast<T>(sums[i] * scale + 0.5);
+}
+
+template <typename T>
+void SaturateSamples(T* dst, const uint32_t* sums, std::size_t n)
+{
+   const uint32_t maxValue = std::numeric_limits<T>::max();
+   for (std::size_t i = 0; i < n; ++i)
+      dst[i] = static_cast<T>(sums[i] < maxValue ? sums[i] : maxValue);
+}
+
+} // anonymous namespace
+
+
+FrameCombiner::FrameCombiner() :
+   enabled_(false),
+   frameCount_(1),
+   mode_(Mean),
+   inputFrames_(0),
+   outputFrames_(0)
+{
+}
+
+FrameCombiner::~FrameCombiner()
+{
+}
+
+bool FrameCombiner::ParseMode(const std::string& name, Mode& mode)
+{
+   if (name == "Mean")
+      mode = Mean;
+   else if (name == "Sum")
+      mode = Sum;
+   else if (name == "Max")
+      mode = Max;
+   else if (name == "Min")
+      mode = Min;
+   else
+      return false;
+   return true;
+}
+
+std::string FrameCombiner::GetModeName(Mode mode)
+{
+   switch (mode)
+   {
+      case Mean: return "Mean";
+      case Sum: return "Sum";
+      case Max: return "Max";
+      case Min: return "Min";
+   }
+   return std::string();
+}
+
+void FrameCombiner::Enable(unsigned frameCount, Mode mode)
+{
+   MMThreadGuard guard(lock_);
+   frameCount_ = frameCount;
+   mode_ = mode;
+   accumulators_.clear();
+   inputFrames_ = 0;
+   outputFrames_ = 0;
+   enabled_ = true;
+}
+
+void FrameCombiner::Disable()
+{
+   MMThreadGuard guard(lock_);
+   enabled_ = false;
+   accumulators_.clear();
+}
+
+bool FrameCombiner::IsEnabled() const
+{
+   MMThreadGuard guard(lock_);
+   return enabled_;
+}
+
+unsigned FrameCombiner::GetFrameCount() const
+{
+   MMThreadGuard guard(lock_);
+   return frameCount_;
+}
+
+FrameCombiner::Mode FrameCombiner::GetMode() const
+{
+   MMThreadGuard guard(lock_);
+   return mode_;
+}
+
+void FrameCombiner::Reset()
+{
+   MMThreadGuard guard(lock_);
+   accumulators_.clear();
+   inputFrames_ = 0;
+   outputFrames_ = 0;
+}
+
+unsigned long FrameCombiner::GetInputFrameCount() const
+{
+   MMThreadGuard guard(lock_);
+   return inputFrames_;
+}
+
+unsigned long FrameCombiner::GetOutputFrameCount() const
+{
+   MMThreadGuard guard(lock_);
+   return outputFrames_;
+}
+
+FrameCombiner::FramePtr FrameCombiner::AddFrame(const std::string& cameraLabel,
+      const unsigned char* pixels, unsigned width, unsigned height,
+      unsigned byteDepth, unsigned nComponents,
+      const Metadata& md) throw (CMMError)
+{
+   if (nComponents == 0 || byteDepth % nComponents != 0)
+      throw CMMError("Invalid number of image components",
+            MMERR_CircularBufferIncompatibleImage);
+   const unsigned sampleBytes = byteDepth / nComponents;
+   if (sampleBytes != 1 && sampleBytes != 2)
+      throw CMMError("Frame combining requires 8- or 16-bit samples",
+            MMERR_CircularBufferIncompatibleImage);
+
+   AccumulatorPtr acc;
+   unsigned frameCount;
+   Mode mode;
+   {
+      MMThreadGuard guard(lock_);
+      AccumulatorPtr& slot = accumulators_[cameraLabel];
+      if (!slot)
+         slot.reset(new Accumulator());
+      acc = slot;
+      frameCount = frameCount_;
+      mode = mode_;
+      ++inputFrames_;
+   }
+
+   // Frames from different cameras are accumulated concurrently; frames
+   // from the same camera are serialized by the accumulator's lock.
+   MMThreadGuard accGuard(acc->lock);
+
+   if (acc->count > 0 && (acc->width != width || acc->height != height ||
+            acc->byteDepth != byteDepth || acc->nComponents != nComponents))
+      acc->count = 0;
+
+   const std::size_t samples = (std::size_t)width * height * nComponents;
+   if (acc->count == 0)
+   {
+      acc->width = width;
+      acc->height = height;
+      acc->byteDepth = byteDepth;
+      acc->nComponents = nComponents;
+      acc->firstMd = md;
+   }
+
+   Accumulate(*acc, pixels, samples, sampleBytes, mode);
+
+   if (++acc->count < frameCount)
+      return FramePtr();
+
+   FramePtr result = Finish(*acc, samples, sampleBytes, frameCount, mode);
+   acc->count = 0;
+
+   MMThreadGuard guard(lock_);
+   ++outputFrames_;
+   return result;
+}
+
+void FrameCombiner::Accumulate(Accumulator& acc, const unsigned char* pixels,
+      std::size_t samples, unsigned sampleBytes, Mode mode)
+{
+   const bool first = (acc.count == 0);
+   if (mode == Mean || mode == Sum)
+   {
+      if (first)
+         acc.sums.resize(samples);
+      if (sampleBytes == 1)
+      {
+         if (first)
+            CopySamples(&acc.sums[0], pixels, samples);
+         else
+            AddSamples(&acc.sums[0], pixels, samples);
+      }
+      else
+      {
+         const uint16_t* src = reinterpret_cast<const uint16_t*>(pixels);
+         if (first)
+            CopySamples(&acc.sums[0], src, samples);
+         else
+            AddSamples(&acc.sums[0], src, samples);
+      }
+      return;
+   }
+
+   if (first)
+   {
+      acc.extremes.assign(pixels, pixels + samples * sampleBytes);
+      return;
+   }
+   if (sampleBytes == 1)
+   {
+      if (mode == Max)
+         MaxSamples(&acc.extremes[0], pixels, samples);
+      else
+         MinSamples(&acc.extremes[0], pixels, samples);
+   }
+   else
+   {
+      uint16_t* dst = reinterpret_cast<uint16_t*>(&acc.extremes[0]);
+      const uint16_t* src = reinterpret_cast<const uint16_t*>(pixels);
+      if (mode == Max)
+         MaxSamples(dst, src, samples);
+      else
+         MinSamples(dst, src, samples);
+   }
+}
+
+FrameCombiner::FramePtr FrameCombiner::Finish(Accumulator& acc,
+      std::size_t samples, unsigned sampleBytes, unsigned frameCount,
+      Mode mode)
+{
+   // Reuse the previous output unless a caller still holds it
+   if (!acc.output || !acc.output.unique())
+      acc.output.reset(new Frame());
+   Frame& out = *acc.output;
+
+   out.width = acc.width;
+   out.height = acc.height;
+   out.nComponents = acc.nComponents;
+   out.byteDepth = acc.byteDepth;
+   switch (mode)
+   {
+      case Mean:
+         out.pixels.resize(samples * sampleBytes);
+         if (sampleBytes == 1)
+            DivideSamples(&out.pixels[0], &acc.sums[0], samples, frameCount);
+         else
+            DivideSamples(reinterpret_cast<uint16_t*>(&out.pixels[0]),
+                  &acc.sums[0], samples, frameCount);
+         break;
+      case Sum:
+         out.pixels.resize(samples * sampleBytes);
+         if (sampleBytes == 1)
+            SaturateSamples(&out.pixels[0], &acc.sums[0], samples);
+         else
+            SaturateSamples(reinterpret_cast<uint16_t*>(&out.pixels[0]),
+                  &acc.sums[0], samples);
+         break;
+      case Max:
+      case Min:
+         // The next group starts by overwriting the accumulator anyway
+         out.pixels.swap(acc.extremes);
+         break;
+   }
+
+   out.md = acc.firstMd;
+   out.md.PutImageTag<long>("FrameCombiner-Count", frameCount);
+   out.md.PutImageTag("FrameCombiner-Mode", GetModeName(mode));
+   return acc.output;
+}
@@ -0,0 +1,142 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          FrameCombiner.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Combines every N sequence frames into one (mean, sum,
+//                maximum or minimum) before they reach the circular buffer.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "Error.h"
+
+#include "../MMDevice/DeviceThreads.h"
+#include "../MMDevice/ImageMetadata.h"
+
+#include <boost/cstdint.hpp>
+#include <boost/smart_ptr/shared_ptr.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+/// Reduces camera sequences to one frame per group of N frames.
+/**
+ * While enabled, frames inserted by each camera are accumulated, and only
+ * every Nth insertion produces a frame, which combines the last N frames of
+ * that camera pixel by pixel:
+ *
+ * - Mean: the rounded average, in the camera's pixel type
+ * - Sum: the sum, in the camera's pixel type, saturating at the largest
+ *   sample value
+ * - Max, Min: the maximum or minimum projection, in the camera's pixel type
+ *
+ * Images with 8- or 16-bit samples (including RGB32 and RGB64) are
+ * supported. The combined frame carries the metadata of the first frame of
+ * its group, with the FrameCombiner-Count and FrameCombiner-Mode tags added.
+ * A partial group is discarded when the image size changes or on Reset().
+ */
+class FrameCombiner
+{
+public:
+   enum Mode
+   {
+      Mean,
+      Sum,
+      Max,
+      Min
+   };
+
+   struct Frame
+   {
+      std::vector<unsigned char> pixels;
+      unsigned width;
+      unsigned height;
+      unsigned byteDepth;
+      unsigned nComponents;
+      Metadata md;
+   };
+   typedef boost::shared_ptr<const Frame> FramePtr;
+
+   static const unsigned maxFrameCount = 65536;
+
+   FrameCombiner();
+   ~FrameCombiner();
+
+   static bool ParseMode(const std::string& name, Mode& mode);
+   static std::string GetModeName(Mode mode);
+
+   void Enable(unsigned frameCount, Mode mode);
+   void Disable();
+   bool IsEnabled() const;
+   unsigned GetFrameCount() const;
+   Mode GetMode() const;
+
+   // Discard all partially combined frames and zero the counters
+   void Reset();
+
+   /**
+    * Adds a frame from the given camera. Returns the combined frame when this
+    * frame completes a group, and a null pointer otherwise. The returned
+    * frame is not modified until it is released.
+    */
+   FramePtr AddFrame(const std::string& cameraLabel,
+         const unsigned char* pixels, unsigned width, unsigned height,
+         unsigned byteDepth, unsigned nComponents,
+         const Metadata& md) throw (CMMError);
+
+   unsigned long GetInputFrameCount() const;
+   unsigned long GetOutputFrameCount() const;
+
+private:
+   FrameCombiner(const FrameCombiner&);
+   FrameCombiner& operator=(const FrameCombiner&);
+
+   struct Accumulator
+   {
+      Accumulator() :
+         width(0), height(0), byteDepth(0), nComponents(0), count(0)
+      {}
+
+      MMThreadLock lock;
+      unsigned width;
+      unsigned height;
+      unsigned byteDepth;
+      unsigned nComponents;
+      unsigned count;
+      std::vector<boost::uint32_t> sums; // Mean and Sum; cannot overflow
+      std::vector<unsigned char> extremes; // Max and Min, in the input type
+      Metadata firstMd;
+      boost::shared_ptr<Frame> output;
+   };
+   typedef boost::shared_ptr<Accumulator> AccumulatorPtr;
+
+   void Accumulate(Accumulator& acc, const unsigned char* pixels,
+         std::size_t samples, unsigned sampleBytes, Mode mode);
+   FramePtr Finish(Accumulator& acc, std::size_t samples,
+         unsigned sampleBytes, unsigned frameCount, Mode mode);
+
+   mutable MMThreadLock lock_;
+   bool enabled_;
+   unsigned frameCount_;
+   Mode mode_;
+   std::map<std::string, AccumulatorPtr> accumulators_;
+
+   unsigned long inputFrames_;
+   unsigned long outputFrames_;
+};
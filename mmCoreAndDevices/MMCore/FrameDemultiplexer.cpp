@@ -0,0 +1,337 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          FrameDemultiplexer.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Splits sequence frames holding several sub-images (image
+//                splitters, multi-ROI cameras) into multi-channel frames.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "FrameDemultiplexer.h"
+
+#include "CircularBuffer.h"
+#include "ErrorCodes.h"
+
+#include "../MMDevice/MMDeviceConstants.h"
+
+#include <boost/cstdint.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+
+namespace
+{
+
+// Copies outWidth x outHeight pixels, where output pixel (c, r) is taken
+// from origin[r * rowStep + c * colStep]. Flips and rotations are all
+// expressed by the choice of origin and steps.
+template <typename T>
+void CopyStrided(T* dest, unsigned outWidth, unsigned outHeight,
+      const T* origin, std::ptrdiff_t rowStep, std::ptrdiff_t colStep)
+{
+   if (colStep == 1)
+   {
+      for (unsigned r = 0; r < outHeight; ++r)
+         memcpy(dest + (std::size_t)r * outWidth,
+               origin + (std::ptrdiff_t)r * rowStep, outWidth * sizeof(T));
+      return;
+   }
+   if (colStep == -1)
+   {
+      for (unsigned r = 0; r < outHeight; ++r)
+      {
+         const T* src = origin + (std::ptrdiff_t)r * rowStep;
+         T* dst = dest + (std::size_t)r * outWidth;
+         for (unsigned c = 0; c < outWidth; ++c)
+            dst[c] = *(src - (std::ptrdiff_t)c);
+      }
+      return;
+   }
+
+   // Rotations read the source by columns. Copy in square tiles, so that the
+   // source rows touched by a tile stay in cache while it is written.
+   const unsigned tile = 32;
+   for (unsigned r0 = 0; r0 < outHeight; r0 += tile)
+   {
+      const unsigned rEnd = std::min(r0 + tile, outHeight);
+      for (unsigned c0 = 0; c0 < outWidth; c0 += tile)
+      {
+         const unsigned cEnd = std::min(c0 + tile, outWidth);
+         for (unsigned r = r0; r < rEnd; ++r)
+         {
+            const T* src = origin + (std::ptrdiff_t)r * rowStep;
+            T* dst = dest + (std::size_t)r * outWidth;
+            for (unsigned c = c0; c < cEnd; ++c)
+               dst[c] = src[(std::ptrdiff_t)c * colStep];
+         }
+      }
+   }
+}
+
+template <typename T>
+void CopyRegionT(const FrameDemultiplexer::Region& region, const T* src,
+      unsigned srcWidth, T* dest)
+{
+   const std::ptrdiff_t stride = srcWidth;
+   const std::ptrdiff_t left = region.x;
+   const std::ptrdiff_t right = region.x + region.width - 1;
+   const std::ptrdiff_t top = region.y;
+   const std::ptrdiff_t bottom = region.y + region.height - 1;
+
+   switch (region.transform)
+   {
+      case FrameDemultiplexer::None:
+         CopyStrided(dest, region.width, region.height,
+               src + top * stride + left, stride, 1);
+         break;
+      case FrameDemultiplexer::FlipHorizontal:
+         CopyStrided(dest, region.width, region.height,
+               src + top * stride + right, stride, -1);
+         break;
+      case FrameDemultiplexer::FlipVertical:
+         CopyStrided(dest, region.width, region.height,
+               src + bottom * stride + left, -stride, 1);
+         break;
+      case FrameDemultiplexer::Rotate90:
+         // Output row r is source column left + r, read bottom to top
+         CopyStrided(dest, region.height, region.width,
+               src + bottom * stride + left, 1, -stride);
+         break;
+      case FrameDemultiplexer::Rotate180:
+         CopyStrided(dest, region.width, region.height,
+               src + bottom * stride + right, -stride, -1);
+         break;
+      case FrameDemultiplexer::Rotate270:
+         // Output row r is source column right - r, read top to bottom
+         CopyStrided(dest, region.height, region.width,
+               src + top * stride + right, -1, stride);
+         break;
+   }
+}
+
+class RegionSource : public CircularBuffer::ChannelSource
+{
+public:
+   RegionSource(const std::vector<FrameDemultiplexer::Region>& regions,
+         const unsigned char* pixels, unsigned width, unsigned byteDepth) :
+      regions_(regions),
+      pixels_(pixels),
+      width_(width),
+      byteDepth_(byteDepth)
+   {}
+
+   virtual void CopyChannel(unsigned channel, unsigned char* dest) const
+   {
+      FrameDemultiplexer::CopyRegion(regions_[channel], pixels_, width_,
+            byteDepth_, dest);
+   }
+
+private:
+   const std::vector<FrameDemultiplexer::Region>& regions_;
+   const unsigned char* pixels_;
+   unsigned width_;
+   unsigned byteDepth_;
+};
+
+} // anonymous namespace
+
+
+FrameDemultiplexer::FrameDemultiplexer() :
+   enabled_(false),
+   channelWidth_(0),
+   channelHeight_(0)
+{
+}
+
+FrameDemultiplexer::~FrameDemultiplexer()
+{
+}
+
+bool FrameDemultiplexer::ParseTransform(const std::string& name,
+      Transform& transform)
+{
+   if (name.empty() || name == "None")
+      transform = None;
+   else if (name == "FlipHorizontal")
+      transform = FlipHorizontal;
+   else if (name == "FlipVertical")
+      transform = FlipVertical;
+   else if (name == "Rotate90")
+      transform = Rotate90;
+   else if (name == "Rotate180")
+      transform = Rotate180;
+   else if (name == "Rotate270")
+      transform = Rotate270;
+   else
+      return false;
+   return true;
+}
+
+std::string FrameDemultiplexer::GetTransformName(Transform transform)
+{
+   switch (transform)
+   {
+      case None: return "None";
+      case FlipHorizontal: return "FlipHorizontal";
+      case FlipVertical: return "FlipVertical";
+      case Rotate90: return "Rotate90";
+      case Rotate180: return "Rotate180";
+      case Rotate270: return "Rotate270";
+   }
+   return std::string();
+}
+
+void FrameDemultiplexer::GetChannelSize(const Region& region,
+      unsigned& width, unsigned& height)
+{
+   if (region.transform == Rotate90 || region.transform == Rotate270)
+   {
+      width = region.height;
+      height = region.width;
+   }
+   else
+   {
+      width = region.width;
+      height = region.height;
+   }
+}
+
+void FrameDemultiplexer::Enable(const std::vector<Region>& regions)
+   throw (CMMError)
+{
+   if (regions.empty())
+      throw CMMError("No regions given for frame demultiplexing",
+            MMERR_InvalidContents);
+
+   unsigned width = 0, height = 0;
+   for (std::size_t i = 0; i < regions.size(); ++i)
+   {
+      if (regions[i].width == 0 || regions[i].height == 0)
+         throw CMMError("Empty region given for frame demultiplexing",
+               MMERR_InvalidContents);
+      unsigned w, h;
+      GetChannelSize(regions[i], w, h);
+      if (i == 0)
+      {
+         width = w;
+         height = h;
+      }
+      else if (w != width || h != height)
+      {
+         throw CMMError("Demultiplexed regions must have the same size",
+               MMERR_InvalidContents);
+      }
+   }
+
+   MMThreadGuard guard(lock_);
+   regions_ = regions;
+   channelWidth_ = width;
+   channelHeight_ = height;
+   enabled_ = true;
+}
+
+void FrameDemultiplexer::Disable()
+{
+   MMThreadGuard guard(lock_);
+   enabled_ = false;
+}
+
+bool FrameDemultiplexer::IsEnabled() const
+{
+   MMThreadGuard guard(lock_);
+   return enabled_;
+}
+
+unsigned FrameDemultiplexer::GetChannelCount() const
+{
+   MMThreadGuard guard(lock_);
+   return static_cast<unsigned>(regions_.size());
+}
+
+unsigned FrameDemultiplexer::GetChannelWidth() const
+{
+   MMThreadGuard guard(lock_);
+   return channelWidth_;
+}
+
+unsigned FrameDemultiplexer::GetChannelHeight() const
+{
+   MMThreadGuard guard(lock_);
+   return channelHeight_;
+}
+
+void FrameDemultiplexer::CopyRegion(const Region& region,
+      const unsigned char* src, unsigned srcWidth, unsigned byteDepth,
+      unsigned char* dest)
+{
+   switch (byteDepth)
+   {
+      case 1:
+         CopyRegionT(region, src, srcWidth, dest);
+         break;
+      case 2:
+         CopyRegionT(region, reinterpret_cast<const boost::uint16_t*>(src),
+               srcWidth, reinterpret_cast<boost::uint16_t*>(dest));
+         break;
+      case 4:
+         CopyRegionT(region, reinterpret_cast<const boost::uint32_t*>(src),
+               srcWidth, reinterpret_cast<boost::uint32_t*>(dest));
+         break;
+      case 8:
+         CopyRegionT(region, reinterpret_cast<const boost::uint64_t*>(src),
+               srcWidth, reinterpret_cast<boost::uint64_t*>(dest));
+         break;
+   }
+}
+
+bool FrameDemultiplexer::InsertImage(CircularBuffer& cbuf,
+      const unsigned char* pixels, unsigned width, unsigned height,
+      unsigned byteDepth, unsigned nComponents,
+      const Metadata& md) throw (CMMError)
+{
+   if (byteDepth != 1 && byteDepth != 2 && byteDepth != 4 && byteDepth != 8)
+      throw CMMError("Unsupported pixel size for frame demultiplexing",
+            MMERR_CircularBufferIncompatibleImage);
+
+   std::vector<Region> regions;
+   unsigned channelWidth, channelHeight;
+   {
+      MMThreadGuard guard(lock_);
+      regions = regions_;
+      channelWidth = channelWidth_;
+      channelHeight = channelHeight_;
+   }
+
+   for (std::size_t i = 0; i < regions.size(); ++i)
+   {
+      if (regions[i].x + regions[i].width > width ||
+            regions[i].y + regions[i].height > height)
+         throw CMMError("Demultiplexed region lies outside the image",
+               MMERR_CircularBufferIncompatibleImage);
+   }
+
+   std::vector<Metadata> metadata(regions.size(), md);
+   for (std::size_t i = 0; i < metadata.size(); ++i)
+      metadata[i].PutImageTag(MM::g_Keyword_CameraChannelIndex, (long)i);
+
+   RegionSource source(regions, pixels, width, byteDepth);
+   return cbuf.InsertMultiChannel(source, &metadata[0],
+         static_cast<unsigned>(regions.size()), channelWidth, channelHeight,
+         byteDepth, nComponents);
+}
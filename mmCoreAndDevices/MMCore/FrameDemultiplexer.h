@@ -0,0 +1,105 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          FrameDemultiplexer.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Splits sequence frames holding several sub-images (image
+//                splitters, multi-ROI cameras) into multi-channel frames.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "Error.h"
+
+#include "../MMDevice/DeviceThreads.h"
+#include "../MMDevice/ImageMetadata.h"
+
+#include <string>
+#include <vector>
+
+class CircularBuffer;
+
+/// Splits camera frames into the channels of multi-channel frames.
+/**
+ * While enabled, each frame inserted by a camera is cut into a set of
+ * rectangular regions, which are inserted into the circular buffer as the
+ * channels of one multi-channel frame (channel i from region i). Each region
+ * may be flipped or rotated on the way, e.g. to register the mirrored half
+ * of an image splitter. The regions are copied straight from the camera
+ * frame into the circular buffer.
+ *
+ * All regions must yield channels of the same size after their transform.
+ * Frames for which a region falls outside the image are rejected.
+ */
+class FrameDemultiplexer
+{
+public:
+   enum Transform
+   {
+      None,
+      FlipHorizontal,
+      FlipVertical,
+      Rotate90, // clockwise
+      Rotate180,
+      Rotate270
+   };
+
+   struct Region
+   {
+      unsigned x;
+      unsigned y;
+      unsigned width;
+      unsigned height;
+      Transform transform;
+   };
+
+   FrameDemultiplexer();
+   ~FrameDemultiplexer();
+
+   static bool ParseTransform(const std::string& name, Transform& transform);
+   static std::string GetTransformName(Transform transform);
+
+   void Enable(const std::vector<Region>& regions) throw (CMMError);
+   void Disable();
+   bool IsEnabled() const;
+   unsigned GetChannelCount() const;
+   unsigned GetChannelWidth() const;
+   unsigned GetChannelHeight() const;
+
+   // Returns false if the circular buffer overflowed
+   bool InsertImage(CircularBuffer& cbuf, const unsigned char* pixels,
+         unsigned width, unsigned height, unsigned byteDepth,
+         unsigned nComponents, const Metadata& md) throw (CMMError);
+
+   // Copies a region of the source image (of the given width) into a
+   // channel image, applying the region's transform
+   static void CopyRegion(const Region& region, const unsigned char* src,
+         unsigned srcWidth, unsigned byteDepth, unsigned char* dest);
+
+private:
+   FrameDemultiplexer(const FrameDemultiplexer&);
+   FrameDemultiplexer& operator=(const FrameDemultiplexer&);
+
+   static void GetChannelSize(const Region& region, unsigned& width,
+         unsigned& height);
+
+   mutable MMThreadLock lock_;
+   bool enabled_;
+   std::vector<Region> regions_;
+   unsigned channelWidth_;
+   unsigned channelHeight_;
+};
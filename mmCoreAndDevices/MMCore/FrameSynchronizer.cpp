@@ -0,0 +1,378 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          FrameSynchronizer.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Matches sequence frames from several cameras into
+//                multi-channel frames.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "FrameSynchronizer.h"
+
+#include "CircularBuffer.h"
+#include "CoreClock.h"
+#include "ErrorCodes.h"
+
+#include "../MMDevice/MMDeviceConstants.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+
+FrameSynchronizer::FrameSynchronizer() :
+   enabled_(false),
+   mode_(MatchImageNumber),
+   maxSkewMs_(0.0),
+   timeoutMs_(1000.0),
+   startNs_(mm::CoreClock::MonotonicNs()),
+   matchedFrames_(0),
+   droppedFrames_(0)
+{
+}
+
+FrameSynchronizer::~FrameSynchronizer()
+{
+}
+
+void FrameSynchronizer::Enable(const std::vector<std::string>& cameraLabels,
+      MatchMode mode, double maxSkewMs, double timeoutMs)
+{
+   MMThreadGuard guard(lock_);
+   mode_ = mode;
+   maxSkewMs_ = maxSkewMs;
+   timeoutMs_ = timeoutMs;
+
+   channels_.clear();
+   channels_.resize(cameraLabels.size());
+   for (std::size_t i = 0; i < cameraLabels.size(); ++i)
+      channels_[i].label = cameraLabels[i];
+   ClearQueues();
+   matchedFrames_ = 0;
+   droppedFrames_ = 0;
+   enabled_ = true;
+}
+
+void FrameSynchronizer::Disable()
+{
+   MMThreadGuard guard(lock_);
+   enabled_ = false;
+   ClearQueues();
+}
+
+bool FrameSynchronizer::IsEnabled() const
+{
+   MMThreadGuard guard(lock_);
+   return enabled_;
+}
+
+void FrameSynchronizer::Reset()
+{
+   MMThreadGuard guard(lock_);
+   ClearQueues();
+   matchedFrames_ = 0;
+   droppedFrames_ = 0;
+}
+
+unsigned long FrameSynchronizer::GetMatchedFrameCount() const
+{
+   MMThreadGuard guard(lock_);
+   return matchedFrames_;
+}
+
+unsigned long FrameSynchronizer::GetDroppedFrameCount() const
+{
+   MMThreadGuard guard(lock_);
+   return droppedFrames_;
+}
+
+bool FrameSynchronizer::InsertImage(CircularBuffer& cbuf,
+      const std::string& cameraLabel, const unsigned char* pixels,
+      unsigned width, unsigned height, unsigned byteDepth,
+      unsigned nComponents, const Metadata& md,
+      bool clearOnOverflow) throw (CMMError)
+{
+   FramePtr frame;
+   {
+      MMThreadGuard guard(lock_);
+      if (FindChannel(cameraLabel))
+         frame = AcquireFrame();
+   }
+   if (!frame)
+      return cbuf.InsertImage(pixels, width, height, byteDepth, nComponents,
+            &md);
+
+   // Copied without the lock, so that the other cameras are not held up
+   frame->pixels.assign(pixels,
+         pixels + (std::size_t)width * height * byteDepth);
+   frame->width = width;
+   frame->height = height;
+   frame->byteDepth = byteDepth;
+   frame->nComponents = nComponents;
+   frame->md = md;
+
+   std::vector<MatchedSet> matched;
+   bool incompatible = false;
+   {
+      MMThreadGuard guard(lock_);
+
+      // Disabled or regrouped while the frame was copied
+      Channel* channel = FindChannel(cameraLabel);
+      if (!channel)
+      {
+         ReleaseFrame(frame);
+         frame.reset();
+      }
+      else
+      {
+         const double nowMs = NowMs();
+         frame->arrivalMs = nowMs;
+
+         if (frame->md.HasTag(MM::g_Keyword_Metadata_ImageNumber))
+         {
+            long number = std::atol(frame->md.GetSingleTag(
+                     MM::g_Keyword_Metadata_ImageNumber).GetValue().c_str());
+            if (!channel->haveFirstImageNumber)
+            {
+               channel->firstImageNumber = number;
+               channel->haveFirstImageNumber = true;
+            }
+            frame->imageNumber = number - channel->firstImageNumber;
+         }
+         else
+            frame->imageNumber = channel->arrivalCount;
+         ++channel->arrivalCount;
+
+         if (frame->md.HasTag(MM::g_Keyword_Elapsed_Time_ms))
+            frame->timestampMs = std::atof(frame->md.GetSingleTag(
+                     MM::g_Keyword_Elapsed_Time_ms).GetValue().c_str());
+         else
+            frame->timestampMs = nowMs;
+
+         channel->queue.push_back(frame);
+         if (channel->queue.size() > maxQueuedFrames_)
+            DropFront(*channel);
+         DropExpired(nowMs);
+         PopMatched(matched, incompatible);
+      }
+   }
+   if (!frame)
+      return cbuf.InsertImage(pixels, width, height, byteDepth, nComponents,
+            &md);
+
+   // Inserted without the lock, so that a full buffer under the Block
+   // policy stalls only the camera that completed the set
+   bool ok = true;
+   for (std::size_t i = 0; i < matched.size(); ++i)
+   {
+      // A frame that was only queued is never reported as rejected, so the
+      // camera does not clear the buffer and insert it a second time. Under
+      // the Clear policy, the buffer is cleared here instead.
+      if (!InsertMatched(cbuf, matched[i], clearOnOverflow) &&
+            !clearOnOverflow)
+         ok = false;
+   }
+   if (incompatible)
+      throw CMMError("Synchronized cameras produced images of different sizes",
+            MMERR_CircularBufferIncompatibleImage);
+   return ok;
+}
+
+double FrameSynchronizer::NowMs() const
+{
+   return (mm::CoreClock::MonotonicNs() - startNs_) / 1.0e6;
+}
+
+FrameSynchronizer::FramePtr FrameSynchronizer::AcquireFrame()
+{
+   if (freeFrames_.empty())
+      return FramePtr(new Frame());
+   FramePtr frame = freeFrames_.back();
+   freeFrames_.pop_back();
+   return frame;
+}
+
+FrameSynchronizer::Channel*
+FrameSynchronizer::FindChannel(const std::string& cameraLabel)
+{
+   if (!enabled_)
+      return 0;
+   for (std::size_t i = 0; i < channels_.size(); ++i)
+   {
+      if (channels_[i].label == cameraLabel)
+         return &channels_[i];
+   }
+   return 0;
+}
+
+void FrameSynchronizer::ReleaseFrame(const FramePtr& frame)
+{
+   // Keep the allocation for reuse by later frames
+   if (freeFrames_.size() < maxQueuedFrames_)
+      freeFrames_.push_back(frame);
+}
+
+void FrameSynchronizer::DropFront(Channel& channel)
+{
+   ReleaseFrame(channel.queue.front());
+   channel.queue.pop_front();
+   ++droppedFrames_;
+}
+
+void FrameSynchronizer::DropExpired(double nowMs)
+{
+   for (std::size_t i = 0; i < channels_.size(); ++i)
+   {
+      std::deque<FramePtr>& queue = channels_[i].queue;
+      while (!queue.empty() && nowMs - queue.front()->arrivalMs > timeoutMs_)
+         DropFront(channels_[i]);
+   }
+}
+
+void FrameSynchronizer::PopMatched(std::vector<MatchedSet>& matched,
+      bool& incompatible)
+{
+   for (;;)
+   {
+      bool complete = true;
+      for (std::size_t i = 0; i < channels_.size(); ++i)
+      {
+         if (channels_[i].queue.empty())
+         {
+            complete = false;
+            break;
+         }
+      }
+      if (!complete)
+         return;
+
+      if (mode_ == MatchImageNumber)
+      {
+         long newest = channels_[0].queue.front()->imageNumber;
+         for (std::size_t i = 1; i < channels_.size(); ++i)
+            newest = std::max(newest, channels_[i].queue.front()->imageNumber);
+
+         // Frames older than the newest head have lost their partner
+         bool dropped = false;
+         for (std::size_t i = 0; i < channels_.size(); ++i)
+         {
+            if (channels_[i].queue.front()->imageNumber < newest)
+            {
+               DropFront(channels_[i]);
+               dropped = true;
+            }
+         }
+         if (dropped)
+            continue;
+      }
+      else
+      {
+         std::size_t oldest = 0;
+         double oldestMs = channels_[0].queue.front()->timestampMs;
+         double newestMs = oldestMs;
+         for (std::size_t i = 1; i < channels_.size(); ++i)
+         {
+            double t = channels_[i].queue.front()->timestampMs;
+            if (t < oldestMs)
+            {
+               oldestMs = t;
+               oldest = i;
+            }
+            newestMs = std::max(newestMs, t);
+         }
+
+         // Later frames of the other cameras are later still, so the
+         // oldest head can no longer be matched
+         if (newestMs - oldestMs > maxSkewMs_)
+         {
+            DropFront(channels_[oldest]);
+            continue;
+         }
+      }
+
+      MatchedSet frames(channels_.size());
+      for (std::size_t i = 0; i < channels_.size(); ++i)
+      {
+         frames[i] = channels_[i].queue.front();
+         channels_[i].queue.pop_front();
+      }
+
+      bool sameSize = true;
+      for (std::size_t i = 1; i < frames.size(); ++i)
+      {
+         if (frames[i]->width != frames[0]->width ||
+               frames[i]->height != frames[0]->height ||
+               frames[i]->byteDepth != frames[0]->byteDepth)
+            sameSize = false;
+      }
+      if (sameSize)
+         matched.push_back(frames);
+      else
+      {
+         droppedFrames_ += frames.size();
+         for (std::size_t i = 0; i < frames.size(); ++i)
+            ReleaseFrame(frames[i]);
+         incompatible = true;
+      }
+   }
+}
+
+bool FrameSynchronizer::InsertMatched(CircularBuffer& cbuf,
+      const MatchedSet& frames, bool clearOnOverflow)
+{
+   const std::size_t n = frames.size();
+   std::vector<const unsigned char*> pixels(n);
+   std::vector<Metadata> metadata(n);
+   for (std::size_t i = 0; i < n; ++i)
+   {
+      pixels[i] = frames[i]->pixels.empty() ? 0 : &frames[i]->pixels[0];
+      metadata[i] = frames[i]->md;
+      metadata[i].PutImageTag(MM::g_Keyword_CameraChannelIndex, (long)i);
+   }
+
+   const Frame& first = *frames[0];
+   bool ok = cbuf.InsertMultiChannel(&pixels[0], &metadata[0],
+         static_cast<unsigned>(n), first.width, first.height, first.byteDepth,
+         first.nComponents);
+   if (!ok && clearOnOverflow)
+   {
+      cbuf.Clear();
+      ok = cbuf.InsertMultiChannel(&pixels[0], &metadata[0],
+            static_cast<unsigned>(n), first.width, first.height,
+            first.byteDepth, first.nComponents);
+   }
+
+   MMThreadGuard guard(lock_);
+   if (ok)
+      ++matchedFrames_;
+   else
+      droppedFrames_ += n;
+   for (std::size_t i = 0; i < n; ++i)
+      ReleaseFrame(frames[i]);
+   return ok;
+}
+
+void FrameSynchronizer::ClearQueues()
+{
+   for (std::size_t i = 0; i < channels_.size(); ++i)
+   {
+      channels_[i].queue.clear();
+      channels_[i].arrivalCount = 0;
+      channels_[i].haveFirstImageNumber = false;
+      channels_[i].firstImageNumber = 0;
+   }
+   startNs_ = mm::CoreClock::MonotonicNs();
+}
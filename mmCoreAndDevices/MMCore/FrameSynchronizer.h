@@ -0,0 +1,141 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          FrameSynchronizer.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Matches sequence frames from several cameras into
+//                multi-channel frames.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "Error.h"
+
+#include "../MMDevice/DeviceThreads.h"
+#include "../MMDevice/ImageMetadata.h"
+
+#include <boost/smart_ptr/shared_ptr.hpp>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+class CircularBuffer;
+
+/// Combines frames from a group of cameras into multi-channel frames.
+/**
+ * While enabled, frames inserted by the cameras of the group are held back
+ * until one frame from every camera is available that belongs to the same
+ * exposure. The matched set is then inserted into the circular buffer as a
+ * single multi-channel frame, channel i coming from camera i of the group.
+ *
+ * Frames are matched either by image number or by timestamp. Image numbers
+ * are taken from the camera's ImageNumber tag when present (counted from
+ * the first frame received after Reset()), and otherwise from the order of
+ * arrival. Timestamps are taken from the camera's ElapsedTime-ms tag when
+ * present, and otherwise from the arrival time in the core. Frames that
+ * cannot be matched (because a partner was lost, the timestamps differ by
+ * more than the allowed skew, or no partner arrived within the timeout) are
+ * discarded and counted.
+ *
+ * Frames from cameras outside the group are inserted unchanged.
+ */
+class FrameSynchronizer
+{
+public:
+   enum MatchMode
+   {
+      MatchImageNumber,
+      MatchTimestamp
+   };
+
+   FrameSynchronizer();
+   ~FrameSynchronizer();
+
+   void Enable(const std::vector<std::string>& cameraLabels, MatchMode mode,
+         double maxSkewMs, double timeoutMs);
+   void Disable();
+   bool IsEnabled() const;
+
+   // Discard all pending frames and restart image numbering
+   void Reset();
+
+   // Returns false if the circular buffer rejected the matched frame that
+   // this image completed; an image that is only queued is never rejected.
+   // With clearOnOverflow, the buffer is cleared and the matched frame
+   // inserted again instead, and true is returned.
+   bool InsertImage(CircularBuffer& cbuf, const std::string& cameraLabel,
+         const unsigned char* pixels, unsigned width, unsigned height,
+         unsigned byteDepth, unsigned nComponents, const Metadata& md,
+         bool clearOnOverflow) throw (CMMError);
+
+   unsigned long GetMatchedFrameCount() const;
+   unsigned long GetDroppedFrameCount() const;
+
+private:
+   FrameSynchronizer(const FrameSynchronizer&);
+   FrameSynchronizer& operator=(const FrameSynchronizer&);
+
+   struct Frame
+   {
+      std::vector<unsigned char> pixels;
+      unsigned width;
+      unsigned height;
+      unsigned byteDepth;
+      unsigned nComponents;
+      Metadata md;
+      long imageNumber;
+      double timestampMs;
+      double arrivalMs;
+   };
+   typedef boost::shared_ptr<Frame> FramePtr;
+   typedef std::vector<FramePtr> MatchedSet;
+
+   struct Channel
+   {
+      std::string label;
+      std::deque<FramePtr> queue;
+      long arrivalCount;
+      bool haveFirstImageNumber;
+      long firstImageNumber;
+   };
+
+   double NowMs() const;
+   Channel* FindChannel(const std::string& cameraLabel);
+   FramePtr AcquireFrame();
+   void ReleaseFrame(const FramePtr& frame);
+   void DropFront(Channel& channel);
+   void DropExpired(double nowMs);
+   void PopMatched(std::vector<MatchedSet>& matched, bool& incompatible);
+   bool InsertMatched(CircularBuffer& cbuf, const MatchedSet& frames,
+         bool clearOnOverflow);
+   void ClearQueues();
+
+   static const std::size_t maxQueuedFrames_ = 64;
+
+   mutable MMThreadLock lock_;
+   bool enabled_;
+   MatchMode mode_;
+   double maxSkewMs_;
+   double timeoutMs_;
+   std::vector<Channel> channels_;
+   std::vector<FramePtr> freeFrames_;
+   unsigned long long startNs_;
+
+   unsigned long matchedFrames_;
+   unsigned long droppedFrames_;
+};
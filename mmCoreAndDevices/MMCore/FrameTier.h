@@ -0,0 +1,74 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          FrameTier.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Interface of the overflow tiers of the circular buffer.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+
+#pragma once
+
+#include "../MMDevice/ImageMetadata.h"
+
+#include <cstddef>
+#include <vector>
+
+/// A FIFO of frames that do not fit in the circular buffer's frame slots.
+/**
+ * A frame is written in three steps: GetBackSlot() returns memory to which
+ * the uncompressed channels are written (the pixels of channel c starting at
+ * c times the channel size), StoreBack() stores them, and Push() appends the
+ * frame. Frames are indexed from the oldest (0).
+ *
+ * Not thread-safe; the circular buffer serializes access, except that the
+ * inserting thread writes to the back slot and calls StoreBack() without
+ * holding its lock, while other frames may be read or popped, and that
+ * frames are read with ReadChannel() without holding its lock, while frames
+ * may be inserted.
+ */
+class FrameTier
+{
+public:
+   virtual ~FrameTier() {}
+
+   // Discards all frames and sets the frame layout. elementBytes is the size
+   // of the samples of the pixels.
+   virtual void Reset(std::size_t channelBytes, unsigned maxChannels,
+         unsigned elementBytes) = 0;
+   // Number of frames that fit; 0 if the tier is not in use
+   virtual std::size_t GetCapacity() const = 0;
+   virtual std::size_t GetCount() const = 0;
+   virtual bool IsFull() const = 0;
+
+   // Memory to write the next frame to, valid until Push(); 0 if full
+   virtual unsigned char* GetBackSlot() = 0;
+   // Called after the given number of channels are written to the back slot
+   virtual void StoreBack(unsigned channels) { (void)channels; }
+   // Appends the stored frame, with one metadata per channel
+   virtual void Push(const std::vector<Metadata>& channelMetadata) = 0;
+
+   virtual const std::vector<Metadata>& GetMetadata(std::size_t index) const = 0;
+   // The stored frame, which stays in place until it is popped or the tier
+   // is reset
+   virtual const unsigned char* GetFrame(std::size_t index) const = 0;
+   // Reads a channel of a stored frame of the given number of channels
+   virtual void ReadChannel(const unsigned char* frame, unsigned channels,
+         unsigned channel, unsigned char* dest) const = 0;
+   // Discards the oldest frame
+   virtual void Pop() = 0;
+};
@@ -24,6 +24,7 @@
 #include "../Devices/DeviceInstances.h"
 #include "../CoreUtils.h"
 #include "../Error.h"
+#include "../MockDeviceAdapter.h"
 
 #include <boost/bind.hpp>
 #include <boost/make_shared.hpp>
@@ -31,6 +32,7 @@
 
 LoadedDeviceAdapter::LoadedDeviceAdapter(const std::string& name, const std::string& filename) :
    name_(name),
+   mock_(0),
    InitializeModuleData_(0),
    CreateDevice_(0),
    DeleteDevice_(0),
@@ -66,6 +68,24 @@ LoadedDeviceAdapter::LoadedDeviceAdapter(const std::string& name, const std::str
 }
 
 
+LoadedDeviceAdapter::LoadedDeviceAdapter(const std::string& name,
+      MockDeviceAdapter* mock) :
+   name_(name),
+   mock_(mock),
+   InitializeModuleData_(0),
+   CreateDevice_(0),
+   DeleteDevice_(0),
+   GetModuleVersion_(0),
+   GetDeviceInterfaceVersion_(0),
+   GetNumberOfDevices_(0),
+   GetDeviceName_(0),
+   GetDeviceType_(0),
+   GetDeviceDescription_(0)
+{
+   InitializeModuleData();
+}
+
+
 MMThreadLock*
 LoadedDeviceAdapter::GetLock()
 {
@@ -233,6 +253,12 @@ LoadedDeviceAdapter::CheckInterfaceVersion() const
 void
 LoadedDeviceAdapter::InitializeModuleData()
 {
+   if (mock_)
+   {
+      mock_->InitializeModuleData(boost::bind(
+               &LoadedDeviceAdapter::RegisterMockDevice, this, _1, _2, _3));
+      return;
+   }
    if (!InitializeModuleData_)
       InitializeModuleData_ = reinterpret_cast<fnInitializeModuleData>
          (module_->GetFunction("InitializeModuleData"));
@@ -243,6 +269,8 @@ LoadedDeviceAdapter::InitializeModuleData()
 MM::Device*
 LoadedDeviceAdapter::CreateDevice(const char* deviceName)
 {
+   if (mock_)
+      return mock_->CreateDevice(deviceName);
    if (!CreateDevice_)
       CreateDevice_ = reinterpret_cast<fnCreateDevice>
          (module_->GetFunction("CreateDevice"));
@@ -253,6 +281,11 @@ LoadedDeviceAdapter::CreateDevice(const char* deviceName)
 void
 LoadedDeviceAdapter::DeleteDevice(MM::Device* device)
 {
+   if (mock_)
+   {
+      mock_->DeleteDevice(device);
+      return;
+   }
    if (!DeleteDevice_)
       DeleteDevice_ = reinterpret_cast<fnDeleteDevice>
          (module_->GetFunction("DeleteDevice"));
@@ -263,6 +296,8 @@ LoadedDeviceAdapter::DeleteDevice(MM::Device* device)
 long
 LoadedDeviceAdapter::GetModuleVersion() const
 {
+   if (mock_)
+      return MODULE_INTERFACE_VERSION;
    if (!GetModuleVersion_)
       GetModuleVersion_ = reinterpret_cast<fnGetModuleVersion>
          (module_->GetFunction("GetModuleVersion"));
@@ -273,6 +308,8 @@ LoadedDeviceAdapter::GetModuleVersion() const
 long
 LoadedDeviceAdapter::GetDeviceInterfaceVersion() const
 {
+   if (mock_)
+      return DEVICE_INTERFACE_VERSION;
    if (!GetDeviceInterfaceVersion_)
       GetDeviceInterfaceVersion_ = reinterpret_cast<fnGetDeviceInterfaceVersion>
          (module_->GetFunction("GetDeviceInterfaceVersion"));
@@ -283,6 +320,8 @@ LoadedDeviceAdapter::GetDeviceInterfaceVersion() const
 unsigned
 LoadedDeviceAdapter::GetNumberOfDevices() const
 {
+   if (mock_)
+      return static_cast<unsigned>(mockDevices_.size());
    if (!GetNumberOfDevices_)
       GetNumberOfDevices_ = reinterpret_cast<fnGetNumberOfDevices>
          (module_->GetFunction("GetNumberOfDevices"));
@@ -293,6 +332,12 @@ LoadedDeviceAdapter::GetNumberOfDevices() const
 bool
 LoadedDeviceAdapter::GetDeviceName(unsigned index, char* buf, unsigned bufLen) const
 {
+   if (mock_)
+   {
+      if (index >= mockDevices_.size())
+         return false;
+      return CopyMockString(mockDevices_[index].name, buf, bufLen);
+   }
    if (!GetDeviceName_)
       GetDeviceName_ = reinterpret_cast<fnGetDeviceName>
          (module_->GetFunction("GetDeviceName"));
@@ -303,6 +348,12 @@ LoadedDeviceAdapter::GetDeviceName(unsigned index, char* buf, unsigned bufLen) c
 bool
 LoadedDeviceAdapter::GetDeviceType(const char* deviceName, int* type) const
 {
+   if (mock_)
+   {
+      const MockDeviceInfo* info = FindMockDevice(deviceName);
+      *type = info ? info->type : MM::UnknownType;
+      return info != 0;
+   }
    if (!GetDeviceType_)
       GetDeviceType_ = reinterpret_cast<fnGetDeviceType>
          (module_->GetFunction("GetDeviceType"));
@@ -313,8 +364,49 @@ LoadedDeviceAdapter::GetDeviceType(const char* deviceName, int* type) const
 bool
 LoadedDeviceAdapter::GetDeviceDescription(const char* deviceName, char* buf, unsigned bufLen) const
 {
+   if (mock_)
+   {
+      const MockDeviceInfo* info = FindMockDevice(deviceName);
+      return info && CopyMockString(info->description, buf, bufLen);
+   }
    if (!GetDeviceDescription_)
       GetDeviceDescription_ = reinterpret_cast<fnGetDeviceDescription>
          (module_->GetFunction("GetDeviceDescription"));
    return GetDeviceDescription_(deviceName, buf, bufLen);
 }
+
+
+void
+LoadedDeviceAdapter::RegisterMockDevice(const char* name, MM::DeviceType type,
+      const char* description)
+{
+   MockDeviceInfo info;
+   info.name = name;
+   info.type = type;
+   info.description = description ? description : "";
+   mockDevices_.push_back(info);
+}
+
+
+const LoadedDeviceAdapter::MockDeviceInfo*
+LoadedDeviceAdapter::FindMockDevice(const char* deviceName) const
+{
+   for (std::vector<MockDeviceInfo>::const_iterator it = mockDevices_.begin();
+         it != mockDevices_.end(); ++it)
+   {
+      if (it->name == deviceName)
+         return &*it;
+   }
+   return 0;
+}
+
+
+bool
+LoadedDeviceAdapter::CopyMockString(const std::string& str, char* buf,
+      unsigned bufLen)
+{
+   if (str.size() >= bufLen)
+      return false;
+   memcpy(buf, str.c_str(), str.size() + 1);
+   return true;
+}
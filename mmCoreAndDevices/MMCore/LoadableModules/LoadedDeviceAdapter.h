@@ -31,10 +31,14 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/utility.hpp>
 
+#include <string>
+#include <vector>
+
 class CMMCore;
 
 
 class DeviceInstance;
+class MockDeviceAdapter;
 
 
 class LoadedDeviceAdapter /* final */ :
@@ -43,10 +47,12 @@ class LoadedDeviceAdapter /* final */ :
 {
 public:
    LoadedDeviceAdapter(const std::string& name, const std::string& filename);
+   // For unit tests; the implementation is not owned
+   LoadedDeviceAdapter(const std::string& name, MockDeviceAdapter* mock);
 
    // TODO Unload() should mark the instance invalid (or require instance
    // deletion to unload)
-   void Unload() { module_->Unload(); } // For developer use only
+   void Unload() { if (module_) module_->Unload(); } // For developer use only
 
    std::string GetName() const { return name_; }
 
@@ -104,8 +110,23 @@ private:
    MM::Device* CreateDevice(const char* deviceName);
    void DeleteDevice(MM::Device* device);
 
+   struct MockDeviceInfo
+   {
+      std::string name;
+      MM::DeviceType type;
+      std::string description;
+   };
+
+   void RegisterMockDevice(const char* name, MM::DeviceType type,
+         const char* description);
+   const MockDeviceInfo* FindMockDevice(const char* deviceName) const;
+   static bool CopyMockString(const std::string& str, char* buf,
+         unsigned bufLen);
+
    const std::string name_;
    boost::shared_ptr<LoadedModule> module_;
+   MockDeviceAdapter* mock_; // Used instead of module_ if set
+   std::vector<MockDeviceInfo> mockDevices_;
 
    MMThreadLock lock_;
 
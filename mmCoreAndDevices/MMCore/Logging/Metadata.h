@@ -25,6 +25,8 @@
 #include <pthread.h>
 #endif
 
+#include "../CoreClock.h"
+
 #include <boost/date_time/posix_time/posix_time_types.hpp>
 
 
@@ -39,13 +41,11 @@ namespace internal
 
 typedef boost::posix_time::ptime TimestampType;
 
-// Note: Boost's local_time() internally calls the C library function
-// localtime_r() or localtime(). On the platforms we are interested in, either
-// the thread-safe localtime_r() is provided (OS X, Linux), or localtime() is
-// made thread-safe by using thread-local storage (Windows).
+// Derived from the monotonic core clock, so that log timestamps are cheap to
+// take and never go backwards.
 inline TimestampType
 Now()
-{ return boost::posix_time::microsec_clock::local_time(); }
+{ return mm::CoreClock::NowPtime(); }
 
 
 #ifdef _WIN32
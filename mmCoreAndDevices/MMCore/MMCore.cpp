@@ -42,19 +42,29 @@
 #include "../MMDevice/DeviceUtils.h"
 #include "../MMDevice/ImageMetadata.h"
 #include "../MMDevice/ModuleInterface.h"
+#include "AcquisitionEngine.h"
+#include "CallbackDispatcher.h"
 #include "CircularBuffer.h"
 #include "ConfigGroup.h"
 #include "Configuration.h"
 #include "CoreCallback.h"
 #include "CoreProperty.h"
 #include "CoreUtils.h"
+#include "DeviceCallTracer.h"
 #include "DeviceManager.h"
 #include "Devices/DeviceInstances.h"
+#include "DiskSink.h"
+#include "FrameCombiner.h"
+#include "FrameDemultiplexer.h"
+#include "FrameSynchronizer.h"
 #include "Host.h"
 #include "LogManager.h"
 #include "MMCore.h"
 #include "MMEventCallback.h"
 #include "PluginManager.h"
+#include "RemoteCoreServer.h"
+#include "SnapBuffer.h"
+#include "ThreadPool.h"
 
 #include <boost/date_time/posix_time/posix_time.hpp>
 
@@ -113,7 +123,7 @@ using namespace std;
  * (Keep the 3 numbers on one line to make it easier to look at diffs when
  * merging/rebasing.)
  */
-const int MMCore_versionMajor = 10, MMCore_versionMinor = 1, MMCore_versionPatch = 1;
+const int MMCore_versionMajor = 10, MMCore_versionMinor = 16, MMCore_versionPatch = 0;
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -133,6 +143,8 @@ CMMCore::CMMCore() :
    pollingIntervalMs_(10),
    timeoutMs_(5000),
    autoShutter_(true),
+   snapPipeline_(false),
+   stopOnOverflow_(false),
    callback_(0),
    configGroups_(0),
    properties_(0),
@@ -140,6 +152,7 @@ CMMCore::CMMCore() :
    pixelSizeGroup_(0),
    cbuf_(0),
    pluginManager_(new CPluginManager()),
+   callTracer_(new DeviceCallTracer()),
    deviceManager_(new mm::DeviceManager()),
    pPostedErrorsLock_(NULL)
 {
@@ -152,7 +165,15 @@ CMMCore::CMMCore() :
    callback_ = new CoreCallback(this);
 
    const unsigned seqBufMegabytes = (sizeof(void*) > 4) ? 250 : 25;
-   cbuf_ = new CircularBuffer(seqBufMegabytes);
+   threadPool_.reset(new ThreadPool());
+   cbuf_ = new CircularBuffer(seqBufMegabytes, threadPool_);
+   diskSink_.reset(new DiskSink());
+   callbackDispatcher_.reset(new CallbackDispatcher(coreLogger_));
+   frameSync_.reset(new FrameSynchronizer());
+   frameCombiner_.reset(new FrameCombiner());
+   frameDemux_.reset(new FrameDemultiplexer());
+   acqEngine_.reset(new mm::AcquisitionEngine(this));
+   snapBuffer_.reset(new SnapBuffer(2, threadPool_));
 
    nullAffine_ = new std::vector<double>(6);
    for (int i = 0; i < 6; i++) {
@@ -168,6 +189,11 @@ CMMCore::CMMCore() :
  */
 CMMCore::~CMMCore()
 {
+   // Remote clients must not call into the core from here on
+   stopRemoteCoreServer();
+   // Events still queued are delivered before the devices are unloaded
+   enableCallbackDispatchThread(false);
+
    try
    {
       // TODO We should attempt to continue cleanup beyond the first device
@@ -179,6 +205,9 @@ CMMCore::~CMMCore()
       LOG_ERROR(coreLogger_) << "Exception caught in CMMCore destructor.";
    }
 
+   cbuf_->DetachDiskSink();
+   diskSink_->Stop();
+
    delete callback_;
    delete configGroups_;
    delete properties_;
@@ -838,6 +867,8 @@ void CMMCore::unloadAllDevices() throw (CMMError)
  */
 void CMMCore::reset() throw (CMMError)
 {
+   acqEngine_->Stop();
+
    try
    {
    // before unloading everything try to apply shutdown configuration
@@ -1032,6 +1063,21 @@ void CMMCore::unloadLibrary(const char* moduleName) throw (CMMError)
    }
 }
 
+/**
+ * Registers a device adapter implemented by the calling program, so that its
+ * devices can be loaded with loadDevice() under the given module name.
+ *
+ * This is meant for unit tests of the Core; the implementation is not owned
+ * and must outlive the loaded devices.
+ */
+void CMMCore::loadMockDeviceAdapter(const char* name,
+      MockDeviceAdapter* implementation) throw (CMMError)
+{
+   if (name == 0 || implementation == 0)
+      throw CMMError("Null mock device adapter name or implementation");
+   pluginManager_->AddMockDeviceAdapter(name, implementation);
+}
+
 /**
  * Returns device name for a given device label.
  * "Name" is determined by the library and is immutable, while "label" is
@@ -1230,6 +1276,69 @@ void CMMCore::waitForDevice(boost::shared_ptr<DeviceInstance> pDev) throw (CMMEr
    LOG_DEBUG(coreLogger_) << "Finished waiting for device " << pDev->GetLabel();
 }
 
+/**
+ * Waits for a shutter that was closed by a pipelined snap to finish closing.
+ */
+void CMMCore::waitForPendingShutterClose() throw (CMMError)
+{
+   boost::shared_ptr<ShutterInstance> shutter = pendingShutterClose_.lock();
+   pendingShutterClose_.reset();
+   if (shutter)
+      waitForDevice(shutter);
+}
+
+/**
+ * Applies the current image processor to a snapped image and returns the
+ * processed pixels.
+ *
+ * If useChannel is false, the image is fetched with the camera's
+ * GetImageBuffer() without a channel argument. In pipelined snap mode the
+ * image is copied into the snap buffer first and processed there, so that
+ * the camera buffer is released as soon as possible; otherwise it is
+ * processed in place in the camera buffer.
+ */
+void* CMMCore::processSnappedImage(boost::shared_ptr<CameraInstance> camera,
+      bool useChannel, unsigned channelNr) throw (CMMError)
+{
+   unsigned width, height, bytesPerPixel;
+   unsigned char* pBuf;
+   {
+      mm::DeviceModuleLockGuard guard(camera);
+      const unsigned char* pixels = useChannel ?
+         camera->GetImageBuffer(channelNr) : camera->GetImageBuffer();
+      width = camera->GetImageWidth();
+      height = camera->GetImageHeight();
+      bytesPerPixel = camera->GetImageBytesPerPixel();
+
+      if (snapPipeline_)
+         pBuf = snapBuffer_->Store(pixels,
+               static_cast<std::size_t>(width) * height * bytesPerPixel);
+      else
+         pBuf = const_cast<unsigned char*>(pixels);
+
+      if (!snapPipeline_ && pBuf)
+      {
+         boost::shared_ptr<ImageProcessorInstance> imageProcessor =
+            currentImageProcessor_.lock();
+         if (imageProcessor)
+            imageProcessor->Process(pBuf, width, height, bytesPerPixel);
+         return pBuf;
+      }
+   }
+
+   if (pBuf)
+   {
+      boost::shared_ptr<ImageProcessorInstance> imageProcessor =
+         currentImageProcessor_.lock();
+      if (imageProcessor)
+      {
+         mm::DeviceModuleLockGuard guard(imageProcessor);
+         imageProcessor->Process(pBuf, width, height, bytesPerPixel);
+      }
+   }
+   return pBuf;
+}
+
 /**
  * Checks the busy status of the entire system. The system will report busy if any
  * of the devices is busy.
@@ -1393,16 +1502,51 @@ void CMMCore::setRelativePosition(double d) throw (CMMError)
 
 /**
  * Returns the current position of the stage in microns.
+ *
+ * If a position cache max age has been set for the stage (see
+ * setStagePositionCacheMaxAgeMs()), a position known to the core that is no
+ * older than that may be returned without querying the device.
+ *
  * @return the position in microns
  * @param label     the single-axis drive device label
  */
 double CMMCore::getPosition(const char* label) throw (CMMError)
+{
+   boost::shared_ptr<StageInstance> pStage =
+      deviceManager_->GetDeviceOfType<StageInstance>(label);
+   return getPosition(label,
+         pStage->GetPositionCache().GetDefaultMaxAgeMs());
+}
+
+/**
+ * Returns the position of the stage in microns, allowing a position known to
+ * the core to be returned if it is no older than maxAgeMs.
+ *
+ * The core knows the position last read from the device or reported by the
+ * device through a position change notification. No position is served
+ * from the cache after a move has been started through the core until the
+ * stage has been found to be no longer busy (for example by waitForDevice()
+ * or deviceBusy()); a cached read that finds a move pending checks this
+ * itself.
+ *
+ * @return the position in microns
+ * @param label     the single-axis drive device label
+ * @param maxAgeMs  the maximum age of a cached position, in milliseconds; 0
+ *                  always queries the device
+ */
+double CMMCore::getPosition(const char* label, double maxAgeMs) throw (CMMError)
 {
    boost::shared_ptr<StageInstance> pStage =
       deviceManager_->GetDeviceOfType<StageInstance>(label);
 
+   PositionCache& cache = pStage->GetPositionCache();
+   double pos, unused;
+   if (cache.Get(maxAgeMs, pos, unused))
+      return pos;
+
    mm::DeviceModuleLockGuard guard(pStage);
-   double pos;
+   if (maxAgeMs > 0.0 && cache.IsMovePending())
+      pStage->Busy(); // Lets the cache be used again if the move is done
    int ret = pStage->GetPositionUm(pos);
    if (ret != DEVICE_OK)
    {
@@ -1493,6 +1637,11 @@ void CMMCore::setRelativeXYPosition(double dx, double dy) throw (CMMError) {
 
 /**
  * Obtains the current position of the XY stage in microns.
+ *
+ * If a position cache max age has been set for the stage (see
+ * setStagePositionCacheMaxAgeMs()), a position known to the core that is no
+ * older than that may be returned without querying the device.
+ *
  * @param label   the stage device label
  * @param x            a return parameter yielding the X position in microns
  * @param y            a return parameter yielding the Y position in microns
@@ -1501,8 +1650,36 @@ void CMMCore::getXYPosition(const char* label, double& x, double& y) throw (CMME
 {
    boost::shared_ptr<XYStageInstance> pXYStage =
       deviceManager_->GetDeviceOfType<XYStageInstance>(label);
+   getXYPosition(label, pXYStage->GetPositionCache().GetDefaultMaxAgeMs(),
+         x, y);
+}
+
+/**
+ * Obtains the position of the XY stage in microns, allowing a position known
+ * to the core to be returned if it is no older than maxAgeMs.
+ *
+ * See getPosition(const char*, double) for when cached positions are
+ * available.
+ *
+ * @param label     the stage device label
+ * @param maxAgeMs  the maximum age of a cached position, in milliseconds; 0
+ *                  always queries the device
+ * @param x         a return parameter yielding the X position in microns
+ * @param y         a return parameter yielding the Y position in microns
+ */
+void CMMCore::getXYPosition(const char* label, double maxAgeMs,
+      double& x, double& y) throw (CMMError)
+{
+   boost::shared_ptr<XYStageInstance> pXYStage =
+      deviceManager_->GetDeviceOfType<XYStageInstance>(label);
+
+   PositionCache& cache = pXYStage->GetPositionCache();
+   if (cache.Get(maxAgeMs, x, y))
+      return;
 
    mm::DeviceModuleLockGuard guard(pXYStage);
+   if (maxAgeMs > 0.0 && cache.IsMovePending())
+      pXYStage->Busy(); // Lets the cache be used again if the move is done
    int ret = pXYStage->GetPositionUm(x, y);
    if (ret != DEVICE_OK)
    {
@@ -1529,18 +1706,8 @@ void CMMCore::getXYPosition(double& x, double& y) throw (CMMError)
  */
 double CMMCore::getXPosition(const char* label) throw (CMMError)
 {
-   boost::shared_ptr<XYStageInstance> pXYStage =
-      deviceManager_->GetDeviceOfType<XYStageInstance>(label);
-
-   mm::DeviceModuleLockGuard guard(pXYStage);
    double x, y;
-   int ret = pXYStage->GetPositionUm(x, y);
-   if (ret != DEVICE_OK)
-   {
-      logError(pXYStage->GetName().c_str(), getDeviceErrorText(ret, pXYStage).c_str());
-      throw CMMError(getDeviceErrorText(ret, pXYStage).c_str(), MMERR_DEVICE_GENERIC);
-   }
-
+   getXYPosition(label, x, y);
    return x;
 }
 
@@ -1562,18 +1729,8 @@ double CMMCore::getXPosition() throw (CMMError)
  */
 double CMMCore::getYPosition(const char* label) throw (CMMError)
 {
-   boost::shared_ptr<XYStageInstance> pXYStage =
-      deviceManager_->GetDeviceOfType<XYStageInstance>(label);
-
-   mm::DeviceModuleLockGuard guard(pXYStage);
    double x, y;
-   int ret = pXYStage->GetPositionUm(x, y);
-   if (ret != DEVICE_OK)
-   {
-      logError(pXYStage->GetName().c_str(), getDeviceErrorText(ret, pXYStage).c_str());
-      throw CMMError(getDeviceErrorText(ret, pXYStage).c_str(), MMERR_DEVICE_GENERIC);
-   }
-
+   getXYPosition(label, x, y);
    return y;
 }
 
@@ -1588,6 +1745,67 @@ double CMMCore::getYPosition() throw (CMMError)
     return getYPosition(getXYStageDevice().c_str());
 }
 
+/**
+ * Sets the maximum age of a cached position that getPosition(),
+ * getXYPosition(), getXPosition() and getYPosition() may return for a
+ * stage, instead of querying the device.
+ *
+ * This is useful for stages that are slow to query (for example over a
+ * serial port) and that are polled frequently. Positions read from the device
+ * or reported by the device are cached; the cache is not used after a move
+ * has been started through the core until the stage is no longer busy. The
+ * overloads of getPosition() and getXYPosition() that take a max age can be
+ * used regardless of this setting.
+ *
+ * The setting is not saved in the system configuration.
+ *
+ * @param xyOrZStageLabel  the stage device label (either XY or focus/Z stage)
+ * @param maxAgeMs  the maximum age in milliseconds; 0 (the default) disables
+ *                  the cache
+ */
+void CMMCore::setStagePositionCacheMaxAgeMs(const char* xyOrZStageLabel,
+      double maxAgeMs) throw (CMMError)
+{
+   boost::shared_ptr<DeviceInstance> stage =
+      deviceManager_->GetDevice(xyOrZStageLabel);
+
+   if (stage->GetType() == MM::XYStageDevice)
+   {
+      deviceManager_->GetDeviceOfType<XYStageInstance>(stage)->
+         GetPositionCache().SetDefaultMaxAgeMs(maxAgeMs);
+   }
+   else
+   {
+      deviceManager_->GetDeviceOfType<StageInstance>(stage)->
+         GetPositionCache().SetDefaultMaxAgeMs(maxAgeMs);
+   }
+
+   LOG_DEBUG(coreLogger_) << "Position cache max age of " <<
+      xyOrZStageLabel << " set to " << maxAgeMs << " ms";
+}
+
+/**
+ * Returns the maximum age of a cached position returned by getPosition(),
+ * getXYPosition(), getXPosition() and getYPosition() for a stage.
+ *
+ * @param xyOrZStageLabel  the stage device label (either XY or focus/Z stage)
+ * @return the maximum age in milliseconds; 0 if the cache is not used
+ */
+double CMMCore::getStagePositionCacheMaxAgeMs(const char* xyOrZStageLabel)
+   throw (CMMError)
+{
+   boost::shared_ptr<DeviceInstance> stage =
+      deviceManager_->GetDevice(xyOrZStageLabel);
+
+   if (stage->GetType() == MM::XYStageDevice)
+   {
+      return deviceManager_->GetDeviceOfType<XYStageInstance>(stage)->
+         GetPositionCache().GetDefaultMaxAgeMs();
+   }
+   return deviceManager_->GetDeviceOfType<StageInstance>(stage)->
+      GetPositionCache().GetDefaultMaxAgeMs();
+}
+
 /**
  * Stop the XY or focus/Z stage motors
  *
@@ -2375,6 +2593,12 @@ void CMMCore::snapImage() throw (CMMError)
          // open the shutter
          boost::shared_ptr<ShutterInstance> shutter =
             currentShutterDevice_.lock();
+         if (!autoShutter_ || shutter != pendingShutterClose_.lock())
+         {
+            // Opening the same shutter below waits for it anyway
+            waitForPendingShutterClose();
+         }
+         pendingShutterClose_.reset();
          if (autoShutter_ && shutter)
          {
             int sret = shutter->SetOpen(true);
@@ -2386,6 +2610,8 @@ void CMMCore::snapImage() throw (CMMError)
             waitForDevice(shutter);
          }
 
+         snapBuffer_->BeginSnap();
+
          LOG_DEBUG(coreLogger_) << "Will snap image from current camera";
          ret = camera->SnapImage();
          if (ret == DEVICE_OK)
@@ -2408,7 +2634,12 @@ void CMMCore::snapImage() throw (CMMError)
                logError("CMMCore::snapImage", getDeviceErrorText(sret, shutter).c_str());
                throw CMMError(getDeviceErrorText(sret, shutter).c_str(), MMERR_DEVICE_GENERIC);
             }
-            waitForDevice(shutter);
+            // In pipelined mode the shutter closes while the camera reads
+            // out; completion is awaited before the next exposure instead.
+            if (snapPipeline_)
+               pendingShutterClose_ = shutter;
+            else
+               waitForDevice(shutter);
          }
 		}catch( CMMError& e){
 			throw e;
@@ -2520,6 +2751,8 @@ bool CMMCore::getAutoShutter()
 */
 void CMMCore::setShutterOpen(const char* shutterLabel, bool state) throw (CMMError)
 {
+   waitForPendingShutterClose();
+
    boost::shared_ptr<ShutterInstance> pShutter =
       deviceManager_->GetDeviceOfType<ShutterInstance>(shutterLabel);
    if (pShutter)
@@ -2634,15 +2867,7 @@ void* CMMCore::getImage() throw (CMMError)
 
       void* pBuf(0);
       try {
-         mm::DeviceModuleLockGuard guard(camera);
-         pBuf = const_cast<unsigned char*> (camera->GetImageBuffer());
-
-         boost::shared_ptr<ImageProcessorInstance> imageProcessor =
-            currentImageProcessor_.lock();
-         if (imageProcessor)
-	      {
-            imageProcessor->Process((unsigned char*)pBuf, camera->GetImageWidth(),  camera->GetImageHeight(), camera->GetImageBytesPerPixel() );
-	      }
+         pBuf = processSnappedImage(camera, false, 0);
 		} catch( CMMError& e){
 			throw e;
 		} catch (...) {
@@ -2681,15 +2906,7 @@ void* CMMCore::getImage(unsigned channelNr) throw (CMMError)
    {
       void* pBuf(0);
       try {
-         mm::DeviceModuleLockGuard guard(camera);
-         pBuf = const_cast<unsigned char*> (camera->GetImageBuffer(channelNr));
-
-         boost::shared_ptr<ImageProcessorInstance> imageProcessor =
-            currentImageProcessor_.lock();
-         if (imageProcessor)
-	      {
-            imageProcessor->Process((unsigned char*)pBuf, camera->GetImageWidth(),  camera->GetImageHeight(), camera->GetImageBytesPerPixel() );
-	      }
+         pBuf = processSnappedImage(camera, true, channelNr);
 		} catch( CMMError& e){
 			throw e;
 		} catch (...) {
@@ -2707,6 +2924,66 @@ void* CMMCore::getImage(unsigned channelNr) throw (CMMError)
    }
 }
 
+/**
+ * Enables or disables pipelined snapping.
+ *
+ * In pipelined mode, snapImage() returns without waiting for the auto-shutter
+ * to finish closing, so that the shutter closes while the camera is reading
+ * out. The wait is deferred to the start of the next snap (or skipped when
+ * the same shutter is about to be opened again, because opening waits for
+ * the shutter anyway), or to the next setShutterOpen() or start of a
+ * sequence acquisition.
+ *
+ * Additionally, getImage() copies the camera's image into a small ring of
+ * snap buffers (see setSnapBufferSlotCount()) and runs the image processor
+ * on the copy, outside of the camera's module lock. The returned pointer
+ * remains valid until as many further images as there are slots have been
+ * retrieved with getImage(), so the caller may keep processing an image while
+ * the next one is being snapped.
+ *
+ * @param enable  true to enable pipelined snapping
+ */
+void CMMCore::enableSnapPipeline(bool enable)
+{
+   if (!enable)
+      waitForPendingShutterClose();
+   snapPipeline_ = enable;
+   LOG_DEBUG(coreLogger_) << "Snap pipeline turned " << (enable ? "on" : "off");
+}
+
+/**
+ * Returns whether pipelined snapping is enabled.
+ */
+bool CMMCore::isSnapPipelineEnabled() const
+{
+   return snapPipeline_;
+}
+
+/**
+ * Sets the number of image slots used by getImage() in pipelined snap mode.
+ *
+ * The new count takes effect at the next snapImage(); until then, images
+ * returned by getImage() remain valid as before.
+ *
+ * @param slotCount  number of slots (at least 1; the default is 2)
+ */
+void CMMCore::setSnapBufferSlotCount(unsigned slotCount) throw (CMMError)
+{
+   if (slotCount < 1)
+      throw CMMError("Snap buffer slot count must be at least 1",
+            MMERR_InvalidContents);
+   snapBuffer_->SetSlotCount(slotCount);
+   LOG_DEBUG(coreLogger_) << "Snap buffer slot count set to " << slotCount;
+}
+
+/**
+ * Returns the number of image slots used in pipelined snap mode.
+ */
+unsigned CMMCore::getSnapBufferSlotCount() const
+{
+   return snapBuffer_->GetSlotCount();
+}
+
 /**
 * Returns the size of the internal image buffer.
 *
@@ -2751,17 +3028,22 @@ void CMMCore::startSequenceAcquisition(long numImages, double intervalMs, bool s
             ,MMERR_NotAllowedDuringSequenceAcquisition);
       }
 
+      waitForPendingShutterClose();
+
 		try
 		{
-			if (!cbuf_->Initialize(camera->GetNumberOfChannels(), camera->GetImageWidth(), camera->GetImageHeight(), camera->GetImageBytesPerPixel()))
+			if (!initializeCircularBufferFor(camera->GetNumberOfChannels(), camera->GetImageWidth(), camera->GetImageHeight(), camera->GetImageBytesPerPixel()))
 			{
 				logError(getDeviceName(camera).c_str(), getCoreErrorText(MMERR_CircularBufferFailedToInitialize).c_str());
 				throw CMMError(getCoreErrorText(MMERR_CircularBufferFailedToInitialize).c_str(), MMERR_CircularBufferFailedToInitialize);
 			}
 			cbuf_->Clear();
+			frameSync_->Reset();
+			frameCombiner_->Reset();
          mm::DeviceModuleLockGuard guard(camera);
 
          LOG_DEBUG(coreLogger_) << "Will start sequence acquisition from default camera";
+         stopOnOverflow_ = stopOnOverflow;
 			int nRet = camera->StartSequenceAcquisition(numImages, intervalMs, stopOnOverflow);
 			if (nRet != DEVICE_OK)
 				throw CMMError(getDeviceErrorText(nRet, camera).c_str(), MMERR_DEVICE_GENERIC);
@@ -2797,8 +3079,11 @@ void CMMCore::startSequenceAcquisition(const char* label, long numImages, double
       throw CMMError(getCoreErrorText(MMERR_NotAllowedDuringSequenceAcquisition).c_str(),
                      MMERR_NotAllowedDuringSequenceAcquisition);
 
+   waitForPendingShutterClose();
+
    LOG_DEBUG(coreLogger_) <<
       "Will start sequence acquisition from camera " << label;
+   stopOnOverflow_ = stopOnOverflow;
    int nRet = pCam->StartSequenceAcquisition(numImages, intervalMs, stopOnOverflow);
    if (nRet != DEVICE_OK)
       throw CMMError(getDeviceErrorText(nRet, pCam).c_str(), MMERR_DEVICE_GENERIC);
@@ -2832,6 +3117,21 @@ void CMMCore::prepareSequenceAcquisition(const char* label) throw (CMMError)
 }
 
 
+// Sizes the circular buffer for the frames inserted from a camera with the
+// given image format. These differ from the camera's images when frames are
+// demultiplexed.
+bool CMMCore::initializeCircularBufferFor(unsigned channels, unsigned width,
+      unsigned height, unsigned byteDepth)
+{
+   if (frameDemux_->IsEnabled())
+   {
+      channels = frameDemux_->GetChannelCount();
+      width = frameDemux_->GetChannelWidth();
+      height = frameDemux_->GetChannelHeight();
+   }
+   return cbuf_->Initialize(channels, width, height, byteDepth);
+}
+
 /**
  * Initialize circular buffer based on the current camera settings.
  */
@@ -2841,12 +3141,14 @@ void CMMCore::initializeCircularBuffer() throw (CMMError)
    if (camera)
    {
       mm::DeviceModuleLockGuard guard(camera);
-      if (!cbuf_->Initialize(camera->GetNumberOfChannels(), camera->GetImageWidth(), camera->GetImageHeight(), camera->GetImageBytesPerPixel()))
+      if (!initializeCircularBufferFor(camera->GetNumberOfChannels(), camera->GetImageWidth(), camera->GetImageHeight(), camera->GetImageBytesPerPixel()))
       {
          logError(getDeviceName(camera).c_str(), getCoreErrorText(MMERR_CircularBufferFailedToInitialize).c_str());
          throw CMMError(getCoreErrorText(MMERR_CircularBufferFailedToInitialize).c_str(), MMERR_CircularBufferFailedToInitialize);
       }
       cbuf_->Clear();
+      frameSync_->Reset();
+      frameCombiner_->Reset();
    }
    else
    {
@@ -2893,13 +3195,18 @@ void CMMCore::startContinuousSequenceAcquisition(double intervalMs) throw (CMMEr
             ,MMERR_NotAllowedDuringSequenceAcquisition);
       }
 
-      if (!cbuf_->Initialize(camera->GetNumberOfChannels(), camera->GetImageWidth(), camera->GetImageHeight(), camera->GetImageBytesPerPixel()))
+      waitForPendingShutterClose();
+
+      if (!initializeCircularBufferFor(camera->GetNumberOfChannels(), camera->GetImageWidth(), camera->GetImageHeight(), camera->GetImageBytesPerPixel()))
       {
          logError(getDeviceName(camera).c_str(), getCoreErrorText(MMERR_CircularBufferFailedToInitialize).c_str());
          throw CMMError(getCoreErrorText(MMERR_CircularBufferFailedToInitialize).c_str(), MMERR_CircularBufferFailedToInitialize);
       }
       cbuf_->Clear();
+      frameSync_->Reset();
+      frameCombiner_->Reset();
       LOG_DEBUG(coreLogger_) << "Will start continuous sequence acquisition from current camera";
+      stopOnOverflow_ = false;
       int nRet = camera->StartSequenceAcquisition(intervalMs);
       if (nRet != DEVICE_OK)
          throw CMMError(getDeviceErrorText(nRet, camera).c_str(), MMERR_DEVICE_GENERIC);
@@ -3113,115 +3420,968 @@ void* CMMCore::popNextImageMD(Metadata& md) throw (CMMError)
  * It is rarely necessary to call this directly since starting a sequence
  * acquisition or changing the ROI will always clear the buffer.
  */
-void CMMCore::clearCircularBuffer() throw (CMMError)
+void CMMCore::clearCircularBuffer() throw (CMMError)
+{
+   cbuf_->Clear();
+   frameSync_->Reset();
+   frameCombiner_->Reset();
+}
+
+/**
+ * Starts streaming all frames inserted into the circular buffer to disk.
+ *
+ * Frames are written, as they are inserted, by a dedicated writer thread
+ * into a raw stack file (pathPrefix + ".raw") using unbuffered I/O where
+ * the file system supports it. A binary index with the geometry, file offset
+ * and metadata of each frame is written to pathPrefix + ".idx"; see
+ * DiskSink.h for the format. Frames are still inserted into the circular
+ * buffer as usual. If the disk cannot keep up, frames are skipped in the
+ * stream and counted (see getDiskStreamingDroppedFrameCount()).
+ *
+ * Any stream in progress is stopped first.
+ *
+ * @param pathPrefix  path of the output files, without extension
+ */
+void CMMCore::startDiskStreaming(const char* pathPrefix) throw (CMMError)
+{
+   if (!pathPrefix || !*pathPrefix)
+      throw CMMError("Null or empty disk streaming path",
+            MMERR_NullPointerException);
+
+   stopDiskStreaming();
+   diskSink_->Start(pathPrefix);
+   cbuf_->AttachDiskSink(diskSink_);
+   LOG_INFO(coreLogger_) << "Started streaming images to " << pathPrefix;
+}
+
+/**
+ * Stops streaming frames to disk, after writing out all pending frames.
+ *
+ * @throws CMMError if any write error occurred during streaming
+ */
+void CMMCore::stopDiskStreaming() throw (CMMError)
+{
+   if (!diskSink_->IsActive())
+      return;
+
+   cbuf_->DetachDiskSink();
+   bool ok = diskSink_->Stop();
+   LOG_INFO(coreLogger_) << "Stopped streaming images to disk after " <<
+      diskSink_->GetWrittenFrameCount() << " frames (" <<
+      diskSink_->GetDroppedFrameCount() << " dropped)";
+   if (!ok)
+   {
+      logError("CMMCore::stopDiskStreaming", diskSink_->GetLastError().c_str());
+      throw CMMError(diskSink_->GetLastError(), MMERR_DiskStreamingFailed);
+   }
+}
+
+/**
+ * Returns whether frames are currently being streamed to disk.
+ */
+bool CMMCore::isDiskStreaming()
+{
+   return diskSink_->IsActive();
+}
+
+/**
+ * Returns the number of frames written to disk by the current (or last)
+ * stream. Multi-channel frames count once per channel.
+ */
+long CMMCore::getDiskStreamingFrameCount()
+{
+   return static_cast<long>(diskSink_->GetWrittenFrameCount());
+}
+
+/**
+ * Returns the number of frames that were skipped by the current (or last)
+ * stream because the disk could not keep up.
+ */
+long CMMCore::getDiskStreamingDroppedFrameCount()
+{
+   return static_cast<long>(diskSink_->GetDroppedFrameCount());
+}
+
+/**
+ * Enables synchronization of sequence frames from several cameras.
+ *
+ * While enabled, frames inserted by the given cameras are not placed in the
+ * circular buffer individually. Instead, one frame from each camera is
+ * matched up and the set is inserted as a single multi-channel frame, with
+ * channel i taken from cameraLabels[i]. This is intended for use with a
+ * multi-camera device (such as Utilities' Multi Camera) as the current
+ * camera, whose number of channels sizes the circular buffer accordingly.
+ *
+ * Frames are matched by image number or, if matchTimestamps is true, by
+ * timestamp (the camera's ElapsedTime-ms tag if present, otherwise the
+ * time of arrival in the core). Frames whose timestamps differ by more than
+ * maxSkewMs, or that wait longer than timeoutMs for a partner, are discarded
+ * and counted in getMultiCameraSyncDroppedFrameCount().
+ *
+ * @param cameraLabels     labels of the physical cameras, in channel order
+ * @param matchTimestamps  match by timestamp instead of image number
+ * @param maxSkewMs        largest allowed timestamp difference within a set
+ * @param timeoutMs        longest time a frame waits for its partners
+ */
+void CMMCore::enableMultiCameraSync(std::vector<std::string> cameraLabels,
+      bool matchTimestamps, double maxSkewMs, double timeoutMs) throw (CMMError)
+{
+   if (cameraLabels.size() < 2)
+      throw CMMError("At least two cameras are needed for synchronization",
+            MMERR_InvalidContents);
+   if (maxSkewMs < 0.0 || timeoutMs <= 0.0)
+      throw CMMError("Invalid multi-camera synchronization skew or timeout",
+            MMERR_InvalidContents);
+
+   std::set<std::string> seen;
+   for (std::vector<std::string>::const_iterator it = cameraLabels.begin();
+         it != cameraLabels.end(); ++it)
+   {
+      // Throws if the label is not a camera
+      deviceManager_->GetDeviceOfType<CameraInstance>(*it);
+      if (!seen.insert(*it).second)
+         throw CMMError("Camera " + ToQuotedString(*it) +
+               " is listed more than once", MMERR_InvalidContents);
+   }
+
+   if (frameDemux_->IsEnabled())
+      throw CMMError("Multi-camera synchronization cannot be combined with "
+            "frame demultiplexing", MMERR_InvalidContents);
+
+   frameSync_->Enable(cameraLabels, matchTimestamps ?
+         FrameSynchronizer::MatchTimestamp :
+         FrameSynchronizer::MatchImageNumber, maxSkewMs, timeoutMs);
+   LOG_INFO(coreLogger_) << "Enabled synchronization of " <<
+      cameraLabels.size() << " cameras";
+}
+
+/**
+ * Disables multi-camera synchronization. Frames still waiting for their
+ * partners are discarded.
+ */
+void CMMCore::disableMultiCameraSync()
+{
+   frameSync_->Disable();
+   LOG_INFO(coreLogger_) << "Disabled multi-camera synchronization";
+}
+
+/**
+ * Returns whether multi-camera synchronization is enabled.
+ */
+bool CMMCore::isMultiCameraSyncEnabled()
+{
+   return frameSync_->IsEnabled();
+}
+
+/**
+ * Returns the number of multi-channel frames assembled by the synchronizer
+ * since the last sequence acquisition was started.
+ */
+long CMMCore::getMultiCameraSyncMatchedFrameCount()
+{
+   return static_cast<long>(frameSync_->GetMatchedFrameCount());
+}
+
+/**
+ * Returns the number of camera frames the synchronizer discarded since the
+ * last sequence acquisition was started.
+ */
+long CMMCore::getMultiCameraSyncDroppedFrameCount()
+{
+   return static_cast<long>(frameSync_->GetDroppedFrameCount());
+}
+
+/**
+ * Enables combining of sequence frames in the core.
+ *
+ * While enabled, every frameCount consecutive frames inserted by a camera
+ * are combined into a single frame, and only the combined frame is placed
+ * in the circular buffer (and hence streamed to disk or returned by
+ * popNextImage()). This allows running a camera at full frame rate for
+ * signal-to-noise while reducing the downstream data rate frameCount-fold.
+ *
+ * The mode is one of:
+ * - "Mean": pixel-wise rounded average, in the camera's pixel type
+ * - "Sum": pixel-wise sum, in the camera's pixel type; sums above the
+ *   largest sample value (255 or 65535) are clipped to it
+ * - "Max", "Min": maximum or minimum intensity projection
+ *
+ * Combined frames carry the metadata of the first frame of each group,
+ * with the FrameCombiner-Count and FrameCombiner-Mode tags added. Snapped
+ * images are not affected.
+ *
+ * @param frameCount  number of frames combined into one (1 to 65536)
+ * @param mode        "Mean", "Sum", "Max" or "Min"
+ */
+void CMMCore::enableFrameCombining(long frameCount, const char* mode)
+   throw (CMMError)
+{
+   FrameCombiner::Mode combineMode;
+   if (!mode || !FrameCombiner::ParseMode(mode, combineMode))
+      throw CMMError("Invalid frame combining mode " +
+            ToQuotedString(mode ? mode : ""), MMERR_InvalidContents);
+   if (frameCount < 1 || frameCount > (long)FrameCombiner::maxFrameCount)
+      throw CMMError("Invalid number of frames to combine",
+            MMERR_InvalidContents);
+   if (isSequenceRunning())
+      throw CMMError(getCoreErrorText(
+               MMERR_NotAllowedDuringSequenceAcquisition).c_str(),
+            MMERR_NotAllowedDuringSequenceAcquisition);
+
+   frameCombiner_->Enable(static_cast<unsigned>(frameCount), combineMode);
+   LOG_INFO(coreLogger_) << "Enabled frame combining (" << mode << " of " <<
+      frameCount << " frames)";
+}
+
+/**
+ * Disables frame combining. Frames of an incomplete group are discarded.
+ */
+void CMMCore::disableFrameCombining() throw (CMMError)
+{
+   if (isSequenceRunning())
+      throw CMMError(getCoreErrorText(
+               MMERR_NotAllowedDuringSequenceAcquisition).c_str(),
+            MMERR_NotAllowedDuringSequenceAcquisition);
+
+   frameCombiner_->Disable();
+   LOG_INFO(coreLogger_) << "Disabled frame combining";
+}
+
+/**
+ * Returns whether frame combining is enabled.
+ */
+bool CMMCore::isFrameCombiningEnabled()
+{
+   return frameCombiner_->IsEnabled();
+}
+
+/**
+ * Returns the number of frames combined into one.
+ */
+long CMMCore::getFrameCombiningFrameCount()
+{
+   return static_cast<long>(frameCombiner_->GetFrameCount());
+}
+
+/**
+ * Returns the frame combining mode ("Mean", "Sum", "Max" or "Min").
+ */
+std::string CMMCore::getFrameCombiningMode()
+{
+   return FrameCombiner::GetModeName(frameCombiner_->GetMode());
+}
+
+/**
+ * Enables splitting of sequence frames into multi-channel frames.
+ *
+ * This is intended for image splitters and multi-ROI cameras, which deliver
+ * several sub-images in one frame. While enabled, each sequence frame is cut
+ * into the given regions, which become the channels of one multi-channel
+ * frame in the circular buffer (channel i from region i, retrieved with
+ * popNextImageMD(i, 0, md) and tagged with CameraChannelIndex i). Each region
+ * is copied once, directly into the circular buffer, applying its transform.
+ *
+ * The transforms are "None", "FlipHorizontal", "FlipVertical", "Rotate90",
+ * "Rotate180" or "Rotate270" (rotations are clockwise); an empty list means
+ * no transform for any region. All regions must have the same size after
+ * their transform, which is the size of the channel images (available
+ * from their Width and Height tags). Snapped images are not affected.
+ *
+ * @param x           left edges of the regions, in pixels of the frame
+ * @param y           top edges of the regions
+ * @param width       widths of the regions
+ * @param height      heights of the regions
+ * @param transforms  transform applied to each region, or empty
+ */
+void CMMCore::enableFrameDemultiplexing(std::vector<long> x,
+      std::vector<long> y, std::vector<long> width, std::vector<long> height,
+      std::vector<std::string> transforms) throw (CMMError)
+{
+   const std::size_t n = x.size();
+   if (y.size() != n || width.size() != n || height.size() != n ||
+         (!transforms.empty() && transforms.size() != n))
+      throw CMMError("Frame demultiplexing regions are inconsistently "
+            "specified", MMERR_InvalidContents);
+
+   std::vector<FrameDemultiplexer::Region> regions(n);
+   for (std::size_t i = 0; i < n; ++i)
+   {
+      if (x[i] < 0 || y[i] < 0 || width[i] <= 0 || height[i] <= 0)
+         throw CMMError("Invalid frame demultiplexing region",
+               MMERR_InvalidContents);
+      regions[i].x = static_cast<unsigned>(x[i]);
+      regions[i].y = static_cast<unsigned>(y[i]);
+      regions[i].width = static_cast<unsigned>(width[i]);
+      regions[i].height = static_cast<unsigned>(height[i]);
+      regions[i].transform = FrameDemultiplexer::None;
+      if (!transforms.empty() && !FrameDemultiplexer::ParseTransform(
+               transforms[i], regions[i].transform))
+         throw CMMError("Invalid region transform " +
+               ToQuotedString(transforms[i]), MMERR_InvalidContents);
+   }
+
+   if (isSequenceRunning())
+      throw CMMError(getCoreErrorText(
+               MMERR_NotAllowedDuringSequenceAcquisition).c_str(),
+            MMERR_NotAllowedDuringSequenceAcquisition);
+   if (frameSync_->IsEnabled())
+      throw CMMError("Frame demultiplexing cannot be combined with "
+            "multi-camera synchronization", MMERR_InvalidContents);
+
+   frameDemux_->Enable(regions);
+   LOG_INFO(coreLogger_) << "Enabled demultiplexing of frames into " << n <<
+      " channels";
+}
+
+/**
+ * Disables frame demultiplexing.
+ */
+void CMMCore::disableFrameDemultiplexing() throw (CMMError)
+{
+   if (isSequenceRunning())
+      throw CMMError(getCoreErrorText(
+               MMERR_NotAllowedDuringSequenceAcquisition).c_str(),
+            MMERR_NotAllowedDuringSequenceAcquisition);
+
+   frameDemux_->Disable();
+   LOG_INFO(coreLogger_) << "Disabled frame demultiplexing";
+}
+
+/**
+ * Returns whether frame demultiplexing is enabled.
+ */
+bool CMMCore::isFrameDemultiplexingEnabled()
+{
+   return frameDemux_->IsEnabled();
+}
+
+/**
+ * Returns the number of channels frames are split into, or 0 if frame
+ * demultiplexing is disabled.
+ */
+long CMMCore::getFrameDemultiplexingChannelCount()
+{
+   if (!frameDemux_->IsEnabled())
+      return 0;
+   return static_cast<long>(frameDemux_->GetChannelCount());
+}
+
+/**
+ * Starts running a multi-dimensional acquisition plan.
+ *
+ * The plan is split into as few runs as possible, each acquired as one
+ * sequence of the current camera while the XY stage, focus stage, channel
+ * properties and exposure follow hardware sequences loaded beforehand. A
+ * run ends where the next frame would change an axis whose devices cannot
+ * be sequenced, where a sequence would exceed the length supported by a
+ * device (see get*SequenceMaxLength()), and at each time point when the
+ * time points are spaced by the core. Axes that do not change within a run
+ * are set by software before it starts; the sequences of all devices are
+ * loaded in parallel. See getPlannedAcquisitionRunLengths() for the result.
+ *
+ * The circular buffer is initialized when the plan is started, and receives
+ * the frames of all runs in acquisition order. Each image is tagged with
+ * Acquisition-Frame, Acquisition-TimeIndex, Acquisition-PositionIndex,
+ * Acquisition-SliceIndex, Acquisition-ChannelIndex and (if channels are
+ * set) Acquisition-Channel. If autoshutter is on, the shutter is kept open
+ * for the whole plan.
+ *
+ * This command does not block the calling thread while the plan runs.
+ *
+ * @param plan  the acquisition plan
+ */
+void CMMCore::startPlannedAcquisition(const AcquisitionPlan& plan) throw (CMMError)
+{
+   {
+      MMThreadGuard g(*pPostedErrorsLock_);
+      postedErrors_.clear();
+   }
+
+   acqEngine_->Start(plan);
+   LOG_INFO(coreLogger_) << "Started planned acquisition of " <<
+      plan.getFrameCount() << " frames";
+}
+
+/**
+ * Stops the planned acquisition, if one is running, and waits for it to
+ * finish.
+ */
+void CMMCore::stopPlannedAcquisition()
+{
+   acqEngine_->Stop();
+}
+
+/**
+ * Returns whether a planned acquisition is running.
+ */
+bool CMMCore::isPlannedAcquisitionRunning()
+{
+   return acqEngine_->IsRunning();
+}
+
+/**
+ * Returns the number of frames acquired since the last planned acquisition
+ * was started.
+ */
+long CMMCore::getPlannedAcquisitionFrameCount()
+{
+   return acqEngine_->GetAcquiredFrameCount();
+}
+
+/**
+ * Returns the error that ended the last planned acquisition, or an empty
+ * string if it completed or was stopped.
+ */
+std::string CMMCore::getPlannedAcquisitionError()
+{
+   return acqEngine_->GetLastError();
+}
+
+/**
+ * Returns the number of frames in each run the plan would be split into
+ * with the current devices, without running it.
+ *
+ * @param plan  the acquisition plan
+ */
+std::vector<long> CMMCore::getPlannedAcquisitionRunLengths(
+      const AcquisitionPlan& plan) throw (CMMError)
+{
+   std::vector<mm::AcquisitionRun> runs = acqEngine_->Compile(plan);
+   std::vector<long> lengths;
+   for (std::vector<mm::AcquisitionRun>::const_iterator it = runs.begin();
+         it != runs.end(); ++it)
+      lengths.push_back(static_cast<long>(it->eventCount));
+   return lengths;
+}
+
+/**
+ * Reserve memory for the circular buffer.
+ */
+void CMMCore::setCircularBufferMemoryFootprint(unsigned sizeMB ///< n megabytes
+                                               ) throw (CMMError)
+{
+   // Settings carried over to the new buffer
+   const CircularBuffer::OverflowPolicy overflowPolicy =
+      cbuf_->GetOverflowPolicy();
+   const double overflowBlockTimeoutMs = cbuf_->GetOverflowBlockTimeoutMs();
+   const bool compression = cbuf_->IsCompressionEnabled();
+   const std::string spillPath = cbuf_->GetSpillPath();
+   const unsigned spillSizeMB = cbuf_->GetSpillSizeMB();
+   const std::string shmName = cbuf_->GetSharedMemoryExportName();
+   const unsigned shmSizeMB = cbuf_->GetSharedMemoryExportSizeMB();
+
+   delete cbuf_; // discard old buffer
+   LOG_DEBUG(coreLogger_) << "Will set circular buffer size to " <<
+      sizeMB << " MB";
+	try
+	{
+		cbuf_ = new CircularBuffer(sizeMB, threadPool_);
+	}
+	catch(bad_alloc& ex)
+	{
+      // This is an out-of-memory error before even allocating the buffers.
+		ostringstream messs;
+		messs << getCoreErrorText(MMERR_OutOfMemory).c_str() << " " << ex.what() << endl;
+		throw CMMError(messs.str().c_str() , MMERR_OutOfMemory);
+	}
+	if (NULL == cbuf_) throw CMMError(getCoreErrorText(MMERR_OutOfMemory).c_str(), MMERR_OutOfMemory);
+
+   cbuf_->SetOverflowPolicy(overflowPolicy);
+   cbuf_->SetOverflowBlockTimeoutMs(overflowBlockTimeoutMs);
+   cbuf_->EnableCompression(compression);
+   // The old spill file is deleted by now
+   if (!spillPath.empty())
+      cbuf_->EnableSpill(spillPath, spillSizeMB);
+   if (!shmName.empty())
+      cbuf_->EnableSharedMemoryExport(shmName, shmSizeMB);
+   if (diskSink_->IsActive())
+      cbuf_->AttachDiskSink(diskSink_);
+
+	try
+	{
+
+		// attempt to initialize based on the current camera settings
+      boost::shared_ptr<CameraInstance> camera = currentCameraDevice_.lock();
+      if (camera)
+		{
+         mm::DeviceModuleLockGuard guard(camera);
+         if (!initializeCircularBufferFor(camera->GetNumberOfChannels(), camera->GetImageWidth(), camera->GetImageHeight(), camera->GetImageBytesPerPixel()))
+				throw CMMError(getCoreErrorText(MMERR_CircularBufferFailedToInitialize).c_str(), MMERR_CircularBufferFailedToInitialize);
+		}
+
+      LOG_DEBUG(coreLogger_) << "Did set circular buffer size to " <<
+         sizeMB << " MB";
+	}
+	catch(bad_alloc& ex)
+	{
+		ostringstream messs;
+		messs << getCoreErrorText(MMERR_OutOfMemory).c_str() << " " << ex.what() << endl;
+		throw CMMError(messs.str().c_str() , MMERR_OutOfMemory);
+	}
+	if (NULL == cbuf_)
+      throw CMMError(getCoreErrorText(MMERR_OutOfMemory).c_str(), MMERR_OutOfMemory);
+}
+
+/**
+ * Returns the size of the Circular Buffer in MB
+ */
+unsigned CMMCore::getCircularBufferMemoryFootprint()
+{
+   if (cbuf_)
+   {
+      return cbuf_->GetMemorySizeMB();
+   }
+   return 0;
+}
+
+/**
+ * Returns number ofimages available in the Circular Buffer
+ */
+long CMMCore::getRemainingImageCount()
+{
+   if (cbuf_)
+   {
+      return cbuf_->GetRemainingImageCount();
+   }
+   return 0;
+}
+
+/**
+ * Returns the total number of images that can be stored in the buffer
+ */
+long CMMCore::getBufferTotalCapacity()
+{
+   if (cbuf_)
+   {
+      return cbuf_->GetSize();
+   }
+   return 0;
+}
+
+
+/**
+ * Returns the number of images that can be added to the buffer
+ * without overflowing
+ */
+long CMMCore::getBufferFreeCapacity()
+{
+   if (cbuf_)
+   {
+      return cbuf_->GetFreeSize();
+   }
+   return 0;
+}
+
+/**
+ * Returns the width of the images in the circular buffer, in pixels.
+ *
+ * This is the camera's image width, except when frames are demultiplexed
+ * (see enableFrameDemultiplexing()), in which case it is the width of the
+ * channel images.
+ */
+unsigned CMMCore::getBufferImageWidth()
+{
+   if (cbuf_)
+   {
+      return cbuf_->Width();
+   }
+   return 0;
+}
+
+/**
+ * Returns the height of the images in the circular buffer, in pixels.
+ * See getBufferImageWidth().
+ */
+unsigned CMMCore::getBufferImageHeight()
+{
+   if (cbuf_)
+   {
+      return cbuf_->Height();
+   }
+   return 0;
+}
+
+/**
+ * Indicates whether the circular buffer is overflowed
+ */
+bool CMMCore::isBufferOverflowed() const
+{
+   return cbuf_->Overflow();
+}
+
+/**
+ * Sets what happens to an inserted image when the circular buffer is full.
+ *
+ * The policy is one of:
+ * - "Clear": the image is rejected and the buffer is flagged as overflowed
+ *   (see isBufferOverflowed()). Cameras started with stopOnOverflow stop;
+ *   others clear the buffer, discarding the images not yet retrieved, and
+ *   insert the image again. This is the default.
+ * - "DropNewest": the image is rejected and the buffer is flagged as
+ *   overflowed.
+ * - "DropOldest": the oldest image that has not been retrieved is discarded
+ *   to make room, so that the buffer always holds the most recent images.
+ * - "Block": the camera waits for images to be retrieved, for up to the
+ *   timeout set with setBufferOverflowBlockTimeoutMs(), after which the
+ *   image is rejected as with "DropNewest".
+ *
+ * Under the last three policies, cameras started with stopOnOverflow are
+ * told of a rejected image, and stop; other cameras are not, and go on
+ * acquiring. Images discarded by "DropOldest" do not stop any camera. If
+ * several cameras are acquiring, the stopOnOverflow of the sequence
+ * acquisition started last applies to all of them. Images lost to each
+ * policy are counted (see getBufferDroppedImageCount()).
+ *
+ * @param policy  "Clear", "DropNewest", "DropOldest" or "Block"
+ */
+void CMMCore::setBufferOverflowPolicy(const char* policy) throw (CMMError)
+{
+   CircularBuffer::OverflowPolicy overflowPolicy;
+   if (!policy ||
+         !CircularBuffer::ParseOverflowPolicy(policy, overflowPolicy))
+      throw CMMError("Invalid buffer overflow policy " +
+            ToQuotedString(policy ? policy : ""), MMERR_InvalidContents);
+
+   cbuf_->SetOverflowPolicy(overflowPolicy);
+   LOG_INFO(coreLogger_) << "Set circular buffer overflow policy to " <<
+      policy;
+}
+
+/**
+ * Returns the circular buffer overflow policy ("Clear", "DropNewest",
+ * "DropOldest" or "Block").
+ */
+std::string CMMCore::getBufferOverflowPolicy()
+{
+   return CircularBuffer::GetOverflowPolicyName(cbuf_->GetOverflowPolicy());
+}
+
+/**
+ * Sets how long an insert waits for room under the "Block" overflow policy.
+ *
+ * @param timeoutMs  timeout in milliseconds (1000 by default)
+ */
+void CMMCore::setBufferOverflowBlockTimeoutMs(double timeoutMs)
+   throw (CMMError)
+{
+   if (!(timeoutMs >= 0.0))
+      throw CMMError("Invalid buffer overflow timeout", MMERR_InvalidContents);
+   cbuf_->SetOverflowBlockTimeoutMs(timeoutMs);
+}
+
+/**
+ * Returns how long an insert waits for room under the "Block" overflow
+ * policy, in milliseconds.
+ */
+double CMMCore::getBufferOverflowBlockTimeoutMs()
+{
+   return cbuf_->GetOverflowBlockTimeoutMs();
+}
+
+/**
+ * Returns the number of images lost to the given overflow policy since the
+ * circular buffer was last initialized (which happens when a sequence
+ * acquisition starts).
+ *
+ * For "Clear" and "DropOldest" these are images discarded from the buffer;
+ * for "DropNewest" and "Block" they are images that were rejected.
+ *
+ * @param policy  "Clear", "DropNewest", "DropOldest" or "Block"
+ */
+long CMMCore::getBufferDroppedImageCount(const char* policy) throw (CMMError)
+{
+   CircularBuffer::OverflowPolicy overflowPolicy;
+   if (!policy ||
+         !CircularBuffer::ParseOverflowPolicy(policy, overflowPolicy))
+      throw CMMError("Invalid buffer overflow policy " +
+            ToQuotedString(policy ? policy : ""), MMERR_InvalidContents);
+   return static_cast<long>(cbuf_->GetDroppedImageCount(overflowPolicy));
+}
+
+/**
+ * Adds a spill-to-disk tier to the circular buffer.
+ *
+ * When the circular buffer's memory is full, further images are written to
+ * a memory-mapped file of the given size, created (and fully allocated) at
+ * path, instead of overflowing. They are moved back into memory in order as
+ * images are retrieved with popNextImage() and popNextImageMD(), so the
+ * spill file is transparent to the caller except that the pointer returned
+ * by a pop is valid only until the next pop. The overflow policy (see
+ * setBufferOverflowPolicy()) applies only once the spill file is full too.
+ *
+ * The file should be on fast local storage. It is deleted when the spill
+ * tier is disabled or the core is destroyed. The buffer capacity and
+ * remaining image counts include the spill file.
+ *
+ * @param path    path of the spill file to create
+ * @param sizeMB  size of the spill file in megabytes
+ */
+void CMMCore::enableBufferSpill(const char* path, unsigned sizeMB)
+   throw (CMMError)
+{
+   if (!path || !*path)
+      throw CMMError("Null or empty buffer spill file path",
+            MMERR_NullPointerException);
+   if (isSequenceRunning())
+      throw CMMError(getCoreErrorText(
+               MMERR_NotAllowedDuringSequenceAcquisition).c_str(),
+            MMERR_NotAllowedDuringSequenceAcquisition);
+
+   cbuf_->EnableSpill(path, sizeMB);
+   LOG_INFO(coreLogger_) << "Enabled circular buffer spill file " << path <<
+      " (" << sizeMB << " MB)";
+}
+
+/**
+ * Removes the spill-to-disk tier of the circular buffer. Images held in the
+ * spill file are discarded.
+ */
+void CMMCore::disableBufferSpill() throw (CMMError)
+{
+   if (isSequenceRunning())
+      throw CMMError(getCoreErrorText(
+               MMERR_NotAllowedDuringSequenceAcquisition).c_str(),
+            MMERR_NotAllowedDuringSequenceAcquisition);
+
+   cbuf_->DisableSpill();
+   LOG_INFO(coreLogger_) << "Disabled circular buffer spill file";
+}
+
+/**
+ * Returns whether the circular buffer has a spill-to-disk tier.
+ */
+bool CMMCore::isBufferSpillEnabled()
+{
+   return cbuf_->IsSpillEnabled();
+}
+
+/**
+ * Returns the number of images the spill file can hold at the current image
+ * size.
+ */
+long CMMCore::getBufferSpillCapacity()
+{
+   return static_cast<long>(cbuf_->GetSpillCapacity());
+}
+
+/**
+ * Returns the number of images currently held in the spill file.
+ */
+long CMMCore::getBufferSpillImageCount()
+{
+   return static_cast<long>(cbuf_->GetSpillImageCount());
+}
+
+/**
+ * Returns the largest number of images held in the spill file at once since
+ * the circular buffer was last cleared or initialized.
+ */
+long CMMCore::getBufferSpillPeakImageCount()
+{
+   return static_cast<long>(cbuf_->GetSpillPeakImageCount());
+}
+
+/**
+ * Returns the number of images that went through the spill file since the
+ * circular buffer was last cleared or initialized.
+ */
+long CMMCore::getBufferSpilledImageCount()
+{
+   return static_cast<long>(cbuf_->GetSpilledImageCount());
+}
+
+/**
+ * Enables lossless compression of images in the circular buffer.
+ *
+ * Only a few images are then kept uncompressed; the rest of the buffer's
+ * memory holds images compressed (by byte shuffling and LZ4) on the core's
+ * worker threads as they are inserted. They are decompressed in order as
+ * images are retrieved with popNextImage() and popNextImageMD(), which is
+ * transparent to the caller except that the pointer returned by a pop is
+ * valid only until the next pop. Images that do not fit compressed go to
+ * the spill file, if enabled (see enableBufferSpill()).
+ *
+ * The number of images that fit depends on how well they compress; the
+ * buffer capacity is estimated from the compression ratio of the images
+ * inserted so far. Images whose pixels use fewer bits than their type holds
+ * compress best.
+ *
+ * The circular buffer is reinitialized, discarding its images.
+ */
+void CMMCore::enableBufferCompression() throw (CMMError)
+{
+   if (isSequenceRunning())
+      throw CMMError(getCoreErrorText(
+               MMERR_NotAllowedDuringSequenceAcquisition).c_str(),
+            MMERR_NotAllowedDuringSequenceAcquisition);
+
+   cbuf_->EnableCompression(true);
+   if (currentCameraDevice_.lock())
+      initializeCircularBuffer();
+   LOG_INFO(coreLogger_) << "Enabled circular buffer compression";
+}
+
+/**
+ * Disables compression of images in the circular buffer.
+ *
+ * The circular buffer is reinitialized, discarding its images.
+ */
+void CMMCore::disableBufferCompression() throw (CMMError)
+{
+   if (isSequenceRunning())
+      throw CMMError(getCoreErrorText(
+               MMERR_NotAllowedDuringSequenceAcquisition).c_str(),
+            MMERR_NotAllowedDuringSequenceAcquisition);
+
+   cbuf_->EnableCompression(false);
+   if (currentCameraDevice_.lock())
+      initializeCircularBuffer();
+   LOG_INFO(coreLogger_) << "Disabled circular buffer compression";
+}
+
+/**
+ * Returns whether images in the circular buffer are compressed.
+ */
+bool CMMCore::isBufferCompressionEnabled()
+{
+   return cbuf_->IsCompressionEnabled();
+}
+
+/**
+ * Returns the estimated number of compressed images the circular buffer can
+ * hold, based on the compression ratio so far.
+ */
+long CMMCore::getBufferCompressedCapacity()
+{
+   return static_cast<long>(cbuf_->GetCompressedCapacity());
+}
+
+/**
+ * Returns the number of images currently held compressed in the circular
+ * buffer.
+ */
+long CMMCore::getBufferCompressedImageCount()
+{
+   return static_cast<long>(cbuf_->GetCompressedImageCount());
+}
+
+/**
+ * Returns the ratio of the uncompressed to the compressed size of the images
+ * compressed since the circular buffer was last cleared or initialized, or 0
+ * if none were.
+ */
+double CMMCore::getBufferCompressionRatio()
+{
+   return cbuf_->GetCompressionRatio();
+}
+
+/**
+ * Publishes the images inserted into the circular buffer in a POSIX
+ * shared-memory segment, for other processes on this machine to read.
+ *
+ * Each image is copied, as it is inserted, to the next slot of a ring in
+ * the segment, together with its metadata (single-valued tags only). Other
+ * processes map the segment read-only and read the images in place, without
+ * copying and without locking: the writer never waits for them, and they
+ * detect images overwritten while being read from the slots' sequence
+ * numbers. The layout is documented in MMCoreShm/MMCoreShm.h, which also
+ * declares a small C library (libMMCoreShm) for reading it. Images in the
+ * circular buffer are not affected.
+ *
+ * The segment is created with the given name (a leading '/' is added if
+ * missing), replacing any segment of the same name, and is readable only by
+ * the same user. It is removed when the export is disabled or the core is
+ * destroyed. Not supported on Windows.
+ *
+ * @param name    name of the shared-memory segment
+ * @param sizeMB  size of the segment in megabytes
+ */
+void CMMCore::enableBufferSharedMemoryExport(const char* name,
+      unsigned sizeMB) throw (CMMError)
 {
-   cbuf_->Clear();
+   if (!name || !*name)
+      throw CMMError("Null or empty shared-memory name",
+            MMERR_NullPointerException);
+   if (isSequenceRunning())
+      throw CMMError(getCoreErrorText(
+               MMERR_NotAllowedDuringSequenceAcquisition).c_str(),
+            MMERR_NotAllowedDuringSequenceAcquisition);
+
+   cbuf_->EnableSharedMemoryExport(name, sizeMB);
+   LOG_INFO(coreLogger_) << "Enabled circular buffer shared-memory export " <<
+      cbuf_->GetSharedMemoryExportName() << " (" << sizeMB << " MB)";
 }
 
 /**
- * Reserve memory for the circular buffer.
+ * Stops publishing images in shared memory and removes the segment.
+ * Processes that still have it mapped can read the images already written.
  */
-void CMMCore::setCircularBufferMemoryFootprint(unsigned sizeMB ///< n megabytes
-                                               ) throw (CMMError)
+void CMMCore::disableBufferSharedMemoryExport() throw (CMMError)
 {
-   delete cbuf_; // discard old buffer
-   LOG_DEBUG(coreLogger_) << "Will set circular buffer size to " <<
-      sizeMB << " MB";
-	try
-	{
-		cbuf_ = new CircularBuffer(sizeMB);
-	}
-	catch(bad_alloc& ex)
-	{
-      // This is an out-of-memory error before even allocating the buffers.
-		ostringstream messs;
-		messs << getCoreErrorText(MMERR_OutOfMemory).c_str() << " " << ex.what() << endl;
-		throw CMMError(messs.str().c_str() , MMERR_OutOfMemory);
-	}
-	if (NULL == cbuf_) throw CMMError(getCoreErrorText(MMERR_OutOfMemory).c_str(), MMERR_OutOfMemory);
-
-
-	try
-	{
-
-		// attempt to initialize based on the current camera settings
-      boost::shared_ptr<CameraInstance> camera = currentCameraDevice_.lock();
-      if (camera)
-		{
-         mm::DeviceModuleLockGuard guard(camera);
-         if (!cbuf_->Initialize(camera->GetNumberOfChannels(), camera->GetImageWidth(), camera->GetImageHeight(), camera->GetImageBytesPerPixel()))
-				throw CMMError(getCoreErrorText(MMERR_CircularBufferFailedToInitialize).c_str(), MMERR_CircularBufferFailedToInitialize);
-		}
+   if (isSequenceRunning())
+      throw CMMError(getCoreErrorText(
+               MMERR_NotAllowedDuringSequenceAcquisition).c_str(),
+            MMERR_NotAllowedDuringSequenceAcquisition);
 
-      LOG_DEBUG(coreLogger_) << "Did set circular buffer size to " <<
-         sizeMB << " MB";
-	}
-	catch(bad_alloc& ex)
-	{
-		ostringstream messs;
-		messs << getCoreErrorText(MMERR_OutOfMemory).c_str() << " " << ex.what() << endl;
-		throw CMMError(messs.str().c_str() , MMERR_OutOfMemory);
-	}
-	if (NULL == cbuf_)
-      throw CMMError(getCoreErrorText(MMERR_OutOfMemory).c_str(), MMERR_OutOfMemory);
+   cbuf_->DisableSharedMemoryExport();
+   LOG_INFO(coreLogger_) << "Disabled circular buffer shared-memory export";
 }
 
 /**
- * Returns the size of the Circular Buffer in MB
+ * Returns whether images are published in shared memory.
  */
-unsigned CMMCore::getCircularBufferMemoryFootprint()
+bool CMMCore::isBufferSharedMemoryExportEnabled()
 {
-   if (cbuf_)
-   {
-      return cbuf_->GetMemorySizeMB();
-   }
-   return 0;
+   return cbuf_->IsSharedMemoryExportEnabled();
 }
 
 /**
- * Returns number ofimages available in the Circular Buffer
+ * Returns the name of the shared-memory segment to which images are
+ * exported, or an empty string if the export is disabled.
  */
-long CMMCore::getRemainingImageCount()
+std::string CMMCore::getBufferSharedMemoryExportName()
 {
-   if (cbuf_)
-   {
-      return cbuf_->GetRemainingImageCount();
-   }
-   return 0;
+   return cbuf_->GetSharedMemoryExportName();
 }
 
 /**
- * Returns the total number of images that can be stored in the buffer
+ * Returns the number of images written to shared memory since the export
+ * was enabled.
  */
-long CMMCore::getBufferTotalCapacity()
+long CMMCore::getBufferSharedMemoryExportedImageCount()
 {
-   if (cbuf_)
-   {
-      return cbuf_->GetSize();
-   }
-   return 0;
+   return static_cast<long>(cbuf_->GetSharedMemoryExportedImageCount());
 }
 
-
 /**
- * Returns the number of images that can be added to the buffer
- * without overflowing
+ * Returns the statistics of the frames of a camera that went through the
+ * circular buffer since it was last initialized: frame counts,
+ * queue depth, insert and retrieval rates, overflow losses and the time
+ * frames spent in the buffer.
+ *
+ * The statistics are kept as frames are inserted and retrieved, and reading
+ * them does not wait for the buffer, so they can be polled during a sequence
+ * acquisition without slowing it down. The statistics of the current camera
+ * are also available as read-only Core properties.
+ *
+ * @param cameraLabel   the label of the camera, as in the "Camera" tag of
+ *                      the image metadata. A camera that has not inserted
+ *                      any frame has all-zero statistics.
  */
-long CMMCore::getBufferFreeCapacity()
+SequenceStatistics CMMCore::getSequenceStatistics(const char* cameraLabel)
 {
-   if (cbuf_)
-   {
-      return cbuf_->GetFreeSize();
-   }
-   return 0;
+   SequenceStatistics statistics;
+   cbuf_->GetSequenceStatistics(cameraLabel ? cameraLabel : "", statistics);
+   return statistics;
 }
 
 /**
- * Indicates whether the circular buffer is overflowed
+ * Returns the labels of the cameras that inserted frames into the circular
+ * buffer, for use with getSequenceStatistics().
  */
-bool CMMCore::isBufferOverflowed() const
+std::vector<std::string> CMMCore::getSequenceStatisticsCameras()
 {
-   return cbuf_->Overflow();
+   return cbuf_->GetSequenceStatisticsCameras();
 }
 
 /**
@@ -3458,6 +4618,7 @@ void CMMCore::setChannelGroup(const char* chGroup) throw (CMMError)
       MMThreadGuard scg(stateCacheLock_);
       stateCache_.addSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreChannelGroup, channelGroup_.c_str()));
    }
+   boost::shared_lock<boost::shared_mutex> cbLock(externalCallbackMutex_);
    if (externalCallback_ != 0) 
    {
       externalCallback_->onChannelGroupChanged(channelGroup_.c_str());
@@ -6895,8 +8056,11 @@ void CMMCore::loadSystemConfigurationImpl(const char* fileName) throw (CMMError)
          }
          catch (CMMError& err)
          {
-            if (externalCallback_)
-               externalCallback_->onSystemConfigurationLoaded();
+            {
+               boost::shared_lock<boost::shared_mutex> cbLock(externalCallbackMutex_);
+               if (externalCallback_)
+                  externalCallback_->onSystemConfigurationLoaded();
+            }
             std::ostringstream errorText;
             errorText << "Line " << lineCount << ": " << line << endl;
             errorText << err.getFullMsg() << endl << endl;
@@ -6921,6 +8085,7 @@ void CMMCore::loadSystemConfigurationImpl(const char* fileName) throw (CMMError)
    waitForSystem();
    updateSystemStateCache();
 
+   boost::shared_lock<boost::shared_mutex> cbLock(externalCallbackMutex_);
    if (externalCallback_)
    {
       externalCallback_->onSystemConfigurationLoaded();
@@ -6934,7 +8099,395 @@ void CMMCore::loadSystemConfigurationImpl(const char* fileName) throw (CMMError)
  */
 void CMMCore::registerCallback(MMEventCallback* cb)
 {
-   externalCallback_ = cb;
+   // The dispatcher thread and then the remote-core server receive the
+   // events first
+   boost::unique_lock<boost::shared_mutex> cbLock(externalCallbackMutex_);
+   if (remoteServer_)
+      remoteServer_->SetDownstreamCallback(cb);
+   else if (callbackDispatcher_->IsRunning())
+      callbackDispatcher_->SetDownstreamCallback(cb);
+   else
+      externalCallback_ = cb;
+}
+
+/**
+ * Enables or disables the delivery of events to the registered callback on
+ * a dispatcher thread.
+ *
+ * By default, events are delivered on the thread where they occur, often a
+ * device's thread, which waits for the callback to return. While the
+ * dispatcher thread is enabled, events are queued and delivered in order by
+ * the dispatcher thread, so that devices never wait for the callback.
+ * Queued events are coalesced: an event that has not been delivered yet is
+ * replaced by a later event of the same kind for the same device, property
+ * or group (so that only the latest position of a moving stage is
+ * delivered, for example). If the queue is full, new events are dropped (see
+ * getDroppedCallbackCount()).
+ *
+ * Disabling delivers the queued events first. The remote-core server, if
+ * running, also receives events from the dispatcher thread.
+ *
+ * @param enable   whether to deliver events on the dispatcher thread
+ */
+void CMMCore::enableCallbackDispatchThread(bool enable)
+{
+   if (enable == callbackDispatcher_->IsRunning())
+      return;
+   if (enable)
+   {
+      boost::unique_lock<boost::shared_mutex> cbLock(externalCallbackMutex_);
+      callbackDispatcher_->SetDownstreamCallback(externalCallback_);
+      callbackDispatcher_->Start();
+      externalCallback_ = callbackDispatcher_.get();
+   }
+   else
+   {
+      {
+         boost::unique_lock<boost::shared_mutex> cbLock(externalCallbackMutex_);
+         externalCallback_ = callbackDispatcher_->GetDownstreamCallback();
+      }
+      callbackDispatcher_->Stop();
+   }
+   LOG_INFO(coreLogger_) << "Callback dispatch thread " <<
+      (enable ? "enabled" : "disabled");
+}
+
+/**
+ * Returns whether events are delivered on the dispatcher thread.
+ */
+bool CMMCore::isCallbackDispatchThreadEnabled()
+{
+   return callbackDispatcher_->IsRunning();
+}
+
+/**
+ * Limits the rate at which an event is delivered by the dispatcher thread.
+ *
+ * The limit applies separately to each device, property or group: for
+ * example, a limit of 20 for onStagePositionChanged delivers the position
+ * of each stage at most 20 times per second. Events held back by the limit
+ * are coalesced, so the latest values are always delivered. Has no effect
+ * unless the dispatcher thread is enabled.
+ *
+ * @param callbackName   the name of the MMEventCallback method, such as
+ *                       "onXYStagePositionChanged"
+ * @param maxPerSecond   the maximum rate, or 0 for no limit (the default)
+ */
+void CMMCore::setCallbackMaxRate(const char* callbackName,
+      double maxPerSecond) throw (CMMError)
+{
+   if (!callbackName)
+      throw CMMError("Null callback name", MMERR_NullPointerException);
+   CallbackDispatcher::EventType type;
+   if (!CallbackDispatcher::GetEventTypeByName(callbackName, type))
+      throw CMMError("Unknown callback " + ToQuotedString(callbackName));
+   if (maxPerSecond < 0.0)
+      throw CMMError("Negative callback rate", MMERR_InvalidContents);
+   callbackDispatcher_->SetMaxRate(type, maxPerSecond);
+}
+
+/**
+ * Returns the maximum rate of an event set with setCallbackMaxRate(), or 0
+ * if not limited.
+ */
+double CMMCore::getCallbackMaxRate(const char* callbackName) throw (CMMError)
+{
+   if (!callbackName)
+      throw CMMError("Null callback name", MMERR_NullPointerException);
+   CallbackDispatcher::EventType type;
+   if (!CallbackDispatcher::GetEventTypeByName(callbackName, type))
+      throw CMMError("Unknown callback " + ToQuotedString(callbackName));
+   return callbackDispatcher_->GetMaxRate(type);
+}
+
+/**
+ * Returns the number of events replaced by a later event before being
+ * delivered, since the dispatcher thread was enabled.
+ */
+long CMMCore::getCoalescedCallbackCount()
+{
+   return static_cast<long>(callbackDispatcher_->GetCoalescedEventCount());
+}
+
+/**
+ * Returns the number of events dropped because the dispatcher's queue was
+ * full, since the dispatcher thread was enabled.
+ */
+long CMMCore::getDroppedCallbackCount()
+{
+   return static_cast<long>(callbackDispatcher_->GetDroppedEventCount());
+}
+
+namespace {
+
+DeviceCallTracer::MethodStatistics
+GetDeviceCallStatistics(const DeviceCallTracer& tracer, const char* label,
+      const char* method) throw (CMMError)
+{
+   if (!label || !method)
+      throw CMMError("Null device label or method name",
+            MMERR_NullPointerException);
+   DeviceCallTracer::Method m;
+   if (!DeviceCallTracer::GetMethodByName(method, m))
+      throw CMMError("Device method " + ToQuotedString(method) +
+            " is not traced");
+
+   DeviceCallTracer::MethodStatistics statistics;
+   if (!tracer.GetStatistics(label, m, statistics))
+   {
+      statistics.count = 0;
+      statistics.meanMs = statistics.maxMs = statistics.meanLockWaitMs = 0.0;
+      statistics.histogram.assign(DeviceCallTracer::NumHistogramBuckets, 0);
+   }
+   return statistics;
+}
+
+} // anonymous namespace
+
+/**
+ * Enables or disables the tracing of device calls.
+ *
+ * While enabled, the core times its calls to the most commonly used device
+ * methods (property access, Busy(), snapping and sequence acquisition,
+ * exposure, stage and state positions, and shutters), including the time
+ * spent waiting for the lock of the device's adapter module. The calls are
+ * counted in latency histograms per device and method, and the most recent
+ * calls of each thread are kept for saveDeviceCallTrace().
+ *
+ * Tracing is disabled by default. The overhead per call is two clock reads
+ * and a few atomic increments while enabled, and a flag test otherwise.
+ *
+ * @param enable  whether to trace device calls
+ */
+void CMMCore::enableDeviceCallTracing(bool enable)
+{
+   callTracer_->Enable(enable);
+   LOG_INFO(coreLogger_) << "Device call tracing " <<
+      (enable ? "enabled" : "disabled");
+}
+
+/**
+ * Returns whether device calls are being traced.
+ */
+bool CMMCore::isDeviceCallTracingEnabled()
+{
+   return callTracer_->IsEnabled();
+}
+
+/**
+ * Discards the device calls recorded so far, both the statistics and the
+ * trace.
+ */
+void CMMCore::clearDeviceCallTrace()
+{
+   callTracer_->Clear();
+}
+
+/**
+ * Returns the names of the methods of a device that have been traced.
+ *
+ * Statistics are kept by device label, including for devices that have
+ * since been unloaded.
+ *
+ * @param label  the device label
+ */
+std::vector<std::string>
+CMMCore::getTracedDeviceCallMethods(const char* label) throw (CMMError)
+{
+   CheckDeviceLabel(label);
+   std::vector<DeviceCallTracer::Method> methods =
+      callTracer_->GetCalledMethods(label);
+   std::vector<std::string> names;
+   for (std::vector<DeviceCallTracer::Method>::const_iterator
+         it = methods.begin(), end = methods.end(); it != end; ++it)
+      names.push_back(DeviceCallTracer::GetMethodName(*it));
+   return names;
+}
+
+/**
+ * Returns how many times a device method has been called while tracing was
+ * enabled.
+ *
+ * @param label   the device label
+ * @param method  the method name, as returned by getTracedDeviceCallMethods()
+ */
+long CMMCore::getDeviceCallCount(const char* label, const char* method)
+   throw (CMMError)
+{
+   return static_cast<long>(
+         GetDeviceCallStatistics(*callTracer_, label, method).count);
+}
+
+/**
+ * Returns the histogram of the durations of the calls to a device method.
+ *
+ * Element 0 is the number of calls that took less than 1 microsecond, and
+ * element i > 0 the number of calls that took at least 2^(i-1) and less
+ * than 2^i microseconds. The last element also includes longer calls.
+ *
+ * @param label   the device label
+ * @param method  the method name, as returned by getTracedDeviceCallMethods()
+ */
+std::vector<long>
+CMMCore::getDeviceCallLatencyHistogram(const char* label, const char* method)
+   throw (CMMError)
+{
+   const std::vector<boost::uint64_t> histogram =
+      GetDeviceCallStatistics(*callTracer_, label, method).histogram;
+   return std::vector<long>(histogram.begin(), histogram.end());
+}
+
+/**
+ * Returns the mean duration of the calls to a device method, in
+ * milliseconds, or 0 if it has not been called.
+ *
+ * @param label   the device label
+ * @param method  the method name, as returned by getTracedDeviceCallMethods()
+ */
+double CMMCore::getDeviceCallMeanLatencyMs(const char* label,
+      const char* method) throw (CMMError)
+{
+   return GetDeviceCallStatistics(*callTracer_, label, method).meanMs;
+}
+
+/**
+ * Returns the longest duration of a call to a device method, in
+ * milliseconds.
+ *
+ * @param label   the device label
+ * @param method  the method name, as returned by getTracedDeviceCallMethods()
+ */
+double CMMCore::getDeviceCallMaxLatencyMs(const char* label,
+      const char* method) throw (CMMError)
+{
+   return GetDeviceCallStatistics(*callTracer_, label, method).maxMs;
+}
+
+/**
+ * Returns the mean time, in milliseconds, that calls to a device method
+ * waited for the lock of the device's adapter module before the call. This
+ * time is not included in the call durations.
+ *
+ * @param label   the device label
+ * @param method  the method name, as returned by getTracedDeviceCallMethods()
+ */
+double CMMCore::getDeviceCallMeanLockWaitMs(const char* label,
+      const char* method) throw (CMMError)
+{
+   return GetDeviceCallStatistics(*callTracer_, label, method).meanLockWaitMs;
+}
+
+/**
+ * Saves the recently traced device calls in the Chrome trace event format
+ * (JSON), which can be opened in chrome://tracing or the Perfetto UI.
+ *
+ * Each thread that called devices is shown as a track, with a slice for each
+ * call (named after the method, with the device label as category) and for
+ * each wait for a module lock. About the last 16000 calls of each thread
+ * are kept.
+ *
+ * @param fileName  the file to write
+ */
+void CMMCore::saveDeviceCallTrace(const char* fileName) throw (CMMError)
+{
+   if (!fileName)
+      throw CMMError("Null filename");
+
+   ofstream os;
+   os.open(fileName, ios_base::out | ios_base::trunc);
+   if (!os.is_open())
+   {
+      logError(fileName, getCoreErrorText(MMERR_FileOpenFailed).c_str());
+      throw CMMError(ToQuotedString(fileName) + ": " + getCoreErrorText(MMERR_FileOpenFailed),
+            MMERR_FileOpenFailed);
+   }
+   callTracer_->WriteChromeTrace(os);
+}
+
+/**
+ * Starts serving the Core API to other processes on this machine.
+ *
+ * The server listens on a Unix domain socket created at socketPath
+ * (replacing any file there), accessible only to the same user. Each client
+ * is served on a thread of its own, using the binary protocol described in
+ * MMCoreRemote/RemoteCoreProtocol.h; the RemoteCoreClient class
+ * (libMMCoreRemote) implements the client side. Clients can send several
+ * requests before reading the replies, and can subscribe to the events
+ * that the core sends to its callback (see registerCallback()). The
+ * callback registered by the application keeps receiving them.
+ *
+ * Clients pop images from the circular buffer like any other consumer. When
+ * the shared-memory export of the circular buffer is enabled (see
+ * enableBufferSharedMemoryExport()), popped images are sent to clients by
+ * handle, and clients read the pixels from the shared memory.
+ *
+ * Only part of the Core API is served; see RemoteCoreProtocol.h. Not
+ * supported on Windows.
+ *
+ * @param socketPath  path of the socket to create
+ */
+void CMMCore::startRemoteCoreServer(const char* socketPath) throw (CMMError)
+{
+   if (!socketPath || !*socketPath)
+      throw CMMError("Null or empty remote-core socket path",
+            MMERR_NullPointerException);
+   stopRemoteCoreServer();
+
+   boost::shared_ptr<RemoteCoreServer> server(
+         new RemoteCoreServer(*this, coreLogger_));
+   server->Start(socketPath);
+   // The server receives the events from the dispatcher thread, if enabled
+   if (callbackDispatcher_->IsRunning())
+   {
+      server->SetDownstreamCallback(callbackDispatcher_->GetDownstreamCallback());
+      callbackDispatcher_->SetDownstreamCallback(server.get());
+   }
+   else
+   {
+      boost::unique_lock<boost::shared_mutex> cbLock(externalCallbackMutex_);
+      server->SetDownstreamCallback(externalCallback_);
+      externalCallback_ = server.get();
+   }
+   remoteServer_ = server;
+}
+
+/**
+ * Stops the remote-core server, disconnecting its clients. Requests being
+ * executed are completed first. Waits for events being delivered to the
+ * registered callback, so must not be called from that callback.
+ */
+void CMMCore::stopRemoteCoreServer()
+{
+   if (!remoteServer_)
+      return;
+   // Once the server is out of the chain (the dispatcher swaps its downstream
+   // callback under its own lock), no thread can be delivering to it
+   if (callbackDispatcher_->IsRunning())
+      callbackDispatcher_->SetDownstreamCallback(
+            remoteServer_->GetDownstreamCallback());
+   else
+   {
+      boost::unique_lock<boost::shared_mutex> cbLock(externalCallbackMutex_);
+      externalCallback_ = remoteServer_->GetDownstreamCallback();
+   }
+   remoteServer_->Stop();
+   remoteServer_.reset();
+}
+
+/**
+ * Returns whether the remote-core server is running.
+ */
+bool CMMCore::isRemoteCoreServerRunning()
+{
+   return remoteServer_ && remoteServer_->IsRunning();
+}
+
+/**
+ * Returns the number of clients connected to the remote-core server.
+ */
+long CMMCore::getRemoteCoreServerConnectionCount()
+{
+   return remoteServer_ ? remoteServer_->GetConnectionCount() : 0;
 }
 
 
@@ -7228,6 +8781,7 @@ void CMMCore::InitializeErrorMessages()
    errorText_[MMERR_NullPointerException] = "Null Pointer Exception.";
    errorText_[MMERR_CreatePeripheralFailed] = "Hub failed to create specified peripheral device.";
    errorText_[MMERR_BadAffineTransform] = "Bad affine transform.  Affine transforms need to have 6 numbers; 2 rows of 3 column.";
+   errorText_[MMERR_DiskStreamingFailed] = "Streaming images to disk failed.";
 }
 
 void CMMCore::CreateCoreProperties()
@@ -7286,6 +8840,21 @@ void CMMCore::CreateCoreProperties()
    CoreProperty propBusyTimeoutMs;
    properties_->Add(MM::g_Keyword_CoreTimeoutMs, propBusyTimeoutMs);
 
+   // Sequence statistics of the current camera, computed when read
+   const char* const sequenceStatistics[] = {
+      MM::g_Keyword_CoreSequenceInsertsPerSecond,
+      MM::g_Keyword_CoreSequencePopsPerSecond,
+      MM::g_Keyword_CoreSequenceQueueDepth,
+      MM::g_Keyword_CoreSequenceQueueDepthHighWaterMark,
+      MM::g_Keyword_CoreSequenceOverflowCount,
+      MM::g_Keyword_CoreSequenceMeanResidenceMs,
+   };
+   for (unsigned i = 0; i < sizeof(sequenceStatistics) / sizeof(sequenceStatistics[0]); ++i)
+   {
+      CoreProperty propStatistic("0", true);
+      properties_->Add(sequenceStatistics[i], propStatistic);
+   }
+
    properties_->Refresh();
 }
 
@@ -56,13 +56,17 @@
 #include "../MMDevice/DeviceThreads.h"
 #include "../MMDevice/MMDevice.h"
 #include "../MMDevice/MMDeviceConstants.h"
+#include "AcquisitionPlan.h"
 #include "Configuration.h"
 #include "CoreUtils.h"
 #include "Error.h"
 #include "ErrorCodes.h"
 #include "Logging/Logger.h"
+#include "SequenceStatistics.h"
 
+#include <boost/atomic.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/shared_mutex.hpp>
 #include <boost/weak_ptr.hpp>
 
 #include <cstring>
@@ -86,14 +90,24 @@
 
 
 class CPluginManager;
+class CallbackDispatcher;
 class CircularBuffer;
 class ConfigGroupCollection;
 class CoreCallback;
 class CorePropertyCollection;
+class DiskSink;
+class FrameCombiner;
+class FrameDemultiplexer;
+class FrameSynchronizer;
 class MMEventCallback;
 class Metadata;
+class MockDeviceAdapter;
 class PixelSizeConfigGroup;
 class PropertyBlock;
+class RemoteCoreServer;
+class DeviceCallTracer;
+class SnapBuffer;
+class ThreadPool;
 
 class AutoFocusInstance;
 class CameraInstance;
@@ -108,6 +122,7 @@ class XYStageInstance;
 class CMMCore;
 
 namespace mm {
+   class AcquisitionEngine;
    class DeviceManager;
    class LogManager;
 } // namespace mm
@@ -128,6 +143,7 @@ class CMMCore
 {
    friend class CoreCallback;
    friend class CorePropertyCollection;
+   friend class DeviceInstance;
 
 public:
    CMMCore();
@@ -152,6 +168,8 @@ public:
    void reset() throw (CMMError);
 
    void unloadLibrary(const char* moduleName) throw (CMMError);
+   void loadMockDeviceAdapter(const char* name,
+         MockDeviceAdapter* implementation) throw (CMMError);
 
    void updateCoreProperties() throw (CMMError);
 
@@ -168,6 +186,12 @@ public:
    void saveSystemConfiguration(const char* fileName) throw (CMMError);
    void loadSystemConfiguration(const char* fileName) throw (CMMError);
    void registerCallback(MMEventCallback* cb);
+   void enableCallbackDispatchThread(bool enable);
+   bool isCallbackDispatchThreadEnabled();
+   void setCallbackMaxRate(const char* callbackName, double maxPerSecond) throw (CMMError);
+   double getCallbackMaxRate(const char* callbackName) throw (CMMError);
+   long getCoalescedCallbackCount();
+   long getDroppedCallbackCount();
    ///@}
 
    /** \name Logging and log management. */
@@ -377,6 +401,11 @@ public:
    void* getImage() throw (CMMError);
    void* getImage(unsigned numChannel) throw (CMMError);
 
+   void enableSnapPipeline(bool enable);
+   bool isSnapPipelineEnabled() const;
+   void setSnapBufferSlotCount(unsigned slotCount) throw (CMMError);
+   unsigned getSnapBufferSlotCount() const;
+
    unsigned getImageWidth();
    unsigned getImageHeight();
    unsigned getBytesPerPixel();
@@ -422,12 +451,74 @@ public:
    long getRemainingImageCount();
    long getBufferTotalCapacity();
    long getBufferFreeCapacity();
+   unsigned getBufferImageWidth();
+   unsigned getBufferImageHeight();
    bool isBufferOverflowed() const;
+   void setBufferOverflowPolicy(const char* policy) throw (CMMError);
+   std::string getBufferOverflowPolicy();
+   void setBufferOverflowBlockTimeoutMs(double timeoutMs) throw (CMMError);
+   double getBufferOverflowBlockTimeoutMs();
+   long getBufferDroppedImageCount(const char* policy) throw (CMMError);
+   void enableBufferSpill(const char* path, unsigned sizeMB) throw (CMMError);
+   void disableBufferSpill() throw (CMMError);
+   bool isBufferSpillEnabled();
+   long getBufferSpillCapacity();
+   long getBufferSpillImageCount();
+   long getBufferSpillPeakImageCount();
+   long getBufferSpilledImageCount();
+   void enableBufferCompression() throw (CMMError);
+   void disableBufferCompression() throw (CMMError);
+   bool isBufferCompressionEnabled();
+   long getBufferCompressedCapacity();
+   long getBufferCompressedImageCount();
+   double getBufferCompressionRatio();
+   void enableBufferSharedMemoryExport(const char* name, unsigned sizeMB) throw (CMMError);
+   void disableBufferSharedMemoryExport() throw (CMMError);
+   bool isBufferSharedMemoryExportEnabled();
+   std::string getBufferSharedMemoryExportName();
+   long getBufferSharedMemoryExportedImageCount();
+   SequenceStatistics getSequenceStatistics(const char* cameraLabel);
+   std::vector<std::string> getSequenceStatisticsCameras();
    void setCircularBufferMemoryFootprint(unsigned sizeMB) throw (CMMError);
    unsigned getCircularBufferMemoryFootprint();
    void initializeCircularBuffer() throw (CMMError);
    void clearCircularBuffer() throw (CMMError);
 
+   void startDiskStreaming(const char* pathPrefix) throw (CMMError);
+   void stopDiskStreaming() throw (CMMError);
+   bool isDiskStreaming();
+   long getDiskStreamingFrameCount();
+   long getDiskStreamingDroppedFrameCount();
+
+   void enableMultiCameraSync(std::vector<std::string> cameraLabels,
+         bool matchTimestamps, double maxSkewMs,
+         double timeoutMs) throw (CMMError);
+   void disableMultiCameraSync();
+   bool isMultiCameraSyncEnabled();
+   long getMultiCameraSyncMatchedFrameCount();
+   long getMultiCameraSyncDroppedFrameCount();
+
+   void enableFrameCombining(long frameCount, const char* mode) throw (CMMError);
+   void disableFrameCombining() throw (CMMError);
+   bool isFrameCombiningEnabled();
+   long getFrameCombiningFrameCount();
+   std::string getFrameCombiningMode();
+
+   void enableFrameDemultiplexing(std::vector<long> x, std::vector<long> y,
+         std::vector<long> width, std::vector<long> height,
+         std::vector<std::string> transforms) throw (CMMError);
+   void disableFrameDemultiplexing() throw (CMMError);
+   bool isFrameDemultiplexingEnabled();
+   long getFrameDemultiplexingChannelCount();
+
+   void startPlannedAcquisition(const AcquisitionPlan& plan) throw (CMMError);
+   void stopPlannedAcquisition();
+   bool isPlannedAcquisitionRunning();
+   long getPlannedAcquisitionFrameCount();
+   std::string getPlannedAcquisitionError();
+   std::vector<long> getPlannedAcquisitionRunLengths(
+         const AcquisitionPlan& plan) throw (CMMError);
+
    bool isExposureSequenceable(const char* cameraLabel) throw (CMMError);
    void startExposureSequence(const char* cameraLabel) throw (CMMError);
    void stopExposureSequence(const char* cameraLabel) throw (CMMError);
@@ -474,6 +565,7 @@ public:
    void setPosition(const char* stageLabel, double position) throw (CMMError);
    void setPosition(double position) throw (CMMError);
    double getPosition(const char* stageLabel) throw (CMMError);
+   double getPosition(const char* stageLabel, double maxAgeMs) throw (CMMError);
    double getPosition() throw (CMMError);
    void setRelativePosition(const char* stageLabel, double d) throw (CMMError);
    void setRelativePosition(double d) throw (CMMError);
@@ -505,11 +597,17 @@ public:
    void setRelativeXYPosition(double dx, double dy) throw (CMMError);
    void getXYPosition(const char* xyStageLabel,
          double &x_stage, double &y_stage) throw (CMMError);
+   void getXYPosition(const char* xyStageLabel, double maxAgeMs,
+         double &x_stage, double &y_stage) throw (CMMError);
    void getXYPosition(double &x_stage, double &y_stage) throw (CMMError);
    double getXPosition(const char* xyStageLabel) throw (CMMError);
    double getYPosition(const char* xyStageLabel) throw (CMMError);
    double getXPosition() throw (CMMError);
    double getYPosition() throw (CMMError);
+   void setStagePositionCacheMaxAgeMs(const char* xyOrZStageLabel,
+         double maxAgeMs) throw (CMMError);
+   double getStagePositionCacheMaxAgeMs(const char* xyOrZStageLabel)
+      throw (CMMError);
    void stop(const char* xyOrZStageLabel) throw (CMMError);
    void home(const char* xyOrZStageLabel) throw (CMMError);
    void setOriginXY(const char* xyStageLabel) throw (CMMError);
@@ -629,6 +727,29 @@ public:
    std::vector<std::string> getLoadedPeripheralDevices(const char* hubLabel) throw (CMMError);
    ///@}
 
+   /** \name Device call tracing. */
+   ///@{
+   void enableDeviceCallTracing(bool enable);
+   bool isDeviceCallTracingEnabled();
+   void clearDeviceCallTrace();
+   std::vector<std::string> getTracedDeviceCallMethods(const char* label) throw (CMMError);
+   long getDeviceCallCount(const char* label, const char* method) throw (CMMError);
+   std::vector<long> getDeviceCallLatencyHistogram(const char* label,
+         const char* method) throw (CMMError);
+   double getDeviceCallMeanLatencyMs(const char* label, const char* method) throw (CMMError);
+   double getDeviceCallMaxLatencyMs(const char* label, const char* method) throw (CMMError);
+   double getDeviceCallMeanLockWaitMs(const char* label, const char* method) throw (CMMError);
+   void saveDeviceCallTrace(const char* fileName) throw (CMMError);
+   ///@}
+
+   /** \name Remote access. */
+   ///@{
+   void startRemoteCoreServer(const char* socketPath) throw (CMMError);
+   void stopRemoteCoreServer();
+   bool isRemoteCoreServerRunning();
+   long getRemoteCoreServerConnectionCount();
+   ///@}
+
    /** \name Miscellaneous. */
    ///@{
    std::string getUserId() const;
@@ -665,16 +786,34 @@ private:
    long pollingIntervalMs_;
    long timeoutMs_;
    bool autoShutter_;
+   bool snapPipeline_;
+   // As requested by the last sequence acquisition started; read by camera
+   // threads when the circular buffer rejects an image
+   boost::atomic<bool> stopOnOverflow_;
+   boost::shared_ptr<SnapBuffer> snapBuffer_;
+   boost::weak_ptr<ShutterInstance> pendingShutterClose_;
    std::vector<double> *nullAffine_;
    MM::Core* callback_;                 // core services for devices
    ConfigGroupCollection* configGroups_;
    CorePropertyCollection* properties_;
    MMEventCallback* externalCallback_;  // notification hook to the higher layer (e.g. GUI)
+   // Held shared while calling externalCallback_, exclusively to change it
+   boost::shared_mutex externalCallbackMutex_;
    PixelSizeConfigGroup* pixelSizeGroup_;
    CircularBuffer* cbuf_;
+   boost::shared_ptr<ThreadPool> threadPool_; // Shared by the image buffers
+   boost::shared_ptr<DiskSink> diskSink_;
+   boost::shared_ptr<RemoteCoreServer> remoteServer_;
+   boost::shared_ptr<CallbackDispatcher> callbackDispatcher_;
+   boost::shared_ptr<FrameSynchronizer> frameSync_;
+   boost::shared_ptr<FrameCombiner> frameCombiner_;
+   boost::shared_ptr<FrameDemultiplexer> frameDemux_;
+   boost::shared_ptr<mm::AcquisitionEngine> acqEngine_;
 
    std::vector< boost::weak_ptr<DeviceInstance> > imageSynchroDevices_;
    boost::shared_ptr<CPluginManager> pluginManager_;
+   // Must outlive the devices
+   boost::shared_ptr<DeviceCallTracer> callTracer_;
    boost::shared_ptr<mm::DeviceManager> deviceManager_;
    std::map<int, std::string> errorText_;
    CPropBlockMap propBlocks_;
@@ -704,6 +843,11 @@ private:
    void applyConfiguration(const Configuration& config) throw (CMMError);
    int applyProperties(std::vector<PropertySetting>& props, std::string& lastError);
    void waitForDevice(boost::shared_ptr<DeviceInstance> pDev) throw (CMMError);
+   void waitForPendingShutterClose() throw (CMMError);
+   bool initializeCircularBufferFor(unsigned channels, unsigned width,
+         unsigned height, unsigned byteDepth);
+   void* processSnappedImage(boost::shared_ptr<CameraInstance> camera,
+         bool useChannel, unsigned channelNr) throw (CMMError);
    Configuration getConfigGroupState(const char* group, bool fromCache) throw (CMMError);
    std::string getDeviceErrorText(int deviceCode, boost::shared_ptr<DeviceInstance> pDevice);
    std::string getDeviceName(boost::shared_ptr<DeviceInstance> pDev);
@@ -0,0 +1,50 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          MockDeviceAdapter.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   In-process device adapter for unit tests
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "../MMDevice/MMDevice.h"
+
+#include <boost/function.hpp>
+
+
+/**
+ * A device adapter implemented in the calling program, rather than loaded
+ * from a module. Registered with CMMCore::loadMockDeviceAdapter(); its
+ * devices are then loaded like any others. For unit tests only.
+ *
+ * The implementation must outlive the core (or at least its devices).
+ */
+class MockDeviceAdapter
+{
+public:
+   /// Takes the name, type and description of a device.
+   typedef boost::function<void (const char*, MM::DeviceType, const char*)>
+      RegisterDeviceFunc;
+
+   virtual ~MockDeviceAdapter() {}
+
+   /// Called once, when the adapter is registered.
+   virtual void InitializeModuleData(RegisterDeviceFunc registerDevice) = 0;
+   virtual MM::Device* CreateDevice(const char* name) = 0;
+   virtual void DeleteDevice(MM::Device* device) = 0;
+};
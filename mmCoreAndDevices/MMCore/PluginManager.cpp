@@ -166,6 +166,24 @@ CPluginManager::GetDeviceAdapter(const char* moduleName)
    return GetDeviceAdapter(std::string(moduleName));
 }
 
+void
+CPluginManager::AddMockDeviceAdapter(const std::string& moduleName,
+      MockDeviceAdapter* implementation)
+{
+   if (moduleName.empty())
+   {
+      throw CMMError("Empty device adapter module name");
+   }
+   if (moduleMap_.find(moduleName) != moduleMap_.end())
+   {
+      throw CMMError("A device adapter named " + ToQuotedString(moduleName) +
+            " is already loaded");
+   }
+
+   moduleMap_[moduleName] =
+      boost::make_shared<LoadedDeviceAdapter>(moduleName, implementation);
+}
+
 /** 
  * Unload a module.
  */
@@ -34,6 +34,7 @@
 #include <vector>
 
 class LoadedDeviceAdapter;
+class MockDeviceAdapter;
 
 
 class CPluginManager /* final */
@@ -64,6 +65,12 @@ public:
    boost::shared_ptr<LoadedDeviceAdapter>
    GetDeviceAdapter(const char* moduleName);
 
+   /**
+    * Register an in-process device adapter under a module name (for tests)
+    */
+   void AddMockDeviceAdapter(const std::string& moduleName,
+         MockDeviceAdapter* implementation);
+
 private:
    static std::vector<std::string> GetDefaultSearchPaths();
    std::vector<std::string> GetActualSearchPaths() const;
@@ -0,0 +1,949 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          RemoteCoreServer.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Serves the Core API to local processes over a Unix socket.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+
+#include "RemoteCoreServer.h"
+
+#include "CoreUtils.h"
+#include "ErrorCodes.h"
+#include "MMCore.h"
+#include "SharedMemoryExport.h"
+
+#include "../MMCoreRemote/RemoteCoreProtocol.h"
+
+#include <boost/lexical_cast.hpp>
+#include <boost/make_shared.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <deque>
+
+#ifndef _WINDOWS
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace RemoteCoreProtocol;
+
+
+namespace {
+
+// Events queued for a client that does not keep up; the oldest are dropped
+const std::size_t maxQueuedEvents = 4096;
+
+#ifndef _WINDOWS
+
+#ifdef MSG_NOSIGNAL
+const int sendFlags = MSG_NOSIGNAL;
+#else
+const int sendFlags = 0; // SO_NOSIGPIPE is set instead
+#endif
+
+void SetCloseOnExec(int fd)
+{
+   fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | FD_CLOEXEC);
+}
+
+bool ReadAll(int fd, void* dest, std::size_t bytes)
+{
+   char* p = static_cast<char*>(dest);
+   while (bytes > 0)
+   {
+      ssize_t n = recv(fd, p, bytes, 0);
+      if (n < 0 && errno == EINTR)
+         continue;
+      if (n <= 0)
+         return false;
+      p += n;
+      bytes -= n;
+   }
+   return true;
+}
+
+// Sends the pieces in full; modifies iov
+bool SendAll(int fd, struct iovec* iov, int count)
+{
+   while (count > 0)
+   {
+      struct msghdr msg;
+      std::memset(&msg, 0, sizeof(msg));
+      msg.msg_iov = iov;
+      msg.msg_iovlen = count;
+      ssize_t n = sendmsg(fd, &msg, sendFlags);
+      if (n < 0 && errno == EINTR)
+         continue;
+      if (n < 0)
+         return false;
+      while (count > 0 && static_cast<std::size_t>(n) >= iov->iov_len)
+      {
+         n -= iov->iov_len;
+         ++iov;
+         --count;
+      }
+      if (count > 0)
+      {
+         iov->iov_base = static_cast<char*>(iov->iov_base) + n;
+         iov->iov_len -= n;
+      }
+   }
+   return true;
+}
+
+#endif // _WINDOWS
+
+void PutMetadata(Writer& w, const Metadata& md)
+{
+   std::vector<std::pair<std::string, std::string> > tags;
+   const std::vector<std::string> keys = md.GetKeys();
+   for (std::vector<std::string>::const_iterator it = keys.begin(),
+         end = keys.end(); it != end; ++it)
+   {
+      try
+      {
+         tags.push_back(std::make_pair(*it,
+                  md.GetSingleTag(it->c_str()).GetValue()));
+      }
+      catch (const MetadataKeyError&)
+      {
+         // Array tag
+      }
+   }
+   w.PutUInt32(static_cast<boost::uint32_t>(tags.size()));
+   for (std::size_t i = 0; i < tags.size(); ++i)
+   {
+      w.PutString(tags[i].first);
+      w.PutString(tags[i].second);
+   }
+}
+
+} // anonymous namespace
+
+
+// One client, served by a thread of its own
+class RemoteCoreServer::Connection
+{
+public:
+   Connection(RemoteCoreServer& server, int fd);
+   ~Connection();
+
+   bool Start();
+   // Makes the thread exit
+   void Shutdown();
+   void Join() { thread_.join(); }
+   bool IsFinished();
+
+   void QueueEvent(unsigned opcode, const std::vector<char>& payload);
+
+private:
+   // An image reply: pixels (if not by handle) and metadata follow the
+   // result written by Execute()
+   struct ImageReply
+   {
+      ImageReply() : pixels(0), bytes(0) {}
+      const void* pixels;
+      std::size_t bytes;
+      Writer metadata;
+   };
+
+   void Run();
+   bool HandleRequest(const MessageHeader& request,
+         const std::vector<char>& payload);
+   void Execute(unsigned opcode, Reader& args, Writer& result,
+         ImageReply& image);
+   void PutImage(Writer& result, ImageReply& image, const void* pixels,
+         const Metadata& md);
+   bool FlushEvents();
+   bool Send(const MessageHeader& header, const Writer& payload,
+         const ImageReply* image);
+
+   RemoteCoreServer& server_;
+   CMMCore& core_;
+   int fd_;
+   int wakeFds_[2]; // Pipe signaling queued events
+   boost::thread thread_;
+
+   boost::mutex mutex_;
+   bool finished_;
+   bool subscribed_;
+   std::deque< std::pair<unsigned, std::vector<char> > > events_;
+   unsigned long droppedEventCount_;
+};
+
+
+RemoteCoreServer::Connection::Connection(RemoteCoreServer& server, int fd) :
+   server_(server),
+   core_(server.core_),
+   fd_(fd),
+   finished_(false),
+   subscribed_(false),
+   droppedEventCount_(0)
+{
+   wakeFds_[0] = wakeFds_[1] = -1;
+}
+
+RemoteCoreServer::Connection::~Connection()
+{
+#ifndef _WINDOWS
+   close(fd_);
+   if (wakeFds_[0] >= 0)
+   {
+      close(wakeFds_[0]);
+      close(wakeFds_[1]);
+   }
+#endif
+}
+
+bool RemoteCoreServer::Connection::Start()
+{
+#ifndef _WINDOWS
+   if (pipe(wakeFds_) != 0)
+   {
+      wakeFds_[0] = wakeFds_[1] = -1;
+      return false;
+   }
+   SetCloseOnExec(wakeFds_[0]);
+   SetCloseOnExec(wakeFds_[1]);
+   fcntl(wakeFds_[1], F_SETFL, fcntl(wakeFds_[1], F_GETFL) | O_NONBLOCK);
+   thread_ = boost::thread(&Connection::Run, this);
+   return true;
+#else
+   return false;
+#endif
+}
+
+void RemoteCoreServer::Connection::Shutdown()
+{
+#ifndef _WINDOWS
+   shutdown(fd_, SHUT_RDWR);
+#endif
+}
+
+bool RemoteCoreServer::Connection::IsFinished()
+{
+   boost::lock_guard<boost::mutex> lock(mutex_);
+   return finished_;
+}
+
+void RemoteCoreServer::Connection::QueueEvent(unsigned opcode,
+      const std::vector<char>& payload)
+{
+   bool wasEmpty;
+   {
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      if (!subscribed_ || finished_)
+         return;
+      if (events_.size() >= maxQueuedEvents)
+      {
+         events_.pop_front();
+         ++droppedEventCount_;
+      }
+      wasEmpty = events_.empty();
+      events_.push_back(std::make_pair(opcode, payload));
+   }
+#ifndef _WINDOWS
+   if (wasEmpty)
+   {
+      const char c = 0;
+      // Never blocks; if the pipe is full, a wakeup is pending anyway
+      ssize_t ignored = write(wakeFds_[1], &c, 1);
+      (void)ignored;
+   }
+#endif
+}
+
+void RemoteCoreServer::Connection::Run()
+{
+#ifndef _WINDOWS
+   std::vector<char> payload;
+   for (;;)
+   {
+      struct pollfd fds[2];
+      fds[0].fd = fd_;
+      fds[0].events = POLLIN;
+      fds[1].fd = wakeFds_[0];
+      fds[1].events = POLLIN;
+      if (poll(fds, 2, -1) < 0)
+      {
+         if (errno == EINTR)
+            continue;
+         break;
+      }
+
+      if (fds[1].revents & POLLIN)
+      {
+         char drain[64];
+         ssize_t ignored = read(wakeFds_[0], drain, sizeof(drain));
+         (void)ignored;
+      }
+      if (fds[0].revents & (POLLIN | POLLHUP | POLLERR))
+      {
+         MessageHeader request;
+         if (!ReadAll(fd_, &request, sizeof(request)))
+            break;
+         if (request.payloadBytes > MaxPayloadBytes)
+         {
+            LOG_ERROR(server_.logger_) << "Remote client sent a message of " <<
+               request.payloadBytes << " bytes; closing connection";
+            break;
+         }
+         payload.resize(request.payloadBytes);
+         if (request.payloadBytes > 0 &&
+               !ReadAll(fd_, &payload[0], payload.size()))
+            break;
+         if (!HandleRequest(request, payload))
+            break;
+      }
+      if (!FlushEvents())
+         break;
+   }
+#endif
+
+   unsigned long dropped;
+   {
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      finished_ = true;
+      events_.clear();
+      dropped = droppedEventCount_;
+   }
+   LOG_DEBUG(server_.logger_) << "Remote client disconnected" <<
+      (dropped ? " (" + boost::lexical_cast<std::string>(dropped) +
+       " events dropped)" : std::string());
+}
+
+bool RemoteCoreServer::Connection::HandleRequest(const MessageHeader& request,
+      const std::vector<char>& payload)
+{
+   MessageHeader reply;
+   reply.requestId = request.requestId;
+   reply.opcode = request.opcode;
+   reply.status = StatusOK;
+
+   Reader args(payload.empty() ? 0 : &payload[0], payload.size());
+   Writer result;
+   ImageReply image;
+   try
+   {
+      Execute(request.opcode, args, result, image);
+   }
+   catch (const ProtocolError& e)
+   {
+      LOG_ERROR(server_.logger_) << "Remote client protocol error: " <<
+         e.what() << "; closing connection";
+      return false;
+   }
+   catch (const CMMError& e)
+   {
+      reply.status = StatusError;
+      result.Clear();
+      result.PutUInt32(static_cast<boost::uint32_t>(e.getCode()));
+      result.PutString(e.getFullMsg());
+   }
+   catch (const std::exception& e)
+   {
+      reply.status = StatusError;
+      result.Clear();
+      result.PutUInt32(MMERR_GENERIC);
+      result.PutString(e.what());
+   }
+   return Send(reply, result, reply.status == StatusOK ? &image : 0);
+}
+
+void RemoteCoreServer::Connection::Execute(unsigned opcode, Reader& args,
+      Writer& result, ImageReply& image)
+{
+   switch (opcode)
+   {
+      case OpHello:
+      {
+         const boost::uint32_t magic = args.GetUInt32();
+         const boost::uint32_t version = args.GetUInt32();
+         if (magic != Magic)
+            throw ProtocolError("Not a remote-core client");
+         if (version != Version)
+            throw CMMError("Unsupported remote-core protocol version " +
+                  boost::lexical_cast<std::string>(version));
+         result.PutUInt32(Version);
+         result.PutString(core_.getVersionInfo());
+         result.PutString(core_.getBufferSharedMemoryExportName());
+         break;
+      }
+      case OpPing:
+         break;
+
+      case OpGetVersionInfo:
+         result.PutString(core_.getVersionInfo());
+         break;
+      case OpGetAPIVersionInfo:
+         result.PutString(core_.getAPIVersionInfo());
+         break;
+      case OpGetLoadedDevices:
+         result.PutStrings(core_.getLoadedDevices());
+         break;
+      case OpGetDevicePropertyNames:
+         result.PutStrings(core_.getDevicePropertyNames(
+                  args.GetString().c_str()));
+         break;
+      case OpHasProperty:
+      {
+         const std::string label = args.GetString();
+         const std::string prop = args.GetString();
+         result.PutUInt8(core_.hasProperty(label.c_str(), prop.c_str()));
+         break;
+      }
+      case OpGetProperty:
+      {
+         const std::string label = args.GetString();
+         const std::string prop = args.GetString();
+         result.PutString(core_.getProperty(label.c_str(), prop.c_str()));
+         break;
+      }
+      case OpSetProperty:
+      {
+         const std::string label = args.GetString();
+         const std::string prop = args.GetString();
+         const std::string value = args.GetString();
+         core_.setProperty(label.c_str(), prop.c_str(), value.c_str());
+         break;
+      }
+      case OpGetAllowedPropertyValues:
+      {
+         const std::string label = args.GetString();
+         const std::string prop = args.GetString();
+         result.PutStrings(core_.getAllowedPropertyValues(label.c_str(),
+                  prop.c_str()));
+         break;
+      }
+      case OpGetSystemStateCache:
+      {
+         const Configuration state = core_.getSystemStateCache();
+         result.PutUInt32(static_cast<boost::uint32_t>(state.size()));
+         for (std::size_t i = 0; i < state.size(); ++i)
+         {
+            const PropertySetting setting = state.getSetting(i);
+            result.PutString(setting.getDeviceLabel());
+            result.PutString(setting.getPropertyName());
+            result.PutString(setting.getPropertyValue());
+         }
+         break;
+      }
+      case OpGetAvailableConfigGroups:
+         result.PutStrings(core_.getAvailableConfigGroups());
+         break;
+      case OpGetAvailableConfigs:
+         result.PutStrings(core_.getAvailableConfigs(
+                  args.GetString().c_str()));
+         break;
+      case OpGetCurrentConfig:
+         result.PutString(core_.getCurrentConfig(args.GetString().c_str()));
+         break;
+      case OpSetConfig:
+      case OpWaitForConfig:
+      {
+         const std::string group = args.GetString();
+         const std::string config = args.GetString();
+         if (opcode == OpSetConfig)
+            core_.setConfig(group.c_str(), config.c_str());
+         else
+            core_.waitForConfig(group.c_str(), config.c_str());
+         break;
+      }
+      case OpDeviceBusy:
+         result.PutUInt8(core_.deviceBusy(args.GetString().c_str()));
+         break;
+      case OpWaitForDevice:
+         core_.waitForDevice(args.GetString().c_str());
+         break;
+      case OpWaitForSystem:
+         core_.waitForSystem();
+         break;
+      case OpGetPosition:
+         result.PutDouble(core_.getPosition(args.GetString().c_str()));
+         break;
+      case OpSetPosition:
+      {
+         const std::string label = args.GetString();
+         core_.setPosition(label.c_str(), args.GetDouble());
+         break;
+      }
+      case OpGetXYPosition:
+      {
+         double x, y;
+         core_.getXYPosition(args.GetString().c_str(), x, y);
+         result.PutDouble(x);
+         result.PutDouble(y);
+         break;
+      }
+      case OpSetXYPosition:
+      {
+         const std::string label = args.GetString();
+         const double x = args.GetDouble();
+         core_.setXYPosition(label.c_str(), x, args.GetDouble());
+         break;
+      }
+      case OpGetCameraDevice:
+         result.PutString(core_.getCameraDevice());
+         break;
+      case OpGetExposure:
+         result.PutDouble(core_.getExposure());
+         break;
+      case OpSetExposure:
+         core_.setExposure(args.GetDouble());
+         break;
+      case OpSnapImage:
+         core_.snapImage();
+         break;
+      case OpGetImage:
+         PutImage(result, image, core_.getImage(), Metadata());
+         break;
+      case OpStartContinuousSequenceAcquisition:
+         core_.startContinuousSequenceAcquisition(args.GetDouble());
+         break;
+      case OpStopSequenceAcquisition:
+         core_.stopSequenceAcquisition();
+         break;
+      case OpIsSequenceRunning:
+         result.PutUInt8(core_.isSequenceRunning());
+         break;
+      case OpGetRemainingImageCount:
+         result.PutInt64(core_.getRemainingImageCount());
+         break;
+      case OpPopNextImage:
+      {
+         Metadata md;
+         const void* pixels = core_.popNextImageMD(md);
+         PutImage(result, image, pixels, md);
+         break;
+      }
+
+      case OpSubscribe:
+      case OpUnsubscribe:
+      {
+         boost::lock_guard<boost::mutex> lock(mutex_);
+         subscribed_ = opcode == OpSubscribe;
+         if (!subscribed_)
+            events_.clear();
+         break;
+      }
+
+      default:
+         throw ProtocolError("Unknown opcode " +
+               boost::lexical_cast<std::string>(opcode));
+   }
+}
+
+void RemoteCoreServer::Connection::PutImage(Writer& result, ImageReply& image,
+      const void* pixels, const Metadata& md)
+{
+   const unsigned width = core_.getImageWidth();
+   const unsigned height = core_.getImageHeight();
+   const unsigned bytesPerPixel = core_.getBytesPerPixel();
+   result.PutUInt32(width);
+   result.PutUInt32(height);
+   result.PutUInt32(bytesPerPixel);
+   result.PutUInt32(core_.getNumberOfComponents());
+
+   // Images tagged by the shared-memory export are sent by handle
+   std::string handle;
+   try
+   {
+      handle = md.GetSingleTag(SharedMemoryExport::ImageNumberTag).GetValue();
+   }
+   catch (const MetadataKeyError&)
+   {
+   }
+   if (!handle.empty())
+   {
+      result.PutUInt8(1);
+      result.PutUInt64(boost::lexical_cast<boost::uint64_t>(handle));
+   }
+   else
+   {
+      image.pixels = pixels;
+      image.bytes = static_cast<std::size_t>(width) * height * bytesPerPixel;
+      result.PutUInt8(0);
+      result.PutUInt64(image.bytes);
+   }
+   PutMetadata(image.metadata, md);
+}
+
+bool RemoteCoreServer::Connection::FlushEvents()
+{
+   for (;;)
+   {
+      std::pair<unsigned, std::vector<char> > event;
+      {
+         boost::lock_guard<boost::mutex> lock(mutex_);
+         if (events_.empty())
+            return true;
+         event.first = events_.front().first;
+         event.second.swap(events_.front().second);
+         events_.pop_front();
+      }
+      MessageHeader header;
+      header.requestId = 0;
+      header.opcode = static_cast<boost::uint16_t>(event.first);
+      header.status = StatusOK;
+      Writer payload;
+      if (!event.second.empty())
+         payload.PutRaw(&event.second[0], event.second.size());
+      if (!Send(header, payload, 0))
+         return false;
+   }
+}
+
+bool RemoteCoreServer::Connection::Send(const MessageHeader& header,
+      const Writer& payload, const ImageReply* image)
+{
+#ifndef _WINDOWS
+   MessageHeader h = header;
+   struct iovec iov[4];
+   int count = 0;
+   iov[count].iov_base = &h;
+   iov[count++].iov_len = sizeof(h);
+   const std::vector<char>& bytes = payload.GetBytes();
+   if (!bytes.empty())
+   {
+      iov[count].iov_base = const_cast<char*>(&bytes[0]);
+      iov[count++].iov_len = bytes.size();
+   }
+   std::size_t total = bytes.size();
+   if (image)
+   {
+      if (image->pixels && image->bytes > 0)
+      {
+         iov[count].iov_base = const_cast<void*>(image->pixels);
+         iov[count++].iov_len = image->bytes;
+         total += image->bytes;
+      }
+      const std::vector<char>& md = image->metadata.GetBytes();
+      if (!md.empty())
+      {
+         iov[count].iov_base = const_cast<char*>(&md[0]);
+         iov[count++].iov_len = md.size();
+         total += md.size();
+      }
+   }
+   h.payloadBytes = static_cast<boost::uint32_t>(total);
+   return SendAll(fd_, iov, count);
+#else
+   (void)header;
+   (void)payload;
+   (void)image;
+   return false;
+#endif
+}
+
+
+RemoteCoreServer::RemoteCoreServer(CMMCore& core,
+      mm::logging::Logger logger) :
+   core_(core),
+   logger_(logger),
+   downstream_(0),
+   listenFd_(-1)
+{
+   wakeFds_[0] = wakeFds_[1] = -1;
+}
+
+RemoteCoreServer::~RemoteCoreServer()
+{
+   Stop();
+}
+
+void RemoteCoreServer::Start(const std::string& socketPath) throw (CMMError)
+{
+   Stop();
+
+#ifdef _WINDOWS
+   (void)socketPath;
+   throw CMMError("The remote-core server is not supported on this platform",
+         MMERR_InvalidContents);
+#else
+   struct sockaddr_un addr;
+   std::memset(&addr, 0, sizeof(addr));
+   addr.sun_family = AF_UNIX;
+   if (socketPath.empty() || socketPath.size() >= sizeof(addr.sun_path))
+      throw CMMError("Invalid remote-core socket path " + socketPath,
+            MMERR_InvalidContents);
+   std::memcpy(addr.sun_path, socketPath.c_str(), socketPath.size());
+
+   int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+   if (fd < 0)
+      throw CMMError(std::string("Cannot create remote-core socket: ") +
+            std::strerror(errno), MMERR_FileOpenFailed);
+   SetCloseOnExec(fd);
+   // A socket left over by a crashed process would make bind() fail; any
+   // other file at the path is left alone
+   struct stat st;
+   if (lstat(socketPath.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+      unlink(socketPath.c_str());
+   int err = bind(fd, reinterpret_cast<struct sockaddr*>(&addr),
+         sizeof(addr)) == 0 ? 0 : errno;
+   const bool bound = (err == 0);
+   // Only the same user may connect. Connections are refused until listen(),
+   // so none can be made before the permissions are set.
+   if (err == 0 && chmod(socketPath.c_str(), 0600) != 0)
+      err = errno;
+   if (err == 0 && listen(fd, 16) != 0)
+      err = errno;
+   if (err == 0 && pipe(wakeFds_) != 0)
+      err = errno;
+   if (err != 0)
+   {
+      close(fd);
+      if (bound)
+         unlink(socketPath.c_str());
+      wakeFds_[0] = wakeFds_[1] = -1;
+      throw CMMError("Cannot listen on remote-core socket " + socketPath +
+            ": " + std::strerror(err), MMERR_FileOpenFailed);
+   }
+   SetCloseOnExec(wakeFds_[0]);
+   SetCloseOnExec(wakeFds_[1]);
+
+   listenFd_ = fd;
+   socketPath_ = socketPath;
+   acceptThread_ = boost::thread(&RemoteCoreServer::AcceptLoop, this);
+   LOG_INFO(logger_) << "Remote-core server listening on " << socketPath_;
+#endif
+}
+
+void RemoteCoreServer::Stop()
+{
+   if (!IsRunning())
+      return;
+
+#ifndef _WINDOWS
+   const char c = 0;
+   ssize_t ignored = write(wakeFds_[1], &c, 1);
+   (void)ignored;
+   acceptThread_.join();
+   close(listenFd_);
+   close(wakeFds_[0]);
+   close(wakeFds_[1]);
+   unlink(socketPath_.c_str());
+#endif
+   listenFd_ = -1;
+   wakeFds_[0] = wakeFds_[1] = -1;
+
+   // Connection threads may be publishing events, which takes the mutex
+   std::vector< boost::shared_ptr<Connection> > connections;
+   {
+      boost::lock_guard<boost::mutex> lock(connectionsMutex_);
+      connections.swap(connections_);
+   }
+   for (std::size_t i = 0; i < connections.size(); ++i)
+      connections[i]->Shutdown();
+   for (std::size_t i = 0; i < connections.size(); ++i)
+      connections[i]->Join();
+
+   LOG_INFO(logger_) << "Remote-core server stopped";
+   socketPath_.clear();
+}
+
+unsigned RemoteCoreServer::GetConnectionCount()
+{
+   boost::lock_guard<boost::mutex> lock(connectionsMutex_);
+   unsigned count = 0;
+   for (std::size_t i = 0; i < connections_.size(); ++i)
+      if (!connections_[i]->IsFinished())
+         ++count;
+   return count;
+}
+
+void RemoteCoreServer::AcceptLoop()
+{
+#ifndef _WINDOWS
+   for (;;)
+   {
+      struct pollfd fds[2];
+      fds[0].fd = listenFd_;
+      fds[0].events = POLLIN;
+      fds[1].fd = wakeFds_[0];
+      fds[1].events = POLLIN;
+      if (poll(fds, 2, -1) < 0)
+      {
+         if (errno == EINTR)
+            continue;
+         LOG_ERROR(logger_) << "Remote-core server failed: " <<
+            std::strerror(errno);
+         return;
+      }
+      if (fds[1].revents & POLLIN)
+         return;
+      if (!(fds[0].revents & POLLIN))
+         continue;
+
+      int fd = accept(listenFd_, 0, 0);
+      if (fd < 0)
+         continue;
+      SetCloseOnExec(fd);
+#ifdef SO_NOSIGPIPE
+      int one = 1;
+      setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+
+      boost::shared_ptr<Connection> connection =
+         boost::make_shared<Connection>(boost::ref(*this), fd);
+      if (!connection->Start())
+         continue;
+      LOG_DEBUG(logger_) << "Remote client connected";
+
+      boost::lock_guard<boost::mutex> lock(connectionsMutex_);
+      // Reap clients that have disconnected
+      for (std::size_t i = 0; i < connections_.size(); )
+      {
+         if (connections_[i]->IsFinished())
+         {
+            connections_[i]->Join();
+            connections_.erase(connections_.begin() + i);
+         }
+         else
+            ++i;
+      }
+      connections_.push_back(connection);
+   }
+#endif
+}
+
+void RemoteCoreServer::Publish(unsigned opcode,
+      const std::vector<char>& payload)
+{
+   boost::lock_guard<boost::mutex> lock(connectionsMutex_);
+   for (std::size_t i = 0; i < connections_.size(); ++i)
+      connections_[i]->QueueEvent(opcode, payload);
+}
+
+void RemoteCoreServer::onPropertiesChanged()
+{
+   if (downstream_)
+      downstream_->onPropertiesChanged();
+   Publish(EventPropertiesChanged, std::vector<char>());
+}
+
+void RemoteCoreServer::onPropertyChanged(const char* name,
+      const char* propName, const char* propValue)
+{
+   if (downstream_)
+      downstream_->onPropertyChanged(name, propName, propValue);
+   Writer w;
+   w.PutString(name);
+   w.PutString(propName);
+   w.PutString(propValue);
+   Publish(EventPropertyChanged, w.GetBytes());
+}
+
+void RemoteCoreServer::onChannelGroupChanged(const char* newChannelGroupName)
+{
+   if (downstream_)
+      downstream_->onChannelGroupChanged(newChannelGroupName);
+   Writer w;
+   w.PutString(newChannelGroupName);
+   Publish(EventChannelGroupChanged, w.GetBytes());
+}
+
+void RemoteCoreServer::onConfigGroupChanged(const char* groupName,
+      const char* newConfigName)
+{
+   if (downstream_)
+      downstream_->onConfigGroupChanged(groupName, newConfigName);
+   Writer w;
+   w.PutString(groupName);
+   w.PutString(newConfigName);
+   Publish(EventConfigGroupChanged, w.GetBytes());
+}
+
+void RemoteCoreServer::onSystemConfigurationLoaded()
+{
+   if (downstream_)
+      downstream_->onSystemConfigurationLoaded();
+   Publish(EventSystemConfigurationLoaded, std::vector<char>());
+}
+
+void RemoteCoreServer::onPixelSizeChanged(double newPixelSizeUm)
+{
+   if (downstream_)
+      downstream_->onPixelSizeChanged(newPixelSizeUm);
+   Writer w;
+   w.PutDouble(newPixelSizeUm);
+   Publish(EventPixelSizeChanged, w.GetBytes());
+}
+
+void RemoteCoreServer::onPixelSizeAffineChanged(double v0, double v1,
+      double v2, double v3, double v4, double v5)
+{
+   if (downstream_)
+      downstream_->onPixelSizeAffineChanged(v0, v1, v2, v3, v4, v5);
+   Writer w;
+   w.PutDouble(v0);
+   w.PutDouble(v1);
+   w.PutDouble(v2);
+   w.PutDouble(v3);
+   w.PutDouble(v4);
+   w.PutDouble(v5);
+   Publish(EventPixelSizeAffineChanged, w.GetBytes());
+}
+
+void RemoteCoreServer::onStagePositionChanged(char* name, double pos)
+{
+   if (downstream_)
+      downstream_->onStagePositionChanged(name, pos);
+   Writer w;
+   w.PutString(name);
+   w.PutDouble(pos);
+   Publish(EventStagePositionChanged, w.GetBytes());
+}
+
+void RemoteCoreServer::onXYStagePositionChanged(char* name, double xpos,
+      double ypos)
+{
+   if (downstream_)
+      downstream_->onXYStagePositionChanged(name, xpos, ypos);
+   Writer w;
+   w.PutString(name);
+   w.PutDouble(xpos);
+   w.PutDouble(ypos);
+   Publish(EventXYStagePositionChanged, w.GetBytes());
+}
+
+void RemoteCoreServer::onExposureChanged(char* name, double newExposure)
+{
+   if (downstream_)
+      downstream_->onExposureChanged(name, newExposure);
+   Writer w;
+   w.PutString(name);
+   w.PutDouble(newExposure);
+   Publish(EventExposureChanged, w.GetBytes());
+}
+
+void RemoteCoreServer::onSLMExposureChanged(char* name, double newExposure)
+{
+   if (downstream_)
+      downstream_->onSLMExposureChanged(name, newExposure);
+   Writer w;
+   w.PutString(name);
+   w.PutDouble(newExposure);
+   Publish(EventSLMExposureChanged, w.GetBytes());
+}
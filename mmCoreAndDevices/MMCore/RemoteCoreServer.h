@@ -0,0 +1,100 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          RemoteCoreServer.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Serves the Core API to local processes over a Unix socket.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+
+#pragma once
+
+#include "Error.h"
+#include "MMEventCallback.h"
+#include "Logging/Logger.h"
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include <string>
+#include <vector>
+
+class CMMCore;
+
+/// Serves part of the CMMCore API to processes on the same machine.
+/**
+ * Listens on a Unix domain socket and executes the requests of each client
+ * on a thread of its own, using the protocol described in
+ * MMCoreRemote/RemoteCoreProtocol.h. Clients that subscribe are sent the
+ * core's events, which the server receives by being registered as the
+ * core's callback; it forwards them to the callback registered by the
+ * application, if any. Not supported on Windows.
+ */
+class RemoteCoreServer : public MMEventCallback
+{
+public:
+   RemoteCoreServer(CMMCore& core, mm::logging::Logger logger);
+   ~RemoteCoreServer();
+
+   // Replaces any file at socketPath
+   void Start(const std::string& socketPath) throw (CMMError);
+   void Stop();
+   bool IsRunning() const { return listenFd_ >= 0; }
+   const std::string& GetSocketPath() const { return socketPath_; }
+   unsigned GetConnectionCount();
+
+   void SetDownstreamCallback(MMEventCallback* callback)
+   { downstream_ = callback; }
+   MMEventCallback* GetDownstreamCallback() const { return downstream_; }
+
+   virtual void onPropertiesChanged();
+   virtual void onPropertyChanged(const char* name, const char* propName,
+         const char* propValue);
+   virtual void onChannelGroupChanged(const char* newChannelGroupName);
+   virtual void onConfigGroupChanged(const char* groupName,
+         const char* newConfigName);
+   virtual void onSystemConfigurationLoaded();
+   virtual void onPixelSizeChanged(double newPixelSizeUm);
+   virtual void onPixelSizeAffineChanged(double v0, double v1, double v2,
+         double v3, double v4, double v5);
+   virtual void onStagePositionChanged(char* name, double pos);
+   virtual void onXYStagePositionChanged(char* name, double xpos,
+         double ypos);
+   virtual void onExposureChanged(char* name, double newExposure);
+   virtual void onSLMExposureChanged(char* name, double newExposure);
+
+private:
+   class Connection;
+
+   RemoteCoreServer(const RemoteCoreServer&);
+   RemoteCoreServer& operator=(const RemoteCoreServer&);
+
+   void AcceptLoop();
+   void Publish(unsigned opcode, const std::vector<char>& payload);
+
+   CMMCore& core_;
+   mm::logging::Logger logger_;
+   MMEventCallback* downstream_;
+
+   std::string socketPath_;
+   int listenFd_;
+   int wakeFds_[2]; // Pipe that interrupts AcceptLoop()
+   boost::thread acceptThread_;
+
+   boost::mutex connectionsMutex_;
+   std::vector< boost::shared_ptr<Connection> > connections_;
+};
@@ -0,0 +1,120 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          SequenceCompiler.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Splits an acquisition plan into hardware-sequenced runs
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "SequenceCompiler.h"
+
+#include "AcquisitionPlan.h"
+
+namespace mm
+{
+
+std::vector<AcquisitionEvent>
+SequenceCompiler::ExpandEvents(const AcquisitionPlan& plan)
+{
+   const long timePoints = plan.getTimePointCount();
+   const long positions = plan.getPositionCount();
+   const long slices = plan.getSliceCount();
+   const long channels = plan.getChannelCount();
+   const bool channelsFirst = plan.getChannelsBeforeSlices();
+
+   std::vector<AcquisitionEvent> events;
+   events.reserve(plan.getFrameCount());
+   for (long t = 0; t < timePoints; ++t)
+   {
+      for (long p = 0; p < positions; ++p)
+      {
+         const long outer = channelsFirst ? slices : channels;
+         const long inner = channelsFirst ? channels : slices;
+         for (long i = 0; i < outer; ++i)
+         {
+            for (long j = 0; j < inner; ++j)
+            {
+               AcquisitionEvent event;
+               event.timeIndex = t;
+               event.positionIndex = p;
+               event.sliceIndex = channelsFirst ? i : j;
+               event.channelIndex = channelsFirst ? j : i;
+               events.push_back(event);
+            }
+         }
+      }
+   }
+   return events;
+}
+
+std::vector<AcquisitionRun>
+SequenceCompiler::CompileRuns(const AcquisitionPlan& plan,
+      const std::vector<AcquisitionEvent>& events,
+      const SequenceLimits& limits)
+{
+   const long framesPerTimePoint = plan.getPositionCount() *
+      plan.getSliceCount() * plan.getChannelCount();
+   const bool softwareTimed = plan.getIntervalMs() > 0.0;
+   const bool cameraTimed = softwareTimed && plan.getCameraTimedIntervals() &&
+      framesPerTimePoint == 1;
+
+   std::vector<AcquisitionRun> runs;
+   std::size_t first = 0;
+   while (first < events.size())
+   {
+      const AcquisitionEvent& start = events[first];
+      AcquisitionRun run;
+      run.firstEvent = first;
+      run.eventCount = 1;
+      run.sequenceXY = false;
+      run.sequenceZ = false;
+      run.sequenceChannel = false;
+      run.waitForTimePoint = softwareTimed &&
+         (first == 0 || events[first - 1].timeIndex != start.timeIndex);
+      run.cameraIntervalMs = cameraTimed ? plan.getIntervalMs() : 0.0;
+
+      for (std::size_t next = first + 1; next < events.size(); ++next)
+      {
+         const AcquisitionEvent& event = events[next];
+         if (softwareTimed && !cameraTimed &&
+               event.timeIndex != events[next - 1].timeIndex)
+            break;
+
+         const bool xy = run.sequenceXY ||
+            event.positionIndex != start.positionIndex;
+         const bool z = run.sequenceZ || event.sliceIndex != start.sliceIndex;
+         const bool channel = run.sequenceChannel ||
+            event.channelIndex != start.channelIndex;
+         const long length = static_cast<long>(run.eventCount + 1);
+         if ((xy && length > limits.xyMaxLength) ||
+               (z && length > limits.zMaxLength) ||
+               (channel && length > limits.channelMaxLength))
+            break;
+
+         run.sequenceXY = xy;
+         run.sequenceZ = z;
+         run.sequenceChannel = channel;
+         ++run.eventCount;
+      }
+
+      runs.push_back(run);
+      first += run.eventCount;
+   }
+   return runs;
+}
+
+} // namespace mm
@@ -0,0 +1,98 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          SequenceCompiler.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Splits an acquisition plan into hardware-sequenced runs
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+class AcquisitionPlan;
+
+namespace mm
+{
+
+/// One frame of a plan, as indices into the plan's axes.
+struct AcquisitionEvent
+{
+   long timeIndex;
+   long positionIndex;
+   long sliceIndex;
+   long channelIndex;
+};
+
+/// Hardware sequencing capabilities of the devices used by a plan.
+/**
+ * Each entry is the longest sequence the devices driving the axis accept,
+ * or 0 if the axis cannot be sequenced.
+ */
+struct SequenceLimits
+{
+   long xyMaxLength;
+   long zMaxLength;
+   long channelMaxLength;
+
+   SequenceLimits() : xyMaxLength(0), zMaxLength(0), channelMaxLength(0) {}
+};
+
+/// A range of consecutive frames acquired as one camera sequence.
+/**
+ * Axes that change within the run are driven by hardware sequences loaded
+ * before the run; all other axes keep the value of the first frame, which is
+ * set by software before the run starts.
+ */
+struct AcquisitionRun
+{
+   std::size_t firstEvent;
+   std::size_t eventCount;
+   bool sequenceXY;
+   bool sequenceZ;
+   bool sequenceChannel;
+   // Whether the run must wait for the scheduled start of its first time
+   // point
+   bool waitForTimePoint;
+   // Interval to request from the camera
+   double cameraIntervalMs;
+};
+
+/// Compiles acquisition plans into maximal hardware-sequenced runs.
+class SequenceCompiler
+{
+public:
+   /// Lists the frames of the plan in acquisition order.
+   static std::vector<AcquisitionEvent> ExpandEvents(const AcquisitionPlan& plan);
+
+   /**
+    * Splits the events into runs, greedily making each run as long as
+    * possible. A run is ended before a frame that would change an axis that
+    * cannot be sequenced, that would make the sequence of any changing axis
+    * longer than its limit, or that starts a new time point which must be
+    * started by the core.
+    */
+   static std::vector<AcquisitionRun> CompileRuns(const AcquisitionPlan& plan,
+         const std::vector<AcquisitionEvent>& events,
+         const SequenceLimits& limits);
+
+private:
+   SequenceCompiler();
+};
+
+} // namespace mm
@@ -0,0 +1,295 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          SequenceMonitor.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Per-camera accounting of frames through the circular buffer.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+
+#include "SequenceMonitor.h"
+
+#include "CoreClock.h"
+#include "SequenceStatistics.h"
+
+#include <boost/make_shared.hpp>
+#include <boost/thread/locks.hpp>
+
+
+namespace {
+
+unsigned HistogramBucket(boost::uint64_t durationNs)
+{
+   boost::uint64_t us = durationNs / 1000;
+   unsigned bucket = 0;
+   while (us > 0 && bucket < SequenceMonitor::NumHistogramBuckets - 1)
+   {
+      us >>= 1;
+      ++bucket;
+   }
+   return bucket;
+}
+
+// Events per second over the retained timestamps of count events, up to
+// nowNs. Returns 0 unless at least 2 events are retained.
+double Rate(const boost::atomic<boost::uint64_t>* timesNs,
+      boost::uint64_t count, boost::uint64_t nowNs)
+{
+   const unsigned window = SequenceMonitor::RateWindow;
+   const boost::uint64_t n = count < window ? count : window;
+   if (n < 2)
+      return 0.0;
+   const boost::uint64_t oldestNs =
+      timesNs[(count - n) % window].load(boost::memory_order_relaxed);
+   if (oldestNs == 0 || nowNs <= oldestNs)
+      return 0.0;
+   return static_cast<double>(n - 1) * 1e9 /
+      static_cast<double>(nowNs - oldestNs);
+}
+
+double MsSince(const boost::atomic<boost::uint64_t>* timesNs,
+      boost::uint64_t count, boost::uint64_t nowNs)
+{
+   if (count == 0)
+      return -1.0;
+   const boost::uint64_t lastNs = timesNs[(count - 1) %
+      SequenceMonitor::RateWindow].load(boost::memory_order_relaxed);
+   if (lastNs == 0 || nowNs < lastNs)
+      return -1.0;
+   return static_cast<double>(nowNs - lastNs) / 1e6;
+}
+
+} // anonymous namespace
+
+
+SequenceMonitor::Camera::Camera()
+{
+   Reset();
+}
+
+void
+SequenceMonitor::Camera::Reset()
+{
+   inserted.store(0, boost::memory_order_relaxed);
+   popped.store(0, boost::memory_order_relaxed);
+   evicted.store(0, boost::memory_order_relaxed);
+   rejected.store(0, boost::memory_order_relaxed);
+   depthHighWater.store(depth.load(boost::memory_order_relaxed),
+         boost::memory_order_relaxed);
+   residenceTotalNs.store(0, boost::memory_order_relaxed);
+   residenceMaxNs.store(0, boost::memory_order_relaxed);
+   for (unsigned b = 0; b < NumHistogramBuckets; ++b)
+      buckets[b].store(0, boost::memory_order_relaxed);
+   for (unsigned i = 0; i < RateWindow; ++i)
+   {
+      insertTimesNs[i].store(0, boost::memory_order_relaxed);
+      popTimesNs[i].store(0, boost::memory_order_relaxed);
+   }
+}
+
+
+SequenceMonitor::SequenceMonitor() :
+   lastCamera_(0)
+{
+}
+
+SequenceMonitor::~SequenceMonitor()
+{
+}
+
+SequenceMonitor::Camera*
+SequenceMonitor::FindCamera(const std::string& camera) const
+{
+   boost::lock_guard<boost::mutex> lock(camerasMutex_);
+   std::map<std::string, boost::shared_ptr<Camera> >::const_iterator it =
+      cameras_.find(camera);
+   if (it == cameras_.end())
+      return 0;
+   return it->second.get();
+}
+
+SequenceMonitor::Camera*
+SequenceMonitor::GetOrCreateCamera(const std::string& camera)
+{
+   if (lastCamera_ && camera == lastCameraLabel_)
+      return lastCamera_;
+
+   boost::lock_guard<boost::mutex> lock(camerasMutex_);
+   boost::shared_ptr<Camera>& c = cameras_[camera];
+   if (!c)
+   {
+      c = boost::make_shared<Camera>();
+      c->depth.store(0, boost::memory_order_relaxed);
+      c->Reset();
+   }
+   lastCameraLabel_ = camera;
+   lastCamera_ = c.get();
+   return lastCamera_;
+}
+
+void
+SequenceMonitor::FrameInserted(const std::string& camera, boost::uint64_t nowNs)
+{
+   Camera* c = GetOrCreateCamera(camera);
+   queue_.push_back(std::make_pair(c, nowNs));
+
+   const boost::uint64_t inserted = c->inserted.load(boost::memory_order_relaxed);
+   c->insertTimesNs[inserted % RateWindow].store(nowNs,
+         boost::memory_order_relaxed);
+   c->inserted.store(inserted + 1, boost::memory_order_release);
+
+   const boost::uint64_t depth = c->depth.load(boost::memory_order_relaxed) + 1;
+   c->depth.store(depth, boost::memory_order_relaxed);
+   if (depth > c->depthHighWater.load(boost::memory_order_relaxed))
+      c->depthHighWater.store(depth, boost::memory_order_relaxed);
+}
+
+void
+SequenceMonitor::FrameRejected(const std::string& camera)
+{
+   GetOrCreateCamera(camera)->rejected.fetch_add(1, boost::memory_order_relaxed);
+}
+
+void
+SequenceMonitor::FramePopped(boost::uint64_t nowNs)
+{
+   RemoveOldest(true, nowNs);
+}
+
+void
+SequenceMonitor::FrameEvicted()
+{
+   RemoveOldest(false, 0);
+}
+
+void
+SequenceMonitor::RemoveOldest(bool popped, boost::uint64_t nowNs)
+{
+   if (queue_.empty())
+      return;
+   Camera* c = queue_.front().first;
+   const boost::uint64_t insertNs = queue_.front().second;
+   queue_.pop_front();
+
+   const boost::uint64_t depth = c->depth.load(boost::memory_order_relaxed);
+   if (depth > 0)
+      c->depth.store(depth - 1, boost::memory_order_relaxed);
+
+   if (!popped)
+   {
+      c->evicted.fetch_add(1, boost::memory_order_relaxed);
+      return;
+   }
+
+   const boost::uint64_t residenceNs = nowNs > insertNs ? nowNs - insertNs : 0;
+   c->buckets[HistogramBucket(residenceNs)].fetch_add(1,
+         boost::memory_order_relaxed);
+   c->residenceTotalNs.fetch_add(residenceNs, boost::memory_order_relaxed);
+   if (residenceNs > c->residenceMaxNs.load(boost::memory_order_relaxed))
+      c->residenceMaxNs.store(residenceNs, boost::memory_order_relaxed);
+
+   const boost::uint64_t count = c->popped.load(boost::memory_order_relaxed);
+   c->popTimesNs[count % RateWindow].store(nowNs, boost::memory_order_relaxed);
+   c->popped.store(count + 1, boost::memory_order_release);
+}
+
+void
+SequenceMonitor::DiscardNewest(std::size_t count)
+{
+   for (; count > 0 && !queue_.empty(); --count)
+   {
+      Camera* c = queue_.back().first;
+      queue_.pop_back();
+      const boost::uint64_t depth = c->depth.load(boost::memory_order_relaxed);
+      if (depth > 0)
+         c->depth.store(depth - 1, boost::memory_order_relaxed);
+   }
+}
+
+void
+SequenceMonitor::ClearQueue()
+{
+   queue_.clear();
+   boost::lock_guard<boost::mutex> lock(camerasMutex_);
+   for (std::map<std::string, boost::shared_ptr<Camera> >::iterator
+         it = cameras_.begin(), end = cameras_.end(); it != end; ++it)
+      it->second->depth.store(0, boost::memory_order_relaxed);
+}
+
+void
+SequenceMonitor::ResetStatistics()
+{
+   boost::lock_guard<boost::mutex> lock(camerasMutex_);
+   for (std::map<std::string, boost::shared_ptr<Camera> >::iterator
+         it = cameras_.begin(), end = cameras_.end(); it != end; ++it)
+      it->second->Reset();
+}
+
+void
+SequenceMonitor::GetStatistics(const std::string& camera,
+      SequenceStatistics& statistics) const
+{
+   statistics = SequenceStatistics();
+   statistics.residenceHistogram_.assign(NumHistogramBuckets, 0);
+   const Camera* c = FindCamera(camera);
+   if (!c)
+      return;
+
+   const boost::uint64_t nowNs = mm::CoreClock::MonotonicNs();
+   const boost::uint64_t inserted = c->inserted.load(boost::memory_order_acquire);
+   const boost::uint64_t popped = c->popped.load(boost::memory_order_acquire);
+   statistics.insertedImageCount_ = static_cast<long>(inserted);
+   statistics.poppedImageCount_ = static_cast<long>(popped);
+   statistics.evictedImageCount_ =
+      static_cast<long>(c->evicted.load(boost::memory_order_relaxed));
+   statistics.rejectedImageCount_ =
+      static_cast<long>(c->rejected.load(boost::memory_order_relaxed));
+   statistics.queueDepth_ =
+      static_cast<long>(c->depth.load(boost::memory_order_relaxed));
+   statistics.queueDepthHighWaterMark_ =
+      static_cast<long>(c->depthHighWater.load(boost::memory_order_relaxed));
+
+   statistics.insertsPerSecond_ = Rate(c->insertTimesNs, inserted, nowNs);
+   statistics.popsPerSecond_ = Rate(c->popTimesNs, popped, nowNs);
+   statistics.msSinceLastInsert_ = MsSince(c->insertTimesNs, inserted, nowNs);
+   statistics.msSinceLastPop_ = MsSince(c->popTimesNs, popped, nowNs);
+
+   boost::uint64_t histogramTotal = 0;
+   for (unsigned b = 0; b < NumHistogramBuckets; ++b)
+   {
+      const boost::uint64_t n = c->buckets[b].load(boost::memory_order_relaxed);
+      statistics.residenceHistogram_[b] = static_cast<long>(n);
+      histogramTotal += n;
+   }
+   if (histogramTotal > 0)
+      statistics.meanResidenceMs_ = static_cast<double>(
+            c->residenceTotalNs.load(boost::memory_order_relaxed)) /
+         static_cast<double>(histogramTotal) / 1e6;
+   statistics.maxResidenceMs_ = static_cast<double>(
+         c->residenceMaxNs.load(boost::memory_order_relaxed)) / 1e6;
+}
+
+std::vector<std::string>
+SequenceMonitor::GetCameras() const
+{
+   boost::lock_guard<boost::mutex> lock(camerasMutex_);
+   std::vector<std::string> labels;
+   for (std::map<std::string, boost::shared_ptr<Camera> >::const_iterator
+         it = cameras_.begin(), end = cameras_.end(); it != end; ++it)
+      labels.push_back(it->first);
+   return labels;
+}
@@ -0,0 +1,123 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          SequenceMonitor.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Per-camera accounting of frames through the circular buffer.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+
+
+#pragma once
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/utility.hpp>
+
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+class SequenceStatistics;
+
+/// Counts the frames of each camera inserted into, retrieved from and lost
+/// by the circular buffer, and how long they stay there.
+/**
+ * The circular buffer reports each frame event with the buffer's lock held,
+ * so the events are recorded in the order they happen, by one thread at a
+ * time. The monitor mirrors the order of the frames in the buffer, so that a
+ * retrieved or dropped frame is attributed to its camera and insertion time
+ * without looking at its metadata.
+ *
+ * The statistics of each camera are held in atomic counters, and rates are
+ * computed from rings of the most recent timestamps, so that reading them
+ * never waits for the buffer (only finding a camera by label takes a mutex,
+ * and only briefly).
+ */
+class SequenceMonitor : boost::noncopyable
+{
+public:
+   // Bucket 0 counts frames retrieved within 1 us; bucket i > 0 counts
+   // frames retrieved after [2^(i-1), 2^i) us. The last bucket also counts
+   // longer times.
+   static const unsigned NumHistogramBuckets = 32;
+   // Number of timestamps over which rates are computed
+   static const unsigned RateWindow = 64;
+
+   SequenceMonitor();
+   ~SequenceMonitor();
+
+   // The following must be called with the buffer's lock held
+   void FrameInserted(const std::string& camera, boost::uint64_t nowNs);
+   void FrameRejected(const std::string& camera);
+   // The oldest frame in the buffer was retrieved
+   void FramePopped(boost::uint64_t nowNs);
+   // The oldest frame in the buffer was discarded to make room
+   void FrameEvicted();
+   // The newest count frames were discarded, without being counted as lost
+   void DiscardNewest(std::size_t count);
+   // The buffer was emptied
+   void ClearQueue();
+   // Zero the counts and latencies, keeping the frames in the queue
+   void ResetStatistics();
+
+   // May be called without any lock held. A camera that has not inserted
+   // any frame has all-zero statistics.
+   void GetStatistics(const std::string& camera,
+         SequenceStatistics& statistics) const;
+   std::vector<std::string> GetCameras() const;
+
+private:
+   struct Camera : boost::noncopyable
+   {
+      boost::atomic<boost::uint64_t> inserted;
+      boost::atomic<boost::uint64_t> popped;
+      boost::atomic<boost::uint64_t> evicted;
+      boost::atomic<boost::uint64_t> rejected;
+      boost::atomic<boost::uint64_t> depth;
+      boost::atomic<boost::uint64_t> depthHighWater;
+      boost::atomic<boost::uint64_t> residenceTotalNs;
+      boost::atomic<boost::uint64_t> residenceMaxNs;
+      boost::atomic<boost::uint64_t> buckets[NumHistogramBuckets];
+      // Timestamps of the last RateWindow inserts and pops, at index
+      // count % RateWindow; 0 where not yet written
+      boost::atomic<boost::uint64_t> insertTimesNs[RateWindow];
+      boost::atomic<boost::uint64_t> popTimesNs[RateWindow];
+
+      Camera();
+      void Reset();
+   };
+
+   Camera* FindCamera(const std::string& camera) const;
+   Camera* GetOrCreateCamera(const std::string& camera);
+   void RemoveOldest(bool popped, boost::uint64_t nowNs);
+
+   mutable boost::mutex camerasMutex_;
+   std::map<std::string, boost::shared_ptr<Camera> > cameras_;
+   // Last camera looked up by FrameInserted() or FrameRejected(), which
+   // usually inserts the next frame as well
+   std::string lastCameraLabel_;
+   Camera* lastCamera_;
+
+   // The camera and insertion time of the frames in the buffer, oldest first
+   std::deque<std::pair<Camera*, boost::uint64_t> > queue_;
+};
@@ -0,0 +1,112 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          SequenceStatistics.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Frame throughput and latency statistics of one camera.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+
+#ifndef _SEQUENCESTATISTICS_H_
+#define _SEQUENCESTATISTICS_H_
+
+#include <vector>
+
+
+/**
+ * Frames of one camera that went through the circular buffer, as returned by
+ * CMMCore::getSequenceStatistics().
+ *
+ * Counts and latencies are since the circular buffer was last initialized
+ * (normally, since the start of the last sequence acquisition). Clearing the
+ * buffer, as cameras do when it overflows, does not reset them.
+ * The queue depth is the number of the camera's frames in the buffer, which
+ * have been inserted but neither retrieved nor dropped.
+ *
+ * The residence time of a frame is the time from its insertion to its
+ * retrieval with popNextImage() or a related function. Frames that are
+ * dropped or cleared are not counted.
+ */
+class SequenceStatistics
+{
+public:
+   SequenceStatistics() :
+      insertedImageCount_(0),
+      poppedImageCount_(0),
+      evictedImageCount_(0),
+      rejectedImageCount_(0),
+      queueDepth_(0),
+      queueDepthHighWaterMark_(0),
+      insertsPerSecond_(0.0),
+      popsPerSecond_(0.0),
+      msSinceLastInsert_(-1.0),
+      msSinceLastPop_(-1.0),
+      meanResidenceMs_(0.0),
+      maxResidenceMs_(0.0)
+   {}
+
+   long getInsertedImageCount() const { return insertedImageCount_; }
+   long getPoppedImageCount() const { return poppedImageCount_; }
+   /// Unread frames discarded to make room for new ones (overflow policy
+   /// DropOldest).
+   long getEvictedImageCount() const { return evictedImageCount_; }
+   /// Frames rejected because the buffer was full (overflow policies
+   /// DropNewest and Block).
+   long getRejectedImageCount() const { return rejectedImageCount_; }
+   /// Frames lost to overflow: evicted plus rejected.
+   long getOverflowCount() const
+   { return evictedImageCount_ + rejectedImageCount_; }
+
+   long getQueueDepth() const { return queueDepth_; }
+   long getQueueDepthHighWaterMark() const { return queueDepthHighWaterMark_; }
+
+   /// Over the most recent (up to 64) frames; decays to 0 once frames stop.
+   double getInsertsPerSecond() const { return insertsPerSecond_; }
+   double getPopsPerSecond() const { return popsPerSecond_; }
+   /// -1 if no frame has been inserted or retrieved.
+   double getMsSinceLastInsert() const { return msSinceLastInsert_; }
+   double getMsSinceLastPop() const { return msSinceLastPop_; }
+
+   double getMeanResidenceMs() const { return meanResidenceMs_; }
+   double getMaxResidenceMs() const { return maxResidenceMs_; }
+   /**
+    * Residence times of the retrieved frames. Element 0 counts frames
+    * retrieved within 1 us; element i > 0 counts those retrieved after
+    * [2^(i-1), 2^i) us. The last element also counts longer times.
+    */
+   std::vector<long> getResidenceHistogram() const
+   { return residenceHistogram_; }
+
+private:
+   friend class SequenceMonitor;
+
+   long insertedImageCount_;
+   long poppedImageCount_;
+   long evictedImageCount_;
+   long rejectedImageCount_;
+   long queueDepth_;
+   long queueDepthHighWaterMark_;
+   double insertsPerSecond_;
+   double popsPerSecond_;
+   double msSinceLastInsert_;
+   double msSinceLastPop_;
+   double meanResidenceMs_;
+   double maxResidenceMs_;
+   std::vector<long> residenceHistogram_;
+};
+
+#endif //_SEQUENCESTATISTICS_H_
@@ -0,0 +1,268 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          SharedMemoryExport.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Export of inserted images to POSIX shared memory.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+
+#include "SharedMemoryExport.h"
+
+#include "ErrorCodes.h"
+#include "TaskSet_CopyMemory.h"
+
+#include "../MMCoreShm/MMCoreShm.h"
+
+#include <cerrno>
+#include <cstring>
+#include <limits>
+
+#ifndef _WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+
+const char* const SharedMemoryExport::ImageNumberTag = "SharedMemoryImageNumber";
+
+
+namespace {
+
+// Room for the metadata of an image in each slot
+const std::size_t metadataCapacity = 8192;
+
+std::size_t AlignUp(std::size_t bytes)
+{
+   return (bytes + MMSHM_ALIGNMENT - 1) / MMSHM_ALIGNMENT * MMSHM_ALIGNMENT;
+}
+
+inline void Barrier()
+{
+#ifndef _WINDOWS
+   __sync_synchronize();
+#endif
+}
+
+} // anonymous namespace
+
+
+SharedMemoryExport::SharedMemoryExport(
+      boost::shared_ptr<TaskSet_CopyMemory> copier) :
+   copier_(copier),
+   sizeMB_(0),
+   mappedBytes_(0),
+   data_(0),
+   skippedImageCount_(0)
+{
+}
+
+SharedMemoryExport::~SharedMemoryExport()
+{
+   Close();
+}
+
+void SharedMemoryExport::Open(const std::string& name, unsigned sizeMB)
+   throw (CMMError)
+{
+   Close();
+
+#ifdef _WINDOWS
+   (void)name;
+   (void)sizeMB;
+   throw CMMError("Shared-memory export is not supported on this platform",
+         MMERR_InvalidContents);
+#else
+   const boost::uint64_t bytes = static_cast<boost::uint64_t>(sizeMB) << 20;
+   if (sizeMB == 0 || bytes > std::numeric_limits<std::size_t>::max())
+      throw CMMError("Invalid size of shared-memory export", MMERR_InvalidContents);
+   const std::size_t size = static_cast<std::size_t>(bytes);
+
+   std::string shmName = name;
+   if (shmName.empty() || shmName[0] != '/')
+      shmName = "/" + shmName;
+   if (shmName.size() < 2 || shmName.find('/', 1) != std::string::npos)
+      throw CMMError("Invalid shared-memory name " + name, MMERR_InvalidContents);
+
+   // A segment left over by a crashed process would otherwise make us fail;
+   // readers still mapping it keep their copy
+   shm_unlink(shmName.c_str());
+   int fd = shm_open(shmName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+   if (fd < 0)
+      throw CMMError("Cannot create shared memory " + shmName + ": " +
+            std::strerror(errno), MMERR_FileOpenFailed);
+   int err = ftruncate(fd, static_cast<off_t>(size)) == 0 ? 0 : errno;
+   void* view = MAP_FAILED;
+   if (err == 0)
+   {
+      view = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (view == MAP_FAILED)
+         err = errno;
+   }
+   close(fd);
+   if (err != 0)
+   {
+      shm_unlink(shmName.c_str());
+      throw CMMError("Cannot allocate shared memory " + shmName + ": " +
+            std::strerror(err), MMERR_OutOfMemory);
+   }
+
+   data_ = static_cast<unsigned char*>(view);
+   mappedBytes_ = size;
+   name_ = shmName;
+   sizeMB_ = sizeMB;
+   skippedImageCount_ = 0;
+
+   // The new pages are zero-filled, so only the header needs setting
+   MMShmHeader* header = Header();
+   header->magic = MMSHM_MAGIC;
+   header->version = MMSHM_VERSION;
+   header->segmentBytes = size;
+   header->writerPid = static_cast<boost::uint32_t>(getpid());
+   header->slotsOffset = AlignUp(sizeof(MMShmHeader));
+   header->metadataCapacity = metadataCapacity;
+#endif
+}
+
+void SharedMemoryExport::Close()
+{
+   if (!data_)
+      return;
+#ifndef _WINDOWS
+   munmap(data_, mappedBytes_);
+   shm_unlink(name_.c_str());
+#endif
+   data_ = 0;
+   mappedBytes_ = 0;
+   name_.clear();
+   sizeMB_ = 0;
+}
+
+boost::uint64_t SharedMemoryExport::GetWrittenImageCount() const
+{
+   return data_ ? Header()->writeCount : 0;
+}
+
+MMShmHeader* SharedMemoryExport::Header() const
+{
+   return reinterpret_cast<MMShmHeader*>(data_);
+}
+
+MMShmSlotHeader* SharedMemoryExport::Slot(boost::uint64_t index) const
+{
+   const MMShmHeader* header = Header();
+   return reinterpret_cast<MMShmSlotHeader*>(data_ + header->slotsOffset +
+         static_cast<std::size_t>(index % header->slotCount) *
+         header->slotBytes);
+}
+
+void SharedMemoryExport::LayOut(std::size_t pixelBytes)
+{
+   MMShmHeader* header = Header();
+   const std::size_t slotBytes =
+      AlignUp(sizeof(MMShmSlotHeader) + metadataCapacity + pixelBytes);
+   const std::size_t available = mappedBytes_ - header->slotsOffset;
+
+   header->layoutSequence = header->layoutSequence + 1;
+   Barrier();
+   header->slotBytes = slotBytes;
+   header->pixelCapacity = pixelBytes;
+   header->slotCount = available / slotBytes;
+   for (boost::uint64_t i = 0; i < header->slotCount; ++i)
+      Slot(i)->sequence = 0;
+   Barrier();
+   header->layoutSequence = header->layoutSequence + 1;
+}
+
+boost::uint32_t SharedMemoryExport::SerializeMetadata(const Metadata& md,
+      unsigned char* dest, std::size_t capacity, boost::uint64_t& bytes)
+{
+   boost::uint32_t count = 0;
+   std::size_t offset = 0;
+   const std::vector<std::string> keys = md.GetKeys();
+   for (std::vector<std::string>::const_iterator it = keys.begin(),
+         end = keys.end(); it != end; ++it)
+   {
+      std::string value;
+      try
+      {
+         value = md.GetSingleTag(it->c_str()).GetValue();
+      }
+      catch (const MetadataKeyError&)
+      {
+         continue; // Array tag
+      }
+      const boost::uint32_t lengths[2] = {
+         static_cast<boost::uint32_t>(it->size()),
+         static_cast<boost::uint32_t>(value.size()) };
+      const std::size_t entryBytes = sizeof(lengths) + it->size() + value.size();
+      if (entryBytes > capacity - offset)
+         continue;
+      std::memcpy(dest + offset, lengths, sizeof(lengths));
+      std::memcpy(dest + offset + sizeof(lengths), it->data(), it->size());
+      std::memcpy(dest + offset + sizeof(lengths) + it->size(), value.data(),
+            value.size());
+      offset += entryBytes;
+      ++count;
+   }
+   bytes = offset;
+   return count;
+}
+
+bool SharedMemoryExport::WriteImage(const unsigned char* pixels,
+      std::size_t bytes, unsigned width, unsigned height, unsigned byteDepth,
+      unsigned nComponents, unsigned channel, const Metadata& md,
+      boost::uint64_t& imageNumber)
+{
+   if (!data_)
+      return false;
+   MMShmHeader* header = Header();
+   if (header->slotCount == 0 || header->pixelCapacity != bytes)
+      LayOut(bytes);
+   if (header->slotCount == 0)
+   {
+      ++skippedImageCount_;
+      return false;
+   }
+
+   const boost::uint64_t n = header->writeCount;
+   MMShmSlotHeader* slot = Slot(n);
+   slot->sequence = 2 * n + 1;
+   Barrier();
+
+   unsigned char* metadata = reinterpret_cast<unsigned char*>(slot) +
+      sizeof(MMShmSlotHeader);
+   slot->imageNumber = n;
+   slot->width = width;
+   slot->height = height;
+   slot->bytesPerPixel = byteDepth;
+   slot->numComponents = nComponents;
+   slot->channel = channel;
+   slot->metadataCount = SerializeMetadata(md, metadata, metadataCapacity,
+         slot->metadataBytes);
+   slot->pixelBytes = bytes;
+   copier_->MemCopy(metadata + metadataCapacity, pixels, bytes);
+
+   Barrier();
+   slot->sequence = 2 * n + 2;
+   header->writeCount = n + 1;
+   imageNumber = n;
+   return true;
+}
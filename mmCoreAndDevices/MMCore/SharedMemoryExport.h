@@ -0,0 +1,98 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          SharedMemoryExport.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Export of inserted images to POSIX shared memory.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+
+#pragma once
+
+#include "Error.h"
+
+#include "../MMDevice/ImageMetadata.h"
+
+#include <boost/cstdint.hpp>
+#include <boost/smart_ptr/shared_ptr.hpp>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct MMShmHeader;
+struct MMShmSlotHeader;
+class TaskSet_CopyMemory;
+
+/// Publishes images in a named POSIX shared-memory segment.
+/**
+ * Each image written goes to the next slot of a ring in the segment, for
+ * other processes to read in place; see MMCoreShm/MMCoreShm.h for the layout
+ * and the reader library. The slots are laid out for the size of the
+ * images, and anew when it changes. The segment is removed when closed.
+ *
+ * Only single-valued metadata tags are exported. Not supported on Windows.
+ *
+ * Not thread-safe; the circular buffer writes images with its insert lock
+ * held.
+ */
+class SharedMemoryExport
+{
+public:
+   explicit SharedMemoryExport(boost::shared_ptr<TaskSet_CopyMemory> copier);
+   ~SharedMemoryExport();
+
+   // Creates the segment, replacing any segment of the same name
+   // Metadata tag holding the number (as used by the readers) of each image
+   // written, added to the images in the circular buffer
+   static const char* const ImageNumberTag;
+
+   void Open(const std::string& name, unsigned sizeMB) throw (CMMError);
+   void Close();
+   bool IsOpen() const { return data_ != 0; }
+   const std::string& GetName() const { return name_; }
+   unsigned GetSizeMB() const { return sizeMB_; }
+
+   // Returns false, leaving imageNumber unchanged, if the image is larger
+   // than the segment
+   bool WriteImage(const unsigned char* pixels, std::size_t bytes,
+         unsigned width, unsigned height, unsigned byteDepth,
+         unsigned nComponents, unsigned channel, const Metadata& md,
+         boost::uint64_t& imageNumber);
+
+   // Since opened
+   boost::uint64_t GetWrittenImageCount() const;
+   // Images larger than the segment
+   boost::uint64_t GetSkippedImageCount() const { return skippedImageCount_; }
+
+private:
+   SharedMemoryExport(const SharedMemoryExport&);
+   SharedMemoryExport& operator=(const SharedMemoryExport&);
+
+   MMShmHeader* Header() const;
+   MMShmSlotHeader* Slot(boost::uint64_t index) const;
+   void LayOut(std::size_t pixelBytes);
+   boost::uint32_t SerializeMetadata(const Metadata& md, unsigned char* dest,
+         std::size_t capacity, boost::uint64_t& bytes);
+
+   boost::shared_ptr<TaskSet_CopyMemory> copier_;
+   std::string name_;
+   unsigned sizeMB_;
+   std::size_t mappedBytes_;
+   unsigned char* data_;
+   boost::uint64_t skippedImageCount_;
+};
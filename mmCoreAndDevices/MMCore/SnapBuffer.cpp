@@ -0,0 +1,87 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          SnapBuffer.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Small ring of image slots used by the pipelined snap mode.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "SnapBuffer.h"
+
+#include "TaskSet_CopyMemory.h"
+
+#include <boost/make_shared.hpp>
+
+#include <algorithm>
+
+
+SnapBuffer::SnapBuffer(unsigned slotCount,
+      boost::shared_ptr<ThreadPool> threadPool) :
+   slotCount_(std::max(1u, slotCount)),
+   nextSlot_(0),
+   tasksMemCopy_(boost::make_shared<TaskSet_CopyMemory>(threadPool))
+{
+   for (unsigned i = 0; i < slotCount_; ++i)
+      slots_.push_back(boost::make_shared<Slot>());
+}
+
+SnapBuffer::~SnapBuffer()
+{
+}
+
+void SnapBuffer::SetSlotCount(unsigned slotCount)
+{
+   MMThreadGuard guard(lock_);
+   slotCount_ = std::max(1u, slotCount);
+}
+
+unsigned SnapBuffer::GetSlotCount() const
+{
+   MMThreadGuard guard(lock_);
+   return slotCount_;
+}
+
+void SnapBuffer::BeginSnap()
+{
+   MMThreadGuard guard(lock_);
+   if (slots_.size() == slotCount_)
+      return;
+
+   // Images handed out from removed slots were valid until now
+   if (slots_.size() > slotCount_)
+      slots_.resize(slotCount_);
+   while (slots_.size() < slotCount_)
+      slots_.push_back(boost::make_shared<Slot>());
+   if (nextSlot_ >= slots_.size())
+      nextSlot_ = 0;
+}
+
+unsigned char* SnapBuffer::Store(const unsigned char* pixels, std::size_t bytes)
+{
+   if (!pixels || bytes == 0)
+      return 0;
+
+   MMThreadGuard guard(lock_);
+   Slot& slot = *slots_[nextSlot_];
+   nextSlot_ = (nextSlot_ + 1) % slots_.size();
+
+   // Slots keep their allocation across snaps of the same size
+   if (slot.size() != bytes)
+      slot.resize(bytes);
+   tasksMemCopy_->MemCopy(&slot[0], pixels, bytes);
+   return &slot[0];
+}
@@ -0,0 +1,75 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          SnapBuffer.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Small ring of image slots used by the pipelined snap mode.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "../MMDevice/DeviceThreads.h"
+
+#include <boost/smart_ptr/shared_ptr.hpp>
+
+#include <cstddef>
+#include <vector>
+
+class ThreadPool;
+class TaskSet_CopyMemory;
+
+/// Round-robin set of buffers holding snapped images.
+/**
+ * In pipelined snap mode, getImage() copies the camera's image into the next
+ * slot of this buffer and runs the image processor on the copy, rather than
+ * on the camera's own buffer. A pointer handed out by Store() therefore stays
+ * valid until the slot count of further images have been stored, which lets
+ * the caller keep processing one image while the next snap is in progress.
+ *
+ * A new slot count takes effect only when the next snap begins, so that
+ * slots removed by it stay valid until then.
+ */
+class SnapBuffer
+{
+public:
+   SnapBuffer(unsigned slotCount, boost::shared_ptr<ThreadPool> threadPool);
+   ~SnapBuffer();
+
+   // Takes effect at the next BeginSnap()
+   void SetSlotCount(unsigned slotCount);
+   unsigned GetSlotCount() const;
+
+   // Called before the camera snaps, with no image being stored
+   void BeginSnap();
+
+   // Copy the image to the next slot and return a pointer to the copy
+   unsigned char* Store(const unsigned char* pixels, std::size_t bytes);
+
+private:
+   SnapBuffer(const SnapBuffer&);
+   SnapBuffer& operator=(const SnapBuffer&);
+
+   typedef std::vector<unsigned char> Slot;
+
+   mutable MMThreadLock lock_;
+   // Held by pointer so that adding slots does not move the others
+   std::vector< boost::shared_ptr<Slot> > slots_;
+   unsigned slotCount_; // Requested; applied by BeginSnap()
+   unsigned nextSlot_;
+
+   boost::shared_ptr<TaskSet_CopyMemory> tasksMemCopy_;
+};
@@ -0,0 +1,199 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          SpillFile.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Memory-mapped overflow tier of the circular buffer.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "SpillFile.h"
+
+#include "ErrorCodes.h"
+
+#include <cerrno>
+#include <cstring>
+#include <limits>
+
+#ifdef _WINDOWS
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+
+SpillFile::SpillFile() :
+   sizeMB_(0),
+   mappedBytes_(0),
+   data_(0),
+#ifdef _WINDOWS
+   fileHandle_(INVALID_HANDLE_VALUE),
+   mappingHandle_(0),
+#endif
+   channelBytes_(0),
+   slotBytes_(0),
+   slotCount_(0),
+   frontSlot_(0)
+{
+}
+
+SpillFile::~SpillFile()
+{
+   Close();
+}
+
+void SpillFile::Open(const std::string& path, unsigned sizeMB) throw (CMMError)
+{
+   Close();
+
+   const boost::uint64_t bytes = static_cast<boost::uint64_t>(sizeMB) << 20;
+   if (sizeMB == 0 || bytes > std::numeric_limits<std::size_t>::max())
+      throw CMMError("Invalid size of buffer spill file", MMERR_InvalidContents);
+   const std::size_t size = static_cast<std::size_t>(bytes);
+
+#ifdef _WINDOWS
+   // Deleted by the system when the last handle is closed
+   HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0,
+         NULL, CREATE_ALWAYS,
+         FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+   if (file == INVALID_HANDLE_VALUE)
+      throw CMMError("Cannot create buffer spill file " + path,
+            MMERR_FileOpenFailed);
+   HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE,
+         static_cast<DWORD>(bytes >> 32), static_cast<DWORD>(bytes), NULL);
+   void* view = mapping ?
+      MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size) : NULL;
+   if (!view)
+   {
+      if (mapping)
+         CloseHandle(mapping);
+      CloseHandle(file);
+      throw CMMError("Cannot map buffer spill file " + path,
+            MMERR_OutOfMemory);
+   }
+   fileHandle_ = file;
+   mappingHandle_ = mapping;
+#else
+   int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+   if (fd < 0)
+      throw CMMError("Cannot create buffer spill file " + path + ": " +
+            std::strerror(errno), MMERR_FileOpenFailed);
+   // Reserve the blocks now, so that running out of disk space is reported
+   // here and not as a fault while writing frames
+   int err = ftruncate(fd, static_cast<off_t>(size)) == 0 ? 0 : errno;
+#if defined(__linux__)
+   if (err == 0)
+      err = posix_fallocate(fd, 0, static_cast<off_t>(size));
+#endif
+   void* view = MAP_FAILED;
+   if (err == 0)
+   {
+      view = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (view == MAP_FAILED)
+         err = errno;
+   }
+   // The mapping keeps the file alive; unlinking now also removes it if we
+   // crash
+   close(fd);
+   unlink(path.c_str());
+   if (err != 0)
+      throw CMMError("Cannot allocate buffer spill file " + path + ": " +
+            std::strerror(err), MMERR_OutOfMemory);
+#endif
+
+   data_ = static_cast<unsigned char*>(view);
+   mappedBytes_ = size;
+   path_ = path;
+   sizeMB_ = sizeMB;
+   Reset(channelBytes_, channelBytes_ > 0 ?
+         static_cast<unsigned>(slotBytes_ / channelBytes_) : 0, 1);
+}
+
+void SpillFile::Close()
+{
+   frames_.clear();
+   slotCount_ = 0;
+   if (!data_)
+      return;
+#ifdef _WINDOWS
+   UnmapViewOfFile(data_);
+   CloseHandle(mappingHandle_);
+   CloseHandle(fileHandle_);
+   mappingHandle_ = 0;
+   fileHandle_ = INVALID_HANDLE_VALUE;
+#else
+   munmap(data_, mappedBytes_);
+#endif
+   data_ = 0;
+   mappedBytes_ = 0;
+   path_.clear();
+   sizeMB_ = 0;
+}
+
+void SpillFile::Reset(std::size_t channelBytes, unsigned maxChannels,
+      unsigned /* elementBytes */)
+{
+   frames_.clear();
+   frontSlot_ = 0;
+   channelBytes_ = channelBytes;
+   slotBytes_ = channelBytes * maxChannels;
+   slotCount_ = (data_ && slotBytes_ > 0) ? mappedBytes_ / slotBytes_ : 0;
+}
+
+unsigned char* SpillFile::Slot(std::size_t index) const
+{
+   return data_ + ((frontSlot_ + index) % slotCount_) * slotBytes_;
+}
+
+unsigned char* SpillFile::GetBackSlot()
+{
+   if (IsFull())
+      return 0;
+   return Slot(frames_.size());
+}
+
+void SpillFile::Push(const std::vector<Metadata>& channelMetadata)
+{
+   frames_.push_back(channelMetadata);
+}
+
+const std::vector<Metadata>& SpillFile::GetMetadata(std::size_t index) const
+{
+   return frames_[index];
+}
+
+const unsigned char* SpillFile::GetFrame(std::size_t index) const
+{
+   return Slot(index);
+}
+
+void SpillFile::ReadChannel(const unsigned char* frame,
+      unsigned /* channels */, unsigned channel, unsigned char* dest) const
+{
+   memcpy(dest, frame + channel * channelBytes_, channelBytes_);
+}
+
+void SpillFile::Pop()
+{
+   if (frames_.empty())
+      return;
+   frames_.pop_front();
+   frontSlot_ = (frontSlot_ + 1) % slotCount_;
+}
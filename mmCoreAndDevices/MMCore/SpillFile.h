@@ -0,0 +1,95 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          SpillFile.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Memory-mapped overflow tier of the circular buffer.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "Error.h"
+#include "FrameTier.h"
+
+#include "../MMDevice/ImageMetadata.h"
+
+#include <boost/cstdint.hpp>
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+
+/// A FIFO of frames held in a preallocated memory-mapped file.
+/**
+ * Used by the circular buffer to hold frames that do not fit in RAM. The
+ * file is created when opened and is deleted when closed (or when the
+ * process exits). Frames occupy fixed-size slots, used in a ring; the pixels
+ * of channel c start at c times the channel size in the slot. Metadata is
+ * kept in memory.
+ *
+ * Not thread-safe; the circular buffer serializes access (see FrameTier).
+ */
+class SpillFile : public FrameTier
+{
+public:
+   SpillFile();
+   ~SpillFile();
+
+   // Creates the file, reserves sizeMB on disk and maps it
+   void Open(const std::string& path, unsigned sizeMB) throw (CMMError);
+   void Close();
+   bool IsOpen() const { return data_ != 0; }
+   const std::string& GetPath() const { return path_; }
+   unsigned GetSizeMB() const { return sizeMB_; }
+
+   // Divides the file into slots of the frame size
+   virtual void Reset(std::size_t channelBytes, unsigned maxChannels,
+         unsigned elementBytes);
+   virtual std::size_t GetCapacity() const { return slotCount_; }
+   virtual std::size_t GetCount() const { return frames_.size(); }
+   virtual bool IsFull() const { return frames_.size() >= slotCount_; }
+
+   virtual unsigned char* GetBackSlot();
+   virtual void Push(const std::vector<Metadata>& channelMetadata);
+   virtual const std::vector<Metadata>& GetMetadata(std::size_t index) const;
+   virtual const unsigned char* GetFrame(std::size_t index) const;
+   virtual void ReadChannel(const unsigned char* frame, unsigned channels,
+         unsigned channel, unsigned char* dest) const;
+   virtual void Pop();
+
+private:
+   SpillFile(const SpillFile&);
+   SpillFile& operator=(const SpillFile&);
+
+   unsigned char* Slot(std::size_t index) const;
+
+   std::string path_;
+   unsigned sizeMB_;
+   std::size_t mappedBytes_;
+   unsigned char* data_;
+#ifdef _WINDOWS
+   void* fileHandle_;
+   void* mappingHandle_;
+#endif
+
+   std::size_t channelBytes_;
+   std::size_t slotBytes_;
+   std::size_t slotCount_;
+   std::size_t frontSlot_;
+   std::deque< std::vector<Metadata> > frames_;
+};
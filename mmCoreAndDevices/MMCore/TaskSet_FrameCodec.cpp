@@ -0,0 +1,128 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          TaskSet_FrameCodec.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Task set for parallelized frame compression and decompression.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+
+#include "TaskSet_FrameCodec.h"
+
+#include "FrameCodec.h"
+
+#include <boost/foreach.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+TaskSet_FrameCodec::ATask::ATask(boost::shared_ptr<Semaphore> semDone, size_t taskIndex, size_t totalTaskCount)
+    : Task(semDone, taskIndex, totalTaskCount),
+    compress_(false),
+    blocks_(NULL),
+    elementBytes_(1)
+{
+}
+
+void TaskSet_FrameCodec::ATask::SetUp(bool compress, std::vector<Block>* blocks, unsigned elementBytes, size_t usedTaskCount)
+{
+    compress_ = compress;
+    blocks_ = blocks;
+    elementBytes_ = elementBytes;
+    usedTaskCount_ = usedTaskCount;
+}
+
+void TaskSet_FrameCodec::ATask::Execute()
+{
+    if (taskIndex_ >= usedTaskCount_)
+        return;
+
+    // Blocks are interleaved between tasks
+    for (size_t i = taskIndex_; i < blocks_->size(); i += usedTaskCount_)
+    {
+        Block& block = (*blocks_)[i];
+        if (compress_)
+        {
+            const unsigned char* src = block.src;
+            if (elementBytes_ > 1)
+            {
+                shuffled_.resize(std::max(shuffled_.size(), block.srcBytes));
+                FrameCodec::Shuffle(&shuffled_[0], block.src, block.srcBytes, elementBytes_);
+                src = &shuffled_[0];
+            }
+            block.dstBytes = FrameCodec::Compress(block.dst, block.dstBytes, src, block.srcBytes);
+            block.raw = (block.dstBytes == 0);
+        }
+        else if (block.raw)
+        {
+            memcpy(block.dst, block.src, block.dstBytes);
+        }
+        else
+        {
+            unsigned char* dst = block.dst;
+            if (elementBytes_ > 1)
+            {
+                shuffled_.resize(std::max(shuffled_.size(), block.dstBytes));
+                dst = &shuffled_[0];
+            }
+            const bool ok = FrameCodec::Decompress(dst, block.dstBytes, block.src, block.srcBytes);
+            assert(ok);
+            if (!ok)
+                memset(dst, 0, block.dstBytes);
+            if (elementBytes_ > 1)
+                FrameCodec::Unshuffle(block.dst, dst, block.dstBytes, elementBytes_);
+        }
+    }
+}
+
+TaskSet_FrameCodec::TaskSet_FrameCodec(boost::shared_ptr<ThreadPool> pool)
+    : TaskSet(pool)
+{
+    CreateTasks<ATask>();
+}
+
+void TaskSet_FrameCodec::Compress(std::vector<Block>& blocks, unsigned elementBytes)
+{
+    Run(true, blocks, elementBytes);
+}
+
+void TaskSet_FrameCodec::Decompress(std::vector<Block>& blocks, unsigned elementBytes)
+{
+    Run(false, blocks, elementBytes);
+}
+
+void TaskSet_FrameCodec::Run(bool compress, std::vector<Block>& blocks, unsigned elementBytes)
+{
+    if (blocks.empty())
+        return;
+    assert(!tasks_.empty());
+
+    usedTaskCount_ = std::min(blocks.size(), tasks_.size());
+    BOOST_FOREACH(Task* task, tasks_)
+        static_cast<ATask*>(task)->SetUp(compress, &blocks, elementBytes, usedTaskCount_);
+
+    // A single block is processed without threading
+    if (usedTaskCount_ == 1)
+    {
+        tasks_[0]->Execute();
+        return;
+    }
+
+    Execute();
+    Wait();
+}
@@ -0,0 +1,76 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          TaskSet_FrameCodec.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Task set for parallelized frame compression and decompression.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+
+#pragma once
+
+#include "TaskSet.h"
+
+#include <vector>
+
+// Compresses or decompresses blocks of pixel data with FrameCodec. Each task
+// has its own scratch buffer, so a task set must not be used by two threads
+// at once.
+class TaskSet_FrameCodec : public TaskSet
+{
+public:
+    struct Block
+    {
+        const unsigned char* src;
+        size_t srcBytes;
+        unsigned char* dst;
+        // Compression: the capacity of dst, set to the compressed size.
+        // Decompression: the uncompressed size.
+        size_t dstBytes;
+        // Compression: set if the block does not fit in dst compressed.
+        // Decompression: the block is copied unchanged.
+        bool raw;
+    };
+
+private:
+    class ATask : public Task
+    {
+    public:
+        explicit ATask(boost::shared_ptr<Semaphore> semDone, size_t taskIndex, size_t totalTaskCount);
+
+        void SetUp(bool compress, std::vector<Block>* blocks, unsigned elementBytes, size_t usedTaskCount);
+
+        virtual void Execute()/* override*/;
+
+    private:
+        bool compress_;
+        std::vector<Block>* blocks_;
+        unsigned elementBytes_;
+        std::vector<unsigned char> shuffled_;
+    };
+
+public:
+    explicit TaskSet_FrameCodec(boost::shared_ptr<ThreadPool> pool);
+
+    // Byte-shuffles and compresses each block
+    void Compress(std::vector<Block>& blocks, unsigned elementBytes);
+    // Decompresses and unshuffles each block
+    void Decompress(std::vector<Block>& blocks, unsigned elementBytes);
+
+private:
+    void Run(bool compress, std::vector<Block>& blocks, unsigned elementBytes);
+};
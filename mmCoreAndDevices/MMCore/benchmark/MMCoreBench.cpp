@@ -0,0 +1,494 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          MMCoreBench.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Microbenchmarks of the core, with JSON output.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+
+
+// Measures, for tracking performance across releases:
+// - circular buffer insert and pop rates, for several frame sizes;
+// - construction of image metadata;
+// - getSystemStateCache() and getSystemState();
+// - setConfig() on a group with many settings;
+// - fan-out of property changes notified by a device (OnPropertyChanged())
+//   to the state cache and the application's callback;
+// - logging throughput;
+// - loading a configuration file.
+//
+// The device benchmarks use the DemoCamera adapter, and are skipped if it is
+// not found. The SequenceTester adapter is used, if found, for the devices of
+// the large configuration group. Results are written as JSON.
+//
+// Usage: MMCoreBench [-s seconds] [-a adapterDir]... [-o output.json]
+
+#include "../CircularBuffer.h"
+#include "../CoreClock.h"
+#include "../MMCore.h"
+#include "../MMEventCallback.h"
+#include "../../MMDevice/ImageMetadata.h"
+
+#include <boost/lexical_cast.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+
+namespace {
+
+// Number of state devices in the large configuration group
+const unsigned largeGroupDeviceCount = 32;
+
+double SecondsSince(unsigned long long startNs)
+{
+   return (mm::CoreClock::MonotonicNs() - startNs) / 1e9;
+}
+
+std::string TempPath(const std::string& name)
+{
+   return "/tmp/MMCoreBench-" + boost::lexical_cast<std::string>(getpid()) +
+      "-" + name;
+}
+
+
+// One benchmark's parameters and measured values, written as a JSON object
+class Result
+{
+   std::string name_;
+   std::vector<std::pair<std::string, std::string> > fields_;
+
+public:
+   explicit Result(const std::string& name) : name_(name) {}
+
+   Result& Set(const std::string& key, double value)
+   {
+      char s[32];
+      std::sprintf(s, "%.6g", value);
+      fields_.push_back(std::make_pair(key, std::string(s)));
+      return *this;
+   }
+
+   Result& SetString(const std::string& key, const std::string& value)
+   {
+      fields_.push_back(std::make_pair(key, Quoted(value)));
+      return *this;
+   }
+
+   std::string ToJSON() const
+   {
+      std::string json = "{\"name\": " + Quoted(name_);
+      for (std::size_t i = 0; i < fields_.size(); ++i)
+         json += ", " + Quoted(fields_[i].first) + ": " + fields_[i].second;
+      return json + "}";
+   }
+
+   static std::string Quoted(const std::string& s)
+   {
+      std::string quoted = "\"";
+      for (std::string::const_iterator it = s.begin(); it != s.end(); ++it)
+      {
+         if (*it == '"' || *it == '\\')
+            quoted += '\\';
+         if (static_cast<unsigned char>(*it) >= 0x20)
+            quoted += *it;
+      }
+      return quoted + "\"";
+   }
+};
+
+
+void BenchmarkCircularBuffer(std::vector<Result>& results, unsigned width,
+      unsigned height, double seconds)
+{
+   const unsigned byteDepth = 2;
+   CircularBuffer buffer(512);
+   if (!buffer.Initialize(1, width, height, byteDepth))
+      throw CMMError("Cannot initialize circular buffer");
+   const unsigned long capacity = buffer.GetSize();
+
+   std::vector<unsigned char> pixels(width * height * byteDepth, 42);
+   Metadata md;
+   md.put("Camera", "Camera");
+
+   unsigned long long insertNs = 0, popNs = 0;
+   unsigned long inserted = 0, popped = 0;
+   const unsigned long long start = mm::CoreClock::MonotonicNs();
+   while (SecondsSince(start) < seconds)
+   {
+      // Fill the buffer, then empty it
+      unsigned long long t0 = mm::CoreClock::MonotonicNs();
+      for (unsigned long i = 0; i + 1 < capacity; ++i)
+      {
+         if (!buffer.InsertImage(&pixels[0], width, height, byteDepth, &md))
+            throw CMMError("Circular buffer insert failed");
+      }
+      unsigned long long t1 = mm::CoreClock::MonotonicNs();
+      unsigned long n = 0;
+      while (buffer.GetNextImageBuffer(0))
+         ++n;
+      unsigned long long t2 = mm::CoreClock::MonotonicNs();
+
+      insertNs += t1 - t0;
+      popNs += t2 - t1;
+      inserted += capacity - 1;
+      popped += n;
+   }
+
+   const double frameMB = pixels.size() / 1048576.0;
+   const double insertRate = inserted / (insertNs / 1e9);
+   const double popRate = popped / (popNs / 1e9);
+   results.push_back(Result("circularBufferInsert").
+         Set("width", width).Set("height", height).
+         Set("bytesPerPixel", byteDepth).
+         Set("framesPerSecond", insertRate).
+         Set("megabytesPerSecond", insertRate * frameMB));
+   results.push_back(Result("circularBufferPop").
+         Set("width", width).Set("height", height).
+         Set("bytesPerPixel", byteDepth).
+         Set("framesPerSecond", popRate));
+}
+
+
+void BenchmarkMetadata(std::vector<Result>& results, double seconds)
+{
+   // Tags similar to those added by a camera and the core to each image
+   unsigned long count = 0;
+   const unsigned long long start = mm::CoreClock::MonotonicNs();
+   while (SecondsSince(start) < seconds)
+   {
+      for (unsigned i = 0; i < 1000; ++i)
+      {
+         Metadata md;
+         md.put("Camera", "Camera");
+         md.put("ImageNumber", boost::lexical_cast<std::string>(count + i).c_str());
+         md.put("ElapsedTime-ms", "123.456");
+         md.put("TimeReceivedByCore", "2021-01-01 00:00:00.000000");
+         md.put("Width", "2048");
+         md.put("Height", "2048");
+         md.put("PixelType", "GRAY16");
+         md.put("Binning", "1");
+         md.put("ROI-X-start", "0");
+         md.put("ROI-Y-start", "0");
+         md.put("Exposure-ms", "10.0000");
+         md.put("Camera-Binning", "1");
+         md.put("Camera-Exposure", "10.0000");
+         md.put("Camera-PixelType", "16bit");
+         Metadata copy(md);
+         if (copy.GetKeys().size() != 14)
+            throw CMMError("Unexpected metadata size");
+      }
+      count += 1000;
+   }
+   results.push_back(Result("metadataConstruction").
+         Set("tags", 14).
+         Set("perSecond", count / SecondsSince(start)));
+}
+
+
+void BenchmarkLogging(std::vector<Result>& results, double seconds)
+{
+   const std::string logFile = TempPath("CoreLog.txt");
+   {
+      CMMCore core;
+      core.enableStderrLog(false);
+      core.setPrimaryLogFile(logFile.c_str(), true);
+
+      for (int debug = 0; debug < 2; ++debug)
+      {
+         // Debug messages are filtered out while debug logging is disabled
+         core.enableDebugLog(false);
+         unsigned long count = 0;
+         const unsigned long long start = mm::CoreClock::MonotonicNs();
+         while (SecondsSince(start) < seconds)
+         {
+            for (unsigned i = 0; i < 1000; ++i)
+               core.logMessage("MMCoreBench log message of typical length",
+                     debug != 0);
+            count += 1000;
+         }
+         results.push_back(Result("logMessage").
+               SetString("level", debug ? "debug (filtered)" : "info").
+               Set("perSecond", count / SecondsSince(start)));
+      }
+   }
+   std::remove(logFile.c_str());
+}
+
+
+class PropertyChangeCounter : public MMEventCallback
+{
+public:
+   PropertyChangeCounter() : count(0) {}
+   virtual void onPropertyChanged(const char*, const char*, const char*)
+   { ++count; }
+
+   unsigned long count;
+};
+
+
+// The state devices of the large group are SequenceTester switchers if the
+// adapter is available, and DemoCamera filter wheels otherwise
+void WriteConfigFile(const std::string& path, bool useSequenceTester)
+{
+   std::ofstream cfg(path.c_str());
+   cfg << "# Generated by MMCoreBench\n";
+   if (useSequenceTester)
+      cfg << "Device,THub,SequenceTester,THub\n";
+   for (unsigned i = 1; i <= largeGroupDeviceCount; ++i)
+   {
+      if (useSequenceTester)
+         cfg << "Device,Switcher" << i << ",SequenceTester,TSwitcher" << i << "\n";
+      else
+         cfg << "Device,Switcher" << i << ",DemoCamera,DWheel\n";
+   }
+   cfg << "Device,Camera,DemoCamera,DCam\n"
+      "Device,Objective,DemoCamera,DObjective\n"
+      "Device,Z,DemoCamera,DStage\n"
+      "Device,XY,DemoCamera,DXYStage\n"
+      "Device,Shutter,DemoCamera,DShutter\n";
+   if (useSequenceTester)
+   {
+      for (unsigned i = 1; i <= largeGroupDeviceCount; ++i)
+         cfg << "Parent,Switcher" << i << ",THub\n";
+   }
+   cfg << "Property,Core,Initialize,1\n";
+   for (unsigned i = 1; i <= largeGroupDeviceCount; ++i)
+   {
+      cfg << "ConfigGroup,Large,A,Switcher" << i << ",State,0\n";
+      cfg << "ConfigGroup,Large,B,Switcher" << i << ",State,1\n";
+   }
+   cfg << "Property,Core,Camera,Camera\n"
+      "Property,Core,Shutter,Shutter\n"
+      "Property,Core,Focus,Z\n"
+      "Property,Core,XYStage,XY\n";
+   if (!cfg)
+      throw CMMError("Cannot write " + path);
+}
+
+
+void BenchmarkConfigLoad(std::vector<Result>& results, CMMCore& core,
+      const std::string& cfgFile, double seconds)
+{
+   unsigned loads = 0;
+   double totalMs = 0.0, minMs = 0.0;
+   const unsigned long long start = mm::CoreClock::MonotonicNs();
+   while (loads < 3 || SecondsSince(start) < seconds)
+   {
+      core.unloadAllDevices();
+      const unsigned long long t0 = mm::CoreClock::MonotonicNs();
+      core.loadSystemConfiguration(cfgFile.c_str());
+      const double ms = (mm::CoreClock::MonotonicNs() - t0) / 1e6;
+      totalMs += ms;
+      if (loads == 0 || ms < minMs)
+         minMs = ms;
+      ++loads;
+   }
+   results.push_back(Result("loadSystemConfiguration").
+         Set("devices", core.getLoadedDevices().size()).
+         Set("meanMs", totalMs / loads).
+         Set("minMs", minMs));
+}
+
+
+void BenchmarkStateCache(std::vector<Result>& results, CMMCore& core,
+      double seconds)
+{
+   const std::size_t properties = core.getSystemStateCache().size();
+
+   unsigned long count = 0;
+   unsigned long long start = mm::CoreClock::MonotonicNs();
+   while (SecondsSince(start) < seconds)
+   {
+      core.getSystemStateCache();
+      ++count;
+   }
+   results.push_back(Result("getSystemStateCache").
+         Set("properties", properties).
+         Set("perSecond", count / SecondsSince(start)));
+
+   count = 0;
+   start = mm::CoreClock::MonotonicNs();
+   while (SecondsSince(start) < seconds)
+   {
+      core.getSystemState();
+      ++count;
+   }
+   results.push_back(Result("getSystemState").
+         Set("properties", properties).
+         Set("perSecond", count / SecondsSince(start)));
+}
+
+
+void BenchmarkSetConfig(std::vector<Result>& results, CMMCore& core,
+      const std::string& stateAdapter, double seconds)
+{
+   unsigned long count = 0;
+   const unsigned long long start = mm::CoreClock::MonotonicNs();
+   while (SecondsSince(start) < seconds)
+   {
+      core.setConfig("Large", (count % 2) ? "B" : "A");
+      ++count;
+   }
+   results.push_back(Result("setConfig").
+         SetString("adapter", stateAdapter).
+         Set("settings", core.getConfigData("Large", "A").size()).
+         Set("perSecond", count / SecondsSince(start)));
+}
+
+
+void BenchmarkPropertyChangeFanOut(std::vector<Result>& results,
+      CMMCore& core, double seconds)
+{
+   // The demo objective turret notifies the core of the changes of its
+   // State and Label properties when its State is set
+   PropertyChangeCounter counter;
+   core.registerCallback(&counter);
+   unsigned long count = 0;
+   const unsigned long long start = mm::CoreClock::MonotonicNs();
+   while (SecondsSince(start) < seconds)
+   {
+      core.setProperty("Objective", "State", (count % 2) ? "1" : "0");
+      ++count;
+   }
+   const double elapsed = SecondsSince(start);
+   core.registerCallback(0);
+   results.push_back(Result("onPropertyChangedFanOut").
+         Set("setPropertyPerSecond", count / elapsed).
+         Set("notificationsPerSecond", counter.count / elapsed));
+}
+
+
+void WriteResults(std::FILE* out, CMMCore& core, double seconds,
+      const std::vector<Result>& results)
+{
+   std::fprintf(out, "{\n");
+   std::fprintf(out, "  \"coreVersion\": %s,\n",
+         Result::Quoted(core.getVersionInfo()).c_str());
+   std::fprintf(out, "  \"apiVersion\": %s,\n",
+         Result::Quoted(core.getAPIVersionInfo()).c_str());
+   std::fprintf(out, "  \"secondsPerBenchmark\": %g,\n", seconds);
+   std::fprintf(out, "  \"results\": [");
+   for (std::size_t i = 0; i < results.size(); ++i)
+      std::fprintf(out, "%s\n    %s", i ? "," : "",
+            results[i].ToJSON().c_str());
+   std::fprintf(out, "\n  ]\n}\n");
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char** argv)
+{
+   double seconds = 1.0;
+   std::vector<std::string> adapterDirs;
+   std::string outputFile;
+   int opt;
+   while ((opt = getopt(argc, argv, "s:a:o:")) != -1)
+   {
+      switch (opt)
+      {
+         case 's':
+            seconds = std::atof(optarg);
+            break;
+         case 'a':
+            adapterDirs.push_back(optarg);
+            break;
+         case 'o':
+            outputFile = optarg;
+            break;
+         default:
+            std::fprintf(stderr,
+                  "Usage: %s [-s seconds] [-a adapterDir]... [-o output.json]\n",
+                  argv[0]);
+            return 2;
+      }
+   }
+   if (seconds <= 0.0)
+      return 2;
+
+   std::vector<Result> results;
+   try
+   {
+      CMMCore core;
+      core.enableStderrLog(false);
+
+      BenchmarkCircularBuffer(results, 512, 512, seconds);
+      BenchmarkCircularBuffer(results, 2048, 2048, seconds);
+      BenchmarkCircularBuffer(results, 4096, 4096, seconds);
+      BenchmarkMetadata(results, seconds);
+      BenchmarkLogging(results, seconds);
+
+      core.setDeviceAdapterSearchPaths(adapterDirs);
+      const std::vector<std::string> adapters =
+         core.getDeviceAdapterNames();
+      if (std::find(adapters.begin(), adapters.end(), "DemoCamera") !=
+            adapters.end())
+      {
+         const bool useSequenceTester =
+            std::find(adapters.begin(), adapters.end(), "SequenceTester") !=
+               adapters.end();
+         const std::string cfgFile = TempPath("Large.cfg");
+         WriteConfigFile(cfgFile, useSequenceTester);
+         BenchmarkConfigLoad(results, core, cfgFile, seconds);
+         std::remove(cfgFile.c_str());
+         BenchmarkStateCache(results, core, seconds);
+         BenchmarkSetConfig(results, core,
+               useSequenceTester ? "SequenceTester" : "DemoCamera", seconds);
+         BenchmarkPropertyChangeFanOut(results, core, seconds);
+         core.unloadAllDevices();
+      }
+      else
+      {
+         std::fprintf(stderr,
+               "DemoCamera adapter not found; skipping device benchmarks\n");
+      }
+
+      std::FILE* out = stdout;
+      if (!outputFile.empty())
+      {
+         out = std::fopen(outputFile.c_str(), "w");
+         if (!out)
+         {
+            std::fprintf(stderr, "Cannot write %s\n", outputFile.c_str());
+            return 1;
+         }
+      }
+      WriteResults(out, core, seconds, results);
+      if (out != stdout)
+         std::fclose(out);
+   }
+   catch (const CMMError& e)
+   {
+      std::fprintf(stderr, "%s\n", e.getFullMsg().c_str());
+      return 1;
+   }
+   catch (const std::exception& e)
+   {
+      std::fprintf(stderr, "%s\n", e.what());
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,487 @@
+#include <gtest/gtest.h>
+
+#include "AcquisitionPlan.h"
+#include "MMCore.h"
+#include "MockDeviceAdapter.h"
+
+#include "../../MMDevice/DeviceBase.h"
+#include "../../MMDevice/ImageMetadata.h"
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+
+const char* const g_Camera = "TestCamera";
+const char* const g_Focus = "TestFocus";
+const char* const g_XYStage = "TestXYStage";
+
+// What the engine did to the devices, shared by the devices and the test
+struct DeviceLog
+{
+   boost::mutex mutex;
+   std::vector<std::string> calls;
+   std::vector<double> zSequence;
+   std::vector<double> xSequence;
+   long framesSnapped;
+
+   // Settings of the devices
+   long cameraFrameLimit; // Snapping fails after this many frames
+   double cameraFrameMs;
+   long sequenceMaxLength; // 0 if the stages cannot sequence
+   bool failZSequenceStart;
+
+   DeviceLog() :
+      framesSnapped(0),
+      cameraFrameLimit(-1),
+      cameraFrameMs(1.0),
+      sequenceMaxLength(100),
+      failZSequenceStart(false)
+   {}
+
+   void Record(const std::string& call)
+   {
+      boost::mutex::scoped_lock lock(mutex);
+      calls.push_back(call);
+   }
+
+   bool Called(const std::string& call)
+   {
+      boost::mutex::scoped_lock lock(mutex);
+      return std::find(calls.begin(), calls.end(), call) != calls.end();
+   }
+};
+
+
+class TestCamera : public CCameraBase<TestCamera>
+{
+public:
+   TestCamera(DeviceLog* log) : log_(log), exposureMs_(1.0)
+   { memset(pixels_, 0, sizeof(pixels_)); }
+
+   int Initialize() { return DEVICE_OK; }
+   int Shutdown() { return DEVICE_OK; }
+   void GetName(char* name) const
+   { CDeviceUtils::CopyLimitedString(name, g_Camera); }
+   bool Busy() { return false; }
+
+   int SnapImage()
+   {
+      long frames;
+      {
+         boost::mutex::scoped_lock lock(log_->mutex);
+         if (log_->cameraFrameLimit >= 0 &&
+               log_->framesSnapped >= log_->cameraFrameLimit)
+            return DEVICE_ERR;
+         frames = ++log_->framesSnapped;
+      }
+      pixels_[0] = static_cast<unsigned char>(frames);
+      boost::this_thread::sleep(boost::posix_time::microseconds(
+               static_cast<long>(log_->cameraFrameMs * 1000.0)));
+      return DEVICE_OK;
+   }
+   const unsigned char* GetImageBuffer() { return pixels_; }
+   long GetImageBufferSize() const { return sizeof(pixels_); }
+   unsigned GetImageWidth() const { return 4; }
+   unsigned GetImageHeight() const { return 4; }
+   unsigned GetImageBytesPerPixel() const { return 1; }
+   unsigned GetBitDepth() const { return 8; }
+   int GetBinning() const { return 1; }
+   int SetBinning(int) { return DEVICE_OK; }
+   void SetExposure(double exposureMs) { exposureMs_ = exposureMs; }
+   double GetExposure() const { return exposureMs_; }
+   int SetROI(unsigned, unsigned, unsigned, unsigned) { return DEVICE_OK; }
+   int GetROI(unsigned& x, unsigned& y, unsigned& xSize, unsigned& ySize)
+   {
+      x = y = 0;
+      xSize = GetImageWidth();
+      ySize = GetImageHeight();
+      return DEVICE_OK;
+   }
+   int ClearROI() { return DEVICE_OK; }
+   int IsExposureSequenceable(bool& isSequenceable) const
+   {
+      isSequenceable = false;
+      return DEVICE_OK;
+   }
+
+   int StartSequenceAcquisition(long numImages, double intervalMs,
+         bool stopOnOverflow)
+   {
+      log_->Record("StartSequenceAcquisition");
+      return CCameraBase<TestCamera>::StartSequenceAcquisition(numImages,
+            intervalMs, stopOnOverflow);
+   }
+
+private:
+   DeviceLog* log_;
+   double exposureMs_;
+   unsigned char pixels_[16];
+};
+
+
+class TestFocus : public CStageBase<TestFocus>
+{
+public:
+   TestFocus(DeviceLog* log) : log_(log), positionUm_(0.0) {}
+
+   int Initialize() { return DEVICE_OK; }
+   int Shutdown() { return DEVICE_OK; }
+   void GetName(char* name) const
+   { CDeviceUtils::CopyLimitedString(name, g_Focus); }
+   bool Busy() { return false; }
+
+   int SetPositionUm(double pos)
+   {
+      log_->Record("SetPositionUm");
+      positionUm_ = pos;
+      return DEVICE_OK;
+   }
+   int GetPositionUm(double& pos) { pos = positionUm_; return DEVICE_OK; }
+   int SetPositionSteps(long steps) { return SetPositionUm(0.1 * steps); }
+   int GetPositionSteps(long& steps)
+   {
+      steps = static_cast<long>(positionUm_ / 0.1);
+      return DEVICE_OK;
+   }
+   int SetOrigin() { return DEVICE_OK; }
+   int GetLimits(double& lower, double& upper)
+   {
+      lower = -1000.0;
+      upper = 1000.0;
+      return DEVICE_OK;
+   }
+   bool IsContinuousFocusDrive() const { return false; }
+
+   int IsStageSequenceable(bool& isSequenceable) const
+   {
+      isSequenceable = log_->sequenceMaxLength > 0;
+      return DEVICE_OK;
+   }
+   int GetStageSequenceMaxLength(long& nrEvents) const
+   {
+      nrEvents = log_->sequenceMaxLength;
+      return DEVICE_OK;
+   }
+   int ClearStageSequence()
+   {
+      boost::mutex::scoped_lock lock(log_->mutex);
+      log_->zSequence.clear();
+      return DEVICE_OK;
+   }
+   int AddToStageSequence(double position)
+   {
+      boost::mutex::scoped_lock lock(log_->mutex);
+      log_->zSequence.push_back(position);
+      return DEVICE_OK;
+   }
+   int SendStageSequence()
+   {
+      log_->Record("SendStageSequence");
+      return DEVICE_OK;
+   }
+   int StartStageSequence()
+   {
+      if (log_->failZSequenceStart)
+         return DEVICE_ERR;
+      log_->Record("StartStageSequence");
+      return DEVICE_OK;
+   }
+   int StopStageSequence()
+   {
+      log_->Record("StopStageSequence");
+      return DEVICE_OK;
+   }
+
+private:
+   DeviceLog* log_;
+   double positionUm_;
+};
+
+
+class TestXYStage : public CXYStageBase<TestXYStage>
+{
+public:
+   TestXYStage(DeviceLog* log) : log_(log), xSteps_(0), ySteps_(0) {}
+
+   int Initialize() { return DEVICE_OK; }
+   int Shutdown() { return DEVICE_OK; }
+   void GetName(char* name) const
+   { CDeviceUtils::CopyLimitedString(name, g_XYStage); }
+   bool Busy() { return false; }
+
+   int SetPositionSteps(long x, long y)
+   {
+      log_->Record("SetXYPositionSteps");
+      xSteps_ = x;
+      ySteps_ = y;
+      return DEVICE_OK;
+   }
+   int GetPositionSteps(long& x, long& y)
+   {
+      x = xSteps_;
+      y = ySteps_;
+      return DEVICE_OK;
+   }
+   int Home() { return DEVICE_OK; }
+   int Stop() { return DEVICE_OK; }
+   int SetOrigin() { return DEVICE_OK; }
+   int GetLimitsUm(double& xMin, double& xMax, double& yMin, double& yMax)
+   {
+      xMin = yMin = -1000.0;
+      xMax = yMax = 1000.0;
+      return DEVICE_OK;
+   }
+   int GetStepLimits(long& xMin, long& xMax, long& yMin, long& yMax)
+   {
+      xMin = yMin = -10000;
+      xMax = yMax = 10000;
+      return DEVICE_OK;
+   }
+   double GetStepSizeXUm() { return 0.1; }
+   double GetStepSizeYUm() { return 0.1; }
+
+   int IsXYStageSequenceable(bool& isSequenceable) const
+   {
+      isSequenceable = log_->sequenceMaxLength > 0;
+      return DEVICE_OK;
+   }
+   int GetXYStageSequenceMaxLength(long& nrEvents) const
+   {
+      nrEvents = log_->sequenceMaxLength;
+      return DEVICE_OK;
+   }
+   int ClearXYStageSequence()
+   {
+      boost::mutex::scoped_lock lock(log_->mutex);
+      log_->xSequence.clear();
+      return DEVICE_OK;
+   }
+   int AddToXYStageSequence(double positionX, double)
+   {
+      boost::mutex::scoped_lock lock(log_->mutex);
+      log_->xSequence.push_back(positionX);
+      return DEVICE_OK;
+   }
+   int SendXYStageSequence() { return DEVICE_OK; }
+   int StartXYStageSequence()
+   {
+      log_->Record("StartXYStageSequence");
+      return DEVICE_OK;
+   }
+   int StopXYStageSequence()
+   {
+      log_->Record("StopXYStageSequence");
+      return DEVICE_OK;
+   }
+
+private:
+   DeviceLog* log_;
+   long xSteps_;
+   long ySteps_;
+};
+
+
+class TestAdapter : public MockDeviceAdapter
+{
+public:
+   TestAdapter(DeviceLog* log) : log_(log) {}
+
+   void InitializeModuleData(RegisterDeviceFunc registerDevice)
+   {
+      registerDevice(g_Camera, MM::CameraDevice, "Test camera");
+      registerDevice(g_Focus, MM::StageDevice, "Test focus stage");
+      registerDevice(g_XYStage, MM::XYStageDevice, "Test XY stage");
+   }
+
+   MM::Device* CreateDevice(const char* name)
+   {
+      if (strcmp(name, g_Camera) == 0)
+         return new TestCamera(log_);
+      if (strcmp(name, g_Focus) == 0)
+         return new TestFocus(log_);
+      if (strcmp(name, g_XYStage) == 0)
+         return new TestXYStage(log_);
+      return 0;
+   }
+
+   void DeleteDevice(MM::Device* device) { delete device; }
+
+private:
+   DeviceLog* log_;
+};
+
+
+class AcquisitionEngineTests : public ::testing::Test
+{
+protected:
+   AcquisitionEngineTests() : adapter_(&log_) {}
+
+   virtual void SetUp()
+   {
+      core_.loadMockDeviceAdapter("TestAdapter", &adapter_);
+      core_.loadDevice("Camera", "TestAdapter", g_Camera);
+      core_.loadDevice("Focus", "TestAdapter", g_Focus);
+      core_.loadDevice("XY", "TestAdapter", g_XYStage);
+      core_.initializeAllDevices();
+      core_.setCameraDevice("Camera");
+      core_.setFocusDevice("Focus");
+      core_.setXYStageDevice("XY");
+   }
+
+   virtual void TearDown()
+   {
+      core_.stopPlannedAcquisition();
+      core_.unloadAllDevices();
+   }
+
+   void WaitForPlan()
+   {
+      for (int i = 0; i < 500 && core_.isPlannedAcquisitionRunning(); ++i)
+         boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+      ASSERT_FALSE(core_.isPlannedAcquisitionRunning());
+   }
+
+   static AcquisitionPlan SlicePlan(std::size_t positions, std::size_t slices)
+   {
+      AcquisitionPlan plan;
+      plan.setTimePoints(1, 0.0);
+      if (positions > 0)
+      {
+         std::vector<double> x, y;
+         for (std::size_t i = 0; i < positions; ++i)
+         {
+            x.push_back(10.0 * i);
+            y.push_back(0.0);
+         }
+         plan.setXYPositions(x, y);
+      }
+      std::vector<double> z;
+      for (std::size_t i = 0; i < slices; ++i)
+         z.push_back(1.0 * i);
+      plan.setZPositions(z);
+      return plan;
+   }
+
+   DeviceLog log_;
+   TestAdapter adapter_;
+   CMMCore core_;
+};
+
+} // anonymous namespace
+
+
+TEST_F(AcquisitionEngineTests, SequencedSlicesAreArmedStartedAndStopped)
+{
+   core_.startPlannedAcquisition(SlicePlan(0, 5));
+   WaitForPlan();
+
+   EXPECT_EQ("", core_.getPlannedAcquisitionError());
+   EXPECT_EQ(5, core_.getPlannedAcquisitionFrameCount());
+   EXPECT_EQ(5, log_.framesSnapped);
+
+   // One camera sequence with the slices loaded into the stage
+   const double expected[] = { 0.0, 1.0, 2.0, 3.0, 4.0 };
+   EXPECT_EQ(std::vector<double>(expected, expected + 5), log_.zSequence);
+   EXPECT_EQ(1, std::count(log_.calls.begin(), log_.calls.end(),
+            std::string("StartSequenceAcquisition")));
+   const std::vector<std::string>& calls = log_.calls;
+   std::vector<std::string>::const_iterator send =
+      std::find(calls.begin(), calls.end(), "SendStageSequence");
+   std::vector<std::string>::const_iterator start =
+      std::find(calls.begin(), calls.end(), "StartStageSequence");
+   std::vector<std::string>::const_iterator acquire =
+      std::find(calls.begin(), calls.end(), "StartSequenceAcquisition");
+   std::vector<std::string>::const_iterator stop =
+      std::find(calls.begin(), calls.end(), "StopStageSequence");
+   ASSERT_TRUE(stop != calls.end());
+   EXPECT_TRUE(send < start);
+   EXPECT_TRUE(start < acquire);
+   EXPECT_TRUE(acquire < stop);
+
+   // The frames are tagged with their place in the plan
+   ASSERT_EQ(5, core_.getRemainingImageCount());
+   for (long i = 0; i < 5; ++i)
+   {
+      Metadata md;
+      core_.popNextImageMD(md);
+      EXPECT_EQ(CDeviceUtils::ConvertToString(i),
+            md.GetSingleTag("Acquisition-SliceIndex").GetValue());
+   }
+}
+
+TEST_F(AcquisitionEngineTests, UnsequencedSlicesMoveTheStageBetweenRuns)
+{
+   log_.sequenceMaxLength = 0;
+   core_.startPlannedAcquisition(SlicePlan(0, 3));
+   WaitForPlan();
+
+   EXPECT_EQ("", core_.getPlannedAcquisitionError());
+   EXPECT_EQ(3, core_.getPlannedAcquisitionFrameCount());
+   EXPECT_EQ(3, std::count(log_.calls.begin(), log_.calls.end(),
+            std::string("StartSequenceAcquisition")));
+   EXPECT_EQ(3, std::count(log_.calls.begin(), log_.calls.end(),
+            std::string("SetPositionUm")));
+   EXPECT_FALSE(log_.Called("StartStageSequence"));
+}
+
+TEST_F(AcquisitionEngineTests, StopEndsTheRunAndStopsTheSequences)
+{
+   log_.cameraFrameMs = 5.0;
+   core_.startPlannedAcquisition(SlicePlan(0, 100));
+   for (int i = 0; i < 500 && core_.getPlannedAcquisitionFrameCount() < 2; ++i)
+      boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+   EXPECT_TRUE(core_.isPlannedAcquisitionRunning());
+
+   core_.stopPlannedAcquisition();
+   EXPECT_FALSE(core_.isPlannedAcquisitionRunning());
+   EXPECT_FALSE(core_.isSequenceRunning("Camera"));
+   EXPECT_TRUE(log_.Called("StopStageSequence"));
+   EXPECT_EQ("", core_.getPlannedAcquisitionError());
+   EXPECT_LT(core_.getPlannedAcquisitionFrameCount(), 100);
+}
+
+TEST_F(AcquisitionEngineTests, FailedSequenceStartStopsStartedSequences)
+{
+   log_.failZSequenceStart = true;
+   core_.startPlannedAcquisition(SlicePlan(2, 3));
+   WaitForPlan();
+
+   EXPECT_NE("", core_.getPlannedAcquisitionError());
+   EXPECT_TRUE(log_.Called("StartXYStageSequence"));
+   EXPECT_TRUE(log_.Called("StopXYStageSequence"));
+   EXPECT_FALSE(log_.Called("StartSequenceAcquisition"));
+   EXPECT_EQ(0, log_.framesSnapped);
+}
+
+TEST_F(AcquisitionEngineTests, CameraStoppingEarlyFailsThePlan)
+{
+   log_.cameraFrameLimit = 2;
+   core_.startPlannedAcquisition(SlicePlan(0, 5));
+   WaitForPlan();
+
+   const std::string error = core_.getPlannedAcquisitionError();
+   EXPECT_NE(std::string::npos, error.find("Camera stopped after 2 of 5"))
+      << error;
+   EXPECT_TRUE(log_.Called("StopStageSequence"));
+   EXPECT_FALSE(core_.isSequenceRunning("Camera"));
+
+   // The engine can be started again after a failure
+   log_.cameraFrameLimit = -1;
+   core_.startPlannedAcquisition(SlicePlan(0, 2));
+   WaitForPlan();
+   EXPECT_EQ("", core_.getPlannedAcquisitionError());
+}
+
+int main(int argc, char **argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+
+#include "MMCore.h"
+#include "MockDeviceAdapter.h"
+
+#include "../../MMDevice/DeviceBase.h"
+
+#include <boost/thread/thread.hpp>
+
+#include <cstring>
+#include <vector>
+
+
+namespace
+{
+
+const char* const g_Camera = "TestCamera";
+
+// Frames large enough for the buffer to fill after a few
+const unsigned g_Width = 512;
+const unsigned g_Height = 512;
+
+class TestCamera : public CCameraBase<TestCamera>
+{
+public:
+   TestCamera() : pixels_(g_Width * g_Height), exposureMs_(1.0) {}
+
+   int Initialize() { return DEVICE_OK; }
+   int Shutdown() { return DEVICE_OK; }
+   void GetName(char* name) const
+   { CDeviceUtils::CopyLimitedString(name, g_Camera); }
+   bool Busy() { return false; }
+
+   int SnapImage() { return DEVICE_OK; }
+   const unsigned char* GetImageBuffer() { return &pixels_[0]; }
+   long GetImageBufferSize() const { return static_cast<long>(pixels_.size()); }
+   unsigned GetImageWidth() const { return g_Width; }
+   unsigned GetImageHeight() const { return g_Height; }
+   unsigned GetImageBytesPerPixel() const { return 1; }
+   unsigned GetBitDepth() const { return 8; }
+   int GetBinning() const { return 1; }
+   int SetBinning(int) { return DEVICE_OK; }
+   void SetExposure(double exposureMs) { exposureMs_ = exposureMs; }
+   double GetExposure() const { return exposureMs_; }
+   int SetROI(unsigned, unsigned, unsigned, unsigned) { return DEVICE_OK; }
+   int GetROI(unsigned& x, unsigned& y, unsigned& xSize, unsigned& ySize)
+   {
+      x = y = 0;
+      xSize = g_Width;
+      ySize = g_Height;
+      return DEVICE_OK;
+   }
+   int ClearROI() { return DEVICE_OK; }
+   int IsExposureSequenceable(bool& isSequenceable) const
+   {
+      isSequenceable = false;
+      return DEVICE_OK;
+   }
+
+private:
+   std::vector<unsigned char> pixels_;
+   double exposureMs_;
+};
+
+
+class TestAdapter : public MockDeviceAdapter
+{
+public:
+   void InitializeModuleData(RegisterDeviceFunc registerDevice)
+   {
+      registerDevice(g_Camera, MM::CameraDevice, "Test camera");
+   }
+
+   MM::Device* CreateDevice(const char* name)
+   {
+      if (strcmp(name, g_Camera) == 0)
+         return new TestCamera();
+      return 0;
+   }
+
+   void DeleteDevice(MM::Device* device) { delete device; }
+};
+
+
+class BufferOverflowTests : public ::testing::Test
+{
+protected:
+   virtual void SetUp()
+   {
+      core_.loadMockDeviceAdapter("TestAdapter", &adapter_);
+      core_.loadDevice("Camera", "TestAdapter", g_Camera);
+      core_.initializeAllDevices();
+      core_.setCameraDevice("Camera");
+      core_.setCircularBufferMemoryFootprint(1);
+      core_.setBufferOverflowBlockTimeoutMs(10.0);
+   }
+
+   virtual void TearDown()
+   {
+      core_.stopSequenceAcquisition();
+      core_.unloadAllDevices();
+   }
+
+   void WaitForSequence()
+   {
+      for (int i = 0; i < 500 && core_.isSequenceRunning(); ++i)
+         boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+      ASSERT_FALSE(core_.isSequenceRunning());
+   }
+
+   TestAdapter adapter_;
+   CMMCore core_;
+};
+
+const long g_Frames = 20;
+
+} // anonymous namespace
+
+
+// Cameras that stop on overflow stop at the first rejected frame, whatever
+// the policy
+TEST_F(BufferOverflowTests, StopOnOverflowStopsUnderDropNewest)
+{
+   core_.setBufferOverflowPolicy("DropNewest");
+   core_.startSequenceAcquisition(g_Frames, 0.0, true);
+   WaitForSequence();
+   const long capacity = core_.getBufferTotalCapacity();
+   ASSERT_LT(capacity, g_Frames - 1);
+   EXPECT_EQ(capacity, core_.getRemainingImageCount());
+   EXPECT_EQ(1, core_.getBufferDroppedImageCount("DropNewest"));
+   EXPECT_TRUE(core_.isBufferOverflowed());
+}
+
+TEST_F(BufferOverflowTests, StopOnOverflowStopsUnderBlock)
+{
+   core_.setBufferOverflowPolicy("Block");
+   core_.startSequenceAcquisition(g_Frames, 0.0, true);
+   WaitForSequence();
+   EXPECT_EQ(core_.getBufferTotalCapacity(), core_.getRemainingImageCount());
+   EXPECT_EQ(1, core_.getBufferDroppedImageCount("Block"));
+}
+
+// Other cameras go on acquiring, and the buffer counts the lost frames
+TEST_F(BufferOverflowTests, OtherCamerasGoOnUnderDropNewest)
+{
+   core_.setBufferOverflowPolicy("DropNewest");
+   core_.startSequenceAcquisition(g_Frames, 0.0, false);
+   WaitForSequence();
+   const long capacity = core_.getBufferTotalCapacity();
+   EXPECT_EQ(capacity, core_.getRemainingImageCount());
+   EXPECT_EQ(g_Frames - capacity,
+         core_.getBufferDroppedImageCount("DropNewest"));
+}
+
+// Discarding the oldest frame to make room does not reject the new one
+TEST_F(BufferOverflowTests, DropOldestDoesNotStopCameras)
+{
+   core_.setBufferOverflowPolicy("DropOldest");
+   core_.startSequenceAcquisition(g_Frames, 0.0, true);
+   WaitForSequence();
+   const long capacity = core_.getBufferTotalCapacity();
+   EXPECT_EQ(capacity, core_.getRemainingImageCount());
+   EXPECT_EQ(g_Frames - capacity,
+         core_.getBufferDroppedImageCount("DropOldest"));
+}
+
+// Under Clear, the camera clears the buffer and goes on, unless it stops
+TEST_F(BufferOverflowTests, ClearStopsOrClears)
+{
+   core_.startSequenceAcquisition(g_Frames, 0.0, true);
+   WaitForSequence();
+   EXPECT_EQ(core_.getBufferTotalCapacity(), core_.getRemainingImageCount());
+   EXPECT_TRUE(core_.isBufferOverflowed());
+
+   core_.startSequenceAcquisition(g_Frames, 0.0, false);
+   WaitForSequence();
+   EXPECT_FALSE(core_.isBufferOverflowed());
+   EXPECT_EQ(g_Frames - core_.getRemainingImageCount(),
+         core_.getBufferDroppedImageCount("Clear"));
+}
+
+
+int main(int argc, char** argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
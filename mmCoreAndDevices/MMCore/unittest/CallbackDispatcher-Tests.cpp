@@ -0,0 +1,273 @@
+#include <gtest/gtest.h>
+
+#include "CallbackDispatcher.h"
+#include "CoreClock.h"
+#include "MMCore.h"
+#include "Logging/Logging.h"
+
+#include <boost/make_shared.hpp>
+#include <boost/thread.hpp>
+
+#include <string>
+#include <vector>
+
+
+namespace {
+
+// Records events; the first stage position blocks until released
+class Recorder : public MMEventCallback
+{
+public:
+   Recorder() : blockFirst(false), blocked(false), released(false) {}
+
+   virtual void onPropertyChanged(const char* name, const char* propName,
+         const char* propValue)
+   {
+      boost::lock_guard<boost::mutex> lock(mutex);
+      events.push_back(std::string(name) + "." + propName + "=" + propValue);
+      condition.notify_all();
+   }
+
+   virtual void onStagePositionChanged(char* name, double pos)
+   {
+      boost::unique_lock<boost::mutex> lock(mutex);
+      if (blockFirst && !blocked)
+      {
+         blocked = true;
+         condition.notify_all();
+         while (!released)
+            condition.wait(lock);
+      }
+      positions.push_back(pos);
+      positionTimesNs.push_back(mm::CoreClock::MonotonicNs());
+      events.push_back(std::string(name));
+      condition.notify_all();
+   }
+
+   void WaitUntilBlocked()
+   {
+      boost::unique_lock<boost::mutex> lock(mutex);
+      while (!blocked)
+         condition.wait(lock);
+   }
+
+   void Release()
+   {
+      boost::lock_guard<boost::mutex> lock(mutex);
+      released = true;
+      condition.notify_all();
+   }
+
+   bool WaitForEvents(std::size_t count)
+   {
+      boost::unique_lock<boost::mutex> lock(mutex);
+      const boost::system_time deadline = boost::get_system_time() +
+         boost::posix_time::seconds(5);
+      while (events.size() < count)
+         if (!condition.timed_wait(lock, deadline))
+            return false;
+      return true;
+   }
+
+   boost::mutex mutex;
+   boost::condition_variable condition;
+   bool blockFirst;
+   bool blocked;
+   bool released;
+   std::vector<std::string> events;
+   std::vector<double> positions;
+   std::vector<unsigned long long> positionTimesNs;
+};
+
+mm::logging::Logger NewLogger()
+{
+   static boost::shared_ptr<mm::logging::LoggingCore> loggingCore =
+      boost::make_shared<mm::logging::LoggingCore>();
+   return loggingCore->NewLogger("Test");
+}
+
+} // anonymous namespace
+
+
+TEST(CallbackDispatcherTests, EventTypeNames)
+{
+   CallbackDispatcher::EventType type;
+   ASSERT_TRUE(CallbackDispatcher::GetEventTypeByName(
+            "onXYStagePositionChanged", type));
+   EXPECT_EQ(CallbackDispatcher::XYStagePositionChanged, type);
+   EXPECT_STREQ("onPropertyChanged", CallbackDispatcher::GetEventTypeName(
+            CallbackDispatcher::PropertyChanged));
+   EXPECT_FALSE(CallbackDispatcher::GetEventTypeByName("onImage", type));
+}
+
+
+TEST(CallbackDispatcherTests, ForwardsSynchronouslyWhenStopped)
+{
+   Recorder recorder;
+   CallbackDispatcher dispatcher(NewLogger());
+   dispatcher.SetDownstreamCallback(&recorder);
+   dispatcher.onPropertyChanged("Dev", "Prop", "1");
+   ASSERT_EQ(1u, recorder.events.size());
+   EXPECT_EQ("Dev.Prop=1", recorder.events[0]);
+}
+
+
+TEST(CallbackDispatcherTests, CoalescesWhileListenerIsBusy)
+{
+   Recorder recorder;
+   recorder.blockFirst = true;
+   CallbackDispatcher dispatcher(NewLogger());
+   dispatcher.SetDownstreamCallback(&recorder);
+   dispatcher.Start();
+   ASSERT_TRUE(dispatcher.IsRunning());
+
+   char stage[] = "Z";
+   dispatcher.onStagePositionChanged(stage, 0.0);
+   recorder.WaitUntilBlocked();
+
+   // Queued behind the blocked listener, without waiting for it
+   for (int i = 1; i <= 100; ++i)
+      dispatcher.onStagePositionChanged(stage, i);
+   dispatcher.onPropertyChanged("Dev", "Prop", "1");
+   dispatcher.onPropertyChanged("Dev", "Prop", "2");
+   dispatcher.onPropertyChanged("Dev", "Other", "3");
+   EXPECT_EQ(100u, dispatcher.GetCoalescedEventCount());
+
+   recorder.Release();
+   ASSERT_TRUE(recorder.WaitForEvents(4));
+   dispatcher.Stop();
+   EXPECT_FALSE(dispatcher.IsRunning());
+
+   // In the order first queued, with the latest values
+   ASSERT_EQ(4u, recorder.events.size());
+   EXPECT_EQ("Z", recorder.events[0]);
+   EXPECT_EQ("Z", recorder.events[1]);
+   EXPECT_EQ("Dev.Prop=2", recorder.events[2]);
+   EXPECT_EQ("Dev.Other=3", recorder.events[3]);
+   ASSERT_EQ(2u, recorder.positions.size());
+   EXPECT_EQ(100.0, recorder.positions[1]);
+   EXPECT_EQ(0u, dispatcher.GetDroppedEventCount());
+}
+
+
+TEST(CallbackDispatcherTests, LimitsRatePerDevice)
+{
+   Recorder recorder;
+   CallbackDispatcher dispatcher(NewLogger());
+   dispatcher.SetDownstreamCallback(&recorder);
+   dispatcher.SetMaxRate(CallbackDispatcher::StagePositionChanged, 20.0);
+   EXPECT_EQ(20.0, dispatcher.GetMaxRate(CallbackDispatcher::StagePositionChanged));
+   dispatcher.Start();
+
+   char stage[] = "Z";
+   const unsigned long long startNs = mm::CoreClock::MonotonicNs();
+   for (int i = 0; i < 50; ++i)
+   {
+      dispatcher.onStagePositionChanged(stage, i);
+      boost::this_thread::sleep(boost::posix_time::milliseconds(5));
+   }
+   const unsigned long long endNs = mm::CoreClock::MonotonicNs();
+   dispatcher.Stop();
+
+   // About 250 ms at 20 per second, plus the last position when stopping
+   boost::lock_guard<boost::mutex> lock(recorder.mutex);
+   const double seconds = (endNs - startNs) / 1e9;
+   EXPECT_LE(recorder.positions.size(), seconds * 20.0 + 2.0);
+   EXPECT_GE(recorder.positions.size(), 2u);
+   EXPECT_EQ(49.0, recorder.positions.back());
+   for (std::size_t i = 1; i + 1 < recorder.positionTimesNs.size(); ++i)
+      EXPECT_GE(recorder.positionTimesNs[i] - recorder.positionTimesNs[i - 1],
+            45000000u);
+}
+
+
+// Stops the dispatcher from its first event
+class StoppingListener : public Recorder
+{
+public:
+   StoppingListener() : dispatcher(0), stillRunning(true) {}
+
+   virtual void onPropertyChanged(const char* name, const char* propName,
+         const char* propValue)
+   {
+      if (dispatcher && events.empty())
+      {
+         dispatcher->Stop();
+         dispatcher->Start(); // Ignored until this listener returns
+         stillRunning = dispatcher->IsRunning();
+      }
+      Recorder::onPropertyChanged(name, propName, propValue);
+   }
+
+   CallbackDispatcher* dispatcher;
+   bool stillRunning;
+};
+
+
+TEST(CallbackDispatcherTests, ListenerCanStopDispatcher)
+{
+   StoppingListener listener;
+   CallbackDispatcher dispatcher(NewLogger());
+   listener.dispatcher = &dispatcher;
+   dispatcher.SetDownstreamCallback(&listener);
+   dispatcher.Start();
+
+   dispatcher.onPropertyChanged("Dev", "Prop", "1");
+   dispatcher.onPropertyChanged("Dev", "Other", "2");
+   ASSERT_TRUE(listener.WaitForEvents(2));
+   dispatcher.Stop();
+   EXPECT_FALSE(dispatcher.IsRunning());
+   EXPECT_FALSE(listener.stillRunning);
+
+   // Forwarded synchronously once stopped
+   listener.dispatcher = 0;
+   dispatcher.onPropertyChanged("Dev", "Prop", "3");
+   ASSERT_EQ(3u, listener.events.size());
+   EXPECT_EQ("Dev.Prop=3", listener.events[2]);
+
+   // And can be started again
+   dispatcher.Start();
+   EXPECT_TRUE(dispatcher.IsRunning());
+   dispatcher.onPropertyChanged("Dev", "Prop", "4");
+   ASSERT_TRUE(listener.WaitForEvents(4));
+   dispatcher.Stop();
+}
+
+
+TEST(CallbackDispatcherTests, CoreDeliversOnDispatcherThread)
+{
+   CMMCore core;
+   Recorder recorder;
+   core.registerCallback(&recorder);
+   core.enableCallbackDispatchThread(true);
+   EXPECT_TRUE(core.isCallbackDispatchThreadEnabled());
+   core.setCallbackMaxRate("onStagePositionChanged", 10.0);
+   EXPECT_EQ(10.0, core.getCallbackMaxRate("onStagePositionChanged"));
+   EXPECT_THROW(core.setCallbackMaxRate("onImage", 1.0), CMMError);
+
+   core.setProperty("Core", "TimeoutMs", "2000");
+   ASSERT_TRUE(recorder.WaitForEvents(1));
+   {
+      boost::lock_guard<boost::mutex> lock(recorder.mutex);
+      EXPECT_EQ("Core.TimeoutMs=2000", recorder.events[0]);
+   }
+
+   // Registering while enabled replaces the listener behind the dispatcher
+   Recorder other;
+   core.registerCallback(&other);
+   core.setProperty("Core", "TimeoutMs", "3000");
+   ASSERT_TRUE(other.WaitForEvents(1));
+
+   core.enableCallbackDispatchThread(false);
+   EXPECT_FALSE(core.isCallbackDispatchThreadEnabled());
+   core.setProperty("Core", "TimeoutMs", "4000");
+   EXPECT_EQ(2u, other.events.size());
+   core.registerCallback(0);
+}
+
+
+int main(int argc, char** argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
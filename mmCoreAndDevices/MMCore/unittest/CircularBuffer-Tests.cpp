@@ -0,0 +1,405 @@
+#include <gtest/gtest.h>
+
+#include "CircularBuffer.h"
+#include "SequenceStatistics.h"
+#include "../MMDevice/ImageMetadata.h"
+
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread.hpp>
+
+#include <string>
+#include <vector>
+
+
+namespace {
+
+// 1 MB holds 4 frames of this size
+const unsigned width = 512, height = 512;
+const unsigned bufferFrames = 4;
+
+bool InsertFrame(CircularBuffer& buffer, unsigned char value,
+      const char* camera = "Camera")
+{
+   std::vector<unsigned char> frame(width * height, value);
+   Metadata md;
+   md.put("Camera", camera);
+   return buffer.InsertImage(&frame[0], width, height, 1, &md);
+}
+
+// 16-bit frame with 10-bit pixels that depend on value
+bool InsertCompressibleFrame(CircularBuffer& buffer, unsigned short value)
+{
+   std::vector<unsigned short> frame(width * height);
+   for (unsigned i = 0; i < frame.size(); ++i)
+      frame[i] = static_cast<unsigned short>((i * 7 + value) % 1024);
+   Metadata md;
+   md.put("Camera", "Camera");
+   return buffer.InsertImage(reinterpret_cast<unsigned char*>(&frame[0]),
+         width, height, 2, &md);
+}
+
+bool IsCompressibleFrame(const unsigned char* pixels, unsigned short value)
+{
+   const unsigned short* frame = reinterpret_cast<const unsigned short*>(pixels);
+   for (unsigned i = 0; i < width * height; ++i)
+      if (frame[i] != (i * 7 + value) % 1024)
+         return false;
+   return true;
+}
+
+void PeekFrame(const CircularBuffer* buffer, long n, unsigned char* value)
+{
+   *value = buffer->GetNthFromTopImageBuffer(n)->GetPixels()[0];
+}
+
+void PopFrameAfter(CircularBuffer* buffer, long delayMs)
+{
+   boost::this_thread::sleep(boost::posix_time::milliseconds(delayMs));
+   buffer->GetNextImage();
+}
+
+} // anonymous namespace
+
+
+TEST(CircularBufferTests, OverflowPolicyNames)
+{
+   CircularBuffer::OverflowPolicy policy;
+   ASSERT_TRUE(CircularBuffer::ParseOverflowPolicy("DropOldest", policy));
+   EXPECT_EQ(CircularBuffer::DropOldest, policy);
+   EXPECT_EQ("Block", CircularBuffer::GetOverflowPolicyName(CircularBuffer::Block));
+   ASSERT_TRUE(CircularBuffer::ParseOverflowPolicy("Clear", policy));
+   EXPECT_EQ(CircularBuffer::ClearBuffer, policy);
+   EXPECT_FALSE(CircularBuffer::ParseOverflowPolicy("Reset", policy));
+}
+
+
+TEST(CircularBufferTests, ClearIsTheDefaultPolicy)
+{
+   CircularBuffer buffer(1);
+   ASSERT_TRUE(buffer.Initialize(1, width, height, 1));
+   EXPECT_EQ(CircularBuffer::ClearBuffer, buffer.GetOverflowPolicy());
+
+   for (unsigned i = 0; i < bufferFrames; ++i)
+      EXPECT_TRUE(InsertFrame(buffer, static_cast<unsigned char>(i)));
+   EXPECT_TRUE(buffer.GetNextImage() != 0);
+   EXPECT_TRUE(InsertFrame(buffer, 100));
+   EXPECT_FALSE(InsertFrame(buffer, 101));
+   EXPECT_TRUE(buffer.Overflow());
+
+   // What a camera does on overflow; the frames not yet retrieved are lost
+   buffer.Clear();
+   EXPECT_FALSE(buffer.Overflow());
+   EXPECT_TRUE(InsertFrame(buffer, 101));
+   EXPECT_EQ(101, buffer.GetNextImage()[0]);
+   EXPECT_EQ(bufferFrames, buffer.GetDroppedImageCount(CircularBuffer::ClearBuffer));
+   EXPECT_EQ(0u, buffer.GetDroppedImageCount(CircularBuffer::DropNewest));
+
+   // Clearing a buffer that has not overflowed loses nothing to the policy
+   EXPECT_TRUE(InsertFrame(buffer, 102));
+   buffer.Clear();
+   EXPECT_EQ(bufferFrames, buffer.GetDroppedImageCount(CircularBuffer::ClearBuffer));
+
+   ASSERT_TRUE(buffer.Initialize(1, width, height, 1));
+   EXPECT_EQ(0u, buffer.GetDroppedImageCount(CircularBuffer::ClearBuffer));
+}
+
+
+TEST(CircularBufferTests, DropNewestRejectsFrames)
+{
+   CircularBuffer buffer(1);
+   ASSERT_TRUE(buffer.Initialize(1, width, height, 1));
+   ASSERT_EQ(bufferFrames, buffer.GetSize());
+   buffer.SetOverflowPolicy(CircularBuffer::DropNewest);
+
+   for (unsigned i = 0; i < bufferFrames; ++i)
+      EXPECT_TRUE(InsertFrame(buffer, static_cast<unsigned char>(i)));
+   EXPECT_FALSE(buffer.Overflow());
+   EXPECT_FALSE(InsertFrame(buffer, 100));
+   EXPECT_FALSE(InsertFrame(buffer, 101));
+   EXPECT_TRUE(buffer.Overflow());
+   EXPECT_EQ(2u, buffer.GetDroppedImageCount(CircularBuffer::DropNewest));
+   EXPECT_EQ(0u, buffer.GetDroppedImageCount(CircularBuffer::DropOldest));
+
+   // The frames already in the buffer are kept
+   for (unsigned i = 0; i < bufferFrames; ++i)
+      EXPECT_EQ(i, buffer.GetNextImage()[0]);
+   EXPECT_TRUE(buffer.GetNextImage() == 0);
+
+   // The counts are kept until the buffer is initialized again
+   buffer.Clear();
+   EXPECT_FALSE(buffer.Overflow());
+   EXPECT_EQ(2u, buffer.GetDroppedImageCount(CircularBuffer::DropNewest));
+   EXPECT_EQ(0u, buffer.GetDroppedImageCount(CircularBuffer::ClearBuffer));
+   ASSERT_TRUE(buffer.Initialize(1, width, height, 1));
+   EXPECT_EQ(0u, buffer.GetDroppedImageCount(CircularBuffer::DropNewest));
+}
+
+
+TEST(CircularBufferTests, DropOldestKeepsLatestFrames)
+{
+   CircularBuffer buffer(1);
+   ASSERT_TRUE(buffer.Initialize(1, width, height, 1));
+   buffer.SetOverflowPolicy(CircularBuffer::DropOldest);
+
+   const unsigned frameCount = bufferFrames + 3;
+   for (unsigned i = 0; i < frameCount; ++i)
+      EXPECT_TRUE(InsertFrame(buffer, static_cast<unsigned char>(i)));
+   EXPECT_FALSE(buffer.Overflow());
+   EXPECT_EQ(3u, buffer.GetDroppedImageCount(CircularBuffer::DropOldest));
+   EXPECT_EQ(bufferFrames, buffer.GetRemainingImageCount());
+
+   for (unsigned i = frameCount - bufferFrames; i < frameCount; ++i)
+      EXPECT_EQ(i, buffer.GetNextImage()[0]);
+   EXPECT_TRUE(buffer.GetNextImage() == 0);
+}
+
+
+TEST(CircularBufferTests, BlockTimesOut)
+{
+   CircularBuffer buffer(1);
+   ASSERT_TRUE(buffer.Initialize(1, width, height, 1));
+   buffer.SetOverflowPolicy(CircularBuffer::Block);
+   buffer.SetOverflowBlockTimeoutMs(50.0);
+
+   for (unsigned i = 0; i < bufferFrames; ++i)
+      EXPECT_TRUE(InsertFrame(buffer, static_cast<unsigned char>(i)));
+
+   boost::posix_time::ptime start =
+      boost::posix_time::microsec_clock::universal_time();
+   EXPECT_FALSE(InsertFrame(buffer, 100));
+   boost::posix_time::time_duration waited =
+      boost::posix_time::microsec_clock::universal_time() - start;
+   EXPECT_GE(waited.total_milliseconds(), 45);
+   EXPECT_TRUE(buffer.Overflow());
+   EXPECT_EQ(1u, buffer.GetDroppedImageCount(CircularBuffer::Block));
+}
+
+
+TEST(CircularBufferTests, BlockWaitsForRoom)
+{
+   CircularBuffer buffer(1);
+   ASSERT_TRUE(buffer.Initialize(1, width, height, 1));
+   buffer.SetOverflowPolicy(CircularBuffer::Block);
+   buffer.SetOverflowBlockTimeoutMs(10000.0);
+
+   for (unsigned i = 0; i < bufferFrames; ++i)
+      EXPECT_TRUE(InsertFrame(buffer, static_cast<unsigned char>(i)));
+
+   boost::thread consumer(boost::bind(&PopFrameAfter, &buffer, 20));
+   EXPECT_TRUE(InsertFrame(buffer, 100));
+   consumer.join();
+   EXPECT_FALSE(buffer.Overflow());
+   EXPECT_EQ(0u, buffer.GetDroppedImageCount(CircularBuffer::Block));
+
+   for (unsigned i = 1; i < bufferFrames; ++i)
+      EXPECT_EQ(i, buffer.GetNextImage()[0]);
+   EXPECT_EQ(100, buffer.GetNextImage()[0]);
+}
+
+
+TEST(CircularBufferTests, SpillKeepsFramesInOrder)
+{
+   CircularBuffer buffer(1);
+   ASSERT_TRUE(buffer.Initialize(1, width, height, 1));
+   buffer.EnableSpill("CircularBuffer-Tests-spill", 1);
+   ASSERT_TRUE(buffer.IsSpillEnabled());
+   ASSERT_EQ(bufferFrames, buffer.GetSpillCapacity());
+   EXPECT_EQ(2 * bufferFrames, buffer.GetSize());
+
+   const unsigned frameCount = bufferFrames + 3;
+   for (unsigned i = 0; i < frameCount; ++i)
+      EXPECT_TRUE(InsertFrame(buffer, static_cast<unsigned char>(i)));
+   EXPECT_FALSE(buffer.Overflow());
+   EXPECT_EQ(3u, buffer.GetSpillImageCount());
+   EXPECT_EQ(frameCount, buffer.GetRemainingImageCount());
+
+   // The latest frames are served from the spill file
+   EXPECT_EQ(frameCount - 1, buffer.GetTopImage()[0]);
+   EXPECT_EQ(frameCount - 5,
+         buffer.GetNthFromTopImageBuffer(4)->GetPixels()[0]);
+
+   // Frames inserted while the spill file is being drained go after it
+   EXPECT_EQ(0, buffer.GetNextImage()[0]);
+   EXPECT_TRUE(InsertFrame(buffer, 100));
+   for (unsigned i = 1; i < frameCount; ++i)
+      EXPECT_EQ(i, buffer.GetNextImage()[0]);
+   EXPECT_EQ(100, buffer.GetNextImage()[0]);
+   EXPECT_TRUE(buffer.GetNextImage() == 0);
+
+   EXPECT_EQ(0u, buffer.GetSpillImageCount());
+   EXPECT_EQ(4u, buffer.GetSpillPeakImageCount());
+   EXPECT_EQ(4u, buffer.GetSpilledImageCount());
+   buffer.DisableSpill();
+   EXPECT_FALSE(buffer.IsSpillEnabled());
+}
+
+
+// Threads reading frames from a tier get their own copies
+TEST(CircularBufferTests, TierFramesAreReadPerThread)
+{
+   CircularBuffer buffer(1);
+   ASSERT_TRUE(buffer.Initialize(1, width, height, 1));
+   buffer.EnableSpill("CircularBuffer-Tests-spill", 1);
+   for (unsigned i = 0; i < bufferFrames + 2; ++i)
+      EXPECT_TRUE(InsertFrame(buffer, static_cast<unsigned char>(i)));
+   ASSERT_EQ(2u, buffer.GetSpillImageCount());
+
+   const unsigned char* top = buffer.GetTopImage();
+   EXPECT_EQ(bufferFrames + 1, top[0]);
+   unsigned char other = 0;
+   boost::thread reader(boost::bind(&PeekFrame, &buffer, 1, &other));
+   reader.join();
+   EXPECT_EQ(bufferFrames, other);
+   EXPECT_EQ(bufferFrames + 1, top[0]);
+   EXPECT_EQ(bufferFrames + 1, top[width * height - 1]);
+}
+
+
+TEST(CircularBufferTests, OverflowPolicyAppliesWhenSpillIsFull)
+{
+   CircularBuffer buffer(1);
+   ASSERT_TRUE(buffer.Initialize(1, width, height, 1));
+   buffer.EnableSpill("CircularBuffer-Tests-spill", 1);
+
+   for (unsigned i = 0; i < 2 * bufferFrames; ++i)
+      EXPECT_TRUE(InsertFrame(buffer, static_cast<unsigned char>(i)));
+   EXPECT_FALSE(InsertFrame(buffer, 100));
+   EXPECT_TRUE(buffer.Overflow());
+
+   buffer.SetOverflowPolicy(CircularBuffer::DropOldest);
+   EXPECT_TRUE(InsertFrame(buffer, 101));
+   EXPECT_EQ(1u, buffer.GetDroppedImageCount(CircularBuffer::DropOldest));
+   for (unsigned i = 1; i < 2 * bufferFrames; ++i)
+      EXPECT_EQ(i, buffer.GetNextImage()[0]);
+   EXPECT_EQ(101, buffer.GetNextImage()[0]);
+
+   buffer.Clear();
+   EXPECT_EQ(0u, buffer.GetSpilledImageCount());
+}
+
+
+TEST(CircularBufferTests, CompressionKeepsFramesInOrder)
+{
+   // 8 frames uncompressed: 4 slots, and 2 MB for compressed frames
+   CircularBuffer buffer(4);
+   buffer.EnableCompression(true);
+   ASSERT_TRUE(buffer.Initialize(1, width, height, 2));
+   // Before any frame is compressed, frames are assumed incompressible
+   EXPECT_EQ(3u, buffer.GetCompressedCapacity());
+   EXPECT_EQ(7u, buffer.GetSize());
+
+   const unsigned frameCount = 30;
+   for (unsigned i = 0; i < frameCount; ++i)
+      EXPECT_TRUE(InsertCompressibleFrame(buffer, static_cast<unsigned short>(i)));
+   EXPECT_FALSE(buffer.Overflow());
+   EXPECT_EQ(frameCount - 4, buffer.GetCompressedImageCount());
+   EXPECT_EQ(frameCount, buffer.GetRemainingImageCount());
+   EXPECT_GT(buffer.GetCompressionRatio(), 10.0);
+   EXPECT_GT(buffer.GetSize(), frameCount);
+
+   EXPECT_TRUE(IsCompressibleFrame(buffer.GetTopImage(), frameCount - 1));
+   EXPECT_TRUE(IsCompressibleFrame(
+            buffer.GetNthFromTopImageBuffer(3)->GetPixels(), frameCount - 4));
+
+   EXPECT_TRUE(IsCompressibleFrame(buffer.GetNextImage(), 0));
+   EXPECT_TRUE(InsertCompressibleFrame(buffer, 100));
+   for (unsigned i = 1; i < frameCount; ++i)
+      EXPECT_TRUE(IsCompressibleFrame(buffer.GetNextImage(),
+               static_cast<unsigned short>(i))) << i;
+   EXPECT_TRUE(IsCompressibleFrame(buffer.GetNextImage(), 100));
+   EXPECT_TRUE(buffer.GetNextImage() == 0);
+
+   buffer.EnableCompression(false);
+   ASSERT_TRUE(buffer.Initialize(1, width, height, 2));
+   EXPECT_EQ(8u, buffer.GetSize());
+   EXPECT_EQ(0u, buffer.GetCompressedCapacity());
+}
+
+
+TEST(CircularBufferTests, SequenceStatisticsPerCamera)
+{
+   CircularBuffer buffer(1);
+   buffer.SetOverflowPolicy(CircularBuffer::DropOldest);
+   ASSERT_TRUE(buffer.Initialize(1, width, height, 1));
+
+   // A, B, A, A; then A's first frame is evicted for B's second
+   EXPECT_TRUE(InsertFrame(buffer, 0, "A"));
+   EXPECT_TRUE(InsertFrame(buffer, 1, "B"));
+   EXPECT_TRUE(InsertFrame(buffer, 2, "A"));
+   EXPECT_TRUE(InsertFrame(buffer, 3, "A"));
+   EXPECT_TRUE(InsertFrame(buffer, 4, "B"));
+   boost::this_thread::sleep(boost::posix_time::milliseconds(5));
+   EXPECT_EQ(1, buffer.GetNextImage()[0]);
+
+   SequenceStatistics a, b;
+   buffer.GetSequenceStatistics("A", a);
+   buffer.GetSequenceStatistics("B", b);
+   EXPECT_EQ(3, a.getInsertedImageCount());
+   EXPECT_EQ(0, a.getPoppedImageCount());
+   EXPECT_EQ(1, a.getEvictedImageCount());
+   EXPECT_EQ(2, a.getQueueDepth());
+   EXPECT_EQ(3, a.getQueueDepthHighWaterMark());
+   EXPECT_GT(a.getInsertsPerSecond(), 0.0);
+   EXPECT_EQ(0.0, a.getPopsPerSecond());
+   EXPECT_GE(a.getMsSinceLastInsert(), 0.0);
+   EXPECT_EQ(-1.0, a.getMsSinceLastPop());
+
+   EXPECT_EQ(2, b.getInsertedImageCount());
+   EXPECT_EQ(1, b.getPoppedImageCount());
+   EXPECT_EQ(0, b.getOverflowCount());
+   EXPECT_EQ(1, b.getQueueDepth());
+   EXPECT_GE(b.getMeanResidenceMs(), 5.0);
+   EXPECT_EQ(b.getMeanResidenceMs(), b.getMaxResidenceMs());
+   const std::vector<long> histogram = b.getResidenceHistogram();
+   long histogramTotal = 0;
+   for (std::size_t i = 0; i < histogram.size(); ++i)
+      histogramTotal += histogram[i];
+   EXPECT_EQ(1, histogramTotal);
+
+   std::vector<std::string> cameras = buffer.GetSequenceStatisticsCameras();
+   ASSERT_EQ(2u, cameras.size());
+   EXPECT_EQ("A", cameras[0]);
+
+   // Rejected frames are charged to the inserting camera
+   buffer.SetOverflowPolicy(CircularBuffer::DropNewest);
+   EXPECT_TRUE(InsertFrame(buffer, 5, "B"));
+   EXPECT_FALSE(InsertFrame(buffer, 6, "B"));
+   buffer.GetSequenceStatistics("B", b);
+   EXPECT_EQ(1, b.getRejectedImageCount());
+   EXPECT_EQ(3, b.getInsertedImageCount());
+   EXPECT_EQ(2, b.getQueueDepth());
+
+   // Unknown cameras have no frames
+   SequenceStatistics none;
+   buffer.GetSequenceStatistics("C", none);
+   EXPECT_EQ(0, none.getInsertedImageCount());
+   EXPECT_EQ(-1.0, none.getMsSinceLastInsert());
+
+   // Clearing empties the queue but keeps the counts
+   buffer.Clear();
+   buffer.GetSequenceStatistics("A", a);
+   EXPECT_EQ(3, a.getInsertedImageCount());
+   EXPECT_EQ(1, a.getEvictedImageCount());
+   EXPECT_EQ(0, a.getQueueDepth());
+   EXPECT_EQ(3, a.getQueueDepthHighWaterMark());
+   EXPECT_TRUE(buffer.GetNextImage() == 0);
+   buffer.GetSequenceStatistics("A", a);
+   EXPECT_EQ(0, a.getPoppedImageCount());
+   buffer.GetSequenceStatistics("B", b);
+   EXPECT_EQ(1, b.getRejectedImageCount());
+
+   // Initializing resets them
+   ASSERT_TRUE(buffer.Initialize(1, width, height, 1));
+   buffer.GetSequenceStatistics("A", a);
+   EXPECT_EQ(0, a.getInsertedImageCount());
+   EXPECT_EQ(0, a.getEvictedImageCount());
+   EXPECT_EQ(0, a.getQueueDepthHighWaterMark());
+}
+
+
+int main(int argc, char** argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
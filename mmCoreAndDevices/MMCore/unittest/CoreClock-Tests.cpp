@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+
+#include "CoreClock.h"
+#include "../MMDevice/MMDevice.h"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread/thread.hpp>
+
+
+TEST(CoreClockTests, MonotonicNsNeverDecreases)
+{
+   unsigned long long prev = mm::CoreClock::MonotonicNs();
+   for (int i = 0; i < 100000; ++i)
+   {
+      unsigned long long now = mm::CoreClock::MonotonicNs();
+      ASSERT_GE(now, prev);
+      prev = now;
+   }
+}
+
+
+TEST(CoreClockTests, MeasuresSleep)
+{
+   unsigned long long start = mm::CoreClock::MonotonicNs();
+   boost::this_thread::sleep(boost::posix_time::milliseconds(20));
+   double elapsedMs = (mm::CoreClock::MonotonicNs() - start) / 1.0e6;
+   EXPECT_GE(elapsedMs, 19.0);
+   EXPECT_LT(elapsedMs, 2000.0);
+}
+
+
+TEST(CoreClockTests, WallTimeMatchesSystemClock)
+{
+   boost::posix_time::ptime system = boost::posix_time::microsec_clock::local_time();
+   boost::posix_time::ptime core = mm::CoreClock::NowPtime();
+   EXPECT_NEAR(0.0, (double)(core - system).total_milliseconds(), 1000.0);
+
+   boost::posix_time::ptime epoch(boost::gregorian::date(2000, 1, 1));
+   MM::MMTime mmNow = mm::CoreClock::NowMMTime();
+   double systemMs = (system - epoch).total_microseconds() / 1000.0;
+   EXPECT_NEAR(systemMs, mmNow.getMsec(), 1000.0);
+}
+
+
+TEST(CoreClockTests, MMTimeFollowsMonotonicClock)
+{
+   unsigned long long ns = mm::CoreClock::MonotonicNs();
+   MM::MMTime t0 = mm::CoreClock::ToMMTime(ns);
+   MM::MMTime t1 = mm::CoreClock::ToMMTime(ns + 1500000000ULL);
+   EXPECT_NEAR(1500.0, (t1 - t0).getMsec(), 0.002);
+}
+
+
+int main(int argc, char **argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -0,0 +1,213 @@
+#include <gtest/gtest.h>
+
+#include "CoreClock.h"
+#include "DeviceCallTracer.h"
+#include "MMCore.h"
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+void SleepUs(unsigned us)
+{
+   boost::this_thread::sleep(boost::posix_time::microseconds(us));
+}
+
+void MakeCalls(DeviceCallTracer::Device* device, unsigned count)
+{
+   for (unsigned i = 0; i < count; ++i)
+      DeviceCallTracer::Call call(device, DeviceCallTracer::MethodBusy);
+}
+
+unsigned CountOccurrences(const std::string& s, const std::string& sub)
+{
+   unsigned n = 0;
+   for (std::string::size_type pos = s.find(sub); pos != std::string::npos;
+         pos = s.find(sub, pos + 1))
+      ++n;
+   return n;
+}
+
+const std::size_t bucketCount = DeviceCallTracer::NumHistogramBuckets;
+
+} // anonymous namespace
+
+
+TEST(DeviceCallTracerTests, NothingIsRecordedWhenDisabled)
+{
+   DeviceCallTracer tracer;
+   DeviceCallTracer::Device* device = tracer.RegisterDevice("Camera");
+   EXPECT_EQ(device, tracer.RegisterDevice("Camera"));
+   EXPECT_NE(device, tracer.RegisterDevice("Stage"));
+
+   {
+      DeviceCallTracer::Call call(device, DeviceCallTracer::MethodSnapImage);
+   }
+   DeviceCallTracer::MethodStatistics stats;
+   EXPECT_FALSE(tracer.GetStatistics("Camera",
+            DeviceCallTracer::MethodSnapImage, stats));
+   EXPECT_TRUE(tracer.GetCalledMethods("Camera").empty());
+
+   // A device without a tracer is not traced
+   DeviceCallTracer::Call call(0, DeviceCallTracer::MethodSnapImage);
+}
+
+
+TEST(DeviceCallTracerTests, CountsLatencies)
+{
+   DeviceCallTracer tracer;
+   tracer.Enable(true);
+   DeviceCallTracer::Device* device = tracer.RegisterDevice("Camera");
+   for (int i = 0; i < 3; ++i)
+   {
+      DeviceCallTracer::Call call(device, DeviceCallTracer::MethodSnapImage);
+      SleepUs(2000);
+   }
+   {
+      DeviceCallTracer::Call call(device, DeviceCallTracer::MethodGetExposure);
+   }
+
+   std::vector<DeviceCallTracer::Method> methods =
+      tracer.GetCalledMethods("Camera");
+   ASSERT_EQ(2u, methods.size());
+   EXPECT_EQ(DeviceCallTracer::MethodSnapImage, methods[0]);
+   EXPECT_EQ(DeviceCallTracer::MethodGetExposure, methods[1]);
+
+   DeviceCallTracer::MethodStatistics stats;
+   ASSERT_TRUE(tracer.GetStatistics("Camera",
+            DeviceCallTracer::MethodSnapImage, stats));
+   EXPECT_EQ(3u, stats.count);
+   EXPECT_GE(stats.meanMs, 2.0);
+   EXPECT_GE(stats.maxMs, stats.meanMs);
+   EXPECT_EQ(0.0, stats.meanLockWaitMs);
+   ASSERT_EQ(bucketCount, stats.histogram.size());
+   // 2 ms is in [2048, 4096) us or, if the sleep overran, a later bucket
+   for (unsigned b = 0; b < 11; ++b)
+      EXPECT_EQ(0u, stats.histogram[b]) << "bucket " << b;
+
+   tracer.Clear();
+   EXPECT_FALSE(tracer.GetStatistics("Camera",
+            DeviceCallTracer::MethodSnapImage, stats));
+   std::ostringstream trace;
+   tracer.WriteChromeTrace(trace);
+   EXPECT_EQ(0u, CountOccurrences(trace.str(), "\"SnapImage\""));
+}
+
+
+TEST(DeviceCallTracerTests, AttributesLockWaitToNextCall)
+{
+   DeviceCallTracer tracer;
+   tracer.Enable(true);
+   DeviceCallTracer::Device* device = tracer.RegisterDevice("Stage");
+   const unsigned long long start = mm::CoreClock::MonotonicNs();
+   tracer.RecordLockWait(start, start + 3000000);
+   {
+      DeviceCallTracer::Call call(device, DeviceCallTracer::MethodSetPosition);
+   }
+   {
+      DeviceCallTracer::Call call(device, DeviceCallTracer::MethodSetPosition);
+   }
+
+   DeviceCallTracer::MethodStatistics stats;
+   ASSERT_TRUE(tracer.GetStatistics("Stage",
+            DeviceCallTracer::MethodSetPosition, stats));
+   EXPECT_EQ(2u, stats.count);
+   EXPECT_DOUBLE_EQ(1.5, stats.meanLockWaitMs);
+
+   std::ostringstream trace;
+   tracer.WriteChromeTrace(trace);
+   EXPECT_EQ(1u, CountOccurrences(trace.str(), "\"Module lock wait\""));
+   EXPECT_EQ(2u, CountOccurrences(trace.str(), "\"SetPosition\""));
+}
+
+
+TEST(DeviceCallTracerTests, TracesEachThreadSeparately)
+{
+   DeviceCallTracer tracer;
+   tracer.Enable(true);
+   DeviceCallTracer::Device* device = tracer.RegisterDevice("Shutter \"A\"");
+
+   const unsigned threadCount = 4, callsPerThread = 1000;
+   boost::thread_group threads;
+   for (unsigned i = 0; i < threadCount; ++i)
+      threads.create_thread(boost::bind(&MakeCalls, device, callsPerThread));
+   threads.join_all();
+
+   DeviceCallTracer::MethodStatistics stats;
+   ASSERT_TRUE(tracer.GetStatistics("Shutter \"A\"",
+            DeviceCallTracer::MethodBusy, stats));
+   EXPECT_EQ(threadCount * callsPerThread, stats.count);
+
+   std::ostringstream out;
+   tracer.WriteChromeTrace(out);
+   const std::string trace = out.str();
+   EXPECT_EQ(threadCount, CountOccurrences(trace, "\"thread_name\""));
+   EXPECT_EQ(threadCount * callsPerThread,
+         CountOccurrences(trace, "\"cat\":\"Shutter \\\"A\\\"\""));
+}
+
+
+// Threads hand their buffers back when they exit, so that any number of
+// threads, though not more than 256 at once, have their events traced
+TEST(DeviceCallTracerTests, ReusesBuffersOfExitedThreads)
+{
+   DeviceCallTracer tracer;
+   tracer.Enable(true);
+   DeviceCallTracer::Device* device = tracer.RegisterDevice("Stage");
+
+   const unsigned threadCount = 300, callsPerThread = 2;
+   for (unsigned i = 0; i < threadCount; ++i)
+   {
+      boost::thread thread(boost::bind(&MakeCalls, device, callsPerThread));
+      thread.join();
+   }
+
+   std::ostringstream out;
+   tracer.WriteChromeTrace(out);
+   const std::string trace = out.str();
+   EXPECT_EQ(threadCount, CountOccurrences(trace, "\"thread_name\""));
+   EXPECT_EQ(threadCount * callsPerThread, CountOccurrences(trace, "\"Busy\""));
+}
+
+TEST(DeviceCallTracerTests, KeepsMostRecentEventsOfThread)
+{
+   DeviceCallTracer tracer;
+   tracer.Enable(true);
+   DeviceCallTracer::Device* device = tracer.RegisterDevice("XY");
+   MakeCalls(device, 20000);
+
+   std::ostringstream trace;
+   tracer.WriteChromeTrace(trace);
+   // The oldest event in a full buffer is dropped, as it is the next to be
+   // overwritten
+   EXPECT_EQ(16383u, CountOccurrences(trace.str(), "\"Busy\""));
+}
+
+
+TEST(DeviceCallTracerTests, CoreAPI)
+{
+   CMMCore core;
+   EXPECT_FALSE(core.isDeviceCallTracingEnabled());
+   core.enableDeviceCallTracing(true);
+   EXPECT_TRUE(core.isDeviceCallTracingEnabled());
+
+   EXPECT_TRUE(core.getTracedDeviceCallMethods("Camera").empty());
+   EXPECT_EQ(0, core.getDeviceCallCount("Camera", "SnapImage"));
+   EXPECT_EQ(bucketCount, core.getDeviceCallLatencyHistogram("Camera", "SnapImage").size());
+   EXPECT_EQ(0.0, core.getDeviceCallMeanLatencyMs("Camera", "SnapImage"));
+   EXPECT_THROW(core.getDeviceCallCount("Camera", "NoSuchMethod"), CMMError);
+   EXPECT_THROW(core.saveDeviceCallTrace(0), CMMError);
+}
+
+
+int main(int argc, char** argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
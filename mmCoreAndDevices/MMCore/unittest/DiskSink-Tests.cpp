@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+
+#include "DiskSink.h"
+#include "../MMDevice/ImageMetadata.h"
+
+#include <boost/cstdint.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+std::vector<char> ReadFile(const std::string& path)
+{
+   std::vector<char> data;
+   std::FILE* f = std::fopen(path.c_str(), "rb");
+   if (!f)
+      return data;
+   char buf[65536];
+   std::size_t n;
+   while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0)
+      data.insert(data.end(), buf, buf + n);
+   std::fclose(f);
+   return data;
+}
+
+template <typename T>
+T ReadValue(const std::vector<char>& data, std::size_t& pos)
+{
+   T value;
+   std::memcpy(&value, &data[pos], sizeof(T));
+   pos += sizeof(T);
+   return value;
+}
+
+} // anonymous namespace
+
+
+TEST(DiskSinkTests, WritesRawStackAndIndex)
+{
+   const std::string prefix = "DiskSink-Tests-stream";
+   const unsigned width = 1000, height = 999, frameCount = 40;
+   const std::size_t frameBytes = width * height * 2;
+
+   DiskSink sink;
+   sink.Start(prefix);
+   ASSERT_TRUE(sink.IsActive());
+
+   std::vector<unsigned char> frame(frameBytes);
+   for (unsigned i = 0; i < frameCount; ++i)
+   {
+      std::memset(&frame[0], static_cast<int>(i + 1), frameBytes);
+      Metadata md;
+      md.PutImageTag("Frame", static_cast<long>(i));
+      sink.WriteFrame(&frame[0], frameBytes, width, height, 2, 1, 0, md);
+   }
+   ASSERT_TRUE(sink.Stop());
+   EXPECT_FALSE(sink.IsActive());
+
+   const boost::uint64_t written = sink.GetWrittenFrameCount();
+   EXPECT_EQ(frameCount, written + sink.GetDroppedFrameCount());
+   ASSERT_GT(written, 0u);
+
+   std::vector<char> raw = ReadFile(prefix + ".raw");
+   ASSERT_EQ(written * frameBytes, raw.size());
+
+   std::vector<char> index = ReadFile(prefix + ".idx");
+   ASSERT_GE(index.size(), 16u);
+   EXPECT_EQ(0, std::memcmp(&index[0], "MMRAWIDX", 8));
+   std::size_t pos = 8;
+   EXPECT_EQ(1u, ReadValue<boost::uint32_t>(index, pos));
+   ReadValue<boost::uint32_t>(index, pos);
+
+   for (boost::uint64_t n = 0; n < written; ++n)
+   {
+      const std::size_t recordStart = pos;
+      boost::uint32_t recordBytes = ReadValue<boost::uint32_t>(index, pos);
+      EXPECT_EQ(0u, ReadValue<boost::uint32_t>(index, pos));
+      EXPECT_EQ(n, ReadValue<boost::uint64_t>(index, pos));
+      boost::uint64_t offset = ReadValue<boost::uint64_t>(index, pos);
+      EXPECT_EQ(n * frameBytes, offset);
+      EXPECT_EQ(frameBytes, ReadValue<boost::uint64_t>(index, pos));
+      EXPECT_EQ(width, ReadValue<boost::uint32_t>(index, pos));
+      EXPECT_EQ(height, ReadValue<boost::uint32_t>(index, pos));
+      EXPECT_EQ(2u, ReadValue<boost::uint32_t>(index, pos));
+      EXPECT_EQ(1u, ReadValue<boost::uint32_t>(index, pos));
+
+      Metadata md;
+      md.Restore(std::string(&index[pos], recordStart + recordBytes - pos).c_str());
+      pos = recordStart + recordBytes;
+
+      const long frameNr = atol(md.GetSingleTag("Frame").GetValue().c_str());
+      EXPECT_EQ(static_cast<char>(frameNr + 1), raw[offset]);
+      EXPECT_EQ(static_cast<char>(frameNr + 1), raw[offset + frameBytes - 1]);
+   }
+   EXPECT_EQ(index.size(), pos);
+
+   std::remove((prefix + ".raw").c_str());
+   std::remove((prefix + ".idx").c_str());
+}
+
+
+TEST(DiskSinkTests, StopWithoutFrames)
+{
+   const std::string prefix = "DiskSink-Tests-empty";
+   DiskSink sink;
+   sink.Start(prefix);
+   ASSERT_TRUE(sink.Stop());
+   EXPECT_EQ(0u, ReadFile(prefix + ".raw").size());
+   EXPECT_EQ(16u, ReadFile(prefix + ".idx").size());
+   std::remove((prefix + ".raw").c_str());
+   std::remove((prefix + ".idx").c_str());
+}
+
+
+int main(int argc, char **argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
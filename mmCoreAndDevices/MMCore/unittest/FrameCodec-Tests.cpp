@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+
+#include "FrameCodec.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+std::vector<unsigned char> RandomBytes(std::size_t n, unsigned mask)
+{
+   std::vector<unsigned char> bytes(n);
+   unsigned state = 12345;
+   for (std::size_t i = 0; i < n; ++i)
+   {
+      state = state * 1103515245 + 12345;
+      bytes[i] = static_cast<unsigned char>((state >> 16) & mask);
+   }
+   return bytes;
+}
+
+// 16-bit samples using 10 bits
+std::vector<unsigned char> TenBitSamples(std::size_t count)
+{
+   std::vector<unsigned char> bytes = RandomBytes(2 * count, 0xff);
+   for (std::size_t i = 1; i < bytes.size(); i += 2)
+      bytes[i] &= 0x03;
+   return bytes;
+}
+
+std::size_t RoundTrip(const std::vector<unsigned char>& data)
+{
+   std::vector<unsigned char> compressed(
+         FrameCodec::MaxCompressedBytes(data.size()));
+   const std::size_t size = FrameCodec::Compress(&compressed[0],
+         compressed.size(), data.empty() ? 0 : &data[0], data.size());
+   EXPECT_GT(size, 0u);
+
+   std::vector<unsigned char> decompressed(data.size() + 1);
+   EXPECT_TRUE(FrameCodec::Decompress(&decompressed[0], data.size(),
+            &compressed[0], size));
+   decompressed.resize(data.size());
+   EXPECT_TRUE(data == decompressed);
+   return size;
+}
+
+} // anonymous namespace
+
+
+TEST(FrameCodecTests, RoundTrips)
+{
+   const std::size_t sizes[] = { 0, 1, 12, 13, 100, 70000, 262144 };
+   for (unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+   {
+      SCOPED_TRACE(sizes[i]);
+      RoundTrip(std::vector<unsigned char>(sizes[i], 7));
+      RoundTrip(RandomBytes(sizes[i], 0xff));
+      RoundTrip(RandomBytes(sizes[i], 0x03));
+   }
+}
+
+
+TEST(FrameCodecTests, CompressesRepeatedData)
+{
+   EXPECT_LT(RoundTrip(std::vector<unsigned char>(262144, 0)), 1100u);
+}
+
+
+TEST(FrameCodecTests, RejectsIncompressibleDataThatDoesNotFit)
+{
+   const std::vector<unsigned char> data = RandomBytes(4096, 0xff);
+   std::vector<unsigned char> compressed(data.size() - 1);
+   EXPECT_EQ(0u, FrameCodec::Compress(&compressed[0], compressed.size(),
+            &data[0], data.size()));
+}
+
+
+TEST(FrameCodecTests, ShuffleRoundTrips)
+{
+   // Sizes that are not a multiple of the sample size
+   const std::vector<unsigned char> data = RandomBytes(1003, 0xff);
+   for (unsigned elementBytes = 1; elementBytes <= 8; elementBytes *= 2)
+   {
+      std::vector<unsigned char> shuffled(data.size()), unshuffled(data.size());
+      FrameCodec::Shuffle(&shuffled[0], &data[0], data.size(), elementBytes);
+      FrameCodec::Unshuffle(&unshuffled[0], &shuffled[0], data.size(),
+            elementBytes);
+      EXPECT_TRUE(data == unshuffled);
+   }
+
+   const unsigned char samples[] = { 1, 2, 3, 4, 5, 6 };
+   unsigned char shuffled[6];
+   FrameCodec::Shuffle(shuffled, samples, 6, 2);
+   const unsigned char expected[] = { 1, 3, 5, 2, 4, 6 };
+   EXPECT_EQ(0, memcmp(expected, shuffled, 6));
+}
+
+
+TEST(FrameCodecTests, ShuffleImprovesCompression)
+{
+   const std::vector<unsigned char> data = TenBitSamples(131072);
+   std::vector<unsigned char> shuffled(data.size());
+   FrameCodec::Shuffle(&shuffled[0], &data[0], data.size(), 2);
+   // The high bytes compress; the noisy low bytes do not
+   EXPECT_LT(RoundTrip(shuffled), data.size() * 7 / 8);
+   EXPECT_GT(RoundTrip(data), data.size() * 99 / 100);
+}
+
+
+TEST(FrameCodecTests, DecodesLZ4Blocks)
+{
+   // 3 literals, a match of 6 at offset 3, and a last literal
+   const unsigned char block[] = { 0x32, 'a', 'b', 'c', 3, 0, 0x10, 'x' };
+   char out[10];
+   ASSERT_TRUE(FrameCodec::Decompress(reinterpret_cast<unsigned char*>(out),
+            10, block, sizeof(block)));
+   EXPECT_EQ("abcabcabcx", std::string(out, 10));
+
+   EXPECT_FALSE(FrameCodec::Decompress(reinterpret_cast<unsigned char*>(out),
+            9, block, sizeof(block)));
+   EXPECT_FALSE(FrameCodec::Decompress(reinterpret_cast<unsigned char*>(out),
+            10, block, 5));
+   // Offset beyond the start of the output
+   const unsigned char bad[] = { 0x30, 'a', 'b', 'c', 4, 0, 0x00 };
+   EXPECT_FALSE(FrameCodec::Decompress(reinterpret_cast<unsigned char*>(out),
+            10, bad, sizeof(bad)));
+}
+
+
+int main(int argc, char** argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+
+#include "FrameCombiner.h"
+#include "../MMDevice/ImageMetadata.h"
+
+#include <boost/cstdint.hpp>
+
+#include <string>
+#include <vector>
+
+using boost::uint16_t;
+
+
+namespace {
+
+const unsigned width = 5, height = 3;
+
+FrameCombiner::FramePtr Add16(FrameCombiner& combiner,
+      const std::string& label, uint16_t value, uint16_t firstPixel)
+{
+   std::vector<uint16_t> pixels(width * height, value);
+   pixels[0] = firstPixel;
+   Metadata md;
+   md.PutImageTag("Camera", label);
+   md.PutImageTag<long>("Value", value);
+   return combiner.AddFrame(label,
+         reinterpret_cast<const unsigned char*>(&pixels[0]),
+         width, height, 2, 1, md);
+}
+
+uint16_t Pixel16(const FrameCombiner::FramePtr& frame, std::size_t i)
+{
+   return reinterpret_cast<const uint16_t*>(&frame->pixels[0])[i];
+}
+
+} // anonymous namespace
+
+
+TEST(FrameCombinerTests, ModeNames)
+{
+   FrameCombiner::Mode mode;
+   EXPECT_TRUE(FrameCombiner::ParseMode("Sum", mode));
+   EXPECT_EQ(FrameCombiner::Sum, mode);
+   EXPECT_EQ("Sum", FrameCombiner::GetModeName(mode));
+   EXPECT_TRUE(FrameCombiner::ParseMode("Min", mode));
+   EXPECT_EQ("Min", FrameCombiner::GetModeName(mode));
+   EXPECT_FALSE(FrameCombiner::ParseMode("Median", mode));
+}
+
+
+TEST(FrameCombinerTests, MeanOfEveryNFrames)
+{
+   FrameCombiner combiner;
+   combiner.Enable(3, FrameCombiner::Mean);
+
+   EXPECT_FALSE(Add16(combiner, "Cam", 100, 0));
+   EXPECT_FALSE(Add16(combiner, "Cam", 200, 1));
+   FrameCombiner::FramePtr frame = Add16(combiner, "Cam", 301, 1);
+   ASSERT_TRUE(frame);
+   EXPECT_EQ(width, frame->width);
+   EXPECT_EQ(height, frame->height);
+   EXPECT_EQ(2u, frame->byteDepth);
+   EXPECT_EQ(200, Pixel16(frame, 1));
+   EXPECT_EQ(1, Pixel16(frame, 0)); // 2/3 rounds up
+   EXPECT_EQ("100", frame->md.GetSingleTag("Value").GetValue());
+   EXPECT_EQ("3", frame->md.GetSingleTag("FrameCombiner-Count").GetValue());
+   EXPECT_EQ("Mean", frame->md.GetSingleTag("FrameCombiner-Mode").GetValue());
+
+   EXPECT_FALSE(Add16(combiner, "Cam", 7, 0));
+   EXPECT_EQ(4u, combiner.GetInputFrameCount());
+   EXPECT_EQ(1u, combiner.GetOutputFrameCount());
+}
+
+
+TEST(FrameCombinerTests, SumSaturatesInCameraType)
+{
+   FrameCombiner combiner;
+   combiner.Enable(2, FrameCombiner::Sum);
+
+   EXPECT_FALSE(Add16(combiner, "Cam", 65535, 0));
+   FrameCombiner::FramePtr frame = Add16(combiner, "Cam", 65535, 3);
+   ASSERT_TRUE(frame);
+   EXPECT_EQ(2u, frame->byteDepth);
+   EXPECT_EQ(65535, Pixel16(frame, 1));
+   EXPECT_EQ(3, Pixel16(frame, 0));
+
+   std::vector<unsigned char> a(width * height * 4, 200), b(width * height * 4, 50);
+   b[1] = 56;
+   EXPECT_FALSE(combiner.AddFrame("Cam", &a[0], width, height, 4, 4,
+            Metadata()));
+   frame = combiner.AddFrame("Cam", &b[0], width, height, 4, 4, Metadata());
+   ASSERT_TRUE(frame);
+   EXPECT_EQ(4u, frame->byteDepth);
+   EXPECT_EQ(250, frame->pixels[0]);
+   EXPECT_EQ(255, frame->pixels[1]);
+}
+
+
+TEST(FrameCombinerTests, MaxAndMinProjection)
+{
+   FrameCombiner combiner;
+   combiner.Enable(2, FrameCombiner::Max);
+   Add16(combiner, "Cam", 10, 50);
+   FrameCombiner::FramePtr frame = Add16(combiner, "Cam", 20, 5);
+   ASSERT_TRUE(frame);
+   EXPECT_EQ(50, Pixel16(frame, 0));
+   EXPECT_EQ(20, Pixel16(frame, 1));
+
+   combiner.Enable(2, FrameCombiner::Min);
+   std::vector<unsigned char> a(width * height * 4, 9), b(width * height * 4, 4);
+   a[2] = 1;
+   EXPECT_FALSE(combiner.AddFrame("Cam", &a[0], width, height, 4, 4,
+            Metadata()));
+   frame = combiner.AddFrame("Cam", &b[0], width, height, 4, 4, Metadata());
+   ASSERT_TRUE(frame);
+   EXPECT_EQ(4u, frame->byteDepth);
+   EXPECT_EQ(4, frame->pixels[0]);
+   EXPECT_EQ(1, frame->pixels[2]);
+}
+
+
+TEST(FrameCombinerTests, CamerasAreCombinedSeparately)
+{
+   FrameCombiner combiner;
+   combiner.Enable(2, FrameCombiner::Mean);
+   EXPECT_FALSE(Add16(combiner, "CamA", 10, 0));
+   EXPECT_FALSE(Add16(combiner, "CamB", 100, 0));
+   FrameCombiner::FramePtr a = Add16(combiner, "CamA", 20, 0);
+   FrameCombiner::FramePtr b = Add16(combiner, "CamB", 200, 0);
+   ASSERT_TRUE(a);
+   ASSERT_TRUE(b);
+   EXPECT_EQ(15, Pixel16(a, 1));
+   EXPECT_EQ(150, Pixel16(b, 1));
+   EXPECT_EQ("CamB", b->md.GetSingleTag("Camera").GetValue());
+}
+
+
+TEST(FrameCombinerTests, HeldFrameIsNotOverwritten)
+{
+   FrameCombiner combiner;
+   combiner.Enable(1, FrameCombiner::Mean);
+   FrameCombiner::FramePtr first = Add16(combiner, "Cam", 1, 0);
+   FrameCombiner::FramePtr second = Add16(combiner, "Cam", 2, 0);
+   ASSERT_TRUE(first);
+   ASSERT_TRUE(second);
+   EXPECT_EQ(1, Pixel16(first, 1));
+   EXPECT_EQ(2, Pixel16(second, 1));
+}
+
+
+TEST(FrameCombinerTests, SizeChangeAndResetRestartGroup)
+{
+   FrameCombiner combiner;
+   combiner.Enable(2, FrameCombiner::Mean);
+   std::vector<unsigned char> small(4, 50);
+   EXPECT_FALSE(combiner.AddFrame("Cam", &small[0], 2, 2, 1, 1, Metadata()));
+   EXPECT_FALSE(Add16(combiner, "Cam", 10, 0));
+   FrameCombiner::FramePtr frame = Add16(combiner, "Cam", 20, 0);
+   ASSERT_TRUE(frame);
+   EXPECT_EQ(15, Pixel16(frame, 1));
+
+   EXPECT_FALSE(Add16(combiner, "Cam", 10, 0));
+   combiner.Reset();
+   EXPECT_FALSE(Add16(combiner, "Cam", 30, 0));
+   frame = Add16(combiner, "Cam", 40, 0);
+   ASSERT_TRUE(frame);
+   EXPECT_EQ(35, Pixel16(frame, 1));
+}
+
+
+int main(int argc, char** argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+
+#include "CircularBuffer.h"
+#include "FrameDemultiplexer.h"
+#include "../MMDevice/ImageMetadata.h"
+#include "../MMDevice/MMDeviceConstants.h"
+
+#include <boost/cstdint.hpp>
+
+#include <string>
+#include <vector>
+
+using boost::uint16_t;
+
+
+namespace {
+
+// 4 x 3 image with pixel (x, y) = 10 * y + x
+//     0  1  2  3
+//    10 11 12 13
+//    20 21 22 23
+const unsigned srcWidth = 4, srcHeight = 3;
+
+std::vector<uint16_t> Source()
+{
+   std::vector<uint16_t> pixels;
+   for (unsigned y = 0; y < srcHeight; ++y)
+      for (unsigned x = 0; x < srcWidth; ++x)
+         pixels.push_back(static_cast<uint16_t>(10 * y + x));
+   return pixels;
+}
+
+FrameDemultiplexer::Region MakeRegion(unsigned x, unsigned y, unsigned w,
+      unsigned h, FrameDemultiplexer::Transform transform)
+{
+   FrameDemultiplexer::Region region;
+   region.x = x;
+   region.y = y;
+   region.width = w;
+   region.height = h;
+   region.transform = transform;
+   return region;
+}
+
+std::vector<uint16_t> Copy(const FrameDemultiplexer::Region& region)
+{
+   std::vector<uint16_t> src = Source();
+   std::vector<uint16_t> dest(region.width * region.height);
+   FrameDemultiplexer::CopyRegion(region,
+         reinterpret_cast<const unsigned char*>(&src[0]), srcWidth, 2,
+         reinterpret_cast<unsigned char*>(&dest[0]));
+   return dest;
+}
+
+std::vector<uint16_t> Expected(const uint16_t* values, std::size_t n)
+{
+   return std::vector<uint16_t>(values, values + n);
+}
+
+} // anonymous namespace
+
+
+TEST(FrameDemultiplexerTests, CopiesWithoutTransform)
+{
+   const uint16_t expected[] = { 11, 12, 13, 21, 22, 23 };
+   EXPECT_EQ(Expected(expected, 6),
+         Copy(MakeRegion(1, 1, 3, 2, FrameDemultiplexer::None)));
+}
+
+
+TEST(FrameDemultiplexerTests, Flips)
+{
+   const uint16_t horizontal[] = { 2, 1, 0, 12, 11, 10 };
+   EXPECT_EQ(Expected(horizontal, 6),
+         Copy(MakeRegion(0, 0, 3, 2, FrameDemultiplexer::FlipHorizontal)));
+   const uint16_t vertical[] = { 10, 11, 12, 0, 1, 2 };
+   EXPECT_EQ(Expected(vertical, 6),
+         Copy(MakeRegion(0, 0, 3, 2, FrameDemultiplexer::FlipVertical)));
+   const uint16_t rotated180[] = { 12, 11, 10, 2, 1, 0 };
+   EXPECT_EQ(Expected(rotated180, 6),
+         Copy(MakeRegion(0, 0, 3, 2, FrameDemultiplexer::Rotate180)));
+}
+
+
+TEST(FrameDemultiplexerTests, Rotations)
+{
+   // 3 x 2 region at (1, 1) becomes a 2 x 3 channel
+   const uint16_t clockwise[] = { 21, 11, 22, 12, 23, 13 };
+   EXPECT_EQ(Expected(clockwise, 6),
+         Copy(MakeRegion(1, 1, 3, 2, FrameDemultiplexer::Rotate90)));
+   const uint16_t counterclockwise[] = { 13, 23, 12, 22, 11, 21 };
+   EXPECT_EQ(Expected(counterclockwise, 6),
+         Copy(MakeRegion(1, 1, 3, 2, FrameDemultiplexer::Rotate270)));
+}
+
+
+TEST(FrameDemultiplexerTests, LargeRotationMatchesDefinition)
+{
+   // Larger than the copy tiles, with partial tiles at the edges
+   const unsigned w = 70, h = 45;
+   std::vector<unsigned char> src(w * h);
+   for (std::size_t i = 0; i < src.size(); ++i)
+      src[i] = static_cast<unsigned char>(i * 7);
+   std::vector<unsigned char> dest(w * h);
+   FrameDemultiplexer::CopyRegion(
+         MakeRegion(0, 0, w, h, FrameDemultiplexer::Rotate90),
+         &src[0], w, 1, &dest[0]);
+   for (unsigned r = 0; r < w; ++r)
+      for (unsigned c = 0; c < h; ++c)
+         ASSERT_EQ(src[(h - 1 - c) * w + r], dest[r * h + c]);
+}
+
+
+TEST(FrameDemultiplexerTests, RejectsRegionsOfDifferentSizes)
+{
+   FrameDemultiplexer demux;
+   std::vector<FrameDemultiplexer::Region> regions;
+   regions.push_back(MakeRegion(0, 0, 2, 3, FrameDemultiplexer::None));
+   regions.push_back(MakeRegion(2, 0, 2, 2, FrameDemultiplexer::None));
+   EXPECT_THROW(demux.Enable(regions), CMMError);
+   EXPECT_FALSE(demux.IsEnabled());
+
+   // Same size once rotated
+   regions[1] = MakeRegion(0, 0, 3, 2, FrameDemultiplexer::Rotate90);
+   demux.Enable(regions);
+   EXPECT_TRUE(demux.IsEnabled());
+   EXPECT_EQ(2u, demux.GetChannelCount());
+   EXPECT_EQ(2u, demux.GetChannelWidth());
+   EXPECT_EQ(3u, demux.GetChannelHeight());
+}
+
+
+TEST(FrameDemultiplexerTests, InsertsChannelsIntoBuffer)
+{
+   FrameDemultiplexer demux;
+   std::vector<FrameDemultiplexer::Region> regions;
+   regions.push_back(MakeRegion(0, 0, 2, 3, FrameDemultiplexer::None));
+   regions.push_back(MakeRegion(2, 0, 2, 3, FrameDemultiplexer::FlipHorizontal));
+   demux.Enable(regions);
+
+   CircularBuffer cbuf(1);
+   ASSERT_TRUE(cbuf.Initialize(2, 2, 3, 2));
+   std::vector<uint16_t> src = Source();
+   Metadata md;
+   md.PutImageTag("Camera", "Cam");
+   for (int frame = 0; frame < 2; ++frame)
+      ASSERT_TRUE(demux.InsertImage(cbuf,
+               reinterpret_cast<const unsigned char*>(&src[0]),
+               srcWidth, srcHeight, 2, 1, md));
+   ASSERT_EQ(2, cbuf.GetRemainingImageCount());
+
+   const mm::ImgBuffer* ch0 = cbuf.GetNthFromTopImageBuffer(1, 0);
+   const mm::ImgBuffer* ch1 = cbuf.GetNthFromTopImageBuffer(1, 1);
+   ASSERT_TRUE(ch0 != 0);
+   ASSERT_TRUE(ch1 != 0);
+   const uint16_t* p0 = reinterpret_cast<const uint16_t*>(ch0->GetPixels());
+   const uint16_t* p1 = reinterpret_cast<const uint16_t*>(ch1->GetPixels());
+   EXPECT_EQ(0, p0[0]);
+   EXPECT_EQ(21, p0[5]);
+   EXPECT_EQ(3, p1[0]);
+   EXPECT_EQ(22, p1[5]);
+   EXPECT_EQ("1", ch1->GetMetadata().GetSingleTag(
+            MM::g_Keyword_CameraChannelIndex).GetValue());
+
+   // Image numbers count frames, not channels
+   cbuf.GetNextImageBuffer(0);
+   const mm::ImgBuffer* next = cbuf.GetNthFromTopImageBuffer(0, 1);
+   ASSERT_TRUE(next != 0);
+   EXPECT_EQ("1", next->GetMetadata().GetSingleTag(
+            MM::g_Keyword_Metadata_ImageNumber).GetValue());
+
+   // Regions outside the image are rejected
+   EXPECT_THROW(demux.InsertImage(cbuf,
+            reinterpret_cast<const unsigned char*>(&src[0]),
+            3, 3, 2, 1, md), CMMError);
+}
+
+
+int main(int argc, char** argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
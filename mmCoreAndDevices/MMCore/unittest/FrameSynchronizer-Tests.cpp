@@ -0,0 +1,225 @@
+#include <gtest/gtest.h>
+
+#include "CircularBuffer.h"
+#include "FrameSynchronizer.h"
+#include "../MMDevice/ImageMetadata.h"
+#include "../MMDevice/MMDeviceConstants.h"
+
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <string>
+#include <vector>
+
+
+namespace {
+
+const unsigned width = 8, height = 4;
+
+std::vector<std::string> Labels()
+{
+   std::vector<std::string> labels;
+   labels.push_back("CamA");
+   labels.push_back("CamB");
+   return labels;
+}
+
+bool Insert(FrameSynchronizer& sync, CircularBuffer& cbuf,
+      const std::string& label, unsigned char value,
+      const char* tag, const char* tagValue)
+{
+   std::vector<unsigned char> pixels(width * height, value);
+   Metadata md;
+   md.PutImageTag("Camera", label);
+   if (tag)
+      md.PutImageTag(tag, tagValue);
+   return sync.InsertImage(cbuf, label, &pixels[0], width, height, 1, 1, md,
+         false);
+}
+
+// Large enough to fill the buffer after a few frames
+const unsigned largeWidth = 512, largeHeight = 512;
+
+bool InsertLarge(FrameSynchronizer& sync, CircularBuffer& cbuf,
+      const std::string& label, unsigned char value,
+      bool clearOnOverflow = false)
+{
+   std::vector<unsigned char> pixels(largeWidth * largeHeight, value);
+   Metadata md;
+   md.PutImageTag("Camera", label);
+   return sync.InsertImage(cbuf, label, &pixels[0], largeWidth, largeHeight,
+         1, 1, md, clearOnOverflow);
+}
+
+// Inserts matched pairs until the buffer is full
+unsigned long Fill(FrameSynchronizer& sync, CircularBuffer& cbuf)
+{
+   const unsigned long capacity = cbuf.GetSize();
+   for (unsigned long i = 0; i < capacity; ++i)
+   {
+      EXPECT_TRUE(InsertLarge(sync, cbuf, "CamA", 1));
+      EXPECT_TRUE(InsertLarge(sync, cbuf, "CamB", 2));
+   }
+   EXPECT_EQ(capacity, cbuf.GetRemainingImageCount());
+   return capacity;
+}
+
+void ExpectNextFrame(CircularBuffer& cbuf, unsigned char a, unsigned char b)
+{
+   const mm::ImgBuffer* chA = cbuf.GetNthFromTopImageBuffer(
+         cbuf.GetRemainingImageCount() - 1, 0);
+   const mm::ImgBuffer* chB = cbuf.GetNthFromTopImageBuffer(
+         cbuf.GetRemainingImageCount() - 1, 1);
+   ASSERT_TRUE(chA != 0);
+   ASSERT_TRUE(chB != 0);
+   EXPECT_EQ(a, chA->GetPixels()[0]);
+   EXPECT_EQ(b, chB->GetPixels()[0]);
+   EXPECT_EQ("CamA", chA->GetMetadata().GetSingleTag("Camera").GetValue());
+   EXPECT_EQ("CamB", chB->GetMetadata().GetSingleTag("Camera").GetValue());
+   EXPECT_EQ("1", chB->GetMetadata().GetSingleTag(
+            MM::g_Keyword_CameraChannelIndex).GetValue());
+   cbuf.GetNextImageBuffer(0);
+}
+
+} // anonymous namespace
+
+
+TEST(FrameSynchronizerTests, MatchesByImageNumber)
+{
+   CircularBuffer cbuf(1);
+   ASSERT_TRUE(cbuf.Initialize(2, width, height, 1));
+   FrameSynchronizer sync;
+   sync.Enable(Labels(), FrameSynchronizer::MatchImageNumber, 0.0, 10000.0);
+
+   const char* n = MM::g_Keyword_Metadata_ImageNumber;
+   EXPECT_TRUE(Insert(sync, cbuf, "CamA", 10, n, "100"));
+   EXPECT_EQ(0u, cbuf.GetRemainingImageCount());
+   EXPECT_TRUE(Insert(sync, cbuf, "CamA", 11, n, "101"));
+   EXPECT_TRUE(Insert(sync, cbuf, "CamB", 20, n, "7"));
+   EXPECT_EQ(1u, cbuf.GetRemainingImageCount());
+
+   // Frame 1 of CamB is lost
+   EXPECT_TRUE(Insert(sync, cbuf, "CamA", 12, n, "102"));
+   EXPECT_TRUE(Insert(sync, cbuf, "CamB", 22, n, "9"));
+   EXPECT_EQ(2u, cbuf.GetRemainingImageCount());
+   EXPECT_EQ(2u, sync.GetMatchedFrameCount());
+   EXPECT_EQ(1u, sync.GetDroppedFrameCount());
+
+   ExpectNextFrame(cbuf, 10, 20);
+   ExpectNextFrame(cbuf, 12, 22);
+}
+
+
+TEST(FrameSynchronizerTests, MatchesByTimestampWithinSkew)
+{
+   CircularBuffer cbuf(1);
+   ASSERT_TRUE(cbuf.Initialize(2, width, height, 1));
+   FrameSynchronizer sync;
+   sync.Enable(Labels(), FrameSynchronizer::MatchTimestamp, 1.0, 10000.0);
+
+   const char* t = MM::g_Keyword_Elapsed_Time_ms;
+   EXPECT_TRUE(Insert(sync, cbuf, "CamA", 10, t, "0.0"));
+   EXPECT_TRUE(Insert(sync, cbuf, "CamA", 11, t, "10.0"));
+   EXPECT_TRUE(Insert(sync, cbuf, "CamA", 12, t, "20.0"));
+   EXPECT_TRUE(Insert(sync, cbuf, "CamB", 20, t, "0.5"));
+   EXPECT_TRUE(Insert(sync, cbuf, "CamB", 22, t, "20.3"));
+   EXPECT_EQ(2u, sync.GetMatchedFrameCount());
+   EXPECT_EQ(1u, sync.GetDroppedFrameCount());
+
+   ExpectNextFrame(cbuf, 10, 20);
+   ExpectNextFrame(cbuf, 12, 22);
+}
+
+
+TEST(FrameSynchronizerTests, PassesThroughOtherCameras)
+{
+   CircularBuffer cbuf(1);
+   ASSERT_TRUE(cbuf.Initialize(1, width, height, 1));
+   FrameSynchronizer sync;
+   sync.Enable(Labels(), FrameSynchronizer::MatchImageNumber, 0.0, 10000.0);
+
+   EXPECT_TRUE(Insert(sync, cbuf, "CamC", 5, 0, 0));
+   EXPECT_EQ(1u, cbuf.GetRemainingImageCount());
+   EXPECT_EQ(0u, sync.GetMatchedFrameCount());
+
+   sync.Disable();
+   EXPECT_TRUE(Insert(sync, cbuf, "CamA", 6, 0, 0));
+   EXPECT_EQ(2u, cbuf.GetRemainingImageCount());
+}
+
+
+// Only the frame that completes a rejected set is reported, and the frames
+// that follow are still matched with their partners
+TEST(FrameSynchronizerTests, OverflowRejectsTheCompletingFrame)
+{
+   CircularBuffer cbuf(1);
+   ASSERT_TRUE(cbuf.Initialize(2, largeWidth, largeHeight, 1));
+   cbuf.SetOverflowPolicy(CircularBuffer::DropNewest);
+   FrameSynchronizer sync;
+   sync.Enable(Labels(), FrameSynchronizer::MatchImageNumber, 0.0, 10000.0);
+   const unsigned long capacity = Fill(sync, cbuf);
+
+   EXPECT_TRUE(InsertLarge(sync, cbuf, "CamA", 3));
+   EXPECT_FALSE(InsertLarge(sync, cbuf, "CamB", 4));
+   EXPECT_EQ(capacity, sync.GetMatchedFrameCount());
+   EXPECT_EQ(2u, sync.GetDroppedFrameCount());
+
+   for (unsigned long i = 0; i < capacity; ++i)
+      ExpectNextFrame(cbuf, 1, 2);
+   EXPECT_TRUE(InsertLarge(sync, cbuf, "CamA", 5));
+   EXPECT_TRUE(InsertLarge(sync, cbuf, "CamB", 6));
+   ExpectNextFrame(cbuf, 5, 6);
+}
+
+// Under the Clear policy the buffer is cleared and the set inserted once
+TEST(FrameSynchronizerTests, OverflowClearsTheBuffer)
+{
+   CircularBuffer cbuf(1);
+   ASSERT_TRUE(cbuf.Initialize(2, largeWidth, largeHeight, 1));
+   FrameSynchronizer sync;
+   sync.Enable(Labels(), FrameSynchronizer::MatchImageNumber, 0.0, 10000.0);
+   const unsigned long capacity = Fill(sync, cbuf);
+
+   EXPECT_TRUE(InsertLarge(sync, cbuf, "CamA", 3, true));
+   EXPECT_TRUE(InsertLarge(sync, cbuf, "CamB", 4, true));
+   EXPECT_EQ(1u, cbuf.GetRemainingImageCount());
+   EXPECT_EQ(capacity + 1, sync.GetMatchedFrameCount());
+   EXPECT_EQ(0u, sync.GetDroppedFrameCount());
+   ExpectNextFrame(cbuf, 3, 4);
+}
+
+// A set waiting for room does not hold up frames of the other cameras
+TEST(FrameSynchronizerTests, BlockedInsertDoesNotStallOtherCameras)
+{
+   CircularBuffer cbuf(1);
+   ASSERT_TRUE(cbuf.Initialize(2, largeWidth, largeHeight, 1));
+   cbuf.SetOverflowPolicy(CircularBuffer::Block);
+   cbuf.SetOverflowBlockTimeoutMs(1000.0);
+   FrameSynchronizer sync;
+   sync.Enable(Labels(), FrameSynchronizer::MatchImageNumber, 0.0, 10000.0);
+   const unsigned long capacity = Fill(sync, cbuf);
+
+   EXPECT_TRUE(InsertLarge(sync, cbuf, "CamA", 3));
+   boost::thread blocked(
+         boost::bind(&InsertLarge, boost::ref(sync), boost::ref(cbuf),
+            std::string("CamB"), 4, false));
+   boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+
+   const boost::posix_time::ptime start =
+      boost::posix_time::microsec_clock::universal_time();
+   EXPECT_TRUE(InsertLarge(sync, cbuf, "CamA", 5));
+   EXPECT_LT((boost::posix_time::microsec_clock::universal_time() - start)
+         .total_milliseconds(), 500);
+
+   blocked.join();
+   EXPECT_EQ(capacity, sync.GetMatchedFrameCount());
+   EXPECT_EQ(2u, sync.GetDroppedFrameCount());
+}
+
+
+int main(int argc, char **argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
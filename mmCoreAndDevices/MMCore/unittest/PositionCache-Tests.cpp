@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include "Devices/PositionCache.h"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread/thread.hpp>
+
+
+TEST(PositionCacheTests, ServesPositionsWithinMaxAge)
+{
+   PositionCache cache;
+   double x = -1.0, y = -1.0;
+   EXPECT_FALSE(cache.Get(1000.0, x, y));
+   EXPECT_EQ(0.0, cache.GetDefaultMaxAgeMs());
+
+   cache.Store(12.5, -3.0);
+   ASSERT_TRUE(cache.Get(1000.0, x, y));
+   EXPECT_EQ(12.5, x);
+   EXPECT_EQ(-3.0, y);
+
+   // A max age of 0 always asks for the device to be queried
+   EXPECT_FALSE(cache.Get(0.0, x, y));
+
+   boost::this_thread::sleep(boost::posix_time::milliseconds(20));
+   EXPECT_FALSE(cache.Get(5.0, x, y));
+   EXPECT_TRUE(cache.Get(1000.0, x, y));
+
+   cache.SetDefaultMaxAgeMs(-5.0);
+   EXPECT_EQ(0.0, cache.GetDefaultMaxAgeMs());
+   cache.SetDefaultMaxAgeMs(50.0);
+   EXPECT_EQ(50.0, cache.GetDefaultMaxAgeMs());
+}
+
+
+TEST(PositionCacheTests, NotServedWhileMoving)
+{
+   PositionCache cache;
+   double x, y;
+   cache.Store(1.0);
+   cache.MoveStarted();
+   EXPECT_TRUE(cache.IsMovePending());
+   EXPECT_FALSE(cache.Get(1000.0, x, y));
+
+   // Positions reported during the move are not served, even after it ends
+   cache.Store(2.0);
+   EXPECT_FALSE(cache.Get(1000.0, x, y));
+   cache.MoveCompleted();
+   EXPECT_FALSE(cache.IsMovePending());
+   EXPECT_FALSE(cache.Get(1000.0, x, y));
+
+   cache.Store(3.0);
+   ASSERT_TRUE(cache.Get(1000.0, x, y));
+   EXPECT_EQ(3.0, x);
+
+   // Completion without a pending move keeps the position
+   cache.MoveCompleted();
+   EXPECT_TRUE(cache.Get(1000.0, x, y));
+}
+
+
+int main(int argc, char** argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
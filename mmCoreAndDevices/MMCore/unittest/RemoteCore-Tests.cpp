@@ -0,0 +1,184 @@
+#include <gtest/gtest.h>
+
+#include "MMCore.h"
+#include "MMEventCallback.h"
+#include "../MMCoreRemote/RemoteCoreClient.h"
+
+#include <boost/lexical_cast.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace {
+
+std::string SocketPath(const char* test)
+{
+   return std::string("RemoteCore-Tests-") + test + "-" +
+      boost::lexical_cast<std::string>(getpid()) + ".sock";
+}
+
+class PropertyRecorder : public MMEventCallback
+{
+public:
+   virtual void onPropertyChanged(const char* name, const char* propName,
+         const char* propValue)
+   {
+      changes.push_back(std::string(name) + "." + propName + "=" + propValue);
+   }
+
+   std::vector<std::string> changes;
+};
+
+} // anonymous namespace
+
+
+TEST(RemoteCoreTests, CallsCore)
+{
+   const std::string path = SocketPath("Calls");
+   CMMCore core;
+   core.startRemoteCoreServer(path.c_str());
+   ASSERT_TRUE(core.isRemoteCoreServerRunning());
+
+   RemoteCoreClient client;
+   client.connect(path);
+   EXPECT_EQ(core.getVersionInfo(), client.getServerVersionInfo());
+   EXPECT_TRUE(client.getSharedMemoryName().empty());
+   EXPECT_EQ(core.getAPIVersionInfo(), client.getAPIVersionInfo());
+   client.ping();
+   EXPECT_EQ(1, core.getRemoteCoreServerConnectionCount());
+
+   const std::vector<std::string> devices = client.getLoadedDevices();
+   EXPECT_TRUE(std::find(devices.begin(), devices.end(), "Core") !=
+         devices.end());
+   EXPECT_TRUE(client.hasProperty("Core", "TimeoutMs"));
+   client.setProperty("Core", "TimeoutMs", "1234");
+   EXPECT_EQ(1234, core.getTimeoutMs());
+   EXPECT_EQ("1234", client.getProperty("Core", "TimeoutMs"));
+   EXPECT_EQ(core.getSystemStateCache().size(),
+         client.getSystemStateCache().size());
+
+   // Errors are reported with the core's error code
+   try
+   {
+      client.getProperty("NoSuchDevice", "TimeoutMs");
+      FAIL();
+   }
+   catch (const RemoteCoreError& e)
+   {
+      EXPECT_NE(0, e.getCode());
+   }
+   RemoteImage image;
+   EXPECT_THROW(client.popNextImage(image), RemoteCoreError);
+   client.ping();
+
+   core.stopRemoteCoreServer();
+   EXPECT_FALSE(core.isRemoteCoreServerRunning());
+   EXPECT_THROW(client.ping(), RemoteCoreError);
+   EXPECT_FALSE(client.isConnected());
+   EXPECT_THROW(client.connect(path), RemoteCoreError);
+}
+
+
+TEST(RemoteCoreTests, SocketIsPrivate)
+{
+   const std::string path = SocketPath("Private");
+   CMMCore core;
+   core.startRemoteCoreServer(path.c_str());
+   struct stat st;
+   ASSERT_EQ(0, lstat(path.c_str(), &st));
+   EXPECT_TRUE(S_ISSOCK(st.st_mode));
+   EXPECT_EQ(0600u, (unsigned)(st.st_mode & 0777));
+   core.stopRemoteCoreServer();
+
+   // Only a stale socket is replaced
+   {
+      std::ofstream file(path.c_str());
+      file << "not a socket";
+   }
+   EXPECT_THROW(core.startRemoteCoreServer(path.c_str()), CMMError);
+   EXPECT_FALSE(core.isRemoteCoreServerRunning());
+   ASSERT_EQ(0, lstat(path.c_str(), &st));
+   EXPECT_TRUE(S_ISREG(st.st_mode));
+   unlink(path.c_str());
+}
+
+
+TEST(RemoteCoreTests, PipelinedRequestsAreAnsweredInOrder)
+{
+   const std::string path = SocketPath("Pipeline");
+   CMMCore core;
+   core.startRemoteCoreServer(path.c_str());
+   RemoteCoreClient client;
+   client.connect(path);
+
+   // More than are sent before the client starts reading replies
+   const unsigned count = 1000;
+   std::vector<boost::uint32_t> ids;
+   for (unsigned i = 0; i < count; ++i)
+   {
+      RemoteCoreProtocol::Writer args;
+      args.PutString("Core");
+      args.PutString("TimeoutMs");
+      if (i % 2 == 0)
+      {
+         args.PutString(boost::lexical_cast<std::string>(i));
+         ids.push_back(client.sendRequest(RemoteCoreProtocol::OpSetProperty,
+                  args));
+      }
+      else
+         ids.push_back(client.sendRequest(RemoteCoreProtocol::OpGetProperty,
+                  args));
+   }
+   for (unsigned i = 0; i < count; ++i)
+   {
+      std::vector<char> result;
+      client.receiveReply(ids[i], result);
+      if (i % 2 == 1)
+      {
+         RemoteCoreProtocol::Reader r(&result[0], result.size());
+         EXPECT_EQ(boost::lexical_cast<std::string>(i - 1), r.GetString());
+      }
+   }
+}
+
+
+TEST(RemoteCoreTests, SubscribersReceiveEvents)
+{
+   const std::string path = SocketPath("Events");
+   CMMCore core;
+   PropertyRecorder local;
+   core.registerCallback(&local);
+   core.startRemoteCoreServer(path.c_str());
+
+   RemoteCoreClient client;
+   PropertyRecorder remote;
+   client.registerCallback(&remote);
+   client.connect(path);
+   client.subscribe();
+
+   core.setProperty("Core", "TimeoutMs", "2000");
+   for (int i = 0; i < 100 && remote.changes.empty(); ++i)
+      client.processEvents(50.0);
+   ASSERT_EQ(1u, remote.changes.size());
+   EXPECT_EQ("Core.TimeoutMs=2000", remote.changes[0]);
+
+   // The application's callback still receives the events
+   ASSERT_EQ(1u, local.changes.size());
+   core.stopRemoteCoreServer();
+   core.setProperty("Core", "TimeoutMs", "3000");
+   EXPECT_EQ(2u, local.changes.size());
+   core.registerCallback(0);
+}
+
+
+int main(int argc, char** argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -0,0 +1,234 @@
+#include <gtest/gtest.h>
+
+#include "AcquisitionPlan.h"
+#include "SequenceCompiler.h"
+
+#include <string>
+#include <vector>
+
+using mm::AcquisitionEvent;
+using mm::AcquisitionRun;
+using mm::SequenceCompiler;
+using mm::SequenceLimits;
+
+
+namespace
+{
+
+AcquisitionPlan MakePlan(long timePoints, double intervalMs, std::size_t positions,
+      std::size_t slices, std::size_t channels)
+{
+   AcquisitionPlan plan;
+   plan.setTimePoints(timePoints, intervalMs);
+   if (positions > 0)
+      plan.setXYPositions(std::vector<double>(positions, 0.0),
+            std::vector<double>(positions, 0.0));
+   if (slices > 0)
+      plan.setZPositions(std::vector<double>(slices, 0.0));
+   if (channels > 0)
+      plan.setChannels("Channel", std::vector<std::string>(channels, "DAPI"),
+            std::vector<double>());
+   return plan;
+}
+
+std::vector<std::size_t> RunLengths(const std::vector<AcquisitionRun>& runs)
+{
+   std::vector<std::size_t> lengths;
+   for (std::size_t i = 0; i < runs.size(); ++i)
+      lengths.push_back(runs[i].eventCount);
+   return lengths;
+}
+
+std::vector<AcquisitionRun> Compile(const AcquisitionPlan& plan,
+      const SequenceLimits& limits)
+{
+   return SequenceCompiler::CompileRuns(plan,
+         SequenceCompiler::ExpandEvents(plan), limits);
+}
+
+} // anonymous namespace
+
+
+TEST(SequenceCompilerTests, ExpandsChannelsInsideSlices)
+{
+   AcquisitionPlan plan = MakePlan(2, 0.0, 2, 3, 2);
+   std::vector<AcquisitionEvent> events = SequenceCompiler::ExpandEvents(plan);
+   ASSERT_EQ(24u, events.size());
+   EXPECT_EQ(24, plan.getFrameCount());
+
+   EXPECT_EQ(0, events[1].sliceIndex);
+   EXPECT_EQ(1, events[1].channelIndex);
+   EXPECT_EQ(1, events[2].sliceIndex);
+   EXPECT_EQ(0, events[2].channelIndex);
+   EXPECT_EQ(1, events[6].positionIndex);
+   EXPECT_EQ(0, events[11].timeIndex);
+   EXPECT_EQ(1, events[12].timeIndex);
+   EXPECT_EQ(0, events[12].positionIndex);
+}
+
+
+TEST(SequenceCompilerTests, ExpandsSlicesInsideChannels)
+{
+   AcquisitionPlan plan = MakePlan(1, 0.0, 0, 3, 2);
+   plan.setChannelsBeforeSlices(false);
+   std::vector<AcquisitionEvent> events = SequenceCompiler::ExpandEvents(plan);
+   ASSERT_EQ(6u, events.size());
+   EXPECT_EQ(1, events[1].sliceIndex);
+   EXPECT_EQ(0, events[1].channelIndex);
+   EXPECT_EQ(0, events[3].sliceIndex);
+   EXPECT_EQ(1, events[3].channelIndex);
+}
+
+
+TEST(SequenceCompilerTests, UnchangingAxesNeedNoSequencing)
+{
+   AcquisitionPlan plan = MakePlan(5, 0.0, 1, 1, 1);
+   std::vector<AcquisitionRun> runs = Compile(plan, SequenceLimits());
+   ASSERT_EQ(1u, runs.size());
+   EXPECT_EQ(5u, runs[0].eventCount);
+   EXPECT_FALSE(runs[0].sequenceXY);
+   EXPECT_FALSE(runs[0].sequenceZ);
+   EXPECT_FALSE(runs[0].sequenceChannel);
+   EXPECT_FALSE(runs[0].waitForTimePoint);
+}
+
+
+TEST(SequenceCompilerTests, NothingSequenceable)
+{
+   AcquisitionPlan plan = MakePlan(1, 0.0, 0, 3, 2);
+   std::vector<AcquisitionRun> runs = Compile(plan, SequenceLimits());
+   EXPECT_EQ(6u, runs.size());
+}
+
+
+TEST(SequenceCompilerTests, BreaksAtUnsequenceableAxis)
+{
+   // Z stacks are sequenced; channels are switched by software between them
+   AcquisitionPlan plan = MakePlan(1, 0.0, 0, 10, 3);
+   plan.setChannelsBeforeSlices(false);
+   SequenceLimits limits;
+   limits.zMaxLength = 100;
+   std::vector<AcquisitionRun> runs = Compile(plan, limits);
+   ASSERT_EQ(3u, runs.size());
+   for (std::size_t i = 0; i < runs.size(); ++i)
+   {
+      EXPECT_EQ(10u, runs[i].eventCount);
+      EXPECT_EQ(10 * i, runs[i].firstEvent);
+      EXPECT_TRUE(runs[i].sequenceZ);
+      EXPECT_FALSE(runs[i].sequenceChannel);
+   }
+}
+
+
+TEST(SequenceCompilerTests, RespectsMaxLength)
+{
+   AcquisitionPlan plan = MakePlan(1, 0.0, 0, 10, 0);
+   SequenceLimits limits;
+   limits.zMaxLength = 4;
+   std::vector<AcquisitionRun> runs = Compile(plan, limits);
+   std::vector<std::size_t> expected;
+   expected.push_back(4);
+   expected.push_back(4);
+   expected.push_back(2);
+   EXPECT_EQ(expected, RunLengths(runs));
+}
+
+
+TEST(SequenceCompilerTests, UsesSmallestLimitOfChangingAxes)
+{
+   AcquisitionPlan plan = MakePlan(1, 0.0, 0, 4, 3);
+   SequenceLimits limits;
+   limits.zMaxLength = 1000;
+   limits.channelMaxLength = 5;
+   std::vector<AcquisitionRun> runs = Compile(plan, limits);
+   std::vector<std::size_t> expected;
+   expected.push_back(5);
+   expected.push_back(5);
+   expected.push_back(2);
+   EXPECT_EQ(expected, RunLengths(runs));
+   EXPECT_TRUE(runs[0].sequenceZ);
+   EXPECT_TRUE(runs[0].sequenceChannel);
+}
+
+
+TEST(SequenceCompilerTests, WholePlanInOneRun)
+{
+   AcquisitionPlan plan = MakePlan(3, 0.0, 2, 5, 2);
+   SequenceLimits limits;
+   limits.xyMaxLength = 1000;
+   limits.zMaxLength = 1000;
+   limits.channelMaxLength = 1000;
+   std::vector<AcquisitionRun> runs = Compile(plan, limits);
+   ASSERT_EQ(1u, runs.size());
+   EXPECT_EQ(60u, runs[0].eventCount);
+   EXPECT_TRUE(runs[0].sequenceXY);
+}
+
+
+TEST(SequenceCompilerTests, SoftwareTimedIntervalsBreakAtTimePoints)
+{
+   AcquisitionPlan plan = MakePlan(3, 100.0, 0, 4, 0);
+   SequenceLimits limits;
+   limits.zMaxLength = 1000;
+   std::vector<AcquisitionRun> runs = Compile(plan, limits);
+   ASSERT_EQ(3u, runs.size());
+   for (std::size_t i = 0; i < runs.size(); ++i)
+   {
+      EXPECT_EQ(4u, runs[i].eventCount);
+      EXPECT_TRUE(runs[i].waitForTimePoint);
+      EXPECT_EQ(0.0, runs[i].cameraIntervalMs);
+   }
+}
+
+
+TEST(SequenceCompilerTests, OnlyFirstRunOfTimePointWaits)
+{
+   AcquisitionPlan plan = MakePlan(2, 100.0, 0, 4, 0);
+   SequenceLimits limits;
+   limits.zMaxLength = 2;
+   std::vector<AcquisitionRun> runs = Compile(plan, limits);
+   ASSERT_EQ(4u, runs.size());
+   EXPECT_TRUE(runs[0].waitForTimePoint);
+   EXPECT_FALSE(runs[1].waitForTimePoint);
+   EXPECT_TRUE(runs[2].waitForTimePoint);
+   EXPECT_FALSE(runs[3].waitForTimePoint);
+}
+
+
+TEST(SequenceCompilerTests, CameraTimedIntervals)
+{
+   AcquisitionPlan plan = MakePlan(50, 20.0, 0, 0, 0);
+   plan.setCameraTimedIntervals(true);
+   std::vector<AcquisitionRun> runs = Compile(plan, SequenceLimits());
+   ASSERT_EQ(1u, runs.size());
+   EXPECT_EQ(50u, runs[0].eventCount);
+   EXPECT_EQ(20.0, runs[0].cameraIntervalMs);
+   EXPECT_TRUE(runs[0].waitForTimePoint);
+
+   // Not applicable with more than one frame per time point
+   plan.setZPositions(std::vector<double>(2, 0.0));
+   runs = Compile(plan, SequenceLimits());
+   EXPECT_EQ(100u, runs.size());
+}
+
+
+TEST(AcquisitionPlanTests, RejectsInvalidInput)
+{
+   AcquisitionPlan plan;
+   EXPECT_THROW(plan.setTimePoints(0, 0.0), CMMError);
+   EXPECT_THROW(plan.setTimePoints(1, -1.0), CMMError);
+   EXPECT_THROW(plan.setXYPositions(std::vector<double>(2),
+            std::vector<double>(3)), CMMError);
+   EXPECT_THROW(plan.setChannels("Channel", std::vector<std::string>(2),
+            std::vector<double>(1)), CMMError);
+   EXPECT_THROW(plan.setChannels("", std::vector<std::string>(2),
+            std::vector<double>()), CMMError);
+   EXPECT_EQ(1, plan.getFrameCount());
+}
+
+
+int main(int argc, char** argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -0,0 +1,241 @@
+#include <gtest/gtest.h>
+
+#include "CircularBuffer.h"
+#include "SharedMemoryExport.h"
+#include "TaskSet_CopyMemory.h"
+#include "ThreadPool.h"
+#include "../MMDevice/ImageMetadata.h"
+#include "../MMCoreShm/MMCoreShm.h"
+
+#include <boost/lexical_cast.hpp>
+#include <boost/make_shared.hpp>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+namespace {
+
+const unsigned width = 64, height = 32;
+const std::size_t imageBytes = width * height * 2;
+
+std::string SegmentName(const char* test)
+{
+   return std::string("/SharedMemoryExport-Tests-") + test + "-" +
+      boost::lexical_cast<std::string>(getpid());
+}
+
+unsigned char PixelValue(boost::uint64_t imageNumber)
+{
+   return static_cast<unsigned char>(imageNumber % 251 + 1);
+}
+
+bool InsertImage(CircularBuffer& buffer, boost::uint64_t imageNumber)
+{
+   std::vector<unsigned char> image(imageBytes, PixelValue(imageNumber));
+   Metadata md;
+   md.put("Camera", "Camera");
+   md.put("Index", boost::lexical_cast<std::string>(imageNumber).c_str());
+   return buffer.InsertImage(&image[0], width, height, 2, &md);
+}
+
+std::string FindMetadata(const MMShmImage& image, const std::string& key)
+{
+   boost::uint64_t offset = 0;
+   const char* k;
+   const char* v;
+   uint32_t kBytes, vBytes;
+   while (mmshm_next_metadata(&image, &offset, &k, &kBytes, &v, &vBytes))
+      if (std::string(k, kBytes) == key)
+         return std::string(v, vBytes);
+   return std::string();
+}
+
+// Exit status of the reader process
+enum
+{
+   ReaderOK = 0,
+   ReaderCannotOpen,
+   ReaderTimedOut,
+   ReaderBadImage,
+   ReaderNothingRead
+};
+
+// Follows the latest image while the other process writes, checking each
+// image read in place, until imageCount images have been written
+int RunReader(const std::string& name, boost::uint64_t imageCount)
+{
+   MMShmReader* reader = 0;
+   for (int i = 0; mmshm_open(name.c_str(), &reader) != MMSHM_OK; ++i)
+   {
+      if (i == 1000)
+         return ReaderCannotOpen;
+      usleep(1000);
+   }
+
+   int status = ReaderOK;
+   unsigned readCount = 0;
+   for (unsigned polls = 0; ; ++polls)
+   {
+      const boost::uint64_t count = mmshm_write_count(reader);
+      if (count == 0)
+      {
+         if (polls == 100000)
+         {
+            status = ReaderTimedOut;
+            break;
+         }
+         usleep(100);
+         continue;
+      }
+
+      const boost::uint64_t n = count - 1;
+      MMShmImage image;
+      if (mmshm_begin_read(reader, n, &image) == MMSHM_OK)
+      {
+         bool valid = image.imageNumber == n && image.width == width &&
+            image.height == height && image.bytesPerPixel == 2 &&
+            image.numComponents == 1 && image.channel == 0 &&
+            image.pixelBytes == imageBytes &&
+            FindMetadata(image, "Camera") == "Camera" &&
+            FindMetadata(image, "Index") ==
+               boost::lexical_cast<std::string>(n);
+         for (std::size_t i = 0; valid && i < imageBytes; ++i)
+            valid = image.pixels[i] == PixelValue(n);
+         // A torn image must be detected
+         if (mmshm_end_read(reader, &image) == MMSHM_OK)
+         {
+            if (!valid)
+            {
+               status = ReaderBadImage;
+               break;
+            }
+            ++readCount;
+         }
+      }
+      if (count == imageCount)
+         break;
+   }
+   if (status == ReaderOK && readCount == 0)
+      status = ReaderNothingRead;
+
+   mmshm_close(reader);
+   return status;
+}
+
+} // anonymous namespace
+
+
+TEST(SharedMemoryExportTests, OtherProcessReadsImagesInPlace)
+{
+   const std::string name = SegmentName("Process");
+   const boost::uint64_t imageCount = 2000;
+
+   CircularBuffer buffer(8);
+   buffer.SetOverflowPolicy(CircularBuffer::DropOldest);
+   ASSERT_TRUE(buffer.Initialize(1, width, height, 2));
+   buffer.EnableSharedMemoryExport(name, 1);
+   ASSERT_TRUE(buffer.IsSharedMemoryExportEnabled());
+   EXPECT_EQ(name, buffer.GetSharedMemoryExportName());
+
+   const pid_t pid = fork();
+   ASSERT_NE(-1, pid);
+   if (pid == 0)
+      _exit(RunReader(name, imageCount));
+
+   for (boost::uint64_t n = 0; n < imageCount; ++n)
+      EXPECT_TRUE(InsertImage(buffer, n));
+   EXPECT_EQ(imageCount, buffer.GetSharedMemoryExportedImageCount());
+
+   int status = -1;
+   ASSERT_EQ(pid, waitpid(pid, &status, 0));
+   ASSERT_TRUE(WIFEXITED(status));
+   EXPECT_EQ(ReaderOK, WEXITSTATUS(status));
+
+   // Images in the circular buffer are not affected, and are tagged with
+   // their number in shared memory
+   EXPECT_EQ(PixelValue(imageCount - 1), buffer.GetTopImage()[0]);
+   const mm::ImgBuffer* top = buffer.GetTopImageBuffer(0);
+   ASSERT_TRUE(top != 0);
+   EXPECT_EQ(boost::lexical_cast<std::string>(imageCount - 1),
+         top->GetMetadata().GetSingleTag(
+            SharedMemoryExport::ImageNumberTag).GetValue());
+
+   buffer.DisableSharedMemoryExport();
+   EXPECT_FALSE(buffer.IsSharedMemoryExportEnabled());
+   MMShmReader* reader = 0;
+   EXPECT_EQ(MMSHM_ERROR, mmshm_open(name.c_str(), &reader));
+}
+
+
+TEST(SharedMemoryExportTests, ReaderDetectsOverwrite)
+{
+   const std::string name = SegmentName("Overwrite");
+   boost::shared_ptr<ThreadPool> pool = boost::make_shared<ThreadPool>();
+   SharedMemoryExport shm(boost::make_shared<TaskSet_CopyMemory>(pool));
+   shm.Open(name.substr(1), 1); // Without the leading slash
+   ASSERT_TRUE(shm.IsOpen());
+   EXPECT_EQ(name, shm.GetName());
+
+   MMShmReader* reader = 0;
+   ASSERT_EQ(MMSHM_OK, mmshm_open(name.c_str(), &reader));
+   EXPECT_EQ(0u, mmshm_slot_count(reader));
+   MMShmImage image;
+   EXPECT_EQ(MMSHM_NOT_READY, mmshm_begin_read(reader, 0, &image));
+
+   std::vector<unsigned char> pixels(imageBytes);
+   Metadata md;
+   boost::uint64_t written;
+   for (unsigned n = 0; n < 2; ++n)
+   {
+      std::memset(&pixels[0], PixelValue(n), imageBytes);
+      ASSERT_TRUE(shm.WriteImage(&pixels[0], imageBytes, width, height, 2, 1,
+               0, md, written));
+      EXPECT_EQ(n, written);
+   }
+   const boost::uint64_t slotCount = mmshm_slot_count(reader);
+   ASSERT_GT(slotCount, 2u);
+   EXPECT_EQ(2u, mmshm_write_count(reader));
+
+   std::vector<unsigned char> copy(imageBytes);
+   ASSERT_EQ(MMSHM_OK,
+         mmshm_copy_image(reader, 1, &image, &copy[0], copy.size()));
+   EXPECT_EQ(PixelValue(1), copy[imageBytes - 1]);
+   EXPECT_EQ(0u, image.metadataCount);
+
+   // Image 0 is overwritten while being read
+   ASSERT_EQ(MMSHM_OK, mmshm_begin_read(reader, 0, &image));
+   EXPECT_EQ(PixelValue(0), image.pixels[0]);
+   for (boost::uint64_t n = 2; n < slotCount + 1; ++n)
+      shm.WriteImage(&pixels[0], imageBytes, width, height, 2, 1, 0, md,
+            written);
+   EXPECT_EQ(MMSHM_OVERWRITTEN, mmshm_end_read(reader, &image));
+   EXPECT_EQ(MMSHM_OVERWRITTEN, mmshm_begin_read(reader, 0, &image));
+   EXPECT_EQ(MMSHM_OK, mmshm_begin_read(reader, 1, &image));
+
+   // A change of image size invalidates all slots
+   ASSERT_EQ(MMSHM_OK, mmshm_begin_read(reader, slotCount, &image));
+   shm.WriteImage(&pixels[0], imageBytes / 2, width, height / 2, 2, 1, 0, md,
+         written);
+   EXPECT_EQ(MMSHM_OVERWRITTEN, mmshm_end_read(reader, &image));
+   EXPECT_EQ(MMSHM_NOT_READY, mmshm_begin_read(reader, slotCount, &image));
+   EXPECT_EQ(MMSHM_OK, mmshm_begin_read(reader, slotCount + 1, &image));
+   EXPECT_EQ(height / 2, image.height);
+   EXPECT_GT(mmshm_slot_count(reader), slotCount);
+
+   mmshm_close(reader);
+   shm.Close();
+   EXPECT_FALSE(shm.IsOpen());
+}
+
+
+int main(int argc, char** argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -0,0 +1,370 @@
+#include <gtest/gtest.h>
+
+#include "MMCore.h"
+#include "MockDeviceAdapter.h"
+#include "SnapBuffer.h"
+#include "ThreadPool.h"
+
+#include "../../MMDevice/DeviceBase.h"
+
+#include <boost/make_shared.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+TEST(SnapBufferTests, StoresCopiesRoundRobin)
+{
+   SnapBuffer buffer(2, boost::make_shared<ThreadPool>());
+   EXPECT_EQ(2u, buffer.GetSlotCount());
+   buffer.BeginSnap();
+
+   std::vector<unsigned char> image(64, 1);
+   unsigned char* first = buffer.Store(&image[0], image.size());
+   ASSERT_TRUE(first != 0);
+   EXPECT_TRUE(first != &image[0]);
+   image.assign(64, 2);
+   unsigned char* second = buffer.Store(&image[0], image.size());
+   ASSERT_TRUE(second != 0);
+   EXPECT_TRUE(second != first);
+   EXPECT_EQ(1, first[63]);
+   EXPECT_EQ(2, second[63]);
+
+   // The third image reuses the first slot
+   image.assign(64, 3);
+   EXPECT_EQ(first, buffer.Store(&image[0], image.size()));
+   EXPECT_EQ(3, first[0]);
+   EXPECT_EQ(2, second[0]);
+
+   EXPECT_TRUE(buffer.Store(0, 64) == 0);
+   EXPECT_TRUE(buffer.Store(&image[0], 0) == 0);
+}
+
+TEST(SnapBufferTests, SlotCountChangesAtNextSnap)
+{
+   SnapBuffer buffer(3, boost::make_shared<ThreadPool>());
+   buffer.BeginSnap();
+   std::vector<unsigned char> image(16, 0);
+   unsigned char* slots[3];
+   for (int i = 0; i < 3; ++i)
+      slots[i] = buffer.Store(&image[0], image.size());
+
+   // Removed slots stay valid until the next snap
+   buffer.SetSlotCount(1);
+   EXPECT_EQ(1u, buffer.GetSlotCount());
+   image.assign(16, 7);
+   EXPECT_EQ(slots[0], buffer.Store(&image[0], image.size()));
+   EXPECT_EQ(slots[1], buffer.Store(&image[0], image.size()));
+
+   buffer.BeginSnap();
+   unsigned char* only = buffer.Store(&image[0], image.size());
+   EXPECT_EQ(only, buffer.Store(&image[0], image.size()));
+
+   buffer.SetSlotCount(0);
+   EXPECT_EQ(1u, buffer.GetSlotCount());
+}
+
+
+namespace
+{
+
+const char* const g_Camera = "TestCamera";
+const char* const g_Shutter = "TestShutter";
+
+const unsigned g_Width = 8;
+const unsigned g_Height = 8;
+const unsigned g_Channels = 2;
+
+// Shared by the devices and the test
+struct DeviceLog
+{
+   boost::mutex mutex;
+   boost::posix_time::ptime shutterClosingUntil;
+   long framesSnapped;
+   // Whether the shutter was still closing when it was opened or a
+   // sequence was started
+   bool openedWhileClosing;
+   bool startedWhileClosing;
+
+   DeviceLog() :
+      framesSnapped(0),
+      openedWhileClosing(false),
+      startedWhileClosing(false)
+   {}
+
+   bool ShutterClosing()
+   {
+      boost::mutex::scoped_lock lock(mutex);
+      return !shutterClosingUntil.is_not_a_date_time() &&
+         boost::posix_time::microsec_clock::universal_time() <
+         shutterClosingUntil;
+   }
+};
+
+
+// Each channel of frame n is filled with 10 * n + channel
+class TestCamera : public CCameraBase<TestCamera>
+{
+public:
+   TestCamera(DeviceLog* log) :
+      log_(log),
+      pixels_(g_Channels * g_Width * g_Height),
+      exposureMs_(1.0)
+   {}
+
+   int Initialize() { return DEVICE_OK; }
+   int Shutdown() { return DEVICE_OK; }
+   void GetName(char* name) const
+   { CDeviceUtils::CopyLimitedString(name, g_Camera); }
+   bool Busy() { return false; }
+
+   int SnapImage()
+   {
+      long frame;
+      {
+         boost::mutex::scoped_lock lock(log_->mutex);
+         frame = ++log_->framesSnapped;
+      }
+      for (unsigned ch = 0; ch < g_Channels; ++ch)
+         memset(&pixels_[ch * g_Width * g_Height],
+               static_cast<int>(10 * frame + ch), g_Width * g_Height);
+      return DEVICE_OK;
+   }
+   const unsigned char* GetImageBuffer() { return &pixels_[0]; }
+   const unsigned char* GetImageBuffer(unsigned channel)
+   {
+      if (channel >= g_Channels)
+         return 0;
+      return &pixels_[channel * g_Width * g_Height];
+   }
+   unsigned GetNumberOfChannels() const { return g_Channels; }
+   long GetImageBufferSize() const { return g_Width * g_Height; }
+   unsigned GetImageWidth() const { return g_Width; }
+   unsigned GetImageHeight() const { return g_Height; }
+   unsigned GetImageBytesPerPixel() const { return 1; }
+   unsigned GetBitDepth() const { return 8; }
+   int GetBinning() const { return 1; }
+   int SetBinning(int) { return DEVICE_OK; }
+   void SetExposure(double exposureMs) { exposureMs_ = exposureMs; }
+   double GetExposure() const { return exposureMs_; }
+   int SetROI(unsigned, unsigned, unsigned, unsigned) { return DEVICE_OK; }
+   int GetROI(unsigned& x, unsigned& y, unsigned& xSize, unsigned& ySize)
+   {
+      x = y = 0;
+      xSize = g_Width;
+      ySize = g_Height;
+      return DEVICE_OK;
+   }
+   int ClearROI() { return DEVICE_OK; }
+   int IsExposureSequenceable(bool& isSequenceable) const
+   {
+      isSequenceable = false;
+      return DEVICE_OK;
+   }
+
+   int StartSequenceAcquisition(long numImages, double intervalMs,
+         bool stopOnOverflow)
+   {
+      if (log_->ShutterClosing())
+      {
+         boost::mutex::scoped_lock lock(log_->mutex);
+         log_->startedWhileClosing = true;
+      }
+      return CCameraBase<TestCamera>::StartSequenceAcquisition(numImages,
+            intervalMs, stopOnOverflow);
+   }
+
+private:
+   DeviceLog* log_;
+   std::vector<unsigned char> pixels_;
+   double exposureMs_;
+};
+
+
+// Busy for a while after being closed
+class TestShutter : public CShutterBase<TestShutter>
+{
+public:
+   TestShutter(DeviceLog* log) : log_(log), open_(false) {}
+
+   int Initialize() { return DEVICE_OK; }
+   int Shutdown() { return DEVICE_OK; }
+   void GetName(char* name) const
+   { CDeviceUtils::CopyLimitedString(name, g_Shutter); }
+   bool Busy() { return log_->ShutterClosing(); }
+
+   int SetOpen(bool open)
+   {
+      const bool closing = log_->ShutterClosing();
+      boost::mutex::scoped_lock lock(log_->mutex);
+      if (open)
+      {
+         if (closing)
+            log_->openedWhileClosing = true;
+      }
+      else
+      {
+         log_->shutterClosingUntil =
+            boost::posix_time::microsec_clock::universal_time() +
+            boost::posix_time::milliseconds(200);
+      }
+      open_ = open;
+      return DEVICE_OK;
+   }
+   int GetOpen(bool& open)
+   {
+      open = open_;
+      return DEVICE_OK;
+   }
+   int Fire(double) { return DEVICE_UNSUPPORTED_COMMAND; }
+
+private:
+   DeviceLog* log_;
+   bool open_;
+};
+
+
+class TestAdapter : public MockDeviceAdapter
+{
+public:
+   TestAdapter(DeviceLog* log) : log_(log) {}
+
+   void InitializeModuleData(RegisterDeviceFunc registerDevice)
+   {
+      registerDevice(g_Camera, MM::CameraDevice, "Test camera");
+      registerDevice(g_Shutter, MM::ShutterDevice, "Test shutter");
+   }
+
+   MM::Device* CreateDevice(const char* name)
+   {
+      if (strcmp(name, g_Camera) == 0)
+         return new TestCamera(log_);
+      if (strcmp(name, g_Shutter) == 0)
+         return new TestShutter(log_);
+      return 0;
+   }
+
+   void DeleteDevice(MM::Device* device) { delete device; }
+
+private:
+   DeviceLog* log_;
+};
+
+
+class SnapPipelineTests : public ::testing::Test
+{
+protected:
+   SnapPipelineTests() : adapter_(&log_) {}
+
+   virtual void SetUp()
+   {
+      core_.loadMockDeviceAdapter("TestAdapter", &adapter_);
+      core_.loadDevice("Camera", "TestAdapter", g_Camera);
+      core_.loadDevice("Shutter", "TestAdapter", g_Shutter);
+      core_.initializeAllDevices();
+      core_.setCameraDevice("Camera");
+      core_.setShutterDevice("Shutter");
+      // Allocated quickly, within the time the shutter takes to close
+      core_.setCircularBufferMemoryFootprint(1);
+      core_.setAutoShutter(true);
+      core_.enableSnapPipeline(true);
+   }
+
+   virtual void TearDown()
+   {
+      core_.stopSequenceAcquisition();
+      core_.unloadAllDevices();
+   }
+
+   unsigned char* SnapChannel(unsigned channel)
+   {
+      core_.snapImage();
+      return static_cast<unsigned char*>(core_.getImage(channel));
+   }
+
+   DeviceLog log_;
+   TestAdapter adapter_;
+   CMMCore core_;
+};
+
+} // anonymous namespace
+
+
+TEST_F(SnapPipelineTests, ImagesStayValidForTheSlotCount)
+{
+   EXPECT_EQ(2u, core_.getSnapBufferSlotCount());
+   EXPECT_THROW(core_.setSnapBufferSlotCount(0), CMMError);
+
+   core_.setSnapBufferSlotCount(3);
+   EXPECT_EQ(3u, core_.getSnapBufferSlotCount());
+   unsigned char* images[4];
+   for (int i = 0; i < 4; ++i)
+      images[i] = SnapChannel(0);
+   EXPECT_EQ(20, images[1][0]);
+   EXPECT_EQ(30, images[2][0]);
+   EXPECT_EQ(40, images[3][0]);
+   EXPECT_EQ(images[0], images[3]);
+
+   core_.setSnapBufferSlotCount(1);
+   unsigned char* first = SnapChannel(0);
+   unsigned char* second = SnapChannel(0);
+   EXPECT_EQ(first, second);
+   EXPECT_EQ(60, second[g_Width * g_Height - 1]);
+}
+
+TEST_F(SnapPipelineTests, ChannelsAreCopiedSeparately)
+{
+   core_.snapImage();
+   unsigned char* ch0 = static_cast<unsigned char*>(core_.getImage(0));
+   unsigned char* ch1 = static_cast<unsigned char*>(core_.getImage(1));
+   ASSERT_TRUE(ch0 != ch1);
+   EXPECT_EQ(10, ch0[0]);
+   EXPECT_EQ(11, ch1[0]);
+
+   // Not the camera's buffer, which the next snap overwrites
+   core_.snapImage();
+   EXPECT_EQ(10, ch0[g_Width * g_Height - 1]);
+   EXPECT_EQ(11, ch1[g_Width * g_Height - 1]);
+}
+
+TEST_F(SnapPipelineTests, SnapReturnsBeforeTheShutterCloses)
+{
+   core_.snapImage();
+   EXPECT_TRUE(log_.ShutterClosing());
+   core_.snapImage();
+   EXPECT_EQ(2, log_.framesSnapped);
+}
+
+TEST_F(SnapPipelineTests, OpeningTheShutterWaitsForItToClose)
+{
+   core_.snapImage();
+   ASSERT_TRUE(log_.ShutterClosing());
+   core_.setShutterOpen(true);
+   EXPECT_FALSE(log_.openedWhileClosing);
+}
+
+TEST_F(SnapPipelineTests, SequenceStartWaitsForTheShutterToClose)
+{
+   core_.snapImage();
+   ASSERT_TRUE(log_.ShutterClosing());
+   core_.startSequenceAcquisition(1, 0.0, false);
+   EXPECT_FALSE(log_.startedWhileClosing);
+}
+
+TEST_F(SnapPipelineTests, DisablingWaitsForTheShutterToClose)
+{
+   core_.snapImage();
+   ASSERT_TRUE(log_.ShutterClosing());
+   core_.enableSnapPipeline(false);
+   EXPECT_FALSE(log_.ShutterClosing());
+}
+
+
+int main(int argc, char** argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
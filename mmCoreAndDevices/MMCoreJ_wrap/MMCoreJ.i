@@ -388,8 +388,56 @@
 // to return CObject containing array of pixel values
 //
 // Assumes that class has the following methods defined:
-// unsigned GetImageWidth()
-// unsigned GetImageHeight()
+// unsigned getImageWidth(), getImageHeight()
+// unsigned getBufferImageWidth(), getBufferImageHeight()
+// unsigned getBytesPerPixel()
+// unsigned getNumberOfComponents()
+
+%{
+// Copies lSize pixels into a new Java array of the matching type
+static jobject ImagePixelsToJava(JNIEnv* jenv, const void* pixels,
+      long lSize, unsigned bytesPerPixel, unsigned numComponents)
+{
+   jarray data = 0;
+   if (bytesPerPixel == 1)
+      data = JCALL1(NewByteArray, jenv, lSize);
+   else if (bytesPerPixel == 2)
+      data = JCALL1(NewShortArray, jenv, lSize);
+   else if (bytesPerPixel == 4 && numComponents == 1)
+      data = JCALL1(NewFloatArray, jenv, lSize);
+   else if (bytesPerPixel == 4)
+      data = JCALL1(NewByteArray, jenv, lSize * 4);
+   else if (bytesPerPixel == 8)
+      data = JCALL1(NewShortArray, jenv, lSize * 4);
+   else
+   {
+      // don't know how to map
+      // TODO: throw exception?
+      return 0;
+   }
+
+   if (data == 0)
+   {
+      jclass excep = jenv->FindClass("java/lang/OutOfMemoryError");
+      if (excep)
+         jenv->ThrowNew(excep, "The system ran out of memory!");
+      return 0;
+   }
+
+   // copy pixels from the image buffer
+   if (bytesPerPixel == 1)
+      JCALL4(SetByteArrayRegion, jenv, (jbyteArray)data, 0, lSize, (const jbyte*)pixels);
+   else if (bytesPerPixel == 2)
+      JCALL4(SetShortArrayRegion, jenv, (jshortArray)data, 0, lSize, (const jshort*)pixels);
+   else if (bytesPerPixel == 4 && numComponents == 1)
+      JCALL4(SetFloatArrayRegion, jenv, (jfloatArray)data, 0, lSize, (const jfloat*)pixels);
+   else if (bytesPerPixel == 4)
+      JCALL4(SetByteArrayRegion, jenv, (jbyteArray)data, 0, lSize * 4, (const jbyte*)pixels);
+   else
+      JCALL4(SetShortArrayRegion, jenv, (jshortArray)data, 0, lSize * 4, (const jshort*)pixels);
+   return data;
+}
+%}
 
 %typemap(jni) void*        "jobject"
 %typemap(jtype) void*      "Object"
@@ -400,110 +448,18 @@
 %typemap(out) void*
 {
    long lSize = (arg1)->getImageWidth() * (arg1)->getImageHeight();
-   
-   if ((arg1)->getBytesPerPixel() == 1)
-   {
-      // create a new byte[] object in Java
-      jbyteArray data = JCALL1(NewByteArray, jenv, lSize);
-      if (data == 0)
-      {
-         jclass excep = jenv->FindClass("java/lang/OutOfMemoryError");
-         if (excep)
-            jenv->ThrowNew(excep, "The system ran out of memory!");
-
-         $result = 0;
-         return $result;
-      }
-   
-      // copy pixels from the image buffer
-      JCALL4(SetByteArrayRegion, jenv, data, 0, lSize, (jbyte*)result);
-
-      $result = data;
-   }
-   else if ((arg1)->getBytesPerPixel() == 2)
-   {
-      // create a new short[] object in Java
-      jshortArray data = JCALL1(NewShortArray, jenv, lSize);
-      if (data == 0)
-      {
-         jclass excep = jenv->FindClass("java/lang/OutOfMemoryError");
-         if (excep)
-            jenv->ThrowNew(excep, "The system ran out of memory!");
-         $result = 0;
-         return $result;
-      }
-  
-      // copy pixels from the image buffer
-      JCALL4(SetShortArrayRegion, jenv, data, 0, lSize, (jshort*)result);
-
-      $result = data;
-   }
-   else if ((arg1)->getBytesPerPixel() == 4)
-   {
-      if ((arg1)->getNumberOfComponents() == 1)
-      {
-         // create a new float[] object in Java
-         jfloatArray data = JCALL1(NewFloatArray, jenv, lSize);
-         if (data == 0)
-         {
-            jclass excep = jenv->FindClass("java/lang/OutOfMemoryError");
-            if (excep)
-               jenv->ThrowNew(excep, "The system ran out of memory!");
-
-            $result = 0;
-            return $result;
-         }
-
-         // copy pixels from the image buffer
-         JCALL4(SetFloatArrayRegion, jenv, data, 0, lSize, (jfloat*)result);
-
-         $result = data;
-      }
-      else
-      {
-         // create a new byte[] object in Java
-         jbyteArray data = JCALL1(NewByteArray, jenv, lSize * 4);
-         if (data == 0)
-         {
-            jclass excep = jenv->FindClass("java/lang/OutOfMemoryError");
-            if (excep)
-               jenv->ThrowNew(excep, "The system ran out of memory!");
-
-            $result = 0;
-            return $result;
-         }
-
-         // copy pixels from the image buffer
-         JCALL4(SetByteArrayRegion, jenv, data, 0, lSize * 4, (jbyte*)result);
-
-         $result = data;
-      }
-   }
-   else if ((arg1)->getBytesPerPixel() == 8)
-   {
-      // create a new short[] object in Java
-      jshortArray data = JCALL1(NewShortArray, jenv, lSize * 4);
-      if (data == 0)
-      {
-         jclass excep = jenv->FindClass("java/lang/OutOfMemoryError");
-         if (excep)
-            jenv->ThrowNew(excep, "The system ran out of memory!");
-         $result = 0;
-         return $result;
-      }
-  
-      // copy pixels from the image buffer
-      JCALL4(SetShortArrayRegion, jenv, data, 0, lSize * 4, (jshort*)result);
-
-      $result = data;
-   }
+   $result = ImagePixelsToJava(jenv, result, lSize,
+         (arg1)->getBytesPerPixel(), (arg1)->getNumberOfComponents());
+}
 
-   else
-   {
-      // don't know how to map
-      // TODO: throw exception?
-      $result = 0;
-   }
+// Images from the circular buffer are smaller than the camera's image when
+// frames are demultiplexed
+%typemap(out) void* getLastImage, void* popNextImage, void* getLastImageMD,
+   void* getNBeforeLastImageMD, void* popNextImageMD
+{
+   long lSize = (arg1)->getBufferImageWidth() * (arg1)->getBufferImageHeight();
+   $result = ImagePixelsToJava(jenv, result, lSize,
+         (arg1)->getBytesPerPixel(), (arg1)->getNumberOfComponents());
 }
 
 // Java typemap
@@ -628,6 +584,9 @@
 %ignore MetadataKeyError;
 %ignore MetadataIndexError;
 
+// Mock device adapters are implemented in C++ (for the Core's unit tests)
+%ignore CMMCore::loadMockDeviceAdapter;
+
 
 %typemap(javaimports) CMMCore %{
    import mmcorej.org.json.JSONObject;
@@ -730,9 +689,14 @@
       tags.put("PixelSizeUm", getPixelSizeUm(true));
       tags.put("PixelSizeAffine", getPixelSizeAffineAsString());
       tags.put("ROI", getROITag());
-      tags.put("Width", getImageWidth());
-      tags.put("Height", getImageHeight());
-      tags.put("PixelType", getPixelType());
+      // Images from the circular buffer carry their own size and type, which
+      // differ from the camera's when frames are demultiplexed
+      if (!tags.has("Width")) {
+         tags.put("Width", getImageWidth());
+         tags.put("Height", getImageHeight());
+      }
+      if (!tags.has("PixelType"))
+         tags.put("PixelType", getPixelType());
       tags.put("Frame", 0);
       tags.put("FrameIndex", 0);
       tags.put("Position", "Default");
@@ -876,6 +840,17 @@
       return new Point2D.Double(p[0][0], p[1][0]);
    }
 
+   /**
+    * Convenience function: returns the XY position of the stage as a
+    * Point2D.Double, allowing a position cached by the core that is no older
+    * than maxAgeMs.
+    */
+   public Point2D.Double getXYStagePosition(String stage, double maxAgeMs) throws java.lang.Exception {
+      double p[][] = new double[2][1];
+      getXYPosition(stage, maxAgeMs, p[0], p[1]);
+      return new Point2D.Double(p[0][0], p[1][0]);
+   }
+
    /**
     * Convenience function: returns the current XY position of the current
     * XY stage device as a Point2D.Double.
@@ -901,6 +876,8 @@
 
 %{
 #include "../MMDevice/MMDeviceConstants.h"
+#include "../MMCore/AcquisitionPlan.h"
+#include "../MMCore/SequenceStatistics.h"
 #include "../MMCore/Configuration.h"
 #include "../MMDevice/ImageMetadata.h"
 #include "../MMCore/MMEventCallback.h"
@@ -1219,7 +1196,9 @@ namespace std {
 
 
 %include "../MMDevice/MMDeviceConstants.h"
+%include "../MMCore/AcquisitionPlan.h"
 %include "../MMCore/Configuration.h"
+%include "../MMCore/SequenceStatistics.h"
 %include "../MMCore/MMCore.h"
 %include "../MMDevice/ImageMetadata.h"
 %include "../MMCore/MMEventCallback.h"
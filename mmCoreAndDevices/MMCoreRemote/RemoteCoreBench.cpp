@@ -0,0 +1,241 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          RemoteCoreBench.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCoreRemote
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Call rate and frame throughput of the remote-core server.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+
+// Serves a core in this process and measures, with clients on threads of
+// their own connected over the socket:
+// - round trips per second, with 1 and N clients, for a call that does
+//   nothing and for getProperty();
+// - pipelined round trips per second;
+// - frames per second popped from a running DemoCamera sequence, by handle
+//   through shared memory and with the pixels in the reply (only if a
+//   directory holding the DemoCamera adapter is given).
+//
+// Usage: RemoteCoreBench [-s seconds] [-c clients] [-a adapterDir]
+
+#include "RemoteCoreClient.h"
+
+#include "../MMCore/MMCore.h"
+
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+
+namespace {
+
+const unsigned pipelineDepth = 64;
+
+double SecondsSince(const boost::posix_time::ptime& start)
+{
+   return (boost::posix_time::microsec_clock::universal_time() - start).
+      total_microseconds() / 1e6;
+}
+
+enum CallKind
+{
+   Ping,
+   GetProperty,
+   PipelinedPing
+};
+
+void RunCalls(const std::string& socketPath, CallKind kind, double seconds,
+      unsigned long* calls)
+{
+   RemoteCoreClient client;
+   client.connect(socketPath);
+   const boost::posix_time::ptime start =
+      boost::posix_time::microsec_clock::universal_time();
+   unsigned long count = 0;
+   std::vector<char> result;
+   std::vector<boost::uint32_t> ids(pipelineDepth);
+   while (SecondsSince(start) < seconds)
+   {
+      switch (kind)
+      {
+         case Ping:
+            client.ping();
+            ++count;
+            break;
+         case GetProperty:
+            client.getProperty("Core", "TimeoutMs");
+            ++count;
+            break;
+         case PipelinedPing:
+            for (unsigned i = 0; i < pipelineDepth; ++i)
+               ids[i] = client.sendRequest(RemoteCoreProtocol::OpPing,
+                     RemoteCoreProtocol::Writer());
+            for (unsigned i = 0; i < pipelineDepth; ++i)
+               client.receiveReply(ids[i], result);
+            count += pipelineDepth;
+            break;
+      }
+   }
+   *calls = count;
+}
+
+void BenchmarkCalls(const std::string& socketPath, const char* name,
+      CallKind kind, unsigned clientCount, double seconds)
+{
+   std::vector<unsigned long> calls(clientCount);
+   boost::thread_group threads;
+   for (unsigned i = 0; i < clientCount; ++i)
+      threads.create_thread(boost::bind(&RunCalls, socketPath, kind, seconds,
+               &calls[i]));
+   threads.join_all();
+   unsigned long total = 0;
+   for (unsigned i = 0; i < clientCount; ++i)
+      total += calls[i];
+   std::printf("%-32s %2u client(s): %10.0f calls/s\n", name, clientCount,
+         total / seconds);
+}
+
+void BenchmarkFrames(CMMCore& core, const std::string& socketPath,
+      bool byHandle, double seconds)
+{
+   if (byHandle)
+      core.enableBufferSharedMemoryExport(
+            ("/RemoteCoreBench-" + boost::lexical_cast<std::string>(getpid())).c_str(),
+            256);
+   else
+      core.disableBufferSharedMemoryExport();
+
+   RemoteCoreClient client;
+   client.connect(socketPath);
+   client.startContinuousSequenceAcquisition(0.0);
+   const boost::posix_time::ptime start =
+      boost::posix_time::microsec_clock::universal_time();
+   unsigned long frames = 0, lost = 0;
+   double bytes = 0.0;
+   RemoteImage image;
+   while (SecondsSince(start) < seconds)
+   {
+      if (client.getRemainingImageCount() == 0)
+      {
+         boost::this_thread::sleep(boost::posix_time::microseconds(200));
+         continue;
+      }
+      try
+      {
+         client.popNextImage(image);
+         ++frames;
+         bytes += static_cast<double>(image.pixels.size());
+      }
+      catch (const RemoteCoreError&)
+      {
+         ++lost; // Overwritten in shared memory
+      }
+   }
+   client.stopSequenceAcquisition();
+   const double elapsed = SecondsSince(start);
+   std::printf("%-32s %2u client(s): %10.0f frames/s, %8.1f MB/s"
+         " (%lu unreadable)\n",
+         byHandle ? "popNextImage (shared memory)" : "popNextImage (inline)",
+         1u, frames / elapsed, bytes / elapsed / 1e6, lost);
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char** argv)
+{
+   double seconds = 2.0;
+   unsigned clientCount = 4;
+   std::string adapterDir;
+   int opt;
+   while ((opt = getopt(argc, argv, "s:c:a:")) != -1)
+   {
+      switch (opt)
+      {
+         case 's':
+            seconds = std::atof(optarg);
+            break;
+         case 'c':
+            clientCount = static_cast<unsigned>(std::atoi(optarg));
+            break;
+         case 'a':
+            adapterDir = optarg;
+            break;
+         default:
+            std::fprintf(stderr,
+                  "Usage: %s [-s seconds] [-c clients] [-a adapterDir]\n",
+                  argv[0]);
+            return 2;
+      }
+   }
+   if (seconds <= 0.0 || clientCount == 0)
+      return 2;
+
+   const std::string socketPath = "/tmp/RemoteCoreBench-" +
+      boost::lexical_cast<std::string>(getpid()) + ".sock";
+   try
+   {
+      CMMCore core;
+      core.enableStderrLog(false);
+      core.startRemoteCoreServer(socketPath.c_str());
+
+      BenchmarkCalls(socketPath, "ping", Ping, 1, seconds);
+      BenchmarkCalls(socketPath, "ping", Ping, clientCount, seconds);
+      BenchmarkCalls(socketPath, "getProperty", GetProperty, 1, seconds);
+      BenchmarkCalls(socketPath, "getProperty", GetProperty, clientCount,
+            seconds);
+      BenchmarkCalls(socketPath, "ping (pipelined)", PipelinedPing, 1,
+            seconds);
+      BenchmarkCalls(socketPath, "ping (pipelined)", PipelinedPing,
+            clientCount, seconds);
+
+      if (!adapterDir.empty())
+      {
+         core.setDeviceAdapterSearchPaths(
+               std::vector<std::string>(1, adapterDir));
+         core.loadDevice("Camera", "DemoCamera", "DCam");
+         core.initializeAllDevices();
+         core.setCameraDevice("Camera");
+         core.setProperty("Camera", "PixelType", "16bit");
+         core.setExposure(1.0);
+         BenchmarkFrames(core, socketPath, true, seconds);
+         BenchmarkFrames(core, socketPath, false, seconds);
+      }
+
+      core.stopRemoteCoreServer();
+   }
+   catch (const CMMError& e)
+   {
+      std::fprintf(stderr, "%s\n", e.getFullMsg().c_str());
+      return 1;
+   }
+   catch (const std::exception& e)
+   {
+      std::fprintf(stderr, "%s\n", e.what());
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,784 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          RemoteCoreClient.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCoreRemote
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Client of the remote-core server.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+
+#include "RemoteCoreClient.h"
+
+#include "../MMCore/MMEventCallback.h"
+#include "../MMCoreShm/MMCoreShm.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace RemoteCoreProtocol;
+
+
+namespace {
+
+// Requests sent before reading replies, beyond which replies are read and
+// kept, so that neither side blocks with full socket buffers
+const std::size_t maxPendingRequests = 256;
+const std::size_t maxQueuedEvents = 4096;
+
+#ifdef MSG_NOSIGNAL
+const int sendFlags = MSG_NOSIGNAL;
+#else
+const int sendFlags = 0;
+#endif
+
+std::string ErrnoMessage(const std::string& what)
+{
+   return what + ": " + std::strerror(errno);
+}
+
+// For the MMEventCallback functions taking non-const strings
+std::vector<char> MutableString(const std::string& s)
+{
+   std::vector<char> chars(s.begin(), s.end());
+   chars.push_back('\0');
+   return chars;
+}
+
+} // anonymous namespace
+
+
+RemoteCoreClient::RemoteCoreClient() :
+   fd_(-1),
+   shmReader_(0),
+   nextRequestId_(1),
+   callback_(0),
+   droppedEventCount_(0)
+{
+}
+
+RemoteCoreClient::~RemoteCoreClient()
+{
+   disconnect();
+}
+
+void RemoteCoreClient::connect(const std::string& socketPath)
+{
+   disconnect();
+
+   struct sockaddr_un addr;
+   std::memset(&addr, 0, sizeof(addr));
+   addr.sun_family = AF_UNIX;
+   if (socketPath.empty() || socketPath.size() >= sizeof(addr.sun_path))
+      throw RemoteCoreError("Invalid remote-core socket path " + socketPath);
+   std::memcpy(addr.sun_path, socketPath.c_str(), socketPath.size());
+
+   int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+   if (fd < 0)
+      throw RemoteCoreError(ErrnoMessage("Cannot create socket"));
+   fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+   int one = 1;
+   setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+   if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr),
+            sizeof(addr)) != 0)
+   {
+      const std::string msg = ErrnoMessage("Cannot connect to " + socketPath);
+      close(fd);
+      throw RemoteCoreError(msg);
+   }
+   fd_ = fd;
+
+   try
+   {
+      Writer args;
+      args.PutUInt32(Magic);
+      args.PutUInt32(Version);
+      std::vector<char> result;
+      Call(OpHello, args, result);
+      Reader r(result.empty() ? 0 : &result[0], result.size());
+      r.GetUInt32();
+      serverVersion_ = r.GetString();
+      shmName_ = r.GetString();
+   }
+   catch (...)
+   {
+      disconnect();
+      throw;
+   }
+}
+
+void RemoteCoreClient::disconnect()
+{
+   if (shmReader_)
+   {
+      mmshm_close(shmReader_);
+      shmReader_ = 0;
+   }
+   if (fd_ >= 0)
+   {
+      close(fd_);
+      fd_ = -1;
+   }
+   serverVersion_.clear();
+   shmName_.clear();
+   pending_.clear();
+   replies_.clear();
+   events_.clear();
+}
+
+boost::uint32_t RemoteCoreClient::sendRequest(unsigned opcode,
+      const Writer& args)
+{
+   if (fd_ < 0)
+      throw RemoteCoreError("Not connected");
+   while (pending_.size() >= maxPendingRequests)
+      ReadAndDispatch();
+
+   const boost::uint32_t requestId = nextRequestId_++;
+   if (nextRequestId_ == 0)
+      nextRequestId_ = 1;
+
+   MessageHeader header;
+   header.payloadBytes = static_cast<boost::uint32_t>(args.GetBytes().size());
+   header.requestId = requestId;
+   header.opcode = static_cast<boost::uint16_t>(opcode);
+   header.status = StatusOK;
+
+   struct iovec iov[2];
+   iov[0].iov_base = &header;
+   iov[0].iov_len = sizeof(header);
+   int count = 1;
+   if (header.payloadBytes > 0)
+   {
+      iov[1].iov_base = const_cast<char*>(&args.GetBytes()[0]);
+      iov[1].iov_len = header.payloadBytes;
+      count = 2;
+   }
+   struct iovec* piece = iov;
+   while (count > 0)
+   {
+      struct msghdr msg;
+      std::memset(&msg, 0, sizeof(msg));
+      msg.msg_iov = piece;
+      msg.msg_iovlen = count;
+      ssize_t n = sendmsg(fd_, &msg, sendFlags);
+      if (n < 0 && errno == EINTR)
+         continue;
+      if (n < 0)
+      {
+         const std::string msg = ErrnoMessage("Cannot send request");
+         disconnect();
+         throw RemoteCoreError(msg);
+      }
+      while (count > 0 && static_cast<std::size_t>(n) >= piece->iov_len)
+      {
+         n -= piece->iov_len;
+         ++piece;
+         --count;
+      }
+      if (count > 0)
+      {
+         piece->iov_base = static_cast<char*>(piece->iov_base) + n;
+         piece->iov_len -= n;
+      }
+   }
+   pending_.push_back(requestId);
+   return requestId;
+}
+
+void RemoteCoreClient::receiveReply(boost::uint32_t requestId,
+      std::vector<char>& result)
+{
+   for (;;)
+   {
+      for (std::deque<Message>::iterator it = replies_.begin(),
+            end = replies_.end(); it != end; ++it)
+      {
+         if (it->header.requestId != requestId)
+            continue;
+         Message reply;
+         reply.header = it->header;
+         reply.payload.swap(it->payload);
+         replies_.erase(it);
+         if (reply.header.status != StatusOK)
+         {
+            Reader r(reply.payload.empty() ? 0 : &reply.payload[0],
+                  reply.payload.size());
+            const int code = static_cast<int>(r.GetUInt32());
+            throw RemoteCoreError(r.GetString(), code);
+         }
+         result.swap(reply.payload);
+         return;
+      }
+      if (fd_ < 0)
+         throw RemoteCoreError("Not connected");
+      if (std::find(pending_.begin(), pending_.end(), requestId) ==
+            pending_.end())
+         throw RemoteCoreError("No such pending request");
+      ReadAndDispatch();
+   }
+}
+
+void RemoteCoreClient::ReadMessage(Message& message)
+{
+   char* dest = reinterpret_cast<char*>(&message.header);
+   std::size_t bytes = sizeof(message.header);
+   bool inHeader = true;
+   for (;;)
+   {
+      while (bytes > 0)
+      {
+         ssize_t n = recv(fd_, dest, bytes, 0);
+         if (n < 0 && errno == EINTR)
+            continue;
+         if (n <= 0)
+         {
+            const std::string msg = n == 0 ?
+               std::string("Connection closed by the remote core") :
+               ErrnoMessage("Cannot receive from the remote core");
+            disconnect();
+            throw RemoteCoreError(msg);
+         }
+         dest += n;
+         bytes -= n;
+      }
+      if (!inHeader)
+         return;
+      if (message.header.payloadBytes > MaxPayloadBytes)
+      {
+         disconnect();
+         throw RemoteCoreError("Invalid message from the remote core");
+      }
+      message.payload.resize(message.header.payloadBytes);
+      dest = message.payload.empty() ? 0 : &message.payload[0];
+      bytes = message.payload.size();
+      inHeader = false;
+   }
+}
+
+void RemoteCoreClient::ReadAndDispatch()
+{
+   Message message;
+   ReadMessage(message);
+   if (message.header.opcode >= EventFirst)
+   {
+      if (events_.size() >= maxQueuedEvents)
+      {
+         events_.pop_front();
+         ++droppedEventCount_;
+      }
+      events_.push_back(Message());
+      events_.back().header = message.header;
+      events_.back().payload.swap(message.payload);
+      return;
+   }
+   if (pending_.empty() || pending_.front() != message.header.requestId)
+   {
+      disconnect();
+      throw RemoteCoreError("Unexpected reply from the remote core");
+   }
+   pending_.pop_front();
+   replies_.push_back(Message());
+   replies_.back().header = message.header;
+   replies_.back().payload.swap(message.payload);
+}
+
+void RemoteCoreClient::Call(unsigned opcode, const Writer& args,
+      std::vector<char>& result)
+{
+   receiveReply(sendRequest(opcode, args), result);
+}
+
+void RemoteCoreClient::CallNoArgs(unsigned opcode, std::vector<char>& result)
+{
+   Call(opcode, Writer(), result);
+}
+
+void RemoteCoreClient::subscribe()
+{
+   std::vector<char> result;
+   CallNoArgs(OpSubscribe, result);
+}
+
+void RemoteCoreClient::unsubscribe()
+{
+   std::vector<char> result;
+   CallNoArgs(OpUnsubscribe, result);
+}
+
+unsigned RemoteCoreClient::processEvents(double timeoutMs)
+{
+   if (fd_ < 0)
+      throw RemoteCoreError("Not connected");
+
+   // Read whatever has arrived, waiting only if nothing is queued
+   int timeout = events_.empty() ? static_cast<int>(timeoutMs) : 0;
+   for (;;)
+   {
+      struct pollfd pfd;
+      pfd.fd = fd_;
+      pfd.events = POLLIN;
+      int ready = poll(&pfd, 1, timeout);
+      if (ready < 0 && errno == EINTR)
+         continue;
+      if (ready <= 0)
+         break;
+      ReadAndDispatch();
+      timeout = 0;
+   }
+
+   unsigned count = 0;
+   while (!events_.empty())
+   {
+      Message event;
+      event.header = events_.front().header;
+      event.payload.swap(events_.front().payload);
+      events_.pop_front();
+      ++count;
+      if (!callback_)
+         continue;
+
+      Reader r(event.payload.empty() ? 0 : &event.payload[0],
+            event.payload.size());
+      switch (event.header.opcode)
+      {
+         case EventPropertiesChanged:
+            callback_->onPropertiesChanged();
+            break;
+         case EventPropertyChanged:
+         {
+            const std::string device = r.GetString();
+            const std::string prop = r.GetString();
+            const std::string value = r.GetString();
+            callback_->onPropertyChanged(device.c_str(), prop.c_str(),
+                  value.c_str());
+            break;
+         }
+         case EventChannelGroupChanged:
+            callback_->onChannelGroupChanged(r.GetString().c_str());
+            break;
+         case EventConfigGroupChanged:
+         {
+            const std::string group = r.GetString();
+            const std::string config = r.GetString();
+            callback_->onConfigGroupChanged(group.c_str(), config.c_str());
+            break;
+         }
+         case EventSystemConfigurationLoaded:
+            callback_->onSystemConfigurationLoaded();
+            break;
+         case EventPixelSizeChanged:
+            callback_->onPixelSizeChanged(r.GetDouble());
+            break;
+         case EventPixelSizeAffineChanged:
+         {
+            double v[6];
+            for (int i = 0; i < 6; ++i)
+               v[i] = r.GetDouble();
+            callback_->onPixelSizeAffineChanged(v[0], v[1], v[2], v[3], v[4],
+                  v[5]);
+            break;
+         }
+         case EventStagePositionChanged:
+         {
+            std::vector<char> label = MutableString(r.GetString());
+            callback_->onStagePositionChanged(&label[0], r.GetDouble());
+            break;
+         }
+         case EventXYStagePositionChanged:
+         {
+            std::vector<char> label = MutableString(r.GetString());
+            const double x = r.GetDouble();
+            callback_->onXYStagePositionChanged(&label[0], x, r.GetDouble());
+            break;
+         }
+         case EventExposureChanged:
+         case EventSLMExposureChanged:
+         {
+            std::vector<char> label = MutableString(r.GetString());
+            if (event.header.opcode == EventExposureChanged)
+               callback_->onExposureChanged(&label[0], r.GetDouble());
+            else
+               callback_->onSLMExposureChanged(&label[0], r.GetDouble());
+            break;
+         }
+         default:
+            break; // From a newer server
+      }
+   }
+   return count;
+}
+
+void RemoteCoreClient::ping()
+{
+   std::vector<char> result;
+   CallNoArgs(OpPing, result);
+}
+
+MMShmReader* RemoteCoreClient::getSharedMemoryReader()
+{
+   if (!shmReader_ && !shmName_.empty() &&
+         mmshm_open(shmName_.c_str(), &shmReader_) != MMSHM_OK)
+   {
+      shmReader_ = 0;
+      throw RemoteCoreError(ErrnoMessage("Cannot open shared memory " +
+               shmName_));
+   }
+   return shmReader_;
+}
+
+void RemoteCoreClient::ReadImage(Reader& r, RemoteImage& image)
+{
+   image.width = r.GetUInt32();
+   image.height = r.GetUInt32();
+   image.bytesPerPixel = r.GetUInt32();
+   image.numComponents = r.GetUInt32();
+   image.byHandle = r.GetUInt8() != 0;
+   if (image.byHandle)
+   {
+      image.handle = r.GetUInt64();
+      MMShmReader* reader = getSharedMemoryReader();
+      if (!reader)
+         throw RemoteCoreError("Image sent by handle without shared memory");
+      MMShmImage shmImage;
+      int ret = mmshm_begin_read(reader, image.handle, &shmImage);
+      if (ret == MMSHM_OK)
+      {
+         image.pixels.assign(shmImage.pixels,
+               shmImage.pixels + shmImage.pixelBytes);
+         ret = mmshm_end_read(reader, &shmImage);
+      }
+      if (ret == MMSHM_OVERWRITTEN)
+         throw RemoteCoreError("Image overwritten in shared memory before "
+               "it could be read");
+      if (ret != MMSHM_OK)
+         throw RemoteCoreError("Cannot read image from shared memory");
+   }
+   else
+   {
+      const boost::uint64_t bytes = r.GetUInt64();
+      const char* pixels = r.GetRaw(static_cast<std::size_t>(bytes));
+      image.handle = 0;
+      image.pixels.assign(pixels, pixels + bytes);
+   }
+
+   image.metadata.clear();
+   const boost::uint32_t count = r.GetUInt32();
+   for (boost::uint32_t i = 0; i < count; ++i)
+   {
+      const std::string key = r.GetString();
+      image.metadata.push_back(std::make_pair(key, r.GetString()));
+   }
+}
+
+
+// Core API
+
+namespace {
+
+class ResultReader : public Reader
+{
+public:
+   explicit ResultReader(const std::vector<char>& result) :
+      Reader(result.empty() ? 0 : &result[0], result.size())
+   {}
+};
+
+} // anonymous namespace
+
+std::string RemoteCoreClient::getVersionInfo()
+{
+   std::vector<char> result;
+   CallNoArgs(OpGetVersionInfo, result);
+   return ResultReader(result).GetString();
+}
+
+std::string RemoteCoreClient::getAPIVersionInfo()
+{
+   std::vector<char> result;
+   CallNoArgs(OpGetAPIVersionInfo, result);
+   return ResultReader(result).GetString();
+}
+
+std::vector<std::string> RemoteCoreClient::getLoadedDevices()
+{
+   std::vector<char> result;
+   CallNoArgs(OpGetLoadedDevices, result);
+   return ResultReader(result).GetStrings();
+}
+
+std::vector<std::string> RemoteCoreClient::getDevicePropertyNames(
+      const char* label)
+{
+   Writer args;
+   args.PutString(label);
+   std::vector<char> result;
+   Call(OpGetDevicePropertyNames, args, result);
+   return ResultReader(result).GetStrings();
+}
+
+bool RemoteCoreClient::hasProperty(const char* label, const char* propName)
+{
+   Writer args;
+   args.PutString(label);
+   args.PutString(propName);
+   std::vector<char> result;
+   Call(OpHasProperty, args, result);
+   return ResultReader(result).GetUInt8() != 0;
+}
+
+std::string RemoteCoreClient::getProperty(const char* label,
+      const char* propName)
+{
+   Writer args;
+   args.PutString(label);
+   args.PutString(propName);
+   std::vector<char> result;
+   Call(OpGetProperty, args, result);
+   return ResultReader(result).GetString();
+}
+
+void RemoteCoreClient::setProperty(const char* label, const char* propName,
+      const char* propValue)
+{
+   Writer args;
+   args.PutString(label);
+   args.PutString(propName);
+   args.PutString(propValue);
+   std::vector<char> result;
+   Call(OpSetProperty, args, result);
+}
+
+std::vector<std::string> RemoteCoreClient::getAllowedPropertyValues(
+      const char* label, const char* propName)
+{
+   Writer args;
+   args.PutString(label);
+   args.PutString(propName);
+   std::vector<char> result;
+   Call(OpGetAllowedPropertyValues, args, result);
+   return ResultReader(result).GetStrings();
+}
+
+std::vector< std::vector<std::string> >
+RemoteCoreClient::getSystemStateCache()
+{
+   std::vector<char> result;
+   CallNoArgs(OpGetSystemStateCache, result);
+   ResultReader r(result);
+   const boost::uint32_t count = r.GetUInt32();
+   std::vector< std::vector<std::string> > settings;
+   for (boost::uint32_t i = 0; i < count; ++i)
+   {
+      std::vector<std::string> setting;
+      for (int j = 0; j < 3; ++j)
+         setting.push_back(r.GetString());
+      settings.push_back(setting);
+   }
+   return settings;
+}
+
+std::vector<std::string> RemoteCoreClient::getAvailableConfigGroups()
+{
+   std::vector<char> result;
+   CallNoArgs(OpGetAvailableConfigGroups, result);
+   return ResultReader(result).GetStrings();
+}
+
+std::vector<std::string> RemoteCoreClient::getAvailableConfigs(
+      const char* group)
+{
+   Writer args;
+   args.PutString(group);
+   std::vector<char> result;
+   Call(OpGetAvailableConfigs, args, result);
+   return ResultReader(result).GetStrings();
+}
+
+std::string RemoteCoreClient::getCurrentConfig(const char* groupName)
+{
+   Writer args;
+   args.PutString(groupName);
+   std::vector<char> result;
+   Call(OpGetCurrentConfig, args, result);
+   return ResultReader(result).GetString();
+}
+
+void RemoteCoreClient::setConfig(const char* groupName,
+      const char* configName)
+{
+   Writer args;
+   args.PutString(groupName);
+   args.PutString(configName);
+   std::vector<char> result;
+   Call(OpSetConfig, args, result);
+}
+
+void RemoteCoreClient::waitForConfig(const char* group,
+      const char* configName)
+{
+   Writer args;
+   args.PutString(group);
+   args.PutString(configName);
+   std::vector<char> result;
+   Call(OpWaitForConfig, args, result);
+}
+
+bool RemoteCoreClient::deviceBusy(const char* label)
+{
+   Writer args;
+   args.PutString(label);
+   std::vector<char> result;
+   Call(OpDeviceBusy, args, result);
+   return ResultReader(result).GetUInt8() != 0;
+}
+
+void RemoteCoreClient::waitForDevice(const char* label)
+{
+   Writer args;
+   args.PutString(label);
+   std::vector<char> result;
+   Call(OpWaitForDevice, args, result);
+}
+
+void RemoteCoreClient::waitForSystem()
+{
+   std::vector<char> result;
+   CallNoArgs(OpWaitForSystem, result);
+}
+
+double RemoteCoreClient::getPosition(const char* stageLabel)
+{
+   Writer args;
+   args.PutString(stageLabel);
+   std::vector<char> result;
+   Call(OpGetPosition, args, result);
+   return ResultReader(result).GetDouble();
+}
+
+void RemoteCoreClient::setPosition(const char* stageLabel, double position)
+{
+   Writer args;
+   args.PutString(stageLabel);
+   args.PutDouble(position);
+   std::vector<char> result;
+   Call(OpSetPosition, args, result);
+}
+
+void RemoteCoreClient::getXYPosition(const char* xyStageLabel,
+      double& x_stage, double& y_stage)
+{
+   Writer args;
+   args.PutString(xyStageLabel);
+   std::vector<char> result;
+   Call(OpGetXYPosition, args, result);
+   ResultReader r(result);
+   x_stage = r.GetDouble();
+   y_stage = r.GetDouble();
+}
+
+void RemoteCoreClient::setXYPosition(const char* xyStageLabel, double x,
+      double y)
+{
+   Writer args;
+   args.PutString(xyStageLabel);
+   args.PutDouble(x);
+   args.PutDouble(y);
+   std::vector<char> result;
+   Call(OpSetXYPosition, args, result);
+}
+
+std::string RemoteCoreClient::getCameraDevice()
+{
+   std::vector<char> result;
+   CallNoArgs(OpGetCameraDevice, result);
+   return ResultReader(result).GetString();
+}
+
+double RemoteCoreClient::getExposure()
+{
+   std::vector<char> result;
+   CallNoArgs(OpGetExposure, result);
+   return ResultReader(result).GetDouble();
+}
+
+void RemoteCoreClient::setExposure(double exp)
+{
+   Writer args;
+   args.PutDouble(exp);
+   std::vector<char> result;
+   Call(OpSetExposure, args, result);
+}
+
+void RemoteCoreClient::snapImage()
+{
+   std::vector<char> result;
+   CallNoArgs(OpSnapImage, result);
+}
+
+void RemoteCoreClient::getImage(RemoteImage& image)
+{
+   std::vector<char> result;
+   CallNoArgs(OpGetImage, result);
+   ResultReader r(result);
+   ReadImage(r, image);
+}
+
+void RemoteCoreClient::startContinuousSequenceAcquisition(double intervalMs)
+{
+   Writer args;
+   args.PutDouble(intervalMs);
+   std::vector<char> result;
+   Call(OpStartContinuousSequenceAcquisition, args, result);
+}
+
+void RemoteCoreClient::stopSequenceAcquisition()
+{
+   std::vector<char> result;
+   CallNoArgs(OpStopSequenceAcquisition, result);
+}
+
+bool RemoteCoreClient::isSequenceRunning()
+{
+   std::vector<char> result;
+   CallNoArgs(OpIsSequenceRunning, result);
+   return ResultReader(result).GetUInt8() != 0;
+}
+
+long RemoteCoreClient::getRemainingImageCount()
+{
+   std::vector<char> result;
+   CallNoArgs(OpGetRemainingImageCount, result);
+   return static_cast<long>(ResultReader(result).GetInt64());
+}
+
+void RemoteCoreClient::popNextImage(RemoteImage& image)
+{
+   std::vector<char> result;
+   CallNoArgs(OpPopNextImage, result);
+   ResultReader r(result);
+   ReadImage(r, image);
+}
@@ -0,0 +1,194 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          RemoteCoreClient.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCoreRemote
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Client of the remote-core server.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+
+#pragma once
+
+#include "RemoteCoreProtocol.h"
+
+#include <boost/cstdint.hpp>
+
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+class MMEventCallback;
+struct MMShmReader;
+
+
+/// Error reported by the remote core (with its error code), or a failure
+/// of the connection (code 0).
+class RemoteCoreError : public std::runtime_error
+{
+public:
+   explicit RemoteCoreError(const std::string& what, int code = 0) :
+      std::runtime_error(what), code_(code)
+   {}
+   int getCode() const { return code_; }
+
+private:
+   int code_;
+};
+
+
+/// An image received from the remote core.
+struct RemoteImage
+{
+   RemoteImage() :
+      width(0), height(0), bytesPerPixel(0), numComponents(0),
+      byHandle(false), handle(0)
+   {}
+
+   unsigned width;
+   unsigned height;
+   unsigned bytesPerPixel;
+   unsigned numComponents;
+   // Whether the image was sent by handle into shared memory; the pixels
+   // are copied from there
+   bool byHandle;
+   boost::uint64_t handle;
+   std::vector<unsigned char> pixels;
+   std::vector< std::pair<std::string, std::string> > metadata;
+};
+
+
+/// Client of the remote-core server (see CMMCore::startRemoteCoreServer()).
+/**
+ * The Core API functions have the same names and arguments as in CMMCore,
+ * and throw RemoteCoreError where CMMCore throws CMMError. Each waits for
+ * its reply.
+ *
+ * To pipeline requests, call sendRequest() several times, then
+ * receiveReply() for each request in turn; the arguments and results are
+ * encoded as described in RemoteCoreProtocol.h.
+ *
+ * Events are queued as they arrive and delivered to the registered
+ * callback, on the calling thread, by processEvents(). The callback must
+ * not call the client.
+ *
+ * Not thread-safe; use one client per thread.
+ */
+class RemoteCoreClient
+{
+public:
+   RemoteCoreClient();
+   ~RemoteCoreClient();
+
+   void connect(const std::string& socketPath);
+   void disconnect();
+   bool isConnected() const { return fd_ >= 0; }
+   // As returned by the server when connecting
+   const std::string& getServerVersionInfo() const { return serverVersion_; }
+   const std::string& getSharedMemoryName() const { return shmName_; }
+
+   // Pipelining
+   boost::uint32_t sendRequest(unsigned opcode,
+         const RemoteCoreProtocol::Writer& args);
+   // Replies must be received in the order of the requests
+   void receiveReply(boost::uint32_t requestId, std::vector<char>& result);
+
+   // Events
+   void registerCallback(MMEventCallback* callback) { callback_ = callback; }
+   void subscribe();
+   void unsubscribe();
+   // Waits up to timeoutMs for an event if none is queued, then delivers the
+   // queued events; returns how many were delivered
+   unsigned processEvents(double timeoutMs);
+   // Discarded because processEvents() was not called often enough
+   unsigned long getDroppedEventCount() const { return droppedEventCount_; }
+
+   // Round trip without executing anything
+   void ping();
+
+   std::string getVersionInfo();
+   std::string getAPIVersionInfo();
+   std::vector<std::string> getLoadedDevices();
+   std::vector<std::string> getDevicePropertyNames(const char* label);
+   bool hasProperty(const char* label, const char* propName);
+   std::string getProperty(const char* label, const char* propName);
+   void setProperty(const char* label, const char* propName,
+         const char* propValue);
+   std::vector<std::string> getAllowedPropertyValues(const char* label,
+         const char* propName);
+   // Device, property and value of each cached property
+   std::vector< std::vector<std::string> > getSystemStateCache();
+   std::vector<std::string> getAvailableConfigGroups();
+   std::vector<std::string> getAvailableConfigs(const char* group);
+   std::string getCurrentConfig(const char* groupName);
+   void setConfig(const char* groupName, const char* configName);
+   void waitForConfig(const char* group, const char* configName);
+   bool deviceBusy(const char* label);
+   void waitForDevice(const char* label);
+   void waitForSystem();
+   double getPosition(const char* stageLabel);
+   void setPosition(const char* stageLabel, double position);
+   void getXYPosition(const char* xyStageLabel, double& x_stage,
+         double& y_stage);
+   void setXYPosition(const char* xyStageLabel, double x, double y);
+   std::string getCameraDevice();
+   double getExposure();
+   void setExposure(double exp);
+   void snapImage();
+   void getImage(RemoteImage& image);
+   void startContinuousSequenceAcquisition(double intervalMs);
+   void stopSequenceAcquisition();
+   bool isSequenceRunning();
+   long getRemainingImageCount();
+   void popNextImage(RemoteImage& image);
+
+   // For reading images sent by handle in place (see MMCoreShm.h); null if
+   // the server has no shared-memory export
+   MMShmReader* getSharedMemoryReader();
+
+private:
+   struct Message
+   {
+      RemoteCoreProtocol::MessageHeader header;
+      std::vector<char> payload;
+   };
+
+   RemoteCoreClient(const RemoteCoreClient&);
+   RemoteCoreClient& operator=(const RemoteCoreClient&);
+
+   void ReadMessage(Message& message);
+   // Reads the next message; replies are kept for receiveReply()
+   void ReadAndDispatch();
+   void Call(unsigned opcode, const RemoteCoreProtocol::Writer& args,
+         std::vector<char>& result);
+   void CallNoArgs(unsigned opcode, std::vector<char>& result);
+   void ReadImage(RemoteCoreProtocol::Reader& r, RemoteImage& image);
+
+   int fd_;
+   std::string serverVersion_;
+   std::string shmName_;
+   MMShmReader* shmReader_;
+
+   boost::uint32_t nextRequestId_;
+   std::deque<boost::uint32_t> pending_; // Sent, reply not received
+   std::deque<Message> replies_; // Received, not yet returned
+
+   MMEventCallback* callback_;
+   std::deque<Message> events_;
+   unsigned long droppedEventCount_;
+};
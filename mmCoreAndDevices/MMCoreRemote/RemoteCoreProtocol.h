@@ -0,0 +1,264 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          RemoteCoreProtocol.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCoreRemote
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Binary protocol of the remote-core server.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+
+/*
+ * CMMCore::startRemoteCoreServer() serves a subset of the CMMCore API to
+ * other processes on the same machine over a Unix domain socket.
+ * RemoteCoreClient implements the client side.
+ *
+ * Each message is a MessageHeader followed by payloadBytes bytes of payload.
+ * A client sends requests, each with a requestId of its choice (nonzero),
+ * and may send further requests before the replies arrive (pipelining).
+ * The server executes the requests of a connection in order and replies to
+ * each with a message that has the same requestId and opcode. The status
+ * of a reply is StatusOK, or StatusError with the payload holding the error
+ * code (int32) and message (string) of the CMMError thrown by the core.
+ *
+ * After OpSubscribe, the server also sends event messages (requestId 0,
+ * opcode EventFirst or above), which may arrive between replies. Events are
+ * queued per connection and, if a client does not keep up, the oldest are
+ * discarded; the device threads that raise them never wait for a client.
+ *
+ * Payload values are in the machine's byte order (both ends are on the
+ * same machine): integers as uint8/uint32/int64/uint64, doubles as IEEE
+ * double, strings as a uint32 length followed by the bytes (no null
+ * terminator), string vectors as a uint32 count followed by the strings.
+ *
+ * Images popped from the circular buffer are returned by handle when the
+ * core's shared-memory export is enabled (see
+ * CMMCore::enableBufferSharedMemoryExport()): the handle is the image's
+ * number in the shared-memory segment, whose name is returned by OpHello,
+ * and the client reads the pixels from there. Otherwise, and for snapped
+ * images, the pixels are sent in the reply.
+ */
+
+#pragma once
+
+#include <boost/cstdint.hpp>
+
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace RemoteCoreProtocol {
+
+const boost::uint32_t Magic = 0x4d4d5243; // "MMRC"
+const boost::uint32_t Version = 1;
+
+// Larger messages are a protocol error
+const boost::uint32_t MaxPayloadBytes = 1u << 30;
+
+struct MessageHeader
+{
+   boost::uint32_t payloadBytes;
+   boost::uint32_t requestId;
+   boost::uint16_t opcode;
+   boost::uint16_t status;
+};
+
+enum Status
+{
+   StatusOK = 0,
+   StatusError = 1
+};
+
+// Arguments and results are listed as (arguments) -> results
+enum Opcode
+{
+   // (uint32 magic, uint32 version) -> (uint32 version, string coreVersion,
+   // string shmName); shmName is empty if the shared-memory export is off
+   OpHello = 1,
+   OpPing, // () -> ()
+
+   OpGetVersionInfo, // () -> (string)
+   OpGetAPIVersionInfo, // () -> (string)
+   OpGetLoadedDevices, // () -> (strings)
+   OpGetDevicePropertyNames, // (string label) -> (strings)
+   OpHasProperty, // (string label, string propName) -> (uint8)
+   OpGetProperty, // (string label, string propName) -> (string)
+   OpSetProperty, // (string label, string propName, string value) -> ()
+   OpGetAllowedPropertyValues, // (string label, string propName) -> (strings)
+   // () -> (uint32 count, then count x (string device, string property,
+   // string value))
+   OpGetSystemStateCache,
+   OpGetAvailableConfigGroups, // () -> (strings)
+   OpGetAvailableConfigs, // (string group) -> (strings)
+   OpGetCurrentConfig, // (string group) -> (string)
+   OpSetConfig, // (string group, string config) -> ()
+   OpWaitForConfig, // (string group, string config) -> ()
+   OpDeviceBusy, // (string label) -> (uint8)
+   OpWaitForDevice, // (string label) -> ()
+   OpWaitForSystem, // () -> ()
+   OpGetPosition, // (string label) -> (double)
+   OpSetPosition, // (string label, double position) -> ()
+   OpGetXYPosition, // (string label) -> (double x, double y)
+   OpSetXYPosition, // (string label, double x, double y) -> ()
+   OpGetCameraDevice, // () -> (string)
+   OpGetExposure, // () -> (double)
+   OpSetExposure, // (double) -> ()
+   OpSnapImage, // () -> ()
+   OpGetImage, // () -> (image)
+   OpStartContinuousSequenceAcquisition, // (double intervalMs) -> ()
+   OpStopSequenceAcquisition, // () -> ()
+   OpIsSequenceRunning, // () -> (uint8)
+   OpGetRemainingImageCount, // () -> (int64)
+   OpPopNextImage, // () -> (image)
+   OpSubscribe, // () -> ()
+   OpUnsubscribe, // () -> ()
+
+   OpCount
+};
+
+// An image is: uint32 width, uint32 height, uint32 bytesPerPixel,
+// uint32 numComponents, uint8 byHandle, then either (uint64 handle) or
+// (uint64 byteCount, pixels), then the metadata as uint32 count followed by
+// count x (string key, string value).
+
+// Event messages, carrying the arguments of the MMEventCallback function
+enum EventOpcode
+{
+   EventFirst = 0x8000,
+   EventPropertiesChanged = EventFirst, // ()
+   EventPropertyChanged, // (string device, string property, string value)
+   EventChannelGroupChanged, // (string group)
+   EventConfigGroupChanged, // (string group, string config)
+   EventSystemConfigurationLoaded, // ()
+   EventPixelSizeChanged, // (double)
+   EventPixelSizeAffineChanged, // (6 x double)
+   EventStagePositionChanged, // (string label, double)
+   EventXYStagePositionChanged, // (string label, double x, double y)
+   EventExposureChanged, // (string label, double)
+   EventSLMExposureChanged // (string label, double)
+};
+
+
+class ProtocolError : public std::runtime_error
+{
+public:
+   explicit ProtocolError(const std::string& what) :
+      std::runtime_error(what)
+   {}
+};
+
+
+/// Appends values to a message payload.
+class Writer
+{
+public:
+   const std::vector<char>& GetBytes() const { return bytes_; }
+   void Clear() { bytes_.clear(); }
+
+   void PutUInt8(boost::uint8_t v) { PutRaw(&v, sizeof(v)); }
+   void PutUInt32(boost::uint32_t v) { PutRaw(&v, sizeof(v)); }
+   void PutInt64(boost::int64_t v) { PutRaw(&v, sizeof(v)); }
+   void PutUInt64(boost::uint64_t v) { PutRaw(&v, sizeof(v)); }
+   void PutDouble(double v) { PutRaw(&v, sizeof(v)); }
+
+   void PutString(const std::string& s)
+   {
+      PutUInt32(static_cast<boost::uint32_t>(s.size()));
+      PutRaw(s.data(), s.size());
+   }
+
+   void PutStrings(const std::vector<std::string>& strings)
+   {
+      PutUInt32(static_cast<boost::uint32_t>(strings.size()));
+      for (std::size_t i = 0; i < strings.size(); ++i)
+         PutString(strings[i]);
+   }
+
+   void PutRaw(const void* data, std::size_t bytes)
+   {
+      const char* p = static_cast<const char*>(data);
+      bytes_.insert(bytes_.end(), p, p + bytes);
+   }
+
+private:
+   std::vector<char> bytes_;
+};
+
+
+/// Reads values from a message payload, throwing ProtocolError if it ends
+/// early.
+class Reader
+{
+public:
+   Reader(const char* data, std::size_t bytes) :
+      data_(data), end_(data + bytes)
+   {}
+
+   std::size_t GetRemainingBytes() const { return end_ - data_; }
+
+   boost::uint8_t GetUInt8() { return Get<boost::uint8_t>(); }
+   boost::uint32_t GetUInt32() { return Get<boost::uint32_t>(); }
+   boost::int64_t GetInt64() { return Get<boost::int64_t>(); }
+   boost::uint64_t GetUInt64() { return Get<boost::uint64_t>(); }
+   double GetDouble() { return Get<double>(); }
+
+   std::string GetString()
+   {
+      const boost::uint32_t bytes = GetUInt32();
+      const char* p = GetRaw(bytes);
+      return std::string(p, bytes);
+   }
+
+   std::vector<std::string> GetStrings()
+   {
+      const boost::uint32_t count = GetUInt32();
+      std::vector<std::string> strings;
+      // Each string takes at least 4 bytes
+      if (count > GetRemainingBytes() / 4)
+         throw ProtocolError("Truncated message");
+      strings.reserve(count);
+      for (boost::uint32_t i = 0; i < count; ++i)
+         strings.push_back(GetString());
+      return strings;
+   }
+
+   // Returns a pointer to the next bytes and skips them
+   const char* GetRaw(std::size_t bytes)
+   {
+      if (bytes > GetRemainingBytes())
+         throw ProtocolError("Truncated message");
+      const char* p = data_;
+      data_ += bytes;
+      return p;
+   }
+
+private:
+   template <typename T>
+   T Get()
+   {
+      T v;
+      std::memcpy(&v, GetRaw(sizeof(T)), sizeof(T));
+      return v;
+   }
+
+   const char* data_;
+   const char* end_;
+};
+
+} // namespace RemoteCoreProtocol
@@ -0,0 +1,173 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          MMCoreShm.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCoreShm
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Shared-memory export of the circular buffer: layout and reader.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+
+/*
+ * MMCore can publish the images inserted into its circular buffer in a named
+ * POSIX shared-memory segment (CMMCore::enableBufferSharedMemoryExport()).
+ * Processes on the same machine can then read the images in place, without
+ * copying them, using the functions declared below (or by following the
+ * layout directly).
+ *
+ * The segment starts with an MMShmHeader, followed (at slotsOffset) by
+ * slotCount slots of slotBytes each. Each image (each channel of a
+ * multi-channel frame) is written to the next slot in turn: image n, counted
+ * from 0 since the export was enabled, goes to slot n % slotCount,
+ * overwriting image n - slotCount. The writer never waits for readers.
+ *
+ * A slot is an MMShmSlotHeader, then metadataCapacity bytes of metadata,
+ * then pixelCapacity bytes of pixels (rows top to bottom, no padding, in the
+ * same format as CMMCore::popNextImage()). The metadata are metadataCount
+ * entries of: key length (uint32), value length (uint32), key, value; the
+ * strings are UTF-8 and not null-terminated. Entries that do not fit are
+ * omitted.
+ *
+ * Consistency is ensured with sequence numbers (seqlocks). The sequence of a
+ * slot is odd while it is being written, and 2 * (n + 1) once image n is
+ * complete. Readers check the sequence before and after reading a slot; the
+ * image is valid only if it did not change. Likewise, layoutSequence is odd
+ * while the writer changes the slot layout (when the image size changes),
+ * which invalidates all slots. All integers are in the machine's byte order.
+ */
+
+#ifndef MMCORESHM_H
+#define MMCORESHM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MMSHM_MAGIC 0x4d4d5348U /* "MMSH" */
+#define MMSHM_VERSION 1
+#define MMSHM_ALIGNMENT 64 /* Of slots and of pixels */
+
+typedef struct MMShmHeader
+{
+   uint32_t magic;
+   uint32_t version;
+   uint64_t segmentBytes;
+   uint32_t writerPid;
+   uint32_t reserved0;
+
+   volatile uint64_t layoutSequence;
+   uint64_t slotsOffset;
+   uint64_t slotBytes;
+   uint64_t slotCount; /* 0 until the first image */
+   uint64_t metadataCapacity;
+   uint64_t pixelCapacity;
+
+   /* Images written; image writeCount - 1 is the latest */
+   volatile uint64_t writeCount;
+
+   uint64_t reserved[6];
+} MMShmHeader;
+
+typedef struct MMShmSlotHeader
+{
+   volatile uint64_t sequence;
+   uint64_t imageNumber;
+   uint32_t width;
+   uint32_t height;
+   uint32_t bytesPerPixel;
+   uint32_t numComponents;
+   uint32_t channel;
+   uint32_t metadataCount;
+   uint64_t metadataBytes;
+   uint64_t pixelBytes;
+   uint64_t reserved[1];
+} MMShmSlotHeader;
+
+
+/* Reader API */
+
+enum
+{
+   MMSHM_OK = 0,
+   MMSHM_NOT_READY = 1, /* Not yet written, or being written */
+   MMSHM_OVERWRITTEN = 2, /* Overwritten, or the layout changed */
+   MMSHM_ERROR = -1 /* See errno */
+};
+
+typedef struct MMShmReader MMShmReader;
+
+/* An image being read; the pointers are into the segment */
+typedef struct MMShmImage
+{
+   uint64_t imageNumber;
+   uint32_t width;
+   uint32_t height;
+   uint32_t bytesPerPixel;
+   uint32_t numComponents;
+   uint32_t channel;
+   const unsigned char* pixels;
+   uint64_t pixelBytes;
+   const unsigned char* metadata;
+   uint64_t metadataBytes;
+   uint32_t metadataCount;
+
+   /* For mmshm_end_read() */
+   uint64_t layoutSequence_;
+   uint64_t slotSequence_;
+   const volatile uint64_t* slotSequencePtr_;
+} MMShmImage;
+
+/* Maps the segment read-only; name as passed to
+ * enableBufferSharedMemoryExport(). Returns MMSHM_OK or MMSHM_ERROR (errno
+ * is EINVAL if the segment is not an export of a supported version). */
+int mmshm_open(const char* name, MMShmReader** reader);
+void mmshm_close(MMShmReader* reader);
+
+/* Number of images written so far */
+uint64_t mmshm_write_count(const MMShmReader* reader);
+/* Number of slots (the most images available at once); 0 before the first
+ * image */
+uint64_t mmshm_slot_count(const MMShmReader* reader);
+
+/* Starts reading image imageNumber in place. Returns MMSHM_OK,
+ * MMSHM_NOT_READY or MMSHM_OVERWRITTEN. Anything read from the image must
+ * be discarded unless mmshm_end_read() then returns MMSHM_OK. */
+int mmshm_begin_read(const MMShmReader* reader, uint64_t imageNumber,
+      MMShmImage* image);
+/* Returns MMSHM_OK if the image was not overwritten while being read, or
+ * MMSHM_OVERWRITTEN */
+int mmshm_end_read(const MMShmReader* reader, const MMShmImage* image);
+
+/* Copies the pixels of image imageNumber to dest (of capacity bytes) and
+ * fills image, whose pointers must not be used. Returns as
+ * mmshm_begin_read(), or MMSHM_ERROR (errno ERANGE) if dest is too small. */
+int mmshm_copy_image(const MMShmReader* reader, uint64_t imageNumber,
+      MMShmImage* image, void* dest, size_t capacity);
+
+/* Iterates over the metadata of an image: start with *offset = 0; returns 0
+ * after the last entry. */
+int mmshm_next_metadata(const MMShmImage* image, uint64_t* offset,
+      const char** key, uint32_t* keyBytes,
+      const char** value, uint32_t* valueBytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MMCORESHM_H */
@@ -0,0 +1,238 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          MMCoreShmReader.c
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCoreShm
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Reader of the shared-memory export of the circular buffer.
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+
+#include "MMCoreShm.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct MMShmReader
+{
+   const unsigned char* data;
+   size_t bytes;
+};
+
+#define MMSHM_BARRIER() __sync_synchronize()
+
+static const MMShmHeader* Header(const MMShmReader* reader)
+{
+   return (const MMShmHeader*)reader->data;
+}
+
+int mmshm_open(const char* name, MMShmReader** reader)
+{
+   int fd;
+   struct stat st;
+   void* data;
+   const MMShmHeader* header;
+
+   *reader = NULL;
+   fd = shm_open(name, O_RDONLY, 0);
+   if (fd < 0)
+      return MMSHM_ERROR;
+   if (fstat(fd, &st) != 0)
+   {
+      int err = errno;
+      close(fd);
+      errno = err;
+      return MMSHM_ERROR;
+   }
+   if ((size_t)st.st_size < sizeof(MMShmHeader))
+   {
+      close(fd);
+      errno = EINVAL;
+      return MMSHM_ERROR;
+   }
+   data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+   close(fd);
+   if (data == MAP_FAILED)
+      return MMSHM_ERROR;
+
+   header = (const MMShmHeader*)data;
+   if (header->magic != MMSHM_MAGIC || header->version != MMSHM_VERSION ||
+         header->segmentBytes > (uint64_t)st.st_size)
+   {
+      munmap(data, (size_t)st.st_size);
+      errno = EINVAL;
+      return MMSHM_ERROR;
+   }
+
+   *reader = (MMShmReader*)malloc(sizeof(MMShmReader));
+   if (!*reader)
+   {
+      munmap(data, (size_t)st.st_size);
+      errno = ENOMEM;
+      return MMSHM_ERROR;
+   }
+   (*reader)->data = (const unsigned char*)data;
+   (*reader)->bytes = (size_t)st.st_size;
+   return MMSHM_OK;
+}
+
+void mmshm_close(MMShmReader* reader)
+{
+   if (!reader)
+      return;
+   munmap((void*)reader->data, reader->bytes);
+   free(reader);
+}
+
+uint64_t mmshm_write_count(const MMShmReader* reader)
+{
+   uint64_t count = Header(reader)->writeCount;
+   MMSHM_BARRIER();
+   return count;
+}
+
+uint64_t mmshm_slot_count(const MMShmReader* reader)
+{
+   const MMShmHeader* header = Header(reader);
+   uint64_t layout, count;
+   do
+   {
+      layout = header->layoutSequence;
+      MMSHM_BARRIER();
+      count = header->slotCount;
+      MMSHM_BARRIER();
+   } while ((layout & 1) || layout != header->layoutSequence);
+   return count;
+}
+
+int mmshm_begin_read(const MMShmReader* reader, uint64_t imageNumber,
+      MMShmImage* image)
+{
+   const MMShmHeader* header = Header(reader);
+   const unsigned char* slot;
+   const MMShmSlotHeader* slotHeader;
+   uint64_t layout, slotsOffset, slotBytes, slotCount, metadataCapacity,
+            pixelCapacity, writeCount, sequence;
+
+   layout = header->layoutSequence;
+   MMSHM_BARRIER();
+   if (layout & 1)
+      return MMSHM_NOT_READY;
+   slotsOffset = header->slotsOffset;
+   slotBytes = header->slotBytes;
+   slotCount = header->slotCount;
+   metadataCapacity = header->metadataCapacity;
+   pixelCapacity = header->pixelCapacity;
+   writeCount = header->writeCount;
+   MMSHM_BARRIER();
+   if (header->layoutSequence != layout)
+      return MMSHM_NOT_READY;
+
+   if (slotCount == 0 || imageNumber >= writeCount)
+      return MMSHM_NOT_READY;
+   if (writeCount - imageNumber > slotCount)
+      return MMSHM_OVERWRITTEN;
+   if (slotsOffset + slotCount * slotBytes > reader->bytes ||
+         sizeof(MMShmSlotHeader) + metadataCapacity + pixelCapacity > slotBytes)
+   {
+      errno = EINVAL;
+      return MMSHM_ERROR;
+   }
+
+   slot = reader->data + slotsOffset + (imageNumber % slotCount) * slotBytes;
+   slotHeader = (const MMShmSlotHeader*)slot;
+   sequence = slotHeader->sequence;
+   MMSHM_BARRIER();
+   if (sequence != 2 * (imageNumber + 1))
+      return sequence > 2 * (imageNumber + 1) ?
+         MMSHM_OVERWRITTEN : MMSHM_NOT_READY;
+
+   image->imageNumber = slotHeader->imageNumber;
+   image->width = slotHeader->width;
+   image->height = slotHeader->height;
+   image->bytesPerPixel = slotHeader->bytesPerPixel;
+   image->numComponents = slotHeader->numComponents;
+   image->channel = slotHeader->channel;
+   image->metadataCount = slotHeader->metadataCount;
+   image->metadataBytes = slotHeader->metadataBytes;
+   image->pixelBytes = slotHeader->pixelBytes;
+   image->metadata = slot + sizeof(MMShmSlotHeader);
+   image->pixels = slot + sizeof(MMShmSlotHeader) + metadataCapacity;
+   image->layoutSequence_ = layout;
+   image->slotSequence_ = sequence;
+   image->slotSequencePtr_ = &slotHeader->sequence;
+
+   if (mmshm_end_read(reader, image) != MMSHM_OK)
+      return MMSHM_OVERWRITTEN;
+   if (image->metadataBytes > metadataCapacity ||
+         image->pixelBytes > pixelCapacity)
+   {
+      errno = EINVAL;
+      return MMSHM_ERROR;
+   }
+   return MMSHM_OK;
+}
+
+int mmshm_end_read(const MMShmReader* reader, const MMShmImage* image)
+{
+   MMSHM_BARRIER();
+   if (*image->slotSequencePtr_ != image->slotSequence_ ||
+         Header(reader)->layoutSequence != image->layoutSequence_)
+      return MMSHM_OVERWRITTEN;
+   return MMSHM_OK;
+}
+
+int mmshm_copy_image(const MMShmReader* reader, uint64_t imageNumber,
+      MMShmImage* image, void* dest, size_t capacity)
+{
+   int ret = mmshm_begin_read(reader, imageNumber, image);
+   if (ret != MMSHM_OK)
+      return ret;
+   if (image->pixelBytes > capacity)
+   {
+      errno = ERANGE;
+      return MMSHM_ERROR;
+   }
+   memcpy(dest, image->pixels, (size_t)image->pixelBytes);
+   return mmshm_end_read(reader, image);
+}
+
+int mmshm_next_metadata(const MMShmImage* image, uint64_t* offset,
+      const char** key, uint32_t* keyBytes,
+      const char** value, uint32_t* valueBytes)
+{
+   const unsigned char* entry = image->metadata + *offset;
+   uint32_t lengths[2];
+
+   if (*offset > image->metadataBytes ||
+         image->metadataBytes - *offset < sizeof(lengths))
+      return 0;
+   memcpy(lengths, entry, sizeof(lengths));
+   if (image->metadataBytes - *offset - sizeof(lengths) <
+         (uint64_t)lengths[0] + lengths[1])
+      return 0;
+   *key = (const char*)entry + sizeof(lengths);
+   *keyBytes = lengths[0];
+   *value = *key + lengths[0];
+   *valueBytes = lengths[1];
+   *offset += sizeof(lengths) + (uint64_t)lengths[0] + lengths[1];
+   return 1;
+}
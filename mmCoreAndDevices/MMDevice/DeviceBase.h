@@ -1154,6 +1154,18 @@ protected:
       return MM::MMTime(0.0);
    }
 
+   /**
+   * Gets the time in nanoseconds on a monotonic clock, for measuring
+   * intervals.
+   */
+   unsigned long long GetMonotonicTimeNs()
+   {
+      if (callback_)
+         return callback_->GetMonotonicTimeNs();
+
+      return 0;
+   }
+
    /**
    * Check if we have callback mechanism set up.
    */
@@ -1432,8 +1444,9 @@ public:
       int ret = GetCoreCallback()->PrepareForAcq(this);
       if (ret != DEVICE_OK)
          return ret;
-      thd_->Start(numImages,interval_ms);
+      // Set before the first image is inserted
       stopWhenCBOverflows_ = stopOnOverflow;
+      thd_->Start(numImages,interval_ms);
       return DEVICE_OK;
    }
 
@@ -326,6 +326,8 @@ public:
    {
       MetadataTag* tag = FindTag(key);
       const MetadataSingleTag* stag = tag->ToSingleTag();
+      if (!stag)
+         throw MetadataKeyError();
       return *stag;
    }
 
@@ -333,6 +335,8 @@ public:
    {
       MetadataTag* tag = FindTag(key);
       const MetadataArrayTag* atag = tag->ToArrayTag();
+      if (!atag)
+         throw MetadataKeyError();
       return *atag;
    }
 
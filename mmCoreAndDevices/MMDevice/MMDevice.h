@@ -27,7 +27,7 @@
 // Header version
 // If any of the class definitions changes, the interface version
 // must be incremented
-#define DEVICE_INTERFACE_VERSION 70
+#define DEVICE_INTERFACE_VERSION 73
 ///////////////////////////////////////////////////////////////////////////////
 
 
@@ -1238,6 +1238,24 @@ namespace MM {
       virtual Device* GetInstalledDevice(int devIdx) = 0;
    };
 
+   /**
+    * Writes an image into a buffer provided by the Core.
+    * Cameras pass one to Core::InsertImage() to convert or copy their frames
+    * straight into the circular buffer, instead of inserting a finished
+    * image that the Core then copies.
+    */
+   class ImageWriter
+   {
+   public:
+      virtual ~ImageWriter() {}
+      /**
+       * Write the image, with tightly packed rows, to dest, which has room
+       * for the image size given to Core::InsertImage(). Called at most once,
+       * on the thread calling InsertImage(), before it returns.
+       */
+      virtual void WriteImage(unsigned char* dest) const = 0;
+   };
+
    /**
     * Callback API to the core control module.
     * Devices use this abstract interface to use Core services
@@ -1310,6 +1328,11 @@ namespace MM {
 
       virtual unsigned long GetClockTicksUs(const Device* caller) = 0;
       virtual MM::MMTime GetCurrentMMTime() = 0;
+      /**
+       * Nanoseconds on the core's monotonic clock, from an arbitrary origin.
+       * GetCurrentMMTime() is derived from the same clock.
+       */
+      virtual unsigned long long GetMonotonicTimeNs() = 0;
 
       // sequence acquisition
       virtual int AcqFinished(const Device* caller, int statusCode) = 0;
@@ -1319,6 +1342,12 @@ namespace MM {
       virtual int InsertImage(const Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, const Metadata* md = 0, const bool doProcess = true) = 0;
       /// \deprecated Use the other forms instead.
       virtual int InsertImage(const Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, const char* serializedMetadata, const bool doProcess = true) = 0;
+      /**
+       * Insert an image written by writer. The image is written directly
+       * into the circular buffer unless an image processor or other Core
+       * processing of sequence frames is in use.
+       */
+      virtual int InsertImage(const Device* caller, const ImageWriter& writer, unsigned width, unsigned height, unsigned byteDepth, unsigned nComponents, const Metadata* md = 0) = 0;
       virtual void ClearImageBuffer(const Device* caller) = 0;
       virtual bool InitializeImageBuffer(unsigned channels, unsigned slices, unsigned int w, unsigned int h, unsigned int pixDepth) = 0;
       /// \deprecated Use the other forms instead.
@@ -1340,6 +1369,11 @@ namespace MM {
       virtual int GetExposure(double& expMs) = 0;
       virtual int SetConfig(const char* group, const char* name) = 0;
       virtual int GetCurrentConfig(const char* group, int bufLen, char* name) = 0;
+      /**
+       * Like GetCurrentConfig(), but from the core's property cache, without
+       * querying any device. Cheap enough to be called for every frame.
+       */
+      virtual int GetCurrentConfigFromCache(const char* group, int bufLen, char* name) = 0;
       virtual int GetChannelConfig(char* channelConfigName, const unsigned int channelConfigIterator) = 0;
 
       // direct access to specific device types
@@ -131,6 +131,12 @@ namespace MM {
    const char* const g_Keyword_CoreSLM          = "SLM";
    const char* const g_Keyword_CoreGalvo        = "Galvo";
    const char* const g_Keyword_CoreTimeoutMs    = "TimeoutMs";
+   const char* const g_Keyword_CoreSequenceInsertsPerSecond = "SequenceInsertsPerSecond";
+   const char* const g_Keyword_CoreSequencePopsPerSecond = "SequencePopsPerSecond";
+   const char* const g_Keyword_CoreSequenceQueueDepth = "SequenceQueueDepth";
+   const char* const g_Keyword_CoreSequenceQueueDepthHighWaterMark = "SequenceQueueDepthHighWaterMark";
+   const char* const g_Keyword_CoreSequenceOverflowCount = "SequenceOverflowCount";
+   const char* const g_Keyword_CoreSequenceMeanResidenceMs = "SequenceMeanResidenceMs";
    const char* const g_Keyword_Channel          = "Channel";
    const char* const g_Keyword_Version          = "Version";
    const char* const g_Keyword_ColorMode        = "ColorMode";
@@ -0,0 +1,594 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          PixelConvert.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMDevice - Device adapter kit
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Conversion of camera pixel formats (YUV, packed mono, RGB24)
+//                to the formats used by Micro-Manager
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "PixelConvert.h"
+#include "PixelConvertKernels.h"
+
+#include "DeviceThreads.h"
+
+#ifdef _WIN32
+#include <intrin.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <cstddef>
+#include <vector>
+
+namespace {
+
+// Images smaller than this are not worth starting a thread for
+const unsigned long long minPixelsPerThread = 65536;
+
+inline unsigned char Clip(int value)
+{
+   return static_cast<unsigned char>(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+// ITU-R BT.601, studio range, in 8-bit fixed point
+inline void YUVToRGB32(int y, int u, int v, unsigned char* out)
+{
+   const int c = 298 * (y - 16) + 128;
+   const int d = u - 128;
+   const int e = v - 128;
+   out[0] = Clip((c + 516 * d) >> 8);
+   out[1] = Clip((c - 100 * d - 208 * e) >> 8);
+   out[2] = Clip((c + 409 * e) >> 8);
+   out[3] = 255;
+}
+
+//
+// Scalar reference implementations, converting pixels [begin, width) of a row
+//
+
+void YUV422RowToRGB32(unsigned char* dst, const unsigned char* src,
+      unsigned begin, unsigned width, bool uyvy)
+{
+   const unsigned yOffset = uyvy ? 1 : 0;
+   const unsigned uOffset = uyvy ? 0 : 1;
+   for (unsigned i = begin; i < width; i += 2)
+   {
+      const unsigned char* s = src + 2 * i;
+      const int u = s[uOffset];
+      const int v = s[uOffset + 2];
+      YUVToRGB32(s[yOffset], u, v, dst + 4 * i);
+      YUVToRGB32(s[yOffset + 2], u, v, dst + 4 * i + 4);
+   }
+}
+
+void NV12RowToRGB32(unsigned char* dst, const unsigned char* srcY,
+      const unsigned char* srcUV, unsigned begin, unsigned width)
+{
+   for (unsigned i = begin; i < width; i += 2)
+   {
+      const int u = srcUV[i];
+      const int v = srcUV[i + 1];
+      YUVToRGB32(srcY[i], u, v, dst + 4 * i);
+      YUVToRGB32(srcY[i + 1], u, v, dst + 4 * i + 4);
+   }
+}
+
+void YUYVRowToGray8(unsigned char* dst, const unsigned char* src,
+      unsigned begin, unsigned width)
+{
+   for (unsigned i = begin; i < width; ++i)
+      dst[i] = src[2 * i];
+}
+
+void RGB24RowToRGB32(unsigned char* dst, const unsigned char* src,
+      unsigned begin, unsigned width, bool bgr)
+{
+   const unsigned bOffset = bgr ? 0 : 2;
+   const unsigned rOffset = bgr ? 2 : 0;
+   for (unsigned i = begin; i < width; ++i)
+   {
+      const unsigned char* s = src + 3 * i;
+      unsigned char* d = dst + 4 * i;
+      d[0] = s[bOffset];
+      d[1] = s[1];
+      d[2] = s[rOffset];
+      d[3] = 255;
+   }
+}
+
+void Mono10PackedRowToGray16(unsigned short* dst, const unsigned char* src,
+      unsigned begin, unsigned width)
+{
+   for (unsigned i = begin; i < width; i += 4)
+   {
+      const unsigned char* s = src + i / 4 * 5;
+      const unsigned low = s[4];
+      for (unsigned k = 0; k < 4; ++k)
+         dst[i + k] = static_cast<unsigned short>(
+               (s[k] << 2) | ((low >> (2 * k)) & 0x3));
+   }
+}
+
+void Mono12PackedRowToGray16(unsigned short* dst, const unsigned char* src,
+      unsigned begin, unsigned width)
+{
+   for (unsigned i = begin; i < width; i += 2)
+   {
+      const unsigned char* s = src + i / 2 * 3;
+      dst[i] = static_cast<unsigned short>((s[0] << 4) | (s[2] & 0x0f));
+      dst[i + 1] = static_cast<unsigned short>((s[1] << 4) | (s[2] >> 4));
+   }
+}
+
+PixelConverter::InstructionSet DetectInstructionSet()
+{
+#if defined(PIXELCONVERT_X86) && defined(__GNUC__)
+   __builtin_cpu_init();
+#  ifdef PIXELCONVERT_AVX2
+   if (__builtin_cpu_supports("avx2"))
+      return PixelConverter::AVX2;
+#  endif
+   if (__builtin_cpu_supports("ssse3"))
+      return PixelConverter::SSSE3;
+   if (__builtin_cpu_supports("sse2"))
+      return PixelConverter::SSE2;
+#elif defined(PIXELCONVERT_X86) && defined(_MSC_VER)
+   int info[4];
+   __cpuid(info, 0);
+   const int maxLeaf = info[0];
+   __cpuid(info, 1);
+   const bool sse2 = (info[3] & (1 << 26)) != 0;
+   const bool ssse3 = (info[2] & (1 << 9)) != 0;
+#  ifdef PIXELCONVERT_AVX2
+   // AVX2 also needs the OS to save the YMM registers
+   const bool osxsave = (info[2] & (1 << 27)) != 0;
+   if (maxLeaf >= 7 && osxsave && (_xgetbv(0) & 0x6) == 0x6)
+   {
+      __cpuidex(info, 7, 0);
+      if (info[1] & (1 << 5))
+         return PixelConverter::AVX2;
+   }
+#  endif
+   (void)maxLeaf;
+   if (ssse3)
+      return PixelConverter::SSSE3;
+   if (sse2)
+      return PixelConverter::SSE2;
+#endif
+   return PixelConverter::Scalar;
+}
+
+class RowTask
+{
+public:
+   virtual ~RowTask() {}
+   virtual void Run(unsigned beginRow, unsigned endRow) const = 0;
+};
+
+class BandThread : public MMDeviceThreadBase
+{
+public:
+   BandThread(const RowTask& task, unsigned beginRow, unsigned endRow) :
+      task_(task),
+      beginRow_(beginRow),
+      endRow_(endRow)
+   {}
+
+   int svc()
+   {
+      task_.Run(beginRow_, endRow_);
+      return 0;
+   }
+
+private:
+   const RowTask& task_;
+   unsigned beginRow_;
+   unsigned endRow_;
+};
+
+// Splits the rows into bands converted on separate threads, the calling
+// thread converting the first band
+void RunRows(const RowTask& task, unsigned height, unsigned long long pixels,
+      unsigned threadCount)
+{
+   unsigned long long threads = threadCount;
+   if (threads > pixels / minPixelsPerThread)
+      threads = pixels / minPixelsPerThread;
+   if (threads > height)
+      threads = height;
+   if (threads <= 1)
+   {
+      task.Run(0, height);
+      return;
+   }
+
+   const unsigned bands = static_cast<unsigned>(threads);
+   std::vector<BandThread*> workers;
+   for (unsigned i = 1; i < bands; ++i)
+   {
+      workers.push_back(new BandThread(task,
+               static_cast<unsigned>((unsigned long long)height * i / bands),
+               static_cast<unsigned>((unsigned long long)height * (i + 1) / bands)));
+      workers.back()->activate();
+   }
+   task.Run(0, height / bands);
+   for (std::size_t i = 0; i < workers.size(); ++i)
+   {
+      workers[i]->wait();
+      delete workers[i];
+   }
+}
+
+class YUV422Task : public RowTask
+{
+public:
+   YUV422Task(unsigned char* dst, const unsigned char* src, unsigned width,
+         unsigned srcStride, bool uyvy, PixelConverter::InstructionSet isa) :
+      dst_(dst), src_(src), width_(width), srcStride_(srcStride),
+      uyvy_(uyvy), isa_(isa)
+   {}
+
+   void Run(unsigned beginRow, unsigned endRow) const
+   {
+      for (unsigned row = beginRow; row < endRow; ++row)
+      {
+         unsigned char* dst = dst_ + (std::size_t)row * width_ * 4;
+         const unsigned char* src = src_ + (std::size_t)row * srcStride_;
+         unsigned done = 0;
+#ifdef PIXELCONVERT_X86
+#  ifdef PIXELCONVERT_AVX2
+         if (isa_ >= PixelConverter::AVX2)
+            done = PixelConvertKernels::YUV422RowToRGB32_AVX2(dst, src,
+                  width_, uyvy_);
+         else
+#  endif
+         if (isa_ >= PixelConverter::SSE2)
+            done = PixelConvertKernels::YUV422RowToRGB32_SSE2(dst, src,
+                  width_, uyvy_);
+#endif
+         YUV422RowToRGB32(dst, src, done, width_, uyvy_);
+      }
+   }
+
+private:
+   unsigned char* dst_;
+   const unsigned char* src_;
+   unsigned width_;
+   unsigned srcStride_;
+   bool uyvy_;
+   PixelConverter::InstructionSet isa_;
+};
+
+class NV12Task : public RowTask
+{
+public:
+   NV12Task(unsigned char* dst, const unsigned char* srcY,
+         const unsigned char* srcUV, unsigned width, unsigned strideY,
+         unsigned strideUV, PixelConverter::InstructionSet isa) :
+      dst_(dst), srcY_(srcY), srcUV_(srcUV), width_(width),
+      strideY_(strideY), strideUV_(strideUV), isa_(isa)
+   {}
+
+   void Run(unsigned beginRow, unsigned endRow) const
+   {
+      for (unsigned row = beginRow; row < endRow; ++row)
+      {
+         unsigned char* dst = dst_ + (std::size_t)row * width_ * 4;
+         const unsigned char* y = srcY_ + (std::size_t)row * strideY_;
+         const unsigned char* uv = srcUV_ + (std::size_t)(row / 2) * strideUV_;
+         unsigned done = 0;
+#ifdef PIXELCONVERT_X86
+#  ifdef PIXELCONVERT_AVX2
+         if (isa_ >= PixelConverter::AVX2)
+            done = PixelConvertKernels::NV12RowToRGB32_AVX2(dst, y, uv, width_);
+         else
+#  endif
+         if (isa_ >= PixelConverter::SSE2)
+            done = PixelConvertKernels::NV12RowToRGB32_SSE2(dst, y, uv, width_);
+#endif
+         NV12RowToRGB32(dst, y, uv, done, width_);
+      }
+   }
+
+private:
+   unsigned char* dst_;
+   const unsigned char* srcY_;
+   const unsigned char* srcUV_;
+   unsigned width_;
+   unsigned strideY_;
+   unsigned strideUV_;
+   PixelConverter::InstructionSet isa_;
+};
+
+class YUYVGrayTask : public RowTask
+{
+public:
+   YUYVGrayTask(unsigned char* dst, const unsigned char* src, unsigned width,
+         unsigned srcStride, PixelConverter::InstructionSet isa) :
+      dst_(dst), src_(src), width_(width), srcStride_(srcStride), isa_(isa)
+   {}
+
+   void Run(unsigned beginRow, unsigned endRow) const
+   {
+      for (unsigned row = beginRow; row < endRow; ++row)
+      {
+         unsigned char* dst = dst_ + (std::size_t)row * width_;
+         const unsigned char* src = src_ + (std::size_t)row * srcStride_;
+         unsigned done = 0;
+#ifdef PIXELCONVERT_X86
+         if (isa_ >= PixelConverter::SSE2)
+            done = PixelConvertKernels::YUYVRowToGray8_SSE2(dst, src, width_);
+#endif
+         YUYVRowToGray8(dst, src, done, width_);
+      }
+   }
+
+private:
+   unsigned char* dst_;
+   const unsigned char* src_;
+   unsigned width_;
+   unsigned srcStride_;
+   PixelConverter::InstructionSet isa_;
+};
+
+class RGB24Task : public RowTask
+{
+public:
+   RGB24Task(unsigned char* dst, const unsigned char* src, unsigned width,
+         unsigned srcStride, bool bgr, PixelConverter::InstructionSet isa) :
+      dst_(dst), src_(src), width_(width), srcStride_(srcStride), bgr_(bgr),
+      isa_(isa)
+   {}
+
+   void Run(unsigned beginRow, unsigned endRow) const
+   {
+      for (unsigned row = beginRow; row < endRow; ++row)
+      {
+         unsigned char* dst = dst_ + (std::size_t)row * width_ * 4;
+         const unsigned char* src = src_ + (std::size_t)row * srcStride_;
+         unsigned done = 0;
+#ifdef PIXELCONVERT_X86
+         if (isa_ >= PixelConverter::SSSE3)
+            done = PixelConvertKernels::RGB24RowToRGB32_SSSE3(dst, src,
+                  width_, bgr_);
+#endif
+         RGB24RowToRGB32(dst, src, done, width_, bgr_);
+      }
+   }
+
+private:
+   unsigned char* dst_;
+   const unsigned char* src_;
+   unsigned width_;
+   unsigned srcStride_;
+   bool bgr_;
+   PixelConverter::InstructionSet isa_;
+};
+
+class MonoPackedTask : public RowTask
+{
+public:
+   MonoPackedTask(unsigned short* dst, const unsigned char* src,
+         unsigned width, unsigned srcStride, unsigned bitDepth,
+         PixelConverter::InstructionSet isa) :
+      dst_(dst), src_(src), width_(width), srcStride_(srcStride),
+      bitDepth_(bitDepth), isa_(isa)
+   {}
+
+   void Run(unsigned beginRow, unsigned endRow) const
+   {
+      for (unsigned row = beginRow; row < endRow; ++row)
+      {
+         unsigned short* dst = dst_ + (std::size_t)row * width_;
+         const unsigned char* src = src_ + (std::size_t)row * srcStride_;
+         unsigned done = 0;
+         if (bitDepth_ == 10)
+         {
+#ifdef PIXELCONVERT_X86
+            if (isa_ >= PixelConverter::SSSE3)
+               done = PixelConvertKernels::Mono10PackedRowToGray16_SSSE3(dst,
+                     src, width_);
+#endif
+            Mono10PackedRowToGray16(dst, src, done, width_);
+         }
+         else
+         {
+#ifdef PIXELCONVERT_X86
+            if (isa_ >= PixelConverter::SSSE3)
+               done = PixelConvertKernels::Mono12PackedRowToGray16_SSSE3(dst,
+                     src, width_);
+#endif
+            Mono12PackedRowToGray16(dst, src, done, width_);
+         }
+      }
+   }
+
+private:
+   unsigned short* dst_;
+   const unsigned char* src_;
+   unsigned width_;
+   unsigned srcStride_;
+   unsigned bitDepth_;
+   PixelConverter::InstructionSet isa_;
+};
+
+class LUTTask : public RowTask
+{
+public:
+   LUTTask(unsigned char* dst, const unsigned short* src, unsigned width,
+         unsigned srcStride, const unsigned char* lut) :
+      dst_(dst), src_(src), width_(width), srcStride_(srcStride), lut_(lut)
+   {}
+
+   void Run(unsigned beginRow, unsigned endRow) const
+   {
+      const unsigned char* srcBytes = reinterpret_cast<const unsigned char*>(src_);
+      for (unsigned row = beginRow; row < endRow; ++row)
+      {
+         unsigned char* dst = dst_ + (std::size_t)row * width_;
+         const unsigned short* src = reinterpret_cast<const unsigned short*>(
+               srcBytes + (std::size_t)row * srcStride_);
+         for (unsigned i = 0; i < width_; ++i)
+            dst[i] = lut_[src[i]];
+      }
+   }
+
+private:
+   unsigned char* dst_;
+   const unsigned short* src_;
+   unsigned width_;
+   unsigned srcStride_;
+   const unsigned char* lut_;
+};
+
+} // anonymous namespace
+
+
+PixelConverter::PixelConverter() :
+   instructionSet_(GetSupportedInstructionSet()),
+   threadCount_(1)
+{
+}
+
+PixelConverter::~PixelConverter()
+{
+}
+
+PixelConverter::InstructionSet PixelConverter::GetSupportedInstructionSet()
+{
+   static const InstructionSet supported = DetectInstructionSet();
+   return supported;
+}
+
+const char* PixelConverter::GetInstructionSetName(InstructionSet instructionSet)
+{
+   switch (instructionSet)
+   {
+      case SSE2: return "SSE2";
+      case SSSE3: return "SSSE3";
+      case AVX2: return "AVX2";
+      default: return "Scalar";
+   }
+}
+
+unsigned PixelConverter::GetProcessorCount()
+{
+#ifdef _WIN32
+   SYSTEM_INFO info;
+   GetSystemInfo(&info);
+   long count = info.dwNumberOfProcessors;
+#else
+   long count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+   return count > 0 ? static_cast<unsigned>(count) : 1;
+}
+
+void PixelConverter::SetInstructionSet(InstructionSet instructionSet)
+{
+   InstructionSet supported = GetSupportedInstructionSet();
+   instructionSet_ = instructionSet < supported ? instructionSet : supported;
+}
+
+void PixelConverter::SetThreadCount(unsigned count)
+{
+   threadCount_ = count > 0 ? count : 1;
+}
+
+void PixelConverter::YUYVToRGB32(unsigned char* dst, const unsigned char* src,
+      unsigned width, unsigned height, unsigned srcStride) const
+{
+   RunRows(YUV422Task(dst, src, width, srcStride, false, instructionSet_),
+         height, (unsigned long long)width * height, threadCount_);
+}
+
+void PixelConverter::UYVYToRGB32(unsigned char* dst, const unsigned char* src,
+      unsigned width, unsigned height, unsigned srcStride) const
+{
+   RunRows(YUV422Task(dst, src, width, srcStride, true, instructionSet_),
+         height, (unsigned long long)width * height, threadCount_);
+}
+
+void PixelConverter::NV12ToRGB32(unsigned char* dst, const unsigned char* srcY,
+      const unsigned char* srcUV, unsigned width, unsigned height,
+      unsigned strideY, unsigned strideUV) const
+{
+   RunRows(NV12Task(dst, srcY, srcUV, width, strideY, strideUV,
+            instructionSet_),
+         height, (unsigned long long)width * height, threadCount_);
+}
+
+void PixelConverter::YUYVToGray8(unsigned char* dst, const unsigned char* src,
+      unsigned width, unsigned height, unsigned srcStride) const
+{
+   RunRows(YUYVGrayTask(dst, src, width, srcStride, instructionSet_),
+         height, (unsigned long long)width * height, threadCount_);
+}
+
+void PixelConverter::RGB24ToRGB32(unsigned char* dst, const unsigned char* src,
+      unsigned width, unsigned height, unsigned srcStride) const
+{
+   RunRows(RGB24Task(dst, src, width, srcStride, false, instructionSet_),
+         height, (unsigned long long)width * height, threadCount_);
+}
+
+void PixelConverter::BGR24ToRGB32(unsigned char* dst, const unsigned char* src,
+      unsigned width, unsigned height, unsigned srcStride) const
+{
+   RunRows(RGB24Task(dst, src, width, srcStride, true, instructionSet_),
+         height, (unsigned long long)width * height, threadCount_);
+}
+
+void PixelConverter::Mono10PackedToGray16(unsigned short* dst,
+      const unsigned char* src, unsigned width, unsigned height,
+      unsigned srcStride) const
+{
+   RunRows(MonoPackedTask(dst, src, width, srcStride, 10, instructionSet_),
+         height, (unsigned long long)width * height, threadCount_);
+}
+
+void PixelConverter::Mono12PackedToGray16(unsigned short* dst,
+      const unsigned char* src, unsigned width, unsigned height,
+      unsigned srcStride) const
+{
+   RunRows(MonoPackedTask(dst, src, width, srcStride, 12, instructionSet_),
+         height, (unsigned long long)width * height, threadCount_);
+}
+
+void PixelConverter::Gray16ToGray8(unsigned char* dst,
+      const unsigned short* src, unsigned width, unsigned height,
+      unsigned srcStride, const unsigned char* lut) const
+{
+   RunRows(LUTTask(dst, src, width, srcStride, lut),
+         height, (unsigned long long)width * height, threadCount_);
+}
+
+void PixelConverter::BuildLinearLUT(unsigned char* lut,
+      unsigned short minValue, unsigned short maxValue)
+{
+   const unsigned range = maxValue > minValue ? maxValue - minValue : 1;
+   for (unsigned i = 0; i < 65536; ++i)
+   {
+      if (i <= minValue)
+         lut[i] = 0;
+      else if (i >= maxValue)
+         lut[i] = 255;
+      else
+         lut[i] = static_cast<unsigned char>(
+               ((i - minValue) * 255 + range / 2) / range);
+   }
+}
@@ -0,0 +1,118 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          PixelConvert.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMDevice - Device adapter kit
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Conversion of camera pixel formats (YUV, packed mono, RGB24)
+//                to the formats used by Micro-Manager
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#ifndef _PIXELCONVERT_H_
+#define _PIXELCONVERT_H_
+
+/**
+ * Converts camera images into Micro-Manager's pixel formats: GRAY8, GRAY16
+ * and RGB32 (stored as B, G, R, A bytes, with A set to 255).
+ *
+ * Each conversion has a portable scalar implementation, which defines the
+ * result, and on x86 processors SIMD implementations (SSE2, SSSE3, AVX2)
+ * chosen at run time according to the processor's capabilities. The SIMD
+ * implementations give results identical to the scalar ones. Images can
+ * also be split into bands of rows converted on several threads.
+ *
+ * Source rows are given with their stride (bytes from the start of one row
+ * to the next), so that padded driver buffers can be converted directly.
+ * Destination images are tightly packed. Widths of YUV 4:2:2 images must be
+ * even; widths of packed mono images must be a multiple of the packing
+ * group (4 pixels for 10-bit, 2 pixels for 12-bit).
+ *
+ * YUV is converted with the ITU-R BT.601 studio-range (16-235) equations.
+ */
+class PixelConverter
+{
+public:
+   enum InstructionSet
+   {
+      Scalar,
+      SSE2,
+      SSSE3,
+      AVX2
+   };
+
+   PixelConverter();
+   ~PixelConverter();
+
+   // The best instruction set supported by the processor and this build
+   static InstructionSet GetSupportedInstructionSet();
+   static const char* GetInstructionSetName(InstructionSet instructionSet);
+   static unsigned GetProcessorCount();
+
+   // Limits the instruction set used by this converter (e.g. for testing).
+   // The supported instruction set is used by default.
+   void SetInstructionSet(InstructionSet instructionSet);
+   InstructionSet GetInstructionSet() const { return instructionSet_; }
+
+   // Number of threads an image is split across (default 1). Small images
+   // are always converted on the calling thread.
+   void SetThreadCount(unsigned count);
+   unsigned GetThreadCount() const { return threadCount_; }
+
+   // YUV 4:2:2 with byte order Y0 U Y1 V to RGB32
+   void YUYVToRGB32(unsigned char* dst, const unsigned char* src,
+         unsigned width, unsigned height, unsigned srcStride) const;
+   // YUV 4:2:2 with byte order U Y0 V Y1 to RGB32
+   void UYVYToRGB32(unsigned char* dst, const unsigned char* src,
+         unsigned width, unsigned height, unsigned srcStride) const;
+   // YUV 4:2:0 with a Y plane and an interleaved U V plane to RGB32
+   void NV12ToRGB32(unsigned char* dst, const unsigned char* srcY,
+         const unsigned char* srcUV, unsigned width, unsigned height,
+         unsigned strideY, unsigned strideUV) const;
+   // Luma of YUYV images to GRAY8
+   void YUYVToGray8(unsigned char* dst, const unsigned char* src,
+         unsigned width, unsigned height, unsigned srcStride) const;
+
+   // 24-bit color with byte order R G B to RGB32
+   void RGB24ToRGB32(unsigned char* dst, const unsigned char* src,
+         unsigned width, unsigned height, unsigned srcStride) const;
+   // 24-bit color with byte order B G R to RGB32
+   void BGR24ToRGB32(unsigned char* dst, const unsigned char* src,
+         unsigned width, unsigned height, unsigned srcStride) const;
+
+   // 10-bit mono packed as in MIPI CSI-2 RAW10 (V4L2 Y10P): four pixels in
+   // five bytes, the 8 high bits of each followed by a byte of low bits
+   void Mono10PackedToGray16(unsigned short* dst, const unsigned char* src,
+         unsigned width, unsigned height, unsigned srcStride) const;
+   // 12-bit mono packed as in MIPI CSI-2 RAW12 (V4L2 Y12P): two pixels in
+   // three bytes, the 8 high bits of each followed by a byte of low bits
+   void Mono12PackedToGray16(unsigned short* dst, const unsigned char* src,
+         unsigned width, unsigned height, unsigned srcStride) const;
+
+   // GRAY16 to GRAY8 through a lookup table of 65536 entries
+   void Gray16ToGray8(unsigned char* dst, const unsigned short* src,
+         unsigned width, unsigned height, unsigned srcStride,
+         const unsigned char* lut) const;
+   // Fills a 65536-entry table mapping [minValue, maxValue] linearly to
+   // [0, 255], clipping values outside
+   static void BuildLinearLUT(unsigned char* lut, unsigned short minValue,
+         unsigned short maxValue);
+
+private:
+   InstructionSet instructionSet_;
+   unsigned threadCount_;
+};
+
+#endif // _PIXELCONVERT_H_
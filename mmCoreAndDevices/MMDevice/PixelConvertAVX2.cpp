@@ -0,0 +1,123 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          PixelConvertAVX2.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMDevice - Device adapter kit
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   AVX2 row kernels of PixelConverter
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "PixelConvertKernels.h"
+
+#ifdef PIXELCONVERT_AVX2
+
+#include <immintrin.h>
+
+namespace PixelConvertKernels {
+
+namespace {
+
+// Same arithmetic as the SSE2 kernel. AVX2 operates on each 128-bit half
+// separately, so each half of the register holds 8 consecutive pixels.
+PIXELCONVERT_TARGET("avx2") inline
+void YUYV4ToBGR(__m256i yuyv, __m256i& b, __m256i& g, __m256i& r)
+{
+   const __m256i v = _mm256_sub_epi16(yuyv, _mm256_set1_epi32(0x00800010));
+   const __m256i y = _mm256_add_epi32(
+         _mm256_madd_epi16(v, _mm256_set1_epi32(298)),
+         _mm256_set1_epi32(128));
+   const __m256i ub = _mm256_madd_epi16(v, _mm256_set_epi16(
+            0, 0, 516, 0, 0, 0, 516, 0, 0, 0, 516, 0, 0, 0, 516, 0));
+   const __m256i vr = _mm256_madd_epi16(v, _mm256_set_epi16(
+            409, 0, 0, 0, 409, 0, 0, 0, 409, 0, 0, 0, 409, 0, 0, 0));
+   const __m256i uvg = _mm256_madd_epi16(v, _mm256_set_epi16(
+            -208, 0, -100, 0, -208, 0, -100, 0,
+            -208, 0, -100, 0, -208, 0, -100, 0));
+   b = _mm256_srai_epi32(_mm256_add_epi32(y,
+            _mm256_shuffle_epi32(ub, _MM_SHUFFLE(2, 2, 0, 0))), 8);
+   r = _mm256_srai_epi32(_mm256_add_epi32(y,
+            _mm256_shuffle_epi32(vr, _MM_SHUFFLE(3, 3, 1, 1))), 8);
+   g = _mm256_srai_epi32(_mm256_add_epi32(y, _mm256_add_epi32(uvg,
+               _mm256_shuffle_epi32(uvg, _MM_SHUFFLE(2, 3, 0, 1)))), 8);
+}
+
+// Converts 16 pixels in YUYV order (pixels 0-7 in the low half, 8-15 in the
+// high half) and stores them as 64 bytes of BGRA
+PIXELCONVERT_TARGET("avx2") inline
+void YUYV16ToRGB32(__m256i yuyv, unsigned char* dst)
+{
+   const __m256i zero = _mm256_setzero_si256();
+   __m256i b0, g0, r0, b1, g1, r1;
+   YUYV4ToBGR(_mm256_unpacklo_epi8(yuyv, zero), b0, g0, r0);
+   YUYV4ToBGR(_mm256_unpackhi_epi8(yuyv, zero), b1, g1, r1);
+
+   const __m256i b = _mm256_packs_epi32(b0, b1);
+   const __m256i g = _mm256_packs_epi32(g0, g1);
+   const __m256i r = _mm256_packs_epi32(r0, r1);
+   const __m256i bg = _mm256_unpacklo_epi8(_mm256_packus_epi16(b, b),
+         _mm256_packus_epi16(g, g));
+   const __m256i ra = _mm256_unpacklo_epi8(_mm256_packus_epi16(r, r),
+         _mm256_set1_epi8(-1));
+   // Pixels 0-3 and 8-11, then 4-7 and 12-15
+   const __m256i lo = _mm256_unpacklo_epi16(bg, ra);
+   const __m256i hi = _mm256_unpackhi_epi16(bg, ra);
+   _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst),
+         _mm256_permute2x128_si256(lo, hi, 0x20));
+   _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 32),
+         _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+} // anonymous namespace
+
+PIXELCONVERT_TARGET("avx2")
+unsigned YUV422RowToRGB32_AVX2(unsigned char* dst, const unsigned char* src,
+      unsigned width, bool uyvy)
+{
+   unsigned i = 0;
+   for (; i + 16 <= width; i += 16)
+   {
+      __m256i in = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(src + 2 * i));
+      if (uyvy)
+         in = _mm256_or_si256(_mm256_slli_epi16(in, 8),
+               _mm256_srli_epi16(in, 8));
+      YUYV16ToRGB32(in, dst + 4 * i);
+   }
+   return i;
+}
+
+PIXELCONVERT_TARGET("avx2")
+unsigned NV12RowToRGB32_AVX2(unsigned char* dst, const unsigned char* srcY,
+      const unsigned char* srcUV, unsigned width)
+{
+   unsigned i = 0;
+   for (; i + 16 <= width; i += 16)
+   {
+      const __m128i y = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(srcY + i));
+      const __m128i uv = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(srcUV + i));
+      const __m256i yuyv = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_unpacklo_epi8(y, uv)),
+            _mm_unpackhi_epi8(y, uv), 1);
+      YUYV16ToRGB32(yuyv, dst + 4 * i);
+   }
+   return i;
+}
+
+} // namespace PixelConvertKernels
+
+#endif // PIXELCONVERT_AVX2
@@ -0,0 +1,77 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          PixelConvertKernels.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMDevice - Device adapter kit
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Internal SIMD row kernels of PixelConverter
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#ifndef _PIXELCONVERTKERNELS_H_
+#define _PIXELCONVERTKERNELS_H_
+
+// Each instruction set has its kernels in a separate file. Only the kernel
+// functions are compiled for that instruction set (through function target
+// attributes, so that no special compiler flags are needed), and they are
+// called only after checking that the processor supports it.
+//
+// The kernels convert the leading pixels of a row, in whole blocks, and
+// return how many pixels they converted; the caller converts the rest with
+// the scalar code.
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#  define PIXELCONVERT_X86
+#  if !defined(_MSC_VER) || _MSC_VER >= 1700 // No AVX2 intrinsics in VS2010
+#     define PIXELCONVERT_AVX2
+#  endif
+#endif
+
+#if defined(__GNUC__)
+#  define PIXELCONVERT_TARGET(isa) __attribute__((target(isa)))
+#else
+#  define PIXELCONVERT_TARGET(isa)
+#endif
+
+#ifdef PIXELCONVERT_X86
+
+namespace PixelConvertKernels {
+
+unsigned YUV422RowToRGB32_SSE2(unsigned char* dst, const unsigned char* src,
+      unsigned width, bool uyvy);
+unsigned NV12RowToRGB32_SSE2(unsigned char* dst, const unsigned char* srcY,
+      const unsigned char* srcUV, unsigned width);
+unsigned YUYVRowToGray8_SSE2(unsigned char* dst, const unsigned char* src,
+      unsigned width);
+
+unsigned RGB24RowToRGB32_SSSE3(unsigned char* dst, const unsigned char* src,
+      unsigned width, bool bgr);
+unsigned Mono10PackedRowToGray16_SSSE3(unsigned short* dst,
+      const unsigned char* src, unsigned width);
+unsigned Mono12PackedRowToGray16_SSSE3(unsigned short* dst,
+      const unsigned char* src, unsigned width);
+
+#ifdef PIXELCONVERT_AVX2
+unsigned YUV422RowToRGB32_AVX2(unsigned char* dst, const unsigned char* src,
+      unsigned width, bool uyvy);
+unsigned NV12RowToRGB32_AVX2(unsigned char* dst, const unsigned char* srcY,
+      const unsigned char* srcUV, unsigned width);
+#endif
+
+} // namespace PixelConvertKernels
+
+#endif // PIXELCONVERT_X86
+
+#endif // _PIXELCONVERTKERNELS_H_
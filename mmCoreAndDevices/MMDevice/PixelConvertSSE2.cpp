@@ -0,0 +1,136 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          PixelConvertSSE2.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMDevice - Device adapter kit
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   SSE2 row kernels of PixelConverter
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "PixelConvertKernels.h"
+
+#ifdef PIXELCONVERT_X86
+
+#include <emmintrin.h>
+
+namespace PixelConvertKernels {
+
+namespace {
+
+// Converts 4 pixels given as 16-bit Y U Y V samples to 32-bit B, G and R
+// values (before clipping), with the same integer arithmetic as the scalar
+// code: madd gives the exact 32-bit sums of products.
+PIXELCONVERT_TARGET("sse2") inline
+void YUYV4ToBGR(__m128i yuyv, __m128i& b, __m128i& g, __m128i& r)
+{
+   const __m128i v = _mm_sub_epi16(yuyv, _mm_set1_epi32(0x00800010));
+   const __m128i y = _mm_add_epi32(
+         _mm_madd_epi16(v, _mm_set1_epi32(298)), _mm_set1_epi32(128));
+   // Chroma terms come out for each pixel pair; spread them to both pixels
+   const __m128i ub = _mm_madd_epi16(v,
+         _mm_set_epi16(0, 0, 516, 0, 0, 0, 516, 0));
+   const __m128i vr = _mm_madd_epi16(v,
+         _mm_set_epi16(409, 0, 0, 0, 409, 0, 0, 0));
+   const __m128i uvg = _mm_madd_epi16(v,
+         _mm_set_epi16(-208, 0, -100, 0, -208, 0, -100, 0));
+   b = _mm_srai_epi32(_mm_add_epi32(y,
+            _mm_shuffle_epi32(ub, _MM_SHUFFLE(2, 2, 0, 0))), 8);
+   r = _mm_srai_epi32(_mm_add_epi32(y,
+            _mm_shuffle_epi32(vr, _MM_SHUFFLE(3, 3, 1, 1))), 8);
+   g = _mm_srai_epi32(_mm_add_epi32(y, _mm_add_epi32(uvg,
+               _mm_shuffle_epi32(uvg, _MM_SHUFFLE(2, 3, 0, 1)))), 8);
+}
+
+// Converts 8 pixels in YUYV order and stores them as 32 bytes of BGRA
+PIXELCONVERT_TARGET("sse2") inline
+void YUYV8ToRGB32(__m128i yuyv, unsigned char* dst)
+{
+   const __m128i zero = _mm_setzero_si128();
+   __m128i b0, g0, r0, b1, g1, r1;
+   YUYV4ToBGR(_mm_unpacklo_epi8(yuyv, zero), b0, g0, r0);
+   YUYV4ToBGR(_mm_unpackhi_epi8(yuyv, zero), b1, g1, r1);
+
+   // Saturating packs clip to [0, 255]
+   const __m128i b = _mm_packs_epi32(b0, b1);
+   const __m128i g = _mm_packs_epi32(g0, g1);
+   const __m128i r = _mm_packs_epi32(r0, r1);
+   const __m128i bg = _mm_unpacklo_epi8(_mm_packus_epi16(b, b),
+         _mm_packus_epi16(g, g));
+   const __m128i ra = _mm_unpacklo_epi8(_mm_packus_epi16(r, r),
+         _mm_set1_epi8(-1));
+   _mm_storeu_si128(reinterpret_cast<__m128i*>(dst),
+         _mm_unpacklo_epi16(bg, ra));
+   _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16),
+         _mm_unpackhi_epi16(bg, ra));
+}
+
+} // anonymous namespace
+
+PIXELCONVERT_TARGET("sse2")
+unsigned YUV422RowToRGB32_SSE2(unsigned char* dst, const unsigned char* src,
+      unsigned width, bool uyvy)
+{
+   unsigned i = 0;
+   for (; i + 8 <= width; i += 8)
+   {
+      __m128i in = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(src + 2 * i));
+      if (uyvy) // Swap bytes to YUYV order
+         in = _mm_or_si128(_mm_slli_epi16(in, 8), _mm_srli_epi16(in, 8));
+      YUYV8ToRGB32(in, dst + 4 * i);
+   }
+   return i;
+}
+
+PIXELCONVERT_TARGET("sse2")
+unsigned NV12RowToRGB32_SSE2(unsigned char* dst, const unsigned char* srcY,
+      const unsigned char* srcUV, unsigned width)
+{
+   unsigned i = 0;
+   for (; i + 8 <= width; i += 8)
+   {
+      // Interleaving 8 Y with 4 U V pairs gives YUYV order
+      const __m128i y = _mm_loadl_epi64(
+            reinterpret_cast<const __m128i*>(srcY + i));
+      const __m128i uv = _mm_loadl_epi64(
+            reinterpret_cast<const __m128i*>(srcUV + i));
+      YUYV8ToRGB32(_mm_unpacklo_epi8(y, uv), dst + 4 * i);
+   }
+   return i;
+}
+
+PIXELCONVERT_TARGET("sse2")
+unsigned YUYVRowToGray8_SSE2(unsigned char* dst, const unsigned char* src,
+      unsigned width)
+{
+   const __m128i lumaMask = _mm_set1_epi16(0x00ff);
+   unsigned i = 0;
+   for (; i + 16 <= width; i += 16)
+   {
+      const __m128i a = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(src + 2 * i));
+      const __m128i b = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(src + 2 * i + 16));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+            _mm_packus_epi16(_mm_and_si128(a, lumaMask),
+               _mm_and_si128(b, lumaMask)));
+   }
+   return i;
+}
+
+} // namespace PixelConvertKernels
+
+#endif // PIXELCONVERT_X86
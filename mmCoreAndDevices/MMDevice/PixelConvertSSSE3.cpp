@@ -0,0 +1,137 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          PixelConvertSSSE3.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMDevice - Device adapter kit
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   SSSE3 row kernels of PixelConverter
+//
+// AUTHOR:        agent, agent@local, 10/19/2026
+//
+// COPYRIGHT:     agent, 2026
+//
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "PixelConvertKernels.h"
+
+#ifdef PIXELCONVERT_X86
+
+#include <tmmintrin.h>
+
+namespace PixelConvertKernels {
+
+PIXELCONVERT_TARGET("ssse3")
+unsigned RGB24RowToRGB32_SSSE3(unsigned char* dst, const unsigned char* src,
+      unsigned width, bool bgr)
+{
+   // Each shuffle places 4 pixels (12 bytes) in B G R order, leaving zeros
+   // for alpha
+   const __m128i shuffle = bgr ?
+      _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1) :
+      _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+   const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xff000000));
+
+   unsigned i = 0;
+   for (; i + 16 <= width; i += 16)
+   {
+      const unsigned char* s = src + 3 * i;
+      const __m128i in0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+      const __m128i in1 = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(s + 16));
+      const __m128i in2 = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(s + 32));
+
+      // Bring each group of 4 pixels to the start of a register
+      const __m128i p0 = in0;
+      const __m128i p1 = _mm_alignr_epi8(in1, in0, 12);
+      const __m128i p2 = _mm_alignr_epi8(in2, in1, 8);
+      const __m128i p3 = _mm_srli_si128(in2, 4);
+
+      __m128i* d = reinterpret_cast<__m128i*>(dst + 4 * i);
+      _mm_storeu_si128(d, _mm_or_si128(_mm_shuffle_epi8(p0, shuffle), alpha));
+      _mm_storeu_si128(d + 1,
+            _mm_or_si128(_mm_shuffle_epi8(p1, shuffle), alpha));
+      _mm_storeu_si128(d + 2,
+            _mm_or_si128(_mm_shuffle_epi8(p2, shuffle), alpha));
+      _mm_storeu_si128(d + 3,
+            _mm_or_si128(_mm_shuffle_epi8(p3, shuffle), alpha));
+   }
+   return i;
+}
+
+// The packed formats are unpacked by placing, in each 16-bit lane, the byte
+// holding the pixel's high bits above the byte holding its low bits, then
+// shifting the low bits into place with a per-lane multiplication.
+
+PIXELCONVERT_TARGET("ssse3")
+unsigned Mono10PackedRowToGray16_SSSE3(unsigned short* dst,
+      const unsigned char* src, unsigned width)
+{
+   const __m128i shuffle = _mm_setr_epi8(4, 0, 4, 1, 4, 2, 4, 3,
+         9, 5, 9, 6, 9, 7, 9, 8);
+   // Moves the 2 low bits of pixel k (bits 2k, 2k + 1) to bits 6 and 7
+   const __m128i lowShift = _mm_setr_epi16(64, 16, 4, 1, 64, 16, 4, 1);
+   const __m128i highMask = _mm_set1_epi16(0x03fc);
+   const __m128i lowMask = _mm_set1_epi16(0x0003);
+   const __m128i byteMask = _mm_set1_epi16(0x00ff);
+
+   // 8 pixels from 10 bytes, with loads of 16 bytes that must stay in the row
+   const unsigned rowBytes = width / 4 * 5;
+   unsigned i = 0;
+   for (; i + 8 <= width && i / 4 * 5 + 16 <= rowBytes; i += 8)
+   {
+      const __m128i in = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(src + i / 4 * 5));
+      const __m128i v = _mm_shuffle_epi8(in, shuffle);
+      const __m128i high = _mm_and_si128(_mm_srli_epi16(v, 6), highMask);
+      const __m128i low = _mm_and_si128(_mm_srli_epi16(
+               _mm_mullo_epi16(_mm_and_si128(v, byteMask), lowShift), 6),
+            lowMask);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+            _mm_or_si128(high, low));
+   }
+   return i;
+}
+
+PIXELCONVERT_TARGET("ssse3")
+unsigned Mono12PackedRowToGray16_SSSE3(unsigned short* dst,
+      const unsigned char* src, unsigned width)
+{
+   const __m128i shuffle = _mm_setr_epi8(2, 0, 2, 1, 5, 3, 5, 4,
+         8, 6, 8, 7, 11, 9, 11, 10);
+   // Moves the 4 low bits of even pixels (bits 0-3) and odd pixels (bits
+   // 4-7) to bits 4-7
+   const __m128i lowShift = _mm_setr_epi16(16, 1, 16, 1, 16, 1, 16, 1);
+   const __m128i highMask = _mm_set1_epi16(0x0ff0);
+   const __m128i lowMask = _mm_set1_epi16(0x000f);
+   const __m128i byteMask = _mm_set1_epi16(0x00ff);
+
+   // 8 pixels from 12 bytes, with loads of 16 bytes that must stay in the row
+   const unsigned rowBytes = width / 2 * 3;
+   unsigned i = 0;
+   for (; i + 8 <= width && i / 2 * 3 + 16 <= rowBytes; i += 8)
+   {
+      const __m128i in = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(src + i / 2 * 3));
+      const __m128i v = _mm_shuffle_epi8(in, shuffle);
+      const __m128i high = _mm_and_si128(_mm_srli_epi16(v, 4), highMask);
+      const __m128i low = _mm_and_si128(_mm_srli_epi16(
+               _mm_mullo_epi16(_mm_and_si128(v, byteMask), lowShift), 4),
+            lowMask);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+            _mm_or_si128(high, low));
+   }
+   return i;
+}
+
+} // namespace PixelConvertKernels
+
+#endif // PIXELCONVERT_X86
@@ -0,0 +1,185 @@
+#include <gtest/gtest.h>
+
+#include "PixelConvert.h"
+
+#include <vector>
+
+
+namespace {
+
+// Widths that leave partial SIMD blocks at the end of rows
+const unsigned testWidth = 92;
+const unsigned testHeight = 7;
+
+std::vector<unsigned char> RandomBytes(std::size_t n)
+{
+   std::vector<unsigned char> bytes(n);
+   unsigned state = 12345;
+   for (std::size_t i = 0; i < n; ++i)
+   {
+      state = state * 1103515245 + 12345;
+      bytes[i] = static_cast<unsigned char>(state >> 16);
+   }
+   return bytes;
+}
+
+std::vector<PixelConverter::InstructionSet> SupportedInstructionSets()
+{
+   std::vector<PixelConverter::InstructionSet> sets;
+   const PixelConverter::InstructionSet supported =
+      PixelConverter::GetSupportedInstructionSet();
+   for (int isa = PixelConverter::Scalar; isa <= supported; ++isa)
+      sets.push_back(static_cast<PixelConverter::InstructionSet>(isa));
+   return sets;
+}
+
+} // anonymous namespace
+
+
+TEST(PixelConvertTests, YUVReferenceValues)
+{
+   // Y U Y V: black and white, then pure red (BT.601)
+   const unsigned char yuyv[] = { 16, 128, 235, 128, 81, 90, 81, 240 };
+   std::vector<unsigned char> rgb32(16);
+   PixelConverter converter;
+   converter.SetInstructionSet(PixelConverter::Scalar);
+   converter.YUYVToRGB32(&rgb32[0], yuyv, 2, 2, 4);
+
+   const unsigned char expected[] = { 0, 0, 0, 255, 255, 255, 255, 255,
+      0, 0, 255, 255, 0, 0, 255, 255 };
+   for (unsigned i = 0; i < 16; ++i)
+      EXPECT_NEAR(expected[i], rgb32[i], 1) << "byte " << i;
+}
+
+
+TEST(PixelConvertTests, UnpacksMono10)
+{
+   // 0x3ff, 0x000, 0x155, 0x2aa
+   const unsigned char packed[] = { 0xff, 0x00, 0x55, 0xaa, 0x93 };
+   unsigned short pixels[4];
+   PixelConverter().Mono10PackedToGray16(pixels, packed, 4, 1, 5);
+   EXPECT_EQ(0x3ff, pixels[0]);
+   EXPECT_EQ(0x000, pixels[1]);
+   EXPECT_EQ(0x155, pixels[2]);
+   EXPECT_EQ(0x2aa, pixels[3]);
+}
+
+
+TEST(PixelConvertTests, UnpacksMono12)
+{
+   // 0xabc, 0x123
+   const unsigned char packed[] = { 0xab, 0x12, 0x3c };
+   unsigned short pixels[2];
+   PixelConverter().Mono12PackedToGray16(pixels, packed, 2, 1, 3);
+   EXPECT_EQ(0xabc, pixels[0]);
+   EXPECT_EQ(0x123, pixels[1]);
+}
+
+
+TEST(PixelConvertTests, OrdersRGB24)
+{
+   const unsigned char rgb[] = { 1, 2, 3 };
+   unsigned char bgra[4];
+   PixelConverter converter;
+   converter.RGB24ToRGB32(bgra, rgb, 1, 1, 3);
+   EXPECT_EQ(3, bgra[0]);
+   EXPECT_EQ(2, bgra[1]);
+   EXPECT_EQ(1, bgra[2]);
+   EXPECT_EQ(255, bgra[3]);
+   converter.BGR24ToRGB32(bgra, rgb, 1, 1, 3);
+   EXPECT_EQ(1, bgra[0]);
+   EXPECT_EQ(3, bgra[2]);
+}
+
+
+TEST(PixelConvertTests, LinearLUT)
+{
+   std::vector<unsigned char> lut(65536);
+   PixelConverter::BuildLinearLUT(&lut[0], 100, 1120);
+   EXPECT_EQ(0, lut[0]);
+   EXPECT_EQ(0, lut[100]);
+   EXPECT_EQ(128, lut[610]);
+   EXPECT_EQ(255, lut[1120]);
+   EXPECT_EQ(255, lut[65535]);
+
+   const unsigned short src[] = { 0, 610, 4000 };
+   unsigned char dst[3];
+   PixelConverter().Gray16ToGray8(dst, src, 3, 1, sizeof(src), &lut[0]);
+   EXPECT_EQ(0, dst[0]);
+   EXPECT_EQ(128, dst[1]);
+   EXPECT_EQ(255, dst[2]);
+}
+
+
+TEST(PixelConvertTests, SIMDMatchesScalar)
+{
+   const unsigned w = testWidth, h = testHeight;
+   // Padded source rows
+   const unsigned stride = 4 * w + 12;
+   const std::vector<unsigned char> src = RandomBytes(stride * h);
+   const std::vector<unsigned char> uv = RandomBytes(stride * h / 2 + stride);
+
+   PixelConverter reference;
+   reference.SetInstructionSet(PixelConverter::Scalar);
+   std::vector<unsigned char> expYUYV(4 * w * h), expUYVY(4 * w * h),
+      expNV12(4 * w * h), expGray(w * h), expRGB(4 * w * h), expBGR(4 * w * h);
+   std::vector<unsigned short> exp10(w * h), exp12(w * h);
+   reference.YUYVToRGB32(&expYUYV[0], &src[0], w, h, stride);
+   reference.UYVYToRGB32(&expUYVY[0], &src[0], w, h, stride);
+   reference.NV12ToRGB32(&expNV12[0], &src[0], &uv[0], w, h, stride, stride);
+   reference.YUYVToGray8(&expGray[0], &src[0], w, h, stride);
+   reference.RGB24ToRGB32(&expRGB[0], &src[0], w, h, stride);
+   reference.BGR24ToRGB32(&expBGR[0], &src[0], w, h, stride);
+   reference.Mono10PackedToGray16(&exp10[0], &src[0], w, h, stride);
+   reference.Mono12PackedToGray16(&exp12[0], &src[0], w, h, stride);
+
+   const std::vector<PixelConverter::InstructionSet> sets =
+      SupportedInstructionSets();
+   for (std::size_t i = 0; i < sets.size(); ++i)
+   {
+      SCOPED_TRACE(PixelConverter::GetInstructionSetName(sets[i]));
+      PixelConverter converter;
+      converter.SetInstructionSet(sets[i]);
+      ASSERT_EQ(sets[i], converter.GetInstructionSet());
+
+      std::vector<unsigned char> rgb32(4 * w * h), gray(w * h);
+      std::vector<unsigned short> gray16(w * h);
+      converter.YUYVToRGB32(&rgb32[0], &src[0], w, h, stride);
+      EXPECT_TRUE(expYUYV == rgb32);
+      converter.UYVYToRGB32(&rgb32[0], &src[0], w, h, stride);
+      EXPECT_TRUE(expUYVY == rgb32);
+      converter.NV12ToRGB32(&rgb32[0], &src[0], &uv[0], w, h, stride, stride);
+      EXPECT_TRUE(expNV12 == rgb32);
+      converter.YUYVToGray8(&gray[0], &src[0], w, h, stride);
+      EXPECT_TRUE(expGray == gray);
+      converter.RGB24ToRGB32(&rgb32[0], &src[0], w, h, stride);
+      EXPECT_TRUE(expRGB == rgb32);
+      converter.BGR24ToRGB32(&rgb32[0], &src[0], w, h, stride);
+      EXPECT_TRUE(expBGR == rgb32);
+      converter.Mono10PackedToGray16(&gray16[0], &src[0], w, h, stride);
+      EXPECT_TRUE(exp10 == gray16);
+      converter.Mono12PackedToGray16(&gray16[0], &src[0], w, h, stride);
+      EXPECT_TRUE(exp12 == gray16);
+   }
+}
+
+
+TEST(PixelConvertTests, ThreadsMatchSingleThread)
+{
+   const unsigned w = 640, h = 481;
+   const std::vector<unsigned char> src = RandomBytes(2 * w * h);
+
+   PixelConverter converter;
+   std::vector<unsigned char> expected(4 * w * h), actual(4 * w * h);
+   converter.YUYVToRGB32(&expected[0], &src[0], w, h, 2 * w);
+   converter.SetThreadCount(3);
+   converter.YUYVToRGB32(&actual[0], &src[0], w, h, 2 * w);
+   EXPECT_TRUE(expected == actual);
+}
+
+
+int main(int argc, char** argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}